@@ -1,8 +1,150 @@
 // -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
 #include "macropores.h"
 
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
 namespace CRootBox {
 
+/**
+ * Constructor, transforms the conductivity into global coordinates
+ *
+ * @param a                     first end point of the pore axis [cm]
+ * @param b                     second end point of the pore axis [cm]
+ * @param radius                pore radius [cm]
+ * @param localConductivity     conductivity K' in the local axes of the pore, the first axis is along the pore
+ */
+MacroPore::MacroPore(const Vector3d& a, const Vector3d& b, double radius, const Matrix3d& localConductivity)
+    :a(a), b(b), radius(radius)
+{
+    Vector3d v = b.minus(a);
+    Matrix3d m = Matrix3d::ons(v); // orthonormal, i.e. M^-1 = M^T
+    Matrix3d k = m;
+    k.times(localConductivity);
+    k.times(m.inverse());
+    conductivity = k;
+}
+
+/**
+ * Signed distance between the point @param p and the surface of the pore (minus is inside)
+ */
+double MacroPore::getDist(const Vector3d& p) const
+{
+    Vector3d v = b.minus(a);
+    Vector3d w = p.minus(a);
+    double c1 = w.times(v);
+    double c2 = v.times(v);
+    double t = (c2>0) ? std::min(std::max(c1/c2, 0.), 1.) : 0.;
+    return p.minus(a.plus(v.times(t))).length()-radius;
+}
+
+/**
+ * Adds a pore with an anisotropic conductivity along and across the pore axis
+ *
+ * @param a         first end point of the pore axis [cm]
+ * @param b         second end point of the pore axis [cm]
+ * @param radius    pore radius [cm]
+ * @param axial     conductivity along the pore axis [1]
+ * @param radial    conductivity perpendicular to the pore axis [1]
+ * @return the index of the pore
+ */
+int MacroPoreRootSystem::addPore(const Vector3d& a, const Vector3d& b, double radius, double axial, double radial)
+{
+    return addPore(a, b, radius, Matrix3d(axial, 0, 0, 0, radial, 0, 0, 0, radial));
+}
+
+/**
+ * Adds a pore, and inserts its bounding box into the tree
+ *
+ * @param a                     first end point of the pore axis [cm]
+ * @param b                     second end point of the pore axis [cm]
+ * @param radius                pore radius [cm]
+ * @param localConductivity     conductivity K' in the local axes of the pore, the first axis is along the pore
+ * @return the index of the pore
+ */
+int MacroPoreRootSystem::addPore(const Vector3d& a, const Vector3d& b, double radius, const Matrix3d& localConductivity)
+{
+    if (!(radius>0) || (a.minus(b).length()==0)) {
+        std::cout << "MacroPoreRootSystem::addPore: pores need a positive radius and length\n" << std::flush;
+        throw std::invalid_argument("MacroPoreRootSystem::addPore: pores need a positive radius and length");
+    }
+    pores.push_back(MacroPore(a, b, radius, localConductivity));
+    std::vector<double> lower = { std::min(a.x, b.x)-radius, std::min(a.y, b.y)-radius, std::min(a.z, b.z)-radius };
+    std::vector<double> upper = { std::max(a.x, b.x)+radius, std::max(a.y, b.y)+radius, std::max(a.z, b.z)+radius };
+    poreTree.insertParticle(pores.size()-1, lower, upper);
+    return pores.size()-1;
+}
+
+/**
+ * The pore containing the point @param p, the innermost one if pores overlap
+ *
+ * @return the pore, or nullptr if the point is outside all pores
+ */
+const MacroPore* MacroPoreRootSystem::findPore(const Vector3d& p) const
+{
+    if (pores.empty()) {
+        return nullptr;
+    }
+    std::vector<double> x = { p.x, p.y, p.z };
+    auto indices = poreTree.query(aabb::AABB(x, x));
+    const MacroPore* pore = nullptr;
+    double mdist = 0.;
+    for (unsigned int i : indices) {
+        double d = pores[i].getDist(p);
+        if (d<mdist) {
+            mdist = d;
+            pore = &pores[i];
+        }
+    }
+    return pore;
+}
+
+/**
+ * Removes all pores of the collection
+ */
+void MacroPoreRootSystem::clearPores()
+{
+    pores.clear();
+    poreTree.removeAll();
+}
+
+/**
+ * Creates a MacroPoreRoot as base root, called by Seed::initialize and RootSystem::createBaseRoots
+ */
+Root* MacroPoreRootSystem::createRoot(int type, Vector3d iheading, double delay)
+{
+    return new (this) MacroPoreRoot(this, type, iheading, delay, nullptr, 0, 0);
+}
+
+/**
+ * @return an empty MacroPoreRoot, or the organ of Organism::createOrgan
+ */
+Organ* MacroPoreRootSystem::createOrgan(int ot)
+{
+    if (ot==ot_root) {
+        return new (this) MacroPoreRoot(-1, nullptr, true, true, 0., 0., Vector3d(), 0., 0);
+    }
+    return Organism::createOrgan(ot);
+}
+
+/**
+ * @copydoc Root::copy
+ */
+Organ* MacroPoreRoot::copy(Organism* rs)
+{
+    MacroPoreRoot* r = new (rs) MacroPoreRoot(*this); // shallow copy
+    r->parent = nullptr;
+    r->plant = rs;
+    r->samples = nullptr; // copies might be simulated in parallel
+    r->param_->retain(); // share parameters
+    for (size_t i=0; i< children.size(); i++) {
+        r->children[i] = children[i]->copy(rs); // copy laterals
+        r->children[i]->setParent(this);
+    }
+    return r;
+}
+
 /**
  *  @copydoc Root::createLateral
  *
@@ -10,13 +152,17 @@ namespace CRootBox {
  */
 void MacroPoreRoot::createLateral(bool verbose)
 {
-    int lt = getRootTypeParameter()->getLateralType(nodes.back());
+    Instrumentation::Timer timer(plant->getInstrumentation(), Organism::ot_root, Instrumentation::p_createLateral);
+    int lt = getRootTypeParameter()->getLateralType(getNode(getNumberOfNodes()-1), plant);
     if (lt>0) {
         double ageLN = this->calcAge(length); // age of root when lateral node is created
         double ageLG = this->calcAge(length+param()->la); // age of the root, when the lateral starts growing (i.e when the apical zone is developed)
         double delay = ageLG-ageLN; // time the lateral has to wait
-        Root* lateral = new MacroPoreRoot(plant, lt,  heading(), delay,  this, length, nodes.size()-1);
+        Root* lateral = new (plant) MacroPoreRoot(plant, lt,  heading(), delay,  this, length, getNumberOfNodes()-1);
         children.push_back(lateral);
+        if (plant->getInstrumentation().isEnabled()) {
+            plant->getInstrumentation().count(Organism::ot_root, Instrumentation::c_laterals);
+        }
         lateral->simulate(age-ageLN,verbose); // pass time overhead (age we want to achieve minus current age)
     }
 }
@@ -24,15 +170,23 @@ void MacroPoreRoot::createLateral(bool verbose)
 /**
  *  @copydoc Root::getIncrement
  *
- *  adds macro pore model to the increment
+ *  adds macro pore model to the increment, the pores of the collection are used before the pore geometry
  */
 Vector3d MacroPoreRoot::getIncrement(const Vector3d& p, double sdx)
 {
-    Vector3d sv = Root::getIncrement(p, sdx).normalize();
-    if (((MacroPoreRootSystem*)plant)->poreGeometry==nullptr) { // no pores defined
+    Vector3d sv = Root::getIncrement(p, sdx);
+    sv.normalize();
+    const MacroPoreRootSystem* rs = (MacroPoreRootSystem*)plant;
+    const MacroPore* pore = rs->findPore(p);
+    if (pore!=nullptr) { // inside a pore of the collection
+        Vector3d sv1 = pore->conductivity.times(sv);
+        sv1.normalize();
+        return sv1.times(sdx);
+    }
+    if (rs->poreGeometry==nullptr) { // no pores defined
         return sv.times(sdx);
     } else {
-        if (((MacroPoreRootSystem*)plant)->poreGeometry->getDist(p)<0) { // inside the pore
+        if (rs->poreGeometry->getDist(p)<0) { // inside the pore
             auto sv1 = ((MacroPoreRootSystem*)plant)->applyPoreConductivities(sv);
             // std::cout << "Length before " << sv.length() << ", length after " << sv1.length() << "\n";
             sv1.normalize();
@@ -43,4 +197,4 @@ Vector3d MacroPoreRoot::getIncrement(const Vector3d& p, double sdx)
     }
 }
 
-}
+} // end namespace CRootBox
@@ -4,17 +4,45 @@
 
 #include "RootSystem.h"
 
+#include "../../external/aabbcc/AABB.h"
+
+#include <vector>
+
 namespace CRootBox {
 
+/**
+ * A cylindrical macro pore (e.g. an earthworm burrow) from a to b, with its conductivity in global coordinates
+ */
+struct MacroPore {
+
+    MacroPore(const Vector3d& a, const Vector3d& b, double radius, const Matrix3d& localConductivity);
+
+    double getDist(const Vector3d& p) const; ///< signed distance to the pore surface (minus is inside)
+
+    Vector3d a; ///< first end point of the pore axis [cm]
+    Vector3d b; ///< second end point of the pore axis [cm]
+    double radius; ///< pore radius [cm]
+    Matrix3d conductivity; ///< K = M*K'*M^-1, with the local axes M of the pore (first axis along the pore), Landl et al. 2016, Eqn (12)
+
+};
+
 /**
  * Include the macro pore model of Landl et al. 2016 into the RootBox model
  *
+ * Either a single pore geometry with constant local axes (setPoreGeometry, setPoreLocalAxes), or a collection of
+ * cylindrical pores (addPore). The pores of the collection are put into an aabb tree, and their conductivities are
+ * transformed into global coordinates when they are added, so a root increment costs one tree query and
+ * one matrix vector product, independent of the number of pores.
+ *
  * D. Leitner, 2019
  */
 class MacroPoreRootSystem : public RootSystem {
+
+    friend class MacroPoreRoot;
+
 public:
 
-    // todo overwrite initialize to create MacroPoreRoot as base organs
+    Root* createRoot(int type, Vector3d iheading, double delay) override; ///< creates MacroPoreRoot as base roots
 
     // Macro pores
     void setPoreGeometry(SignedDistanceFunction* geom) { poreGeometry = geom; }
@@ -27,6 +55,18 @@ public:
         return poreLocalAxes.times(poreConductivity.times(invPoreLocalAxes.times(v))); // Landl et al. 2016, Eqn (12), K*v = [M*K'*(M^-1)]*v
     }
 
+    // Collection of pores
+    int addPore(const Vector3d& a, const Vector3d& b, double radius, double axial, double radial); ///< adds a pore, returns its index
+    int addPore(const Vector3d& a, const Vector3d& b, double radius, const Matrix3d& localConductivity); ///< adds a pore with the conductivity K' in its local axes
+    int getNumberOfPores() const { return pores.size(); }
+    const MacroPore& getPore(int i) const { return pores.at(i); }
+    const MacroPore* findPore(const Vector3d& p) const; ///< pore containing the point, or nullptr
+    void clearPores(); ///< removes all pores of the collection
+
+protected:
+
+    Organ* createOrgan(int ot) override; ///< empty MacroPoreRoot (see Organism::readBinary)
+
 private:
 
     // todo currently everything is constant... // (move to specific application)
@@ -35,6 +75,9 @@ private:
     Matrix3d invPoreLocalAxes = Matrix3d();
     SignedDistanceFunction* poreGeometry = nullptr;
 
+    std::vector<MacroPore> pores;
+    mutable aabb::Tree poreTree = aabb::Tree(); // aabb::Tree::query does not modify the tree, but is not declared const
+
 };
 
 /**
@@ -42,8 +85,15 @@ private:
  */
 class MacroPoreRoot :public Root {
 
+public:
+
+    MacroPoreRoot(int id, const OrganSpecificParameter* param, bool alive, bool active, double age, double length,
+        Vector3d iheading, double pbl, int pni, bool moved = false, int oldNON = 0)
+    :Root(id, param, alive, active, age, length, iheading, pbl, pni, moved, oldNON) { }
     MacroPoreRoot(Organism* rs, int type, Vector3d pheading, double delay, Root* parent, double pbl, int pni) :Root(rs, type, pheading, delay, parent, pbl, pni) { }
 
+    Organ* copy(Organism* rs) override; ///< deep copies the root tree, keeping the class of the roots
+
 protected:
 
     Vector3d getIncrement(const Vector3d& p, double sdx) override; ///< called by createSegments, to determine growth direction
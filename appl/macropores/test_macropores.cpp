@@ -0,0 +1,73 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "macropores.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+/**
+ * Checks that a straight tap root entering a tilted pore is redirected along the pore,
+ * and that copies and restarts of the root system keep the MacroPoreRoot base organs
+ */
+using namespace CRootBox;
+
+static void setParameters(RootSystem& rs)
+{
+    auto rrp = new RootRandomParameter(&rs);
+    rrp->subType = 1;
+    rrp->lb = 0.;
+    rrp->la = 40.; // no laterals, the maximal length is lb+la
+    rrp->r = 2.;
+    rrp->gf = 2; // linear growth
+    rrp->tropismT = RootSystem::tt_gravi;
+    rrp->tropismS = 0.;
+    rrp->theta = 0.; // straight down
+    rrp->dx = 0.1;
+    rs.setOrganRandomParameter(rrp);
+}
+
+static Vector3d tip(const RootSystem& rs)
+{
+    const Organ* r = rs.getRoots().at(0);
+    return r->getNode(r->getNumberOfNodes()-1);
+}
+
+static bool check(bool b, std::string msg)
+{
+    std::cout << (b ? "passed: " : "FAILED: ") << msg << "\n";
+    return b;
+}
+
+int main()
+{
+    // the tap root grows straight down from (0,0,-3), the pore is tilted by 45 degrees and crosses the root at z = -10
+    RootSystem ref;
+    setParameters(ref);
+    ref.initialize();
+    ref.simulate(12);
+
+    MacroPoreRootSystem rs;
+    setParameters(rs);
+    rs.addPore(Vector3d(-10,0,-20), Vector3d(10,0,0), 1., 1., 0.01);
+    rs.initialize();
+    rs.simulate(3); // the root enters the pore
+    MacroPoreRootSystem cp = rs;
+    rs.save("test_macropores.bin");
+    MacroPoreRootSystem ld;
+    ld.addPore(Vector3d(-10,0,-20), Vector3d(10,0,0), 1., 1., 0.01);
+    ld.load("test_macropores.bin");
+    std::remove("test_macropores.bin");
+    rs.simulate(9);
+    cp.simulate(9);
+    ld.simulate(9);
+
+    Vector3d t0 = tip(ref), t = tip(rs);
+    std::cout << "tip without pore " << t0.toString() << ", with pore " << t.toString() << "\n";
+    bool ok = true;
+    ok &= check(std::fabs(t0.x)<1.e-9, "the root grows straight without pores");
+    ok &= check(t.x<-5., "the root is redirected along the pore");
+    ok &= check(std::fabs(t.x-t.z-10.)<2., "the root tip stays close to the pore axis");
+    ok &= check(tip(cp).minus(t).length()<1.e-9, "the copy grows along the pore");
+    ok &= check(tip(ld).minus(t).length()<1.e-9, "the restart grows along the pore");
+    return ok ? 0 : 1;
+}
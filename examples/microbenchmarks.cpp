@@ -0,0 +1,229 @@
+// Copyright (C) 2016 Daniel Leitner and Andrea Schnepf. See //license.txt for details.
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <dirent.h>
+
+#include "../src/RootSystem.h"
+#include "../src/analysis.h"
+#include "../src/sdf_rs.h"
+
+/**
+ * Microbenchmarks
+ *
+ * Times the simulation hot paths (root growth, tropisms, signed distance functions, segment analysis, SDF_RootSystem
+ * queries, and the writers) for each model parameter set, and writes the results into a CSV file, one line per benchmark:
+ *
+ * parameters, benchmark, calls, repetitions, best [s], mean [s], best per call [s]
+ *
+ * Each benchmark is repeated, the best time is the most stable value to compare between releases.
+ *
+ * Usage: benchmark_crootbox [-r repetitions] [-o file.csv] [-p parameter folder] [parameter set names...]
+ * the default file is "benchmarks.csv", without names all xml files of the parameter folder (default "modelparameter/")
+ * are benchmarked.
+ */
+namespace CRootBox {
+
+/**
+ * Calls f(i) for i = 0..repetitions-1, each call performs calls operations, and writes a line of results
+ */
+void measure(std::ostream& os, const std::string& parameters, const std::string& benchmark, int calls, int repetitions,
+    std::function<void(int)> f)
+{
+    std::vector<double> times;
+    for (int i=0; i<repetitions; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        f(i);
+        auto t1 = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(t1-t0).count());
+    }
+    double best = *std::min_element(times.begin(), times.end());
+    double mean = 0.;
+    for (double t : times) {
+        mean += t/repetitions;
+    }
+    os << parameters << "," << benchmark << "," << calls << "," << repetitions << "," << best << "," << mean << ","
+        << best/calls << "\n" << std::flush;
+}
+
+/**
+ * Runs all benchmarks for a single parameter set
+ */
+void microbenchmarks(std::ostream& os, const std::string& path, const std::string& name, int repetitions)
+{
+    const double simtime = 30.; // days
+    const int n = 10000; // number of points per query benchmark
+    volatile double sink = 0.; // keeps results of queries alive
+
+    /* growth */
+    std::vector<RootSystem> copies(repetitions);
+    for (auto& r : copies) {
+        r.Organism::readParameters(path + name + ".xml");
+        r.setSeed(1);
+        r.initialize();
+    }
+    measure(os, name, "RootSystem::simulate", 1, repetitions, [&](int i) { copies[i].simulate(simtime); });
+    RootSystem& grown = copies.back();
+
+    /* points, half of them within the container */
+    SDF_PlantContainer container(10., 10., 40., false);
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> UD(-1., 1.);
+    std::vector<Vector3d> points(n);
+    for (int i=0; i<n; i++) {
+        points[i] = Vector3d(15.*UD(gen), 15.*UD(gen), -30.+30.*UD(gen));
+    }
+
+    /* tropisms */
+    Gravitropism tropism(&grown, 1., 0.2);
+    measure(os, name, "Tropism::getHeading", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            sink = sink + tropism.getHeading(p, Matrix3d(), 0.1).x;
+        }
+    });
+    tropism.setGeometry(&container);
+    measure(os, name, "Tropism::getHeading (geometry)", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            Vector3d q(std::min(std::max(p.x, -9.), 9.), std::min(std::max(p.y, -9.), 9.), std::min(std::max(p.z, -39.), -1.)); // within
+            sink = sink + tropism.getHeading(q, Matrix3d(), 0.1).x;
+        }
+    });
+
+    /* signed distance functions */
+    SDF_PlantBox box(20., 20., 50.);
+    SDF_RotateTranslate moved(&box, Vector3d(5., 0., -10.));
+    SDF_Difference difference(&container, &moved);
+    SDF_Compiled compiled(&difference);
+    measure(os, name, "SDF_PlantContainer::getDist", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            sink = sink + container.getDist(p);
+        }
+    });
+    measure(os, name, "SDF_Difference::getDist", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            sink = sink + difference.getDist(p);
+        }
+    });
+    measure(os, name, "SDF_Compiled::getDist", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            sink = sink + compiled.getDist(p);
+        }
+    });
+
+    /* segment analysis */
+    measure(os, name, "SegmentAnalyser::SegmentAnalyser", 1, repetitions, [&](int) {
+        SegmentAnalyser a(grown);
+        sink = sink + a.segments.size();
+    });
+    SegmentAnalyser analyser(grown);
+    measure(os, name, "SegmentAnalyser::filter", 1, repetitions, [&](int) {
+        SegmentAnalyser a(analyser);
+        a.filter("subType", 1);
+        sink = sink + a.segments.size();
+    });
+    measure(os, name, "SegmentAnalyser::crop", 1, repetitions, [&](int) {
+        SegmentAnalyser a(analyser);
+        a.crop(&container);
+        sink = sink + a.segments.size();
+    });
+    measure(os, name, "SegmentAnalyser::distribution", 1, repetitions, [&](int) {
+        sink = sink + analyser.distribution("length", 0., -50., 50, true).at(0);
+    });
+
+    /* SDF_RootSystem */
+    measure(os, name, "SDF_RootSystem::SDF_RootSystem", 1, repetitions, [&](int) {
+        SDF_RootSystem sdf(grown);
+        sink = sink + sdf.getDist(Vector3d());
+    });
+    SDF_RootSystem sdf(grown);
+    measure(os, name, "SDF_RootSystem::getDist", n, repetitions, [&](int) {
+        for (const auto& p : points) {
+            sink = sink + sdf.getDist(p);
+        }
+    });
+    measure(os, name, "SDF_RootSystem::getNearestSegments", n/10, repetitions, [&](int) {
+        for (int i=0; i<n/10; i++) {
+            sink = sink + sdf.getNearestSegments(points[i], 4).size();
+        }
+    });
+
+    /* writers */
+    std::string out = "benchmark_" + name;
+    measure(os, name, "RootSystem::write (vtp)", 1, repetitions, [&](int) { grown.write(out + ".vtp"); });
+    measure(os, name, "Organism::writeRSML", 1, repetitions, [&](int) { grown.writeRSML(out + ".rsml"); });
+    measure(os, name, "SegmentAnalyser::write (vtp)", 1, repetitions, [&](int) { analyser.write(out + "_segments.vtp"); });
+    measure(os, name, "Organism::save", 1, repetitions, [&](int) { grown.save(out + ".bin"); });
+    measure(os, name, "Organism::load", 1, repetitions, [&](int) {
+        RootSystem r;
+        r.load(out + ".bin");
+    });
+    for (std::string ext : { ".vtp", ".rsml", "_segments.vtp", ".bin" }) {
+        std::remove((out + ext).c_str());
+    }
+}
+
+} // end namespace CRootBox
+
+int main(int argc, char* argv[])
+{
+    using namespace CRootBox;
+
+    int repetitions = 3;
+    std::string path = "modelparameter/";
+    std::string file = "benchmarks.csv";
+    std::vector<std::string> names;
+    for (int i=1; i<argc; i++) {
+        std::string a = argv[i];
+        if ((a=="-r" || a=="-o" || a=="-p") && (i+1<argc)) {
+            std::string v = argv[++i];
+            if (a=="-r") {
+                repetitions = std::max(std::stoi(v), 1);
+            } else if (a=="-o") {
+                file = v;
+            } else {
+                path = v + "/";
+            }
+        } else {
+            names.push_back(a);
+        }
+    }
+
+    if (names.empty()) { // all parameter sets
+        DIR* dir = opendir(path.c_str());
+        if (dir==nullptr) {
+            std::cout << "benchmark_crootbox: could not open parameter folder " << path << "\n" << std::flush;
+            return 1;
+        }
+        while (dirent* e = readdir(dir)) {
+            std::string f = e->d_name;
+            if ((f.size()>4) && (f.substr(f.size()-4)==".xml")) {
+                names.push_back(f.substr(0, f.size()-4));
+            }
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+    }
+
+    std::ofstream os(file);
+    if (!os.good()) {
+        std::cout << "benchmark_crootbox: could not open file " << file << "\n" << std::flush;
+        return 1;
+    }
+    os << "parameters,benchmark,calls,repetitions,best [s],mean [s],best per call [s]\n";
+    int failed = 0;
+    for (const auto& name : names) {
+        try {
+            std::cout << "benchmarking " << name << "\n" << std::flush;
+            microbenchmarks(os, path, name, repetitions);
+        } catch (const std::exception& e) {
+            std::cerr << "benchmark_crootbox: " << name << " failed: " << e.what() << "\n" << std::flush;
+            failed++;
+        }
+    }
+    return (failed>0) ? 1 : 0;
+}
@@ -2,19 +2,76 @@
 #include "Organ.h"
 
 #include "Organism.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
 
 #include "organparameter.h"
+#include "binaryio.h"
+#include "parallel.h"
 
 namespace CRootBox {
 
+/* interned parameter names, the first Organ::pi_numberOfIds entries correspond to Organ::ParameterIds */
+static std::vector<std::string> parameterNames = { "length", "age", "creationTime", "order", "one", "id", "organType", "subType",
+    "alive", "active", "nubmerOfChildren", "lb", "la", "nob", "r", "radius", "a", "theta", "rlt", "k", "lnMean", "lnDev", "volume",
+    "surface", "type", "iHeadingX", "iHeadingY", "iHeadingZ", "parentBaseLength", "parentNI" };
+static std::map<std::string, int> parameterIds; // name to id, built on first use
+static std::mutex parameterMutex; // guards parameterNames and parameterIds
+
+/**
+ * Interns the parameter name @param name.
+ * Names of Organ::ParameterIds map to their enum values, any other name (e.g. of an organ type parameter)
+ * obtains a new id, that is valid for the life time of the program.
+ *
+ * Resolve the id once, and use Organ::getParameter(int) or Organ::getParameters in loops over organs.
+ *
+ * @return the parameter id
+ */
+int Organ::parameterId(std::string name)
+{
+    std::lock_guard<std::mutex> lock(parameterMutex);
+    if (parameterIds.empty()) {
+        assert(parameterNames.size()==pi_numberOfIds && "Organ::parameterId: parameter names do not match Organ::ParameterIds");
+        for (int i=0; i<parameterNames.size(); i++) {
+            parameterIds[parameterNames[i]] = i;
+        }
+        parameterIds["numberOfChildren"] = pi_numberOfChildren;
+    }
+    auto it = parameterIds.find(name);
+    if (it!=parameterIds.end()) {
+        return it->second;
+    }
+    int id = parameterNames.size();
+    parameterNames.push_back(name);
+    parameterIds[name] = id;
+    return id;
+}
+
+/**
+ * @return the parameter name of the interned id @param id (@see Organ::parameterId)
+ */
+std::string Organ::parameterName(int id)
+{
+    std::lock_guard<std::mutex> lock(parameterMutex);
+    try {
+        return parameterNames.at(id);
+    } catch (const std::exception& e) {
+        std::cout << "Organ::parameterName: unknown parameter id " << id << "\n";
+        throw(e);
+    }
+}
+
 /**
  * Constructs an organ from given data.
  * The organ tree must be created, @see Organ::setPlant, Organ::setParent, Organ::addChild
  * Organ geometry must be created, @see Organ::addNode, ensure that this->getNodeId(0) == parent->getNodeId(pni)
  *
  * @param id        the organ's unique id (@see Organ::getId)
- * @param param     the organs parameters set, ownership transfers to the organ
+ * @param param     the organs parameters set, the organ holds a reference (@see OrganSpecificParameter::retain)
  * @param alive     indicates if the organ is alive (@see Organ::isAlive)
  * @param active    indicates if the organ is active (@see Organ::isActive)
  * @param age       the current age of the organ (@see Organ::getAge)
@@ -33,7 +90,11 @@ Organ::Organ(int id, const OrganSpecificParameter* param, bool alive, bool activ
         length(length),
         moved(moved),
         oldNumberOfNodes(oldNON)
-{ }
+{
+    if (param_!=nullptr) {
+        param_->retain();
+    }
+}
 
 /**
  * The constructor is used for simulation.
@@ -51,34 +112,90 @@ Organ::Organ(Organism* plant, Organ* parent, int ot, int st, double delay):
         plant(plant),
         parent(parent),
         id(plant->getOrganIndex()),  // unique id from the plant
-        param_(plant->getOrganRandomParameter(ot, st)->realize()), // draw specific parameters from random distributions
-        age(-delay)
-{ }
+        stream((parent!=nullptr) ? OrganStream::mix(parent->stream.key, parent->children.size()) : OrganStream::mix(plant->getSeed(), id)),
+        param_(realize(ot, st)), // draw specific parameters from random distributions
+        age(-delay),
+        journaled(plant->getCheckpoint()) // created after the checkpoint, there is nothing to restore
+{
+    param_->retain();
+}
 
 /**
- * Destructor deletes all children, and its parameter class
+ * Draws the specific parameters of a new organ from the random parameters of the plant,
+ * with the stream of the organ, if the organism uses organ streams (is called before the parameters are initialized)
+ *
+ * @param ot        organ type
+ * @param st        sub type of the organ type
+ */
+const OrganSpecificParameter* Organ::realize(int ot, int st)
+{
+    Organism::StreamScope scope(plant, &stream);
+    return plant->getSharedOrganRandomParameter(ot, st)->realize(plant);
+}
+
+/**
+ * Destructor deletes all children, and releases its parameter class
  */
 Organ::~Organ()
 {
     for(auto c : children) {
         delete c;
     }
-    delete param_; // organ parameters
+    if (param_!=nullptr) {
+        param_->release(); // organ parameters, deleted if they are not shared
+    }
+}
+
+/**
+ * Allocates the organ from the memory pool of the plant, organs of a plant are thus released in bulk,
+ * and organs created one after the other lie next to each other in memory
+ *
+ * @param size      size of the object [bytes]
+ * @param plant     the plant owning the pool, nullptr allocates on the heap
+ */
+void* Organ::operator new(size_t size, Organism* plant)
+{
+    if (plant==nullptr) {
+        return MemoryPool::allocateHeap(size);
+    }
+    return plant->getMemoryPool().allocate(size);
+}
+
+/**
+ * Allocates the organ on the heap (e.g. organs created in Python)
+ */
+void* Organ::operator new(size_t size)
+{
+    return MemoryPool::allocateHeap(size);
+}
+
+/**
+ * Returns the memory to the pool it was allocated from, or to the heap
+ */
+void Organ::operator delete(void* p)
+{
+    MemoryPool::deallocate(p);
+}
+
+void Organ::operator delete(void* p, Organism* plant)
+{
+    MemoryPool::deallocate(p);
 }
 
 /*
  * Deep copies this organ into the new plant @param plant.
  * All children are deep copied, plant and parent pointers are updated.
+ * The specific parameters are immutable, and shared with the copy.
  *
  * @param plant     the plant the copied organ will be part of
  * @return          the newly created copy (ownership is passed)
  */
 Organ* Organ::copy(Organism* p)
 {
-    Organ* o = new Organ(*this); // shallow copy
+    Organ* o = new (p) Organ(*this); // shallow copy
     o->parent=nullptr;
     o->plant = p;
-    o->param_ = new OrganSpecificParameter(*param_); // copy parameters
+    o->param_->retain(); // share parameters
     for (size_t i=0; i< children.size(); i++) {
         o->children[i] = children[i]->copy(p); // copy lateral
         o->children[i]->setParent(this);
@@ -100,10 +217,18 @@ int Organ::organType() const
 /**
  * @return The organ type parameter is retrieved from the plant organism.
  * The Organism class manages all organs type parameters.
+ *
+ * The pointer is cached, and resolved again whenever the organism replaces a type parameter (see Organism::getParameterVersion),
+ * or the organ was copied into another organism (version numbers are unique).
  */
 OrganRandomParameter* Organ::getOrganRandomParameter() const
 {
-    return plant->getOrganRandomParameter(this->organType(), param_->subType);
+    uint64_t version = plant->getParameterVersion();
+    if (randomParamVersion!=version) {
+        randomParam = plant->getSharedOrganRandomParameter(this->organType(), param_->subType);
+        randomParamVersion = version;
+    }
+    return randomParam;
 }
 
 /**
@@ -115,15 +240,19 @@ OrganRandomParameter* Organ::getOrganRandomParameter() const
 void Organ::simulate(double dt, bool verbose)
 {
     // store information of this time step
-    oldNumberOfNodes = nodes.size();
+    oldNumberOfNodes = getNumberOfNodes();
     moved = false;
 
     // if the organ is alive, manage children
     if (alive) {
         age += dt;
         for (auto& c : children)  {
-            c->simulate(dt, verbose);
+            if (!c->isFinished() && !c->isSleeping()) {
+                c->simulate(dt, verbose);
+            }
         }
+    } else { // dead at the start of the time step: nothing has changed, and nothing will change
+        finished = true;
     }
 }
 
@@ -136,6 +265,7 @@ void Organ::addChild(Organ* c)
 {
     c->setParent(this);
     children.push_back(c);
+    plant->organTreeChanged();
 }
 
 /**
@@ -149,9 +279,303 @@ void Organ::addChild(Organ* c)
  */
 void Organ::addNode(Vector3d n, int id, double t)
 {
-    nodes.push_back(n); // node
+    if (nodeIds.size()==0) {
+        firstNodeCT = t;
+    }
     nodeIds.push_back(id); // new unique id
-    nodeCTs.push_back(t); // exact creation time
+    if ((tipNodes==nullptr) && (plant!=nullptr) && plant->getNodeStore().isRounded()) {
+        tipNodes = std::make_shared<TipNodes>(); // a new organ (see Organ::holdTipNodes)
+    } else if (tipNodes.use_count()>1) { // shared with a copy, or a saved state
+        tipNodes = std::make_shared<TipNodes>(*tipNodes);
+    }
+    if (tipNodes!=nullptr) {
+        tipNodes->nodes[0] = tipNodes->nodes[1];
+        tipNodes->cts[0] = tipNodes->cts[1];
+        tipNodes->nodes[1] = n;
+        tipNodes->cts[1] = t;
+    }
+    storeNode(nodeIds.size()-1, n, t);
+}
+
+/**
+ * Moves the i-th node, e.g. the tip in case of impeded growth
+ *
+ * @param i         local node index
+ * @param n         new node coordinates [cm]
+ * @param t         new node creation time [day]
+ */
+void Organ::setNode(int i, const Vector3d& n, double t)
+{
+    int j = i-getNumberOfNodes()+2;
+    if ((tipNodes!=nullptr) && (j>=0) && (j<2) && (i>=0)) {
+        if (tipNodes.use_count()>1) {
+            tipNodes = std::make_shared<TipNodes>(*tipNodes);
+        }
+        tipNodes->nodes[j] = n;
+        tipNodes->cts[j] = t;
+    }
+    if (i==0) {
+        firstNodeCT = t;
+    }
+    storeNode(i, n, t);
+}
+
+/**
+ * Growing organs hold their last two nodes in full precision, if the node store is rounded, so that the growth
+ * does not depend on the storage precision. Called for the base organs before and after the precision of the
+ * node store is changed (see Organism::setStoragePrecision), released tip nodes are written into the store.
+ *
+ * @param rounded   the node store is (or will be) rounded
+ */
+void Organ::holdTipNodes(bool rounded)
+{
+    int n = getNumberOfNodes();
+    if (rounded && alive && active && (tipNodes==nullptr) && (n>0)) {
+        auto tn = std::make_shared<TipNodes>();
+        for (int j = std::max(2-n, 0); j<2; j++) {
+            tn->nodes[j] = getNode(n-2+j);
+            tn->cts[j] = getNodeCT(n-2+j);
+        }
+        tipNodes = tn;
+    } else if (!rounded && (tipNodes!=nullptr)) {
+        auto tn = tipNodes;
+        tipNodes = nullptr;
+        for (int j = std::max(2-n, 0); j<2; j++) {
+            storeNode(n-2+j, tn->nodes[j], tn->cts[j]);
+        }
+    }
+    for (auto& c : children) {
+        c->holdTipNodes(rounded);
+    }
+}
+
+/**
+ * @return the i-th node, from the tip nodes, the pending nodes, or the node store of the plant
+ *
+ * @param i         local node index
+ */
+Vector3d Organ::getNode(int i) const
+{
+    int j = i-getNumberOfNodes()+2;
+    if ((tipNodes!=nullptr) && (j>=0) && (j<2) && (i>=0)) {
+        return tipNodes->nodes[j];
+    }
+    if ((pending!=nullptr) && (i>=pending->first)) {
+        return pending->nodes.at(i-pending->first);
+    }
+    return plant->getNodeStore().getNode(nodeIds.at(i));
+}
+
+/**
+ * @return the creation time of the i-th node, the first node of a lateral has its own creation time
+ * (the node store holds the creation time of the parent node)
+ *
+ * @param i         local node index
+ */
+double Organ::getNodeCT(int i) const
+{
+    int j = i-getNumberOfNodes()+2;
+    if ((tipNodes!=nullptr) && (j>=0) && (j<2) && (i>=0)) {
+        return tipNodes->cts[j];
+    }
+    if (i==0) {
+        return firstNodeCT;
+    }
+    if ((pending!=nullptr) && (i>=pending->first)) {
+        return pending->cts.at(i-pending->first);
+    }
+    return plant->getNodeStore().getNodeCT(nodeIds.at(i));
+}
+
+/**
+ * Writes the i-th node into the organism's node store (see Organism::getNodeStore).
+ *
+ * The first node of a lateral is owned by its parent, and is not written.
+ * Nodes with provisional ids, nodes written during a parallel simulation step (the subtrees share the store),
+ * and nodes of an organ without plant are kept as pending nodes, and are written by Organ::flushNodes.
+ *
+ * @param i         local node index
+ */
+void Organ::storeNode(int i)
+{
+    storeNode(i, getNode(i), getNodeCT(i));
+}
+
+/**
+ * Writes the i-th node into the organism's node store, with given coordinates and creation time
+ *
+ * @param i         local node index
+ * @param n         node coordinates [cm]
+ * @param t         node creation time [day]
+ */
+void Organ::storeNode(int i, const Vector3d& n, double t)
+{
+    if ((pending==nullptr) && (plant!=nullptr) && (nodeIds[i]>=0) && !Organism::isSimulatingSubtree()) {
+        if ((i>0) || (parent==nullptr)) {
+            int p = (i>0) ? nodeIds[i-1] : -1;
+            plant->getNodeStore().set(nodeIds[i], n, t, this, p);
+        }
+        return;
+    }
+    if (pending==nullptr) {
+        pending = std::make_shared<PendingNodes>();
+        pending->first = i;
+    } else if (pending.use_count()>1) { // shared with a copy
+        pending = std::make_shared<PendingNodes>(*pending);
+    }
+    while (i<pending->first) { // extend to the front
+        pending->first--;
+        pending->nodes.insert(pending->nodes.begin(), getNode(pending->first));
+        pending->cts.insert(pending->cts.begin(), getNodeCT(pending->first));
+    }
+    size_t k = i-pending->first;
+    pending->nodes.resize(std::max(pending->nodes.size(), k+1));
+    pending->cts.resize(pending->nodes.size());
+    pending->nodes[k] = n;
+    pending->cts[k] = t;
+}
+
+/**
+ * Writes the pending nodes into the node store, if the organ has a plant, and all its node ids are final
+ */
+void Organ::flushNodes()
+{
+    if ((pending==nullptr) || (plant==nullptr) || Organism::isSimulatingSubtree()) {
+        return;
+    }
+    for (size_t i=pending->first; i<nodeIds.size(); i++) {
+        if (nodeIds[i]<0) {
+            return;
+        }
+    }
+    auto pn = pending;
+    pending = nullptr;
+    pn->nodes.resize(std::max(int(nodeIds.size())-pn->first, 0)); // the organ might have been shrunk (see RootState::restore)
+    for (size_t k=0; k<pn->nodes.size(); k++) {
+        storeNode(pn->first+k, pn->nodes[k], pn->cts[k]);
+    }
+}
+
+/**
+ * Writes all nodes of the organ and its children into the organism's node store,
+ * e.g. after the organ tree was copied
+ */
+void Organ::storeNodes()
+{
+    flushNodes();
+    for (size_t i=0; i<nodeIds.size(); i++) {
+        storeNode(i);
+    }
+    for (auto& c : children) {
+        c->storeNodes();
+    }
+}
+
+/**
+ * @return all nodes of the organ
+ */
+std::vector<Vector3d> Organ::getNodes() const
+{
+    std::vector<Vector3d> n;
+    getNodes(n);
+    return n;
+}
+
+/**
+ * All nodes of the organ
+ *
+ * @param n         buffer receiving the nodes [cm]
+ */
+void Organ::getNodes(std::vector<Vector3d>& n) const
+{
+    n.resize(nodeIds.size());
+    for (size_t i=0; i<n.size(); i++) {
+        n[i] = getNode(i);
+    }
+}
+
+/**
+ * All node creation times of the organ
+ *
+ * @param cts       buffer receiving the creation times [day]
+ */
+void Organ::getNodeCTs(std::vector<double>& cts) const
+{
+    cts.resize(nodeIds.size());
+    for (size_t i=0; i<cts.size(); i++) {
+        cts[i] = getNodeCT(i);
+    }
+}
+
+/**
+ * @return the memory of the node data held by the organ, i.e. node indices, tip nodes, and pending nodes,
+ * elements shared with copies are counted fully [bytes]
+ */
+size_t Organ::getNodeMemory() const
+{
+    size_t m = nodeIds.get().capacity()*sizeof(int);
+    if (tipNodes!=nullptr) {
+        m += sizeof(TipNodes);
+    }
+    if (pending!=nullptr) {
+        m += pending->nodes.capacity()*sizeof(Vector3d)+pending->cts.capacity()*sizeof(double);
+    }
+    return m;
+}
+
+/**
+ * Saves the state of the organ for the current checkpoint of the plant, if this was not done already.
+ * Must be called before the organ is changed.
+ */
+void Organ::journal()
+{
+    if (plant!=nullptr) {
+        int c = plant->getCheckpoint();
+        if ((c!=0) && (journaled!=c)) {
+            plant->journal(this);
+            journaled = c;
+        }
+    }
+}
+
+/**
+ * True, if the organ is dormant, and neither the organ nor one of its children emerges or dies before the end of the
+ * current time step. Then the organ and its children are skipped by the simulation, their age is advanced lazily.
+ */
+bool Organ::isSleeping() const
+{
+    return dormant && (plant->getStepEnd()<wakeTime);
+}
+
+/**
+ * Age of the organ [day]. Dormant organs are not simulated, the age is advanced by the time since their last simulation.
+ */
+double Organ::getAge() const
+{
+    if (dormant) {
+        return age+std::max(plant->getSimTime()-visited, 0.);
+    }
+    return age;
+}
+
+/**
+ * Called by an organ that died during the current time step: the dormant organs of its subtree are not simulated any
+ * more, their age is advanced to the time of the death @param t, and they are no longer dormant (i.e. their age stays).
+ */
+void Organ::freezeChildren(double t)
+{
+    for (auto& c : children) {
+        if (!c->isFinished()) { // finished organs stay
+            if (c->dormant) {
+                c->journal();
+                if (c->visited<=plant->getSimTime()) { // not simulated in this time step
+                    c->age += t-c->visited;
+                }
+                c->dormant = false;
+            }
+            c->freezeChildren(t);
+        }
+    }
 }
 
 /**
@@ -176,15 +600,50 @@ void Organ::addNode(Vector3d n, double t)
  */
 std::vector<Vector2i> Organ::getSegments() const
 {
-    if (this->nodes.size()>1) {
-        std::vector<Vector2i> segs = std::vector<Vector2i>(nodes.size()-1);
-        for (size_t i=0; i<nodes.size()-1; i++) {
-            Vector2i s(getNodeId(i),getNodeId(i+1));
-            segs[i] = s;
+    std::vector<Vector2i> segs;
+    segs.reserve(std::max(getNumberOfNodes()-1, 0));
+    getSegments(segs);
+    return segs;
+}
+
+/**
+ * Appends the segments of the organ to a buffer, e.g. to collect the segments of many organs without
+ * temporary vectors (@see Organism::getSegments)
+ *
+ * @param segs      the segments are appended, each consisting of two global node indices
+ */
+void Organ::getSegments(std::vector<Vector2i>& segs) const
+{
+    for (size_t i=1; i<nodeIds.size(); i++) {
+        segs.push_back(Vector2i(getNodeId(i-1), getNodeId(i)));
+    }
+}
+
+/**
+ * Replaces the provisional ids, that were handed out during a parallel simulation step
+ * (see Organism::simulateParallel), by final ids. Provisional ids are negative and start at -2,
+ * the k-th provisional id (-2-k) becomes offset+k. Must be called directly after Organ::simulate.
+ *
+ * @param organOffset   first final organ id of this subtree
+ * @param nodeOffset    first final node id of this subtree
+ */
+void Organ::resolveIds(int organOffset, int nodeOffset)
+{
+    size_t i0 = oldNumberOfNodes; // nodes of the previous time steps have final ids
+    if (id<-1) { // organ was created in this time step
+        id = organOffset-id-2;
+        i0 = 0;
+    }
+    for (size_t i=i0; i<nodeIds.size(); i++) {
+        if (nodeIds[i]<-1) {
+            nodeIds.set(i, nodeOffset-nodeIds[i]-2);
+        }
+    }
+    flushNodes();
+    for (auto& c : children) {
+        if (!c->isFinished()) { // finished organs have final ids
+            c->resolveIds(organOffset, nodeOffset);
         }
-        return segs;
-    } else {
-        return std::vector<Vector2i>(0);
     }
 }
 
@@ -212,7 +671,7 @@ std::vector<Organ*> Organ::getOrgans(int ot)
  */
 void Organ::getOrgans(int ot, std::vector<Organ*>& v)
 {
-    if (this->nodes.size()>1) {
+    if (this->getNumberOfNodes()>1) {
         if ((ot<0) || (ot==this->organType())) {
             v.push_back(this);
         }
@@ -223,20 +682,23 @@ void Organ::getOrgans(int ot, std::vector<Organ*>& v)
 }
 
 /**
- * Returns a single scalar parameter called @param name of the organ.
- * This method is for post processing, since it is flexible but slow.
- * Overwrite to add more parameters for specific organs.
+ * Returns a single scalar parameter of the organ, the parameter is given by its interned id (@see Organ::parameterId).
+ * This method is for post processing. Overwrite to add more parameters for specific organs.
+ * The name based version Organ::getParameter(std::string) interns the name on each call,
+ * for many organs use Organ::getParameters.
  *
  * For OrganTypeParametrs: add "_dev" to obtain the parameter's deviation (usually standard deviation),
  * optionally, add "_mean" to obtain the mean value (to avoid naming conflicts with the specific parameters).
  *
+ * @param id        interned parameter id
  * @return The parameter value, if unknown NaN
  */
-double Organ::getParameter(std::string name) const {
-    if (name=="length") { return getLength(); }
-    if (name=="age") { return getAge(); }
-    if (name=="creationTime") { return getNodeCT(0); }
-    if (name=="order") { // count how often it is possible to move up
+double Organ::getParameter(int id) const {
+    switch (id) {
+    case pi_length: return getLength();
+    case pi_age: return getAge();
+    case pi_creationTime: return getNodeCT(0);
+    case pi_order: { // count how often it is possible to move up
         int r = 0;
         const Organ* p = this;
         while (p->parent != nullptr) {
@@ -245,88 +707,243 @@ double Organ::getParameter(std::string name) const {
         }
         return r;
     }
-    if (name=="one") { return 1; } // e.g. for counting the organs
-    if (name=="id") { return getId(); }
-    if (name=="organType") { return this->organType(); }
-    if (name=="subType") { return this->param_->subType; }
-    if (name=="alive") { return isAlive(); }
-    if (name=="active") { return isActive(); }
-    if (name=="nubmerOfChildren") { return children.size(); }
+    case pi_one: return 1; // e.g. for counting the organs
+    case pi_id: return getId();
+    case pi_organType: return this->organType();
+    case pi_subType: return this->param_->subType;
+    case pi_alive: return isAlive();
+    case pi_active: return isActive();
+    case pi_numberOfChildren: return children.size();
     // numberOfNodes
     // numberOfSegments
-    return this->getOrganRandomParameter()->getParameter(name); // ask the type parameter
+    default: return this->getOrganRandomParameter()->getParameter(parameterName(id)); // ask the type parameter
+    }
+}
+
+/**
+ * Fills a column with a parameter of each organ. The list is grouped by organ (e.g. the segment owners of
+ * SegmentAnalyser), each organ is evaluated only once, and its value is copied to all its entries.
+ * Empty entries (nullptr) obtain 0.
+ *
+ * The organs are evaluated in parallel, Organ::getParameter must be thread safe for different organs
+ * (true for the organs of this library, if the organism is not modified meanwhile).
+ *
+ * @param id        interned parameter id (@see Organ::parameterId)
+ * @param organs    list of organs
+ * @param threads   number of threads evaluating the organs, 0 for sequential (default)
+ * @return the parameter value per organ
+ */
+std::vector<double> Organ::getParameters(int id, const std::vector<Organ*>& organs, int threads)
+{
+    std::vector<const Organ*> unique; // organs in the order of their first entry
+    std::vector<int> group(organs.size(), -1); // index into unique per entry
+    std::unordered_map<const Organ*, int> groups;
+    const Organ* last = nullptr;
+    int g = -1;
+    for (size_t i=0; i<organs.size(); i++) {
+        if (organs[i]!=last) { // consecutive entries mostly belong to the same organ
+            last = organs[i];
+            if (last==nullptr) {
+                g = -1;
+            } else {
+                auto it = groups.find(last);
+                if (it==groups.end()) {
+                    g = unique.size();
+                    groups[last] = g;
+                    unique.push_back(last);
+                } else {
+                    g = it->second;
+                }
+            }
+        }
+        group[i] = g;
+    }
+    std::vector<double> values(unique.size());
+    parallelFor(unique.size(), threads, [&](int j) {
+        values[j] = unique[j]->getParameter(id);
+    });
+    std::vector<double> data(organs.size(), 0.);
+    for (size_t i=0; i<organs.size(); i++) {
+        if (group[i]>=0) {
+            data[i] = values[group[i]];
+        }
+    }
+    return data;
+}
+
+/**
+ * Attribute in float precision (float output is much nicer)
+ */
+static void pushFloatAttribute(tinyxml2::XMLPrinter& printer, const char* name, double v)
+{
+    char buffer[200];
+    tinyxml2::XMLUtil::ToStr(float(v), buffer, 200);
+    printer.PushAttribute(name, buffer);
 }
 
 /**
  * Writes the organs RSML root tag, if it has more than one node.
+ * The tag is streamed into the printer, no document is built.
  *
- * Called by Organism::getRSMLScene, not exposed to Python
+ * Called by Organism::writeRSMLScene, not exposed to Python
  *
- * @param doc          the xml document (supplies factory functions)
- * @param parent       the parent xml element, where the organ's tag is added
+ * @param printer      the xml printer (e.g. writing to a file)
  */
-void Organ::writeRSML(tinyxml2::XMLDocument& doc, tinyxml2::XMLElement* parent) const
+void Organ::writeRSML(tinyxml2::XMLPrinter& printer) const
 {
-    if (this->nodes.size()>1) {
+    if (this->getNumberOfNodes()>1) {
         int nn = plant->getRSMLSkip()+1;
         // organ
         // std::string name = getOrganTypeParameter()->name; // todo where to put it
-        tinyxml2::XMLElement* organ = doc.NewElement("root"); // TODO use ot to fetch tag name?
-        organ->SetAttribute("ID", id);
+        printer.OpenElement("root"); // TODO use ot to fetch tag name?
+        printer.PushAttribute("ID", id);
         // geometry
-        tinyxml2::XMLElement* geometry = doc.NewElement("geometry");
-        organ->InsertEndChild(geometry);
-        tinyxml2::XMLElement* polyline = doc.NewElement("polyline");
+        printer.OpenElement("geometry");
+        printer.OpenElement("polyline");
         int o = (this->parent!=nullptr); // baseRoot = 0, others = 1
         for (int i = o; i<getNumberOfNodes(); i+=nn) {
-            auto n = getNode(i);
-            tinyxml2::XMLElement* p = doc.NewElement("point");
-            p->SetAttribute("x", float(n.x));
-            p->SetAttribute("y", float(n.y));
-            p->SetAttribute("z", float(n.z));
-            polyline->InsertEndChild(p);
+            Vector3d n = getNode(i);
+            printer.OpenElement("point");
+            pushFloatAttribute(printer, "x", n.x);
+            pushFloatAttribute(printer, "y", n.y);
+            pushFloatAttribute(printer, "z", n.z);
+            printer.CloseElement();
         }
-        geometry->InsertEndChild(polyline);
+        printer.CloseElement(); // polyline
+        printer.CloseElement(); // geometry
         // properties
-        tinyxml2::XMLElement* properties = doc.NewElement("properties");
-        auto prop_names = plant->getRSMLProperties();
-        for (const auto& pname : prop_names) {
-            tinyxml2::XMLElement* p = doc.NewElement(pname.c_str());
-            p->SetAttribute("value", float(this->getParameter(pname)));
-            properties->InsertEndChild(p);
+        printer.OpenElement("properties");
+        for (const auto& pname : plant->getRSMLProperties()) {
+            printer.OpenElement(pname.c_str());
+            pushFloatAttribute(printer, "value", this->getParameter(pname));
+            printer.CloseElement();
         }
-        organ->InsertEndChild(properties);
+        printer.CloseElement(); // properties
         /* laterals roots */
         for (size_t i = 0; i<children.size(); i+=nn) {
-            children[i]->writeRSML(doc, organ);
+            children[i]->writeRSML(printer);
         }
         // functions
-        tinyxml2::XMLElement* fcts = doc.NewElement("functions");
-        tinyxml2::XMLElement* fun1 = doc.NewElement("function");
-        fun1->SetAttribute("domain","polyline");
-        fun1->SetAttribute("name","node_creation_time");
+        printer.OpenElement("functions");
+        printer.OpenElement("function");
+        printer.PushAttribute("domain","polyline");
+        printer.PushAttribute("name","node_creation_time");
         for (int i = o; i<getNumberOfNodes(); i+=nn) {
-            double ct = getNodeCT(i);
-            tinyxml2::XMLElement* p = doc.NewElement("sample");
-            p->SetAttribute("value", ct);
-            fun1->InsertEndChild(p);
+            printer.OpenElement("sample");
+            printer.PushAttribute("value", getNodeCT(i));
+            printer.CloseElement();
         }
-        tinyxml2::XMLElement* fun2 = doc.NewElement("function");
-        fun2->SetAttribute("domain","polyline");
-        fun2->SetAttribute("name","node_index");
+        printer.CloseElement(); // function
+        printer.OpenElement("function");
+        printer.PushAttribute("domain","polyline");
+        printer.PushAttribute("name","node_index");
         for (int i = o; i<getNumberOfNodes(); i+=nn) {
-            int nid = getNodeId(i);
-            tinyxml2::XMLElement* p = doc.NewElement("sample");
-            p->SetAttribute("value", nid);
-            fun2->InsertEndChild(p);
+            printer.OpenElement("sample");
+            printer.PushAttribute("value", nodeIds[i]);
+            printer.CloseElement();
         }
-        fcts->InsertEndChild(fun1);
-        fcts->InsertEndChild(fun2);
-        organ->InsertEndChild(fcts);
-        parent->InsertEndChild(organ);
+        printer.CloseElement(); // function
+        printer.CloseElement(); // functions
+        printer.CloseElement(); // root
     }
 }
 
+/**
+ * Writes the state of the organ: id, specific parameters, development, and node data.
+ * The children are written by Organism::save.
+ *
+ * @param w         the binary writer
+ */
+void Organ::writeBinary(BinaryWriter& w) const
+{
+    w.write(id);
+    writeParameter(w);
+    w.write(alive);
+    w.write(active);
+    w.write(getAge()); // dormant organs are restored awake
+    w.write(length);
+    std::vector<Vector3d> n;
+    std::vector<double> t;
+    getNodes(n);
+    getNodeCTs(t);
+    w.write(n);
+    w.write(nodeIds.get());
+    w.write(t);
+    w.write(moved);
+    w.write(oldNumberOfNodes);
+    w.write(stream.key);
+    w.write(stream.draws);
+}
+
+/**
+ * Reads the state written by Organ::writeBinary, the specific parameters are allocated from the pool of the plant
+ *
+ * @param r         the binary reader
+ */
+void Organ::readBinary(BinaryReader& r)
+{
+    id = r.read<int>();
+    if (param_!=nullptr) {
+        param_->release();
+    }
+    param_ = nullptr;
+    param_ = readParameter(r);
+    param_->retain();
+    alive = r.read<bool>();
+    active = r.read<bool>();
+    age = r.read<double>();
+    dormant = false;
+    length = r.read<double>();
+    std::vector<Vector3d> n = r.readVector3ds();
+    nodeIds = r.readVector<int>();
+    std::vector<double> t = r.readVector<double>();
+    moved = r.read<bool>();
+    oldNumberOfNodes = r.read<int>();
+    stream.key = r.read<uint64_t>();
+    stream.draws = r.read<uint64_t>();
+    if ((nodeIds.size()!=n.size()) || (t.size()!=n.size())) {
+        std::cout << "Organ::readBinary: organ " << id << " has " << n.size() << " nodes, but " << nodeIds.size()
+            << " node indices, and " << t.size() << " creation times \n" << std::flush;
+        throw std::invalid_argument("Organ::readBinary: inconsistent node data");
+    }
+    pending = nullptr;
+    if (n.size()>0) {
+        firstNodeCT = t[0];
+    }
+    tipNodes = nullptr;
+    if (alive && active && plant->getNodeStore().isRounded()) { // see Organ::holdTipNodes
+        tipNodes = std::make_shared<TipNodes>();
+        for (size_t i = (n.size()>2) ? n.size()-2 : 0; i<n.size(); i++) { // the last two nodes
+            tipNodes->nodes[i+2-n.size()] = n[i];
+            tipNodes->cts[i+2-n.size()] = t[i];
+        }
+    }
+    NodeStore& store = plant->getNodeStore(); // the parent is not set yet, a shared first node is written by its first organ
+    for (size_t i=0; i<n.size(); i++) {
+        if ((i>0) || (nodeIds[0]>=store.size()) || (store.getOrgan(nodeIds[0])==nullptr)) {
+            store.set(nodeIds[i], n[i], t[i], this, (i>0) ? nodeIds[i-1] : -1);
+        }
+    }
+}
+
+/**
+ * Writes the specific parameters of the organ, overwrite for each organ class
+ */
+void Organ::writeParameter(BinaryWriter& w) const
+{
+    w.write(param_->subType);
+}
+
+/**
+ * @return the specific parameters written by Organ::writeParameter
+ */
+const OrganSpecificParameter* Organ::readParameter(BinaryReader& r)
+{
+    auto p = new (plant) OrganSpecificParameter();
+    p->subType = r.read<int>();
+    return p;
+}
+
 /**
  * @return Quick info about the object for debugging
  */
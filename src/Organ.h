@@ -3,16 +3,43 @@
 #define ORGAN_H_
 
 #include "mymath.h"
+#include "sharedvector.h"
+#include "philox.h"
 
 #include "../external/tinyxml2/tinyxml2.h"
 
 #include <vector>
+#include <string>
+#include <memory>
 
 namespace CRootBox {
 
 class OrganSpecificParameter;
 class OrganRandomParameter;
 class Organism;
+class BinaryWriter;
+class BinaryReader;
+
+/**
+ * The last two nodes of a growing organ in full precision, if the node store of the plant is rounded (see NodeStore::setPrecision),
+ * so that the growth is not affected by the storage precision
+ */
+struct TipNodes
+{
+    Vector3d nodes[2]; ///< the second last node, and the last node [cm]
+    double cts[2] = { 0., 0. }; ///< node creation times [day]
+};
+
+/**
+ * Nodes of an organ, that are not written into the node store of the plant yet (see Organ::storeNode),
+ * e.g. the nodes of a parallel simulation step, or the nodes of an organ without plant
+ */
+struct PendingNodes
+{
+    int first = 0; ///< local index of the first pending node
+    std::vector<Vector3d> nodes; ///< nodes from the local index PendingNodes::first on [cm]
+    std::vector<double> cts; ///< node creation times [day]
+};
 
 /**
  * Organ
@@ -31,11 +58,28 @@ class Organ
 {
 public:
 
+    /* parameter ids, interned names of the organ parameters (@see Organ::parameterId) */
+    enum ParameterIds {
+        pi_length = 0, pi_age, pi_creationTime, pi_order, pi_one, pi_id, pi_organType, pi_subType, pi_alive, pi_active,
+        pi_numberOfChildren, // Organ
+        pi_lb, pi_la, pi_nob, pi_r, pi_radius, pi_a, pi_theta, pi_rlt, pi_k, pi_lnMean, pi_lnDev, pi_volume, pi_surface,
+        pi_type, pi_iHeadingX, pi_iHeadingY, pi_iHeadingZ, pi_parentBaseLength, pi_parentNI, // Root
+        pi_numberOfIds // first id of names interned at run time (i.e. type parameters)
+    };
+    static int parameterId(std::string name); ///< interned id of a parameter name, unknown names obtain new ids
+    static std::string parameterName(int id); ///< parameter name of an interned id
+
     Organ(int id, const OrganSpecificParameter* param, bool alive, bool active, double age, double length,
         bool moved= false, int oldNON = 0); ///< creates everything from scratch
     Organ(Organism* plant, Organ* parent, int organtype, int subtype, double delay); ///< used within simulation
     virtual ~Organ();
 
+    /* allocation from the memory pool of the plant (@see MemoryPool) */
+    static void* operator new(size_t size, Organism* plant); ///< allocates from the pool of the plant, use new (plant) Root(...)
+    static void* operator new(size_t size); ///< allocates on the heap
+    static void operator delete(void* p); ///< returns the memory to its pool, or to the heap
+    static void operator delete(void* p, Organism* plant); ///< called if the constructor throws
+
     virtual Organ* copy(Organism* plant); ///< deep copies the organ tree
 
     virtual int organType() const; ///< returns the organs type, overwrite for each organ
@@ -47,26 +91,43 @@ public:
     void setParent(Organ* p) { parent = p; } ///< sets parent organ
     Organ* getParent() const { return parent; } ///< return parent organ, equals nullptr if it has no parent
     void setOrganism(Organism* p) { plant = p; } ///< sets the organism of which the organ is part of
+    Organism* getOrganism() const { return plant; } ///< the organism of which the organ is part of
     void addChild(Organ* c); ///< adds an subsequent organ
+    int getNumberOfChildren() const { return children.size(); } ///< number of successive organs
+    Organ* getChild(int i) const { return children.at(i); } ///< i-th successive organ
 
     /* parameters */
     int getId() const { return id; } ///< unique organ id
-    const OrganSpecificParameter* getParam() const { return param_; } ///< organ parameters
-    OrganRandomParameter* getOrganRandomParameter() const;  ///< organ type parameter
+    const OrganSpecificParameter* getParam() const { return param_; } ///< organ parameters, shared with the copies of the organ
+    OrganRandomParameter* getOrganRandomParameter() const;  ///< organ type parameter, shared with the copies of the plant (read only)
     bool isAlive() const { return alive; } ///< checks if alive
     bool isActive() const { return active; } ///< checks if active
-    double getAge() const { return age; } ///< return age of the organ
+    bool isFinished() const { return finished; } ///< the organ and its children can no longer change, and are skipped by the simulation
+    bool isDormant() const { return dormant; } ///< the organ and its children do not change until an emergence or a death, and are skipped by the simulation
+    bool isSleeping() const; ///< the organ is dormant during the current time step, i.e. it is not simulated
+    double getWakeTime() const { return wakeTime; } ///< simulation time, at which a dormant organ or one of its children emerges or dies
+    double getAge() const; ///< return age of the organ (advanced lazily, while the organ is dormant)
     double getLength() const { return length; } ///< returns length of the organ
 
     /* geometry */
-    int getNumberOfNodes() const { return nodes.size(); } ///< number of nodes of the organ
-    int getNumberOfSegments() { return nodes.size()-1; } ///<  per default, the organ is represented by a polyline, i.e. getNumberOfNodes()-1
-    Vector3d getNode(int i) const { return nodes.at(i); } ///< i-th node of the organ
+    int getNumberOfNodes() const { return nodeIds.size(); } ///< number of nodes of the organ
+    int getNumberOfSegments() { return getNumberOfNodes()-1; } ///<  per default, the organ is represented by a polyline, i.e. getNumberOfNodes()-1
+    Vector3d getNode(int i) const; ///< i-th node of the organ
     int getNodeId(int i) const { return nodeIds.at(i); } ///< global node index of the i-th node, i is called the local node index
-    double getNodeCT(int i) const { return nodeCTs.at(i); } ///< creation time of the i-th node
+    double getNodeCT(int i) const; ///< creation time of the i-th node
+    std::vector<Vector3d> getNodes() const; ///< all nodes of the organ
+    void getNodes(std::vector<Vector3d>& n) const; ///< all nodes of the organ, into a reused buffer
+    void getNodeCTs(std::vector<double>& cts) const; ///< all node creation times of the organ, into a reused buffer
+    size_t getNodeMemory() const; ///< memory of the node data held by the organ, without the node store [bytes]
     void addNode(Vector3d n, double t); //< adds a node to the root
     void addNode(Vector3d n, int id, double t); //< adds a node to the root
     std::vector<Vector2i> getSegments() const; ///< per default, the organ is represented by a polyline
+    void getSegments(std::vector<Vector2i>& segs) const; ///< appends the segments of the polyline to a buffer
+    void resolveIds(int organOffset, int nodeOffset); ///< replaces provisional ids of a parallel simulation step (see Organism::simulate)
+    void storeNodes(); ///< writes the nodes of the organ and its children into the organism's node store
+    void holdTipNodes(bool rounded); ///< growing organs hold their last two nodes, if the node store is rounded (see Organism::setStoragePrecision)
+    void journal(); ///< saves the state of the organ, before it is changed (see Organism::journal)
+    void freezeChildren(double t); ///< the dormant organs of the subtree develop until time t, and are no longer dormant (see Root::simulate)
 
     /* last time step */
     bool hasMoved() { return moved; }; ///< have any nodes moved during the last simulate call
@@ -75,38 +136,61 @@ public:
     /* for post processing */
     std::vector<Organ*> getOrgans(int ot=-1); ///< the organ including children in a sequential vector
     void getOrgans(int otype, std::vector<Organ*>& v); ///< the organ including children in a sequential vector
-    virtual double getParameter(std::string name) const; ///< returns an organ parameter
+    double getParameter(std::string name) const { return getParameter(parameterId(name)); } ///< returns an organ parameter
+    virtual double getParameter(int id) const; ///< returns an organ parameter by its interned id
+    static std::vector<double> getParameters(int id, const std::vector<Organ*>& organs, int threads = 0); ///< parameter value per organ of a list
 
     /* IO */
     virtual std::string toString() const; ///< info for debugging
-    virtual void writeRSML(tinyxml2::XMLDocument& doc, tinyxml2::XMLElement* parent) const; ///< writes this organs RSML tag
+    virtual void writeRSML(tinyxml2::XMLPrinter& printer) const; ///< writes this organs RSML tag
+    virtual void writeBinary(BinaryWriter& w) const; ///< writes the state of this organ, without children (see Organism::save)
+    virtual void readBinary(BinaryReader& r); ///< reads the state written by Organ::writeBinary, the organism must be set
 
 protected:
 
+    void storeNode(int i); ///< writes the i-th node into the organism's node store
+    void storeNode(int i, const Vector3d& n, double t); ///< writes the i-th node with given coordinates and creation time
+    void setNode(int i, const Vector3d& n, double t); ///< moves the i-th node, e.g. the tip
+    void flushNodes(); ///< writes the pending nodes into the node store (see Organ::storeNode)
+    const OrganSpecificParameter* realize(int ot, int st); ///< draws the specific parameters, from the stream of the organ
+
+    virtual void writeParameter(BinaryWriter& w) const; ///< writes the specific parameters (see Organ::writeBinary)
+    virtual const OrganSpecificParameter* readParameter(BinaryReader& r); ///< reads the specific parameters, allocated from the pool of the plant
+
     /* up and down the organ tree */
     Organism* plant; ///< the plant of which this organ is part of
     Organ* parent; ///< pointer to the parent organ (nullptr if it has no parent)
     std::vector<Organ*> children; ///< the successive organs
 
     /* Parameters that are constant over the organ life time */
-    const int id; ///< unique organ id
-    const OrganSpecificParameter* param_; ///< the parameter set of this organ
+    int id; ///< unique organ id (provisional during a parallel simulation step, see Organ::resolveIds)
+    OrganStream stream; ///< random numbers of the organ, if the organism uses organ streams (see Organism::setOrganStreams)
+    const OrganSpecificParameter* param_; ///< the parameter set of this organ, a reference is held (@see OrganSpecificParameter::retain)
+    mutable OrganRandomParameter* randomParam = nullptr; ///< cached organ type parameter (see Organ::getOrganRandomParameter)
+    mutable uint64_t randomParamVersion = 0; ///< Organism::getParameterVersion of Organ::randomParam
 
     /* Parameters are changing over time */
     bool alive = true; ///< true: alive, false: dead
     bool active = true; ///< true: active, false: organ stopped growing
     double age = 0; ///< current age [days]
     double length = 0; ///< length of the organ [cm]
+    bool finished = false; ///< see Organ::isFinished, set by Organ::simulate
+    bool dormant = false; ///< see Organ::isDormant, set by Root::simulate
+    double wakeTime = 0.; ///< see Organ::getWakeTime
+    double visited = 0.; ///< end of the time step of the last simulate call, the age of a dormant organ is advanced from there
 
     /* node data */
-    std::vector<Vector3d> nodes; ///< nodes of the organ [cm]
-    std::vector<int> nodeIds; ///< global node indices
-    std::vector<double> nodeCTs; ///< node creation times [days]
+    SharedVector<int> nodeIds; ///< global node indices, the coordinates are held by the node store of the plant (@see Organism::getNodeStore)
+    double firstNodeCT = 0.; ///< creation time of the first node (for laterals the store holds the creation time of the parent node)
+    std::shared_ptr<TipNodes> tipNodes; ///< the last two nodes in full precision, held by growing organs if the node store is rounded
+    std::shared_ptr<PendingNodes> pending; ///< the nodes from a local index on, that are not written into the node store yet
 
     /* last time step */
     bool moved = false; ///< nodes moved during last time step
     int oldNumberOfNodes = 0; ///< number of nodes at the end of previous time step
 
+    int journaled = 0; ///< checkpoint, for which the state of the organ was saved last (see Organ::journal)
+
 };
 
 } // namespace CRootBox
@@ -5,15 +5,24 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
 #include <ctime>
 #include <numeric>
+#include <algorithm>
 
 #include "organparameter.h"
+#include "parallel.h"
+#include "binaryio.h"
 
 namespace CRootBox {
 
 std::vector<std::string> Organism::organTypeNames = { "organ", "seed", "root", "stem", "leaf" };
 
+thread_local SubtreeStream* Organism::stream = nullptr;
+thread_local OrganStream* Organism::organStream = nullptr;
+std::atomic<int> Organism::checkpoints(0);
+std::atomic<uint64_t> Organism::parameterVersions(0);
+
 /**
  * @return the organ type number of an organ type name @param name
  */
@@ -47,76 +56,162 @@ std::string Organism::organTypeName(int ot)
 
 /**
  * Copy constructor
+ *
+ * The organs are deep copied, but they share their specific parameters with the original organs (@see Organ::copy).
+ * The organ random parameters are shared, until either organism modifies them (@see Organism::getOrganRandomParameter).
+ * The copy keeps the parameter version, since its parameter table holds the same pointers.
+ * Copying an organism is thus cheap compared to simulating its organs.
  */
-Organism::Organism(const Organism& o): organParam(o.organParam), simtime(o.simtime),
-    organId(o.organId), nodeId(o.nodeId), gen(o.gen), UD(o.UD), ND(o.ND)
+Organism::Organism(const Organism& o): organParam(o.organParam), parameterTable(o.parameterTable),
+    parameterVersion(o.parameterVersion), simtime(o.simtime), stepEnd(o.stepEnd),
+    organId(o.organId), nodeId(o.nodeId),
+    seed(o.seed), gen(o.gen), UD(o.UD), ND(o.ND),
+    numberOfThreads(o.numberOfThreads), instrumentation(o.instrumentation), streams(o.streams), organStreams(o.organStreams)
 {
     // std::cout << "Copying organism with "<<o.baseOrgans.size()<< " base organs \n";
     baseOrgans.resize(o.baseOrgans.size());  // copy base organs
     for (int i=0; i<baseOrgans.size(); i++) {
         baseOrgans[i] = o.baseOrgans[i]->copy(this);
     }
-    for (int ot = 0; ot < numberOfOrganTypes; ot++) { // copy organ type parameters
-        for (auto& otp : organParam[ot]) {
-            otp.second = otp.second->copy(this);
-        }
+    nodeStore.assignGeometry(o.nodeStore); // the organs hold no coordinates, the copies own the copied nodes
+    for (auto& bo : baseOrgans) {
+        bo->storeNodes();
     }
 }
 
 /*
- * Destructor: deletes all base organs, and organ type parameters
+ * Destructor: deletes all base organs, the organ type parameters are deleted with their last organism
  */
 Organism::~Organism()
 {
-    for(auto o :baseOrgans) { // delete base organs
-        delete o;
+    {
+        MemoryPool::BulkRelease bulk(pool);
+        for(auto o :baseOrgans) { // delete base organs
+            delete o;
+        }
     }
-    for (int ot = 0; ot < numberOfOrganTypes; ot++) {  // delete organ type parameters
-        for (auto& otp : organParam[ot]) {
-            delete otp.second;
+    MemoryPool::destroy(pool); // shared parameters of the organs may still live in copies
+}
+
+/**
+ * Deletes the base organs and their children, the pool is destroyed afterwards, which releases its chunks at once
+ * (unless shared parameters of the organs live in copies), and new organs are allocated from a new pool
+ */
+void Organism::deleteOrgans()
+{
+    {
+        MemoryPool::BulkRelease bulk(pool);
+        for (auto o : baseOrgans) {
+            delete o;
         }
     }
+    baseOrgans.clear();
+    MemoryPool::destroy(pool);
+    pool = new MemoryPool();
+}
+
+/**
+ * Copies the organ type parameters of a specific organ type into a vector, for modification.
+ * Parameters that are shared with a copy of the organism are copied first (copy on write).
+ *
+ * @param ot    the organ type
+ */
+std::vector<OrganRandomParameter*> Organism::getOrganRandomParameter(int ot)
+{
+    std::vector<OrganRandomParameter*>  otps = std::vector<OrganRandomParameter*>(0);
+    for (auto& otp : organParam[ot]) {
+        otps.push_back(unshare(otp.second));
+    }
+    return otps;
 }
 
 /**
- * Copies the organ type parameters of a specific organ type into a vector
+ * Returns an organ type parameter of a specific organ type and sub type, for modification.
+ * If the parameter is shared with a copy of the organism, it is copied first (copy on write),
+ * since any modification must only affect this organism.
+ *
+ * @param ot       the organ type (e.g. ot_root)
+ * @param subType  the sub type (e.g. root type)
+ * @return         the respective type parameter
+ */
+OrganRandomParameter* Organism::getOrganRandomParameter(int ot, int subtype)
+{
+    getSharedOrganRandomParameter(ot, subtype); // throws, if it was not set
+    return unshare(organParam[ot][subtype]);
+}
+
+/**
+ * Copies the organ type parameters of a specific organ type into a vector, the parameters must not be modified
  *
  * @param ot    the organ type
  */
-std::vector<OrganRandomParameter*> Organism::getOrganRandomParameter(int ot) const
+std::vector<OrganRandomParameter*> Organism::getSharedOrganRandomParameter(int ot) const
 {
     std::vector<OrganRandomParameter*>  otps = std::vector<OrganRandomParameter*>(0);
     for (auto& otp : organParam[ot]) {
-        otps.push_back(otp.second);
+        otps.push_back(otp.second.get());
     }
     return otps;
 }
 
 /**
- * Returns an organ type parameter of a specific organ type and sub type
+ * Returns an organ type parameter of a specific organ type and sub type, that must not be modified,
+ * since it may be shared with copies of the organism. Used by the organs during simulation.
  *
  * @param ot       the organ type (e.g. ot_root)
  * @param subType  the sub type (e.g. root type)
  * @return         the respective type parameter
  */
-OrganRandomParameter* Organism::getOrganRandomParameter(int ot, int subtype) const
+OrganRandomParameter* Organism::getSharedOrganRandomParameter(int ot, int subtype) const
 {
+    const auto& table = parameterTable[ot];
+    if ((subtype>=0) && (subtype<(int)table.size()) && (table[subtype]!=nullptr)) {
+        return table[subtype];
+    }
     try {
-        //                std::cout << "reading organ type " << ot << " sub type " << subtype <<": ";
-        //                for (auto& p : organParam[ot]) {
-        //                    std::cout << p.first;
-        //                }
-        //                std::cout << "\n" << std::flush;
-        return organParam[ot].at(subtype);
+        return organParam[ot].at(subtype).get();
     } catch(const std::out_of_range& oor) {
         std::cout << "Organism::getOrganTypeParameter: Organ type parameter of sub type " << subtype << " was not set \n" << std::flush;
         throw;
     }
 }
 
+/**
+ * Copies the parameter set @param p into this organism, if it is shared with a copy of the organism
+ *
+ * @return the parameter set, that is only used by this organism
+ */
+OrganRandomParameter* Organism::unshare(std::shared_ptr<OrganRandomParameter>& p)
+{
+    if (p.use_count()>1) {
+        p = std::shared_ptr<OrganRandomParameter>(p->copy(this));
+        updateParameterTable(p->organType);
+    }
+    return p.get();
+}
+
+/**
+ * Rebuilds the flat table of the organ type parameters of organ type @param ot, after Organism::organParam has changed.
+ * The new version number invalidates the parameter pointers cached by the organs (see Organ::getOrganRandomParameter).
+ */
+void Organism::updateParameterTable(int ot)
+{
+    auto& table = parameterTable[ot];
+    table.clear();
+    for (auto& otp : organParam[ot]) {
+        if (otp.first>=0) { // negative sub types are only found by the map
+            if (otp.first>=(int)table.size()) {
+                table.resize(otp.first+1, nullptr);
+            }
+            table[otp.first] = otp.second.get();
+        }
+    }
+    parameterVersion = nextParameterVersion();
+}
+
 /**
  *  Sets the  type parameter, subType and organType defined within p
- *  Deletes the old parameter if there is one, takes ownership of the new one
+ *  Releases the old parameter if there is one (it is deleted, if no copy of the organism shares it), takes ownership of the new one
  *
  *  @param p    the organ type parameter
  */
@@ -125,15 +220,27 @@ void Organism::setOrganRandomParameter(OrganRandomParameter* p)
     assert(p->plant == this && "OrganTypeParameter::plant should be this organism");
     int otype = p->organType;
     int subtype = p->subType;
-    try {
-        delete organParam[otype][subtype];
-    } catch (std::exception& e) {
-        // did not exist, nothing to delete
+    auto& otp = organParam[otype][subtype];
+    if (otp.get()==p) { // already set
+        return;
     }
-    organParam[otype][subtype] = p;
+    otp = std::shared_ptr<OrganRandomParameter>(p); // the old parameter is deleted, if it is not shared
+    updateParameterTable(otype);
     // std::cout << "setting organ type " << otype << ", sub type " << subtype << ", name "<< p->name << "\n";
 }
 
+/**
+ * Adds a base organ, and its nodes to the node store
+ *
+ * @param o     the organ (ownership is passed)
+ */
+void Organism::addOrgan(Organ* o)
+{
+    baseOrgans.push_back(o);
+    o->storeNodes();
+    organTreeChanged();
+}
+
 /**
  * Overwrite if there is the need for additional initializations,
  * before simulation starts.
@@ -156,10 +263,76 @@ void Organism::simulate(double dt, bool verbose)
     }
     oldNumberOfNodes = getNumberOfNodes();
     oldNumberOfOrgans = getNumberOfOrgans();
-    for (const auto& r : baseOrgans) {
-        r->simulate(dt, verbose);
+    if (cacheValid) { // bring caches up to date, and keep the change log short
+        updateCaches();
+    }
+    nodeStore.clearChanges();
+    cacheChanges = 0;
+    stepEnd = simtime+dt;
+    if (numberOfThreads>0) {
+        simulateParallel(dt, verbose);
+    } else {
+        for (const auto& r : baseOrgans) {
+            if (r->isFinished()) { // dead subtrees are skipped
+                continue;
+            }
+            if (r->isSleeping()) { // dormant subtrees too
+                if (instrumentation.isEnabled()) {
+                    instrumentation.count(r->organType(), Instrumentation::c_skipped);
+                }
+                continue;
+            }
+            Instrumentation::Timer timer(instrumentation, r->organType(), Instrumentation::p_simulate);
+            r->simulate(dt, verbose);
+        }
     }
     simtime+=dt;
+    if (nodeStore.getPacking() && (getCheckpoint()==0)) { // a pop restores unpacked nodes
+        packNodes();
+    }
+}
+
+/**
+ * Simulates the base organs, and their subtrees, in parallel using Organism::numberOfThreads threads.
+ *
+ * Each base organ draws its random numbers from its own stream (seeded by the organism's seed and the
+ * base organ index). Ids created during the time step are provisional, and are replaced afterwards,
+ * in the order of the base organs, by the same ids a sequential simulation would have created.
+ * Therefore, the result only depends on the seed, and not on the number of threads.
+ *
+ * Callbacks (e.g. SoilLookUp, Tropism) must be thread safe, and can not be implemented in Python.
+ *
+ * @param dt        time step [day]
+ * @param verbose   turns console output on or off
+ */
+void Organism::simulateParallel(double dt, bool verbose)
+{
+    while (streams.size()<baseOrgans.size()) { // a stream for each new base organ
+        streams.push_back(SubtreeStream(seed, streams.size()));
+    }
+    parallelFor(baseOrgans.size(), numberOfThreads, [&](int i) {
+        streams[i].organs = 0;
+        streams[i].nodes = 0;
+        if (baseOrgans[i]->isFinished() || baseOrgans[i]->isSleeping()) {
+            return;
+        }
+        stream = &streams[i];
+        try {
+            Instrumentation::Timer timer(instrumentation, baseOrgans[i]->organType(), Instrumentation::p_simulate);
+            baseOrgans[i]->simulate(dt, verbose);
+        } catch (...) {
+            stream = nullptr;
+            throw;
+        }
+        stream = nullptr;
+    });
+    for (size_t i=0; i<baseOrgans.size(); i++) { // final ids, and store new nodes
+        if (!baseOrgans[i]->isFinished()) {
+            baseOrgans[i]->resolveIds(organId+1, nodeId+1);
+        }
+        organId += streams[i].organs;
+        nodeId += streams[i].nodes;
+    }
 }
 
 /**
@@ -172,13 +345,44 @@ void Organism::simulate(double dt, bool verbose)
 std::vector<Organ*> Organism::getOrgans(int ot) const
 {
     std::vector<Organ*> organs = std::vector<Organ*>(0);
-    organs.reserve(getNumberOfOrgans()); // just for speed up
-    for (const auto& o : this->baseOrgans) {
-        o->getOrgans(ot, organs);
-    }
+    organs.reserve(getOrganList().size()); // just for speed up
+    getOrgans(organs, ot);
     return organs;
 }
 
+/**
+ * All organs of the organ tree in depth first order (the order of Organism::getOrgans), including organs with
+ * less than two nodes. The list is kept until the tree changes, i.e. until new organs are created (they always take
+ * new organ ids), or organs are removed (e.g. RootSystem::pop). Queries between two time steps share a single list,
+ * only a time step creating organs causes a rebuild. The organ types are kept in a contiguous vector next to the list,
+ * so filtering by organ type does not touch the organs.
+ *
+ * @return the organs, valid until the organ tree changes
+ */
+const std::vector<Organ*>& Organism::getOrganList() const
+{
+    if ((organListTree!=treeVersion) || (organListIds!=organId)) {
+        organList.clear();
+        std::vector<Organ*> stack(baseOrgans.rbegin(), baseOrgans.rend());
+        while (!stack.empty()) { // depth first, children in their order
+            Organ* o = stack.back();
+            stack.pop_back();
+            organList.push_back(o);
+            for (int i=o->getNumberOfChildren()-1; i>=0; i--) {
+                stack.push_back(o->getChild(i));
+            }
+        }
+        organListTypes.resize(organList.size());
+        for (size_t i=0; i<organList.size(); i++) {
+            organListTypes[i] = organList[i]->organType();
+        }
+        organListTree = treeVersion;
+        organListIds = organId;
+        organListVersion++;
+    }
+    return organList;
+}
+
 /**
  * Returns a single scalar parameter for each organ as sequential list,
  * corresponding to the sequential organ list, see Organism::getOrgans.
@@ -195,11 +399,7 @@ std::vector<double> Organism::getParameter(std::string name, int ot, std::vector
     if (organs.empty()) {
         organs = getOrgans(ot);
     }
-    std::vector<double> p = std::vector<double>(organs.size());
-    for (int i=0; i<organs.size(); i++) {
-        p[i] = organs[i]->getParameter(name);
-    }
-    return p;
+    return Organ::getParameters(Organ::parameterId(name), organs);
 }
 
 /**
@@ -239,15 +439,8 @@ int Organism::getNumberOfSegments(int ot) const
  */
 std::vector<std::vector<Vector3d>> Organism::getPolylines(int ot) const
 {
-    auto organs = getOrgans(ot);
-    std::vector<std::vector<Vector3d>> nodes = std::vector<std::vector<Vector3d>>(organs.size());
-    for (size_t j=0; j<organs.size(); j++) {
-        std::vector<Vector3d>  n = std::vector<Vector3d>(organs[j]->getNumberOfNodes());
-        for (size_t i=0; i<organs[j]->getNumberOfNodes(); i++) { // loop over all nodes of all organs
-            n.at(i) = organs[j]->getNode(i);
-        }
-        nodes[j] = n;
-    }
+    std::vector<std::vector<Vector3d>> nodes;
+    getPolylines(nodes, ot);
     return nodes;
 }
 
@@ -262,15 +455,97 @@ std::vector<std::vector<double>> Organism::getPolylineCTs(int ot) const
     auto organs = getOrgans(ot);
     std::vector<std::vector<double>> nodes = std::vector<std::vector<double>>(organs.size());
     for (size_t j=0; j<organs.size(); j++) {
-        std::vector<double>  nct = std::vector<double>(organs[j]->getNumberOfNodes());
-        for (size_t i=0; i<organs[j]->getNumberOfNodes(); i++) { // loop over all nodes of all organs
-            nct.at(i) = organs[j]->getNodeCT(i);
-        }
-        nodes[j] = nct;
+        organs[j]->getNodeCTs(nodes[j]);
     }
     return nodes;
 }
 
+/**
+ * Sets the storage precision of the node geometry (@see NodeStore::setPrecision). The node store is the only copy of the
+ * coordinates, a reduced precision reduces the memory of the geometry (@see Organism::getNodeMemory). The organs grow in
+ * double precision, growing organs hold their last two nodes (@see Organ::holdTipNodes), all other geometry obtained from
+ * the organs and the organism (e.g. Organ::getNodes, Organism::getNodes, Organism::getSegmentCTs, SegmentAnalyser) is rounded.
+ *
+ * @param p             PackedColumn::p_double (default), PackedColumn::p_float, or PackedColumn::p_quantized
+ * @param resolution    step of quantized coordinates [cm]
+ * @param origin        origin of quantized coordinates, e.g. the seed position [cm]
+ */
+void Organism::setStoragePrecision(int p, double resolution, Vector3d origin)
+{
+    for (auto& bo : baseOrgans) { // growing organs keep their last nodes in full precision
+        bo->holdTipNodes(true);
+    }
+    nodeStore.setPrecision(p, resolution, origin);
+    for (auto& bo : baseOrgans) {
+        bo->holdTipNodes(nodeStore.isRounded());
+    }
+    cacheValid = false; // the caches hold the previous precision
+}
+
+/**
+ * Enables or disables the packing of the nodes that no longer change (@see NodeStore::setPacking). After each time step
+ * (and right away), blocks of nodes of organs that stopped growing are encoded as quantized deltas (@see Organism::packNodes),
+ * which reduces the memory of the geometry of large organisms (@see Organism::getNodeMemory) to a fraction.
+ * Like a reduced storage precision (@see Organism::setStoragePrecision), the growth is not affected, but all other geometry
+ * (e.g. Organism::getNodes, the incremental caches, and SegmentAnalyser) is rounded to the resolutions. Matrices updated
+ * incrementally (e.g. Doussan::update) keep the unrounded coordinates of their segments.
+ *
+ * @param pack              pack the nodes
+ * @param resolution        step of quantized coordinates [cm]
+ * @param timeResolution    step of quantized creation times [day]
+ */
+void Organism::setNodePacking(bool pack, double resolution, double timeResolution)
+{
+    for (auto& bo : baseOrgans) { // growing organs keep their last nodes in full precision
+        bo->holdTipNodes(true);
+    }
+    nodeStore.setPacking(pack, resolution, timeResolution);
+    for (auto& bo : baseOrgans) {
+        bo->holdTipNodes(nodeStore.isRounded());
+    }
+    cacheValid = false; // the caches hold the previous geometry
+    if (getCheckpoint()==0) {
+        packNodes();
+    }
+}
+
+/**
+ * Packs the nodes that no longer change (@see NodeStore::pack), i.e. all but the last two nodes of growing organs.
+ * Called after each time step if packing is enabled (@see Organism::setNodePacking), but not while a checkpoint is held,
+ * so that RootSystem::pop restores the nodes unpacked.
+ */
+void Organism::packNodes()
+{
+    if (!nodeStore.getPacking()) {
+        return;
+    }
+    std::vector<int> changing;
+    for (const auto o : getOrganList()) {
+        if (o->isAlive() && o->isActive()) {
+            for (int i = std::max(o->getNumberOfNodes()-2, 0); i<o->getNumberOfNodes(); i++) {
+                int id = o->getNodeId(i);
+                if ((id<nodeStore.size()) && (nodeStore.getOrgan(id)==o)) { // shared base nodes are written by the parent
+                    changing.push_back(id);
+                }
+            }
+        }
+    }
+    std::sort(changing.begin(), changing.end());
+    nodeStore.pack(changing);
+}
+
+/**
+ * @return the memory of the node data held by the organs, without the node store [bytes]
+ */
+size_t Organism::getOrganNodeMemory() const
+{
+    size_t m = 0;
+    for (auto o : getOrganList()) {
+        m += o->getNodeMemory();
+    }
+    return m;
+}
+
 /**
  * All nodes of emerged organs are ordered by their node index,
  * initial nodes of base organs are copied, even if not emerged.
@@ -279,16 +554,8 @@ std::vector<std::vector<double>> Organism::getPolylineCTs(int ot) const
  */
 std::vector<Vector3d> Organism::getNodes() const
 {
-    auto organs = getOrgans();
-    std::vector<Vector3d> nv = std::vector<Vector3d>(getNumberOfNodes()); // reserve big enough vector
-    for (const auto& o : baseOrgans) { // copy initial nodes (even if organs have not developed)
-        nv.at(o->getNodeId(0)) = o->getNode(0);
-    }
-    for (const auto& o : organs) { // copy all organ nodes
-        for (size_t i = 1; i<o->getNumberOfNodes(); i++) { // since all base nodes are stored twice as base and along root
-            nv.at(o->getNodeId(i)) = o->getNode(i);
-        }
-    }
+    std::vector<Vector3d> nv;
+    getNodes(nv);
     return nv;
 }
 
@@ -303,17 +570,8 @@ std::vector<Vector3d> Organism::getNodes() const
  */
 std::vector<double> Organism::getNodeCTs() const
 {
-    auto organs = getOrgans();
-    std::vector<double> cts = std::vector<double>(getNumberOfNodes()); // reserve big enough vector
-    for (const auto& o : baseOrgans) { // copy initial nodes (even if organs have not developed)
-        cts.at(o->getNodeId(0)) = o->getNodeCT(0);
-    }
-    for (const auto& o : organs) { // copy all organ creation times
-        for (size_t i=1; i<o->getNumberOfNodes(); i++) {
-            // we start at 1 because we don't copy the emergence time of the lateral root
-            cts.at(o->getNodeId(i)) = o->getNodeCT(i);
-        }
-    }
+    std::vector<double> cts;
+    getNodeCTs(cts);
     return cts;
 }
 
@@ -327,13 +585,9 @@ std::vector<double> Organism::getNodeCTs() const
  */
 std::vector<Vector2i> Organism::getSegments(int ot) const
 {
-    auto organs = getOrgans(ot);
     std::vector<Vector2i> segs = std::vector<Vector2i>(0);
     segs.reserve(this->getNumberOfSegments(ot)); // for speed up
-    for (const auto& o : organs) {
-        auto s = o->getSegments();
-        segs.insert(segs.end(), s.begin(), s.end()); // append s; todo check if it works..
-    }
+    getSegments(segs, ot);
     return segs;
 }
 
@@ -346,12 +600,9 @@ std::vector<Vector2i> Organism::getSegments(int ot) const
  */
 std::vector<double> Organism::getSegmentCTs(int ot) const
 {
-    auto nodeCT = getNodeCTs(); // of all nodes (otherwise indices are tricky)
-    auto segs = getSegments(ot);
-    std::vector<double> cts = std::vector<double>(segs.size());
-    for (int i=0; i<cts.size(); i++) {
-        cts[i] = nodeCT[segs[i].y]; // segment creation time is the node creation time of the second node
-    }
+    std::vector<double> cts;
+    cts.reserve(this->getNumberOfSegments(ot)); // for speed up
+    getSegmentCTs(cts, ot);
     return cts;
 }
 
@@ -363,16 +614,296 @@ std::vector<double> Organism::getSegmentCTs(int ot) const
  */
 std::vector<Organ*> Organism::getSegmentOrigins(int ot) const
 {
-    auto organs = getOrgans(ot);
     std::vector<Organ*> segs = std::vector<Organ*>(0);
     segs.reserve(this->getNumberOfSegments(ot)); // for speed up
-    for (const auto& o : organs) {
-        auto s = o->getSegments();
-        for (int i=0; i<s.size(); i++) {
-            segs.push_back(o);
+    getSegmentOrigins(segs, ot);
+    return segs;
+}
+
+/**
+ * Calls f for the organs of type ot with more than one node, in the order of Organism::getOrgans
+ */
+template<class F>
+static void forEachOrgan(const std::vector<Organ*>& organs, const std::vector<int>& types, int ot, F& f)
+{
+    for (size_t i=0; i<organs.size(); i++) {
+        if (((ot<0) || (ot==types[i])) && (organs[i]->getNumberOfNodes()>1)) {
+            f(organs[i]);
         }
     }
-    return segs;
+}
+
+/**
+ * Sequential list of organs, like Organism::getOrgans(int)
+ *
+ * The buffer versions of the geometry methods replace the content of the buffer, and reuse its memory. Called each
+ * time step (e.g. in a coupling loop) with the same buffers, they only allocate if the geometry outgrows the buffer.
+ *
+ * @param organs    buffer receiving the organs
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ */
+void Organism::getOrgans(std::vector<Organ*>& organs, int ot) const
+{
+    organs.clear();
+    auto f = [&](Organ* o) { organs.push_back(o); };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+}
+
+/**
+ * Nodes per organ, like Organism::getPolylines(int)
+ *
+ * @param polylines buffer receiving a vector of nodes per organ, the inner vectors are reused as well
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ */
+void Organism::getPolylines(std::vector<std::vector<Vector3d>>& polylines, int ot) const
+{
+    size_t k = 0;
+    auto f = [&](Organ* o) {
+        if (k==polylines.size()) {
+            polylines.push_back(std::vector<Vector3d>());
+        }
+        o->getNodes(polylines[k++]);
+    };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+    polylines.resize(k);
+}
+
+/**
+ * Nodes ordered by their node index, like Organism::getNodes()
+ *
+ * @param nodes     buffer receiving the nodes
+ */
+void Organism::getNodes(std::vector<Vector3d>& nodes) const
+{
+    nodes.resize(getNumberOfNodes());
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=0; i<n; i++) {
+        nodes[i] = nodeStore.getNode(i);
+    }
+    std::fill(nodes.begin()+n, nodes.end(), Vector3d());
+}
+
+/**
+ * Node creation times, like Organism::getNodeCTs()
+ *
+ * @param cts       buffer receiving the node creation times
+ */
+void Organism::getNodeCTs(std::vector<double>& cts) const
+{
+    cts.resize(getNumberOfNodes());
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=0; i<n; i++) {
+        cts[i] = nodeStore.getNodeCT(i);
+    }
+    std::fill(cts.begin()+n, cts.end(), 0.);
+}
+
+/**
+ * Line segments of the organism, like Organism::getSegments(int)
+ *
+ * @param segs      buffer receiving the segments
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ */
+void Organism::getSegments(std::vector<Vector2i>& segs, int ot) const
+{
+    segs.clear();
+    auto f = [&](Organ* o) { o->getSegments(segs); };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+}
+
+/**
+ * Segment creation times, like Organism::getSegmentCTs(int)
+ *
+ * @param cts       buffer receiving the creation times
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ */
+void Organism::getSegmentCTs(std::vector<double>& cts, int ot) const
+{
+    cts.clear();
+    auto f = [&](Organ* o) {
+        for (int i=1; i<o->getNumberOfNodes(); i++) {
+            cts.push_back(nodeStore.getNodeCT(o->getNodeId(i))); // segment creation time is the node creation time of the second node
+        }
+    };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+}
+
+/**
+ * Organs containing each segment, like Organism::getSegmentOrigins(int)
+ *
+ * @param origins   buffer receiving the organs
+ * @param ot        the expected organ type, where -1 denotes all organ types (default)
+ */
+void Organism::getSegmentOrigins(std::vector<Organ*>& origins, int ot) const
+{
+    origins.clear();
+    auto f = [&](Organ* o) { origins.insert(origins.end(), o->getNumberOfNodes()-1, o); };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+}
+
+/**
+ * Streams the geometry to a visitor, without copying it: first all nodes by their node index (like Organism::getNodes),
+ * then the organs (like Organism::getOrgans), each followed by its segments (like Organism::getSegments)
+ *
+ * @param v         the visitor
+ * @param ot        the expected organ type of the organs and segments, where -1 denotes all organ types (default)
+ */
+void Organism::visit(GeometryVisitor& v, int ot) const
+{
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=0; i<getNumberOfNodes(); i++) {
+        if (i<n) {
+            v.visitNode(i, nodeStore.getNode(i), nodeStore.getNodeCT(i));
+        } else {
+            v.visitNode(i, Vector3d(), 0.);
+        }
+    }
+    auto f = [&](Organ* o) {
+        if (v.visitOrgan(o)) {
+            for (int i=1; i<o->getNumberOfNodes(); i++) {
+                int ni = o->getNodeId(i);
+                v.visitSegment(Vector2i(o->getNodeId(i-1), ni), nodeStore.getNodeCT(ni), o);
+            }
+        }
+    };
+    forEachOrgan(getOrganList(), organListTypes, ot, f);
+}
+
+/**
+ * The nodes of the organism, like Organism::getNodes(), but held in a persistent cache.
+ * The cache is built by the first call, and afterwards only patched with the new and moved nodes,
+ * i.e. the costs per time step are proportional to the growth in this step.
+ *
+ * The reference is valid until the next call of a non-const method of the organism.
+ *
+ * @return          nodes, ordered by their node index
+ */
+const std::vector<Vector3d>& Organism::getCachedNodes() const
+{
+    updateCaches();
+    return nodeCache;
+}
+
+/**
+ * All line segments of the organism in a persistent cache (see Organism::getCachedNodes).
+ *
+ * In contrast to Organism::getSegments the segments are ordered by the index of their second node,
+ * i.e. new segments are appended, and the indices of existing segments do not change during growth.
+ *
+ * @return          line segments, each containing two node indices
+ */
+const std::vector<Vector2i>& Organism::getCachedSegments() const
+{
+    updateCaches();
+    return segmentCache;
+}
+
+/**
+ * @return the creation times of the segments, corresponding to Organism::getCachedSegments
+ */
+const std::vector<double>& Organism::getCachedSegmentCTs() const
+{
+    updateCaches();
+    return segmentCTCache;
+}
+
+/**
+ * @return the organs containing the segments, corresponding to Organism::getCachedSegments
+ */
+const std::vector<Organ*>& Organism::getCachedSegmentOrigins() const
+{
+    updateCaches();
+    return segmentOriginCache;
+}
+
+/**
+ * Applies the changes logged by the node store (overwritten nodes, and shrinking e.g. by RootSystem::pop),
+ * and appends the new nodes to the caches. Rebuilds the caches if they are not valid.
+ */
+void Organism::updateCaches() const
+{
+    if (!cacheValid) {
+        nodeCache.clear();
+        segmentCache.clear();
+        segmentCTCache.clear();
+        segmentOriginCache.clear();
+        segmentIndex.clear();
+        cacheNodes = 0;
+        cacheChanges = nodeStore.getChanges().size(); // nothing to patch
+        cacheValid = true;
+    }
+    const auto& changes = nodeStore.getChanges();
+    for (; cacheChanges<changes.size(); cacheChanges++) {
+        int i = changes[cacheChanges];
+        if (i>=0) { // node i was overwritten
+            if ((i<cacheNodes) && (i<nodeStore.size())) {
+                nodeCache[i] = nodeStore.getNode(i);
+                int si = segmentIndex[i];
+                if (si>=0) {
+                    segmentCache[si].x = nodeStore.getPrev(i);
+                    segmentCTCache[si] = nodeStore.getNodeCT(i);
+                    segmentOriginCache[si] = nodeStore.getOrgan(i);
+                } else if (nodeStore.getPrev(i)>=0) { // a segment would have to be inserted
+                    cacheValid = false;
+                    updateCaches();
+                    return;
+                }
+            }
+        } else { // store was shrunk
+            int n = -i-1;
+            if (n<cacheNodes) {
+                while (!segmentCache.empty() && (segmentCache.back().y>=n)) {
+                    segmentCache.pop_back();
+                    segmentCTCache.pop_back();
+                    segmentOriginCache.pop_back();
+                }
+                nodeCache.resize(n);
+                segmentIndex.resize(n);
+                cacheNodes = n;
+            }
+        }
+    }
+    nodeCache.resize(cacheNodes);
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=cacheNodes; i<n; i++) { // append new nodes
+        nodeCache.push_back(nodeStore.getNode(i));
+        int p = nodeStore.getPrev(i);
+        if (p>=0) {
+            segmentIndex.push_back(segmentCache.size());
+            segmentCache.push_back(Vector2i(p,i));
+            segmentCTCache.push_back(nodeStore.getNodeCT(i));
+            segmentOriginCache.push_back(nodeStore.getOrgan(i));
+        } else {
+            segmentIndex.push_back(-1);
+        }
+    }
+    if (n>cacheNodes) {
+        cacheNodes = n;
+    }
+    nodeCache.resize(getNumberOfNodes()); // unused node indices (e.g. artificial shoot)
+}
+
+/**
+ * Scale of the elongation of an organ, multiplied with the elongation scale of its organ type parameter (e.g.
+ * RootRandomParameter::f_se). Organs without a scale (e.g. laterals created in the current time step) use the scale
+ * of their nearest ancestor that has one.
+ *
+ * @param o         the organ
+ * @return          the scale, 1 if no scales are set
+ */
+double Organism::getElongationScale(const Organ* o) const
+{
+    if (elongationScales.empty()) {
+        return 1.;
+    }
+    while (o!=nullptr) {
+        int id = o->getId(); // provisional ids of a parallel time step are negative
+        if ((id>=0) && (id<int(elongationScales.size()))) {
+            return elongationScales[id];
+        }
+        o = o->getParent();
+    }
+    return 1.;
 }
 
 /**
@@ -430,13 +961,10 @@ std::vector<double> Organism::getUpdatedNodeCTs() const
  */
 std::vector<Vector3d> Organism::getNewNodes() const
 {
-    auto organs = this->getOrgans();
     std::vector<Vector3d> nv(this->getNumberOfNewNodes());
-    for (const auto& o : organs) {
-        int onon = o->getOldNumberOfNodes();
-        for (size_t i=onon; i<o->getNumberOfNodes(); i++) { // loop over all new nodes
-            nv.at(o->getNodeId(i)-this->oldNumberOfNodes) = o->getNode(i);
-        }
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=oldNumberOfNodes; i<n; i++) {
+        nv[i-oldNumberOfNodes] = nodeStore.getNode(i);
     }
     return nv;
 }
@@ -449,16 +977,10 @@ std::vector<Vector3d> Organism::getNewNodes() const
  */
 std::vector<double> Organism::getNewNodeCTs() const
 {
-    auto organs = this->getOrgans();
     std::vector<double> nv(this->getNumberOfNewNodes());
-    for (const auto& o : organs) {
-        int onon = o->getOldNumberOfNodes();
-        if (onon==0) { // make sure to never copy the root emergence time
-            onon = 1;
-        }
-        for (size_t i=onon; i<o->getNumberOfNodes(); i++) { // loop over all new nodes
-            nv.at(o->getNodeId(i)-this->oldNumberOfNodes) = o->getNodeCT(i);
-        }
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=oldNumberOfNodes; i<n; i++) {
+        nv[i-oldNumberOfNodes] = nodeStore.getNodeCT(i);
     }
     return nv;
 }
@@ -506,6 +1028,94 @@ std::vector<Organ*> Organism::getNewSegmentOrigins(int ot) const
     return so;
 }
 
+/**
+ * All changes of the previous time step (see Organism::getStepDelta(StepDelta&, int))
+ *
+ * @param ot        the expected organ type of the new segments, where -1 denotes all organ types (default)
+ * @return          new nodes, updated nodes, and new segments
+ */
+StepDelta Organism::getStepDelta(int ot) const
+{
+    StepDelta delta;
+    getStepDelta(delta, ot);
+    return delta;
+}
+
+/**
+ * All changes of the previous time step, like the separate calls of Organism::getNewNodes, Organism::getNewNodeCTs,
+ * Organism::getUpdatedNodeIndices, Organism::getUpdatedNodes, Organism::getUpdatedNodeCTs, Organism::getNewSegments,
+ * and Organism::getNewSegmentOrigins, but with a single traversal of the organs. The vectors of the delta are replaced,
+ * and reuse their memory, when called each time step with the same delta.
+ *
+ * @param delta     receives the changes
+ * @param ot        the expected organ type of the new segments, where -1 denotes all organ types (default)
+ */
+void Organism::getStepDelta(StepDelta& delta, int ot) const
+{
+    struct Fill : public StepDeltaSink {
+        StepDelta& d;
+        Fill(StepDelta& d): d(d) { }
+        void newNode(int i, const Vector3d& n, double ct) override {
+            d.newNodes.push_back(n);
+            d.newNodeCTs.push_back(ct);
+        }
+        void updatedNode(int i, const Vector3d& n, double ct) override {
+            d.updatedNodeIndices.push_back(i);
+            d.updatedNodes.push_back(n);
+            d.updatedNodeCTs.push_back(ct);
+        }
+        void newSegment(const Vector2i& s, Organ* o) override {
+            d.newSegments.push_back(s);
+            d.newSegmentOrigins.push_back(o);
+        }
+    } fill(delta);
+    delta.numberOfNewNodes = getNumberOfNewNodes();
+    delta.numberOfNewOrgans = getNumberOfNewOrgans();
+    delta.newNodes.clear();
+    delta.newNodeCTs.clear();
+    delta.updatedNodeIndices.clear();
+    delta.updatedNodes.clear();
+    delta.updatedNodeCTs.clear();
+    delta.newSegments.clear();
+    delta.newSegmentOrigins.clear();
+    delta.newNodes.reserve(delta.numberOfNewNodes);
+    delta.newNodeCTs.reserve(delta.numberOfNewNodes);
+    delta.newSegments.reserve(delta.numberOfNewNodes);
+    delta.newSegmentOrigins.reserve(delta.numberOfNewNodes);
+    visitStepDelta(fill, ot);
+}
+
+/**
+ * Streams the changes of the previous time step to a sink: the new nodes (in the order of their node indices), then
+ * per organ (in the order of Organism::getOrgans) the updated node and the new segments. The organs are traversed once.
+ *
+ * @param sink      receives the changes
+ * @param ot        the expected organ type of the new segments, where -1 denotes all organ types (default)
+ */
+void Organism::visitStepDelta(StepDeltaSink& sink, int ot) const
+{
+    int n = std::min(getNumberOfNodes(), nodeStore.size());
+    for (int i=oldNumberOfNodes; i<getNumberOfNodes(); i++) {
+        if (i<n) {
+            sink.newNode(i, nodeStore.getNode(i), nodeStore.getNodeCT(i));
+        } else {
+            sink.newNode(i, Vector3d(), 0.);
+        }
+    }
+    auto f = [&](Organ* o) {
+        int onon = o->getOldNumberOfNodes();
+        if (o->hasMoved()) {
+            sink.updatedNode(o->getNodeId(onon-1), o->getNode(onon-1), o->getNodeCT(onon-1));
+        }
+        if ((onon>0) && ((ot<0) || (ot==o->organType()))) {
+            for (int i=onon-1; i<o->getNumberOfNodes()-1; i++) { // loop over new segments
+                sink.newSegment(Vector2i(o->getNodeId(i), o->getNodeId(i+1)), o);
+            }
+        }
+    };
+    forEachOrgan(getOrganList(), organListTypes, -1, f);
+}
+
 /**
  * @return Quick info about the object for debugging
  */
@@ -572,75 +1182,319 @@ void Organism::writeParameters(std::string name, std::string basetag, bool comme
 
 /**
  * Creates a rsml file with filename @param name.
+ * The organs are streamed into the file one after the other, no document is built.
  *
  * @param name      name of the rsml file
  */
 void Organism::writeRSML(std::string name) const
 {
-    tinyxml2::XMLDocument xmlDoc;
-    tinyxml2:: XMLElement* rsml = xmlDoc.NewElement("rsml"); // RSML
-    tinyxml2:: XMLElement* meta = getRSMLMetadata(xmlDoc);
-    tinyxml2:: XMLElement* scene = getRSMLScene(xmlDoc);
-    rsml->InsertEndChild(meta);
-    rsml->InsertEndChild(scene);
-    xmlDoc.InsertEndChild(rsml);
-    xmlDoc.SaveFile(name.c_str());
+    FILE* fp = fopen(name.c_str(), "w");
+    if (fp==nullptr) {
+        std::cout << "Organism::writeRSML: could not open file " << name << "\n" << std::flush;
+        throw std::invalid_argument("Organism::writeRSML: could not open file " + name);
+    }
+    tinyxml2::XMLPrinter printer(fp);
+    printer.OpenElement("rsml"); // RSML
+    writeRSMLMetadata(printer);
+    writeRSMLScene(printer);
+    printer.CloseElement();
+    fclose(fp);
 }
 
 /**
- * @return the meta tag of the rsml file
+ * Writes the same document as Organism::writeRSML(std::string) into a stream.
+ * The document is printed into memory first, e.g. for writing it later, or by another thread (@see AsyncWriter).
+ *
+ * @param os        typically a string stream
  */
-tinyxml2:: XMLElement* Organism::getRSMLMetadata(tinyxml2::XMLDocument& xmlDoc) const
+void Organism::writeRSML(std::ostream& os) const
 {
-    tinyxml2:: XMLElement* metadata = xmlDoc.NewElement("metadata"); // META
-    tinyxml2:: XMLElement* version = xmlDoc.NewElement("version");
-    version->SetText(1);
-    tinyxml2:: XMLElement* unit = xmlDoc.NewElement("unit");
-    unit->SetText("cm");
-    tinyxml2:: XMLElement* resolution = xmlDoc.NewElement("resolution");
-    resolution->SetText(1);
-    tinyxml2:: XMLElement* last = xmlDoc.NewElement("last-modified");
+    tinyxml2::XMLPrinter printer;
+    printer.OpenElement("rsml"); // RSML
+    writeRSMLMetadata(printer);
+    writeRSMLScene(printer);
+    printer.CloseElement();
+    os << printer.CStr();
+}
+
+/**
+ * Writes the meta tag of the rsml file
+ */
+void Organism::writeRSMLMetadata(tinyxml2::XMLPrinter& printer) const
+{
+    printer.OpenElement("metadata"); // META
+    printer.OpenElement("version");
+    printer.PushText(1);
+    printer.CloseElement();
+    printer.OpenElement("unit");
+    printer.PushText("cm");
+    printer.CloseElement();
+    printer.OpenElement("resolution");
+    printer.PushText(1);
+    printer.CloseElement();
+    printer.OpenElement("last-modified");
     std::time_t t = std::time(0);
     std::tm* now = std::localtime(&t);
     std::string s = std::to_string(now->tm_mday)+"-"+std::to_string(now->tm_mon+1)+"-"+std::to_string(now->tm_year + 1900);
-    last->SetText(s.c_str());
-    tinyxml2:: XMLElement* software = xmlDoc.NewElement("software");
-    software->SetText("OrganicBox");
+    printer.PushText(s.c_str());
+    printer.CloseElement();
+    printer.OpenElement("software");
+    printer.PushText("OrganicBox");
+    printer.CloseElement();
     // todo no image tag (?)
     // todo property-definitions
     // todo time sequence (?)
-    metadata->InsertEndChild(version);
-    metadata->InsertEndChild(unit);
-    metadata->InsertEndChild(resolution);
-    metadata->InsertEndChild(last);
-    metadata->InsertEndChild(software);
     // todo insert remaining tags
-    return metadata;
+    printer.CloseElement();
 }
 
 /**
- * @return the scene tag of the RSML document, calls base organs to write their tags
+ * Writes the scene tag of the RSML document, calls base organs to write their tags
  */
-tinyxml2:: XMLElement* Organism::getRSMLScene(tinyxml2::XMLDocument& xmlDoc) const
+void Organism::writeRSMLScene(tinyxml2::XMLPrinter& printer) const
 {
-    tinyxml2:: XMLElement* scene = xmlDoc.NewElement("scene");
-    tinyxml2:: XMLElement* plant = xmlDoc.NewElement("plant");
-    scene->InsertEndChild(plant);
+    printer.OpenElement("scene");
+    printer.OpenElement("plant");
     for (auto& o: baseOrgans) {
-        o->writeRSML(xmlDoc, plant);
+        o->writeRSML(printer);
+    }
+    printer.CloseElement(); // plant
+    printer.CloseElement(); // scene
+}
+
+/* binary file layout (see Organism::save) */
+static const std::string binaryMagic = "CRootBox"; ///< first bytes of the file
+static const uint32_t binaryVersion = 3; ///< increase, if the layout changes
+static const uint32_t binaryByteOrder = 0x01020304; ///< the file is written in native byte order
+
+/**
+ * Writes the simulation state into a binary file: the organ random parameters, the organ tree with the specific parameters
+ * and node data of each organ, the id counters, the simulation time, and the states of the random number generators.
+ *
+ * Callbacks (tropisms, growth functions, soil look ups), and the confining geometry are not written.
+ * The file is written in native byte order, and is not meant to be exchanged between different platforms.
+ *
+ * @param name      file name
+ */
+void Organism::save(std::string name) const
+{
+    std::ofstream fos(name, std::ios::binary);
+    if (!fos.good()) {
+        std::cout << "Organism::save: could not open file " << name << "\n" << std::flush;
+        throw std::invalid_argument("Organism::save: could not open file " + name);
+    }
+    BinaryWriter w(fos);
+    w.writeChars(binaryMagic);
+    w.write(binaryVersion);
+    w.write(binaryByteOrder);
+    writeBinary(w);
+    if (!fos.good()) {
+        std::cout << "Organism::save: could not write file " << name << "\n" << std::flush;
+        throw std::invalid_argument("Organism::save: could not write file " + name);
+    }
+}
+
+/**
+ * Restores the simulation state from a binary file written by Organism::save.
+ * The file is memory mapped, and the organs are created directly from the mapped data.
+ *
+ * Organ random parameters of the file replace the parameters of the same organ type and sub type.
+ * Simulation continues exactly as the saved organism would have continued. Checkpoints (see RootSystem::push) are discarded.
+ * If the file is corrupt a std::invalid_argument is thrown, and the organism has no organs.
+ *
+ * @param name      file name
+ */
+void Organism::load(std::string name)
+{
+    MappedFile file(name);
+    BinaryReader r(file.getData(), file.getSize());
+    if ((file.getSize()<binaryMagic.size()) || (r.readChars(binaryMagic.size())!=binaryMagic)) {
+        std::cout << "Organism::load: " << name << " is not a CRootBox binary file \n" << std::flush;
+        throw std::invalid_argument("Organism::load: not a CRootBox binary file " + name);
+    }
+    uint32_t version = r.read<uint32_t>();
+    uint32_t order = r.read<uint32_t>();
+    if ((version!=binaryVersion) || (order!=binaryByteOrder)) {
+        std::cout << "Organism::load: file " << name << " has version " << version << " and byte order " << std::hex << order
+            << std::dec << ", expected version " << binaryVersion << " in native byte order \n" << std::flush;
+        throw std::invalid_argument("Organism::load: unsupported file " + name);
+    }
+    readBinary(r);
+    if (!r.atEnd()) {
+        std::cout << "Organism::load: unexpected data after byte " << r.getPosition() << " of file " << name << "\n" << std::flush;
+        throw std::invalid_argument("Organism::load: unexpected data in file " + name);
+    }
+}
+
+/**
+ * Writes the simulation state, overwrite to add the state of derived classes
+ *
+ * @param w         the binary writer
+ */
+void Organism::writeBinary(BinaryWriter& w) const
+{
+    w.write(simtime);
+    w.write(organId);
+    w.write(nodeId);
+    w.write(oldNumberOfNodes);
+    w.write(oldNumberOfOrgans);
+    w.write(seed);
+    w.writeText(gen);
+    w.writeText(UD);
+    w.writeText(ND);
+    w.write(uint64_t(streams.size()));
+    for (const auto& s : streams) {
+        w.writeText(s.gen);
+        w.writeText(s.UD);
+        w.writeText(s.ND);
+        w.write(s.organs);
+        w.write(s.nodes);
+    }
+    w.write(organStreams);
+    for (int ot = 0; ot < numberOfOrganTypes; ot++) {
+        w.write(uint64_t(organParam[ot].size()));
+        for (const auto& otp : organParam[ot]) {
+            otp.second->writeBinary(w);
+        }
+    }
+    w.write(nodeStore.size());
+    w.write(uint64_t(baseOrgans.size()));
+    for (const auto& o : baseOrgans) {
+        writeOrgan(w, o);
+    }
+}
+
+/**
+ * Reads the simulation state written by Organism::writeBinary, replaces all organs
+ *
+ * @param r         the binary reader
+ */
+void Organism::readBinary(BinaryReader& r)
+{
+    deleteOrgans();
+    organTreeChanged();
+    nodeStore.clear();
+    nodeStore.clearChanges();
+    cacheValid = false;
+    cacheChanges = 0;
+    streams.clear();
+    simtime = r.read<double>();
+    organId = r.read<int>();
+    nodeId = r.read<int>();
+    oldNumberOfNodes = r.read<int>();
+    oldNumberOfOrgans = r.read<int>();
+    seed = r.read<unsigned int>();
+    r.readText(gen);
+    r.readText(UD);
+    r.readText(ND);
+    uint64_t n = r.read<uint64_t>();
+    for (uint64_t i=0; i<n; i++) {
+        streams.push_back(SubtreeStream(seed, i));
+        r.readText(streams.back().gen);
+        r.readText(streams.back().UD);
+        r.readText(streams.back().ND);
+        streams.back().organs = r.read<int>();
+        streams.back().nodes = r.read<int>();
+    }
+    organStreams = r.read<bool>();
+    for (int ot = 0; ot < numberOfOrganTypes; ot++) {
+        n = r.read<uint64_t>();
+        for (uint64_t i=0; i<n; i++) {
+            if (organParam[ot].empty()) {
+                std::cout << "Organism::readBinary: the organism has no parameters of organ type " << ot << "\n" << std::flush;
+                throw std::invalid_argument("Organism::readBinary: unsupported organ type");
+            }
+            OrganRandomParameter* otp = organParam[ot].begin()->second->copy(this); // same class, as in Organism::readParameters
+            try {
+                otp->readBinary(r);
+            } catch (...) {
+                delete otp;
+                throw;
+            }
+            setOrganRandomParameter(otp);
+        }
+    }
+    int nodes = r.read<int>();
+    n = r.read<uint64_t>();
+    try {
+        for (uint64_t i=0; i<n; i++) {
+            baseOrgans.push_back(readOrgan(r));
+        }
+    } catch (...) {
+        for (auto o : baseOrgans) {
+            delete o;
+        }
+        baseOrgans.clear();
+        throw;
+    }
+    nodeStore.resize(nodes);
+    for (auto& o : baseOrgans) {
+        o->storeNodes();
+    }
+    nodeStore.clearChanges();
+}
+
+/**
+ * Creates an empty organ of organ type @param ot, overwrite for the organ classes of the organism
+ */
+Organ* Organism::createOrgan(int ot)
+{
+    if (ot==ot_organ) {
+        return new (this) Organ(-1, nullptr, true, true, 0., 0.);
+    }
+    std::cout << "Organism::createOrgan: unsupported organ type " << ot << "\n" << std::flush;
+    throw std::invalid_argument("Organism::createOrgan: unsupported organ type");
+}
+
+/**
+ * Writes the organ @param o, and recursively its children
+ */
+void Organism::writeOrgan(BinaryWriter& w, const Organ* o) const
+{
+    w.write(o->organType());
+    o->writeBinary(w);
+    w.write(o->getNumberOfChildren());
+    for (int i=0; i<o->getNumberOfChildren(); i++) {
+        writeOrgan(w, o->getChild(i));
+    }
+}
+
+/**
+ * Reads an organ written by Organism::writeOrgan, and recursively its children
+ *
+ * @return the organ (ownership is passed)
+ */
+Organ* Organism::readOrgan(BinaryReader& r)
+{
+    int ot = r.read<int>();
+    Organ* o = createOrgan(ot);
+    try {
+        o->setOrganism(this);
+        o->readBinary(r);
+        o->getOrganRandomParameter(); // throws, if the organism has no parameters of this sub type
+        int n = r.read<int>();
+        for (int i=0; i<n; i++) {
+            o->addChild(readOrgan(r));
+        }
+    } catch (...) {
+        delete o;
+        throw;
     }
-    return scene;
+    return o;
 }
 
 /**
  * Sets the seed of the organisms random number generator.
  * In order to obtain two exact same organisms call before Organism::initialize().
+ * The streams of a parallel simulation (see Organism::setNumberOfThreads) are derived from the same seed.
  *
  * @param seed      the random number generator seed
  */
 void Organism::setSeed(unsigned int seed)
 {
+    this->seed = seed;
     this->gen = std::mt19937(seed);
+    streams.clear(); // recreated with the new seed
 }
 
 
@@ -3,17 +3,85 @@
 #define ORGANISM_H_
 
 #include "mymath.h"
+#include "nodestore.h"
+#include "pool.h"
+#include "instrumentation.h"
+#include "philox.h"
 
 #include "../external/tinyxml2/tinyxml2.h"
 
 #include <random>
 #include <map>
 #include <array>
+#include <atomic>
+#include <memory>
 
 namespace CRootBox {
 
 class Organ;
 class OrganRandomParameter;
+class BinaryWriter;
+class BinaryReader;
+
+/**
+ * Random number stream and provisional id counters of a single base organ subtree,
+ * used by Organism::simulate if the base organs are simulated in parallel (see Organism::setNumberOfThreads)
+ */
+struct SubtreeStream {
+
+    SubtreeStream(unsigned int seed, unsigned int baseOrgan) { std::seed_seq seq = { seed, baseOrgan }; gen.seed(seq); }
+
+    int nextOrganIndex() { organs++; return -organs-1; } ///< provisional organ id (<-1), see Organ::resolveIds
+    int nextNodeIndex() { nodes++; return -nodes-1; } ///< provisional node id (<-1), see Organ::resolveIds
+
+    std::mt19937 gen;
+    std::uniform_real_distribution<double> UD;
+    std::normal_distribution<double> ND;
+    int organs = 0; ///< number of organ ids handed out in the current time step
+    int nodes = 0; ///< number of node ids handed out in the current time step
+
+};
+
+/**
+ * Receives the geometry of an organism from Organism::visit, without copying it into vectors.
+ * Overwrite the methods of interest, the default implementations do nothing.
+ */
+class GeometryVisitor {
+public:
+    virtual ~GeometryVisitor() { }
+    virtual void visitNode(int i, const Vector3d& n, double ct) { } ///< node with global index i, and its creation time
+    virtual bool visitOrgan(const Organ* o) { return true; } ///< organ with more than one node, return false to skip its segments
+    virtual void visitSegment(const Vector2i& s, double ct, const Organ* o) { } ///< segment of the organ o, and its creation time
+};
+
+/**
+ * Receives the changes of the last time step from Organism::visitStepDelta, e.g. to stream them into the data structures
+ * of a coupled solver. Overwrite the methods of interest, the default implementations do nothing.
+ */
+class StepDeltaSink {
+public:
+    virtual ~StepDeltaSink() { }
+    virtual void newNode(int i, const Vector3d& n, double ct) { } ///< node created in the last time step, with global index i
+    virtual void updatedNode(int i, const Vector3d& n, double ct) { } ///< node moved in the last time step (the former tip of an organ)
+    virtual void newSegment(const Vector2i& s, Organ* o) { } ///< segment of the organ o, created in the last time step
+};
+
+/**
+ * Changes of the last time step, filled by Organism::getStepDelta in a single traversal of the organs.
+ * The vectors correspond to Organism::getNewNodes, Organism::getNewNodeCTs, Organism::getUpdatedNodeIndices,
+ * Organism::getUpdatedNodes, Organism::getUpdatedNodeCTs, Organism::getNewSegments, and Organism::getNewSegmentOrigins.
+ */
+struct StepDelta {
+    int numberOfNewNodes = 0; ///< see Organism::getNumberOfNewNodes
+    int numberOfNewOrgans = 0; ///< see Organism::getNumberOfNewOrgans
+    std::vector<Vector3d> newNodes;
+    std::vector<double> newNodeCTs;
+    std::vector<int> updatedNodeIndices;
+    std::vector<Vector3d> updatedNodes;
+    std::vector<double> updatedNodeCTs;
+    std::vector<Vector2i> newSegments;
+    std::vector<Organ*> newSegmentOrigins;
+};
 
 /**
  * Organism
@@ -28,6 +96,11 @@ class OrganRandomParameter;
  * Supports RSML
  * Holds global node index and organ index counter
  * Holds random numbers generator for the organ classes
+ *
+ * Thread safety: different organisms can be used by different threads at the same time, also copies of the same organism
+ * (they share parameters and node data, which are copied on write). A single organism must only be used by one thread at
+ * a time, also for const methods (some fill caches), which includes its organs, parameters, and attached objects
+ * (e.g. geometry, soil, tropisms).
  */
 class Organism {
 
@@ -39,22 +112,39 @@ public:
     static std::string organTypeName(int ot); ///< organ type name from an organ type number
 
     Organism() { }; ///< empty constructor
-    Organism(const Organism& o); ///< copy constructor
+    Organism(const Organism& o); ///< copy constructor, shares the parameters
+    Organism& operator=(const Organism& o) = delete;
     virtual ~Organism(); ///< destructor
 
     /* organ parameter management */
-    OrganRandomParameter* getOrganRandomParameter(int otype, int subType) const; ///< returns the respective the type parameter
-    std::vector<OrganRandomParameter*> getOrganRandomParameter(int ot) const; ///< returns all type parameters of an organ type (e.g. root)
+    OrganRandomParameter* getOrganRandomParameter(int otype, int subType); ///< returns the respective the type parameter, which can be modified
+    std::vector<OrganRandomParameter*> getOrganRandomParameter(int ot); ///< returns all type parameters of an organ type (e.g. root), which can be modified
+    OrganRandomParameter* getSharedOrganRandomParameter(int otype, int subType) const; ///< returns the respective type parameter, read only
+    std::vector<OrganRandomParameter*> getSharedOrganRandomParameter(int ot) const; ///< returns all type parameters of an organ type, read only
     void setOrganRandomParameter(OrganRandomParameter* p); ///< sets an organ type parameter, subType and organType defined within p
+    uint64_t getParameterVersion() const { return parameterVersion; } ///< changes, whenever a type parameter is replaced (see Organ::getOrganRandomParameter)
 
     /* initialization and simulation */
-    void addOrgan(Organ* o) { baseOrgans.push_back(o); } ///< adds an organ, takes ownership
+    void addOrgan(Organ* o); ///< adds an organ, takes ownership
     virtual void initialize(); ///< overwrite for initialization jobs
     virtual void simulate(double dt, bool verbose = false); ///< calls the base organs simulate methods
     double getSimTime() const { return simtime; } ///< returns the current simulation time
+    double getStepEnd() const { return stepEnd; } ///< end of the time step, that is simulated (see Organ::isSleeping)
+    void setNumberOfThreads(int n) { numberOfThreads = n; } ///< number of threads simulating the base organs, 0 for the sequential algorithm (default)
+    int getNumberOfThreads() const { return numberOfThreads; } ///< number of threads simulating the base organs
+    bool isDryRun() const { return dryRun; } ///< organs only develop age and length, but create no geometry (see RootSystem::simulateDry)
+    Instrumentation& getInstrumentation() { return instrumentation; } ///< optional counters and timers of the simulation (disabled by default)
+    const Instrumentation& getInstrumentation() const { return instrumentation; }
+
+    /* checkpoints */
+    int getCheckpoint() const { return checkpoint; } ///< id of the current checkpoint (see RootSystem::push), 0 if there is none
+    virtual void journal(Organ* o) { } ///< saves the state of an organ, before it changes for the first time after the current checkpoint
 
     /* organs as sequential list */
     std::vector<Organ*> getOrgans(int ot=-1) const; ///< sequential list of organs
+    const std::vector<Organ*>& getOrganList() const; ///< all organs of the organ tree in depth first order, cached until the tree changes
+    uint64_t getOrganListVersion() const { getOrganList(); return organListVersion; } ///< changes, whenever Organism::getOrganList changes
+    void organTreeChanged() { treeVersion++; } ///< organs were added, removed, or replaced, invalidates Organism::getOrganList (thread safe)
     virtual std::vector<double> getParameter(std::string name, int ot = -1, std::vector<Organ*> organs = std::vector<Organ*>(0)) const; ///< parameter value per organ
     double getSummed(std::string name, int ot = -1) const; ///< summed up parameters
 
@@ -69,6 +159,32 @@ public:
     virtual std::vector<Vector2i> getSegments(int ot=-1) const; ///< line segment containing two node indices, corresponding to Organism::getNodes
     virtual std::vector<double> getSegmentCTs(int ot=-1) const; ///< line creation times, corresponding to Organism::getSegments
     virtual std::vector<Organ*> getSegmentOrigins(int ot=-1) const; ///< Points to the organ which contains the segment, corresponding to Organism::getSegments
+    void getOrgans(std::vector<Organ*>& organs, int ot=-1) const; ///< sequential list of organs, into a reused buffer
+    void getPolylines(std::vector<std::vector<Vector3d>>& polylines, int ot=-1) const; ///< nodes per organ, into a reused buffer
+    virtual void getNodes(std::vector<Vector3d>& nodes) const; ///< nodes, into a reused buffer
+    void getNodeCTs(std::vector<double>& cts) const; ///< node creation times, into a reused buffer
+    void getSegments(std::vector<Vector2i>& segs, int ot=-1) const; ///< segments, into a reused buffer
+    void getSegmentCTs(std::vector<double>& cts, int ot=-1) const; ///< segment creation times, into a reused buffer
+    void getSegmentOrigins(std::vector<Organ*>& origins, int ot=-1) const; ///< segment origins, into a reused buffer
+    void visit(GeometryVisitor& v, int ot=-1) const; ///< streams nodes, organs, and segments to a visitor
+    const std::vector<Vector3d>& getCachedNodes() const; ///< nodes, like Organism::getNodes, incrementally updated
+    const std::vector<Vector2i>& getCachedSegments() const; ///< all segments, ordered by their second node index, incrementally updated
+    const std::vector<double>& getCachedSegmentCTs() const; ///< segment creation times, corresponding to Organism::getCachedSegments
+    const std::vector<Organ*>& getCachedSegmentOrigins() const; ///< segment origins, corresponding to Organism::getCachedSegments
+    const NodeStore& getNodeStore() const { return nodeStore; } ///< contiguous node geometry indexed by the global node index
+    NodeStore& getNodeStore() { return nodeStore; } ///< contiguous node geometry, only organs should modify it (see Organ::addNode)
+    void setStoragePrecision(int p, double resolution = 1.e-4, Vector3d origin = Vector3d()); ///< precision of the node store (@see NodeStore::setPrecision)
+    int getStoragePrecision() const { return nodeStore.getPrecision(); } ///< precision of the node store (@see PackedColumn::Precision)
+    void setNodePacking(bool pack, double resolution = 1.e-4, double timeResolution = 1.e-6); ///< packs nodes that no longer change (@see NodeStore::setPacking)
+    bool getNodePacking() const { return nodeStore.getPacking(); } ///< nodes are packed (@see Organism::setNodePacking)
+    void packNodes(); ///< packs the nodes that no longer change (@see NodeStore::pack)
+    size_t getOrganNodeMemory() const; ///< memory of the node data held by the organs, without the node store [bytes]
+    size_t getNodeMemory() const { return nodeStore.getMemory()+getOrganNodeMemory(); } ///< memory of the node geometry, i.e. the node store and the node data of the organs [bytes]
+    void setElongationScales(const std::vector<double>& scales) { elongationScales = scales; } ///< scales of the elongation per organ id, e.g. by the CarbonAllocator (empty for none)
+    const std::vector<double>& getElongationScales() const { return elongationScales; } ///< scales of the elongation per organ id
+    double getElongationScale(const Organ* o) const; ///< scale of the elongation of an organ (see Organism::setElongationScales)
+    MemoryPool& getMemoryPool() { return *pool; } ///< memory of the organs and their parameters (see Organ::operator new)
+    const MemoryPool& getMemoryPool() const { return *pool; }
 
     /* last time step */
     int getNumberOfNewNodes() const { return getNumberOfNodes()- oldNumberOfNodes; } ///< The number of new nodes created in the previous time step (ame number as new segments)
@@ -80,36 +196,108 @@ public:
     std::vector<double> getNewNodeCTs() const; ///< Nodes created in the previous time step
     std::vector<Vector2i> getNewSegments(int ot=-1) const; ///< Segments created in the previous time step
     std::vector<Organ*> getNewSegmentOrigins(int ot=-1) const; ///< Copies a pointer to the root containing the new segments
+    StepDelta getStepDelta(int ot=-1) const; ///< all changes of the previous time step, in a single traversal
+    void getStepDelta(StepDelta& delta, int ot=-1) const; ///< all changes of the previous time step, into reused buffers
+    void visitStepDelta(StepDeltaSink& sink, int ot=-1) const; ///< streams the changes of the previous time step to a sink
 
     /* io */
     virtual std::string toString() const; ///< Quick info for debugging
     void readParameters(std::string name, std::string  basetag = "plant"); ///< reads all organ type parameters from a xml file
     void writeParameters(std::string name, std::string basetag = "plant", bool comments = true) const; ///< write all organ type parameters into a xml file
     virtual void writeRSML(std::string name) const; ///< writes a RSML file
+    void writeRSML(std::ostream& os) const; ///< writes the RSML document into a stream, e.g. to serialize it in memory
     int getRSMLSkip() const { return rsmlSkip; } ///< skips points in the RSML output (default = 0)
     void setRSMLSkip(int skip) { assert(rsmlSkip>=0 && "rsmlSkip must be >= 0" ); rsmlSkip = skip;  } ///< skips points in the RSML output (default = 0)
     std::vector<std::string>& getRSMLProperties() { return rsmlProperties; } ///< reference to the vector<string> of RSML property names, default is { "organType", "subType","length", "age"  }
+    void save(std::string name) const; ///< writes the simulation state into a binary file, for restarts
+    void load(std::string name); ///< restores the simulation state from a binary file written by Organism::save
 
     /* id management */
-    int getOrganIndex() { organId++; return organId; } ///< returns next unique organ id, only organ constructors should call this
-    int getNodeIndex() { nodeId++; return nodeId; } ///< returns next unique node id, only organ constructors should call this
+    int getOrganIndex() { if (stream!=nullptr) { return stream->nextOrganIndex(); } organId++; return organId; } ///< returns next unique organ id, only organ constructors should call this
+    int getNodeIndex() { if (stream!=nullptr) { return stream->nextNodeIndex(); } nodeId++; return nodeId; } ///< returns next unique node id, only organ constructors should call this
+    static bool isSimulatingSubtree() { return stream!=nullptr; } ///< the current thread simulates a subtree, i.e. ids are provisional and the node store is not written (see Organism::simulateParallel)
 
     /* random number generator */
     virtual void setSeed(unsigned int seed); ///< Sets the seed of the organisms random number generator
-    virtual double rand() { return UD(gen); } ///< Uniformly distributed random number (0,1)
-    virtual double randn() { return ND(gen); } ///< Normally distributed random number (0,1)
+    unsigned int getSeed() const { return seed; } ///< seed of the random number generator
+    virtual double rand() { ///< Uniformly distributed random number (0,1)
+        if (organStream!=nullptr) { return organStream->rand(); }
+        if (stream!=nullptr) { return stream->UD(stream->gen); }
+        return UD(gen);
+    }
+    virtual double randn() { ///< Normally distributed random number (0,1)
+        if (organStream!=nullptr) { return organStream->randn(); }
+        if (stream!=nullptr) { return stream->ND(stream->gen); }
+        return ND(gen);
+    }
+    void setOrganStreams(bool b) { organStreams = b; } ///< organs draw from their own counter based streams (call before Organism::initialize)
+    bool hasOrganStreams() const { return organStreams; } ///< true, if organs draw from their own streams (see OrganStream)
+
+    /**
+     * Within its scope, the random numbers of the current thread are drawn from the stream of an organ,
+     * if the organism uses organ streams (see Organism::setOrganStreams)
+     */
+    class StreamScope {
+    public:
+        StreamScope(const Organism* plant, OrganStream* s): previous(organStream) {
+            if (plant->organStreams) {
+                organStream = s;
+            }
+        }
+        ~StreamScope() { organStream = previous; }
+    private:
+        OrganStream* previous;
+    };
 
 protected:
 
-    virtual tinyxml2:: XMLElement* getRSMLMetadata(tinyxml2::XMLDocument& doc) const;
-    virtual tinyxml2:: XMLElement* getRSMLScene(tinyxml2::XMLDocument& doc) const;
+    virtual void writeRSMLMetadata(tinyxml2::XMLPrinter& printer) const; ///< writes the metadata tag
+    virtual void writeRSMLScene(tinyxml2::XMLPrinter& printer) const; ///< writes the scene tag, calls the base organs
+
+    virtual void writeBinary(BinaryWriter& w) const; ///< writes the simulation state (see Organism::save)
+    virtual void readBinary(BinaryReader& r); ///< reads the simulation state (see Organism::load)
+    virtual Organ* createOrgan(int ot); ///< empty organ of organ type ot, filled by Organ::readBinary
+    void writeOrgan(BinaryWriter& w, const Organ* o) const; ///< writes the organ, and its children
+    Organ* readOrgan(BinaryReader& r); ///< reads an organ, and its children
 
+    void simulateParallel(double dt, bool verbose); ///< simulates the base organs on Organism::numberOfThreads threads
+    void updateCaches() const; ///< patches the geometry caches with the changes of the node store
+    void deleteOrgans(); ///< deletes the base organs in bulk, and replaces the memory pool (see MemoryPool::BulkRelease)
+
+    MemoryPool* pool = new MemoryPool(); ///< owns the memory of the organs, declared first to outlive them, destroyed by MemoryPool::destroy
     std::vector<Organ*> baseOrgans;  ///< base organs of the root system
+    NodeStore nodeStore; ///< geometry of all nodes, indexed by the global node index
+
+    /* incremental geometry caches (see Organism::getCachedSegments) */
+    mutable bool cacheValid = false; ///< caches are built
+    mutable int cacheNodes = 0; ///< number of node store entries in the caches
+    mutable size_t cacheChanges = 0; ///< number of node store changes applied to the caches
+    mutable std::vector<Vector3d> nodeCache;
+    mutable std::vector<Vector2i> segmentCache;
+    mutable std::vector<double> segmentCTCache;
+    mutable std::vector<Organ*> segmentOriginCache;
+    mutable std::vector<int> segmentIndex; ///< index of the segment ending in a node, or -1
+
+    /* flattened organ tree (see Organism::getOrganList) */
+    std::atomic<uint64_t> treeVersion = { 0 }; ///< see Organism::organTreeChanged, organs add children in parallel
+    mutable std::vector<Organ*> organList;
+    mutable std::vector<int> organListTypes; ///< organ types, corresponding to Organism::organList
+    mutable uint64_t organListTree = 0; ///< Organism::treeVersion of the list
+    mutable int organListIds = -2; ///< Organism::organId of the list, new organs always take new ids
+    mutable uint64_t organListVersion = 0; ///< see Organism::getOrganListVersion
 
     static const int numberOfOrganTypes = 5;
-    std::array<std::map<int, OrganRandomParameter*>, numberOfOrganTypes> organParam;
+    OrganRandomParameter* unshare(std::shared_ptr<OrganRandomParameter>& p); ///< copies the parameter set, if it is shared
+    void updateParameterTable(int ot); ///< rebuilds Organism::parameterTable of an organ type, and renews Organism::parameterVersion
+
+    std::array<std::map<int, std::shared_ptr<OrganRandomParameter>>, numberOfOrganTypes> organParam; ///< shared by the copies of the organism, copied on write
+    std::array<std::vector<OrganRandomParameter*>, numberOfOrganTypes> parameterTable; ///< Organism::organParam indexed by sub type (nullptr if not set)
+    uint64_t parameterVersion = nextParameterVersion(); ///< see Organism::getParameterVersion
+    static uint64_t nextParameterVersion() { return ++parameterVersions; } ///< unique version number
+    static std::atomic<uint64_t> parameterVersions; ///< number of versions created by all organisms (the numbers are unique)
 
     double simtime = 0;
+    double stepEnd = 0; ///< see Organism::getStepEnd
     int organId = -1;
     int nodeId = -1;
     int oldNumberOfNodes = 0;
@@ -118,10 +306,23 @@ protected:
     std::vector<std::string> rsmlProperties = { "organType", "subType","length", "age"  };
     int rsmlSkip = 0; // skips points
 
+    std::vector<double> elongationScales; ///< see Organism::setElongationScales, not copied
+
+    unsigned int seed = std::mt19937::default_seed; ///< seed of the random number generator
     std::mt19937 gen;
     std::uniform_real_distribution<double> UD;
     std::normal_distribution<double> ND;
 
+    int numberOfThreads = 0; ///< 0 for sequential simulation, otherwise base organs are simulated in parallel
+    bool dryRun = false; ///< see Organism::isDryRun
+    Instrumentation instrumentation; ///< see Organism::getInstrumentation
+    int checkpoint = 0; ///< see Organism::getCheckpoint
+    static std::atomic<int> checkpoints; ///< number of checkpoints created by all organisms (the ids are unique)
+    std::vector<SubtreeStream> streams; ///< one random number stream per base organ (parallel simulation only)
+    static thread_local SubtreeStream* stream; ///< stream of the subtree the current thread is simulating, or nullptr
+    bool organStreams = false; ///< see Organism::setOrganStreams
+    static thread_local OrganStream* organStream; ///< stream of the organ the current thread is simulating, or nullptr
+
 };
 
 } // namespace
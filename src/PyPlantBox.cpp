@@ -37,7 +37,7 @@ PYBIND11_MODULE(py_plantbox, m) {
         .def(py::init<>())
         .def(py::init<double, double, double>())
         .def(py::init<const Vector3d&>())
-        .def("rotAB", &Vector3d::rotAB)
+        .def("rotAB", (Vector3d (*)(double, double)) &Vector3d::rotAB) // overloads
         .def("normalize", &Vector3d::normalize)
         .def("times", (double (Vector3d::*)(const Vector3d&) const) &Vector3d::times) // overloads
         .def("length", &Vector3d::length)
@@ -57,7 +57,7 @@ PYBIND11_MODULE(py_plantbox, m) {
         .def("rotX", &Matrix3d::rotX)
         .def("rotY", &Matrix3d::rotY)
         .def("rotZ", &Matrix3d::rotZ)
-        .def("ons", &Matrix3d::ons)
+        .def("ons", (Matrix3d (*)(Vector3d&)) &Matrix3d::ons) // overloads
         .def("det", &Matrix3d::det)
         .def("inverse", &Matrix3d::inverse)
         .def("column", &Matrix3d::column)
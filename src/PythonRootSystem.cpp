@@ -19,7 +19,17 @@
 #include "RootSystem.h"
 #include "sdf_rs.h"
 #include "analysis.h"
-#include "../examples/example_exudation.h"
+#include "ensemble.h"
+#include "timeseries.h"
+#include "doussan.h"
+#include "exudation.h"
+#include "rsml.h"
+#include "mapper.h"
+#include "field.h"
+#include "asyncwriter.h"
+#include "carbon.h"
+#include "tipregistry.h"
+#include "segmentstore.h"
 
 namespace CRootBox {
 
@@ -39,32 +49,61 @@ Vector3d (Vector3d::*times1)(const double) const = &Vector3d::times;
 double (Vector3d::*times2)(const Vector3d&) const = &Vector3d::times;
 void (Matrix3d::*times3)(const Matrix3d&) = &Matrix3d::times;
 Vector3d (Matrix3d::*times4)(const Vector3d&) const = &Matrix3d::times;
+Matrix3d (*ons1)(Vector3d&) = &Matrix3d::ons;
+Vector3d (*rotAB1)(double, double) = &Vector3d::rotAB;
 
 std::string (SignedDistanceFunction::*writePVPScript)() const = &SignedDistanceFunction::writePVPScript; // because of default value
 
-OrganRandomParameter* (Organism::*getOrganRandomParameter1)(int otype, int subType) const = &Organism::getOrganRandomParameter;
-std::vector<OrganRandomParameter*> (Organism::*getOrganRandomParameter2)(int otype) const = &Organism::getOrganRandomParameter;
+OrganRandomParameter* (Organism::*getOrganRandomParameter1)(int otype, int subType) = &Organism::getOrganRandomParameter;
+std::vector<OrganRandomParameter*> (Organism::*getOrganRandomParameter2)(int otype) = &Organism::getOrganRandomParameter;
+OrganSpecificParameter* (OrganRandomParameter::*realize1)() = &OrganRandomParameter::realize;
 void (OrganRandomParameter::*readXML1)(std::string name) = &OrganRandomParameter::readXML;
 void (OrganRandomParameter::*writeXML1)(std::string name) const = &OrganRandomParameter::writeXML;
 void (OrganRandomParameter::*bindDoubleParameter)(std::string name, double* d, std::string descr, double* dev) = &OrganRandomParameter::bindParameter;
 void (OrganRandomParameter::*bindIntParameter)(std::string name, int* i, std::string descr, double* dev) = &OrganRandomParameter::bindParameter;
 
+std::vector<Vector3d> (Organ::*getOrganNodes)() const = &Organ::getNodes;
 void (Organ::*addNode1)(Vector3d n, double t) = &Organ::addNode;
 void (Organ::*addNode2)(Vector3d n, int id, double t)= &Organ::addNode;
 std::vector<Organ*> (Organ::*getOrgans1)(int otype) = &Organ::getOrgans;
 void (Organ::*getOrgans2)(int otype, std::vector<Organ*>& v) = &Organ::getOrgans;
+double (Organ::*getParameter1)(std::string name) const = &Organ::getParameter;
+std::vector<Vector2i> (Organ::*getSegments1)() const = &Organ::getSegments;
+void (Organ::*getSegments2)(std::vector<Vector2i>& segs) const = &Organ::getSegments;
+
+std::vector<Organ*> (Organism::*getOrgans3)(int ot) const = &Organism::getOrgans;
+void (Organism::*getOrgans4)(std::vector<Organ*>& organs, int ot) const = &Organism::getOrgans;
+std::vector<std::vector<Vector3d>> (Organism::*getPolylines1)(int ot) const = &Organism::getPolylines;
+void (Organism::*getPolylines2)(std::vector<std::vector<Vector3d>>& polylines, int ot) const = &Organism::getPolylines;
+std::vector<Vector3d> (Organism::*getNodes1)() const = &Organism::getNodes;
+void (Organism::*getNodes2)(std::vector<Vector3d>& nodes) const = &Organism::getNodes;
+std::vector<double> (Organism::*getNodeCTs1)() const = &Organism::getNodeCTs;
+void (Organism::*getNodeCTs2)(std::vector<double>& cts) const = &Organism::getNodeCTs;
+std::vector<Vector2i> (Organism::*getSegments3)(int ot) const = &Organism::getSegments;
+void (Organism::*getSegments4)(std::vector<Vector2i>& segs, int ot) const = &Organism::getSegments;
+std::vector<double> (Organism::*getSegmentCTs1)(int ot) const = &Organism::getSegmentCTs;
+void (Organism::*getSegmentCTs2)(std::vector<double>& cts, int ot) const = &Organism::getSegmentCTs;
+std::vector<Organ*> (Organism::*getSegmentOrigins1)(int ot) const = &Organism::getSegmentOrigins;
+void (Organism::*getSegmentOrigins2)(std::vector<Organ*>& origins, int ot) const = &Organism::getSegmentOrigins;
+StepDelta (Organism::*getStepDelta1)(int ot) const = &Organism::getStepDelta;
+void (Organism::*getStepDelta2)(StepDelta& delta, int ot) const = &Organism::getStepDelta;
+double (Organ::*getParameter2)(int id) const = &Organ::getParameter;
 
 void (RootSystem::*simulate1)(double dt, bool silence) = &RootSystem::simulate;
 void (RootSystem::*simulate2)() = &RootSystem::simulate;
 void (RootSystem::*simulate3)(double dt, double maxinc, ProportionalElongation* f_se, bool silence) = &RootSystem::simulate;
 void (RootSystem::*initialize1)() = &RootSystem::initialize;
 void (RootSystem::*initialize2)(int basal, int shootborne) = &RootSystem::initialize;
+std::vector<int> (RootSystem::*getRootTips1)() const = &RootSystem::getRootTips;
+void (RootSystem::*getRootTips2)(std::vector<int>& tips) const = &RootSystem::getRootTips;
 
-RootRandomParameter* (RootSystem::*getRootTypeParameter1)(int subType) const = &RootSystem::getRootTypeParameter;
-std::vector<RootRandomParameter*> (RootSystem::*getRootTypeParameter2)() const = &RootSystem::getRootTypeParameter;
+RootRandomParameter* (RootSystem::*getRootTypeParameter1)(int subType) = &RootSystem::getRootTypeParameter;
+std::vector<RootRandomParameter*> (RootSystem::*getRootTypeParameter2)() = &RootSystem::getRootTypeParameter;
+int (RootRandomParameter::*getLateralType1)(const Vector3d& pos) = &RootRandomParameter::getLateralType;
 
 void (SegmentAnalyser::*addSegments1)(const Organism& plant) = &SegmentAnalyser::addSegments;
 void (SegmentAnalyser::*addSegments2)(const SegmentAnalyser& a) = &SegmentAnalyser::addSegments;
+void (RSMLReader::*rsmlRead)(std::string name) = &RSMLReader::read;
 void (SegmentAnalyser::*filter1)(std::string name, double min, double max) = &SegmentAnalyser::filter;
 void (SegmentAnalyser::*filter2)(std::string name, double value) = &SegmentAnalyser::filter;
 double (SegmentAnalyser::*getSummed1)(std::string name) const = &SegmentAnalyser::getSummed;
@@ -73,7 +112,29 @@ std::vector<double> (SegmentAnalyser::*distribution_1)(std::string name, double
 std::vector<SegmentAnalyser> (SegmentAnalyser::*distribution_2)(double top, double bot, int n) const = &SegmentAnalyser::distribution;
 std::vector<std::vector<double>> (SegmentAnalyser::*distribution2_1)(std::string name, double top, double bot, double left, double right, int n, int m, bool exact) const = &SegmentAnalyser::distribution2;
 std::vector<std::vector<SegmentAnalyser>> (SegmentAnalyser::*distribution2_2)(double top, double bot, double left, double right, int n, int m) const = &SegmentAnalyser::distribution2;
+std::vector<double> (SegmentAnalyser::*rasterize_1)(std::string name, const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z, bool exact) const = &SegmentAnalyser::rasterize;
+void (SegmentAnalyser::*rasterize_2)(std::string name, RectilinearGrid3D& grid, bool exact) const = &SegmentAnalyser::rasterize;
 SegmentAnalyser (SegmentAnalyser::*cut1)(const SDF_HalfPlane& plane) const = &SegmentAnalyser::cut;
+SegmentAnalyser (SegmentAnalyser::*cut3)(const SDF_HalfPlane& plane, const SegmentIndex& index) const = &SegmentAnalyser::cut;
+void (SegmentAnalyser::*crop1)(SignedDistanceFunction* geometry) = &SegmentAnalyser::crop;
+SegmentAnalyser (SegmentAnalyser::*crop2)(SignedDistanceFunction* geometry, const SegmentIndex& index) const = &SegmentAnalyser::crop;
+SegmentAnalyser (SegmentAnalyser::*foto1)(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height) const = &SegmentAnalyser::foto;
+SegmentAnalyser (SegmentAnalyser::*foto2)(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height, const SegmentIndex& index) const = &SegmentAnalyser::foto;
+std::vector<double> (SignedDistanceFunction::*getDists1)(const std::vector<Vector3d>& points) const = &SignedDistanceFunction::getDists;
+std::vector<double> (SoilLookUp::*getValues1)(const std::vector<Vector3d>& pos) const = &SoilLookUp::getValues;
+double (RectilinearGrid3D::*getValue3D)(const Vector3d& pos, const Organ* o) const = &RectilinearGrid3D::getValue;
+SegmentQuery& (SegmentQuery::*queryFilter1)(std::string name, double min, double max) = &SegmentQuery::filter;
+SegmentQuery& (SegmentQuery::*queryFilter2)(std::string name, double value) = &SegmentQuery::filter;
+SegmentView& (SegmentView::*viewFilter1)(std::string name, double min, double max) = &SegmentView::filter;
+SegmentView& (SegmentView::*viewFilter2)(std::string name, double value) = &SegmentView::filter;
+double (SegmentView::*viewGetSummed1)(std::string name) const = &SegmentView::getSummed;
+double (SegmentView::*viewGetSummed2)(std::string name, SignedDistanceFunction* geometry) const = &SegmentView::getSummed;
+void (SegmentStore::*storeAddSegments1)(const Organism& plant) = &SegmentStore::addSegments;
+void (SegmentStore::*storeAddSegments2)(const SegmentAnalyser& a) = &SegmentStore::addSegments;
+double (SegmentStore::*storeGetSummed1)(std::string name) const = &SegmentStore::getSummed;
+double (SegmentStore::*storeGetSummed2)(std::string name, SignedDistanceFunction* geometry) const = &SegmentStore::getSummed;
+void (SegmentStore::*storeFilter1)(std::string name, double min, double max, SegmentStore& out) const = &SegmentStore::filter;
+void (SegmentStore::*storeFilter2)(std::string name, double value, SegmentStore& out) const = &SegmentStore::filter;
 
 /**
  * Default arguments: no idea how to do it by hand, magic everywhere...
@@ -91,16 +152,65 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(getNewSegments_overloads, getNewSegments,
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(getNewSegmentOrigins_overloads, getNewSegmentOrigins, 0, 1);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(openFile_overloads,openFile,1,2);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(simulate1_overloads,simulate,1,2);
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(simulate3_overloads,simulate,3,4);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(getValue_overloads,getValue,1,2);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(tropismObjective_overloads,tropismObjective,5,6);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(getNumberOfRoots_overloads,getNumberOfRoots,0,1);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(toString_overloads, toString, 0, 1);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(getAnalyser_overloads, getAnalyser, 0, 1);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(writeVTP_overloads, writeVTP, 1, 2);
 // BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(bindParameter_overloads, bindParameter, 2, 4);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(readParameters_overloads, readParameters, 1, 2);
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(writeParameters_overloads, writeParameters, 1, 3);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(setDistribution_overloads, setDistribution, 4, 5);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(init_overloads, init, 0, 1);
 
 
+/**
+ * The global interpreter lock (GIL) is released during long running calls (simulation, analysis, and file output),
+ * so Python threads can simulate different organisms at the same time. The GIL is acquired again for each call back into
+ * Python (e.g. the methods of a SoilLookUp or Doussan that is derived in Python).
+ *
+ * The released calls follow the thread safety of the C++ classes: different objects can be used by different threads
+ * concurrently, a single object (and the objects it holds, e.g. its geometry or soil) must only be used by one thread at a time.
+ */
+class ReleaseGIL { // releases the GIL, within its scope
+public:
+    ReleaseGIL(): state(PyEval_SaveThread()) { }
+    ~ReleaseGIL() { PyEval_RestoreThread(state); }
+private:
+    PyThreadState* state;
+};
+
+class AcquireGIL { // acquires the GIL within its scope, in any thread, with or without the GIL
+public:
+    AcquireGIL(): state(PyGILState_Ensure()) { }
+    ~AcquireGIL() { PyGILState_Release(state); }
+private:
+    PyGILState_STATE state;
+};
+
+/* calls the member function f without the GIL */
+template<class F, F f> struct WithoutGIL;
+template<class R, class C, class... A, R (C::*f)(A...)>
+struct WithoutGIL<R (C::*)(A...), f> {
+    static R call(C& c, A... a) { ReleaseGIL unlocked; return (c.*f)(a...); }
+};
+template<class R, class C, class... A, R (C::*f)(A...) const>
+struct WithoutGIL<R (C::*)(A...) const, f> {
+    static R call(const C& c, A... a) { ReleaseGIL unlocked; return (c.*f)(a...); }
+};
+#define WITHOUT_GIL(type, f) &WithoutGIL<type, f>::call
+
+SegmentAnalyser* createAnalyser(const Organism& plant) { ReleaseGIL unlocked; return new SegmentAnalyser(plant); }
+SegmentAnalyser* getStoreChunk(const SegmentStore& s, int i) { SegmentAnalyser* a = new SegmentAnalyser(); *a = s.getChunk(i); return a; } // assignment keeps the user data
+SegmentAnalyser* loadStore(const SegmentStore& s) { ReleaseGIL unlocked; SegmentAnalyser* a = new SegmentAnalyser(); *a = s.load(); return a; }
+RSMLReader* createRSMLReader(std::string name) { ReleaseGIL unlocked; return new RSMLReader(name); }
+std::vector<double> tropismObjectives(Tropism& t, const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx) {
+    std::vector<double> v;
+    t.tropismObjectives(pos, old, trials, dx, nullptr, v);
+    return v;
+} // batch evaluation without an organ
+
 /**
  * Virtual functions
  */
@@ -108,15 +218,268 @@ class SoilLookUp_Wrap : public SoilLookUp, public wrapper<SoilLookUp> {
 public:
 
     virtual double getValue(const Vector3d& pos, const Organ* o = nullptr) const override {
+        AcquireGIL locked;
         return this->get_override("getValue")(pos, o);
     }
 
     virtual std::string toString() const override {
+        AcquireGIL locked;
         return this->get_override("toString")();
     }
 
+    virtual bool getCellBounds(const Vector3d& p, Vector3d& lo, Vector3d& hi) const override {
+        AcquireGIL locked;
+        if (override f = this->get_override("getCellBounds")) { // returns (lo, hi), or None
+            object r = f(p);
+            if (r.is_none()) {
+                return false;
+            }
+            lo = extract<Vector3d>(r[0]);
+            hi = extract<Vector3d>(r[1]);
+            return true;
+        }
+        return false;
+    }
+
+};
+
+class GeometryVisitor_Wrap : public GeometryVisitor, public wrapper<GeometryVisitor> {
+public:
+
+    virtual void visitNode(int i, const Vector3d& n, double ct) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("visitNode")) {
+            f(i, n, ct);
+        }
+    }
+
+    virtual bool visitOrgan(const Organ* o) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("visitOrgan")) {
+            return f(ptr(const_cast<Organ*>(o)));
+        }
+        return true;
+    }
+
+    virtual void visitSegment(const Vector2i& s, double ct, const Organ* o) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("visitSegment")) {
+            f(s, ct, ptr(const_cast<Organ*>(o)));
+        }
+    }
+
+};
+
+class StepDeltaSink_Wrap : public StepDeltaSink, public wrapper<StepDeltaSink> {
+public:
+
+    virtual void newNode(int i, const Vector3d& n, double ct) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("newNode")) {
+            f(i, n, ct);
+        }
+    }
+
+    virtual void updatedNode(int i, const Vector3d& n, double ct) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("updatedNode")) {
+            f(i, n, ct);
+        }
+    }
+
+    virtual void newSegment(const Vector2i& s, Organ* o) override {
+        AcquireGIL locked;
+        if (override f = this->get_override("newSegment")) {
+            f(s, ptr(o));
+        }
+    }
+
+};
+
+class Doussan_Wrap : public Doussan, public wrapper<Doussan> {
+public:
+
+    Doussan_Wrap(const Organism& plant, SoilLookUp* soil): Doussan(plant, soil) { }
+
+    virtual double radialConductivity(int ot, int subType, double age) const override {
+        {
+            AcquireGIL locked;
+            if (override f = this->get_override("radialConductivity")) {
+                return f(ot, subType, age);
+            }
+        }
+        return Doussan::radialConductivity(ot, subType, age);
+    }
+    double default_radialConductivity(int ot, int subType, double age) const { return Doussan::radialConductivity(ot, subType, age); }
+
+    virtual double axialConductivity(int ot, int subType, double age) const override {
+        {
+            AcquireGIL locked;
+            if (override f = this->get_override("axialConductivity")) {
+                return f(ot, subType, age);
+            }
+        }
+        return Doussan::axialConductivity(ot, subType, age);
+    }
+    double default_axialConductivity(int ot, int subType, double age) const { return Doussan::axialConductivity(ot, subType, age); }
+
+    virtual bool overwritesConductivities() const override { // only, if a Python subclass defines the conductivities
+        AcquireGIL locked;
+        return bool(this->get_override("radialConductivity")) || bool(this->get_override("axialConductivity"));
+    }
+
+};
+
+/**
+ * Contiguous arrays exposed with the Python buffer protocol, numpy.asarray(a) (or memoryview(a)) uses the memory
+ * of the array without copying, and without a call per element (unlike the vector_indexing_suite wrappers).
+ *
+ * The array owns its elements (they are moved from the result of the C++ method), and lives at least as long as any view.
+ * Vectors of Vector3d are 2d arrays with 3 columns, vectors of Vector2i with 2 columns.
+ */
+class ArrayBuffer {
+public:
+
+    ArrayBuffer(std::vector<double>&& v) { set(std::move(v), "d", 1); }
+    ArrayBuffer(std::vector<int>&& v) { set(std::move(v), "i", 1); }
+    ArrayBuffer(std::vector<Vector3d>&& v) { set(std::move(v), "d", 3); }
+    ArrayBuffer(std::vector<Vector2i>&& v) { set(std::move(v), "i", 2); }
+
+    int getBuffer(Py_buffer* view, int flags);
+    ///< fills the buffer view (the exporter and its reference count are set by the caller)
+
+    tuple getShape() const { return (ndim==1) ? make_tuple(shape[0]) : make_tuple(shape[0], shape[1]); }
+    int getLength() const { return shape[0]; }
+    std::string getFormat() const { return format; }
+
+protected:
+
+    template<class T>
+    void set(std::vector<T>&& v, const char* f, int columns) {
+        static_assert(sizeof(Vector3d)==3*sizeof(double) && sizeof(Vector2i)==2*sizeof(int), "ArrayBuffer: unexpected padding");
+        auto p = std::make_shared<std::vector<T>>(std::move(v));
+        owner = p;
+        data = (char*)p->data();
+        format = f;
+        itemsize = (format=="d") ? sizeof(double) : sizeof(int);
+        shape[0] = p->size();
+        shape[1] = columns;
+        ndim = (columns>1) ? 2 : 1;
+        strides[0] = columns*itemsize;
+        strides[1] = itemsize;
+    }
+
+    std::shared_ptr<void> owner; ///< the moved vector
+    char* data = nullptr;
+    std::string format;
+    Py_ssize_t itemsize = 0;
+    int ndim = 1;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+
 };
 
+int ArrayBuffer::getBuffer(Py_buffer* view, int flags)
+{
+    view->buf = data;
+    view->len = shape[0]*shape[1]*itemsize;
+    view->readonly = 0;
+    view->itemsize = itemsize;
+    view->format = ((flags & PyBUF_FORMAT)==PyBUF_FORMAT) ? (char*)format.c_str() : nullptr;
+    view->ndim = ndim;
+    view->shape = ((flags & PyBUF_ND)==PyBUF_ND) ? shape : nullptr;
+    view->strides = ((flags & PyBUF_STRIDES)==PyBUF_STRIDES) ? strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+/* buffer protocol of the Python class ArrayBuffer */
+int getArrayBuffer(PyObject* exporter, Py_buffer* view, int flags)
+{
+    extract<ArrayBuffer&> a(exporter);
+    if (!a.check()) {
+        PyErr_SetString(PyExc_BufferError, "ArrayBuffer: not an array");
+        view->obj = nullptr;
+        return -1;
+    }
+    view->obj = exporter;
+    Py_INCREF(exporter);
+    return a().getBuffer(view, flags);
+}
+PyBufferProcs arrayBufferProcs = { &getArrayBuffer, nullptr };
+
+/* array versions of the geometry and parameter accessors */
+ArrayBuffer getNodeArray(const Organism& o) { return ArrayBuffer(o.getNodes()); }
+ArrayBuffer getNodeCTArray(const Organism& o) { return ArrayBuffer(o.getNodeCTs()); }
+ArrayBuffer getSegmentArray(const Organism& o, int ot) { return ArrayBuffer(o.getSegments(ot)); }
+ArrayBuffer getSegmentCTArray(const Organism& o, int ot) { return ArrayBuffer(o.getSegmentCTs(ot)); }
+ArrayBuffer getParameterArray(const Organism& o, std::string name, int ot) { return ArrayBuffer(o.getParameter(name, ot)); }
+ArrayBuffer getAnalyserNodeArray(const SegmentAnalyser& a) { return ArrayBuffer(std::vector<Vector3d>(a.nodes)); }
+ArrayBuffer getAnalyserSegmentArray(const SegmentAnalyser& a) { return ArrayBuffer(std::vector<Vector2i>(a.segments)); }
+ArrayBuffer getAnalyserSegmentCTArray(const SegmentAnalyser& a) { return ArrayBuffer(std::vector<double>(a.segCTs)); }
+ArrayBuffer getAnalyserParameterArray(const SegmentAnalyser& a, std::string name) { return ArrayBuffer(a.getParameter(name)); }
+
+/**
+ * A writable view of a Python object with the buffer protocol (e.g. a contiguous numpy array of float64) holding n doubles.
+ * The view is held until it is deleted, meanwhile the object cannot be resized (e.g. a bytearray, or an array.array).
+ */
+class FieldView {
+public:
+    FieldView(object o, size_t n) {
+        if (PyObject_GetBuffer(o.ptr(), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE)!=0) {
+            throw_error_already_set();
+        }
+        std::string f = (view.format!=nullptr) ? view.format : "B";
+        if ((view.itemsize!=sizeof(double)) || (f.back()!='d') || (view.len!=Py_ssize_t(n*sizeof(double)))) {
+            PyBuffer_Release(&view);
+            std::cout << "RectilinearGrid3D::bindField: the field must be a contiguous array of " << n << " doubles\n" << std::flush;
+            throw std::invalid_argument("RectilinearGrid3D::bindField: the field must be a contiguous array of doubles of the size of the data");
+        }
+    }
+    ~FieldView() { PyBuffer_Release(&view); }
+    double* data() const { return (double*)view.buf; }
+private:
+    FieldView(const FieldView&) = delete;
+    FieldView& operator=(const FieldView&) = delete;
+    Py_buffer view;
+};
+
+/* the view as Python object, that releases the view when it is deleted */
+object fieldViewObject(FieldView* v) {
+    PyObject* c = PyCapsule_New(v, nullptr, [](PyObject* c) { delete (FieldView*)PyCapsule_GetPointer(c, nullptr); });
+    if (c==nullptr) {
+        delete v;
+        throw_error_already_set();
+    }
+    return object(handle<>(c));
+}
+
+/*
+ * zero copy fields of grids, the views of the bound fields are held by the Python grid (attribute _fields), and are
+ * replaced by the next binding, or released by unbindField
+ */
+void bindGridField(object self, object a) {
+    RectilinearGrid3D& g = extract<RectilinearGrid3D&>(self);
+    object v = fieldViewObject(new FieldView(a, g.data.size()));
+    g.bindField(((FieldView*)PyCapsule_GetPointer(v.ptr(), nullptr))->data(), g.data.size());
+    setattr(self, "_fields", make_tuple(v)); // releases the views of the previous binding
+}
+void bindGridFields(object self, object front, object back) {
+    RectilinearGrid3D& g = extract<RectilinearGrid3D&>(self);
+    object f = fieldViewObject(new FieldView(front, g.data.size()));
+    object b = fieldViewObject(new FieldView(back, g.data.size()));
+    g.bindFields(((FieldView*)PyCapsule_GetPointer(f.ptr(), nullptr))->data(), ((FieldView*)PyCapsule_GetPointer(b.ptr(), nullptr))->data(),
+        g.data.size());
+    setattr(self, "_fields", make_tuple(f, b));
+}
+void unbindGridField(object self) {
+    RectilinearGrid3D& g = extract<RectilinearGrid3D&>(self);
+    g.unbindField();
+    setattr(self, "_fields", object());
+}
+bool isFrontGridField(const RectilinearGrid3D& g, object a) { FieldView v(a, g.data.size()); return v.data()==g.getField(); }
+
 //class Tropism_Wrap : public Tropism, public wrapper<Tropism> {
 //public:
 //
@@ -146,6 +509,15 @@ BOOST_PYTHON_MODULE(py_rootbox)
     class_<std::vector<int>>("std_vector_int_")
         .def(vector_indexing_suite<std::vector<int>>() )
         ;
+    object arrayBuffer = class_<ArrayBuffer>("ArrayBuffer", no_init) // use numpy.asarray
+        .add_property("shape", &ArrayBuffer::getShape)
+        .add_property("format", &ArrayBuffer::getFormat)
+        .def("__len__", &ArrayBuffer::getLength)
+        ;
+    ((PyTypeObject*)arrayBuffer.ptr())->tp_as_buffer = &arrayBufferProcs;
+    class_<std::vector<std::string>>("std_vector_string_")
+        .def(vector_indexing_suite<std::vector<std::string>>() )
+        ;
     /*
      * mymath.h
      */
@@ -159,12 +531,21 @@ BOOST_PYTHON_MODULE(py_rootbox)
     class_<std::vector<Vector2i>>("std_vector_Vector2i_")
         .def(vector_indexing_suite<std::vector<Vector2i>>() )
         ;
+    class_<Vector2d>("Vector2d", init<>())
+        .def(init<double,double>())
+        .def(init<Vector2d&>())
+        .def_readwrite("x",&Vector2d::x)
+        .def_readwrite("y",&Vector2d::y)
+        .def("__str__",&Vector2d::toString)
+        ;
     class_<Vector3d>("Vector3d", init<>())
         .def(init<double,double,double>())
         .def(init<Vector3d&>())
         .def_readwrite("x",&Vector3d::x)
         .def_readwrite("y",&Vector3d::y)
         .def_readwrite("z",&Vector3d::z)
+        .def("rotAB",rotAB1)
+        .staticmethod("rotAB")
         .def("normalize",&Vector3d::normalize)
         .def("times",times1)
         .def("times",times2)
@@ -188,13 +569,15 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def("rotX",&Matrix3d::rotX)
         .def("rotY",&Matrix3d::rotY)
         .def("rotZ",&Matrix3d::rotZ)
-        .def("ons",&Matrix3d::ons)
+        .def("ons",ons1)
         .def("det",&Matrix3d::det)
         .def("inverse",&Matrix3d::inverse)
         .def("column",&Matrix3d::column)
         .def("row",&Matrix3d::row)
         .def("times",times3)
         .def("times",times4)
+        .def("timesRotAB",&Matrix3d::timesRotAB)
+        .def("step",&Matrix3d::step)
         .def("__str__",&Matrix3d::toString)
         .def("__rep__",&Matrix3d::toString)
         ;
@@ -203,6 +586,7 @@ BOOST_PYTHON_MODULE(py_rootbox)
      */
     class_<SignedDistanceFunction, SignedDistanceFunction*>("SignedDistanceFunction")
         .def("getDist",&SignedDistanceFunction::getDist)
+        .def("getDists",getDists1)
         .def("writePVPScript", writePVPScript)
         .def("__str__",&SignedDistanceFunction::toString)
         ;
@@ -247,6 +631,20 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def("getDist",&SDF_Complement::getDist)
         .def("__str__",&SDF_Complement::toString)
         ;
+    class_<SDF_Compiled, bases<SignedDistanceFunction>>("SDF_Compiled",init<SignedDistanceFunction*>())
+        .def("getDist",&SDF_Compiled::getDist)
+        .def("recompile",&SDF_Compiled::recompile)
+        .def("getNumberOfInstructions",&SDF_Compiled::getNumberOfInstructions)
+        .def("__str__",&SDF_Compiled::toString)
+        ;
+    class_<SDF_Cached, bases<SignedDistanceFunction>>("SDF_Cached",init<SignedDistanceFunction*, Vector3d&, Vector3d&, optional<double, double, size_t>>())
+        .def("getDist",&SDF_Cached::getDist)
+        .def("rebuild",&SDF_Cached::rebuild)
+        .def("getNumberOfBricks",&SDF_Cached::getNumberOfBricks)
+        .def("getMemory",&SDF_Cached::getMemory)
+        .def("isComplete",&SDF_Cached::isComplete)
+        .def("__str__",&SDF_Cached::toString)
+        ;
     class_<SDF_HalfPlane, bases<SignedDistanceFunction>>("SDF_HalfPlane",init<Vector3d&,Vector3d&>())
         .def(init<Vector3d&,Vector3d&,Vector3d&>())
         .def("getDist",&SDF_HalfPlane::getDist)
@@ -261,10 +659,16 @@ BOOST_PYTHON_MODULE(py_rootbox)
      */
     class_<SoilLookUp_Wrap, SoilLookUp_Wrap*, boost::noncopyable>("SoilLookUp",init<>())
         .def("getValue",&SoilLookUp_Wrap::getValue)
+        .def("getValues",getValues1)
+        .def("setCaching",&SoilLookUp::setCaching)
+        .def("getCaching",&SoilLookUp::getCaching)
+        .def("changed",&SoilLookUp::changed)
+        .def("getVersion",&SoilLookUp::getVersion)
         .def("__str__",&SoilLookUp_Wrap::toString)
         ;
     class_<SoilLookUpSDF, SoilLookUpSDF*, bases<SoilLookUp>>("SoilLookUpSDF",init<>())
         .def(init<SignedDistanceFunction*, double, double, double>())
+        .def("getValue", &SoilLookUpSDF::getValue, getValue_overloads())
         .def_readwrite("sdf", &SoilLookUpSDF::sdf)
         .def_readwrite("fmax", &SoilLookUpSDF::fmax)
         .def_readwrite("fmin", &SoilLookUpSDF::fmin)
@@ -300,6 +704,32 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def_readwrite("data", &EquidistantGrid1D::data)
         .def("__str__",&EquidistantGrid1D::toString)
         ;
+    class_<RectilinearGrid3D, RectilinearGrid3D*, bases<SoilLookUp>>("RectilinearGrid3D", no_init)
+        .def("getValue", getValue3D, getValue_overloads())
+        .def("getData", &RectilinearGrid3D::getData)
+        .def("setData", &RectilinearGrid3D::setData)
+        .def("index", &RectilinearGrid3D::index)
+        .def("setInterpolation", &RectilinearGrid3D::setInterpolation)
+        .def("getInterpolation", &RectilinearGrid3D::getInterpolation)
+        .def("setBlocked", &RectilinearGrid3D::setBlocked)
+        .def("getBlocked", &RectilinearGrid3D::getBlocked)
+        .def("update", &RectilinearGrid3D::update)
+        .def("getGridPoint", &RectilinearGrid3D::getGridPoint)
+        .def("bindField", &bindGridField)
+        .def("bindFields", &bindGridFields)
+        .def("swapFields", &RectilinearGrid3D::swapFields)
+        .def("unbindField", &unbindGridField)
+        .def("isBound", &RectilinearGrid3D::isBound)
+        .def("isFrontField", &isFrontGridField)
+        .def_readonly("nx", &RectilinearGrid3D::nx)
+        .def_readonly("ny", &RectilinearGrid3D::ny)
+        .def_readonly("nz", &RectilinearGrid3D::nz)
+        .def_readwrite("data", &RectilinearGrid3D::data)
+        .def("__str__",&RectilinearGrid3D::toString)
+        ;
+    class_<EquidistantGrid3D, EquidistantGrid3D*, bases<RectilinearGrid3D>, boost::noncopyable>("EquidistantGrid3D", init<double, double, double, int, int, int>())
+        .def(init<double, double, int, double, double, int, double, double, int>())
+        ;
     /*
      * organparameter.h
      */
@@ -309,8 +739,9 @@ BOOST_PYTHON_MODULE(py_rootbox)
         ;
     class_<OrganRandomParameter, OrganRandomParameter*>("OrganRandomParameter", init<Organism*>())
         .def("copy",&OrganRandomParameter::copy, return_value_policy<reference_existing_object>())
-        .def("realize",&OrganRandomParameter::realize, return_value_policy<reference_existing_object>())
+        .def("realize",realize1, return_value_policy<reference_existing_object>())
         .def("getParameter",&OrganRandomParameter::getParameter)
+        .def("setParameter",&OrganRandomParameter::setParameter)
         .def("writeXML",writeXML1)
         .def("readXML",readXML1)
 //        .def("bindIntParameter",bindIntParameter, bindParameter_overloads()) // not working, can't pass int*
@@ -340,28 +771,74 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def("getOrganRandomParameter",&Organ::getOrganRandomParameter, return_value_policy<reference_existing_object>())
         .def("isAlive",&Organ::isAlive)
         .def("isActive",&Organ::isActive)
+        .def("isFinished",&Organ::isFinished)
+        .def("isDormant",&Organ::isDormant)
+        .def("getWakeTime",&Organ::getWakeTime)
         .def("getAge",&Organ::getAge)
         .def("getLength",&Organ::getLength)
         .def("getNumberOfNodes",&Organ::getNumberOfNodes)
         .def("getNode",&Organ::getNode)
         .def("getNodeId",&Organ::getNodeId)
         .def("getNodeCT",&Organ::getNodeCT)
+        .def("getNodes",getOrganNodes)
+        .def("getNodeMemory",&Organ::getNodeMemory)
         .def("addNode",addNode1)
         .def("addNode",addNode2)
-        .def("getSegments",&Organ::getSegments)
+        .def("getNumberOfChildren",&Organ::getNumberOfChildren)
+        .def("getChild",&Organ::getChild, return_value_policy<reference_existing_object>())
+        .def("getSegments",getSegments1)
+        .def("getSegments",getSegments2)
         .def("hasMoved",&Organ::hasMoved)
         .def("getOldNumberOfNodes",&Organ::getOldNumberOfNodes)
         .def("getOrgans", getOrgans1, getOrgans_overloads())
         .def("getOrgans", getOrgans2)
-        .def("getParameter",&Organ::getParameter)
+        .def("getParameter",getParameter1)
+        .def("getParameter",getParameter2)
+        .def("getParameters",&Organ::getParameters)
+        .staticmethod("getParameters")
+        .def("parameterId",&Organ::parameterId)
+        .staticmethod("parameterId")
+        .def("parameterName",&Organ::parameterName)
+        .staticmethod("parameterName")
         .def("__str__",&Organ::toString)
         ;
     class_<std::vector<Organ*>>("std_vector_Organ_")
         .def(vector_indexing_suite<std::vector<Organ*>>() )
         ;
+    /*
+     * instrumentation.h
+     */
+    class_<Instrumentation, boost::noncopyable>("Instrumentation", no_init)
+        .def("setEnabled", &Instrumentation::setEnabled)
+        .def("isEnabled", &Instrumentation::isEnabled)
+        .def("clear", &Instrumentation::clear)
+        .def("getCount", &Instrumentation::getCount, (arg("self"), arg("name"), arg("ot")=-1))
+        .def("getTime", &Instrumentation::getTime, (arg("self"), arg("name"), arg("ot")=-1))
+        .def_readonly("counterNames", &Instrumentation::counterNames)
+        .def_readonly("phaseNames", &Instrumentation::phaseNames)
+        .def("__str__",&Instrumentation::toString)
+        ;
     /*
      * Organism.h
      */
+    class_<GeometryVisitor_Wrap, boost::noncopyable>("GeometryVisitor", init<>())
+        ;
+    class_<StepDeltaSink_Wrap, boost::noncopyable>("StepDeltaSink", init<>())
+        .def("newNode", &StepDeltaSink::newNode)
+        .def("updatedNode", &StepDeltaSink::updatedNode)
+        .def("newSegment", &StepDeltaSink::newSegment)
+        ;
+    class_<StepDelta>("StepDelta", init<>())
+        .def_readonly("numberOfNewNodes", &StepDelta::numberOfNewNodes)
+        .def_readonly("numberOfNewOrgans", &StepDelta::numberOfNewOrgans)
+        .def_readonly("newNodes", &StepDelta::newNodes)
+        .def_readonly("newNodeCTs", &StepDelta::newNodeCTs)
+        .def_readonly("updatedNodeIndices", &StepDelta::updatedNodeIndices)
+        .def_readonly("updatedNodes", &StepDelta::updatedNodes)
+        .def_readonly("updatedNodeCTs", &StepDelta::updatedNodeCTs)
+        .def_readonly("newSegments", &StepDelta::newSegments)
+        .def_readonly("newSegmentOrigins", &StepDelta::newSegmentOrigins)
+        ;
     class_<Organism, Organism*>("Organism", init<>())
         .def(init<Organism&>())
         .def("organTypeNumber", &Organism::organTypeNumber)
@@ -371,24 +848,54 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def("setOrganRandomParameter", &Organism::setOrganRandomParameter)
 
         .def("addOrgan", &Organism::addOrgan)
-        .def("initialize", &Organism::initialize)
-        .def("simulate", &Organism::simulate, simulate1_overloads())
+        .def("initialize", WITHOUT_GIL(void (Organism::*)(), &Organism::initialize))
+        .def("simulate", WITHOUT_GIL(void (Organism::*)(double, bool), &Organism::simulate), (arg("self"), arg("dt"), arg("verbose")=false))
         .def("getSimTime", &Organism::getSimTime)
+        .def("setNumberOfThreads", &Organism::setNumberOfThreads)
+        .def("getNumberOfThreads", &Organism::getNumberOfThreads)
+        .def("getInstrumentation", (Instrumentation& (Organism::*)())&Organism::getInstrumentation, return_internal_reference<>())
 
-        .def("getOrgans", &Organism::getOrgans, getOrgans_overloads())
+        .def("getOrgans", getOrgans3, getOrgans_overloads())
+        .def("getOrgans", getOrgans4, (arg("self"), arg("organs"), arg("ot")=-1))
+        .def("getOrganList", &Organism::getOrganList, return_value_policy<copy_const_reference>())
+        .def("getOrganListVersion", &Organism::getOrganListVersion)
         .def("getParameter", &Organism::getParameter, getParameter_overloads())
         .def("getSummed", &Organism::getSummed, getSummed_overloads())
 
         .def("getNumberOfOrgans", &Organism::getNumberOfOrgans)
         .def("getNumberOfNodes", &Organism::getNumberOfNodes)
+        .def("setStoragePrecision", &Organism::setStoragePrecision, (arg("self"), arg("p"), arg("resolution")=1.e-4, arg("origin")=Vector3d()))
+        .def("getStoragePrecision", &Organism::getStoragePrecision)
+        .def("setNodePacking", &Organism::setNodePacking, (arg("self"), arg("pack"), arg("resolution")=1.e-4, arg("timeResolution")=1.e-6))
+        .def("getNodePacking", &Organism::getNodePacking)
+        .def("setElongationScales", &Organism::setElongationScales)
+        .def("getElongationScales", &Organism::getElongationScales, return_value_policy<copy_const_reference>())
+        .def("getOrganNodeMemory", &Organism::getOrganNodeMemory)
+        .def("getNodeMemory", &Organism::getNodeMemory)
         .def("getNumberOfSegments", &Organism::getNumberOfSegments, getNumberOfSegments_overloads())
-        .def("getPolylines", &Organism::getPolylines, getPolylines_overloads())
+        .def("getPolylines", getPolylines1, getPolylines_overloads())
+        .def("getPolylines", getPolylines2, (arg("self"), arg("polylines"), arg("ot")=-1))
         .def("getPolylineCTs", &Organism::getPolylineCTs, getPolylineCTs_overloads())
-        .def("getNodes", &Organism::getNodes)
-        .def("getNodeCTs", &Organism::getNodeCTs)
-        .def("getSegments", &Organism::getSegments, getSegments_overloads())
-        .def("getSegmentCTs", &Organism::getSegmentCTs, getSegmentCTs_overloads())
-        .def("getSegmentOrigins", &Organism::getSegmentOrigins,  getSegmentOrigins_overloads())
+        .def("getNodes", getNodes1)
+        .def("getNodes", getNodes2)
+        .def("getNodeCTs", getNodeCTs1)
+        .def("getNodeCTs", getNodeCTs2)
+        .def("getSegments", getSegments3, getSegments_overloads())
+        .def("getSegments", getSegments4, (arg("self"), arg("segs"), arg("ot")=-1))
+        .def("getSegmentCTs", getSegmentCTs1, getSegmentCTs_overloads())
+        .def("getSegmentCTs", getSegmentCTs2, (arg("self"), arg("cts"), arg("ot")=-1))
+        .def("getSegmentOrigins", getSegmentOrigins1,  getSegmentOrigins_overloads())
+        .def("getSegmentOrigins", getSegmentOrigins2, (arg("self"), arg("origins"), arg("ot")=-1))
+        .def("visit", &Organism::visit, (arg("self"), arg("visitor"), arg("ot")=-1))
+        .def("getNodeArray", &getNodeArray)
+        .def("getNodeCTArray", &getNodeCTArray)
+        .def("getSegmentArray", &getSegmentArray, (arg("self"), arg("ot")=-1))
+        .def("getSegmentCTArray", &getSegmentCTArray, (arg("self"), arg("ot")=-1))
+        .def("getParameterArray", &getParameterArray, (arg("self"), arg("name"), arg("ot")=-1))
+        .def("getCachedNodes", &Organism::getCachedNodes, return_value_policy<copy_const_reference>())
+        .def("getCachedSegments", &Organism::getCachedSegments, return_value_policy<copy_const_reference>())
+        .def("getCachedSegmentCTs", &Organism::getCachedSegmentCTs, return_value_policy<copy_const_reference>())
+        .def("getCachedSegmentOrigins", &Organism::getCachedSegmentOrigins, return_value_policy<copy_const_reference>())
 
         .def("getNumberOfNewNodes", &Organism::getNumberOfNewNodes)
         .def("getNumberOfNewOrgans", &Organism::getNumberOfNewOrgans)
@@ -400,18 +907,26 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def("getNewNodeCTs", &Organism::getNewNodeCTs)
         .def("getNewSegments", &Organism::getNewSegments,  getNewSegments_overloads())
         .def("getNewSegmentOrigins", &Organism::getNewSegmentOrigins,  getNewSegmentOrigins_overloads())
+        .def("getStepDelta", getStepDelta1, (arg("self"), arg("ot")=-1))
+        .def("getStepDelta", getStepDelta2, (arg("self"), arg("delta"), arg("ot")=-1))
+        .def("visitStepDelta", &Organism::visitStepDelta, (arg("self"), arg("sink"), arg("ot")=-1))
 
         .def("readParameters", &Organism::readParameters, readParameters_overloads())
         .def("writeParameters", &Organism::writeParameters, writeParameters_overloads())
-        .def("writeRSML", &Organism::writeRSML)
+        .def("writeRSML", WITHOUT_GIL(void (Organism::*)(std::string) const, &Organism::writeRSML))
         .def("getRSMLSkip", &Organism::getRSMLSkip)
         .def("setRSMLSkip", &Organism::setRSMLSkip)
         .def("getRSMLProperties", &Organism::getRSMLProperties, return_value_policy<copy_non_const_reference>())
+        .def("save", WITHOUT_GIL(void (Organism::*)(std::string) const, &Organism::save))
+        .def("load", WITHOUT_GIL(void (Organism::*)(std::string), &Organism::load))
 
         .def("getOrganIndex", &Organism::getOrganIndex)
         .def("getNodeIndex", &Organism::getNodeIndex)
 
         .def("setSeed", &Organism::setSeed)
+        .def("getSeed", &Organism::getSeed)
+        .def("setOrganStreams", &Organism::setOrganStreams)
+        .def("hasOrganStreams", &Organism::hasOrganStreams)
         .def("rand", &Organism::rand)
         .def("randn", &Organism::randn)
         .def("__str__",&Organism::toString)
@@ -430,6 +945,10 @@ BOOST_PYTHON_MODULE(py_rootbox)
         .def(init<Root&, double>())
         .def(init<RootSystem&, double>())
         .def("getDist",&SDF_RootSystem::getDist)
+        .def("update",&SDF_RootSystem::update)
+        .def("getSegmentsInRadius",&SDF_RootSystem::getSegmentsInRadius)
+        .def("getNearestSegments",&SDF_RootSystem::getNearestSegments)
+        .def("getSegmentDist",&SDF_RootSystem::getSegmentDist)
         .def("__str__",&SDF_RootSystem::toString)
     ;
     /**
@@ -442,10 +961,17 @@ BOOST_PYTHON_MODULE(py_rootbox)
 //                .def("setTropismParameter",&Tropism_Wrap::setTropismParameter)
 //                .def("setGeometry",&Tropism_Wrap::setGeometry) // todo dont know how that works
                 ;
+    class_<TropismTrials>("TropismTrials", init<>())
+                .def("add",&TropismTrials::add)
+                .def("clear",&TropismTrials::clear)
+                .def("update",&TropismTrials::update)
+                .def("size",&TropismTrials::size)
+                ;
     class_<Tropism, Tropism*>("TropismBase",init<Organism*>()) // Base class for the following tropisms
                 .def(init<Organism*, double, double>())
                 .def("getHeading",&Tropism::getHeading)
                 .def("tropismObjective",&Tropism::tropismObjective, tropismObjective_overloads())
+                .def("tropismObjectives",&tropismObjectives)
                 .def("copy",&Tropism::copy, return_value_policy<reference_existing_object>())
                 .def("setTropismParameter",&Tropism::setTropismParameter)
                 .def("setGeometry",&Tropism::setGeometry)
@@ -459,47 +985,179 @@ BOOST_PYTHON_MODULE(py_rootbox)
         ;
     class_<Hydrotropism, Hydrotropism*, bases<Tropism>>("Hydrotropism",init<Organism*,double, double, SoilLookUp*>())
         ;
-    //	class_<CombinedTropism, CombinedTropism*, bases<Tropism>>("CombinedTropism",init<>()) // Todo needs some extra work
-    //	;
+    class_<HydroGravitropism, HydroGravitropism*, bases<Tropism>>("HydroGravitropism",init<Organism*,double, double, SoilLookUp*, optional<double, double>>())
+        ;
+    class_<CombinedTropism, CombinedTropism*, bases<Tropism>>("CombinedTropism",
+        init<Organism*, double, double, Tropism*, double, Tropism*, double>()[with_custodian_and_ward<1,5, with_custodian_and_ward<1,7>>()])
+        ; // the two tropisms are kept alive by the combined tropism
     /*
      * analysis.h
      */
     class_<SegmentAnalyser, SegmentAnalyser*>("SegmentAnalyser")
-        .def(init<RootSystem&>())
+        .def("__init__", make_constructor(&createAnalyser))
         .def(init<SegmentAnalyser&>())
+        .def(init<RSMLReader&>())
         .def("addSegments",addSegments1)
         .def("addSegments",addSegments2)
-        .def("crop", &SegmentAnalyser::crop)
+        .def("crop", crop1)
+        .def("crop", crop2)
+        .def("select", &SegmentAnalyser::select)
         .def("filter", filter1)
         .def("filter", filter2)
         .def("pack", &SegmentAnalyser::pack)
+        .def("coarsen", &SegmentAnalyser::coarsen)
         .def("getParameter", &SegmentAnalyser::getParameter)
+        .def("getNodeArray", &getAnalyserNodeArray)
+        .def("getSegmentArray", &getAnalyserSegmentArray)
+        .def("getSegmentCTArray", &getAnalyserSegmentCTArray)
+        .def("getParameterArray", &getAnalyserParameterArray)
         .def("getSegmentLength", &SegmentAnalyser::getSegmentLength)
         .def("getSummed", getSummed1)
         .def("getSummed", getSummed2)
-        .def("distribution", distribution_1)
-        .def("distribution", distribution_2)
-        .def("distribution2", distribution2_1)
-        .def("distribution2", distribution2_2)
+        .def("distribution", WITHOUT_GIL(decltype(distribution_1), &SegmentAnalyser::distribution))
+        .def("distribution", WITHOUT_GIL(decltype(distribution_2), &SegmentAnalyser::distribution))
+        .def("distribution2", WITHOUT_GIL(decltype(distribution2_1), &SegmentAnalyser::distribution2))
+        .def("distribution2", WITHOUT_GIL(decltype(distribution2_2), &SegmentAnalyser::distribution2))
+        .def("rasterize", WITHOUT_GIL(decltype(rasterize_1), &SegmentAnalyser::rasterize))
+        .def("rasterize", WITHOUT_GIL(decltype(rasterize_2), &SegmentAnalyser::rasterize))
+        .def("setNumberOfThreads", &SegmentAnalyser::setNumberOfThreads)
+        .def("getNumberOfThreads", &SegmentAnalyser::getNumberOfThreads)
         .def("getOrgans", &SegmentAnalyser::getOrgans)
         .def("getNumberOfOrgans", &SegmentAnalyser::getNumberOfOrgans)
         .def("cut", cut1)
+        .def("cut", cut3)
+        .def("foto", foto1, (arg("self"), arg("pos"), arg("ons"), arg("fl"), arg("width")=1., arg("height")=1.))
+        .def("foto", foto2)
         .def("addUserData", &SegmentAnalyser::addUserData)
         .def("clearUserData", &SegmentAnalyser::clearUserData)
-        .def("write", &SegmentAnalyser::write)
+        .def("write", WITHOUT_GIL(void (SegmentAnalyser::*)(std::string, int), &SegmentAnalyser::write), (arg("self"), arg("name"), arg("format")=int(VTPWriter::ascii)))
         .def_readwrite("nodes", &SegmentAnalyser::nodes)
         .def_readwrite("segments", &SegmentAnalyser::segments)
         .def_readwrite("segCTs", &SegmentAnalyser::segCTs)
         // .def("cut", cut2) // not working, see top definition of cut2
         ;
+    class_<RSMLReader, RSMLReader*>("RSMLReader", init<>())
+        .def("__init__", make_constructor(&createRSMLReader))
+        .def("read", WITHOUT_GIL(decltype(rsmlRead), &RSMLReader::read))
+        .def("clear", &RSMLReader::clear)
+        .def("getDataNames", &RSMLReader::getDataNames, return_value_policy<copy_const_reference>())
+        .def("getData", &RSMLReader::getData, return_value_policy<copy_const_reference>())
+        .def_readonly("nodes", &RSMLReader::nodes)
+        .def_readonly("segments", &RSMLReader::segments)
+        .def_readonly("segCTs", &RSMLReader::segCTs)
+        ;
     class_<std::vector<SegmentAnalyser>>("std_vector_SegmentAnalyser_")
             .def(vector_indexing_suite<std::vector<SegmentAnalyser>>() )
             ;
+    class_<SegmentIndex, SegmentIndex*>("SegmentIndex", init<SegmentAnalyser&, optional<int>>()[with_custodian_and_ward<1,2>()])
+        .def("getIntersecting", &SegmentIndex::getIntersecting)
+        .def("getNear", &SegmentIndex::getNear)
+        .def("getNumberOfSegments", &SegmentIndex::getNumberOfSegments)
+        ;
+    std::vector<double> (CreationTimeIndex::*ctDistribution1)(std::string, double, double, int, bool, double) const = &CreationTimeIndex::distribution;
+    std::vector<std::vector<double>> (CreationTimeIndex::*ctDistribution2)(std::string, double, double, int, bool, const std::vector<double>&) const = &CreationTimeIndex::distribution;
+    class_<CreationTimeIndex, CreationTimeIndex*, boost::noncopyable>("CreationTimeIndex", init<SegmentAnalyser&>()[with_custodian_and_ward<1,2>()])
+        .def("getNumberOfSegments", &CreationTimeIndex::getNumberOfSegments)
+        .def("getSegments", &CreationTimeIndex::getSegments)
+        .def("getSummed", &CreationTimeIndex::getSummed)
+        .def("distribution", ctDistribution1)
+        .def("distribution", ctDistribution2)
+        .def("getSnapshot", &CreationTimeIndex::getSnapshot)
+        ;
+    enum_<PackedColumn::Precision>("StoragePrecision")
+        .value("double", PackedColumn::Precision::p_double)
+        .value("float", PackedColumn::Precision::p_float)
+        .value("quantized", PackedColumn::Precision::p_quantized)
+        ;
+    class_<PackedSegments, PackedSegments*>("PackedSegments", init<SegmentAnalyser&, optional<int, double, Vector3d>>())
+        .def("unpack", &PackedSegments::unpack)
+        .def("getNumberOfSegments", &PackedSegments::getNumberOfSegments)
+        .def("getMemory", &PackedSegments::getMemory)
+        ;
+    class_<SegmentQuery, SegmentQuery*>("SegmentQuery", init<SegmentAnalyser&>()[with_custodian_and_ward<1,2>()])
+        .def("crop", &SegmentQuery::crop, return_self<>())
+        .def("filter", queryFilter1, return_self<>())
+        .def("filter", queryFilter2, return_self<>())
+        .def("clear", &SegmentQuery::clear)
+        .def("getSegmentIndices", &SegmentQuery::getSegmentIndices, return_value_policy<copy_const_reference>())
+        .def("getNumberOfSegments", &SegmentQuery::getNumberOfSegments)
+        .def("getSummed", &SegmentQuery::getSummed)
+        .def("getAnalyser", &SegmentQuery::getAnalyser, getAnalyser_overloads())
+        ;
+    class_<SegmentView, SegmentView*>("SegmentView", init<Organism&>()[with_custodian_and_ward<1,2>()])
+        .def("filter", viewFilter1, return_self<>())
+        .def("filter", viewFilter2, return_self<>())
+        .def("crop", &SegmentView::crop, return_self<>())
+        .def("getNumberOfSegments", &SegmentView::getNumberOfSegments)
+        .def("getSegmentIndices", &SegmentView::getSegmentIndices, return_value_policy<copy_const_reference>())
+        .def("getNumberOfCuts", &SegmentView::getNumberOfCuts)
+        .def("getParameter", &SegmentView::getParameter)
+        .def("getSummed", viewGetSummed1)
+        .def("getSummed", viewGetSummed2)
+        .def("distribution", &SegmentView::distribution, (arg("self"), arg("name"), arg("top"), arg("bot"), arg("n"), arg("exact")=false))
+        .def("rasterize", &SegmentView::rasterize, (arg("self"), arg("name"), arg("x"), arg("y"), arg("z"), arg("exact")=true))
+        .def("getAnalyser", &SegmentView::getAnalyser)
+        ;
+    void (AsyncWriter::*asyncWrite1)(const SegmentAnalyser&, std::string, int) = &AsyncWriter::write;
+    void (AsyncWriter::*asyncWrite2)(const Organism&, std::string, int) = &AsyncWriter::write;
+    class_<AsyncWriter, boost::noncopyable>("AsyncWriter", init<optional<int>>())
+        .def("write", WITHOUT_GIL(decltype(asyncWrite1), &AsyncWriter::write), (arg("self"), arg("ana"), arg("name"), arg("format")=int(VTPWriter::ascii)))
+        .def("write", WITHOUT_GIL(decltype(asyncWrite2), &AsyncWriter::write), (arg("self"), arg("plant"), arg("name"), arg("format")=int(VTPWriter::ascii)))
+        .def("finish", WITHOUT_GIL(decltype(&AsyncWriter::finish), &AsyncWriter::finish))
+        .def("getQueueSize", &AsyncWriter::getQueueSize)
+        .def("getNumberOfPending", &AsyncWriter::getNumberOfPending)
+        .def("getNumberOfWritten", &AsyncWriter::getNumberOfWritten)
+        .def("__str__", &AsyncWriter::toString)
+        ;
+    /*
+     * mapper.h
+     */
+    class_<SegmentMapper, boost::noncopyable>("SegmentMapper", init<std::vector<double>, std::vector<double>, std::vector<double>>())
+        .def(init<RectilinearGrid3D&>())
+        .def("map", &SegmentMapper::map)
+        .def("update", &SegmentMapper::update)
+        .def("getNumberOfCells", &SegmentMapper::getNumberOfCells)
+        .def("getNumberOfUpdated", &SegmentMapper::getNumberOfUpdated)
+        .def("getCells", &SegmentMapper::getCells)
+        .def("getFractions", &SegmentMapper::getFractions)
+        .def("getCellSegments", &SegmentMapper::getCellSegments)
+        .def("distribute", &SegmentMapper::distribute)
+        ;
+    class_<std::vector<std::vector<int>>>("std_vector_vector_int_")
+            .def(vector_indexing_suite<std::vector<std::vector<int>>>() )
+            ;
+    class_<VTPWriter, boost::noncopyable>("VTPWriter", no_init)
+        .def("hasCompression", &VTPWriter::hasCompression)
+        .staticmethod("hasCompression")
+        ;
+    class_<TimeSeriesWriter, boost::noncopyable>("TimeSeriesWriter", init<std::string, optional<int>>())
+        .def("write", &TimeSeriesWriter::write)
+        .def("close", &TimeSeriesWriter::close)
+        .def("getNumberOfSteps", &TimeSeriesWriter::getNumberOfSteps)
+        ;
+    class_<TimeSeriesReader, boost::noncopyable>("TimeSeriesReader", init<std::string>())
+        .def("getNumberOfSteps", &TimeSeriesReader::getNumberOfSteps)
+        .def("getTime", &TimeSeriesReader::getTime)
+        .def("isKeyframe", &TimeSeriesReader::isKeyframe)
+        .def("read", &TimeSeriesReader::read)
+        .def("getStep", &TimeSeriesReader::getStep)
+        .def("getNodes", &TimeSeriesReader::getNodes, return_value_policy<copy_const_reference>())
+        .def("getNodeCTs", &TimeSeriesReader::getNodeCTs, return_value_policy<copy_const_reference>())
+        .def("getSegments", &TimeSeriesReader::getSegments, return_value_policy<copy_const_reference>())
+        .def("getSegmentCTs", &TimeSeriesReader::getSegmentCTs)
+        .def("getSegmentData", &TimeSeriesReader::getSegmentData)
+        .def("writeVTP", &TimeSeriesReader::writeVTP, writeVTP_overloads())
+        ;
+    enum_<VTPWriter::Format>("VTPFormat")
+        .value("ascii", VTPWriter::Format::ascii)
+        .value("binary", VTPWriter::Format::binary)
+        .value("compressed", VTPWriter::Format::compressed)
+        ;
     /*
      * rootparameter.h
      */
     class_<RootRandomParameter, RootRandomParameter*, bases<OrganRandomParameter>>("RootRandomParameter", init<Organism*>())
-                .def("getLateralType",&RootRandomParameter::getLateralType)
+                .def("getLateralType",getLateralType1)
                 .def("getK",&RootRandomParameter::getK)
                 .def_readwrite("type", &RootRandomParameter::subType)
                 .def_readwrite("lb", &RootRandomParameter::lb)
@@ -630,12 +1288,17 @@ BOOST_PYTHON_MODULE(py_rootbox)
              .def("setGeometry", &RootSystem::setGeometry)
              .def("setSoil", &RootSystem::setSoil)
              .def("reset", &RootSystem::reset)
-             .def("initialize", initialize1)
-             .def("initialize", initialize2)
+             .def("initialize", WITHOUT_GIL(decltype(initialize1), &RootSystem::initialize))
+             .def("initialize", WITHOUT_GIL(decltype(initialize2), &RootSystem::initialize))
+             .def("setLazyBaseRoots", &RootSystem::setLazyBaseRoots)
+             .def("hasLazyBaseRoots", &RootSystem::hasLazyBaseRoots)
+             .def("getNumberOfScheduledRoots", &RootSystem::getNumberOfScheduledRoots)
              .def("setTropism", &RootSystem::setTropism)
-             .def("simulate",simulate1, simulate1_overloads())
-             .def("simulate",simulate2)
-             .def("simulate",simulate3, simulate3_overloads())
+             .def("createTropismFunction", &RootSystem::createTropismFunction, return_value_policy<manage_new_object>())
+             .def("simulate", WITHOUT_GIL(decltype(simulate1), &RootSystem::simulate), (arg("self"), arg("dt"), arg("silence")=false))
+             .def("simulate", WITHOUT_GIL(decltype(simulate2), &RootSystem::simulate))
+             .def("simulate", WITHOUT_GIL(decltype(simulate3), &RootSystem::simulate), (arg("self"), arg("dt"), arg("maxinc"), arg("f_se"), arg("silence")=false))
+             .def("simulateDry", WITHOUT_GIL(double (RootSystem::*)(double, bool), &RootSystem::simulateDry), (arg("self"), arg("dt"), arg("verbose")=false))
              .def("getSimTime", &RootSystem::getSimTime)
              .def("getNumberOfNodes", &RootSystem::getNumberOfNodes)
              .def("getRoots", &RootSystem::getRoots)
@@ -643,13 +1306,112 @@ BOOST_PYTHON_MODULE(py_rootbox)
              .def("getNumberOfRoots", &RootSystem::getNumberOfRoots, getNumberOfRoots_overloads())
              .def("getBaseRoots", &RootSystem::getBaseRoots)
              .def("getShootSegments", &RootSystem::getShootSegments)
-             .def("getSegmentOrigins", &RootSystem::getSegmentOrigins)
-             .def("getRootTips", &RootSystem::getRootTips)
+             .def("getRootTips", getRootTips1)
+             .def("getRootTips", getRootTips2)
+             .def("setTipRegistry", &RootSystem::setTipRegistry, (arg("self"), arg("b"), arg("cellSize")=1.))
+             .def("hasTipRegistry", &RootSystem::hasTipRegistry)
+             .def("getTipRegistry", &RootSystem::getTipRegistry, return_internal_reference<>())
              .def("getRootBases", &RootSystem::getRootBases)
              .def("getNumberOfNewNodes",&RootSystem::getNumberOfNewNodes)
              .def("push",&RootSystem::push)
              .def("pop",&RootSystem::pop)
-             .def("write", &RootSystem::write)
+             .def("write", WITHOUT_GIL(void (RootSystem::*)(std::string, int) const, &RootSystem::write), (arg("self"), arg("name"), arg("format")=int(VTPWriter::ascii)))
+             ;
+    /*
+     * ensemble.h
+     */
+    class_<RootSystemEnsemble, RootSystemEnsemble*>("RootSystemEnsemble", init<RootSystem&>()[with_custodian_and_ward<1,2>()])
+             .def("setGeometry", &RootSystemEnsemble::setGeometry)
+             .def("setSoil", &RootSystemEnsemble::setSoil)
+             .def("setDistribution", &RootSystemEnsemble::setDistribution, setDistribution_overloads())
+             .def("addSummed", &RootSystemEnsemble::addSummed)
+             .def("run", WITHOUT_GIL(decltype(&RootSystemEnsemble::run), &RootSystemEnsemble::run), (arg("self"), arg("replicates"), arg("seed"), arg("simtime"), arg("dt")=1., arg("threads")=0))
+             .def("getNumberOfReplicates", &RootSystemEnsemble::getNumberOfReplicates)
+             .def("getDistributionMean", &RootSystemEnsemble::getDistributionMean)
+             .def("getDistributionVariance", &RootSystemEnsemble::getDistributionVariance)
+             .def("getSummedMean", &RootSystemEnsemble::getSummedMean)
+             .def("getSummedVariance", &RootSystemEnsemble::getSummedVariance)
+             .def("getTipsMean", &RootSystemEnsemble::getTipsMean)
+             .def("getTipsVariance", &RootSystemEnsemble::getTipsVariance)
+             .def("__str__",&RootSystemEnsemble::toString)
+             ;
+    void (ParameterSweep::*setSamples1)(int, int, unsigned int) = &ParameterSweep::setSamples;
+    void (ParameterSweep::*setSamples2)(const std::vector<std::vector<double>>&) = &ParameterSweep::setSamples;
+    class_<ParameterSweep, ParameterSweep*>("ParameterSweep", init<RootSystem&>()[with_custodian_and_ward<1,2>()])
+             .def("setGeometry", &ParameterSweep::setGeometry)
+             .def("setSoil", &ParameterSweep::setSoil)
+             .def("addParameter", &ParameterSweep::addParameter)
+             .def("addSummed", &ParameterSweep::addSummed)
+             .def("setSamples", setSamples1, (arg("self"), arg("sampling"), arg("n"), arg("seed")=1))
+             .def("setSamples", setSamples2)
+             .def("run", WITHOUT_GIL(decltype(&ParameterSweep::run), &ParameterSweep::run), (arg("self"), arg("simtime"), arg("dt")=1., arg("threads")=0, arg("filename")="", arg("seed")=1))
+             .def("getNumberOfParameters", &ParameterSweep::getNumberOfParameters)
+             .def("getNumberOfSamples", &ParameterSweep::getNumberOfSamples)
+             .def("getSample", &ParameterSweep::getSample)
+             .def("getColumnNames", &ParameterSweep::getColumnNames)
+             .def("getColumn", &ParameterSweep::getColumn)
+             .def("__str__",&ParameterSweep::toString)
+             ;
+    enum_<ParameterSweep::Sampling>("Sampling")
+            .value("grid", ParameterSweep::Sampling::s_grid)
+            .value("latinhypercube", ParameterSweep::Sampling::s_latinhypercube)
+            .value("sobol", ParameterSweep::Sampling::s_sobol)
+            ;
+    /*
+     * field.h
+     */
+    class_<Field, boost::noncopyable>("Field", init<RootSystem&>()[with_custodian_and_ward<1,2>()])
+             .def("setGeometry", &Field::setGeometry, with_custodian_and_ward<1,2>())
+             .def("setSoil", &Field::setSoil, with_custodian_and_ward<1,2>())
+             .def("addPlant", &Field::addPlant)
+             .def("setPatches", &Field::setPatches)
+             .def("initialize", WITHOUT_GIL(decltype(&Field::initialize), &Field::initialize))
+             .def("simulate", WITHOUT_GIL(decltype(&Field::simulate), &Field::simulate), (arg("self"), arg("dt"), arg("threads")=0, arg("patch")=-1))
+             .def("getNumberOfPlants", &Field::getNumberOfPlants)
+             .def("getPlant", &Field::getPlant, return_internal_reference<>())
+             .def("getNumberOfPatches", &Field::getNumberOfPatches)
+             .def("getPatch", &Field::getPatch)
+             .def("getPlants", &Field::getPlants)
+             .def("getNumberOfNodes", &Field::getNumberOfNodes)
+             .def("getNodeOffset", &Field::getNodeOffset)
+             .def("getPlantOfNode", &Field::getPlantOfNode)
+             .def("getNodes", &Field::getNodes)
+             .def("getSegments", &Field::getSegments)
+             .def("getSegmentCTs", &Field::getSegmentCTs)
+             .def("getSegmentOrigins", &Field::getSegmentOrigins)
+             .def("getAnalyser", &Field::getAnalyser)
+             .def("__str__",&Field::toString)
+             ;
+    /*
+     * doussan.h
+     */
+    class_<Doussan_Wrap, boost::noncopyable>("Doussan", init<Organism&, SoilLookUp*>()[with_custodian_and_ward<1,2>(), with_custodian_and_ward<1,3>()])
+             .def("radialConductivity", &Doussan::radialConductivity, &Doussan_Wrap::default_radialConductivity)
+             .def("axialConductivity", &Doussan::axialConductivity, &Doussan_Wrap::default_axialConductivity)
+             .def("setKrTable", &Doussan::setKrTable)
+             .def("setKxTable", &Doussan::setKxTable)
+             .def("init", &Doussan::init, init_overloads())
+             .def("update", &Doussan::update)
+             .def("assemble", WITHOUT_GIL(decltype(&Doussan::assemble), &Doussan::assemble))
+             .def("getRowPtr", &Doussan::getRowPtr, return_value_policy<copy_const_reference>())
+             .def("getColIdx", &Doussan::getColIdx, return_value_policy<copy_const_reference>())
+             .def("getValues", &Doussan::getValues, return_value_policy<copy_const_reference>())
+             .def("getB", &Doussan::getB, return_value_policy<copy_const_reference>())
+             .def("getI", &Doussan::getI)
+             .def("getJ", &Doussan::getJ)
+             .def("getV", &Doussan::getV)
+             .def("addNeumann", &Doussan::addNeumann)
+             .def("addDirichlet", &Doussan::addDirichlet)
+             .def("clearBoundaryConditions", &Doussan::clearBoundaryConditions)
+             .def("solve", WITHOUT_GIL(decltype(&Doussan::solve), &Doussan::solve))
+             .def("getAxialFlux", &Doussan::getAxialFlux)
+             .def("getRadialFlux", &Doussan::getRadialFlux)
+             .def("getSegments", &Doussan::getSegments, return_value_policy<copy_const_reference>())
+             .def("isTree", &Doussan::isTree)
+             .def_readwrite("kr", &Doussan::kr)
+             .def_readwrite("kx", &Doussan::kx)
+             .def_readwrite("rho", &Doussan::rho)
+             .def_readwrite("g", &Doussan::g)
              ;
     enum_<RootSystem::TropismTypes>("TropismType")
             .value("plagio", RootSystem::TropismTypes::tt_plagio)
@@ -666,7 +1428,10 @@ BOOST_PYTHON_MODULE(py_rootbox)
      */
     class_<ExudationModel, ExudationModel*>("ExudationModel", init<double, double, int, RootSystem&>())
             .def(init<double, double, double, int, int, int, RootSystem&>())
-		    .def("calculate", &ExudationModel::calculate)
+		    .def("calculate", WITHOUT_GIL(decltype(&ExudationModel::calculate), &ExudationModel::calculate))
+            .def("setNumberOfThreads", &ExudationModel::setNumberOfThreads)
+            .def("getNumberOfThreads", &ExudationModel::getNumberOfThreads)
+            .def("clear", &ExudationModel::clear)
 		    .def_readwrite("Q", &ExudationModel::Q)
 		    .def_readwrite("Dl", &ExudationModel::Dl)
 		    .def_readwrite("theta", &ExudationModel::theta)
@@ -684,6 +1449,65 @@ BOOST_PYTHON_MODULE(py_rootbox)
             .value("mps", ExudationModel::IntegrationType::mps)
             .value("mls", ExudationModel::IntegrationType::mls)
             ;
+    /*
+     * carbon.h
+     */
+    class_<CarbonAllocator, CarbonAllocator*>("CarbonAllocator", init<RootSystem&>())
+            .def("setWeight", &CarbonAllocator::setWeight)
+            .def("getWeight", &CarbonAllocator::getWeight)
+            .def("setCost", &CarbonAllocator::setCost)
+            .def("getCost", &CarbonAllocator::getCost)
+            .def("getDemand", &CarbonAllocator::getDemand)
+            .def("allocate", &CarbonAllocator::allocate)
+            .def("simulate", WITHOUT_GIL(decltype(&CarbonAllocator::simulate), &CarbonAllocator::simulate), (arg("self"), arg("dt"), arg("maxinc"), arg("verbose")=false))
+            .def("getDemands", &CarbonAllocator::getDemands, return_value_policy<copy_const_reference>())
+            .def("getScales", &CarbonAllocator::getScales, return_value_policy<copy_const_reference>())
+            .def("getLambda", &CarbonAllocator::getLambda)
+            .def("__str__", &CarbonAllocator::toString)
+            ;
+    /*
+     * segmentstore.h
+     */
+    class_<SegmentStore, SegmentStore*, boost::noncopyable>("SegmentStore", init<std::string>())
+            .def(init<std::string, std::vector<std::string>, optional<int>>())
+            .def("addSegments", WITHOUT_GIL(decltype(storeAddSegments1), &SegmentStore::addSegments))
+            .def("addSegments", WITHOUT_GIL(decltype(storeAddSegments2), &SegmentStore::addSegments))
+            .def("getNumberOfChunks", &SegmentStore::getNumberOfChunks)
+            .def("getChunk", &getStoreChunk, return_value_policy<manage_new_object>())
+            .def("load", &loadStore, return_value_policy<manage_new_object>())
+            .def("getSummed", WITHOUT_GIL(decltype(storeGetSummed1), &SegmentStore::getSummed))
+            .def("getSummed", WITHOUT_GIL(decltype(storeGetSummed2), &SegmentStore::getSummed))
+            .def("distribution", WITHOUT_GIL(decltype(&SegmentStore::distribution), &SegmentStore::distribution), (arg("self"), arg("name"), arg("top"), arg("bot"), arg("n"), arg("exact")=false))
+            .def("rasterize", WITHOUT_GIL(decltype(&SegmentStore::rasterize), &SegmentStore::rasterize), (arg("self"), arg("name"), arg("x"), arg("y"), arg("z"), arg("exact")=true))
+            .def("filter", WITHOUT_GIL(decltype(storeFilter1), &SegmentStore::filter))
+            .def("filter", WITHOUT_GIL(decltype(storeFilter2), &SegmentStore::filter))
+            .def("crop", WITHOUT_GIL(decltype(&SegmentStore::crop), &SegmentStore::crop))
+            .def("getName", &SegmentStore::getName)
+            .def("getTypes", &SegmentStore::getTypes, return_value_policy<copy_const_reference>())
+            .def("getChunkSize", &SegmentStore::getChunkSize)
+            .def("getNumberOfSegments", &SegmentStore::getNumberOfSegments)
+            .def("getNumberOfNodes", &SegmentStore::getNumberOfNodes)
+            .def("getFileSize", &SegmentStore::getFileSize)
+            .def("__str__", &SegmentStore::toString)
+            ;
+    /*
+     * tipregistry.h
+     */
+    class_<TipRegistry, TipRegistry*>("TipRegistry", init<>())
+            .def(init<double>())
+            .def("update", &TipRegistry::update)
+            .def("rebuild", &TipRegistry::rebuild)
+            .def("clear", &TipRegistry::clear)
+            .def("getNumberOfTips", &TipRegistry::getNumberOfTips)
+            .def("getCellSize", &TipRegistry::getCellSize)
+            .def("getTips", &TipRegistry::getTips)
+            .def("getTipsInRadius", &TipRegistry::getTipsInRadius)
+            .def("getTipsInBox", &TipRegistry::getTipsInBox)
+            .def("getTipsInCell", &TipRegistry::getTipsInCell)
+            .def("getOrgan", &TipRegistry::getOrgan, return_value_policy<reference_existing_object>())
+            .def("getPosition", &TipRegistry::getPosition)
+            .def("__str__", &TipRegistry::toString)
+            ;
 
 }
 
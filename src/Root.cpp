@@ -1,8 +1,12 @@
 // -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
 #include "Root.h"
 
+#include "binaryio.h"
+
 namespace CRootBox {
 
+static_assert(sizeof(Root)<=MemoryPool::maxObjectSize(), "Root: roots must fit into the size classes of the memory pool");
+
 /**
  * Constructs a root from given data.
  * The organ tree must be created, @see Organ::setPlant, Organ::setParent, Organ::addChild
@@ -39,14 +43,15 @@ Root::Root(int id, const OrganSpecificParameter* param, bool alive, bool active,
  */
 Root::Root(Organism* rs, int type, Vector3d heading, double delay,  Root* parent, double pbl, int pni) :Organ(rs, parent, Organism::ot_root, type, delay)
 {
+    Organism::StreamScope scope(plant, &stream);
     double beta = 2*M_PI*plant->rand(); // initial rotation
     Matrix3d ons = Matrix3d::ons(heading);
     double theta = param()->theta;
     if (parent!=nullptr) { // scale if not a baseRoot
-        double scale = getRootTypeParameter()->f_sa->getValue(parent->getNode(pni),this);
+        double scale = getSoilValue(getRootTypeParameter()->f_sa, parent->getNode(pni));
         theta*=scale;
     }
-    iHeading = ons.times(Vector3d::rotAB(theta,beta)); // new initial heading
+    iHeading = ons.timesRotAB(theta,beta); // new initial heading
     parentBaseLength = pbl;
     parentNI = pni;
     length = 0;
@@ -59,16 +64,17 @@ Root::Root(Organism* rs, int type, Vector3d heading, double delay,  Root* parent
 
 /**
  * Deep copies the organ into the new plant @param rs.
- * All laterals are deep copied, plant and parent pointers are updated.
+ * All laterals are deep copied, plant and parent pointers are updated, the specific parameters are shared.
  *
  * @param plant     the plant the copied organ will be part of
  */
 Organ* Root::copy(Organism* rs)
 {
-    Root* r = new Root(*this); // shallow copy
+    Root* r = new (rs) Root(*this); // shallow copy
     r->parent = nullptr;
     r->plant = rs;
-    r->param_ = new RootSpecificParameter(*param()); // copy parameters
+    r->samples = nullptr; // copies might be simulated in parallel
+    r->param_->retain(); // share parameters
     for (size_t i=0; i< children.size(); i++) {
         r->children[i] = children[i]->copy(rs); // copy laterals
         r->children[i]->setParent(this);
@@ -84,9 +90,15 @@ Organ* Root::copy(Organism* rs)
  */
 void Root::simulate(double dt, bool verbose)
 {
+    Organism::StreamScope scope(plant, &stream);
+    journal(); // (see RootSystem::push)
     firstCall = true;
     moved = false;
-    oldNumberOfNodes = nodes.size();
+    oldNumberOfNodes = getNumberOfNodes();
+    if (dormant) { // the time steps, in which the root was skipped
+        age += plant->getSimTime()-visited;
+        dormant = false;
+    }
 
     const RootSpecificParameter& p = *param(); // rename
 
@@ -101,7 +113,7 @@ void Root::simulate(double dt, bool verbose)
 
         // probabilistic branching model
         if ((age>0) && (age-dt<=0)) { // the root emerges in this time step
-            double P = getRootTypeParameter()->f_sbp->getValue(nodes.back(),this);
+            double P = getSoilValue(getRootTypeParameter()->f_sbp, getNode(getNumberOfNodes()-1), emergenceSample);
             if (P<1.) { // P==1 means the lateral emerges with probability 1 (default case)
                 double p = 1.-std::pow((1.-P), dt); //probability of emergence in this time step
                 if (plant->rand()>p) { // not rand()<p
@@ -114,6 +126,15 @@ void Root::simulate(double dt, bool verbose)
 
             // children first (lateral roots grow even if base root is inactive)
             for (auto l:children) {
+                if (l->isFinished()) { // dead subtrees are skipped
+                    continue;
+                }
+                if (l->isSleeping()) { // dormant subtrees too, until a lateral emerges or dies
+                    if (plant->getInstrumentation().isEnabled()) {
+                        plant->getInstrumentation().count(Organism::ot_root, Instrumentation::c_skipped);
+                    }
+                    continue;
+                }
                 l->simulate(dt,verbose);
             }
 
@@ -130,7 +151,7 @@ void Root::simulate(double dt, bool verbose)
 
                 double targetlength = calcLength(age_+dt_);
                 double e = targetlength-length; // unimpeded elongation in time step dt
-                double scale = getRootTypeParameter()->f_se->getValue(nodes.back(),this);
+                double scale = getSoilValue(getRootTypeParameter()->f_se, getNode(getNumberOfNodes()-1), elongationSample)*plant->getElongationScale(this);
                 double dl = std::max(scale*e, 0.); // length increment
 
                 // create geometry
@@ -187,8 +208,29 @@ void Root::simulate(double dt, bool verbose)
             } // if active
             active = length<(p.getK()-dx()/10); // become inactive, if final length is nearly reached
         }
-    } // if alive
-
+        if (!alive) { // died in this time step, the laterals develop no further
+            freezeChildren(plant->getSimTime()+dt);
+        }
+    } else { // dead at the start of the time step: nothing has changed, and nothing will change
+        finished = true;
+    }
+    visited = plant->getStepEnd();
+    if (alive) { // unborn, or inactive without changes in this time step, and all laterals dormant
+        dormant = ((age<=0) || !active) && (getNumberOfNodes()==oldNumberOfNodes) && !moved;
+        wakeTime = (age<=0) ? visited-age : visited+p.rlt-age; // emergence, or death
+        for (auto l : children) {
+            if (!dormant) {
+                break;
+            }
+            if (!l->isFinished()) {
+                dormant = l->isDormant();
+                wakeTime = std::min(wakeTime, l->getWakeTime());
+            }
+        }
+    }
+    if (!(alive && active)) {
+        tipNodes = nullptr; // the node store holds the last nodes (see Organ::holdTipNodes)
+    }
 }
 
 /**
@@ -203,7 +245,25 @@ double Root::calcCreationTime(double length)
     double rootage = calcAge(length);
     rootage = std::min(rootage, age);
     assert(rootage >= 0 && "Root::getCreationTime() negative root age");
-    return rootage+nodeCTs[0];
+    return rootage+getNodeCT(0);
+}
+
+/**
+ * Analytical creation (=emergence) times of several points along the already grown root,
+ * equals Root::calcCreationTime per point, with a single call of the growth function (@see GrowthFunction::getAges)
+ *
+ * @param lengths  lengths along the root, where the points are located [cm]
+ * @param cts      the analytic times when these points were reached by the growing root [day] (results)
+ */
+void Root::calcCreationTimes(const std::vector<double>& lengths, std::vector<double>& cts)
+{
+    getRootTypeParameter()->f_gf->getAges(lengths, param()->r, param()->getK(), this, cts);
+    double ct0 = getNodeCT(0);
+    for (auto& ct : cts) {
+        ct = std::min(ct, age);
+        assert(ct >= 0 && "Root::calcCreationTimes() negative root age");
+        ct += ct0;
+    }
 }
 
 /**
@@ -235,7 +295,7 @@ double Root::calcAge(double length)
  */
 RootRandomParameter* Root::getRootTypeParameter() const
 {
-    return (RootRandomParameter*)plant->getOrganRandomParameter(Organism::ot_root, param_->subType);
+    return (RootRandomParameter*)getOrganRandomParameter();
 }
 
 /**
@@ -255,13 +315,17 @@ const RootSpecificParameter* Root::param() const
  */
 void Root::createLateral(bool verbose)
 {
-    int lt = getRootTypeParameter()->getLateralType(nodes.back());
+    Instrumentation::Timer timer(plant->getInstrumentation(), Organism::ot_root, Instrumentation::p_createLateral);
+    int lt = getRootTypeParameter()->getLateralType(getNode(getNumberOfNodes()-1), plant);
     if (lt>0) {
         double ageLN = this->calcAge(length); // age of root when lateral node is created
         double ageLG = this->calcAge(length+param()->la); // age of the root, when the lateral starts growing (i.e when the apical zone is developed)
         double delay = ageLG-ageLN; // time the lateral has to wait
-        Root* lateral = new Root(plant, lt,  heading(), delay,  this, length, nodes.size()-1);
+        Root* lateral = new (plant) Root(plant, lt,  heading(), delay,  this, length, getNumberOfNodes()-1);
         children.push_back(lateral);
+        if (plant->getInstrumentation().isEnabled()) {
+            plant->getInstrumentation().count(Organism::ot_root, Instrumentation::c_laterals);
+        }
         lateral->simulate(age-ageLN,verbose); // pass time overhead (age we want to achieve minus current age)
     }
 }
@@ -271,8 +335,9 @@ void Root::createLateral(bool verbose)
  */
 Vector3d Root::heading()
 {
-    if (nodes.size()>1) {
-        auto h = nodes.back().minus(nodes.at(nodes.size()-2)); // a->b = b-a
+    int nn = getNumberOfNodes();
+    if (nn>1) {
+        auto h = getNode(nn-1).minus(getNode(nn-2)); // a->b = b-a
         h.normalize();
         return h;
     } else {
@@ -290,6 +355,11 @@ Vector3d Root::heading()
  */
 void Root::createSegments(double l, double dt, bool verbose)
 {
+    if (plant->isDryRun()) { // only the length is developed (see RootSystem::simulateDry)
+        return;
+    }
+    Instrumentation& stats = plant->getInstrumentation();
+    Instrumentation::Timer timer(stats, Organism::ot_root, Instrumentation::p_createSegments);
     if (l==0) {
         std::cout << "Root::createSegments: zero length encountered \n";
         return;
@@ -300,20 +370,19 @@ void Root::createSegments(double l, double dt, bool verbose)
 
     // shift first node to axial resolution
     double shiftl = 0; // length produced by shift
-    int nn = nodes.size();
+    int nn = getNumberOfNodes();
     if (firstCall) { // first call of createSegments (in Root::simulate)
         firstCall = false;
         if ((nn>1) && (children.empty() || (nn-1 != ((Root*)children.back())->parentNI)) ) { // don't move a child base node
-            Vector3d n2 = nodes[nn-2];
-            Vector3d n1 = nodes[nn-1];
+            Vector3d n2 = getNode(nn-2);
+            Vector3d n1 = getNode(nn-1);
             double olddx = n1.minus(n2).length(); // length of last segment
             if (olddx<dx()*0.99) { // shift node instead of creating a new node
                 shiftl = std::min(dx()-olddx, l);
                 double sdx = olddx + shiftl; // length of new segment
                 Vector3d newdxv = getIncrement(n2, sdx);
-                nodes[nn-1] = Vector3d(n2.plus(newdxv));
-                double et = this->calcCreationTime(length+shiftl);
-                nodeCTs[nn-1] = et; // in case of impeded growth the node emergence time is not exact anymore, but might break down to temporal resolution
+                double et = this->calcCreationTime(length+shiftl); // in case of impeded growth the node emergence time is not exact anymore, but might break down to temporal resolution
+                setNode(nn-1, Vector3d(n2.plus(newdxv)), et);
                 moved = true;
                 l -= shiftl;
                 if (l<=0) { // ==0 should be enough
@@ -327,30 +396,89 @@ void Root::createSegments(double l, double dt, bool verbose)
         }
     }
     // create n+1 new nodes
+    thread_local std::vector<double> sdxs, lengths, ets; // reused buffers, roots are simulated in parallel
+    sdxs.clear();
+    lengths.clear();
     double sl = 0; // summed length of created segment
     int n = floor(l/dx());
+    bool skipped = false;
     for (int i = 0; i < n + 1; i++) {
-
         double sdx; // segment length (<=dx)
         if (i<n) {  // normal case
             sdx = dx();
         } else { // last segment
             sdx = l-n*dx();
             if (sdx<smallDx) { // quit if l is too small
-                if (verbose) {
-                    std::cout << "skipped small segment ("<< sdx <<" < "<< smallDx << ") \n";
-                }
-                return;
+                skipped = true;
+                break;
             }
         }
         sl += sdx;
-        Vector3d newdx = getIncrement(nodes.back(), sdx);
-        Vector3d newnode = Vector3d(nodes.back().plus(newdx));
-        double et = this->calcCreationTime(length+shiftl+sl);
-        // in case of impeded growth the node emergence time is not exact anymore,
-        // but might break down to temporal resolution
-        addNode(newnode, et);
+        sdxs.push_back(sdx);
+        lengths.push_back(length+shiftl+sl);
+    }
+    // in case of impeded growth the node emergence time is not exact anymore,
+    // but might break down to temporal resolution
+    calcCreationTimes(lengths, ets);
+    Vector3d tip = getNode(getNumberOfNodes()-1);
+    for (size_t i = 0; i < sdxs.size(); i++) {
+        Vector3d newdx = getIncrement(tip, sdxs[i]);
+        Vector3d newnode = Vector3d(tip.plus(newdx));
+        addNode(newnode, ets[i]);
+        tip = newnode;
+        if (stats.isEnabled()) {
+            stats.count(Organism::ot_root, Instrumentation::c_segments);
+        }
+    }
+    if (skipped && verbose) {
+        std::cout << "skipped small segment ("<< l-n*dx() <<" < "<< smallDx << ") \n";
+    }
+}
+
+/**
+ * Looks up a scaling function (e.g. RootRandomParameter::f_se) at a position, the lookup is recorded by the instrumentation
+ *
+ * @param f         the scaling function
+ * @param pos       position of the lookup
+ * @return          the scale
+ */
+double Root::getSoilValue(const SoilLookUp* f, const Vector3d& pos) const
+{
+    Instrumentation& stats = plant->getInstrumentation();
+    Instrumentation::Timer timer(stats, Organism::ot_root, Instrumentation::p_soil);
+    if (stats.isEnabled()) {
+        stats.count(Organism::ot_root, Instrumentation::c_soil);
     }
+    return f->getValue(pos, this);
+}
+
+/**
+ * Looks up a scaling function at a position, and reuses the sample of the tip if it is still in the same soil cell
+ * (@see SoilLookUp::getCachedValue), only the lookups that miss the sample are recorded by the instrumentation
+ *
+ * @param f         the scaling function
+ * @param pos       position of the lookup
+ * @param sample    Root::elongationSample, or Root::emergenceSample
+ * @return          the scale
+ */
+double Root::getSoilValue(const SoilLookUp* f, const Vector3d& pos, int sample) const
+{
+    if (!f->getCaching()) { // most roots never keep a sample
+        return getSoilValue(f, pos);
+    }
+    if (samples==nullptr) {
+        samples = std::shared_ptr<SoilLookUp::Sample>(new SoilLookUp::Sample[2], std::default_delete<SoilLookUp::Sample[]>());
+    }
+    SoilLookUp::Sample& s = samples.get()[sample];
+    if (f->isCached(pos, s)) {
+        return s.value;
+    }
+    Instrumentation& stats = plant->getInstrumentation();
+    Instrumentation::Timer timer(stats, Organism::ot_root, Instrumentation::p_soil);
+    if (stats.isEnabled()) {
+        stats.count(Organism::ot_root, Instrumentation::c_soil);
+    }
+    return f->getCachedValue(pos, this, s);
 }
 
 /**
@@ -365,7 +493,7 @@ Vector3d Root::getIncrement(const Vector3d& p, double sdx)
     Vector3d h = heading();
     Matrix3d ons = Matrix3d::ons(h);
     Vector2d ab = getRootTypeParameter()->f_tf->getHeading(p, ons, sdx, this);
-    Vector3d sv = ons.times(Vector3d::rotAB(ab.x,ab.y));
+    Vector3d sv = ons.timesRotAB(ab.x,ab.y);
     return sv.times(sdx);
 }
 
@@ -376,36 +504,99 @@ Vector3d Root::getIncrement(const Vector3d& p, double sdx)
  * lnMean, and lnDev denotes the mean and standard deviation of the inter-lateral distance of this organ
  * ln_mean, and ln_dev is the mean and standard deviation from the root type parameters
  */
-double Root::getParameter(std::string name) const
+double Root::getParameter(int id) const
 {
-    if (name=="lb") { return param()->lb; } // basal zone [cm]
-    if (name=="la") { return param()->la; } // apical zone [cm]
-    if (name=="nob") { return param()->nob; } // number of branches
-    if (name=="r"){ return param()->r; }  // initial growth rate [cm day-1]
-    if (name=="radius") { return param()->a; } // root radius [cm]
-    if (name=="a") { return param()->a; } // root radius [cm]
-    if (name=="theta") { return param()->theta; } // angle between root and parent root [rad]
-    if (name=="rlt") { return param()->rlt; } // root life time [day]
-    if (name=="k") { return param()->getK(); }; // maximal root length [cm]
-    if (name=="lnMean") { // mean lateral distance [cm]
+    switch (id) {
+    case pi_lb: return param()->lb; // basal zone [cm]
+    case pi_la: return param()->la; // apical zone [cm]
+    case pi_nob: return param()->nob; // number of branches
+    case pi_r: return param()->r;  // initial growth rate [cm day-1]
+    case pi_radius: return param()->a; // root radius [cm]
+    case pi_a: return param()->a; // root radius [cm]
+    case pi_theta: return param()->theta; // angle between root and parent root [rad]
+    case pi_rlt: return param()->rlt; // root life time [day]
+    case pi_k: return param()->getK(); // maximal root length [cm]
+    case pi_lnMean: { // mean lateral distance [cm]
         auto& v =param()->ln;
         return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
     }
-    if (name=="lnDev") { // standard deviation of lateral distance [cm]
+    case pi_lnDev: { // standard deviation of lateral distance [cm]
         auto& v =param()->ln;
         double mean = std::accumulate(v.begin(), v.end(), 0.0) / v.size();
         double sq_sum = std::inner_product(v.begin(), v.end(), v.begin(), 0.0);
         return std::sqrt(sq_sum / v.size() - mean * mean);
     }
-    if (name=="volume") { return param()->a*param()->a*M_PI*getLength(); } // // root volume [cm^3]
-    if (name=="surface") { return 2*param()->a*M_PI*getLength(); }
-    if (name=="type") { return this->param_->subType; }  // in CRootBox the subType is often called just type
-    if (name=="iHeadingX") { return iHeading.x; } // root initial heading x - coordinate [cm]
-    if (name=="iHeadingY") { return iHeading.y; } // root initial heading y - coordinate [cm]
-    if (name=="iHeadingZ") { return iHeading.z; } // root initial heading z - coordinate [cm]
-    if (name=="parentBaseLength") { return parentBaseLength; } // length of parent root where the lateral emerges [cm]
-    if (name=="parentNI") { return parentNI; } // local parent node index where the lateral emerges
-    return Organ::getParameter(name);
+    case pi_volume: return param()->a*param()->a*M_PI*getLength(); // // root volume [cm^3]
+    case pi_surface: return 2*param()->a*M_PI*getLength();
+    case pi_type: return this->param_->subType;  // in CRootBox the subType is often called just type
+    case pi_iHeadingX: return iHeading.x; // root initial heading x - coordinate [cm]
+    case pi_iHeadingY: return iHeading.y; // root initial heading y - coordinate [cm]
+    case pi_iHeadingZ: return iHeading.z; // root initial heading z - coordinate [cm]
+    case pi_parentBaseLength: return parentBaseLength; // length of parent root where the lateral emerges [cm]
+    case pi_parentNI: return parentNI; // local parent node index where the lateral emerges
+    default: return Organ::getParameter(id);
+    }
+}
+
+/**
+ * @copydoc Organ::writeBinary
+ *
+ * and the initial heading, and the position at the parent root
+ */
+void Root::writeBinary(BinaryWriter& w) const
+{
+    Organ::writeBinary(w);
+    w.write(iHeading);
+    w.write(parentBaseLength);
+    w.write(parentNI);
+    w.write(firstCall);
+}
+
+/**
+ * @copydoc Organ::readBinary
+ */
+void Root::readBinary(BinaryReader& r)
+{
+    Organ::readBinary(r);
+    iHeading = r.readVector3d();
+    parentBaseLength = r.read<double>();
+    parentNI = r.read<int>();
+    firstCall = r.read<bool>();
+}
+
+/**
+ * Writes the realized root parameters
+ */
+void Root::writeParameter(BinaryWriter& w) const
+{
+    auto p = param();
+    w.write(p->subType);
+    w.write(p->lb);
+    w.write(p->la);
+    w.write(p->nob);
+    w.write(p->r);
+    w.write(p->a);
+    w.write(p->theta);
+    w.write(p->rlt);
+    w.write(p->ln);
+}
+
+/**
+ * @return the realized root parameters written by Root::writeParameter
+ */
+const OrganSpecificParameter* Root::readParameter(BinaryReader& r)
+{
+    auto p = new (plant) RootSpecificParameter();
+    p->subType = r.read<int>();
+    p->lb = r.read<double>();
+    p->la = r.read<double>();
+    p->nob = r.read<int>();
+    p->r = r.read<double>();
+    p->a = r.read<double>();
+    p->theta = r.read<double>();
+    p->rlt = r.read<double>();
+    p->ln = r.readVector<double>();
+    return p;
 }
 
 /**
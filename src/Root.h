@@ -10,6 +10,7 @@
 namespace CRootBox {
 
 class RootState;
+class RootSystemState;
 
 /**
  * Root
@@ -22,6 +23,7 @@ class Root :public Organ
 {
 
     friend RootState;
+    friend RootSystemState;
 
 public:
 
@@ -38,10 +40,12 @@ public:
     void simulate(double dt, bool silence = false) override; ///< root growth for a time span of @param dt
 
     /* Roots as sequential list */
-    double getParameter(std::string name) const override; ///< returns an organ parameter
+    using Organ::getParameter;
+    double getParameter(int id) const override; ///< returns an organ parameter by its interned id
 
     /* From analytical equations */
     double calcCreationTime(double length); ///< analytical creation (=emergence) time of a node at a length
+    void calcCreationTimes(const std::vector<double>& lengths, std::vector<double>& cts); ///< analytical creation times of nodes at several lengths
     double calcLength(double age); ///< analytical length of the root
     double calcAge(double length); ///< analytical age of the root
 
@@ -52,6 +56,8 @@ public:
 
     /* IO */
     std::string toString() const override;
+    void writeBinary(BinaryWriter& w) const override; ///< writes the state of this root, without laterals
+    void readBinary(BinaryReader& r) override; ///< reads the state written by Root::writeBinary
 
     /* Parameters that are given per root that are constant*/
     Vector3d iHeading; ///< the initial heading of the root, when it was created
@@ -60,13 +66,21 @@ public:
 
 protected:
 
+    void writeParameter(BinaryWriter& w) const override;
+    const OrganSpecificParameter* readParameter(BinaryReader& r) override;
+
     virtual void createLateral(bool silence); ///< creates a new lateral, called by Root::simulate()
     void createSegments(double l, double dt, bool silence); ///< creates segments of length l, called by Root::simulate()
     virtual Vector3d getIncrement(const Vector3d& p, double sdx); ///< called by createSegments, to determine growth direction
     Vector3d heading(); ///< current growth direction of the root
+    double getSoilValue(const SoilLookUp* f, const Vector3d& pos) const; ///< value of a scaling function of the root type parameters
+    double getSoilValue(const SoilLookUp* f, const Vector3d& pos, int sample) const; ///< reuses the last value of the tip
 
     bool firstCall = true; ///< firstCall of createSegments in simulate
     const double smallDx = 1e-6; ///< threshold value, smaller segments will be skipped (otherwise root tip direction can become NaN)
+    static const int elongationSample = 0; ///< last value of RootRandomParameter::f_se at the tip (@see SoilLookUp::setCaching)
+    static const int emergenceSample = 1; ///< last value of RootRandomParameter::f_sbp at the tip
+    mutable std::shared_ptr<SoilLookUp::Sample> samples; ///< the two samples of the tip, allocated by the first cached lookup, not shared with copies
 
 };
 
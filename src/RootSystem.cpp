@@ -4,6 +4,11 @@
 #include "organparameter.h"
 #include "Organism.h"
 #include "Seed.h"
+#include "binaryio.h"
+#include "carbon.h"
+
+#include <algorithm>
+#include <functional>
 
 namespace CRootBox {
 
@@ -29,16 +34,20 @@ RootSystem::RootSystem(): Organism()
  *
  * @param rs        root system that is copied
  */
-RootSystem::RootSystem(const RootSystem& rs): Organism(rs), geometry(rs.geometry), soil(rs.soil)
+RootSystem::RootSystem(const RootSystem& rs): Organism(rs), geometry(rs.geometry), soil(rs.soil),
+    lazyBaseRoots(rs.lazyBaseRoots), emergence(rs.emergence), crownNodes(rs.crownNodes)
 {
     std::cout << "Copying root system with "<<rs.baseOrgans.size()<< " base roots \n";
     roots.clear();
+    if (rs.tipRegistry) { // the tips of the copied roots are registered by the next update
+        tipRegistry = std::make_shared<TipRegistry>(rs.tipRegistry->getCellSize());
+    }
 }
 
 /**
  * @return the i-th root parameter of sub type @param type.
  */
-RootRandomParameter* RootSystem::getRootTypeParameter(int type) const
+RootRandomParameter* RootSystem::getRootTypeParameter(int type)
 {
     return (RootRandomParameter*) getOrganRandomParameter(Organism::ot_root, type);
 }
@@ -46,11 +55,11 @@ RootRandomParameter* RootSystem::getRootTypeParameter(int type) const
 /**
  * @return all root type parameters in a vector
  */
-std::vector<RootRandomParameter*> RootSystem::getRootTypeParameter() const
+std::vector<RootRandomParameter*> RootSystem::getRootTypeParameter()
 {
     std::vector<RootRandomParameter*>  otps = std::vector<RootRandomParameter*>(0);
     for (auto& otp : organParam[Organism::ot_root]) {
-        otps.push_back((RootRandomParameter*)otp.second);
+        otps.push_back((RootRandomParameter*)unshare(otp.second));
     }
     return otps;
 }
@@ -77,10 +86,17 @@ SeedRandomParameter* RootSystem::getRootSystemParameter()
  */
 void RootSystem::reset()
 {
-    for(auto b :baseOrgans) {
-        delete b;
+    deleteOrgans();
+    emergence.clear();
+    crownNodes.clear();
+    if (tipRegistry) {
+        tipRegistry->clear();
     }
-    baseOrgans.clear();
+    organTreeChanged();
+    nodeStore.clear();
+    streams.clear();
+    stateStack = std::stack<RootSystemState>(); // the journals point to the deleted roots
+    checkpoint = 0;
     simtime = 0;
     organId = -1;
     nodeId = -1;
@@ -156,7 +172,7 @@ void RootSystem::writeParameters(std::ostream& os) const
 {
 	std::cout << "RootSystem::writeParameters is deprecated, use writeParameters(std::string filename) instead \n";
     for (auto& otp :organParam[Organism::ot_root]) {
-        ((RootRandomParameter*)otp.second)->write(os);
+        ((RootRandomParameter*)otp.second.get())->write(os);
     }
 }
 /**
@@ -165,6 +181,9 @@ void RootSystem::writeParameters(std::ostream& os) const
  *
  * Call this method before simulation and after setting geometry, plant and root parameters
  *
+ * If RootSystem::setLazyBaseRoots is set, only the tap root is created. The basal and shoot borne roots are kept
+ * in a queue of emergence times, and are created in the time step of their emergence (see RootSystem::createBaseRoots).
+ *
  * @parm basaltype      the type of the basal roots (default = 4)
  * @parm basaltype      the type of the shootborne roots (default = 5)
  */
@@ -177,10 +196,16 @@ void RootSystem::initialize(int basaltype, int shootbornetype)
 
     // create seed
     Seed seed = Seed(this);
-    seed.initialize();
+    seed.initialize(lazyBaseRoots);
     seedParam = SeedSpecificParameter(*seed.param()); // copy the specific parameters
     // std::cout << "RootSystem::initialize:\n" <<  seedParam.toString() ;
     baseOrgans = seed.copyBaseOrgans();
+    for (auto& bo : baseOrgans) { // the copies own the base nodes
+        bo->storeNodes();
+    }
+    emergence = seed.getEmergence();
+    std::make_heap(emergence.begin(), emergence.end(), std::greater<BaseRootEmergence>());
+    crownNodes.assign(lazyBaseRoots ? seed.getNumberOfRootCrowns() : 0, -1);
 
     oldNumberOfNodes = baseOrgans.size();
     initCallbacks();
@@ -195,7 +220,7 @@ void RootSystem::initCallbacks()
 {
     // Create tropisms and growth functions per root type
     for (auto& p_otp :organParam[Organism::ot_root]) {
-        RootRandomParameter* rtp = (RootRandomParameter*)p_otp.second;
+        RootRandomParameter* rtp = (RootRandomParameter*)unshare(p_otp.second);
         Tropism* tropism = this->createTropismFunction(rtp->tropismT, rtp->tropismN, rtp->tropismS);
         tropism->setGeometry(geometry);
         delete rtp->f_tf; // delete old tropism
@@ -220,7 +245,7 @@ void RootSystem::setTropism(Tropism* tf_, int rt)
         getRootTypeParameter(rt)->f_tf=tf_;
     } else { // set for all root types (default)
         for (auto& p_otp :organParam[Organism::ot_root]) {
-            RootRandomParameter* rtp = (RootRandomParameter*)p_otp.second;
+            RootRandomParameter* rtp = (RootRandomParameter*)unshare(p_otp.second);
             rtp->f_tf = tf_;
         }
     }
@@ -234,8 +259,11 @@ void RootSystem::setTropism(Tropism* tf_, int rt)
  */
 void RootSystem::simulate(double dt, bool verbose)
 {
+    createBaseRoots(dt);
     Organism::simulate(dt,verbose);
-    roots.clear(); // empty buffer
+    if (tipRegistry) {
+        tipRegistry->update(*this);
+    }
 }
 
 /**
@@ -250,6 +278,12 @@ void RootSystem::simulate()
  * Simulates root system growth for a time span, elongates a maximum of @param maxinc total length [cm/day]
  * using the proportional elongation @param se to impede overall growth.
  *
+ * The increase of the unlimited time step is computed analytically, including the emerging laterals
+ * (see CarbonAllocator::getDemand). If it exceeds the maximum, the proportional scale maxinc/increase is corrected once by
+ * the increase of a dry run (see RootSystem::simulateDry), with the elasticity of the analytic increase between the scale
+ * and one. The dry run creates no geometry, so only the final time step creates segments, and its increase is an estimate
+ * of dt*maxinc (use CarbonAllocator for scales per root type).
+ *
  * @param dt        time step [day]
  * @param maxinc_   maximal total length [cm/day] the root system is allowed to grow in this time step
  * @param se        The class ProportionalElongation is used to scale overall root growth
@@ -257,50 +291,90 @@ void RootSystem::simulate()
  */
 void RootSystem::simulate(double dt, double maxinc_, ProportionalElongation* se, bool verbose)
 {
-    const double accuracy = 1.e-3;
-    const int maxiter = 20;
     double maxinc = dt*maxinc_; // [cm]
-    double ol = getSummed("length");
-    int i = 0;
-
-    push();
     se->setScale(1.);
-    simulate(dt, verbose);
-    double l = getSummed("length");
-    double inc_ = l - ol;
+    CarbonAllocator allocator(*this);
+    double inc_ = allocator.getDemand(dt); // analytic, the scales of se are proportional
     if (verbose) {
-        std::cout << "expected increase is " << inc_ << " maximum is " << maxinc
-            << "\n";
+        std::cout << "expected increase is " << inc_ << " maximum is " << maxinc << "\n";
     }
-    pop();
-
-    if ((inc_>maxinc) && (std::abs(inc_-maxinc)>accuracy)) { // check if we have to perform a binary search
-
-        double sl = 0.; // left
-        double sr = 1.; // right
+    if (inc_>maxinc) {
+        double m = maxinc/inc_; // proportional elongation
+        se->setScale(m);
+        double inc = simulateDry(dt, verbose);
+        if (verbose) {
+            std::cout << "\tscale " << m << ", dry run increase " <<  inc << ", maximum " << maxinc << "\n";
+        }
+        if (inc>0) {
+            double m1 = std::min(m*maxinc/inc, 1.); // proportional correction
+            if (m1!=m) { // the elasticity of the analytic increase between m and m1
+                double c = allocator.getDemand(dt);
+                se->setScale(m1);
+                double p = std::log(allocator.getDemand(dt)/c)/std::log(m1/m);
+                if (std::isfinite(p) && (p>0)) {
+                    m1 = std::min(m*std::pow(maxinc/inc, 1./p), 1.);
+                }
+            }
+            se->setScale(m1);
+        }
+    }
+    this->simulate(dt, verbose);
+}
 
-        while ( ((std::abs(inc_-maxinc)) > accuracy) && (i<maxiter) )  { // binary search
+/**
+ * Summed length of the organ @param o and its children, including organs that have not created a segment yet
+ */
+static double summedLength(const Organ* o)
+{
+    double l = o->getLength();
+    for (int i=0; i<o->getNumberOfChildren(); i++) {
+        l += summedLength(o->getChild(i));
+    }
+    return l;
+}
 
-            double m = (sl+sr)/2.; // mid
-            push();
-            se->setScale(m);
-            simulate(dt, verbose);
-            l = getSummed("length");
-            inc_ = l - ol;
-            pop();
-            if (verbose) {
-                std::cout << "\t(sl, mid, sr) = (" << sl << ", " <<  m << ", " <<  sr << "), inc " <<  inc_ << ", err: " << std::abs(inc_-maxinc) << " > " << accuracy << "\n";
-            }
-            if (inc_>maxinc) { // concatenate
-                sr = m;
-            } else {
-                sl = m;
+/**
+ * Dry run of a time step: the roots develop age and length, and create their laterals, like in RootSystem::simulate,
+ * but no nodes are created (no segments, and no tropism trials). Afterwards the state is restored (see RootSystem::pop).
+ *
+ * Elongation scales and branching probabilities are evaluated at the root tips at the start of the time step,
+ * and the random numbers of the dry run differ from the actual time step: there are no tropism trials, so the draws
+ * that follow them (e.g. the emergence and the parameters of laterals) differ. The result is therefore an estimate of
+ * the elongation in RootSystem::simulate, also for position independent scales (e.g. within 4% for Anagallis femina).
+ * It is exact only for time steps that draw no random numbers after the first tropism trial.
+ *
+ * @param dt        time step [day]
+ * @param verbose   indicates if status is written to the console (cout) (default = false)
+ * @return          total length increment [cm]
+ */
+double RootSystem::simulateDry(double dt, bool verbose)
+{
+    double l0 = 0.;
+    for (const auto& r : baseOrgans) {
+        l0 += summedLength(r);
+    }
+    push();
+    dryRun = true;
+    stepEnd = simtime+dt;
+    double l1 = 0.;
+    try {
+        createBaseRoots(dt); // deleted by pop
+        for (const auto& r : baseOrgans) { // sequential, the random numbers are restored by pop
+            if (!r->isFinished() && !r->isSleeping()) {
+                r->simulate(dt, verbose);
             }
-            i++;
-
         }
+        for (const auto& r : baseOrgans) {
+            l1 += summedLength(r);
+        }
+    } catch (...) {
+        dryRun = false;
+        pop();
+        throw;
     }
-    this->simulate(dt, verbose);
+    dryRun = false;
+    pop();
+    return l1-l0;
 }
 
 /**
@@ -318,12 +392,7 @@ Tropism* RootSystem::createTropismFunction(int tt, double N, double sigma) {
     case tt_plagio: return new Plagiotropism(this,N,sigma);
     case tt_gravi: return new Gravitropism(this,N,sigma);
     case tt_exo: return new Exotropism(this,N,sigma);
-    case tt_hydro: {
-        Tropism* gt =  new Gravitropism(this,N,sigma);
-        Tropism* ht= new Hydrotropism(this,N,sigma,soil);
-        Tropism* cht = new CombinedTropism(this,N,sigma,ht,10.,gt,1.); // does only use the objective functions from gravitropism and hydrotropism
-        return cht;
-    }
+    case tt_hydro: return new HydroGravitropism(this,N,sigma,soil,10.,1.); // composed at compile time, same as CombinedTropism(hydro,10,gravi,1)
     default: throw std::invalid_argument( "RootSystem::createTropismFunction() tropism type not implemented" );
     }
 }
@@ -345,25 +414,36 @@ GrowthFunction* RootSystem::createGrowthFunction(int gft) {
 
 /**
  * Represents the root system as sequential vector of roots, copies the root only, if it has more than 1 node.
- * buffers the result, until next call of simulate(dt), a bit redundant to @see Organsim::getOrgans().
+ * a bit redundant to @see Organsim::getOrgans().
  *
  * \return sequential vector of roots with more than 1 node
  */
 std::vector<Root*> RootSystem::getRoots() const
 {
-    if (roots.empty()) { // create buffer
-        std::vector<Organ*> organs;
-        organs.reserve(getNumberOfOrgans()); // for speed up
-        for (const auto& br : this->baseOrgans) {
-            ((Root*)br)->getOrgans(ot_root, organs);
-        }
-        for (auto& o :organs) {
-            roots.push_back((Root*)o);
+    return getRootBuffer();
+}
+
+/**
+ * The roots of RootSystem::getRoots, filtered from the cached organ list (@see Organism::getOrganList).
+ * The buffer is kept, until new organs or nodes are created.
+ *
+ * \return sequential vector of roots with more than 1 node
+ */
+const std::vector<Root*>& RootSystem::getRootBuffer() const
+{
+    uint64_t version = getOrganListVersion();
+    if (roots.empty() || (rootsVersion!=version) || (rootsNodes!=nodeId)) { // create buffer
+        roots.clear();
+        const auto& organs = getOrganList();
+        for (size_t i=0; i<organs.size(); i++) {
+            if ((organListTypes[i]==ot_root) && (organs[i]->getNumberOfNodes()>1)) {
+                roots.push_back((Root*)organs[i]);
+            }
         }
-        return roots;
-    } else { // return buffer
-        return roots;
+        rootsVersion = version;
+        rootsNodes = nodeId; // roots with a single node only emerge with a new node
     }
+    return roots;
 }
 
 /**
@@ -371,11 +451,10 @@ std::vector<Root*> RootSystem::getRoots() const
  *
  * adds an artificial shoot node
  */
-std::vector<Vector3d> RootSystem::getNodes() const
+void RootSystem::getNodes(std::vector<Vector3d>& nodes) const
 {
-    auto v = Organism::getNodes();
-    v.at(0) = Vector3d(0.,0.,0.); // add artificial shoot
-    return v;
+    Organism::getNodes(nodes);
+    nodes.at(0) = Vector3d(0.,0.,0.); // add artificial shoot
 }
 
 
@@ -384,20 +463,60 @@ std::vector<Vector3d> RootSystem::getNodes() const
  */
 std::vector<int> RootSystem::getRootTips() const
 {
-    this->getRoots(); // update roots (if necessary)
     std::vector<int> tips;
-    for (auto& r : roots) {
-        tips.push_back(r->getNodeId(r->getNumberOfNodes()-1));
-    }
+    getRootTips(tips);
     return tips;
 }
 
+/**
+ * The node indices of the root tips, like RootSystem::getRootTips(), the buffer is reused
+ *
+ * @param tips      buffer receiving the node indices
+ */
+void RootSystem::getRootTips(std::vector<int>& tips) const
+{
+    const auto& roots = getRootBuffer();
+    tips.resize(roots.size());
+    for (size_t i=0; i<roots.size(); i++) {
+        tips[i] = roots[i]->getNodeId(roots[i]->getNumberOfNodes()-1);
+    }
+}
+
+/**
+ * Keeps a registry of the tips of the growing roots, with spatial queries (see TipRegistry).
+ * The registry is updated after each time step from the nodes that changed, and rebuilt by RootSystem::pop.
+ *
+ * @param b         turns the registry on or off
+ * @param cellSize  edge length of the cells of the spatial hash [cm]
+ */
+void RootSystem::setTipRegistry(bool b, double cellSize)
+{
+    if (b) {
+        tipRegistry = std::make_shared<TipRegistry>(cellSize);
+        tipRegistry->rebuild(*this);
+    } else {
+        tipRegistry.reset();
+    }
+}
+
+/**
+ * @return the registry of the growing root tips, after the last time step
+ */
+const TipRegistry& RootSystem::getTipRegistry() const
+{
+    if (!tipRegistry) {
+        std::cout << "RootSystem::getTipRegistry: the tip registry is not enabled (see RootSystem::setTipRegistry)\n" << std::flush;
+        throw std::invalid_argument("RootSystem::getTipRegistry: the tip registry is not enabled");
+    }
+    return *tipRegistry;
+}
+
 /**
  * @return the node indices of the root bases
  */
 std::vector<int> RootSystem::getRootBases() const
 {
-    this->getRoots(); // update roots (if necessary)
+    getRootBuffer(); // update roots (if necessary)
     std::vector<int> bases;
     for (auto& r : roots) {
         bases.push_back(r->getNodeId(0));
@@ -430,11 +549,13 @@ std::vector<Vector2i> RootSystem::getShootSegments() const
 }
 
 /**
- * Pushes current root system state to the stack
+ * Pushes current root system state to the stack.
+ * The roots are journaled, when they change for the first time after the push (see RootSystemState).
  */
 void RootSystem::push()
 {
     stateStack.push(RootSystemState(*this));
+    checkpoint = ++checkpoints; // new id, the roots are no longer journaled for the previous checkpoint
 }
 
 /**
@@ -445,6 +566,18 @@ void RootSystem::pop()
     RootSystemState& rss = stateStack.top();
     rss.restore(*this);
     stateStack.pop();
+    if (tipRegistry) {
+        tipRegistry->rebuild(*this);
+    }
+}
+
+/**
+ * Saves the state of the root @param o in the state on top of the stack, called by Organ::journal
+ */
+void RootSystem::journal(Organ* o)
+{
+    std::lock_guard<std::mutex> lock(journalMutex);
+    stateStack.top().journal.push_back(RootState(*((Root*)o)));
 }
 
 /**
@@ -464,17 +597,17 @@ std::string RootSystem::toString() const
  *
  * @param name      file name e.g. output.vtp
  */
-void RootSystem::write(std::string name) const
+void RootSystem::write(std::string name, int format) const
 {
     std::ofstream fos;
-    fos.open(name.c_str());
+    fos.open(name.c_str(), std::ios::out | std::ios::binary);
     std::string ext = name.substr(name.size()-3,name.size()); // pick the right writer
     if (ext.compare("sml")==0) {
         std::cout << "writing RSML... "<< name.c_str() <<"\n";
         //writeRSML(fos);
     } else if (ext.compare("vtp")==0) {
         std::cout << "writing VTP... "<< name.c_str() <<"\n";
-        writeVTP(fos);
+        writeVTP(fos, format);
     } else if (ext.compare(".py")==0)  {
         std::cout << "writing Geometry ... "<< name.c_str() <<"\n";
         writeGeometry(fos);
@@ -493,17 +626,17 @@ void RootSystem::write(std::string name) const
  *
  * todo use tinyxml2, move to Organism
  *
- * @param os      typically a file out stream
+ * @param os        typically a file out stream
+ * @param format    VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
  */
-void RootSystem::writeVTP(std::ostream & os) const
+void RootSystem::writeVTP(std::ostream & os, int format) const
 {
-    this->getRoots(); // update roots (if necessary)
+    getRootBuffer(); // update roots (if necessary)
     const auto& nodes = getPolylines();
     const auto& times = getPolylineCTs();
 
-    os << "<?xml version=\"1.0\"?>";
-    os << "<VTKFile type=\"PolyData\" version=\"0.1\" byte_order=\"LittleEndian\">\n";
-    os << "<PolyData>\n";
+    VTPWriter vtp(os, format);
+    vtp.begin();
     int non = 0; // number of nodes
     for (const auto& r : roots) {
         non += r->getNumberOfNodes();
@@ -511,54 +644,51 @@ void RootSystem::writeVTP(std::ostream & os) const
     int nol=roots.size(); // number of lines
     os << "<Piece NumberOfLines=\""<< nol << "\" NumberOfPoints=\""<<non<<"\">\n";
     // POINTDATA
-    os << "<PointData Scalars=\" PointData\">\n" << "<DataArray type=\"Float32\" Name=\"time\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
+    os << "<PointData Scalars=\" PointData\">\n";
+    std::vector<double> data;
+    data.reserve(3*non);
     for (const auto& r: times) {
-        for (const auto& t : r) {
-            os << t << " ";
-        }
+        data.insert(data.end(), r.begin(), r.end());
     }
-    os << "\n</DataArray>\n" << "\n</PointData>\n";
+    vtp.dataArray("time", 1, data);
+    os << "\n</PointData>\n";
     // CELLDATA (live on the polylines)
     os << "<CellData Scalars=\" CellData\">\n";
     const size_t N = 3; // SCALARS
     std::string scalarTypeNames[N] = {"type", "order", "radius" };
     for (size_t i=0; i<N; i++) {
-        os << "<DataArray type=\"Float32\" Name=\"" << scalarTypeNames[i] <<"\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
-        auto scalars = getParameter(scalarTypeNames[i]);
-        for (auto s : scalars) {
-            os << s<< " ";
-        }
-        os << "\n</DataArray>\n";
+        vtp.dataArray(scalarTypeNames[i], 1, getParameter(scalarTypeNames[i]));
     }
     os << "\n</CellData>\n";
     // POINTS (=nodes)
-    os << "<Points>\n"<<"<DataArray type=\"Float32\" Name=\"Coordinates\" NumberOfComponents=\"3\" format=\"ascii\" >\n";
+    os << "<Points>\n";
+    data.clear();
     for (const auto& r : nodes) {
         for (const auto& n : r) {
-            os << n.x << " "<< n.y <<" "<< n.z<< " ";
+            data.push_back(n.x);
+            data.push_back(n.y);
+            data.push_back(n.z);
         }
     }
-    os << "\n</DataArray>\n"<< "</Points>\n";
+    vtp.dataArray("Coordinates", 3, data);
+    os << "</Points>\n";
     // LINES (polylines)
-    os << "<Lines>\n"<<"<DataArray type=\"Int32\" Name=\"connectivity\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
+    os << "<Lines>\n";
+    std::vector<int> connectivity(non), offsets(nol);
     int c=0;
-    for (const auto& r : roots) {
-        for (size_t i=0; i<r->getNumberOfNodes(); i++) {
-            os << c << " ";
+    for (size_t j=0; j<roots.size(); j++) {
+        for (size_t i=0; i<roots[j]->getNumberOfNodes(); i++) {
+            connectivity[c] = c;
             c++;
         }
+        offsets[j] = c;
     }
-    os << "\n</DataArray>\n"<<"<DataArray type=\"Int32\" Name=\"offsets\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
-    c = 0;
-    for (const auto& r : roots) {
-        c += r->getNumberOfNodes();
-        os << c << " ";
-    }
-    os << "\n</DataArray>\n";
+    vtp.dataArray("connectivity", 1, connectivity);
+    vtp.dataArray("offsets", 1, offsets);
     os << "\n</Lines>\n";
 
     os << "</Piece>\n";
-    os << "</PolyData>\n" << "</VTKFile>\n";
+    vtp.end();
 }
 
 /**
@@ -577,18 +707,153 @@ void RootSystem::writeGeometry(std::ostream & os) const
 
 
 
+/**
+ * @copydoc Organism::writeBinary
+ *
+ * and the seed parameters of RootSystem::initialize
+ */
+void RootSystem::writeBinary(BinaryWriter& w) const
+{
+    Organism::writeBinary(w);
+    w.write(seedParam.subType);
+    w.write(seedParam.seedPos);
+    w.write(seedParam.firstB);
+    w.write(seedParam.delayB);
+    w.write(seedParam.maxB);
+    w.write(seedParam.nC);
+    w.write(seedParam.firstSB);
+    w.write(seedParam.delaySB);
+    w.write(seedParam.delayRC);
+    w.write(seedParam.nz);
+    w.write(seedParam.simtime);
+    w.write(numberOfCrowns);
+    w.write(lazyBaseRoots);
+    w.write(uint64_t(emergence.size()));
+    for (const auto& e : emergence) {
+        w.write(e.time);
+        w.write(e.subType);
+        w.write(e.crown);
+        w.write(e.index);
+        w.write(e.position);
+    }
+    w.write(uint64_t(crownNodes.size()));
+    for (int n : crownNodes) {
+        w.write(n);
+    }
+}
+
+/**
+ * @copydoc Organism::readBinary
+ *
+ * Tropisms and growth functions are created as by RootSystem::initialize, set the confining geometry before loading,
+ * and tropisms set by RootSystem::setTropism after loading.
+ */
+void RootSystem::readBinary(BinaryReader& r)
+{
+    reset();
+    roots.clear();
+    Organism::readBinary(r);
+    seedParam.subType = r.read<int>();
+    seedParam.seedPos = r.readVector3d();
+    seedParam.firstB = r.read<double>();
+    seedParam.delayB = r.read<double>();
+    seedParam.maxB = r.read<int>();
+    seedParam.nC = r.read<int>();
+    seedParam.firstSB = r.read<double>();
+    seedParam.delaySB = r.read<double>();
+    seedParam.delayRC = r.read<double>();
+    seedParam.nz = r.read<double>();
+    seedParam.simtime = r.read<double>();
+    numberOfCrowns = r.read<int>();
+    lazyBaseRoots = r.read<bool>();
+    uint64_t n = r.read<uint64_t>();
+    for (uint64_t i=0; i<n; i++) { // in heap order
+        BaseRootEmergence e;
+        e.time = r.read<double>();
+        e.subType = r.read<int>();
+        e.crown = r.read<int>();
+        e.index = r.read<int>();
+        e.position = r.readVector3d();
+        emergence.push_back(e);
+    }
+    n = r.read<uint64_t>();
+    for (uint64_t i=0; i<n; i++) {
+        crownNodes.push_back(r.read<int>());
+    }
+    initCallbacks();
+    if (tipRegistry) {
+        tipRegistry->rebuild(*this);
+    }
+}
+
+/**
+ * Creates a base root without nodes, called by Seed::initialize and RootSystem::createBaseRoots
+ *
+ * @param type      sub type of the root
+ * @param iheading  initial heading
+ * @param delay     delay of growth [day]
+ * @return the new root
+ */
+Root* RootSystem::createRoot(int type, Vector3d iheading, double delay)
+{
+    return new (this) Root(this, type, iheading, delay, nullptr, 0, 0);
+}
+
+/**
+ * @return an empty root, or the organ of Organism::createOrgan
+ */
+Organ* RootSystem::createOrgan(int ot)
+{
+    if (ot==ot_root) {
+        return new (this) Root(-1, nullptr, true, true, 0., 0., Vector3d(), 0., 0);
+    }
+    return Organism::createOrgan(ot);
+}
+
+/**
+ * Creates the scheduled basal and shoot borne roots (see RootSystem::setLazyBaseRoots), that emerge before the end
+ * of the time step. The roots are created with the age, and the first node a root created by RootSystem::initialize
+ * would have. The first root of a root crown creates the node of the crown, the other roots of the crown share it.
+ *
+ * The random parameters of the roots are drawn when the roots are created, therefore the results differ from
+ * a root system, that creates all base roots in RootSystem::initialize.
+ *
+ * @param dt        time step [day]
+ */
+void RootSystem::createBaseRoots(double dt)
+{
+    const std::greater<BaseRootEmergence> later;
+    size_t n = baseOrgans.size();
+    while (!emergence.empty() && (emergence.front().time<simtime+dt)) { // the root is born within the time step
+        std::pop_heap(emergence.begin(), emergence.end(), later);
+        BaseRootEmergence e = emergence.back();
+        emergence.pop_back();
+        Root* root = createRoot(e.subType, Vector3d(0,0,-1), e.time-simtime);
+        if (e.crown<0) { // basal roots emerge at the seed
+            root->addNode(baseOrgans.at(0)->getNode(0), baseOrgans.at(0)->getNodeId(0), e.time);
+        } else if (crownNodes.at(e.crown)<0) { // new root crown
+            root->addNode(e.position, e.time);
+            crownNodes[e.crown] = root->getNodeId(0);
+        } else {
+            root->addNode(e.position, crownNodes[e.crown], e.time);
+        }
+        baseOrgans.push_back(root);
+    }
+    if (baseOrgans.size()>n) {
+        organTreeChanged();
+    }
+}
+
 /**
  * Create a root system state object from a rootsystem, use RootSystemState::restore to go back to that state.
  *
  * @param rs        the root system to be stored
  */
-RootSystemState::RootSystemState(const RootSystem& rs) : simtime(rs.simtime), rid(rs.organId), old_non(rs.oldNumberOfNodes), old_nor(rs.oldNumberOfOrgans),
-    numberOfCrowns(rs.numberOfCrowns), gen(rs.gen), UD(rs.UD), ND(rs.ND)
+RootSystemState::RootSystemState(const RootSystem& rs) : simtime(rs.simtime), rid(rs.organId), nid(rs.nodeId), old_non(rs.oldNumberOfNodes), old_nor(rs.oldNumberOfOrgans),
+    numberOfCrowns(rs.numberOfCrowns), nob(rs.baseOrgans.size()), emergence(rs.emergence), crownNodes(rs.crownNodes),
+    gen(rs.gen), UD(rs.UD), ND(rs.ND), streams(rs.streams)
 {
-    baseRoots = std::vector<RootState>(rs.baseOrgans.size()); // store base roots
-    for (size_t i=0; i<baseRoots.size(); i++) {
-        baseRoots[i] = RootState(*((Root*)rs.baseOrgans[i]));
-    }
+    checkpoint = rs.checkpoint;
 }
 
 /**
@@ -608,9 +873,24 @@ void RootSystemState::restore(RootSystem& rs)
     rs.gen = gen;
     rs.UD = UD;
     rs.ND = ND;
-    for (size_t i=0; i<baseRoots.size(); i++) { // restore base roots
-        baseRoots[i].restore(*((Root*)rs.baseOrgans[i]));
+    rs.streams = streams;
+    rs.checkpoint = checkpoint;
+    rs.nodeStore.resize(nid+1); // remove nodes that have not been created
+    for (auto it = journal.rbegin(); it!=journal.rend(); ++it) { // latest changes first, laterals are restored before their parents delete them
+        it->restore();
+    }
+    if (rs.baseOrgans.size()>nob) { // delete base roots that have not been created (see RootSystem::createBaseRoots)
+        for (size_t i = nob; i<rs.baseOrgans.size(); i++) {
+            delete rs.baseOrgans[i];
+        }
+        rs.baseOrgans.resize(nob);
+        for (auto& bo : rs.baseOrgans) { // shared base nodes were written by the deleted roots
+            ((Root*)bo)->storeNode(0);
+        }
     }
+    rs.emergence = emergence;
+    rs.crownNodes = crownNodes;
+    rs.organTreeChanged();
 }
 
 /**
@@ -618,43 +898,43 @@ void RootSystemState::restore(RootSystem& rs)
  *
  * @param r        the root to be stored
  */
-RootState::RootState(const Root& r): alive(r.alive), active(r.active), age(r.age), length(r.length), old_non(r.oldNumberOfNodes)
+RootState::RootState(Root& r): alive(r.alive), active(r.active), finished(r.finished), dormant(r.dormant),
+    wakeTime(r.wakeTime), visited(r.visited), age(r.age), length(r.length), old_non(r.oldNumberOfNodes)
 {
-    lNode = r.nodes.back();
+    root = &r;
+    noc = r.children.size();
+    draws = r.stream.draws;
+    non = r.getNumberOfNodes();
+    lNode = r.getNode(non-1);
     lNodeId = r.nodeIds.back();
-    lneTime = r.nodeCTs.back();
-    non = r.nodes.size();
-    laterals = std::vector<RootState>(r.children.size());
-    for (size_t i=0; i<laterals.size(); i++) {
-        laterals[i] = RootState(*((Root*)r.children[i]));
-    }
+    lneTime = r.getNodeCT(non-1);
+    tipNodes = r.tipNodes; // copied on write by the root
 }
 
 /**
  * Restore evolved root back to its previous state
- *
- * @param r    the root to be restored
  */
-void RootState::restore(Root& r)
+void RootState::restore()
 {
+    Root& r = *root;
     r.alive = alive; // copy things that changed
     r.active = active;
+    r.finished = finished;
+    r.dormant = dormant;
+    r.wakeTime = wakeTime;
+    r.visited = visited;
     r.age = age;
     r.length = length;
     r.oldNumberOfNodes = old_non;
-    r.nodes.resize(non); // shrink vectors
-    r.nodeIds.resize(non);
-    r.nodeCTs.resize(non);
-    r.nodes.back() = lNode; // restore last value
-    r.nodeIds.back() = lNodeId;
-    r.nodeCTs.back() = lneTime;
-    for (size_t i = laterals.size(); i<r.children.size(); i++) { // delete roots that have not been created
+    r.stream.draws = draws;
+    r.nodeIds.resize(non); // shrink vector
+    r.nodeIds.setBack(lNodeId); // restore last value
+    r.tipNodes = tipNodes;
+    r.storeNode(non-1, lNode, lneTime);
+    for (size_t i = noc; i<r.children.size(); i++) { // delete roots that have not been created
         delete r.children[i];
     }
-    r.children.resize(laterals.size()); // shrink and restore laterals
-    for (size_t i=0; i<laterals.size(); i++) {
-        laterals[i].restore(*((Root*)r.children[i]));
-    }
+    r.children.resize(noc);
 }
 
 } // end namespace CRootBox
@@ -3,14 +3,19 @@
 #define ROOTSYSTEM_H_
 
 #include <stack>
+#include <mutex>
 #include <fstream>
+#include <memory>
 
 #include "soil.h"
 #include "tropism.h"
 #include "Organism.h"
 #include "rootparameter.h"
 #include "Root.h"
+#include "Seed.h"
+#include "tipregistry.h"
 #include "seedparameter.h"
+#include "vtpwriter.h"
 
 namespace CRootBox {
 
@@ -40,8 +45,8 @@ public:
     virtual ~RootSystem() { };
 
     /* Parameter input output */
-    RootRandomParameter* getRootTypeParameter(int type) const;///< returns the i-th root parameter set (i=1..n)
-    std::vector<RootRandomParameter*> getRootTypeParameter() const; ///< all root type parameters as a vector
+    RootRandomParameter* getRootTypeParameter(int type);///< returns the i-th root parameter set (i=1..n), which can be modified (@see Organism::getOrganRandomParameter)
+    std::vector<RootRandomParameter*> getRootTypeParameter(); ///< all root type parameters as a vector, which can be modified
     void setRootSystemParameter(SeedRandomParameter& rsp); ///< sets the root system parameters
     SeedRandomParameter* getRootSystemParameter(); ///< gets the root system parameters
     void openFile(std::string filename, std::string subdir="modelparameter/"); ///< reads root parameter and plant parameter
@@ -54,10 +59,14 @@ public:
     void reset(); ///< resets the root class, keeps the root type parameters
     void initialize() override { initialize(4,5); }; ///< creates the base roots, call before simulation and after setting the plant and root parameters
     void initialize(int basal, int shootborne); ///< creates the base roots, call before simulation and after setting the plant and root parameters
+    void setLazyBaseRoots(bool b) { lazyBaseRoots = b; } ///< creates basal and shoot borne roots when they emerge (call before RootSystem::initialize)
+    bool hasLazyBaseRoots() const { return lazyBaseRoots; } ///< true, if basal and shoot borne roots are created when they emerge
+    int getNumberOfScheduledRoots() const { return emergence.size(); } ///< number of base roots that are not created yet (see RootSystem::setLazyBaseRoots)
     void setTropism(Tropism* tf, int rt = -1); ///< sets a tropism function for a single root type or all root types (defaut)
     void simulate(double dt, bool verbose = false) override; ///< simulates root system growth for time span dt
     void simulate(); ///< simulates root system growth for the time defined in the root system parameters
     void simulate(double dt, double maxinc, ProportionalElongation* se, bool silence = false); // simulates the root system with a maximal overall elongation
+    double simulateDry(double dt, bool verbose = false); ///< length increment of a time step, without creating geometry
 
     /* sequential */
     std::vector<Root*> getRoots() const; ///< represents the root system as sequential vector of roots and buffers the result
@@ -66,37 +75,61 @@ public:
     void initCallbacks(); ///< sets up callback functions for tropisms and growth functions, called by initialize()
     virtual Tropism* createTropismFunction(int tt, double N, double sigma); ///< Creates the tropisms, overwrite or change this method to add more tropisms
     virtual GrowthFunction* createGrowthFunction(int gft); ///< Creates the growth function per root type, overwrite or change this method to add more tropisms
+    virtual Root* createRoot(int type, Vector3d iheading, double delay); ///< Creates a base root (see Seed::initialize), overwrite this method to grow other root classes
 
     /* Analysis of simulation results */
     int getNumberOfSegments(int ot = -1) const override { return nodeId-numberOfCrowns-1; } ///< Number of segments of the root system ((nid+1)-1) - numberOfCrowns - 1 (artificial shoot)
     int getNumberOfRoots(bool all = false) const { if (all) return organId+1; else return getRoots().size(); }
-    std::vector<Vector3d> getNodes() const override;
+    using Organism::getNodes;
+    void getNodes(std::vector<Vector3d>& nodes) const override;
     std::vector<Organ*> getBaseRoots() const { return baseOrgans; } ///< Base roots are tap root, basal roots, and shoot borne roots TODO
     std::vector<Vector2i> getShootSegments() const; ///< Copies the segments connecting tap, basal root, shootborne roots
     std::vector<int> getRootTips() const; ///< Node indices of the root tips
+    void getRootTips(std::vector<int>& tips) const; ///< Node indices of the root tips, into a reused buffer
+    void setTipRegistry(bool b, double cellSize = 1.); ///< keeps a registry of the growing root tips up to date after each time step
+    bool hasTipRegistry() const { return (bool)tipRegistry; } ///< true, if the tip registry is kept up to date
+    const TipRegistry& getTipRegistry() const; ///< the registry of the growing root tips (@see RootSystem::setTipRegistry)
     std::vector<int> getRootBases() const; ///< Node indices of the root bases
 
     /* dynamics */
     void push(); ///< push current state to a stack
     void pop(); ///< retrieve previous state from stack
+    void journal(Organ* o) override; ///< saves the state of a root in the checkpoint on top of the stack
 
     /* Output */
-    void write(std::string name) const; /// writes simulation results (type is determined from file extension in name)
-    void writeVTP(std::ostream & os) const; ///< writes current simulation results as VTP (VTK polydata file)
+    void write(std::string name, int format = VTPWriter::ascii) const; /// writes simulation results (type is determined from file extension in name)
+    void writeVTP(std::ostream & os, int format = VTPWriter::ascii) const; ///< writes current simulation results as VTP (VTK polydata file)
     void writeGeometry(std::ostream & os) const; ///< writes the current confining geometry (e.g. a plant container) as paraview python script
 
     std::string toString() const override; ///< infos about current root system state (for debugging)
 
+protected:
+
+    void writeBinary(BinaryWriter& w) const override; ///< writes the simulation state, and the seed parameters (see Organism::save)
+    void readBinary(BinaryReader& r) override; ///< reads the simulation state, and sets up the callbacks (see Organism::load)
+    Organ* createOrgan(int ot) override; ///< empty root (see Organism::readBinary)
+    void createBaseRoots(double dt); ///< creates the scheduled base roots emerging within the time step
+
 private:
 
     SeedSpecificParameter seedParam;
     SignedDistanceFunction* geometry = new SignedDistanceFunction(); ///< Confining geometry (unconfined by default)
     SoilLookUp* soil = nullptr; ///< callback for hydro, or chemo tropism (needs to set before initialize()) TODO should be a part of tf, or rtparam
 
+    const std::vector<Root*>& getRootBuffer() const; ///< updates and returns the buffer of RootSystem::getRoots
     mutable std::vector<Root*> roots = std::vector<Root*>(); // buffer for getRoots()
+    mutable uint64_t rootsVersion = 0; ///< Organism::getOrganListVersion of the buffer
+    mutable int rootsNodes = -1; ///< Organism::nodeId of the buffer
     int numberOfCrowns = 0;
 
+    bool lazyBaseRoots = false; ///< see RootSystem::setLazyBaseRoots
+    std::vector<BaseRootEmergence> emergence; ///< base roots that are not created yet, a heap with the earliest emergence on top
+    std::vector<int> crownNodes; ///< node index of each root crown, or -1 if no root of the crown was created yet
+
+    std::shared_ptr<TipRegistry> tipRegistry; ///< see RootSystem::setTipRegistry
+
     std::stack<RootSystemState> stateStack;
+    std::mutex journalMutex; ///< roots are journaled in parallel (see Organism::setNumberOfThreads)
 };
 
 
@@ -105,6 +138,10 @@ private:
  * Sores a state of the RootSystem,
  * i.e. all data that changes over time (*), i.e. excluding node data that cannot change
  *
+ * The roots are not stored when the state is created, but journaled: each root saves its state when it changes for the
+ * first time after the checkpoint (see Organ::journal). Creating the state is cheap, and restoring it is proportional
+ * to the number of roots that changed.
+ *
  * (*) excluding changes regarding RootSystemParameter, any RootTypeParameter, confining geometry, and soil
  */
 class RootSystemState
@@ -120,7 +157,8 @@ public:
 
 private:
 
-    std::vector<RootState> baseRoots;  ///< Base roots of the root system
+    std::vector<RootState> journal;  ///< states of the roots that changed after the checkpoint, in the order of the changes
+    int checkpoint = 0; ///< checkpoint of the root system when the state was created
 
     double simtime = 0; ///< simulation time
     int rid = -1; ///< unique root id counter
@@ -128,10 +166,14 @@ private:
     int old_non=0; ///< old number of nodes
     int old_nor=0; ///< old number of roots
     int numberOfCrowns = 0; ///< old number of root crowns
+    size_t nob = 0; ///< number of base roots, base roots created later are deleted
+    std::vector<BaseRootEmergence> emergence; ///< base roots that were not created yet
+    std::vector<int> crownNodes; ///< node indices of the root crowns
 
     mutable std::mt19937 gen; ///< random generator state
     mutable std::uniform_real_distribution<double> UD;  ///< random generator state
     mutable std::normal_distribution<double> ND; ///< random generator state
+    std::vector<SubtreeStream> streams; ///< random generator states of a parallel simulation
 
 };
 
@@ -147,26 +189,32 @@ public:
 
     RootState() { };
 
-    RootState(const Root& r); ///< create the root state from a root
+    RootState(Root& r); ///< create the root state from a root
 
-    void restore(Root& r); ///< restore evolved root back to its previous state
+    void restore(); ///< restore evolved root back to its previous state
 
 private:
 
     /* parameters that are given per root that may change with time */
     bool alive = 1; ///< true: alive, false: dead
     bool active = 1; ///< true: active, false: root stopped growing
+    bool finished = 0; ///< see Organ::isFinished
+    bool dormant = 0; ///< see Organ::isDormant
+    double wakeTime = 0.; ///< see Organ::getWakeTime
+    double visited = 0.; ///< end of the time step of the last simulate call
     double age = 0; ///< current age [days]
     double length = 0; ///< actual length [cm] of the root. might differ from getLength(age) in case of impeded root growth
     int old_non = 1; ///< number of old nodes, the sign is positive if the last node was updated, otherwise its negative
 
-    /* down the root branch*/
-    std::vector<RootState> laterals = std::vector<RootState>(0); ///< the lateral roots of this root
+    Root* root = nullptr; ///< the root
+    size_t noc = 0; ///< number of laterals, laterals created later are deleted
+    uint64_t draws = 0; ///< random numbers drawn from the stream of the root
 
     /* last node */
     Vector3d lNode = Vector3d(0.,0.,0.); ///< last node
     int lNodeId = 0; ///< last node id
     double lneTime = 0.;  ///< last creation time
+    std::shared_ptr<TipNodes> tipNodes; ///< last two nodes in full precision, if held (see Organ::holdTipNodes)
     size_t non = 0; ///< number of nodes
 
 };
@@ -1,14 +1,20 @@
 // -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
 #include "Seed.h"
 
-#include "Root.h"
+#include "RootSystem.h"
 
 namespace CRootBox {
 
 /**
+ * Creates the tap root, basal roots, and shoot borne roots
  *
+ * In the lazy initialization only the tap root is created, the basal and shoot borne roots are listed
+ * with their emergence times (see Seed::getEmergence), and are created by the root system during simulation
+ * (see RootSystem::setLazyBaseRoots).
+ *
+ * @param lazy      list the basal and shoot borne roots instead of creating them (default = false)
  */
-void Seed::initialize()
+void Seed::initialize(bool lazy)
 {
     /*
      * Create base roots
@@ -18,11 +24,10 @@ void Seed::initialize()
     Vector3d iheading(0,0,-1);
 
     // Taproot
-    Root* taproot = new Root(plant, 1, iheading ,0, nullptr, 0, 0); // tap root has root type 1
+    Root* taproot = ((RootSystem*)plant)->createRoot(1, iheading, 0); // tap root has root type 1
     taproot->addNode(rs->seedPos,0);
     this->addChild(taproot);
 
-    auto pmap = plant->getOrganRandomParameter(Organism::ot_root);
     // Basal roots
     int bt = getParamSubType(Organism::ot_root, "basal");
     if (bt>0) {
@@ -30,10 +35,10 @@ void Seed::initialize()
     } // otherwise stick with default
     if (rs->maxB>0) {
         try {
-            plant->getOrganRandomParameter(Organism::ot_root, basalType); // if the type is not defined an exception is thrown
+            plant->getSharedOrganRandomParameter(Organism::ot_root, basalType); // if the type is not defined an exception is thrown
         } catch (...) {
             std::cout << "Seed::initialize: Basal root type #" << basalType << " was not defined, using tap root parameters instead\n" << std::flush;
-            RootRandomParameter* brtp = (RootRandomParameter*)plant->getOrganRandomParameter(Organism::ot_root, 1)->copy(plant);
+            RootRandomParameter* brtp = (RootRandomParameter*)plant->getSharedOrganRandomParameter(Organism::ot_root, 1)->copy(plant);
             brtp->subType = basalType;
             plant->setOrganRandomParameter(brtp);
         }
@@ -43,7 +48,12 @@ void Seed::initialize()
         }
         double delay = rs->firstB;
         for (int i=0; i<maxB; i++) {
-            Root* basalroot = new Root(plant, basalType, iheading, delay, nullptr, 0, 0);
+            if (lazy) {
+                emergence.push_back({ delay, basalType, -1, int(emergence.size()), rs->seedPos });
+                delay += rs->delayB;
+                continue;
+            }
+            Root* basalroot = ((RootSystem*)plant)->createRoot(basalType, iheading, delay);
             basalroot->addNode(taproot->getNode(0), taproot->getNodeId(0), delay);
             this->addChild(basalroot);
             delay += rs->delayB;
@@ -56,10 +66,10 @@ void Seed::initialize()
     } // otherwise stick with default
     if ((rs->nC>0) && (rs->firstSB+rs->delaySB<maxT)) { // only if there are any shootborne roots
         try {
-            plant->getOrganRandomParameter(Organism::ot_root, shootborneType); // if the type is not defined an exception is thrown
+            plant->getSharedOrganRandomParameter(Organism::ot_root, shootborneType); // if the type is not defined an exception is thrown
         } catch (...) {
             std::cout << "Seed::initialize:Shootborne root type #" << shootborneType << " was not defined, using tap root parameters instead\n";
-            RootRandomParameter* srtp =  (RootRandomParameter*)plant->getOrganRandomParameter(Organism::ot_root, 1)->copy(plant);
+            RootRandomParameter* srtp =  (RootRandomParameter*)plant->getSharedOrganRandomParameter(Organism::ot_root, 1)->copy(plant);
             srtp->subType = shootborneType;
             plant->setOrganRandomParameter(srtp);
         }
@@ -68,13 +78,22 @@ void Seed::initialize()
         numberOfRootCrowns = ceil((maxT-rs->firstSB)/rs->delayRC); // maximal number of root crowns
         double delay = rs->firstSB;
         for (int i=0; i<numberOfRootCrowns; i++) {
-            Root* shootborne0 = new Root(plant, shootborneType, iheading ,delay, nullptr, 0, 0);
+            if (lazy) {
+                for (int j=0; j<rs->nC; j++) {
+                    emergence.push_back({ delay, shootborneType, i, int(emergence.size()), sbpos });
+                    delay += rs->delaySB;
+                }
+                sbpos.z+=rs->nz;  // move up, for next root crown
+                delay = rs->firstSB + i*rs->delayRC; // reset age
+                continue;
+            }
+            Root* shootborne0 = ((RootSystem*)plant)->createRoot(shootborneType, iheading, delay);
             // TODO fix the initial radial heading
             shootborne0->addNode(sbpos,delay);
             this->addChild(shootborne0);
             delay += rs->delaySB;
             for (int j=1; j<rs->nC; j++) {
-                Root* shootborne = new Root(plant, shootborneType, iheading ,delay, nullptr, 0, 0);
+                Root* shootborne = ((RootSystem*)plant)->createRoot(shootborneType, iheading, delay);
                 // TODO fix the initial radial heading
                 shootborne->addNode(shootborne0->getNode(0), shootborne0->getNodeId(0),delay);
                 this->addChild(shootborne);
@@ -97,9 +116,9 @@ void Seed::initialize()
 //        Vector3d isheading(0, 0, 1);//Initial Stem heading
 //        Stem* mainstem = new Stem(plant, this, 1, 0., isheading, 0., 0.); // tap root has subtype 1
 //        mainstem->addNode(sparam->seedPos, 0);
-//        children.push_back(mainstem);
-//
-//
+//        children.push_back(mainstem);
+//
+//
 //        if (sparam->maxTi>0) {
 //            if (plant->getParameter(Organ::ot_stem, tillerType)->subType<1) { // if the type is not defined, copy tap root
 //                std::cout << "Basal root type #" << basalType << " was not defined, using tap root parameters instead\n";
@@ -113,18 +132,18 @@ void Seed::initialize()
 //                int maxTi = sparam->maxTi;
 //                if (sparam->delayB>0) {
 //                    maxTi = std::min(maxTi,int(std::ceil((maxT-sparam->firstB)/sparam->delayB))); // maximal for simtime maxT
-//                }
+//                }
 //                std::cout << "maxT = " << sparam->maxTi << "\n";
-//                double delay = sparam->firstB;
+//                double delay = sparam->firstB;
 //                StemTypeParameter* tillParam = (StemTypeParameter*)plant->getParameter(Organ::ot_stem, 4);
 //                for (int i=0; i<maxTi; i++) {
 //                    Stem* tiller = new Stem(plant, this, 4, delay, isheading ,0., 0.);
 //                    tiller->addNode(sparam->seedPos,0);
-//                    children.push_back(tiller);
-//
+//                    children.push_back(tiller);
+//
 //                    std::cout << "new maxT type is main stem = " << sparam->maxTi << "\n";
 //                }
-//
+//
 //            }
 //
 //            //	Stem* tiller1 = new Stem(plant, this, 1, 2, isheading ,0., 0.); // tap root has subtype 1
@@ -139,7 +158,7 @@ void Seed::initialize()
 //            //	children.push_back(tiller3);
 //        }
 //
-//    }
+//    }
 }
 
 /**
@@ -159,7 +178,7 @@ std::vector<Organ*> Seed::copyBaseOrgans()
  */
 int Seed::getParamSubType(int organtype, std::string str)
 {
-    auto orp = plant->getOrganRandomParameter(organtype);
+    auto orp = plant->getSharedOrganRandomParameter(organtype);
     for (auto& o:orp) {
         if (o->name == str) {
             return o->subType;
@@ -7,6 +7,20 @@
 
 namespace CRootBox {
 
+/**
+ * Emergence of a base root, that is created not before its emergence time (see Seed::initialize, RootSystem::setLazyBaseRoots)
+ */
+struct BaseRootEmergence
+{
+    double time; ///< emergence time [day]
+    int subType; ///< root sub type
+    int crown; ///< root crown (starting with 0), or -1 for basal roots
+    int index; ///< index in the order of the base roots, for equal emergence times
+    Vector3d position; ///< position of the first node [cm]
+
+    bool operator>(const BaseRootEmergence& e) const { return (time>e.time) || ((time==e.time) && (index>e.index)); } ///< later emergence
+};
+
 /**
  * Seed
  *
@@ -21,7 +35,7 @@ public:
 
 	virtual int organType() const override { return Organism::ot_seed; }
 
-	void initialize();
+	void initialize(bool lazy = false);
 
     SeedSpecificParameter* param() const { return (SeedSpecificParameter*)param_; }
 
@@ -30,15 +44,17 @@ public:
 	int getNumberOfRootCrowns() const { return numberOfRootCrowns; }
 	std::vector<Organ*>& baseOrgans() { return children; }
 	std::vector<Organ*> copyBaseOrgans();
+	const std::vector<BaseRootEmergence>& getEmergence() const { return emergence; } ///< base roots that are not created yet (lazy initialization)
 
 	// default positions
 	int basalType = 4;
-	int shootborneType = 5;
+	int shootborneType = 5;
 	int tillerType = 4;
 
 protected:
 
     int numberOfRootCrowns = 0;
+    std::vector<BaseRootEmergence> emergence; ///< see Seed::initialize
 	int getParamSubType(int organtype, std::string str);
 
 };
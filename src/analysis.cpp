@@ -3,11 +3,15 @@
 
 #include "Organ.h"
 #include "Organism.h"
+#include "raster.h"
+#include "soil.h"
+#include "rsml.h"
 
 #include <iomanip>
 #include <istream>
 #include <fstream>
 #include <set>
+#include <algorithm>
 
 namespace CRootBox {
 
@@ -26,6 +30,24 @@ SegmentAnalyser::SegmentAnalyser(const Organism& plant)
     assert(segments.size()==segO.size());
 }
 
+/**
+ * Copies the line segments read from a RSML file to the analysis class.
+ * The segment data (e.g. root properties) are added as user data, and can be retrieved by name with SegmentAnalyser::getParameter.
+ * There are no segment origins, parameters of the organs are zero.
+ *
+ * @param rsml      the segments of a RSML file
+ */
+SegmentAnalyser::SegmentAnalyser(const RSMLReader& rsml)
+{
+    nodes = rsml.nodes;
+    segments = rsml.segments;
+    segCTs = rsml.segCTs;
+    segO.resize(segments.size(), nullptr);
+    for (const auto& name : rsml.getDataNames()) {
+        addUserData(rsml.getData(name), name);
+    }
+}
+
 /**
  * Adds all line segments from  @param plant to the analysis
  */
@@ -53,9 +75,23 @@ void SegmentAnalyser::addSegments(const SegmentAnalyser& a)
     assert(segments.size()==segO.size());
 }
 
+/**
+ * @return the segment radii for surface and volume, from the user data "radius" if present (e.g. of a snapshot), otherwise from the organs
+ */
+std::vector<double> SegmentAnalyser::getRadii() const
+{
+    auto it = std::find(userDataNames.begin(), userDataNames.end(), "radius");
+    if (it!=userDataNames.end()) {
+        return userData[it-userDataNames.begin()];
+    }
+    return Organ::getParameters(Organ::pi_radius, segO, numberOfThreads);
+}
+
 /**
  * Returns a specific parameter per root segment
  *
+ * Organ parameters are evaluated once per organ, and in parallel over the organs (@see SegmentAnalyser::setNumberOfThreads).
+ *
  * @param st    parameter type @see RootSystem::ScalarType per segment
  * \return      vector containing parameter value per segment
  */
@@ -67,22 +103,21 @@ std::vector<double> SegmentAnalyser::getParameter(std::string name) const
         return data;
     }
     if (name == "length") {
-        for (size_t i=0; i<data.size(); i++) {
-            data.at(i) = getSegmentLength(i);
-        }
-        return data;
+        return getSegmentLengths();
     }
     if (name == "surface") {
+        data = getRadii();
+        std::vector<double> l = getSegmentLengths();
         for (size_t i=0; i<data.size(); i++) {
-            double a = segO.at(i)-> getParameter("radius");
-            data.at(i) = 2*a*M_PI*getSegmentLength(i);
+            data[i] *= 2*M_PI*l[i];
         }
         return data;
     }
     if (name == "volume") {
+        data = getRadii();
+        std::vector<double> l = getSegmentLengths();
         for (size_t i=0; i<data.size(); i++) {
-            double a = segO.at(i)-> getParameter("radius");
-            data.at(i) = a*a*M_PI*getSegmentLength(i);
+            data[i] *= data[i]*M_PI*l[i];
         }
         return data;
     }
@@ -98,11 +133,29 @@ std::vector<double> SegmentAnalyser::getParameter(std::string name) const
         data = userData.at(2);
         return data;
     }
+    for (size_t i=0; i<userDataNames.size(); i++) { // user data by name
+        if (userDataNames[i] == name) {
+            return userData[i];
+        }
+    }
     // else pass to Organs
-    for (size_t i=0; i<segO.size(); i++) {
-        data.at(i) = segO.at(i)->getParameter(name);
+    return Organ::getParameters(Organ::parameterId(name), segO, numberOfThreads);
+}
+
+/**
+ * Returns the lengths of all segments, in a single pass without bounds checks
+ */
+std::vector<double> SegmentAnalyser::getSegmentLengths() const
+{
+    std::vector<double> l(segments.size());
+    const Vector3d* n = nodes.data();
+    for (size_t i=0; i<segments.size(); i++) {
+        const Vector3d& a = n[segments[i].x];
+        const Vector3d& b = n[segments[i].y];
+        double dx = a.x-b.x, dy = a.y-b.y, dz = a.z-b.z;
+        l[i] = std::sqrt(dx*dx+dy*dy+dz*dz);
     }
-    return data;
+    return l;
 }
 
 /**
@@ -130,12 +183,15 @@ void SegmentAnalyser::crop(SignedDistanceFunction* geometry)
     std::vector<Vector2i> seg;
     std::vector<Organ*> sO;
     std::vector<double> ntimes;
+    SDF_Compiled compiled(geometry); // flat program, without virtual calls
+    std::vector<double> dist;
+    compiled.getDists(nodes, dist); // all nodes at once
     for (size_t i=0; i<segments.size(); i++) {
         auto s = segments.at(i);
         Vector3d x = nodes.at(s.x);
         Vector3d y = nodes.at(s.y);
-        bool x_ = geometry->getDist(x)<=0; // in?
-        bool y_ = geometry->getDist(y)<=0; // in?
+        bool x_ = dist.at(s.x)<=0; // in?
+        bool y_ = dist.at(s.y)<=0; // in?
         if ((x_==true) && (y_==true)) { //segment is inside
             seg.push_back(s);
             sO.push_back(segO.at(i));
@@ -157,7 +213,7 @@ void SegmentAnalyser::crop(SignedDistanceFunction* geometry)
                 out = x;
             }
             // cut
-            Vector3d newnode = cut(in, out, geometry);
+            Vector3d newnode = cut(in, out, &compiled);
             // add new segment
             nodes.push_back(newnode);
             Vector2i newseg(ini,nodes.size()-1);
@@ -248,6 +304,137 @@ void SegmentAnalyser::pack() {
     nodes = newnodes; // kabum!
 }
 
+/**
+ * Returns a packed copy, whose data are independent of the organs: the parameters @param types are evaluated into
+ * user data (followed by the user data of this analyser), and the organ pointers are replaced by nullptr.
+ *
+ * Writing the copy with SegmentAnalyser::writeVTP without types gives the same file as SegmentAnalyser::write with the
+ * same types, while the organism continues to grow (@see AsyncWriter). Organ parameters of the copy are 0.
+ *
+ * @param types     parameter names (@see SegmentAnalyser::getParameter), evaluated before the organs change
+ * @return the copy
+ */
+SegmentAnalyser SegmentAnalyser::snapshot(std::vector<std::string> types) const
+{
+    SegmentAnalyser a(*this);
+    a.pack();
+    for (const auto& name : types) {
+        a.userData.push_back(getParameter(name));
+        a.userDataNames.push_back(name);
+    }
+    a.userData.insert(a.userData.end(), userData.begin(), userData.end());
+    a.userDataNames.insert(a.userDataNames.end(), userDataNames.begin(), userDataNames.end());
+    a.segO = std::vector<Organ*>(segO.size(), nullptr);
+    return a;
+}
+
+/**
+ * Level of detail: merges consecutive segments of the same organ into a single segment, as long as the nodes in between
+ * are within a distance @param tolerance of the merged segment. Branching nodes (with more or less than one
+ * incoming and one outgoing segment), and the first and last node of each organ are kept.
+ *
+ * The merged segment has the creation time of its last segment (i.e. of its second node), and the length weighted mean of
+ * the user data. Its length is the distance of its nodes, i.e. slightly less than the summed length of the merged segments.
+ * Organ parameters (e.g. radius) are unchanged, since the merged segments belong to the same organ.
+ *
+ * The merged nodes are not deleted, call SegmentAnalyser::pack afterwards.
+ *
+ * @param tolerance     maximal distance of a removed node to the merged segment [cm]
+ */
+void SegmentAnalyser::coarsen(double tolerance)
+{
+    std::vector<int> in(nodes.size(), 0), out(nodes.size(), 0), next(nodes.size(), -1); // node degrees, outgoing segment
+    for (size_t i=0; i<segments.size(); i++) {
+        out.at(segments[i].x)++;
+        in.at(segments[i].y)++;
+        next[segments[i].x] = i;
+    }
+    auto interior = [&](int s) { // is the second node of segment s within a single organ polyline
+        int n = segments[s].y;
+        return (in[n]==1) && (out[n]==1) && (segO[next[n]]==segO[s]);
+    };
+    std::vector<bool> start(segments.size(), true); // first segments of the chains
+    for (size_t i=0; i<segments.size(); i++) {
+        if (interior(i)) {
+            start[next[segments[i].y]] = false;
+        }
+    }
+    std::vector<Vector2i> seg;
+    std::vector<Organ*> sO;
+    std::vector<double> ntimes;
+    std::vector<std::vector<double>> data(userData.size());
+    std::vector<bool> visited(segments.size(), false);
+    std::vector<int> chain;
+    for (size_t i=0; i<segments.size(); i++) {
+        if (!start[i] || visited[i]) {
+            continue;
+        }
+        chain.clear();
+        int s = i;
+        chain.push_back(s);
+        visited[s] = true;
+        while (interior(s) && !visited[next[segments[s].y]]) {
+            s = next[segments[s].y];
+            chain.push_back(s);
+            visited[s] = true;
+        }
+        size_t j0 = 0;
+        while (j0<chain.size()) { // greedily merge chain[j0..j1]
+            Vector3d a = nodes[segments[chain[j0]].x];
+            size_t j1 = j0;
+            while (j1+1<chain.size()) {
+                Vector3d b = nodes[segments[chain[j1+1]].y];
+                Vector3d ab = b.minus(a);
+                double l2 = ab.times(ab);
+                bool within = true;
+                for (size_t k=j0; (k<=j1) && within; k++) { // distance of the nodes between a and b to the segment
+                    Vector3d p = nodes[segments[chain[k]].y].minus(a);
+                    double t = (l2>0) ? std::min(std::max(p.times(ab)/l2, 0.), 1.) : 0.;
+                    within = (p.minus(ab.times(t)).length()<=tolerance);
+                }
+                if (!within) {
+                    break;
+                }
+                j1++;
+            }
+            seg.push_back(Vector2i(segments[chain[j0]].x, segments[chain[j1]].y));
+            sO.push_back(segO[chain[j0]]);
+            ntimes.push_back(segCTs[chain[j1]]);
+            if (!userData.empty()) { // length weighted mean
+                double l = 0.;
+                std::vector<double> v(userData.size(), 0.);
+                for (size_t k=j0; k<=j1; k++) {
+                    double lk = getSegmentLength(chain[k]);
+                    l += lk;
+                    for (size_t u=0; u<userData.size(); u++) {
+                        v[u] += lk*userData[u][chain[k]];
+                    }
+                }
+                for (size_t u=0; u<userData.size(); u++) {
+                    data[u].push_back((l>0) ? v[u]/l : userData[u][chain[j0]]);
+                }
+            }
+            j0 = j1+1;
+        }
+    }
+    for (size_t i=0; i<segments.size(); i++) { // segments of cycles (should not happen) are kept
+        if (!visited[i]) {
+            seg.push_back(segments[i]);
+            sO.push_back(segO[i]);
+            ntimes.push_back(segCTs[i]);
+            for (size_t u=0; u<userData.size(); u++) {
+                data[u].push_back(userData[u][i]);
+            }
+        }
+    }
+    segments = seg;
+    segO = sO;
+    segCTs = ntimes;
+    for (size_t u=0; u<userData.size(); u++) {
+        userData[u] = data[u];
+    }
+}
+
 /**
  *  Numerically computes the intersection point
  *
@@ -323,42 +510,77 @@ int SegmentAnalyser::getNumberOfOrgans() const
 }
 
 /**
- * Projects the segments to an image plane (todo verify this code)
+ * Projects the segments to the image of a pinhole camera. The segments behind the image plane (closer to the camera than
+ * the focal length, or behind the camera) are cut off, the projected segments are cropped to the image.
  *
- * @param pos       position of camera
- * @param ons       orthonormal system, row 1 is orthogonal to the image plane given by [row 2,row 3]
+ * @param pos       position of the camera
+ * @param ons       orthonormal system, column 1 is the viewing direction, columns 2 and 3 are the image axes
  * @param fl        focal length, alpha = 2*arctan(d/(2*fl)), were alpha is the angle of field, and d the image diagonal
+ * @param width     image width, along column 2 of the orthonormal system
+ * @param height    image height, along column 3 of the orthonormal system
  *
- * \return The image segments in the x-y plane (z=0)
+ * \return The image segments in the x-y plane (z=0), the image center is the origin
  */
-SegmentAnalyser SegmentAnalyser::foto(const Vector3d& pos, const Matrix3d& ons, double fl) const
+SegmentAnalyser SegmentAnalyser::foto(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height) const
 {
+    if (!(fl>0) || !(width>0) || !(height>0)) {
+        std::cout << "SegmentAnalyser::foto: focal length and image size must be positive\n" << std::flush;
+        throw std::invalid_argument("SegmentAnalyser::foto: focal length and image size must be positive");
+    }
     SegmentAnalyser f(*this); // copy
-    for (auto& n : f.nodes) { // translate
-        n = n.minus(pos);
-    }
-    Matrix3d m = ons.inverse(); // rotate
-    for (auto& n : f.nodes) {
-        n = m.times(n);
-    }
-    //	// crop to objects in front of the camera
-    Vector3d o(0.,0.,0.);
-    Vector3d plane(0.,0., -1);
-    SDF_HalfPlane sdf = SDF_HalfPlane(o,plane);
-    f.crop(&sdf);
+    SDF_HalfPlane front = frustum(pos, ons, fl, width, height).at(0);
+    f.crop(&front); // objects beyond the image plane
     f.pack();
-    // project
-    for (auto& a : f.nodes) {
-        a = a.times(fl/(-plane.times(a)));
-        a.z = 0;
+    Matrix3d m = ons.inverse();
+    for (auto& a : f.nodes) { // project, lines are mapped to lines
+        Vector3d q = m.times(a.minus(pos)); // depth, and image coordinates
+        a = Vector3d(fl*q.y/q.x, fl*q.z/q.x, -1.);
     }
-    // final image crop
-    SDF_PlantBox box(1.,1.,2.); // TODO --> d = sqrt(2) cm
+    SDF_PlantBox box(width, height, 2.); // image crop, z in [-2,0]
     f.crop(&box);
     f.pack();
+    for (auto& a : f.nodes) {
+        a.z = 0.;
+    }
     return f;
 }
 
+/**
+ * Projects the segments to the image of a pinhole camera, only the segments within the view of the camera are processed
+ * (@see SegmentAnalyser::foto)
+ *
+ * @param index     index of this analyser
+ */
+SegmentAnalyser SegmentAnalyser::foto(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height,
+    const SegmentIndex& index) const
+{
+    checkIndex(index);
+    if (!(fl>0) || !(width>0) || !(height>0)) {
+        std::cout << "SegmentAnalyser::foto: focal length and image size must be positive\n" << std::flush;
+        throw std::invalid_argument("SegmentAnalyser::foto: focal length and image size must be positive");
+    }
+    SegmentAnalyser f = select(index.getInside(frustum(pos, ons, fl, width, height)));
+    f.clearUserData();
+    return f.foto(pos, ons, fl, width, height);
+}
+
+/**
+ * The view of a camera, as half planes (minus is inside): the image plane followed by the four sides
+ * (@see SegmentAnalyser::foto)
+ */
+std::vector<SDF_HalfPlane> SegmentAnalyser::frustum(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height)
+{
+    Vector3d v = ons.column(0);
+    v.normalize();
+    std::vector<SDF_HalfPlane> planes;
+    planes.push_back(SDF_HalfPlane(pos.plus(v.times(fl)), v.times(-1.)));
+    Vector3d l[4] = { Vector3d(-width/2., fl, 0.), Vector3d(-width/2., -fl, 0.), Vector3d(-height/2., 0., fl), Vector3d(-height/2., 0., -fl) };
+    for (int i=0; i<4; i++) { // normals in camera coordinates, e.g. fl*y-width/2*x <= 0
+        planes.push_back(SDF_HalfPlane(pos, ons.times(l[i])));
+    }
+    return planes;
+}
+
 /**
  * Keeps the segments that intersect with a plane
  *
@@ -383,6 +605,80 @@ SegmentAnalyser SegmentAnalyser::cut(const SDF_HalfPlane& plane) const
     return f;
 }
 
+/**
+ * Keeps the segments that intersect with a plane, only the candidates of the index are tested
+ *
+ * @param plane     half plane
+ * @param index     index of this analyser
+ */
+SegmentAnalyser SegmentAnalyser::cut(const SDF_HalfPlane& plane, const SegmentIndex& index) const
+{
+    checkIndex(index);
+    return select(index.getIntersecting(plane)).cut(plane);
+}
+
+/**
+ * Crops the segments with some geometry, only the candidates of the index are tested. In contrast to
+ * SegmentAnalyser::crop(geometry), the analyser is not changed, and the cropped segments are returned (without user data).
+ *
+ * @param geometry      signed distance function of the geometry, must not overestimate distances
+ * @param index         index of this analyser
+ */
+SegmentAnalyser SegmentAnalyser::crop(SignedDistanceFunction* geometry, const SegmentIndex& index) const
+{
+    checkIndex(index);
+    SegmentAnalyser f = select(index.getNear(*geometry));
+    f.clearUserData();
+    f.crop(geometry);
+    return f;
+}
+
+/**
+ * Copies the segments with the given indices, with their creation times, origins, and user data.
+ * Only the nodes of these segments are copied, in the order of their first use.
+ *
+ * @param indices   segment indices
+ */
+SegmentAnalyser SegmentAnalyser::select(const std::vector<int>& indices) const
+{
+    SegmentAnalyser f;
+    f.numberOfThreads = numberOfThreads;
+    std::vector<int> ni(nodes.size(), -1); // new node indices
+    auto node = [&](int i) {
+        if (ni.at(i)<0) {
+            ni[i] = f.nodes.size();
+            f.nodes.push_back(nodes[i]);
+        }
+        return ni[i];
+    };
+    for (int i : indices) {
+        const Vector2i& s = segments.at(i);
+        int x = node(s.x);
+        f.segments.push_back(Vector2i(x, node(s.y)));
+        f.segCTs.push_back(segCTs.at(i));
+        f.segO.push_back(segO.at(i));
+    }
+    for (size_t k=0; k<userData.size(); k++) {
+        std::vector<double> data(indices.size());
+        for (size_t j=0; j<indices.size(); j++) {
+            data[j] = userData[k].at(indices[j]);
+        }
+        f.addUserData(data, userDataNames[k]);
+    }
+    return f;
+}
+
+/**
+ * Throws, if the index was built for another analyser
+ */
+void SegmentAnalyser::checkIndex(const SegmentIndex& index) const
+{
+    if ((&index.getAnalyser()!=this) || (index.getNumberOfSegments()!=(int)segments.size())) {
+        std::cout << "SegmentAnalyser::checkIndex: the index was built for another analyser, or the analyser changed\n" << std::flush;
+        throw std::invalid_argument("SegmentAnalyser::checkIndex: the index was built for another analyser, or the analyser changed");
+    }
+}
+
 /**
  *  Creates a vertical distribution of the parameter of type @param st (@see RootSystem::ScalarType)
  *
@@ -395,22 +691,12 @@ SegmentAnalyser SegmentAnalyser::cut(const SDF_HalfPlane& plane) const
  */
 std::vector<double> SegmentAnalyser::distribution(std::string name, double top, double bot, int n, bool exact) const
 {
-    std::vector<double> d(n);
     double dz = (bot-top)/double(n);
-    SDF_PlantBox* layer = new SDF_PlantBox(1e100,1e100,dz);
-    for (int i=0; i<n; i++) {
-        Vector3d t(0,0,top-i*dz);
-        SDF_RotateTranslate g(layer,t);
-        if (exact) {
-            SegmentAnalyser a(*this); // copy everything
-            a.crop(&g); // crop exactly
-            d.at(i) = a.getSummed(name);
-        } else {
-            d.at(i) = this->getSummed(name, &g);
-        }
+    std::vector<double> z(n+1);
+    for (int i=0; i<=n; i++) {
+        z[i] = top-i*dz; // layer i is [top-(i+1)*dz, top-i*dz]
     }
-    delete layer;
-    return d;
+    return rasterize(name, { }, { }, z, exact);
 }
 
 /**
@@ -452,26 +738,20 @@ std::vector<SegmentAnalyser> SegmentAnalyser::distribution(double top, double bo
  */
 std::vector<std::vector<double>> SegmentAnalyser::distribution2(std::string name, double top, double bot, double left, double right, int n, int m, bool exact) const
 {
-    std::vector<std::vector<double>> d(n);
     double dz = (bot-top)/double(n);
     double dx = (right-left)/double(m);
-    SDF_PlantBox* layer = new SDF_PlantBox(dx,1e9,dz);
+    std::vector<double> x(m+1), z(n+1);
+    for (int j=0; j<=m; j++) {
+        x[j] = left+j*dx;
+    }
+    for (int i=0; i<=n; i++) {
+        z[i] = top-i*dz;
+    }
+    std::vector<double> r = rasterize(name, x, { }, z, exact);
+    std::vector<std::vector<double>> d(n);
     for (int i=0; i<n; i++) {
-        std::vector<double> row(m); // m columns
-        for (int j=0; j<m; j++) {
-            Vector3d t(left+(j+0.5)*dx,0.,top-i*dz); // box is [-x/2,-y/2,0] - [x/2,y/2,-z]
-            SDF_RotateTranslate g(layer,t);
-            if (exact) {
-                SegmentAnalyser a(*this); // copy everything
-                a.crop(&g); // crop exactly
-                row.at(j) = a.getSummed(name);
-            } else {
-                row.at(j) = this->getSummed(name, &g);
-            }
-        }
-        d.at(i)=row; // store the row (n rows)
+        d[i] = std::vector<double>(r.begin()+i*m, r.begin()+(i+1)*m); // n rows, m columns
     }
-    delete layer;
     return d;
 }
 
@@ -519,21 +799,69 @@ std::vector<std::vector<SegmentAnalyser>> SegmentAnalyser::distribution2(double
     return d;
 }
 
+/**
+ * Creates a three-dimensional distribution of the parameter @param name in a single pass over the segments (@see Raster).
+ * Length, surface, and volume are split exactly at the voxel boundaries, other parameters are added once
+ * for each voxel the segment passes (as summing the parameter of the cropped segments).
+ *
+ * @param name      parameter type @see SegmentAnalyser::getParameter
+ * @param x         voxel boundaries along the x-axis (ascending or descending), empty for an unbounded axis
+ * @param y         voxel boundaries along the y-axis
+ * @param z         voxel boundaries along the z-axis
+ * @param exact     calculates the intersection with the voxel boundaries (true), only based on segment midpoints (false)
+ * \return          the summed parameter per voxel, x-fastest (@see Raster::index)
+ */
+std::vector<double> SegmentAnalyser::rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y,
+    const std::vector<double>& z, bool exact) const
+{
+    Raster raster(x, y, z);
+    bool proportional = (name=="length") || (name=="surface") || (name=="volume");
+    return raster.rasterize(nodes, segments, getParameter(name), proportional, exact, numberOfThreads);
+}
+
+/**
+ * Creates a three-dimensional distribution of the parameter @param name, and stores it in the data of @param grid.
+ * The cell (i,j,k) of the grid is [x_i,x_i+1]x[y_j,y_j+1]x[z_k,z_k+1] (@see RectilinearGrid3D::getValue),
+ * the data at the last grid point of each axis is zero.
+ *
+ * @param name      parameter type @see SegmentAnalyser::getParameter
+ * @param grid      the grid that receives the summed parameter per cell
+ * @param exact     calculates the intersection with the cell boundaries (true), only based on segment midpoints (false)
+ */
+void SegmentAnalyser::rasterize(std::string name, RectilinearGrid3D& grid, bool exact) const
+{
+    if ((grid.nx<2) || (grid.ny<2) || (grid.nz<2)) {
+        std::cout << "SegmentAnalyser::rasterize: the grid needs at least two grid points per axis\n" << std::flush;
+        throw std::invalid_argument("SegmentAnalyser::rasterize: the grid needs at least two grid points per axis");
+    }
+    std::vector<double> r = rasterize(name, grid.xgrid->grid, grid.ygrid->grid, grid.zgrid->grid, exact);
+    std::fill(grid.data.begin(), grid.data.end(), 0.);
+    size_t l = 0;
+    for (size_t k=0; k<grid.nz-1; k++) {
+        for (size_t j=0; j<grid.ny-1; j++) {
+            for (size_t i=0; i<grid.nx-1; i++) {
+                grid.setData(i, j, k, r[l++]);
+            }
+        }
+    }
+}
+
 /**
  * Exports the simulation results with the type from the extension in name
  * (that must be lower case)
  *
  * @param name      file name e.g. output.vtp
+ * @param format    data format of VTP files: VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
  */
-void SegmentAnalyser::write(std::string name)
+void SegmentAnalyser::write(std::string name, int format)
 {
     this->pack(); // a good idea before writing any file
     std::ofstream fos;
-    fos.open(name.c_str());
+    fos.open(name.c_str(), std::ios::out | std::ios::binary);
     std::string ext = name.substr(name.size()-3,name.size()); // pick the right writer
     if (ext.compare("vtp")==0) {
         std::cout << "writing VTP: " << name << "\n" << std::flush;
-        this->writeVTP(fos,{ "radius", "subType", "creationTime" });
+        this->writeVTP(fos,{ "radius", "subType", "creationTime" }, format);
     } else if (ext.compare("txt")==0)  {
         std::cout << "writing text file for Matlab import: "<< name << "\n"<< std::flush;
         writeRBSegments(fos);
@@ -552,56 +880,49 @@ void SegmentAnalyser::write(std::string name)
  * @param os        typically a file out stream
  * @param types     multiple parameter types (@see RootSystem::ScalarType) that are saved in the VTP file,
  * 					additionally, all userdata is saved per default
+ * @param format    VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
  */
-void SegmentAnalyser::writeVTP(std::ostream & os, std::vector<std::string> types) const
+void SegmentAnalyser::writeVTP(std::ostream & os, std::vector<std::string> types, int format) const
 {
     assert(segments.size() == segO.size());
     assert(segments.size() == segCTs.size());
-    os << "<?xml version=\"1.0\"?>";
-    os << "<VTKFile type=\"PolyData\" version=\"0.1\" byte_order=\"LittleEndian\">\n";
-    os << "<PolyData>\n";
+    VTPWriter vtp(os, format);
+    vtp.begin();
     os << "<Piece NumberOfLines=\""<< segments.size() << "\" NumberOfPoints=\""<< nodes.size()<< "\">\n";
     // data (CellData)
     os << "<CellData Scalars=\" CellData\">\n";
     for (auto name : types) {
-        std::vector<double> data = getParameter(name);
-        os << "<DataArray type=\"Float32\" Name=\"" << name << "\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
-        for (const auto& t : data) {
-            os << t << " ";
-        }
-        os << "\n</DataArray>\n";
+        vtp.dataArray(name, 1, getParameter(name));
     }
     // write user data
     for (size_t i=0; i<userData.size(); i++) {
-        const auto& data = userData.at(i);
-        std::string name = userDataNames.at(i);
-        os << "<DataArray type=\"Float32\" Name=\"" << name << "\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
-        for (const auto& t : data) {
-            os << t << " ";
-        }
-        os << "\n</DataArray>\n";
+        vtp.dataArray(userDataNames.at(i), 1, userData.at(i));
     }
     os << "\n</CellData>\n";
     // nodes (Points)
-    os << "<Points>\n"<<"<DataArray type=\"Float32\" Name=\"Coordinates\" NumberOfComponents=\"3\" format=\"ascii\" >\n";
-    for (const auto& n : nodes) {
-        os << n.x << " "<< n.y <<" "<< n.z<< " ";
+    os << "<Points>\n";
+    std::vector<double> coordinates(3*nodes.size());
+    for (size_t i=0; i<nodes.size(); i++) {
+        coordinates[3*i] = nodes[i].x;
+        coordinates[3*i+1] = nodes[i].y;
+        coordinates[3*i+2] = nodes[i].z;
     }
-    os << "\n</DataArray>\n"<< "</Points>\n";
+    vtp.dataArray("Coordinates", 3, coordinates);
+    os << "</Points>\n";
     // segments (Lines)
-    os << "<Lines>\n"<<"<DataArray type=\"Int32\" Name=\"connectivity\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
-    for (const auto& s : segments) {
-        os << s.x << " " << s.y << " ";
-    }
-    os << "\n</DataArray>\n"<<"<DataArray type=\"Int32\" Name=\"offsets\" NumberOfComponents=\"1\" format=\"ascii\" >\n";
+    os << "<Lines>\n";
+    std::vector<int> connectivity(2*segments.size()), offsets(segments.size());
     for (size_t i=0; i<segments.size(); i++) {
-        os << 2*i+2 << " ";
+        connectivity[2*i] = segments[i].x;
+        connectivity[2*i+1] = segments[i].y;
+        offsets[i] = 2*i+2;
     }
-    os << "\n</DataArray>\n";
+    vtp.dataArray("connectivity", 1, connectivity);
+    vtp.dataArray("offsets", 1, offsets);
     os << "\n</Lines>\n";
     //
     os << "</Piece>\n";
-    os << "</PolyData>\n" << "</VTKFile>\n";
+    vtp.end();
 }
 
 /**
@@ -667,4 +988,891 @@ void SegmentAnalyser::writeDGF(std::ostream & os) const
     os << "# \n";
 }
 
+
+/**
+ * Creates an empty query, that selects all segments of the analyser
+ *
+ * @param ana       the analyser, it is not copied, and must not change while the query is used
+ */
+SegmentQuery::SegmentQuery(const SegmentAnalyser& ana) :ana(ana)
+{ }
+
+/**
+ * Adds a crop to the query, segments crossing the boundary are cut (@see SegmentAnalyser::crop)
+ *
+ * @param geometry      signed distance function of the geometry
+ * @return the query, to chain predicates
+ */
+SegmentQuery& SegmentQuery::crop(SignedDistanceFunction* geometry)
+{
+    Predicate p;
+    p.geometry = geometry;
+    predicates.push_back(p);
+    evaluated = false;
+    return *this;
+}
+
+/**
+ * Adds a filter to the query, keeping the segments where the parameter is within [min,max] (@see SegmentAnalyser::filter)
+ *
+ * @param name  parameter name @see SegmentAnalyser::getParameter
+ * @param min   minimal value
+ * @param max   maximal value
+ * @return the query, to chain predicates
+ */
+SegmentQuery& SegmentQuery::filter(std::string name, double min, double max)
+{
+    Predicate p;
+    p.column = getColumn(name);
+    p.min = min;
+    p.max = max;
+    p.geometry = nullptr;
+    predicates.push_back(p);
+    evaluated = false;
+    return *this;
+}
+
+/**
+ * Adds a filter to the query, keeping the segments where the parameter equals the value (@see SegmentAnalyser::filter)
+ *
+ * @param name      parameter name @see SegmentAnalyser::getParameter
+ * @param value     parameter value of the segments that are kept
+ * @return the query, to chain predicates
+ */
+SegmentQuery& SegmentQuery::filter(std::string name, double value)
+{
+    return filter(name, value, value);
+}
+
+/**
+ * Removes all predicates, i.e. the query selects all segments
+ */
+void SegmentQuery::clear()
+{
+    predicates.clear();
+    evaluated = false;
+}
+
+/**
+ * @return the indices of the selected segments within the analyser
+ */
+const std::vector<int>& SegmentQuery::getSegmentIndices()
+{
+    evaluate();
+    return selected;
+}
+
+/**
+ * @return the number of selected segments
+ */
+int SegmentQuery::getNumberOfSegments()
+{
+    evaluate();
+    return selected.size();
+}
+
+/**
+ * Sums up a parameter over the selected segments without creating a SegmentAnalyser
+ *
+ * @param name      parameter name @see SegmentAnalyser::getParameter
+ * @return the summed parameter
+ */
+double SegmentQuery::getSummed(std::string name)
+{
+    evaluate();
+    Column c = getColumn(name);
+    double v = 0.;
+    for (size_t j=0; j<selected.size(); j++) {
+        v += getValue(c, selected[j], getNode(segments[j].x), getNode(segments[j].y));
+    }
+    return v;
+}
+
+/**
+ * Creates a SegmentAnalyser containing the selected segments, including their user data.
+ *
+ * @param pack      deletes unused nodes (@see SegmentAnalyser::pack)
+ * @return the selected segments
+ */
+SegmentAnalyser SegmentQuery::getAnalyser(bool pack)
+{
+    evaluate();
+    SegmentAnalyser a;
+    a.nodes = ana.nodes;
+    a.nodes.insert(a.nodes.end(), cutNodes.begin(), cutNodes.end());
+    a.segments = segments;
+    a.segCTs.resize(selected.size());
+    a.segO.resize(selected.size());
+    for (size_t j=0; j<selected.size(); j++) {
+        a.segCTs[j] = ana.segCTs[selected[j]];
+        a.segO[j] = ana.segO[selected[j]];
+    }
+    for (size_t k=0; k<ana.userData.size(); k++) {
+        std::vector<double> data(selected.size());
+        for (size_t j=0; j<selected.size(); j++) {
+            data[j] = ana.userData[k][selected[j]];
+        }
+        a.addUserData(data, ana.userDataNames[k]);
+    }
+    if (pack) {
+        a.pack();
+    }
+    return a;
+}
+
+/**
+ * Resolves a parameter name of SegmentAnalyser::getParameter, so it can be evaluated per segment
+ */
+SegmentQuery::Column SegmentQuery::getColumn(std::string name) const
+{
+    Column c;
+    c.id = 0;
+    if (name == "creationTime") {
+        c.kind = 0;
+    } else if (name == "length") {
+        c.kind = 1;
+    } else if ((name == "surface") || (name == "volume")) {
+        c.kind = (name == "surface") ? 2 : 3;
+        c.id = Organ::pi_radius;
+        auto it = std::find(ana.userDataNames.begin(), ana.userDataNames.end(), "radius"); // e.g. of a snapshot
+        if (it != ana.userDataNames.end()) {
+            c.kind += 4; // 6 surface, 7 volume from the user data
+            c.id = it - ana.userDataNames.begin();
+        }
+    } else if ((name == "userData1") || (name == "userData2") || (name == "userData3")) {
+        c.kind = 4;
+        c.id = name.back()-'1';
+    } else if (std::find(ana.userDataNames.begin(), ana.userDataNames.end(), name) != ana.userDataNames.end()) { // user data by name
+        c.kind = 4;
+        c.id = std::find(ana.userDataNames.begin(), ana.userDataNames.end(), name) - ana.userDataNames.begin();
+    } else { // pass to Organs
+        c.kind = 5;
+        c.id = Organ::parameterId(name);
+    }
+    return c;
+}
+
+/**
+ * Evaluates a parameter for the segment @param i of the analyser, with the (possibly cropped) end points @param a and @param b.
+ * Organ parameters are evaluated once per run of segments of the same organ.
+ */
+double SegmentQuery::getValue(Column& c, int i, const Vector3d& a, const Vector3d& b) const
+{
+    switch (c.kind) {
+    case 0: return ana.segCTs[i];
+    case 1: return a.minus(b).length();
+    case 4: return ana.userData.at(c.id).at(i);
+    case 6: return 2*ana.userData.at(c.id).at(i)*M_PI*a.minus(b).length(); // surface
+    case 7: return ana.userData.at(c.id).at(i)*ana.userData.at(c.id).at(i)*M_PI*a.minus(b).length(); // volume
+    default: {
+        const Organ* o = ana.segO[i];
+        if (o!=c.last) {
+            c.last = o;
+            c.lastValue = (o!=nullptr) ? o->getParameter(c.id) : 0.; // as Organ::getParameters
+        }
+        double r = c.lastValue;
+        if (c.kind==2) {
+            return 2*r*M_PI*a.minus(b).length(); // surface
+        }
+        if (c.kind==3) {
+            return r*r*M_PI*a.minus(b).length(); // volume
+        }
+        return r;
+    }
+    }
+}
+
+/**
+ * Applies all predicates to each segment in a single pass, if the predicates changed since the last evaluation.
+ * A segment is dropped by the first predicate it fails.
+ */
+void SegmentQuery::evaluate()
+{
+    if (evaluated) {
+        return;
+    }
+    const int cutNode = -1; // marks an end point created by cropping
+    selected.clear();
+    segments.clear();
+    cutNodes.clear();
+    for (auto& p : predicates) {
+        p.column.last = nullptr; // organs might have changed since the last evaluation
+    }
+    for (size_t i=0; i<ana.segments.size(); i++) {
+        Vector2i s = ana.segments[i];
+        Vector3d a = ana.nodes.at(s.x);
+        Vector3d b = ana.nodes.at(s.y);
+        bool keep = true;
+        for (auto& p : predicates) {
+            if (p.geometry!=nullptr) { // crop
+                bool a_ = p.geometry->getDist(a)<=0; // in?
+                bool b_ = p.geometry->getDist(b)<=0; // in?
+                if (!a_ && !b_) { // segment is outside
+                    keep = false;
+                } else if (a_ != b_) { // one node is inside, one outside, the inside node comes first
+                    if (!a_) {
+                        std::swap(a, b);
+                        std::swap(s.x, s.y);
+                    }
+                    b = SegmentAnalyser::cut(a, b, p.geometry);
+                    s.y = cutNode;
+                }
+            } else { // filter
+                double v = getValue(p.column, i, a, b);
+                keep = (v>=p.min) && (v<=p.max);
+            }
+            if (!keep) {
+                break;
+            }
+        }
+        if (keep) {
+            if (s.x==cutNode) {
+                cutNodes.push_back(a);
+                s.x = ana.nodes.size()+cutNodes.size()-1;
+            }
+            if (s.y==cutNode) {
+                cutNodes.push_back(b);
+                s.y = ana.nodes.size()+cutNodes.size()-1;
+            }
+            selected.push_back(i);
+            segments.push_back(s);
+        }
+    }
+    evaluated = true;
+}
+
+/**
+ * Creates a view selecting all segments of the organism, i.e. the segments (p,i) of all nodes i with a preceding node p
+ *
+ * @param plant     the organism, it is not copied, and must not change while the view is used
+ */
+SegmentView::SegmentView(const Organism& plant) :plant(plant), store(plant.getNodeStore())
+{
+    int n = std::min(plant.getNumberOfNodes(), store.size());
+    selected.reserve(n);
+    for (int i=0; i<n; i++) {
+        if (store.getPrev(i)>=0) {
+            selected.push_back(i);
+        }
+    }
+}
+
+/**
+ * Calls f(j, i, s, a, b) for each selected segment j in order, where i is its second node index in the organism,
+ * s its node indices (-1 for end points created by cropping), and a and b its end points
+ */
+template<class F>
+void SegmentView::forEach(const F& f) const
+{
+    size_t c = 0; // next cut segment
+    for (size_t j=0; j<selected.size(); j++) {
+        int i = selected[j];
+        if ((c<cuts.size()) && (cuts[c].j==int(j))) {
+            f(j, i, cuts[c].s, cuts[c].a, cuts[c].b);
+            c++;
+        } else {
+            int p = store.getPrev(i);
+            f(j, i, Vector2i(p, i), store.getNode(p), store.getNode(i));
+        }
+    }
+}
+
+/**
+ * Keeps the segments, where the parameter is within [min,max] (@see SegmentAnalyser::filter)
+ *
+ * @param name  parameter name @see SegmentAnalyser::getParameter
+ * @param min   minimal value
+ * @param max   maximal value
+ * @return the view, to chain filters
+ */
+SegmentView& SegmentView::filter(std::string name, double min, double max)
+{
+    Column col = getColumn(name);
+    std::vector<int> sel;
+    std::vector<Cut> cs;
+    size_t c = 0;
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        bool cut = (c<cuts.size()) && (cuts[c].j==int(j));
+        double v = getValue(col, i, a, b);
+        if ((v>=min) && (v<=max)) {
+            if (cut) {
+                cs.push_back(cuts[c]);
+                cs.back().j = sel.size();
+            }
+            sel.push_back(i);
+        }
+        if (cut) {
+            c++;
+        }
+    });
+    selected.swap(sel);
+    cuts.swap(cs);
+    return *this;
+}
+
+/**
+ * Keeps the segments, where the parameter equals the value (@see SegmentAnalyser::filter)
+ *
+ * @param name      parameter name @see SegmentAnalyser::getParameter
+ * @param value     parameter value of the segments that are kept
+ * @return the view, to chain filters
+ */
+SegmentView& SegmentView::filter(std::string name, double value)
+{
+    return filter(name, value, value);
+}
+
+/**
+ * Keeps the segments within the geometry (@see SegmentAnalyser::crop). Segments crossing the boundary are cut,
+ * only their new end points are stored in the view.
+ *
+ * @param geometry      signed distance function of the geometry
+ * @return the view, to chain filters
+ */
+SegmentView& SegmentView::crop(SignedDistanceFunction* geometry)
+{
+    const int cutNode = -1; // marks an end point created by cropping
+    std::vector<int> sel;
+    std::vector<Cut> cs;
+    size_t c = 0;
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        bool cut = (c<cuts.size()) && (cuts[c].j==int(j));
+        if (cut) {
+            c++;
+        }
+        bool a_ = geometry->getDist(a)<=0; // in?
+        bool b_ = geometry->getDist(b)<=0; // in?
+        if (a_ && b_) { // segment is inside
+            if (cut) {
+                cs.push_back(cuts[c-1]);
+                cs.back().j = sel.size();
+            }
+            sel.push_back(i);
+        } else if (a_ || b_) { // one node is inside, one outside, the inside node comes first
+            Cut ci;
+            ci.j = sel.size();
+            ci.s = a_ ? s : Vector2i(s.y, s.x);
+            ci.a = a_ ? a : b;
+            ci.b = SegmentAnalyser::cut(ci.a, a_ ? b : a, geometry);
+            ci.s.y = cutNode;
+            cs.push_back(ci);
+            sel.push_back(i);
+        }
+    });
+    selected.swap(sel);
+    cuts.swap(cs);
+    return *this;
+}
+
+/**
+ * @return the parameter per selected segment (@see SegmentAnalyser::getParameter), without user data
+ */
+std::vector<double> SegmentView::getParameter(std::string name) const
+{
+    Column col = getColumn(name);
+    std::vector<double> data(selected.size());
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        data[j] = getValue(col, i, a, b);
+    });
+    return data;
+}
+
+/**
+ * @return the summed parameter over the selected segments (@see SegmentAnalyser::getSummed)
+ */
+double SegmentView::getSummed(std::string name) const
+{
+    Column col = getColumn(name);
+    double v = 0.;
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        v += getValue(col, i, a, b);
+    });
+    return v;
+}
+
+/**
+ * @return the summed parameter over the selected segments within the geometry, based on the segment mid points
+ * (@see SegmentAnalyser::getSummed)
+ */
+double SegmentView::getSummed(std::string name, SignedDistanceFunction* geometry) const
+{
+    Column col = getColumn(name);
+    double v = 0.;
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        if (geometry->getDist(a.plus(b).times(0.5))<0) {
+            v += getValue(col, i, a, b);
+        }
+    });
+    return v;
+}
+
+/**
+ * Vertical distribution of a parameter of the selected segments (@see SegmentAnalyser::distribution)
+ *
+ * @param name      parameter name @see SegmentAnalyser::getParameter
+ * @param top       vertical top position (cm)
+ * @param bot       vertical bot position (cm)
+ * @param n         number of layers (each with a height of (bot-top)/n )
+ * @param exact     calculates the intersection with the layer boundaries (true), only based on segment midpoints (false)
+ * \return Vector of size @param n containing the summed parameter in this layer
+ */
+std::vector<double> SegmentView::distribution(std::string name, double top, double bot, int n, bool exact) const
+{
+    double dz = (bot-top)/double(n);
+    std::vector<double> z(n+1);
+    for (int i=0; i<=n; i++) {
+        z[i] = top-i*dz; // layer i is [top-(i+1)*dz, top-i*dz]
+    }
+    return rasterize(name, { }, { }, z, exact);
+}
+
+/**
+ * Three-dimensional distribution of a parameter of the selected segments (@see SegmentAnalyser::rasterize)
+ *
+ * @param name      parameter name @see SegmentAnalyser::getParameter
+ * @param x         voxel boundaries along the x-axis
+ * @param y         voxel boundaries along the y-axis
+ * @param z         voxel boundaries along the z-axis
+ * @param exact     calculates the intersection with the voxel boundaries (true), only based on segment midpoints (false)
+ * \return          the summed parameter per voxel, x-fastest (@see Raster::index)
+ */
+std::vector<double> SegmentView::rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y,
+    const std::vector<double>& z, bool exact) const
+{
+    Raster raster(x, y, z);
+    bool proportional = (name=="length") || (name=="surface") || (name=="volume");
+    size_t c = 0; // next cut segment
+    auto segment = [&](size_t j, Vector3d& a, Vector3d& b) {
+        if ((c<cuts.size()) && (cuts[c].j==int(j))) {
+            a = cuts[c].a;
+            b = cuts[c].b;
+            c++;
+        } else {
+            a = store.getNode(store.getPrev(selected[j]));
+            b = store.getNode(selected[j]);
+        }
+    };
+    return raster.rasterize(selected.size(), segment, getParameter(name), proportional, exact);
+}
+
+/**
+ * Creates a SegmentAnalyser containing the selected segments. The nodes are those of the organism (@see Organism::getNodes),
+ * followed by the end points created by cropping.
+ *
+ * @return the selected segments
+ */
+SegmentAnalyser SegmentView::getAnalyser() const
+{
+    SegmentAnalyser ana;
+    int n = std::min(plant.getNumberOfNodes(), store.size());
+    ana.nodes.resize(plant.getNumberOfNodes());
+    for (int i=0; i<n; i++) {
+        ana.nodes[i] = store.getNode(i);
+    }
+    ana.segments.reserve(selected.size());
+    ana.segCTs.reserve(selected.size());
+    ana.segO.reserve(selected.size());
+    forEach([&](size_t j, int i, const Vector2i& s, const Vector3d& a, const Vector3d& b) {
+        Vector2i si = s;
+        if (si.x<0) {
+            ana.nodes.push_back(a);
+            si.x = ana.nodes.size()-1;
+        }
+        if (si.y<0) {
+            ana.nodes.push_back(b);
+            si.y = ana.nodes.size()-1;
+        }
+        ana.segments.push_back(si);
+        ana.segCTs.push_back(store.getNodeCT(i)); // segment creation time is the node creation time of the second node
+        ana.segO.push_back(store.getOrgan(i));
+    });
+    return ana;
+}
+
+/**
+ * Resolves a parameter name of SegmentAnalyser::getParameter, so it can be evaluated per segment
+ */
+SegmentView::Column SegmentView::getColumn(std::string name) const
+{
+    Column c;
+    c.id = 0;
+    if (name == "creationTime") {
+        c.kind = 0;
+    } else if (name == "length") {
+        c.kind = 1;
+    } else if ((name == "surface") || (name == "volume")) {
+        c.kind = (name == "surface") ? 2 : 3;
+        c.id = Organ::pi_radius;
+    } else { // pass to Organs
+        c.kind = 5;
+        c.id = Organ::parameterId(name);
+    }
+    return c;
+}
+
+/**
+ * Evaluates a parameter for the segment ending in node @param i, with the (possibly cropped) end points @param a and @param b.
+ * Organ parameters are evaluated once per run of segments of the same organ.
+ */
+double SegmentView::getValue(Column& c, int i, const Vector3d& a, const Vector3d& b) const
+{
+    switch (c.kind) {
+    case 0: return store.getNodeCT(i);
+    case 1: return a.minus(b).length();
+    default: {
+        const Organ* o = store.getOrgan(i);
+        if (o!=c.last) {
+            c.last = o;
+            c.lastValue = (o!=nullptr) ? o->getParameter(c.id) : 0.; // as Organ::getParameters
+        }
+        double r = c.lastValue;
+        if (c.kind==2) {
+            return 2*r*M_PI*a.minus(b).length(); // surface
+        }
+        if (c.kind==3) {
+            return r*r*M_PI*a.minus(b).length(); // volume
+        }
+        return r;
+    }
+    }
+}
+
+/**
+ * Packs the segments of an analyser
+ *
+ * @param ana           the analyser
+ * @param precision     PackedColumn::p_float, or PackedColumn::p_quantized (or PackedColumn::p_double)
+ * @param resolution    step of quantized coordinates [cm]
+ * @param origin        origin of quantized coordinates, e.g. the seed position [cm]
+ */
+PackedSegments::PackedSegments(const SegmentAnalyser& ana, int precision, double resolution, Vector3d origin)
+    :segments(ana.segments), segO(ana.segO)
+{
+    x.setPrecision(precision, resolution, origin.x);
+    y.setPrecision(precision, resolution, origin.y);
+    z.setPrecision(precision, resolution, origin.z);
+    ct.setPrecision(std::min(precision, int(PackedColumn::p_float)));
+    size_t n = ana.nodes.size();
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    for (size_t i=0; i<n; i++) {
+        x.set(i, ana.nodes[i].x);
+        y.set(i, ana.nodes[i].y);
+        z.set(i, ana.nodes[i].z);
+    }
+    ct.resize(ana.segCTs.size());
+    for (size_t i=0; i<ana.segCTs.size(); i++) {
+        ct.set(i, ana.segCTs[i]);
+    }
+}
+
+/**
+ * @return an analyser with the packed segments, nodes and creation times are rounded to the storage precision
+ */
+SegmentAnalyser PackedSegments::unpack() const
+{
+    SegmentAnalyser a;
+    a.nodes.resize(x.size());
+    for (size_t i=0; i<x.size(); i++) {
+        a.nodes[i] = Vector3d(x.get(i), y.get(i), z.get(i));
+    }
+    a.segments = segments;
+    a.segCTs.resize(ct.size());
+    for (size_t i=0; i<ct.size(); i++) {
+        a.segCTs[i] = ct.get(i);
+    }
+    a.segO = segO;
+    return a;
+}
+
+/**
+ * @return the memory of nodes, segments, creation times, and origins [bytes]
+ */
+size_t PackedSegments::getMemory() const
+{
+    return x.getMemory()+y.getMemory()+z.getMemory()+ct.getMemory()+segments.capacity()*sizeof(Vector2i)+segO.capacity()*sizeof(Organ*);
+}
+
+/**
+ * Builds the hierarchy, the segments are split at the median of the longest axis of their boxes
+ *
+ * @param ana           the analyser, is not copied, and must not change while the index is used
+ * @param leafSize      maximal number of segments per leaf
+ */
+SegmentIndex::SegmentIndex(const SegmentAnalyser& ana, int leafSize) :ana(ana)
+{
+    size_t n = ana.segments.size();
+    order.resize(n);
+    lower.resize(n);
+    upper.resize(n);
+    for (size_t i=0; i<n; i++) {
+        const Vector3d& a = ana.nodes.at(ana.segments[i].x);
+        const Vector3d& b = ana.nodes.at(ana.segments[i].y);
+        order[i] = i;
+        lower[i] = Vector3d(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+        upper[i] = Vector3d(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+    }
+    tree.reserve(2*n/std::max(leafSize, 1)+1);
+    if (n>0) {
+        build(0, n, std::max(leafSize, 1));
+    }
+}
+
+/**
+ * Builds the subtree of the segments order[first, first+count)
+ *
+ * @return the index of the subtree's root
+ */
+int SegmentIndex::build(int first, int count, int leafSize)
+{
+    Vector3d lo = lower[order[first]], hi = upper[order[first]];
+    for (int i=first+1; i<first+count; i++) {
+        const Vector3d& l = lower[order[i]];
+        const Vector3d& u = upper[order[i]];
+        lo = Vector3d(std::min(lo.x, l.x), std::min(lo.y, l.y), std::min(lo.z, l.z));
+        hi = Vector3d(std::max(hi.x, u.x), std::max(hi.y, u.y), std::max(hi.z, u.z));
+    }
+    int c = tree.size();
+    tree.push_back(Node{ lo.plus(hi).times(0.5), hi.minus(lo).times(0.5), first, count, -1 });
+    if (count<=leafSize) {
+        return c;
+    }
+    Vector3d d = hi.minus(lo);
+    int axis = ((d.x>=d.y) && (d.x>=d.z)) ? 0 : ((d.y>=d.z) ? 1 : 2);
+    auto mid = [&](int i) {
+        Vector3d m = lower[i].plus(upper[i]);
+        return (axis==0) ? m.x : ((axis==1) ? m.y : m.z);
+    };
+    int half = count/2;
+    std::nth_element(order.begin()+first, order.begin()+first+half, order.begin()+first+count,
+        [&](int a, int b) { return mid(a)<mid(b); });
+    tree[c].count = 0;
+    build(first, half, leafSize);
+    int r = build(first+half, count-half, leafSize);
+    tree[c].right = r;
+    return c;
+}
+
+/**
+ * Traverses the hierarchy, skipping the boxes where @param outside is true
+ *
+ * @return the segments of the remaining leaves (and of boxes, that are not outside), ordered by index
+ */
+std::vector<int> SegmentIndex::query(const std::function<bool(const Node&)>& outside) const
+{
+    std::vector<int> candidates;
+    if (tree.empty()) {
+        return candidates;
+    }
+    std::vector<int> stack = { 0 };
+    while (!stack.empty()) {
+        const Node& node = tree[stack.back()];
+        int c = stack.back();
+        stack.pop_back();
+        if (outside(node)) {
+            continue;
+        }
+        if (node.count>0) {
+            candidates.insert(candidates.end(), order.begin()+node.first, order.begin()+node.first+node.count);
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(c+1);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    return candidates;
+}
+
+/**
+ * The candidate segments, that might cross the plane (@see SegmentAnalyser::cut)
+ *
+ * @param plane     half plane
+ */
+std::vector<int> SegmentIndex::getIntersecting(const SDF_HalfPlane& plane) const
+{
+    const Vector3d& n = plane.n;
+    return query([&](const Node& b) {
+        double r = std::abs(n.x)*b.extent.x+std::abs(n.y)*b.extent.y+std::abs(n.z)*b.extent.z; // projected radius of the box
+        double d = plane.getDist(b.center);
+        return std::abs(d)>r*(1.+1.e-12)+1.e-12; // completely on one side
+    });
+}
+
+/**
+ * The candidate segments, that might be (partly) within all half planes, i.e. within their convex intersection
+ * (e.g. the view of a camera, @see SegmentAnalyser::foto)
+ *
+ * @param planes    half planes, minus is inside
+ */
+std::vector<int> SegmentIndex::getInside(const std::vector<SDF_HalfPlane>& planes) const
+{
+    return query([&](const Node& b) {
+        for (const auto& p : planes) {
+            double r = std::abs(p.n.x)*b.extent.x+std::abs(p.n.y)*b.extent.y+std::abs(p.n.z)*b.extent.z;
+            if (p.getDist(b.center)>r*(1.+1.e-12)+1.e-12) { // completely outside of the plane
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+/**
+ * The candidate segments, that might be (partly) within the geometry (@see SegmentAnalyser::crop).
+ * A box is outside, if the distance of its center exceeds its half diagonal, i.e. the geometry must not overestimate distances.
+ *
+ * @param geometry  signed distance function
+ */
+std::vector<int> SegmentIndex::getNear(const SignedDistanceFunction& geometry) const
+{
+    return query([&](const Node& b) {
+        return geometry.getDist(b.center)>b.extent.length()*(1.+1.e-12)+1.e-12;
+    });
+}
+
+/**
+ * Sorts the segments of the analyser by their creation times (stable, i.e. segments created at the same time keep
+ * their order)
+ *
+ * @param ana       the analyser, it is not copied and must not change while the index is used
+ */
+CreationTimeIndex::CreationTimeIndex(const SegmentAnalyser& ana) :ana(ana)
+{
+    if (ana.segCTs.size()!=ana.segments.size()) {
+        std::cout << "CreationTimeIndex::CreationTimeIndex: each segment needs a creation time\n" << std::flush;
+        throw std::invalid_argument("CreationTimeIndex::CreationTimeIndex: each segment needs a creation time");
+    }
+    order.resize(ana.segments.size());
+    for (size_t i=0; i<order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return ana.segCTs[a]<ana.segCTs[b]; });
+    cts.resize(order.size());
+    for (size_t i=0; i<order.size(); i++) {
+        cts[i] = ana.segCTs[order[i]];
+    }
+}
+
+/**
+ * @return the number of segments with a creation time <= @param t [day], O(log n)
+ */
+int CreationTimeIndex::getNumberOfSegments(double t) const
+{
+    return std::upper_bound(cts.begin(), cts.end(), t)-cts.begin();
+}
+
+/**
+ * @return the indices of the segments with a creation time <= @param t [day], ordered by their creation times
+ */
+std::vector<int> CreationTimeIndex::getSegments(double t) const
+{
+    return std::vector<int>(order.begin(), order.begin()+getNumberOfSegments(t));
+}
+
+/**
+ * The parameter values of the analyser (@see SegmentAnalyser::getParameter), in the sorted order
+ */
+const std::vector<double>& CreationTimeIndex::getValues(std::string name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = values.find(name);
+    if (it==values.end()) {
+        std::vector<double> v = ana.getParameter(name);
+        std::vector<double> sorted(order.size());
+        std::vector<double> sums(order.size()+1);
+        for (size_t i=0; i<order.size(); i++) {
+            sorted[i] = v.at(order[i]);
+            sums[i+1] = sums[i]+sorted[i];
+        }
+        prefix[name] = sums;
+        it = values.insert(std::make_pair(name, sorted)).first;
+    }
+    return it->second; // map elements are not moved by later insertions
+}
+
+/**
+ * The summed parameter of the segments created until time @param t, like SegmentAnalyser::getSummed of the snapshot.
+ * The first call per parameter name computes its prefix sums, later calls are O(log n).
+ *
+ * @param name      parameter name (@see SegmentAnalyser::getParameter)
+ * @param t         time [day]
+ */
+double CreationTimeIndex::getSummed(std::string name, double t) const
+{
+    getValues(name);
+    std::lock_guard<std::mutex> lock(mutex);
+    return prefix.at(name).at(getNumberOfSegments(t));
+}
+
+/**
+ * The vertical distribution of the segments created until time @param t (@see SegmentAnalyser::distribution)
+ */
+std::vector<double> CreationTimeIndex::distribution(std::string name, double top, double bot, int n, bool exact, double t) const
+{
+    return distribution(name, top, bot, n, exact, std::vector<double>{ t }).at(0);
+}
+
+/**
+ * Vertical distributions of the segments created until each of the times (@see SegmentAnalyser::distribution).
+ * The segments created between two consecutive times are rasterized, and added to the previous distribution,
+ * so each segment is only rasterized once.
+ *
+ * @param name      parameter name (@see SegmentAnalyser::getParameter)
+ * @param top       vertical top position (cm)
+ * @param bot       vertical bot position (cm)
+ * @param n         number of layers (each with a height of (bot-top)/n )
+ * @param exact     calculates the intersection with the layer boundaries (true), only based on segment midpoints (false)
+ * @param times     increasing times [day]
+ * @return a distribution per time
+ */
+std::vector<std::vector<double>> CreationTimeIndex::distribution(std::string name, double top, double bot, int n, bool exact,
+    const std::vector<double>& times) const
+{
+    if (!std::is_sorted(times.begin(), times.end())) {
+        std::cout << "CreationTimeIndex::distribution: times must be increasing\n" << std::flush;
+        throw std::invalid_argument("CreationTimeIndex::distribution: times must be increasing");
+    }
+    double dz = (bot-top)/double(n);
+    std::vector<double> z(n+1);
+    for (int i=0; i<=n; i++) {
+        z[i] = top-i*dz; // layer i is [top-(i+1)*dz, top-i*dz]
+    }
+    Raster raster({ }, { }, z);
+    bool proportional = (name=="length") || (name=="surface") || (name=="volume");
+    const std::vector<double>& v = getValues(name);
+    std::vector<std::vector<double>> d;
+    std::vector<double> current(n, 0.);
+    int k0 = 0;
+    std::vector<Vector2i> segs;
+    for (double t : times) {
+        int k1 = getNumberOfSegments(t);
+        segs.resize(k1-k0);
+        for (int k=k0; k<k1; k++) {
+            segs[k-k0] = ana.segments[order[k]];
+        }
+        if (k1>k0) {
+            auto r = raster.rasterize(ana.nodes, segs, std::vector<double>(v.begin()+k0, v.begin()+k1), proportional, exact,
+                ana.getNumberOfThreads());
+            for (int i=0; i<n; i++) {
+                current[i] += r[i];
+            }
+        }
+        d.push_back(current);
+        k0 = k1;
+    }
+    return d;
+}
+
+/**
+ * The segments created until time @param t as analyser, e.g. for writing.
+ * The segments keep their original order, user data are kept (@see SegmentAnalyser::select).
+ */
+SegmentAnalyser CreationTimeIndex::getSnapshot(double t) const
+{
+    std::vector<int> indices = getSegments(t);
+    std::sort(indices.begin(), indices.end());
+    return ana.select(indices);
+}
+
 } // end namespace CRootBox
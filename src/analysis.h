@@ -3,23 +3,43 @@
 #define ANALYSIS_H_
 
 #include "sdf.h"
+#include "vtpwriter.h"
+#include "packedcolumn.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
 
 namespace CRootBox {
 
 class Organism;
 class Organ;
+class NodeStore;
+class SegmentQuery;
+class SegmentIndex;
+class RectilinearGrid3D;
+class RSMLReader;
 
 /**
  * Meshfree analysis of the root system based on signed distance functions.
+ *
+ * Thread safety: the analyser holds copies of the segments, different analysers can be used by different threads at the same time.
+ * The constructor reads the organism, which must not be used by another thread meanwhile (@see Organism).
+ * The const methods of a single analyser can be called concurrently, if its geometries, and the organs of the
+ * segments (read by SegmentAnalyser::getParameter) are not modified meanwhile.
  */
 class SegmentAnalyser
 {
 
+    friend SegmentQuery;
+
 public:
 
     SegmentAnalyser() { }; ///< creates an empty object (use AnalysisSDF::addSegments)
     SegmentAnalyser(const Organism& plant); ///< creates an analyser object containing the segments from the root system
-    SegmentAnalyser(const SegmentAnalyser& a) : nodes(a.nodes), segments(a.segments), segCTs(a.segCTs), segO(a.segO) { } ///< copy constructor, does not copy user data
+    SegmentAnalyser(const RSMLReader& rsml); ///< creates an analyser object containing the segments read from RSML, with their data as user data
+    SegmentAnalyser(const SegmentAnalyser& a) : nodes(a.nodes), segments(a.segments), segCTs(a.segCTs), segO(a.segO),
+        numberOfThreads(a.numberOfThreads) { } ///< copy constructor, does not copy user data
     virtual ~SegmentAnalyser() { }; ///< nothing to do here
 
     // merge segments
@@ -28,35 +48,47 @@ public:
 
     // reduce number of segments
     void crop(SignedDistanceFunction* geometry); ///< crops the data to a geometry
+    SegmentAnalyser crop(SignedDistanceFunction* geometry, const SegmentIndex& index) const; ///< returns the segments cropped to a geometry, using the index
+    SegmentAnalyser select(const std::vector<int>& indices) const; ///< returns the segments with the given indices, and their nodes
     void filter(std::string name, double min, double max); ///< filters the segments to the data @see AnalysisSDF::getScalar
     void filter(std::string name, double value); ///< filters the segments to the data @see AnalysisSDF::getScalar
     void pack(); ///< sorts the nodes and deletes unused nodes
+    void coarsen(double tolerance); ///< merges consecutive segments of the same organ, keeping branching nodes (level of detail)
 
     // some things we might want to know
     std::vector<double> getParameter(std::string name) const; ///< Returns a specific parameter per segment @see RootSystem::ScalarType
     double getSegmentLength(int i) const; ///< returns the length of a segment
+    std::vector<double> getSegmentLengths() const; ///< returns the lengths of all segments
     double getSummed(std::string name) const; ///< Sums up the parameter
     double getSummed(std::string name, SignedDistanceFunction* geometry) const; ///< Sums up the parameter within the geometry
     std::vector<double> distribution(std::string name, double top, double bot, int n, bool exact=false) const; ///< vertical distribution of a parameter
     std::vector<SegmentAnalyser> distribution(double top, double bot, int n) const; ///< vertical distribution of a parameter
     std::vector<std::vector<double>> distribution2(std::string name, double top, double bot, double left, double right, int n, int m, bool exact=false) const; ///< 2d distribution (x,z) of a parameter
     std::vector<std::vector<SegmentAnalyser>> distribution2(double top, double bot, double left, double right, int n, int m) const; ///< 2d distribution (x,z) of a parameter
-    // todo distribution3
+    std::vector<double> rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+        bool exact = true) const; ///< 3d distribution of a parameter, in the voxels of a rectilinear raster @see Raster
+    void rasterize(std::string name, RectilinearGrid3D& grid, bool exact = true) const; ///< 3d distribution of a parameter, into the cells of a grid
+
+    void setNumberOfThreads(int n) { numberOfThreads = n; } ///< number of threads rasterizing the segments and evaluating organ parameters, 0 for sequential (default)
+    int getNumberOfThreads() const { return numberOfThreads; } ///< number of threads rasterizing the segments and evaluating organ parameters
 
     // rather specialized things we want to know
     std::vector<Organ*> getOrgans() const; ///< segment origins
     int getNumberOfOrgans() const; ///< number of different organs
-    SegmentAnalyser foto(const Vector3d& pos, const Matrix3d& ons, double height) const; ///< takes a picture TODO unfinished, untested
+    SegmentAnalyser foto(const Vector3d& pos, const Matrix3d& ons, double fl, double width = 1., double height = 1.) const; ///< projects the segments to a camera image
+    SegmentAnalyser foto(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height, const SegmentIndex& index) const; ///< camera image, using the index
     SegmentAnalyser cut(const SDF_HalfPlane& plane) const; ///< returns the segments intersecting with a plane (e.g. for trenches)
+    SegmentAnalyser cut(const SDF_HalfPlane& plane, const SegmentIndex& index) const; ///< returns the segments intersecting with a plane, using the index
 
     // User data for export or distributions
     void addUserData(std::vector<double> data, std::string name) { assert(data.size()==segments.size()); userData.push_back(data); userDataNames.push_back(name); }
     ///< adds user data that are written into the VTP file, @see SegmentAnalyser::writeVTP
     void clearUserData() { userData.clear(); userDataNames.clear(); } ///< resets the user data
+    SegmentAnalyser snapshot(std::vector<std::string> types = { "radius", "subType", "creationTime" }) const; ///< packed copy that does not read the organs
 
     // some exports
-    void write(std::string name); ///< writes simulation results (type is determined from file extension in name)
-    void writeVTP(std::ostream & os, std::vector<std::string>  types = { }) const; ///< writes a VTP file
+    void write(std::string name, int format = VTPWriter::ascii); ///< writes simulation results (type is determined from file extension in name)
+    void writeVTP(std::ostream & os, std::vector<std::string>  types = { }, int format = VTPWriter::ascii) const; ///< writes a VTP file
     void writeRBSegments(std::ostream & os) const; ///< Writes the segments of the root system, mimics the Matlab script getSegments()
     void writeDGF(std::ostream & os) const; ///< Writes the segments of the root system in DGF format used by DuMux
 
@@ -73,6 +105,264 @@ protected:
     std::vector<std::vector<double>> userData; ///< user data attached to the segments (for vtp file), e.g. flux, pressure, etc.
     std::vector<std::string> userDataNames; ///< names of the data added, e.g. "Flux", "Pressure", etc.
 
+    int numberOfThreads = 0; ///< for rasterizing and organ parameters, @see SegmentAnalyser::rasterize, SegmentAnalyser::getParameter
+
+    std::vector<double> getRadii() const; ///< radius per segment, for surface and volume
+    void checkIndex(const SegmentIndex& index) const; ///< throws, if the index was built for another analyser
+    static std::vector<SDF_HalfPlane> frustum(const Vector3d& pos, const Matrix3d& ons, double fl, double width, double height); ///< view of the camera
+
+};
+
+/**
+ * Bounding volume hierarchy over the segments of a SegmentAnalyser, for repeated plane cuts, crops, and camera images
+ * of the same segments (e.g. many trenches or rhizotube images per time step).
+ *
+ * The index is built once, queries return the candidate segments, whose bounding boxes are not completely on the
+ * wrong side of a plane, or outside of a geometry. The candidates are a superset of the result, they are ordered by
+ * segment index, so that SegmentAnalyser::cut, SegmentAnalyser::crop, and SegmentAnalyser::foto with an index give the
+ * same segments as without.
+ *
+ * The analyser is not copied, and must not change while the index is used. Queries are const, and can run concurrently.
+ */
+class SegmentIndex
+{
+
+public:
+
+    SegmentIndex(const SegmentAnalyser& ana, int leafSize = 8); ///< builds the hierarchy
+    virtual ~SegmentIndex() { }
+
+    std::vector<int> getIntersecting(const SDF_HalfPlane& plane) const; ///< candidates crossing the plane
+    std::vector<int> getInside(const std::vector<SDF_HalfPlane>& planes) const; ///< candidates within the intersection of the half planes
+    std::vector<int> getNear(const SignedDistanceFunction& geometry) const; ///< candidates (partly) within the geometry
+
+    const SegmentAnalyser& getAnalyser() const { return ana; }
+    int getNumberOfSegments() const { return order.size(); } ///< number of indexed segments
+
+protected:
+
+    /* a box of the hierarchy, its children are next in the array (left) and at right, or a leaf */
+    struct Node {
+        Vector3d center; ///< center of the box
+        Vector3d extent; ///< half dimensions of the box
+        int first; ///< first segment of a leaf (in SegmentIndex::order)
+        int count; ///< number of segments of a leaf, or 0 for an inner node
+        int right; ///< index of the right child of an inner node
+    };
+
+    int build(int first, int count, int leafSize); ///< builds the subtree of segments [first, first+count) in order, returns its node
+    std::vector<int> query(const std::function<bool(const Node&)>& outside) const; ///< segments of the boxes not outside
+
+    const SegmentAnalyser& ana;
+    std::vector<Node> tree; ///< depth first, the root is the first node
+    std::vector<int> order; ///< segment indices, the segments of each node are contiguous
+    std::vector<Vector3d> lower; ///< lower corner per segment
+    std::vector<Vector3d> upper; ///< upper corner per segment
+
+};
+
+/**
+ * Index of the segments of a SegmentAnalyser sorted by their creation times, for evaluating the segments
+ * at many past times (e.g. a growth movie, or a time series of distributions) of one analyser.
+ *
+ * The segments are sorted once, the segments created until a time t are then a prefix of the sorted segments,
+ * which is found by a binary search. Summed parameters at time t are looked up from prefix sums,
+ * and distributions for a list of times are accumulated in a single pass over the sorted segments.
+ * A snapshot analyser, e.g. for writing, copies only the segments of the snapshot.
+ *
+ * The parameters are those of the analyser, i.e. time dependent parameters (e.g. "age") are not rewound,
+ * nodes that moved after time t (e.g. root tips) keep their final positions.
+ *
+ * The analyser is not copied, and must not change while the index is used. Queries are const, and can run concurrently.
+ */
+class CreationTimeIndex
+{
+
+public:
+
+    CreationTimeIndex(const SegmentAnalyser& ana); ///< sorts the segments by their creation times
+    virtual ~CreationTimeIndex() { }
+
+    int getNumberOfSegments(double t) const; ///< number of segments created until time t
+    std::vector<int> getSegments(double t) const; ///< segments created until time t, ordered by their creation times
+    double getSummed(std::string name, double t) const; ///< summed parameter of the segments created until time t
+    std::vector<double> distribution(std::string name, double top, double bot, int n, bool exact, double t) const; ///< vertical distribution at time t
+    std::vector<std::vector<double>> distribution(std::string name, double top, double bot, int n, bool exact,
+        const std::vector<double>& times) const; ///< vertical distributions at increasing times, in a single pass
+    SegmentAnalyser getSnapshot(double t) const; ///< the segments created until time t, in their original order
+
+    const SegmentAnalyser& getAnalyser() const { return ana; }
+
+protected:
+
+    const std::vector<double>& getValues(std::string name) const; ///< parameter values in the sorted order, computed once per name
+
+    const SegmentAnalyser& ana;
+    std::vector<int> order; ///< segment indices, sorted by creation time
+    std::vector<double> cts; ///< sorted creation times
+    mutable std::map<std::string, std::vector<double>> values; ///< sorted parameter values, per name
+    mutable std::map<std::string, std::vector<double>> prefix; ///< prefix sums of the sorted values, per name
+    mutable std::mutex mutex; ///< guards the values and prefix sums
+
+};
+
+/**
+ * Lazy selection of the segments of a SegmentAnalyser.
+ *
+ * Filters and crops are only collected. They are evaluated together in a single pass over the segments, when the
+ * result is needed, the result is a list of selected segment indices (and the nodes created by cropping).
+ * A SegmentAnalyser is only created by SegmentQuery::getAnalyser, e.g. for writing or distributions.
+ *
+ * The predicates are applied in the order they were added, e.g. filtering by "length" after a crop uses the cropped length.
+ */
+class SegmentQuery
+{
+
+public:
+
+    SegmentQuery(const SegmentAnalyser& ana); ///< the analyser is not copied, and must not change while the query is used
+    virtual ~SegmentQuery() { }
+
+    // collect predicates
+    SegmentQuery& crop(SignedDistanceFunction* geometry); ///< keeps the segments (or their parts) within a geometry @see SegmentAnalyser::crop
+    SegmentQuery& filter(std::string name, double min, double max); ///< keeps the segments, where the parameter is within [min,max] @see SegmentAnalyser::filter
+    SegmentQuery& filter(std::string name, double value); ///< keeps the segments, where the parameter equals value @see SegmentAnalyser::filter
+    void clear(); ///< removes all predicates
+
+    // results
+    const std::vector<int>& getSegmentIndices(); ///< indices of the selected segments, within the analyser
+    int getNumberOfSegments(); ///< number of selected segments
+    double getSummed(std::string name); ///< sums up the parameter over the selected segments @see SegmentAnalyser::getSummed
+    SegmentAnalyser getAnalyser(bool pack = false); ///< materializes the selection
+
+protected:
+
+    /* a segment parameter, resolved once per predicate (@see SegmentAnalyser::getParameter) */
+    struct Column {
+        int kind; ///< 0 creation time, 1 length, 2 surface, 3 volume, 4 user data, 5 organ parameter, 6 surface and 7 volume from the radius user data
+        int id; ///< user data index, or interned organ parameter id
+        const Organ* last = nullptr; ///< last evaluated organ
+        double lastValue = 0.; ///< value of the last organ
+    };
+
+    /* a single predicate, filter if geometry is nullptr, crop otherwise */
+    struct Predicate {
+        Column column;
+        double min;
+        double max;
+        SignedDistanceFunction* geometry;
+    };
+
+    Column getColumn(std::string name) const; ///< resolves a parameter name
+    double getValue(Column& c, int i, const Vector3d& a, const Vector3d& b) const; ///< parameter of segment i with end points a and b
+    Vector3d getNode(int i) const { return (i<ana.nodes.size()) ? ana.nodes[i] : cutNodes.at(i-ana.nodes.size()); } ///< selection node
+    void evaluate(); ///< single pass over all segments
+
+    const SegmentAnalyser& ana;
+    std::vector<Predicate> predicates;
+
+    bool evaluated = false;
+    std::vector<int> selected; ///< indices of the selected segments
+    std::vector<Vector2i> segments; ///< selected segments, node indices beyond the analyser's nodes refer to cutNodes
+    std::vector<Vector3d> cutNodes; ///< nodes created by cropping
+
+};
+
+/**
+ * Non-owning view of the segments of an organism, e.g. for the diagnostics of each time step.
+ *
+ * In contrast to SegmentAnalyser(const Organism&) the geometry is not copied. The view reads the nodes, creation times,
+ * and organs in place from the NodeStore of the organism, and only holds the selected segments, as the indices of their
+ * second nodes, i.e. the segments are ordered like Organism::getCachedSegments. Filters reduce the selection. Only a crop
+ * copies, the end points of the segments that cross the boundary of the geometry. SegmentView::getAnalyser creates a
+ * SegmentAnalyser from the selection, e.g. for writing.
+ *
+ * There are no user data, parameters are the geometric ones and the organ parameters (@see SegmentAnalyser::getParameter).
+ * The organism must not change while the view is used, i.e. a view is created per time step.
+ */
+class SegmentView
+{
+
+public:
+
+    SegmentView(const Organism& plant); ///< selects all segments of the organism, which is not copied
+    virtual ~SegmentView() { }
+
+    // reduce number of segments
+    SegmentView& filter(std::string name, double min, double max); ///< keeps the segments, where the parameter is within [min,max] @see SegmentAnalyser::filter
+    SegmentView& filter(std::string name, double value); ///< keeps the segments, where the parameter equals value @see SegmentAnalyser::filter
+    SegmentView& crop(SignedDistanceFunction* geometry); ///< keeps the segments (or their parts) within a geometry @see SegmentAnalyser::crop
+
+    // some things we might want to know
+    int getNumberOfSegments() const { return selected.size(); } ///< number of selected segments
+    const std::vector<int>& getSegmentIndices() const { return selected; } ///< second node index of each selected segment
+    int getNumberOfCuts() const { return cuts.size(); } ///< number of selected segments with end points created by cropping
+    std::vector<double> getParameter(std::string name) const; ///< parameter per selected segment @see SegmentAnalyser::getParameter
+    double getSummed(std::string name) const; ///< sums up the parameter
+    double getSummed(std::string name, SignedDistanceFunction* geometry) const; ///< sums up the parameter within the geometry (based on segment mid points)
+    std::vector<double> distribution(std::string name, double top, double bot, int n, bool exact = false) const; ///< vertical distribution of a parameter
+    std::vector<double> rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+        bool exact = true) const; ///< 3d distribution of a parameter @see SegmentAnalyser::rasterize
+    SegmentAnalyser getAnalyser() const; ///< copies the selected segments
+
+    const Organism& getOrganism() const { return plant; }
+
+protected:
+
+    /* a selected segment that was cut by a crop */
+    struct Cut {
+        int j; ///< position within the selection
+        Vector2i s; ///< node indices, or -1 for end points created by cropping
+        Vector3d a; ///< first end point
+        Vector3d b; ///< second end point
+    };
+
+    /* a segment parameter, resolved once per call (@see SegmentQuery::Column) */
+    struct Column {
+        int kind; ///< 0 creation time, 1 length, 2 surface, 3 volume, 5 organ parameter
+        int id; ///< organ parameter id
+        const Organ* last = nullptr; ///< last evaluated organ
+        double lastValue = 0.; ///< value of the last organ
+    };
+
+    Column getColumn(std::string name) const; ///< resolves a parameter name
+    double getValue(Column& c, int i, const Vector3d& a, const Vector3d& b) const; ///< parameter of the segment ending in node i, with end points a and b
+    template<class F>
+    void forEach(const F& f) const; ///< calls f(j, i, s, a, b) for each selected segment j ending in node i, with node indices s, and end points a and b
+
+    const Organism& plant;
+    const NodeStore& store;
+    std::vector<int> selected; ///< second node indices of the selected segments
+    std::vector<Cut> cuts; ///< cut segments, ordered by their positions within the selection
+
+};
+
+/**
+ * The segments of a SegmentAnalyser in reduced precision, e.g. for keeping many snapshots of large root systems.
+ * Coordinates are stored in float precision or quantized relative to an origin, creation times in float precision
+ * (@see PackedColumn). User data are not stored.
+ */
+class PackedSegments
+{
+
+public:
+
+    PackedSegments(const SegmentAnalyser& ana, int precision = PackedColumn::p_float, double resolution = 1.e-4,
+        Vector3d origin = Vector3d()); ///< packs the segments of the analyser
+    virtual ~PackedSegments() { }
+
+    SegmentAnalyser unpack() const; ///< analyser with the rounded nodes and creation times
+
+    int getNumberOfSegments() const { return segments.size(); }
+    size_t getMemory() const; ///< memory of the packed segments [bytes]
+
+protected:
+
+    PackedColumn x, y, z; ///< node coordinates [cm]
+    PackedColumn ct; ///< segment creation times [day]
+    std::vector<Vector2i> segments;
+    std::vector<Organ*> segO;
+
 };
 
 inline bool operator==(const SegmentAnalyser& lhs, const SegmentAnalyser& rhs){ return (&lhs==&rhs); } // only address wise, needed for boost python indexing suite
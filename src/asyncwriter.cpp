@@ -0,0 +1,218 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "asyncwriter.h"
+
+#include "Organism.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * @param queueSize     maximal number of snapshots held at the same time, AsyncWriter::write blocks if the queue is full
+ */
+AsyncWriter::AsyncWriter(int queueSize) :queueSize(queueSize)
+{
+    if (queueSize<1) {
+        std::cout << "AsyncWriter::AsyncWriter: the queue size must be at least 1\n" << std::flush;
+        throw std::invalid_argument("AsyncWriter::AsyncWriter: the queue size must be at least 1");
+    }
+    worker = std::thread(&AsyncWriter::run, this);
+}
+
+/**
+ * Writes the queued files, and stops the background thread. Errors that were not rethrown yet are reported, but not thrown.
+ */
+AsyncWriter::~AsyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work.notify_one();
+    worker.join();
+    if (error) {
+        std::cout << "AsyncWriter::~AsyncWriter: writing a file failed, call AsyncWriter::finish to obtain the error\n" << std::flush;
+    }
+}
+
+/**
+ * Takes a snapshot of the analyser, and queues it. Returns as soon as the snapshot is queued, the analyser
+ * and its organs can change afterwards. The file is the same as written by SegmentAnalyser::write.
+ *
+ * @param ana       the segments, and their user data
+ * @param name      file name, the type is determined from the extension (vtp, txt, or dgf)
+ * @param format    VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
+ */
+void AsyncWriter::write(const SegmentAnalyser& ana, std::string name, int format)
+{
+    rethrow();
+    std::string ext = name.substr(name.size()<3 ? 0 : name.size()-3); // pick the right writer
+    Job job;
+    job.name = name;
+    if (ext.compare("vtp")==0) {
+        std::cout << "writing VTP (asynchronous): " << name << "\n" << std::flush;
+        auto snap = std::make_shared<SegmentAnalyser>();
+        *snap = ana.snapshot({ "radius", "subType", "creationTime" }); // assignment keeps the user data, the copy constructor does not
+        job.serialize = [snap, format](std::ostream& os) { snap->writeVTP(os, { }, format); };
+    } else if ((ext.compare("txt")==0) || (ext.compare("dgf")==0)) { // these formats read the organs per segment
+        std::cout << "writing " << ext << " file (asynchronous): " << name << "\n" << std::flush;
+        SegmentAnalyser packed(ana);
+        packed.pack();
+        auto str = std::make_shared<std::stringstream>();
+        if (ext.compare("txt")==0) {
+            packed.writeRBSegments(*str);
+        } else {
+            packed.writeDGF(*str);
+        }
+        job.serialize = [str](std::ostream& os) { os << str->rdbuf(); };
+    } else {
+        std::cout << "AsyncWriter::write: unknown file type " << name << "\n" << std::flush;
+        throw std::invalid_argument("AsyncWriter::write: unknown file type");
+    }
+    enqueue(job);
+}
+
+/**
+ * Takes a snapshot of the organism, and queues it. Returns as soon as the snapshot is queued, the organism can be
+ * simulated afterwards. Segment based formats are written as by SegmentAnalyser::write, RSML as by Organism::writeRSML.
+ *
+ * @param plant     the organism
+ * @param name      file name, the type is determined from the extension (vtp, txt, dgf, or rsml)
+ * @param format    VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
+ */
+void AsyncWriter::write(const Organism& plant, std::string name, int format)
+{
+    std::string ext = name.substr(name.size()<3 ? 0 : name.size()-3);
+    if (ext.compare("sml")==0) {
+        rethrow();
+        std::cout << "writing RSML (asynchronous): " << name << "\n" << std::flush;
+        auto str = std::make_shared<std::stringstream>();
+        plant.writeRSML(*str);
+        Job job;
+        job.name = name;
+        job.serialize = [str](std::ostream& os) { os << str->rdbuf(); };
+        enqueue(job);
+    } else {
+        write(SegmentAnalyser(plant), name, format);
+    }
+}
+
+/**
+ * Waits until all queued files are written, and rethrows the first error of the background thread
+ */
+void AsyncWriter::finish()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending==0; });
+    }
+    rethrow();
+}
+
+/**
+ * @return the number of snapshots that are queued or being written
+ */
+int AsyncWriter::getNumberOfPending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+/**
+ * @return the number of files written so far
+ */
+int AsyncWriter::getNumberOfWritten() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return written;
+}
+
+/**
+ * Queues a job, blocks while the queue is full (back-pressure on the simulation loop)
+ */
+void AsyncWriter::enqueue(Job job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending<queueSize; });
+        queue.push_back(std::move(job));
+        pending++;
+    }
+    work.notify_one();
+}
+
+/**
+ * Loop of the background thread, writes the queued files in order, until the writer is destroyed
+ */
+void AsyncWriter::run()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty()) { // stop, and nothing left to write
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        bool ok = true;
+        try {
+            std::ofstream fos;
+            fos.open(job.name.c_str(), std::ios::out | std::ios::binary);
+            if (!fos.is_open()) {
+                std::cout << "AsyncWriter::run: could not open file " << job.name << "\n" << std::flush;
+                throw std::invalid_argument("AsyncWriter::run: could not open file " + job.name);
+            }
+            job.serialize(fos);
+            fos.close();
+        } catch (...) {
+            ok = false;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        job = Job(); // release the snapshot before signalling
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+            if (ok) {
+                written++;
+            }
+        }
+        done.notify_all();
+    }
+}
+
+/**
+ * Rethrows the first error of the background thread (once)
+ */
+void AsyncWriter::rethrow()
+{
+    std::exception_ptr e = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(e, error);
+    }
+    if (e) {
+        std::rethrow_exception(e);
+    }
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string AsyncWriter::toString() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::stringstream str;
+    str << "AsyncWriter with queue size " << queueSize << ", " << pending << " pending, and " << written << " written files";
+    return str.str();
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,84 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef ASYNCWRITER_H_
+#define ASYNCWRITER_H_
+
+#include "analysis.h"
+#include "vtpwriter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace CRootBox {
+
+class Organism;
+
+/**
+ * Writes output files on a background thread, while the simulation continues.
+ *
+ * AsyncWriter::write takes a snapshot of the segments in the calling thread (@see SegmentAnalyser::snapshot), and
+ * queues it. The background thread serializes the snapshot, compresses it (VTPWriter::compressed), and writes the file.
+ * The organism can be simulated right after AsyncWriter::write returns.
+ *
+ * Text formats that read organs per segment (txt, dgf), and RSML are serialized into memory in the calling thread,
+ * only the file is written in the background.
+ *
+ * At most queueSize snapshots are held (default 2, i.e. one is written while the next one waits), if the queue is full
+ * AsyncWriter::write blocks until a file is written. Errors of the background thread are rethrown by the next call of
+ * AsyncWriter::write or AsyncWriter::finish. The destructor waits for all files.
+ *
+ * Thread safety: a single thread should call write and finish.
+ */
+class AsyncWriter
+{
+public:
+
+    AsyncWriter(int queueSize = 2); ///< starts the background thread
+    virtual ~AsyncWriter(); ///< writes the queued files, and stops the background thread
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void write(const SegmentAnalyser& ana, std::string name, int format = VTPWriter::ascii); ///< queues a snapshot of the analyser (vtp, txt, or dgf)
+    void write(const Organism& plant, std::string name, int format = VTPWriter::ascii); ///< queues a snapshot of the organism (vtp, txt, dgf, or rsml)
+    void finish(); ///< waits until all queued files are written
+
+    int getQueueSize() const { return queueSize; } ///< maximal number of queued snapshots
+    int getNumberOfPending() const; ///< number of snapshots that are queued or being written
+    int getNumberOfWritten() const; ///< number of files written so far
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    struct Job {
+        std::string name;
+        std::function<void(std::ostream&)> serialize;
+    }; ///< file name, and the serialization of the snapshot
+
+    void enqueue(Job job); ///< waits for a free place in the queue
+    void run(); ///< loop of the background thread
+    void rethrow(); ///< rethrows the first error of the background thread
+
+    int queueSize;
+    std::deque<Job> queue;
+    int pending = 0; // queued or being written
+    int written = 0;
+    bool stop = false;
+    std::exception_ptr error = nullptr;
+
+    mutable std::mutex mutex;
+    std::condition_variable work; // signals the background thread
+    std::condition_variable done; // signals the writing threads
+    std::thread worker;
+
+};
+
+} // end namespace CRootBox
+
+#endif
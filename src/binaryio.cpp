@@ -0,0 +1,92 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "binaryio.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace CRootBox {
+
+/**
+ * @return the current position in the region, and moves @param n bytes ahead
+ */
+const char* BinaryReader::advance(size_t n)
+{
+    if (n>size-pos) {
+        std::cout << "BinaryReader::advance: unexpected end of data at byte " << pos << " of " << size << "\n" << std::flush;
+        throw std::invalid_argument("BinaryReader::advance: unexpected end of data");
+    }
+    const char* p = data+pos;
+    pos += n;
+    return p;
+}
+
+/**
+ * Reads the size of a string or vector, and checks that its elements fit into the rest of the region
+ * (a corrupt size would otherwise allocate arbitrary amounts of memory)
+ *
+ * @param elementSize   size of a single element [bytes]
+ */
+size_t BinaryReader::readSize(size_t elementSize)
+{
+    uint64_t n = read<uint64_t>();
+    if (n>(size-pos)/elementSize) {
+        std::cout << "BinaryReader::readSize: size " << n << " exceeds the data at byte " << pos << " of " << size << "\n" << std::flush;
+        throw std::invalid_argument("BinaryReader::readSize: unexpected end of data");
+    }
+    return n;
+}
+
+/**
+ * Maps the file @param name into memory
+ */
+MappedFile::MappedFile(std::string name)
+{
+#ifndef _WIN32
+    int fd = open(name.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd>=0 && fstat(fd, &st)==0) {
+        size = st.st_size;
+        if (size==0) { // mmap fails for empty files
+            close(fd);
+            return;
+        }
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p!=MAP_FAILED) {
+            data = (const char*)p;
+            mapped = true;
+            return;
+        }
+    } else if (fd>=0) {
+        close(fd);
+    }
+#endif
+    std::ifstream fis(name, std::ios::binary);
+    if (!fis.good()) {
+        std::cout << "MappedFile::MappedFile: could not open file " << name << "\n" << std::flush;
+        throw std::invalid_argument("MappedFile::MappedFile: could not open file " + name);
+    }
+    buffer.assign(std::istreambuf_iterator<char>(fis), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (mapped) {
+        munmap((void*)data, size);
+    }
+#endif
+}
+
+} // namespace CRootBox
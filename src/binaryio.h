@@ -0,0 +1,173 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef BINARYIO_H_
+#define BINARYIO_H_
+
+#include "mymath.h"
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace CRootBox {
+
+/**
+ * BinaryWriter
+ *
+ * Writes plain values, strings, and vectors into a binary stream, in the native byte order (see Organism::save).
+ * Strings and vectors are preceded by their size.
+ */
+class BinaryWriter
+{
+public:
+
+    BinaryWriter(std::ostream& os): os(os) { }
+
+    template<class T>
+    void write(const T& v) { ///< a plain value (int, double, ...)
+        static_assert(std::is_arithmetic<T>::value, "BinaryWriter::write: only arithmetic types");
+        os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+    void write(const Vector3d& v) { write(v.x); write(v.y); write(v.z); } ///< three doubles
+    void write(const std::string& s) { write(uint64_t(s.size())); writeChars(s); } ///< size and characters
+    void writeChars(const std::string& s) { os.write(s.data(), s.size()); } ///< characters without size (e.g. a file signature)
+
+    template<class T>
+    void write(const std::vector<T>& v) { ///< size and values
+        write(uint64_t(v.size()));
+        writeValues(v);
+    }
+
+    template<class T>
+    void writeText(const T& v) { ///< the textual representation of v (e.g. of a std::mt19937, which has no other access to its state)
+        std::ostringstream ss;
+        ss << v;
+        write(ss.str());
+    }
+
+    std::ostream& getStream() { return os; }
+
+protected:
+
+    template<class T>
+    void writeValues(const std::vector<T>& v) {
+        static_assert(std::is_arithmetic<T>::value, "BinaryWriter::write: only arithmetic types");
+        os.write(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+    }
+    void writeValues(const std::vector<Vector3d>& v) {
+        for (const auto& x : v) {
+            write(x);
+        }
+    }
+
+    std::ostream& os;
+
+};
+
+
+
+/**
+ * BinaryReader
+ *
+ * Reads the values of a BinaryWriter from a memory region (e.g. a MappedFile).
+ * Reading beyond the end of the region throws a std::invalid_argument.
+ */
+class BinaryReader
+{
+public:
+
+    BinaryReader(const char* data, size_t size): data(data), size(size) { }
+
+    template<class T>
+    T read() { ///< a plain value (int, double, ...)
+        static_assert(std::is_arithmetic<T>::value, "BinaryReader::read: only arithmetic types");
+        T v;
+        std::memcpy(&v, advance(sizeof(T)), sizeof(T));
+        return v;
+    }
+    Vector3d readVector3d() { double x = read<double>(); double y = read<double>(); return Vector3d(x, y, read<double>()); } ///< three doubles
+    std::string readString() { size_t n = readSize(1); return std::string(advance(n), n); } ///< size and characters
+    std::string readChars(size_t n) { return std::string(advance(n), n); } ///< n characters without size
+
+    template<class T>
+    std::vector<T> readVector() { ///< size and values
+        static_assert(std::is_arithmetic<T>::value, "BinaryReader::read: only arithmetic types");
+        size_t n = readSize(sizeof(T));
+        std::vector<T> v(n);
+        const char* p = advance(n*sizeof(T));
+        if (n>0) {
+            std::memcpy(v.data(), p, n*sizeof(T));
+        }
+        return v;
+    }
+    std::vector<Vector3d> readVector3ds() { ///< size and values
+        size_t n = readSize(3*sizeof(double));
+        std::vector<Vector3d> v;
+        v.reserve(n);
+        for (size_t i=0; i<n; i++) {
+            v.push_back(readVector3d());
+        }
+        return v;
+    }
+
+    template<class T>
+    void readText(T& v) { ///< sets v from its textual representation (@see BinaryWriter::writeText)
+        std::istringstream ss(readString());
+        ss >> v;
+        if (ss.fail()) {
+            std::cout << "BinaryReader::readText: could not parse the text before byte " << pos << "\n" << std::flush;
+            throw std::invalid_argument("BinaryReader::readText: could not parse the text");
+        }
+    }
+
+    size_t getPosition() const { return pos; } ///< number of bytes read
+    bool atEnd() const { return pos==size; } ///< true, if the region is read completely
+
+protected:
+
+    const char* advance(size_t n); ///< current position, and moves n bytes ahead, throws if the region is too small
+    size_t readSize(size_t elementSize); ///< reads a size, which must fit into the rest of the region
+
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+
+};
+
+
+
+/**
+ * MappedFile
+ *
+ * A file mapped into memory read only (mmap), or read into memory on systems without mmap
+ */
+class MappedFile
+{
+public:
+
+    MappedFile(std::string name); ///< maps the file, throws a std::invalid_argument if it cannot be opened
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+protected:
+
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false; ///< data is mapped, otherwise it is held by buffer
+    std::vector<char> buffer;
+
+};
+
+} // namespace CRootBox
+
+#endif
@@ -0,0 +1,385 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "carbon.h"
+
+#include "RootSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * @param subType   root sub type
+ * @param w         sink strength (>=0), roots with larger weights are served first
+ */
+void CarbonAllocator::setWeight(int subType, double w)
+{
+    if (!(w>=0)) {
+        std::cout << "CarbonAllocator::setWeight: the weight must not be negative\n" << std::flush;
+        throw std::invalid_argument("CarbonAllocator::setWeight: the weight must not be negative");
+    }
+    weights[subType] = w;
+}
+
+/**
+ * @param subType   root sub type
+ * @return the sink strength of the root type
+ */
+double CarbonAllocator::getWeight(int subType) const
+{
+    auto it = weights.find(subType);
+    return (it!=weights.end()) ? it->second : 1.;
+}
+
+/**
+ * @param subType   root sub type
+ * @param c         carbon cost per length (>0), e.g. proportional to the cross section of the root type
+ */
+void CarbonAllocator::setCost(int subType, double c)
+{
+    if (!(c>0)) {
+        std::cout << "CarbonAllocator::setCost: the cost must be positive\n" << std::flush;
+        throw std::invalid_argument("CarbonAllocator::setCost: the cost must be positive");
+    }
+    costs[subType] = c;
+}
+
+/**
+ * @param subType   root sub type
+ * @return the carbon cost per length of the root type
+ */
+double CarbonAllocator::getCost(int subType) const
+{
+    auto it = costs.find(subType);
+    return (it!=costs.end()) ? it->second : 1.;
+}
+
+/**
+ * Elongation of a root in the next time step, if the growth is not limited, with the same equations as Root::simulate
+ * (the probabilistic emergence of a root is not considered)
+ *
+ * @param r         the root
+ * @param dt        time step [day]
+ * @return          potential elongation [cm]
+ */
+double CarbonAllocator::potentialElongation(Root* r, double dt)
+{
+    if (!r->isAlive() || !r->isActive() || r->isFinished() || (r->getNumberOfNodes()<1)) {
+        return 0.;
+    }
+    const RootSpecificParameter& p = *r->param();
+    double age = r->getAge();
+    if (age+dt>p.rlt) { // root life time
+        dt = p.rlt-age;
+    }
+    double a = age+dt;
+    if (a<=0) { // not born within the time step
+        return 0.;
+    }
+    double dt_ = (a<dt) ? a : dt; // the root emerges in this time step
+    double e = r->calcLength(r->calcAge(r->getLength())+dt_)-r->getLength();
+    double scale = r->getRootTypeParameter()->f_se->getValue(r->getNode(r->getNumberOfNodes()-1), r);
+    return std::max(scale*e, 0.);
+}
+
+/**
+ * Elongation of the laterals that a root creates in the next time step, with the same equations as Root::simulate and
+ * Root::createLateral. A lateral is created, when the root passes its branching point, and starts growing after the delay,
+ * until the apical zone is developed (see CarbonAllocator::lateralElongation). The laterals grow with the elongation scale
+ * at the tip of the root, and with the elongation scale of the root (see Organism::setElongationScales).
+ *
+ * @param r         the root
+ * @param dt        time step [day]
+ * @param scale     elongation scale of the root (default 1, i.e. unlimited growth)
+ * @return          elongation of the emerging laterals [cm]
+ */
+double CarbonAllocator::emergingElongation(Root* r, double dt, double scale)
+{
+    const RootSpecificParameter& p = *r->param();
+    const RootRandomParameter* rrp = r->getRootTypeParameter();
+    if ((p.nob<=0) || (p.ln.size()+1<=size_t(r->getNumberOfChildren())) || rrp->successor.empty() || !(scale>0)) {
+        return 0.;
+    }
+    double l = r->getLength();
+    double l1 = l+scale*potentialElongation(r, dt); // length at the end of the time step
+    if (l1<p.lb) {
+        return 0.;
+    }
+    double age = std::min(r->getAge()+dt, p.rlt); // age at the end of the time step
+    scale *= rrp->f_se->getValue(r->getNode(r->getNumberOfNodes()-1), r);
+    double e = 0.;
+    double s = p.lb; // branching point
+    for (size_t i=0; i<=p.ln.size(); i++) {
+        if (i>0) {
+            s += p.ln.at(i-1);
+        }
+        if (i<size_t(r->getNumberOfChildren())) { // created before
+            continue;
+        }
+        if ((s>l1) || ((s==l1) && (i<p.ln.size()))) { // not reached within the time step
+            break;
+        }
+        double t = age-r->calcAge(std::max(s, l)+p.la); // growth time of the lateral, longer than dt, if the root was impeded
+        for (size_t j=0; j<rrp->successor.size(); j++) {
+            auto lp = (const RootRandomParameter*)r->getOrganism()->getSharedOrganRandomParameter(Organism::ot_root, rrp->successor[j]);
+            e += rrp->successorP.at(j)*lateralElongation(lp, t, scale, r);
+        }
+    }
+    return std::max(e, 0.);
+}
+
+/**
+ * Expected elongation of a new lateral with the mean parameters of its root type, including its own laterals,
+ * after it has grown for a time span (see Root::createLateral, the probabilistic emergence is not considered)
+ *
+ * @param lp        root type parameter of the lateral
+ * @param t         growth time of the lateral, i.e. the time since the delay passed [day]
+ * @param scale     elongation scale of the lateral
+ * @param r         the parent root (passed to the growth function)
+ * @return          elongation of the lateral and its laterals [cm]
+ */
+double CarbonAllocator::lateralElongation(const RootRandomParameter* lp, double t, double scale, Root* r)
+{
+    t = std::min(t, lp->rlt);
+    if (t<=0) {
+        return 0.;
+    }
+    const double k = lp->getK();
+    double l = scale*lp->f_gf->getLength(t, lp->r, k, r);
+    double e = l;
+    for (int i=0; (i<int(lp->nob)) && (lp->lb+i*lp->ln<l); i++) { // its laterals
+        double ti = t-lp->f_gf->getAge(lp->lb+i*lp->ln+lp->la, lp->r, k, r);
+        if (ti>0) {
+            for (size_t j=0; j<lp->successor.size(); j++) {
+                auto lpj = (const RootRandomParameter*)r->getOrganism()->getSharedOrganRandomParameter(Organism::ot_root, lp->successor[j]);
+                e += lp->successorP.at(j)*lateralElongation(lpj, ti, scale, r);
+            }
+        }
+    }
+    return e;
+}
+
+/**
+ * Mean carbon cost per length of the laterals of a root, weighted by the probabilities of the successor types
+ */
+double CarbonAllocator::lateralCost(const Root* r) const
+{
+    const RootRandomParameter* rrp = r->getRootTypeParameter();
+    double c = 0.;
+    double p = 0.;
+    for (size_t j=0; j<rrp->successor.size(); j++) {
+        c += rrp->successorP.at(j)*getCost(rrp->successor[j]);
+        p += rrp->successorP.at(j);
+    }
+    return (p>0) ? c/p : getCost(r->param()->subType);
+}
+
+/**
+ * Computes the potential elongation of each root in the next time step analytically (see CarbonAllocator::getDemands),
+ * and the carbon demand of the unlimited time step. The demand of a root includes the laterals it creates within the
+ * time step (see CarbonAllocator::emergingElongation), since they grow with its elongation scale.
+ *
+ * @param dt        time step [day]
+ * @return          total carbon demand, i.e. the costs of the unlimited elongation
+ */
+double CarbonAllocator::getDemand(double dt)
+{
+    const auto& organs = rs->getOrganList();
+    demands.assign(rs->getNumberOfOrgans(), 0.);
+    demandCosts.assign(demands.size(), 0.);
+    types.assign(demands.size(), -1);
+    demand = 0.;
+    for (auto o : organs) {
+        int id = o->getId();
+        if ((o->organType()==Organism::ot_root) && (id>=0) && (id<int(demands.size()))) {
+            Root* r = (Root*)o;
+            double d = potentialElongation(r, dt);
+            double dl = (d>0) ? emergingElongation(r, dt) : 0.;
+            if (d+dl>0) {
+                int st = r->param()->subType;
+                demands[id] = d+dl;
+                demandCosts[id] = getCost(st)*d+lateralCost(r)*dl;
+                types[id] = st;
+                demand += demandCosts[id];
+            }
+        }
+    }
+    return demand;
+}
+
+/**
+ * Analytic costs of the next time step for the allocation factor @param lambda, the laterals emerge depending on
+ * the scaled elongation of their parents (see CarbonAllocator::emergingElongation)
+ *
+ * @param lambda    allocation factor
+ * @param dt        time step [day]
+ * @param length    the elongation of the time step [cm] (result)
+ * @return          the costs of the time step
+ */
+double CarbonAllocator::analyticCosts(double lambda, double dt, double& length) const
+{
+    const std::vector<double> s = scalesOf(lambda);
+    double c = 0.;
+    length = 0.;
+    for (auto o : rs->getOrganList()) {
+        int id = o->getId();
+        if ((id>=0) && (id<int(types.size())) && (types[id]>=0) && (s[id]>0)) {
+            Root* r = (Root*)o;
+            double d = s[id]*potentialElongation(r, dt);
+            double dl = emergingElongation(r, dt, s[id]);
+            c += getCost(types[id])*d+lateralCost(r)*dl;
+            length += d+dl;
+        }
+    }
+    return c;
+}
+
+/**
+ * Elongation scales per organ id of the allocation factor @param lambda, i.e. min(1, lambda*w) for the growing roots
+ */
+std::vector<double> CarbonAllocator::scalesOf(double lambda) const
+{
+    std::vector<double> s(demands.size(), 1.);
+    for (size_t i=0; i<s.size(); i++) {
+        if (types[i]>=0) {
+            double w = getWeight(types[i]);
+            s[i] = (w>0) ? std::min(1., lambda*w) : 0.;
+        }
+    }
+    return s;
+}
+
+/**
+ * Solves the allocation factor for the demands of the last call of CarbonAllocator::getDemand in a single pass over
+ * the root types: the costs are saturated + lambda*slope, between the saturation points 1/w of the root types.
+ *
+ * @param budget    the carbon available in the time step
+ * @return          the largest allocation factor, with costs within the budget (the saturation of all types for an infinite budget)
+ */
+double CarbonAllocator::solve(double budget)
+{
+    struct Group {
+        double w = 1.;
+        double cost = 0.; ///< summed costs of the demands of the root type
+    };
+    std::map<int, Group> groups;
+    for (size_t i=0; i<demands.size(); i++) {
+        if (types[i]>=0) {
+            Group& g = groups[types[i]];
+            g.w = getWeight(types[i]);
+            g.cost += demandCosts[i];
+        }
+    }
+    std::vector<Group> sorted;
+    double slope = 0.;
+    for (const auto& g : groups) {
+        if (g.second.w>0) {
+            sorted.push_back(g.second);
+            slope += g.second.cost*g.second.w;
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Group& a, const Group& b) { return a.w>b.w; });
+    double saturated = 0.;
+    for (const auto& g : sorted) {
+        if (saturated+slope/g.w>=budget) { // lambda is below the saturation point of this type
+            return (budget-saturated)/slope;
+        }
+        saturated += g.cost;
+        slope -= g.cost*g.w;
+    }
+    return sorted.empty() ? 0. : 1./sorted.back().w; // all types of positive weight are saturated
+}
+
+/**
+ * Allocates the carbon of the next time step to the roots, and sets their elongation scales
+ * (see Organism::setElongationScales). The scales are used by the following simulation step, and should be
+ * removed afterwards (CarbonAllocator::simulate does both).
+ *
+ * The allocation factor lambda is solved for the analytic demands (see CarbonAllocator::getDemand). If the budget is
+ * exceeded, the elongation with these scales is measured once by a dry run (see RootSystem::simulateDry), and lambda is
+ * corrected towards the budget, with the elasticity of the analytic costs between lambda and the proportional correction
+ * (fewer laterals emerge from parents that grow less, so the costs increase faster than lambda). The dry run draws
+ * other random numbers than the time step (e.g. for the emergence of laterals), the allocation is therefore an estimate.
+ *
+ * @param dt        time step [day]
+ * @param maxinc    carbon available per day, in units of the costs (i.e. cm/day for the default costs)
+ * @return          allocated carbon, i.e. the estimated costs of the following time step
+ */
+double CarbonAllocator::allocate(double dt, double maxinc)
+{
+    const double budget = std::max(dt*maxinc, 0.);
+    rs->setElongationScales(std::vector<double>());
+    getDemand(dt);
+    lambda = -1.; // demand satisfied
+    allocated = demand;
+    scales.assign(demands.size(), 1.);
+    if (demand>budget) {
+        double lsat = solve(std::numeric_limits<double>::infinity()); // all types of positive weight are saturated
+        lambda = solve(budget);
+        scales = scalesOf(lambda);
+        double l;
+        double c = analyticCosts(lambda, dt, l);
+        if ((c>0) && (l>0) && (lambda<lsat)) { // dry run correction
+            rs->setElongationScales(scales);
+            double cd = c*rs->simulateDry(dt)/l; // measured costs
+            if (cd>0) {
+                double l1 = std::min(lambda*budget/cd, lsat); // proportional correction
+                double p = 1.; // the elasticity of the analytic costs between lambda and l1
+                if (l1!=lambda) {
+                    double l_;
+                    p = std::log(analyticCosts(l1, dt, l_)/c)/std::log(l1/lambda);
+                    if (!(std::isfinite(p) && (p>0))) {
+                        p = 1.;
+                    }
+                }
+                double l0 = lambda;
+                lambda = std::min(l0*std::pow(budget/cd, 1./p), lsat);
+                scales = scalesOf(lambda);
+                c = cd*std::pow(lambda/l0, p);
+            }
+        }
+        allocated = std::min(c, demand);
+    }
+    rs->setElongationScales(scales);
+    return allocated;
+}
+
+/**
+ * Carbon limited time step: allocates the carbon (see CarbonAllocator::allocate), simulates the root system,
+ * and removes the elongation scales
+ *
+ * @param dt        time step [day]
+ * @param maxinc    carbon available per day, in units of the costs (i.e. cm/day for the default costs)
+ * @param verbose   turns console output on or off
+ */
+void CarbonAllocator::simulate(double dt, double maxinc, bool verbose)
+{
+    allocate(dt, maxinc);
+    if (verbose) {
+        std::cout << "CarbonAllocator::simulate: demand " << demand << ", allocated " << allocated << ", lambda " << lambda << "\n";
+    }
+    try {
+        rs->simulate(dt, verbose);
+    } catch (...) {
+        rs->setElongationScales(std::vector<double>());
+        throw;
+    }
+    rs->setElongationScales(std::vector<double>());
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string CarbonAllocator::toString() const
+{
+    std::stringstream str;
+    str << "CarbonAllocator: demand " << demand << ", allocated " << allocated << " (lambda " << lambda << ") of the last allocation, "
+        << weights.size() << " weights, and " << costs.size() << " costs set";
+    return str.str();
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,85 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef CARBON_H_
+#define CARBON_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace CRootBox {
+
+class RootSystem;
+class Root;
+class RootRandomParameter;
+
+/**
+ * CarbonAllocator
+ *
+ * Carbon limited growth: distributes the carbon budget of a time step over the growing roots, and scales the elongation
+ * of each root (see Organism::setElongationScales), instead of searching a single scale for all roots by dry runs.
+ *
+ * The demand of a growing root is its potential elongation in the time step, computed analytically from its growth
+ * function and its elongation scale (RootRandomParameter::f_se) at the tip, as in Root::simulate. The laterals that emerge
+ * within the time step grow with the scale of their parent, so their potential elongation is added to the demand of the parent
+ * (see CarbonAllocator::emergingElongation). Each root type has a weight (sink strength, default 1), and a carbon cost per
+ * length (default 1, i.e. the budget is a length [cm]).
+ *
+ * A root of type t with demand d obtains the elongation s*d with s = min(1, lambda*w_t), where lambda is the largest factor
+ * that keeps the costs of the time step within the budget. Root types with larger weights are served first, roots of the
+ * same weight in proportion to their demand, and types with weight zero do not grow if the budget is exceeded.
+ * The allocation is solved in a single pass over the root types (the costs are piecewise linear in lambda).
+ *
+ * The laterals emerge depending on the elongation of their parent, so the costs increase faster than the scales. If the budget
+ * is exceeded, the elongation of the allocation is therefore measured once by a dry run (see RootSystem::simulateDry), and
+ * lambda is corrected towards the budget (see CarbonAllocator::allocate). No trial time steps are simulated, and the allocated
+ * carbon is an estimate of the costs of the following time step.
+ */
+class CarbonAllocator
+{
+public:
+
+    CarbonAllocator(RootSystem& rs) :rs(&rs) { }
+
+    void setWeight(int subType, double w); ///< sink strength of a root type (default 1)
+    double getWeight(int subType) const; ///< sink strength of a root type
+    void setCost(int subType, double c); ///< carbon cost per length of a root type (default 1)
+    double getCost(int subType) const; ///< carbon cost per length of a root type
+
+    double getDemand(double dt); ///< carbon demand of the unlimited growth in the next time step
+    double allocate(double dt, double maxinc); ///< sets the elongation scales of the roots for the next time step
+    void simulate(double dt, double maxinc, bool verbose = false); ///< carbon limited time step
+
+    const std::vector<double>& getDemands() const { return demands; } ///< potential elongation per organ id, including the emerging laterals [cm], of the last allocation
+    const std::vector<double>& getScales() const { return scales; } ///< elongation scale per organ id, of the last allocation
+    double getLambda() const { return lambda; } ///< allocation factor of the last allocation (negative, if the demand was satisfied)
+
+    std::string toString() const; ///< quick info for debugging
+
+    static double potentialElongation(Root* r, double dt); ///< elongation of a root in a time step, if the growth is unlimited
+    static double emergingElongation(Root* r, double dt, double scale = 1.); ///< elongation of the laterals a root creates in a time step
+
+protected:
+
+    static double lateralElongation(const RootRandomParameter* lp, double t, double scale, Root* r); ///< elongation of a new lateral
+    double lateralCost(const Root* r) const; ///< carbon cost per length of the laterals of a root
+    double analyticCosts(double lambda, double dt, double& length) const; ///< analytic costs of an allocation factor
+    double solve(double budget); ///< allocation factor of the demands for a budget
+    std::vector<double> scalesOf(double lambda) const; ///< elongation scales per organ id of an allocation factor
+
+    RootSystem* rs;
+    std::map<int, double> weights;
+    std::map<int, double> costs;
+
+    std::vector<double> demands;
+    std::vector<double> scales;
+    std::vector<double> demandCosts; ///< costs of the demands per organ id
+    std::vector<int> types; ///< root sub type per organ id of the growing roots, -1 otherwise
+    double demand = 0.; ///< total carbon demand of the last allocation, including the emerging laterals
+    double allocated = 0.; ///< total carbon allocated by the last allocation, i.e. the estimated costs of the following time step
+    double lambda = -1.;
+
+};
+
+} // end namespace CRootBox
+
+#endif
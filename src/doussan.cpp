@@ -0,0 +1,681 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "doussan.h"
+
+#include "Organism.h"
+#include "Organ.h"
+#include "organparameter.h"
+#include "soil.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+
+namespace CRootBox {
+
+/**
+ * Constructor
+ *
+ * @param plant     the organism, call Doussan::init before using the system
+ * @param soil      soil matric potential, the soil potential is zero if there is no soil (nullptr)
+ */
+Doussan::Doussan(const Organism& plant, SoilLookUp* soil): plant(plant), soil(soil) { }
+
+/**
+ * Radial conductivity of a segment
+ *
+ * @param ot        organ type
+ * @param subType   sub type of the organ
+ * @param age       age of the segment [day]
+ */
+double Doussan::radialConductivity(int ot, int subType, double age) const
+{
+    return krAge.empty() ? kr : interpolate(krAge, krValue, age);
+}
+
+/**
+ * Axial conductivity of a segment, @see Doussan::radialConductivity
+ */
+double Doussan::axialConductivity(int ot, int subType, double age) const
+{
+    return kxAge.empty() ? kx : interpolate(kxAge, kxValue, age);
+}
+
+/**
+ * The C++ classes that derive from Doussan are assumed to overwrite the conductivities,
+ * overwrite this method, if the conductivities keep depending on the tables only
+ */
+bool Doussan::overwritesConductivities() const
+{
+    return typeid(*this)!=typeid(Doussan);
+}
+
+/**
+ * Sets the radial conductivity as piecewise linear function of the segment age (constant beyond the first and last age)
+ *
+ * @param age       ascending segment ages [day]
+ * @param kr        radial conductivity at these ages
+ */
+void Doussan::setKrTable(const std::vector<double>& age, const std::vector<double>& kr)
+{
+    if (age.size()!=kr.size()) {
+        std::cout << "Doussan::setKrTable: ages and values must have the same length\n" << std::flush;
+        throw std::invalid_argument("Doussan::setKrTable: ages and values must have the same length");
+    }
+    krAge = age;
+    krValue = kr;
+    tablesChanged = true;
+}
+
+/**
+ * Sets the axial conductivity as piecewise linear function of the segment age, @see Doussan::setKrTable
+ */
+void Doussan::setKxTable(const std::vector<double>& age, const std::vector<double>& kx)
+{
+    if (age.size()!=kx.size()) {
+        std::cout << "Doussan::setKxTable: ages and values must have the same length\n" << std::flush;
+        throw std::invalid_argument("Doussan::setKxTable: ages and values must have the same length");
+    }
+    kxAge = age;
+    kxValue = kx;
+    tablesChanged = true;
+}
+
+/**
+ * Copies nodes and segments of the organism, and assembles the linear system
+ *
+ * @param ot        organ type of the segments, -1 for all organ types (default)
+ */
+void Doussan::init(int ot)
+{
+    this->ot = ot;
+    nodes = plant.getNodes();
+    segs = plant.getSegments(ot);
+    segO = plant.getSegmentOrigins(ot);
+    segCTs = plant.getSegmentCTs(ot);
+    shrinks = plant.getNodeStore().getShrinks().size();
+    rowPtr.clear(); // new sparsity pattern
+    assemble();
+}
+
+/**
+ * Adds the segments created in the last time step, and updates the moved nodes. Only the entries of the new segments
+ * are added to the the linear system, and the entries of the segments that were moved, or whose conductivities depend on
+ * their age, are recomputed. The soil potentials of the other segments are kept, call Doussan::assemble after the soil changed.
+ *
+ * If the system is out of sync (e.g. update was not called after each step, or RootSystem::pop was called), if it is not
+ * a tree, or if the conductivity parameters were changed, all segments are copied and assembled again (@see Doussan::init).
+ */
+void Doussan::update()
+{
+    size_t nn0 = nodes.size();
+    size_t ns0 = segs.size();
+    int n = plant.getNumberOfNodes();
+    int old = n - plant.getNumberOfNewNodes(); // number of nodes before the last step
+    if ((old!=(int)nn0) || (plant.getNodeStore().getShrinks().size()!=shrinks) || !tree || (diagPos.size()!=nn0)
+        || changedParameters()) {
+        init(ot);
+        return;
+    }
+    plant.getStepDelta(delta, ot);
+    for (const auto& s : delta.newSegments) { // the new segments end in new nodes
+        if ((s.y<old) || (s.x>=s.y)) {
+            init(ot);
+            return;
+        }
+    }
+    double simtime = plant.getSimTime();
+    bool all = overwritesConductivities();
+
+    // old segments, that are recomputed
+    std::vector<int> changed;
+    std::vector<bool> moved(ns0, false);
+    auto change = [&](int c) {
+        if ((c>=0) && !moved[c]) {
+            moved[c] = true;
+            changed.push_back(c);
+        }
+    };
+    for (int i : delta.updatedNodeIndices) {
+        change(parentSeg.at(i));
+        for (int k=rowPtr[i]; k<rowPtr[i+1]; k++) { // segments starting in the node
+            int j = colIdx[k];
+            if ((j!=i) && (parentSeg[j]>=0) && (segs[parentSeg[j]].x==i)) {
+                change(parentSeg[j]);
+            }
+        }
+    }
+    std::vector<bool> geometry(moved); // the geometry changed
+    if (all) {
+        for (size_t c=0; c<ns0; c++) {
+            change(c);
+        }
+    } else {
+        for (int c : varying) {
+            change(c);
+        }
+    }
+    for (int c : changed) { // remove the old entries
+        addSegment(c, -1.);
+    }
+
+    // nodes and segments
+    nodes.insert(nodes.end(), delta.newNodes.begin(), delta.newNodes.end());
+    for (size_t k=0; k<delta.updatedNodeIndices.size(); k++) {
+        int i = delta.updatedNodeIndices[k];
+        nodes.at(i) = delta.updatedNodes[k];
+        if (parentSeg[i]>=0) {
+            segCTs[parentSeg[i]] = delta.updatedNodeCTs[k]; // @see Organism::getSegmentCTs
+        }
+    }
+    segs.insert(segs.end(), delta.newSegments.begin(), delta.newSegments.end());
+    segO.insert(segO.end(), delta.newSegmentOrigins.begin(), delta.newSegmentOrigins.end());
+    for (const auto& s : delta.newSegments) {
+        segCTs.push_back(delta.newNodeCTs.at(s.y-old));
+    }
+    size_t ns = segs.size();
+    if (!appendPattern(nn0, ns0)) { // not a tree
+        init(ot);
+        return;
+    }
+
+    // segment data
+    std::vector<Organ*> no(delta.newSegmentOrigins.begin(), delta.newSegmentOrigins.end());
+    std::vector<double> nr = Organ::getParameters(Organ::pi_radius, no);
+    radii.insert(radii.end(), nr.begin(), nr.end());
+    length.resize(ns);
+    kr_.resize(ns);
+    kx_.resize(ns);
+    soilP.resize(ns, 0.);
+    for (size_t c=ns0; c<ns; c++) {
+        changed.push_back(c);
+        geometry.push_back(true);
+    }
+    std::vector<Vector3d> mid;
+    std::vector<int> midSegs;
+    for (int c : changed) {
+        setConductivities(c, simtime);
+        if (geometry[c]) {
+            mid.push_back(nodes[segs[c].x].plus(nodes[segs[c].y]).times(0.5));
+            midSegs.push_back(c);
+        }
+    }
+    if (soil!=nullptr) { // new and moved segments in one look up
+        std::vector<double> p;
+        soil->getValues(mid, p);
+        for (size_t k=0; k<midSegs.size(); k++) {
+            soilP[midSegs[k]] = p[k];
+        }
+    }
+
+    // values
+    b.resize(nodes.size(), 0.);
+    for (int c : changed) {
+        addSegment(c, 1.);
+    }
+    for (size_t i=nn0; i<nodes.size(); i++) {
+        if (rowPtr[i+1]-rowPtr[i]==1) { // no segments
+            values[diagPos[i]] = 1.;
+        }
+    }
+    setAssembled(simtime, all);
+}
+
+/**
+ * Computes the length, and the conductivities of segment @param c at the simulation time @param simtime
+ */
+void Doussan::setConductivities(size_t c, double simtime)
+{
+    length[c] = nodes.at(segs[c].y).minus(nodes.at(segs[c].x)).length();
+    int organType = segO[c]->organType();
+    int subType = segO[c]->getParam()->subType;
+    double age = simtime - segCTs[c];
+    kr_[c] = radialConductivity(organType, subType, age);
+    kx_[c] = axialConductivity(organType, subType, age);
+}
+
+/**
+ * Adds the entries of segment @param c to the matrix and the rhs, multiplied by @param sign (-1 removes them)
+ */
+void Doussan::addSegment(size_t c, double sign)
+{
+    int i = segs[c].x;
+    int j = segs[c].y;
+    double l = std::max(length[c], 1.e-12);
+    double vz = (nodes[j].z-nodes[i].z)/l; // normed direction
+    double a = radii[c];
+    double cii = a*M_PI*l*kr_[c]/2.+kx_[c]/l;  // Eqn (10)
+    double cij = a*M_PI*l*kr_[c]/2.-kx_[c]/l;  // Eqn (11)
+    double bi = a*M_PI*l*kr_[c]*soilP[c]; // first term of Eqn (12) & (13)
+    values[diagPos[i]] += sign*cii;
+    values[ijPos[2*c]] += sign*cij;
+    values[diagPos[j]] += sign*cii;
+    values[ijPos[2*c+1]] += sign*cij;
+    b[i] += sign*(bi+kx_[c]*rho*g*vz); // Eqn (12)
+    b[j] += sign*(bi-kx_[c]*rho*g*vz); // Eqn (13)
+}
+
+/**
+ * True, if the conductivity parameters changed since the last assembly (then all segments are assembled again)
+ */
+bool Doussan::changedParameters() const
+{
+    return tablesChanged || (kr!=assembledKr) || (kx!=assembledKx) || (rho!=assembledRho) || (g!=assembledG);
+}
+
+/**
+ * Remembers the parameters of the assembly, and collects the segments, whose conductivities will change with their age
+ * (within the tables, or all segments if the conductivities are overwritten, @param all)
+ */
+void Doussan::setAssembled(double simtime, bool all)
+{
+    tablesChanged = false;
+    assembledKr = kr;
+    assembledKx = kx;
+    assembledRho = rho;
+    assembledG = g;
+    varying.clear();
+    if (all) {
+        return; // all segments are recomputed
+    }
+    double end = -1.e100; // age, after which the tables are constant
+    if (!krAge.empty()) {
+        end = std::max(end, krAge.back());
+    }
+    if (!kxAge.empty()) {
+        end = std::max(end, kxAge.back());
+    }
+    for (size_t c=0; c<segs.size(); c++) {
+        if (simtime-segCTs[c]<end) {
+            varying.push_back(c);
+        }
+    }
+}
+
+/**
+ * Computes radii, lengths, conductivities, and soil potentials of all segments, and assembles Q and b.
+ * The sparsity pattern and the tree structure are only built, if the segments changed.
+ * Nodes without segments get the equation x_i = 0.
+ */
+void Doussan::assemble()
+{
+    size_t nn = nodes.size();
+    size_t ns = segs.size();
+    double simtime = plant.getSimTime();
+
+    // segment data
+    radii = Organ::getParameters(Organ::pi_radius, segO);
+    length.resize(ns);
+    kr_.resize(ns);
+    kx_.resize(ns);
+    std::vector<Vector3d> mid(ns);
+    for (size_t c=0; c<ns; c++) {
+        setConductivities(c, simtime);
+        mid[c] = nodes.at(segs[c].x).plus(nodes.at(segs[c].y)).times(0.5);
+    }
+    if (soil!=nullptr) {
+        soil->getValues(mid, soilP); // all segments in one look up
+    } else {
+        soilP.assign(ns, 0.);
+    }
+
+    // sparsity pattern, and tree structure
+    if ((rowPtr.size()!=nn+1) || (ijPos.size()!=2*ns)) {
+        buildPattern();
+    }
+
+    // values
+    values.assign(colIdx.size(), 0.);
+    b.assign(nn, 0.);
+    for (size_t c=0; c<ns; c++) {
+        addSegment(c, 1.);
+    }
+    for (size_t i=0; i<nn; i++) {
+        if (rowPtr[i+1]-rowPtr[i]==1) { // no segments
+            values[diagPos[i]] = 1.;
+        }
+    }
+    setAssembled(simtime, overwritesConductivities());
+}
+
+/**
+ * Builds the sparsity pattern (rows sorted by column), and the tree structure of all segments
+ */
+void Doussan::buildPattern()
+{
+    size_t nn = nodes.size();
+    size_t ns = segs.size();
+    std::vector<std::vector<std::pair<int,int>>> rows(nn); // (column, entry tag) per row
+    for (size_t i=0; i<nn; i++) {
+        rows[i].push_back(std::make_pair(i, -1));
+    }
+    for (size_t c=0; c<ns; c++) {
+        rows.at(segs[c].x).push_back(std::make_pair(segs[c].y, 2*c));
+        rows.at(segs[c].y).push_back(std::make_pair(segs[c].x, 2*c+1));
+    }
+    rowPtr.assign(nn+1, 0);
+    colIdx.clear();
+    diagPos.assign(nn, 0);
+    ijPos.assign(2*ns, 0);
+    for (size_t i=0; i<nn; i++) {
+        std::sort(rows[i].begin(), rows[i].end());
+        for (const auto& e : rows[i]) {
+            if (e.second<0) {
+                diagPos[i] = colIdx.size();
+            } else {
+                ijPos[e.second] = colIdx.size();
+            }
+            colIdx.push_back(e.first);
+        }
+        rowPtr[i+1] = colIdx.size();
+    }
+    // tree
+    tree = true;
+    parentSeg.assign(nn, -1);
+    std::vector<int> childStart(nn+1, 0);
+    for (size_t c=0; c<ns; c++) {
+        int y = segs[c].y;
+        tree = tree && (parentSeg[y]<0);
+        parentSeg[y] = c;
+        childStart[segs[c].x+1]++;
+    }
+    for (size_t i=0; i<nn; i++) {
+        childStart[i+1] += childStart[i];
+    }
+    std::vector<int> children(ns);
+    std::vector<int> next(childStart.begin(), childStart.end()-1);
+    for (size_t c=0; c<ns; c++) {
+        children[next[segs[c].x]++] = segs[c].y;
+    }
+    order.clear();
+    for (size_t i=0; i<nn; i++) {
+        if (parentSeg[i]<0) { // bases, and nodes without segments
+            order.push_back(i);
+        }
+    }
+    for (size_t k=0; (k<order.size()) && (order.size()<=nn); k++) { // breadth first
+        int i = order[k];
+        for (int l=childStart[i]; l<childStart[i+1]; l++) {
+            order.push_back(children[l]);
+        }
+    }
+    tree = tree && (order.size()==nn); // otherwise there is a cycle
+}
+
+/**
+ * Adds the rows of the new nodes nn0.. and the entries of the new segments ns0.. to the sparsity pattern, and to the tree.
+ * The new segments end in new nodes, so their columns are appended to the rows of the old nodes, and the rows are
+ * shifted once, from the last to the first. The values of the old entries are shifted with them.
+ *
+ * @param nn0       number of nodes before the update
+ * @param ns0       number of segments before the update
+ * @return          false, if the segments are no tree any more (the pattern is inconsistent then)
+ */
+bool Doussan::appendPattern(size_t nn0, size_t ns0)
+{
+    size_t nn = nodes.size();
+    size_t ns = segs.size();
+    // tree, the new nodes are appended to the order, their parents are older nodes
+    parentSeg.resize(nn, -1);
+    for (size_t c=ns0; c<ns; c++) {
+        int y = segs[c].y;
+        if (parentSeg[y]>=0) {
+            return false;
+        }
+        parentSeg[y] = c;
+    }
+    for (size_t i=nn0; i<nn; i++) {
+        order.push_back(i);
+    }
+    // new entries in the rows of the old nodes, (row, column, tag), and in the new rows
+    std::vector<std::array<int,3>> add;
+    std::vector<std::vector<std::pair<int,int>>> rows(nn-nn0); // (column, entry tag) per new row
+    for (size_t i=nn0; i<nn; i++) {
+        rows[i-nn0].push_back(std::make_pair(i, -1));
+    }
+    for (size_t c=ns0; c<ns; c++) {
+        int x = segs[c].x;
+        int y = segs[c].y;
+        if (x<int(nn0)) {
+            add.push_back({ { x, y, int(2*c) } });
+        } else {
+            rows[x-nn0].push_back(std::make_pair(y, 2*c));
+        }
+        rows[y-nn0].push_back(std::make_pair(x, 2*c+1));
+    }
+    std::sort(add.begin(), add.end());
+    // shift the old rows, from the last to the first
+    std::vector<int> shift(nn0+1, 0); // entries added before row i
+    for (const auto& a : add) {
+        shift[a[0]+1]++;
+    }
+    for (size_t i=0; i<nn0; i++) {
+        shift[i+1] += shift[i];
+    }
+    size_t nnz0 = colIdx.size();
+    colIdx.resize(nnz0+add.size());
+    values.resize(nnz0+add.size(), 0.);
+    ijPos.resize(2*ns, 0);
+    size_t k = add.size();
+    for (size_t i=nn0; i-->0; ) {
+        int s0 = rowPtr[i], s1 = rowPtr[i+1];
+        int e = s1+shift[i+1]; // end of the row after the shift
+        while ((k>0) && (add[k-1][0]==int(i))) { // the new columns are larger than the old ones
+            k--;
+            e--;
+            colIdx[e] = add[k][1];
+            values[e] = 0.;
+            ijPos[add[k][2]] = e;
+        }
+        if (shift[i]>0) {
+            for (int l=s1; l-->s0; ) {
+                colIdx[l+shift[i]] = colIdx[l];
+                values[l+shift[i]] = values[l];
+            }
+        }
+        if ((s1-s0==1) && (shift[i+1]>shift[i])) { // the node had no segments (x_i = 0)
+            values[s0+shift[i]] = 0.;
+        }
+        rowPtr[i+1] = s1+shift[i+1];
+    }
+    for (size_t c=0; c<ns0; c++) { // the old entries moved with their rows
+        ijPos[2*c] += shift[segs[c].x];
+        ijPos[2*c+1] += shift[segs[c].y];
+    }
+    for (size_t i=0; i<nn0; i++) {
+        diagPos[i] += shift[i];
+    }
+    // the new rows
+    rowPtr.resize(nn+1);
+    diagPos.resize(nn);
+    for (size_t i=nn0; i<nn; i++) {
+        auto& r = rows[i-nn0];
+        std::sort(r.begin(), r.end());
+        for (const auto& e : r) {
+            if (e.second<0) {
+                diagPos[i] = colIdx.size();
+            } else {
+                ijPos[e.second] = colIdx.size();
+            }
+            colIdx.push_back(e.first);
+            values.push_back(0.);
+        }
+        rowPtr[i+1] = colIdx.size();
+    }
+    return true;
+}
+
+/**
+ * Row indices of the triplets (I,J,V), for segment c the entries (i,i), (i,j), (j,j), (j,i)
+ */
+std::vector<int> Doussan::getI() const
+{
+    std::vector<int> I(4*segs.size());
+    for (size_t c=0; c<segs.size(); c++) {
+        I[4*c] = segs[c].x;
+        I[4*c+1] = segs[c].x;
+        I[4*c+2] = segs[c].y;
+        I[4*c+3] = segs[c].y;
+    }
+    return I;
+}
+
+/**
+ * Column indices of the triplets (I,J,V), @see Doussan::getI
+ */
+std::vector<int> Doussan::getJ() const
+{
+    std::vector<int> J(4*segs.size());
+    for (size_t c=0; c<segs.size(); c++) {
+        J[4*c] = segs[c].x;
+        J[4*c+1] = segs[c].y;
+        J[4*c+2] = segs[c].y;
+        J[4*c+3] = segs[c].x;
+    }
+    return J;
+}
+
+/**
+ * Values of the triplets (I,J,V), duplicate entries are summed, @see Doussan::getI
+ */
+std::vector<double> Doussan::getV() const
+{
+    std::vector<double> V(4*segs.size());
+    for (size_t c=0; c<segs.size(); c++) {
+        double l = std::max(length[c], 1.e-12);
+        double a = radii[c];
+        double cii = a*M_PI*l*kr_[c]/2.+kx_[c]/l;
+        double cij = a*M_PI*l*kr_[c]/2.-kx_[c]/l;
+        V[4*c] = cii;
+        V[4*c+1] = cij;
+        V[4*c+2] = cii;
+        V[4*c+3] = cij;
+    }
+    return V;
+}
+
+/**
+ * Removes all Neumann and Dirichlet boundary conditions
+ */
+void Doussan::clearBoundaryConditions()
+{
+    neumannNodes.clear();
+    neumannFlux.clear();
+    dirichletNodes.clear();
+    dirichletValue.clear();
+}
+
+/**
+ * Solves Q x = b with the boundary conditions, by eliminating the nodes from the tips towards the bases
+ * (Gaussian elimination in the order of the tree, in linear time).
+ *
+ * \return          xylem pressure per node
+ */
+std::vector<double> Doussan::solve() const
+{
+    if (!tree) {
+        std::cout << "Doussan::solve: the segments are not a tree, use the sparse matrix with a general solver\n" << std::flush;
+        throw std::invalid_argument("Doussan::solve: the segments are not a tree");
+    }
+    size_t nn = nodes.size();
+    std::vector<double> d(nn), r = b, x(nn, 0.);
+    for (size_t i=0; i<nn; i++) {
+        d[i] = values[diagPos[i]];
+    }
+    for (size_t k=0; k<neumannNodes.size(); k++) {
+        r.at(neumannNodes[k]) += neumannFlux[k];
+    }
+    std::vector<bool> fixed(nn, false);
+    for (size_t k=0; k<dirichletNodes.size(); k++) {
+        fixed.at(dirichletNodes[k]) = true;
+        x[dirichletNodes[k]] = dirichletValue[k];
+    }
+    for (size_t k=nn; k-->0; ) { // tips first
+        int i = order[k];
+        int c = parentSeg[i];
+        if (c<0) {
+            continue;
+        }
+        int p = segs[c].x;
+        double a = values[ijPos[2*c+1]]; // Q(i,p)
+        if (fixed[i]) {
+            if (!fixed[p]) {
+                r[p] -= a*x[i];
+            }
+        } else if (fixed[p]) {
+            r[i] -= a*x[p];
+        } else {
+            double m = a/d[i];
+            d[p] -= m*a;
+            r[p] -= m*r[i];
+        }
+    }
+    for (size_t k=0; k<nn; k++) { // bases first
+        int i = order[k];
+        if (fixed[i]) {
+            continue;
+        }
+        int c = parentSeg[i];
+        if ((c<0) || fixed[segs[c].x]) {
+            x[i] = r[i]/d[i];
+        } else {
+            x[i] = (r[i]-values[ijPos[2*c+1]]*x[segs[c].x])/d[i];
+        }
+    }
+    return x;
+}
+
+/**
+ * Axial flux per segment, Eqn (6)
+ *
+ * @param x         xylem pressure per node
+ */
+std::vector<double> Doussan::getAxialFlux(const std::vector<double>& x) const
+{
+    std::vector<double> f(segs.size());
+    for (size_t c=0; c<segs.size(); c++) {
+        int i = segs[c].x;
+        int j = segs[c].y;
+        double l = std::max(length[c], 1.e-12);
+        double vz = (nodes[j].z-nodes[i].z)/l;
+        f[c] = -kx_[c]*((x.at(j)-x.at(i))/l+rho*g*vz);
+    }
+    return f;
+}
+
+/**
+ * Radial flux per segment, Eqn (7)
+ *
+ * @param x         xylem pressure per node
+ */
+std::vector<double> Doussan::getRadialFlux(const std::vector<double>& x) const
+{
+    std::vector<double> f(segs.size());
+    for (size_t c=0; c<segs.size(); c++) {
+        int i = segs[c].x;
+        int j = segs[c].y;
+        f[c] = -2.*radii[c]*M_PI*length[c]*kr_[c]*(soilP[c]-(x.at(j)+x.at(i))/2.);
+    }
+    return f;
+}
+
+/**
+ * Piecewise linear interpolation of the table (@param x, @param y) at @param x0, constant beyond the table
+ */
+double Doussan::interpolate(const std::vector<double>& x, const std::vector<double>& y, double x0)
+{
+    if (x0<=x.front()) {
+        return y.front();
+    }
+    if (x0>=x.back()) {
+        return y.back();
+    }
+    size_t i = std::upper_bound(x.begin(), x.end(), x0)-x.begin(); // x[i-1] <= x0 < x[i]
+    double t = (x0-x[i-1])/(x[i]-x[i-1]);
+    return y[i-1]+t*(y[i]-y[i-1]);
+}
+
+} // namespace CRootBox
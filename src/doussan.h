@@ -0,0 +1,134 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef DOUSSAN_H_
+#define DOUSSAN_H_
+
+#include "mymath.h"
+#include "Organism.h"
+
+#include <vector>
+
+namespace CRootBox {
+
+class Organ;
+class SoilLookUp;
+
+/**
+ * Assembles the Doussan linear system Q x = b, for the xylem pressure x in the nodes of the root system
+ * (Doussan et al. 1998, @see python/xylem_flux.py)
+ *
+ * Segment c = (i,j) with length l, radius a, radial conductivity kr, and axial conductivity kx adds
+ * cii = a pi l kr / 2 + kx / l to Q(i,i) and Q(j,j), cij = a pi l kr / 2 - kx / l to Q(i,j) and Q(j,i),
+ * and a pi l kr p_s +- kx rho g v_z to b(i) and b(j), where p_s is the soil matric potential at the segment mid point,
+ * and v_z the z-component of the normed segment direction.
+ *
+ * The matrix is given in compressed sparse row format (rows sorted by column), or as triplets (I,J,V).
+ * Since the root system is a tree, Doussan::solve eliminates the nodes from the tips towards the base, in linear time and
+ * without fill in.
+ *
+ * Conductivities may depend on organ type, sub type and segment age, by overwriting radialConductivity and axialConductivity,
+ * or by piecewise linear tables over segment age (setKrTable, setKxTable).
+ * After a simulation step, Doussan::update only adds the new segments to the matrix (new rows, and new columns at the end
+ * of the rows of their parent nodes), and recomputes the segments that were moved, or whose conductivity depends on their age.
+ */
+class Doussan
+{
+public:
+
+    Doussan(const Organism& plant, SoilLookUp* soil = nullptr); ///< soil matric potential per position, zero if there is no soil
+    virtual ~Doussan() { }
+
+    virtual double radialConductivity(int ot, int subType, double age) const; ///< table or constant kr value, overwrite to add sense
+    virtual double axialConductivity(int ot, int subType, double age) const; ///< table or constant kx value, overwrite to add sense
+    virtual bool overwritesConductivities() const; ///< true, if the conductivities are overwritten, Doussan::update recomputes them for all segments
+
+    void setKrTable(const std::vector<double>& age, const std::vector<double>& kr); ///< radial conductivity, piecewise linear in segment age
+    void setKxTable(const std::vector<double>& age, const std::vector<double>& kx); ///< axial conductivity, piecewise linear in segment age
+
+    void init(int ot = -1); ///< copies the segments of organ type ot, and assembles the system
+    void update(); ///< adds the segments of the last time step, and updates the system
+    void assemble(); ///< computes conductivities and soil potentials of all segments, and the linear system (e.g. after the soil changed)
+
+    /* compressed sparse row matrix Q, and rhs b */
+    const std::vector<int>& getRowPtr() const { return rowPtr; } ///< row i are the entries rowPtr[i] .. rowPtr[i+1]-1
+    const std::vector<int>& getColIdx() const { return colIdx; } ///< column index per entry
+    const std::vector<double>& getValues() const { return values; } ///< value per entry
+    const std::vector<double>& getB() const { return b; } ///< rhs, without boundary conditions
+
+    /* triplets, Q = sparse((I,J), V) */
+    std::vector<int> getI() const; ///< row indices, four per segment
+    std::vector<int> getJ() const; ///< column indices, four per segment
+    std::vector<double> getV() const; ///< values, four per segment
+
+    /* boundary conditions and solution */
+    void addNeumann(int node, double flux) { neumannNodes.push_back(node); neumannFlux.push_back(flux); } ///< adds a flux to the rhs
+    void addDirichlet(int node, double p) { dirichletNodes.push_back(node); dirichletValue.push_back(p); } ///< fixes the pressure in a node
+    void clearBoundaryConditions(); ///< removes all boundary conditions
+    std::vector<double> solve() const; ///< xylem pressure per node, linear time tree solver
+    std::vector<double> getAxialFlux(const std::vector<double>& x) const; ///< axial flux per segment
+    std::vector<double> getRadialFlux(const std::vector<double>& x) const; ///< radial flux per segment
+
+    const std::vector<Vector2i>& getSegments() const { return segs; } ///< segments of the system (new segments are appended by update)
+    const std::vector<Organ*>& getSegmentOrigins() const { return segO; } ///< organ per segment
+    bool isTree() const { return tree; } ///< true, if each node ends at most one segment, and there are no cycles
+
+    double kr = 0; ///< the constant value of radialConductivity, if not overwritten and no table is set
+    double kx = 0; ///< the constant value of axialConductivity, if not overwritten and no table is set
+    double rho = 1.; ///< density of soil water
+    double g = 1.; ///< gravitational acceleration (rho g = 1 for pressure heads)
+
+    std::vector<Vector3d> nodes;
+    std::vector<Vector2i> segs;
+    std::vector<Organ*> segO;
+    std::vector<double> segCTs; ///< creation time per segment
+
+    /* per segment, computed by Doussan::assemble */
+    std::vector<double> radii;
+    std::vector<double> length;
+    std::vector<double> kr_;
+    std::vector<double> kx_;
+    std::vector<double> soilP; ///< soil matric potential at the segment mid point
+
+protected:
+
+    static double interpolate(const std::vector<double>& x, const std::vector<double>& y, double x0);
+
+    void setConductivities(size_t c, double simtime); ///< length, kr, and kx of segment c
+    void addSegment(size_t c, double sign); ///< adds (sign = 1) or removes (sign = -1) the entries of segment c to Q and b
+    void buildPattern(); ///< sparsity pattern and tree structure of all segments
+    bool appendPattern(size_t nn0, size_t ns0); ///< adds the rows of the new nodes, and the entries of the new segments
+    void setAssembled(double simtime, bool all); ///< remembers the parameters of the assembly, and the age dependent segments
+    bool changedParameters() const; ///< the parameters changed since the last assembly
+
+    const Organism& plant;
+    SoilLookUp* soil;
+    int ot = -1;
+    size_t shrinks = 0; ///< number of node store shrinks of the organism at the last init or update
+
+    std::vector<double> krAge, krValue, kxAge, kxValue; ///< age dependent tables
+    bool tablesChanged = false; ///< a table was set since the last assembly
+    double assembledKr = 0., assembledKx = 0., assembledRho = 1., assembledG = 1.; ///< parameters of the last assembly
+    std::vector<int> varying; ///< segments, whose conductivity changes with their age
+    StepDelta delta; ///< changes of the last time step (see Organism::getStepDelta)
+
+    std::vector<int> rowPtr;
+    std::vector<int> colIdx;
+    std::vector<double> values;
+    std::vector<double> b;
+    std::vector<int> diagPos; ///< entry of Q(i,i) per node
+    std::vector<int> ijPos; ///< entries of Q(i,j) and Q(j,i) per segment (two each)
+
+    /* tree structure */
+    bool tree = true;
+    std::vector<int> parentSeg; ///< segment ending in the node, or -1
+    std::vector<int> order; ///< nodes in breadth first order, from the bases to the tips
+
+    std::vector<int> neumannNodes;
+    std::vector<double> neumannFlux;
+    std::vector<int> dirichletNodes;
+    std::vector<double> dirichletValue;
+
+};
+
+} // namespace CRootBox
+
+#endif
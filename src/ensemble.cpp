@@ -0,0 +1,548 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "ensemble.h"
+
+#include "analysis.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+
+namespace CRootBox {
+
+/**
+ * Adds the sample @param x, all samples must have the same size
+ */
+void RunningStatistics::add(const std::vector<double>& x)
+{
+    if (n==0) {
+        mean = std::vector<double>(x.size());
+        m2 = std::vector<double>(x.size());
+    }
+    assert(x.size()==mean.size() && "RunningStatistics::add: samples must have equal size");
+    n++;
+    for (size_t i=0; i<x.size(); i++) {
+        double d = x[i]-mean[i];
+        mean[i] += d/n;
+        m2[i] += d*(x[i]-mean[i]);
+    }
+}
+
+/**
+ * @return the unbiased sample variance per component
+ */
+std::vector<double> RunningStatistics::getVariance() const
+{
+    std::vector<double> v(m2.size());
+    if (n>1) {
+        for (size_t i=0; i<m2.size(); i++) {
+            v[i] = m2[i]/(n-1);
+        }
+    }
+    return v;
+}
+
+/**
+ * The prototype is not copied, and must live as long as the ensemble.
+ * Only its organ parameters are used, set geometry and soil with RootSystemEnsemble::setGeometry and
+ * RootSystemEnsemble::setSoil.
+ *
+ * @param prototype     root system holding the organ parameters of all replicates
+ */
+RootSystemEnsemble::RootSystemEnsemble(const RootSystem& prototype) :prototype(prototype)
+{ }
+
+/**
+ * Sets the vertical distribution, that is evaluated for each replicate (@see SegmentAnalyser::distribution)
+ *
+ * @param name      parameter name (e.g. "length")
+ * @param top       vertical top position (cm)
+ * @param bot       vertical bot position (cm)
+ * @param n         number of layers (each with a height of (bot-top)/n )
+ * @param exact     calculates the intersection with the layer boundaries (true), only based on segment midpoints (false)
+ */
+void RootSystemEnsemble::setDistribution(std::string name, double top, double bot, int n, bool exact)
+{
+    distName = name;
+    distTop = top;
+    distBot = bot;
+    distN = n;
+    distExact = exact;
+}
+
+/**
+ * Adds a parameter, that is summed over all organs of each replicate (@see Organism::getSummed)
+ *
+ * @param name      parameter name (e.g. "length")
+ */
+void RootSystemEnsemble::addSummed(std::string name)
+{
+    summedNames.push_back(name);
+}
+
+/**
+ * Simulates the replicates, and reduces their results. Replicate i uses the seed @param seed + i.
+ * Statistics of a previous run are discarded.
+ *
+ * @param replicates    number of replicates
+ * @param seed          seed of the first replicate
+ * @param simtime       simulation time [day]
+ * @param dt            time step [day]
+ * @param threads       number of threads (0 uses all available cores)
+ */
+void RootSystemEnsemble::run(int replicates, unsigned int seed, double simtime, double dt, int threads)
+{
+    if (dt<=0) {
+        throw std::invalid_argument("RootSystemEnsemble::run: time step must be positive");
+    }
+    if (threads<1) {
+        threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    }
+    distribution = RunningStatistics();
+    summed = RunningStatistics();
+    tips = RunningStatistics();
+
+    std::mutex mutex;
+    std::map<int, Replicate> pending; // finished replicates, waiting for their turn
+    int next = 0; // next replicate to reduce
+    parallelFor(replicates, threads, [&](int i) {
+        Replicate r = simulateReplicate(seed+i, simtime, dt);
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[i] = r;
+        while (!pending.empty() && (pending.begin()->first==next)) {
+            reduce(pending.begin()->second);
+            pending.erase(pending.begin());
+            next++;
+        }
+    });
+}
+
+/**
+ * Creates a root system with the prototype's parameters, simulates and evaluates it
+ *
+ * @param seed          random seed of the replicate
+ * @param simtime       simulation time [day]
+ * @param dt            time step [day]
+ * @return the results of the replicate
+ */
+RootSystemEnsemble::Replicate RootSystemEnsemble::simulateReplicate(unsigned int seed, double simtime, double dt) const
+{
+    RootSystem rs;
+    for (int ot = 0; ot < Organism::organTypeNames.size(); ot++) { // copy organ parameters
+        for (auto p : prototype.getSharedOrganRandomParameter(ot)) {
+            rs.setOrganRandomParameter(p->copy(&rs));
+        }
+    }
+    if (geometry!=nullptr) {
+        rs.setGeometry(geometry);
+    }
+    if (soil!=nullptr) {
+        rs.setSoil(soil);
+    }
+    rs.setSeed(seed);
+    rs.initialize();
+    int n = std::round(simtime/dt);
+    for (int i=0; i<n; i++) {
+        rs.simulate(dt);
+    }
+    Replicate r;
+    if (distN>0) {
+        SegmentAnalyser ana(rs);
+        r.distribution = ana.distribution(distName, distTop, distBot, distN, distExact);
+    }
+    for (const auto& name : summedNames) {
+        r.summed.push_back(rs.getSummed(name));
+    }
+    r.tips.push_back(rs.getRootTips().size());
+    return r;
+}
+
+/**
+ * Adds the results of a single replicate to the running statistics
+ */
+void RootSystemEnsemble::reduce(const Replicate& r)
+{
+    distribution.add(r.distribution);
+    summed.add(r.summed);
+    tips.add(r.tips);
+}
+
+/**
+ * @return the mean of the summed parameter @param name over all replicates
+ */
+double RootSystemEnsemble::getSummedMean(std::string name) const
+{
+    auto it = std::find(summedNames.begin(), summedNames.end(), name);
+    if (it==summedNames.end()) {
+        throw std::invalid_argument("RootSystemEnsemble::getSummedMean: parameter "+name+" was not added");
+    }
+    return summed.getMean().at(it-summedNames.begin());
+}
+
+/**
+ * @return the variance of the summed parameter @param name over all replicates
+ */
+double RootSystemEnsemble::getSummedVariance(std::string name) const
+{
+    auto it = std::find(summedNames.begin(), summedNames.end(), name);
+    if (it==summedNames.end()) {
+        throw std::invalid_argument("RootSystemEnsemble::getSummedVariance: parameter "+name+" was not added");
+    }
+    return summed.getVariance().at(it-summedNames.begin());
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string RootSystemEnsemble::toString() const
+{
+    std::stringstream str;
+    str << "RootSystemEnsemble with " << getNumberOfReplicates() << " replicates";
+    if (distN>0) {
+        str << ", distribution of " << distName << " in " << distN << " layers";
+    }
+    str << ", summed parameters: ";
+    for (const auto& name : summedNames) {
+        str << name << " ";
+    }
+    return str.str();
+}
+
+/**
+ * The prototype is not copied, and must live as long as the sweep.
+ * Only its organ parameters are used, set geometry and soil with ParameterSweep::setGeometry and
+ * ParameterSweep::setSoil.
+ *
+ * @param prototype     root system holding the organ parameters of all samples
+ */
+ParameterSweep::ParameterSweep(const RootSystem& prototype) :prototype(prototype)
+{ }
+
+/**
+ * Adds a swept parameter, previous samples are discarded
+ *
+ * @param organType     organ type (e.g. Organism::ot_root)
+ * @param subType       sub type, the parameter set must be defined by the prototype
+ * @param name          parameter name (@see OrganRandomParameter::setParameter), e.g. "lb", "theta", or "r_dev"
+ * @param min           minimal value of the range
+ * @param max           maximal value of the range
+ */
+void ParameterSweep::addParameter(int organType, int subType, std::string name, double min, double max)
+{
+    auto p = prototype.getSharedOrganRandomParameter(organType, subType); // throws, if it was not set
+    if (std::isnan(p->getParameter(name)) || !(max>=min)) {
+        std::cout << "ParameterSweep::addParameter: unknown parameter " << name << ", or invalid range\n" << std::flush;
+        throw std::invalid_argument("ParameterSweep::addParameter: unknown parameter "+name+", or invalid range");
+    }
+    parameters.push_back({ organType, subType, name, min, max });
+    samples.clear();
+}
+
+/**
+ * Adds a parameter, that is summed over all organs of each sample (@see Organism::getSummed)
+ *
+ * @param name      parameter name (e.g. "length")
+ */
+void ParameterSweep::addSummed(std::string name)
+{
+    summedNames.push_back(name);
+}
+
+/**
+ * Creates the samples over the ranges of the parameters
+ *
+ * @param sampling      ParameterSweep::s_grid (n^d samples, the ranges are divided into n-1 intervals),
+ *                      ParameterSweep::s_latinhypercube (n samples), or ParameterSweep::s_sobol (n samples)
+ * @param n             number of samples, or number of levels per parameter for the grid
+ * @param seed          random seed of the Latin hypercube
+ */
+void ParameterSweep::setSamples(int sampling, int n, unsigned int seed)
+{
+    int d = parameters.size();
+    if ((d==0) || (n<1)) {
+        std::cout << "ParameterSweep::setSamples: add parameters first, and use at least one sample\n" << std::flush;
+        throw std::invalid_argument("ParameterSweep::setSamples: add parameters first, and use at least one sample");
+    }
+    std::vector<std::vector<double>> u; // points in the unit cube
+    switch (sampling) {
+    case s_grid: {
+        size_t m = 1;
+        for (int j=0; j<d; j++) {
+            if (m>size_t(std::numeric_limits<int>::max())/n) {
+                std::cout << "ParameterSweep::setSamples: too many grid points\n" << std::flush;
+                throw std::invalid_argument("ParameterSweep::setSamples: too many grid points");
+            }
+            m *= n;
+        }
+        u = std::vector<std::vector<double>>(m, std::vector<double>(d));
+        for (size_t i=0; i<m; i++) {
+            size_t k = i;
+            for (int j=0; j<d; j++) { // first parameter fastest
+                u[i][j] = (n>1) ? double(k%n)/(n-1) : 0.5;
+                k /= n;
+            }
+        }
+        break;
+    }
+    case s_latinhypercube:
+        u = latinHypercube(n, d, seed);
+        break;
+    case s_sobol:
+        u = sobol(n, d);
+        break;
+    default:
+        std::cout << "ParameterSweep::setSamples: unknown sampling " << sampling << "\n" << std::flush;
+        throw std::invalid_argument("ParameterSweep::setSamples: unknown sampling");
+    }
+    samples = u;
+    for (auto& x : samples) {
+        for (int j=0; j<d; j++) {
+            x[j] = parameters[j].min+x[j]*(parameters[j].max-parameters[j].min);
+        }
+    }
+}
+
+/**
+ * Sets the samples directly
+ *
+ * @param samples       the parameter values of each sample, in the order the parameters were added
+ */
+void ParameterSweep::setSamples(const std::vector<std::vector<double>>& samples)
+{
+    for (const auto& x : samples) {
+        if (x.size()!=parameters.size()) {
+            std::cout << "ParameterSweep::setSamples: each sample needs a value for each parameter\n" << std::flush;
+            throw std::invalid_argument("ParameterSweep::setSamples: each sample needs a value for each parameter");
+        }
+    }
+    this->samples = samples;
+}
+
+/**
+ * Latin hypercube sampling, each of the n strata of each axis contains exactly one point
+ *
+ * @param n             number of points
+ * @param d             dimension
+ * @param seed          random seed
+ */
+std::vector<std::vector<double>> ParameterSweep::latinHypercube(int n, int d, unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::vector<std::vector<double>> u(n, std::vector<double>(d));
+    std::vector<int> strata(n);
+    for (int j=0; j<d; j++) {
+        for (int i=0; i<n; i++) {
+            strata[i] = i;
+        }
+        for (int i=n-1; i>0; i--) { // Fisher-Yates, std::shuffle is implementation defined
+            std::swap(strata[i], strata[std::uniform_int_distribution<int>(0, i)(gen)]);
+        }
+        for (int i=0; i<n; i++) {
+            u[i][j] = (strata[i]+uniform(gen))/n;
+        }
+    }
+    return u;
+}
+
+/**
+ * Sobol sequence in Gray code order, with the direction numbers of Joe and Kuo (2008) for up to 16 dimensions
+ *
+ * @param n             number of points, the origin (first point of the sequence) is skipped
+ * @param d             dimension (at most 16)
+ */
+std::vector<std::vector<double>> ParameterSweep::sobol(int n, int d)
+{
+    static const int maxDim = 16;
+    static const unsigned int s[maxDim] = { 0, 1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5, 5, 6, 6, 6 }; // degree of the primitive polynomial
+    static const unsigned int a[maxDim] = { 0, 0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13, 14, 1, 13, 16 }; // its inner coefficients
+    static const unsigned int m[maxDim][6] = { {}, { 1 }, { 1, 3 }, { 1, 3, 1 }, { 1, 1, 1 }, { 1, 1, 3, 3 },
+        { 1, 3, 5, 13 }, { 1, 1, 5, 5, 17 }, { 1, 1, 5, 5, 5 }, { 1, 1, 7, 11, 19 }, { 1, 1, 5, 1, 1 },
+        { 1, 1, 1, 3, 11 }, { 1, 3, 5, 5, 31 }, { 1, 3, 3, 9, 7, 49 }, { 1, 1, 1, 15, 21, 21 }, { 1, 3, 1, 13, 27, 49 } };
+    if (d>maxDim) {
+        std::cout << "ParameterSweep::sobol: at most " << maxDim << " dimensions are supported\n" << std::flush;
+        throw std::invalid_argument("ParameterSweep::sobol: too many dimensions");
+    }
+    const int bits = 32;
+    std::vector<std::vector<uint32_t>> v(d, std::vector<uint32_t>(bits)); // direction numbers
+    for (int j=0; j<d; j++) {
+        for (int k=0; k<bits; k++) {
+            if (j==0) {
+                v[j][k] = uint32_t(1) << (bits-1-k);
+            } else if (k<int(s[j])) {
+                v[j][k] = m[j][k] << (bits-1-k);
+            } else {
+                v[j][k] = v[j][k-s[j]] ^ (v[j][k-s[j]] >> s[j]);
+                for (unsigned int l=1; l<s[j]; l++) {
+                    v[j][k] ^= ((a[j] >> (s[j]-1-l)) & 1) * v[j][k-l];
+                }
+            }
+        }
+    }
+    std::vector<std::vector<double>> u(n, std::vector<double>(d));
+    std::vector<uint32_t> x(d, 0);
+    for (int i=0; i<n; i++) {
+        int c = 0; // rightmost zero bit of i
+        while ((i >> c) & 1) {
+            c++;
+        }
+        for (int j=0; j<d; j++) {
+            x[j] ^= v[j][c];
+            u[i][j] = std::ldexp(double(x[j]), -bits);
+        }
+    }
+    return u;
+}
+
+/**
+ * Simulates the samples, and writes their results. Sample i uses the seed @param seed + i.
+ * Results of a previous run are discarded.
+ *
+ * @param simtime       simulation time [day]
+ * @param dt            time step [day]
+ * @param threads       number of threads (0 uses all available cores)
+ * @param filename      tab separated output file, written while the samples are finished (empty for no file)
+ * @param seed          seed of the first sample
+ */
+void ParameterSweep::run(double simtime, double dt, int threads, std::string filename, unsigned int seed)
+{
+    if ((dt<=0) || samples.empty()) {
+        std::cout << "ParameterSweep::run: time step must be positive, and samples must be set\n" << std::flush;
+        throw std::invalid_argument("ParameterSweep::run: time step must be positive, and samples must be set");
+    }
+    if (threads<1) {
+        threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    }
+    auto names = getColumnNames();
+    int n = samples.size();
+    columns = std::vector<std::vector<double>>(names.size(), std::vector<double>(n));
+    std::ofstream file;
+    if (!filename.empty()) {
+        file.open(filename.c_str());
+        if (!file.good()) {
+            std::cout << "ParameterSweep::run: could not open file " << filename << "\n" << std::flush;
+            throw std::invalid_argument("ParameterSweep::run: could not open file "+filename);
+        }
+        file.precision(17);
+        for (size_t j=0; j<names.size(); j++) {
+            file << names[j] << ((j+1<names.size()) ? "\t" : "\n");
+        }
+        file << std::flush;
+    }
+
+    std::mutex mutex;
+    int next = 0; // next sample to write
+    std::vector<bool> finished(n, false);
+    parallelFor(n, threads, [&](int i) {
+        std::vector<double> r = samples[i];
+        auto metrics = simulateSample(i, seed+i, simtime, dt);
+        r.insert(r.end(), metrics.begin(), metrics.end());
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t j=0; j<r.size(); j++) {
+            columns[j][i] = r[j];
+        }
+        finished[i] = true;
+        while ((next<n) && finished[next]) {
+            if (file.is_open()) {
+                for (size_t j=0; j<names.size(); j++) {
+                    file << columns[j][next] << ((j+1<names.size()) ? "\t" : "\n");
+                }
+                file << std::flush;
+            }
+            next++;
+        }
+    });
+}
+
+/**
+ * Creates a root system with the prototype's parameters, sets the parameters of the sample, simulates and evaluates it
+ *
+ * @param i             sample index
+ * @param seed          random seed of the sample
+ * @param simtime       simulation time [day]
+ * @param dt            time step [day]
+ * @return the metrics of the sample (summed parameters, number of root tips, number of nodes)
+ */
+std::vector<double> ParameterSweep::simulateSample(int i, unsigned int seed, double simtime, double dt) const
+{
+    RootSystem rs;
+    for (int ot = 0; ot < Organism::organTypeNames.size(); ot++) { // copy organ parameters
+        for (auto p : prototype.getSharedOrganRandomParameter(ot)) {
+            rs.setOrganRandomParameter(p->copy(&rs));
+        }
+    }
+    for (size_t j=0; j<parameters.size(); j++) {
+        const auto& p = parameters[j];
+        rs.getOrganRandomParameter(p.organType, p.subType)->setParameter(p.name, samples[i][j]);
+    }
+    if (geometry!=nullptr) {
+        rs.setGeometry(geometry);
+    }
+    if (soil!=nullptr) {
+        rs.setSoil(soil);
+    }
+    rs.setSeed(seed);
+    rs.initialize();
+    int n = std::round(simtime/dt);
+    for (int k=0; k<n; k++) {
+        rs.simulate(dt);
+    }
+    std::vector<double> r;
+    for (const auto& name : summedNames) {
+        r.push_back(rs.getSummed(name));
+    }
+    r.push_back(rs.getRootTips().size());
+    r.push_back(rs.getNumberOfNodes());
+    return r;
+}
+
+/**
+ * @return the column names: the parameters (organ type name, sub type, and parameter name, e.g. "root1.lb"),
+ * the summed parameters, "tips", and "nodes"
+ */
+std::vector<std::string> ParameterSweep::getColumnNames() const
+{
+    std::vector<std::string> names;
+    for (const auto& p : parameters) {
+        names.push_back(Organism::organTypeName(p.organType)+std::to_string(p.subType)+"."+p.name);
+    }
+    names.insert(names.end(), summedNames.begin(), summedNames.end());
+    names.push_back("tips");
+    names.push_back("nodes");
+    return names;
+}
+
+/**
+ * @return a column of the last run, one value per sample (@see ParameterSweep::getColumnNames)
+ */
+std::vector<double> ParameterSweep::getColumn(std::string name) const
+{
+    auto names = getColumnNames();
+    auto it = std::find(names.begin(), names.end(), name);
+    if ((it==names.end()) || columns.empty()) {
+        throw std::invalid_argument("ParameterSweep::getColumn: unknown column "+name+", or no run yet");
+    }
+    return columns.at(it-names.begin());
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string ParameterSweep::toString() const
+{
+    std::stringstream str;
+    str << "ParameterSweep with " << samples.size() << " samples, columns: ";
+    for (const auto& name : getColumnNames()) {
+        str << name << " ";
+    }
+    return str.str();
+}
+
+} // end namespace CRootBox
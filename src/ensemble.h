@@ -0,0 +1,168 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include "RootSystem.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace CRootBox {
+
+/**
+ * Running mean and variance of a vector valued quantity (Welford's algorithm)
+ */
+class RunningStatistics
+{
+public:
+
+    void add(const std::vector<double>& x); ///< adds a sample
+    int getN() const { return n; } ///< number of samples
+    std::vector<double> getMean() const { return mean; } ///< sample mean
+    std::vector<double> getVariance() const; ///< unbiased sample variance (zero for less than two samples)
+
+private:
+
+    int n = 0;
+    std::vector<double> mean;
+    std::vector<double> m2; // summed squared deviations from the mean
+
+};
+
+/**
+ * RootSystemEnsemble
+ *
+ * Runs stochastic replicates of a root system on a thread pool.
+ * Each replicate copies the organ parameters of a prototype root system, and is simulated with its own seed.
+ * The results of each replicate (vertical distribution, summed parameters, number of root tips) are reduced
+ * into running means and variances, as soon as the replicate is finished, and the root system is deleted.
+ *
+ * The reduction follows the replicate order, so the statistics do not depend on the number of threads.
+ */
+class RootSystemEnsemble
+{
+public:
+
+    RootSystemEnsemble(const RootSystem& prototype); ///< replicates use the organ parameters of the prototype
+    virtual ~RootSystemEnsemble() { }
+
+    /* setup */
+    void setGeometry(SignedDistanceFunction* geom) { geometry = geom; } ///< optionally, sets a confining geometry (shared by all replicates)
+    void setSoil(SoilLookUp* soil_) { soil = soil_; } ///< optionally, sets a soil for hydro tropism (shared by all replicates, must be thread safe)
+    void setDistribution(std::string name, double top, double bot, int n, bool exact = false); ///< vertical distribution evaluated for each replicate, @see SegmentAnalyser::distribution
+    void addSummed(std::string name); ///< adds a parameter that is summed for each replicate, @see Organism::getSummed
+
+    /* simulation */
+    void run(int replicates, unsigned int seed, double simtime, double dt = 1., int threads = 0); ///< simulates the replicates
+
+    /* results */
+    int getNumberOfReplicates() const { return tips.getN(); } ///< number of replicates of the last run
+    std::vector<double> getDistributionMean() const { return distribution.getMean(); } ///< mean vertical distribution
+    std::vector<double> getDistributionVariance() const { return distribution.getVariance(); } ///< variance of the vertical distribution
+    double getSummedMean(std::string name) const; ///< mean of a summed parameter
+    double getSummedVariance(std::string name) const; ///< variance of a summed parameter
+    double getTipsMean() const { return tips.getMean().at(0); } ///< mean number of root tips
+    double getTipsVariance() const { return tips.getVariance().at(0); } ///< variance of the number of root tips
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    /* results of a single replicate */
+    struct Replicate {
+        std::vector<double> distribution;
+        std::vector<double> summed;
+        std::vector<double> tips;
+    };
+
+    virtual Replicate simulateReplicate(unsigned int seed, double simtime, double dt) const; ///< simulates and evaluates a single replicate
+    void reduce(const Replicate& r); ///< adds the results of a replicate to the statistics
+
+    const RootSystem& prototype;
+    SignedDistanceFunction* geometry = nullptr;
+    SoilLookUp* soil = nullptr;
+
+    std::string distName = "";
+    double distTop = 0.;
+    double distBot = 0.;
+    int distN = 0;
+    bool distExact = false;
+    std::vector<std::string> summedNames;
+
+    RunningStatistics distribution;
+    RunningStatistics summed;
+    RunningStatistics tips;
+
+};
+
+/**
+ * ParameterSweep
+ *
+ * Simulates a root system for samples of its organ parameters (e.g. for a sensitivity study), on a thread pool.
+ * Each sample copies the parsed organ parameters of a prototype root system, replaces the swept parameters
+ * (@see OrganRandomParameter::setParameter), and is simulated with its own seed.
+ *
+ * The samples are a full grid, a Latin hypercube, or a Sobol sequence over the parameter ranges (or set directly).
+ * The sample values and the summary metrics of each sample (summed parameters, number
+ * of root tips, number of nodes) are kept as columns, and are streamed into a tab separated text file with a
+ * header line, one line per sample, in the order of the samples (so the file does not depend on the number of threads).
+ */
+class ParameterSweep
+{
+public:
+
+    enum Sampling { s_grid = 0, s_latinhypercube = 1, s_sobol = 2 }; ///< sampling schemes
+
+    ParameterSweep(const RootSystem& prototype); ///< samples use the organ parameters of the prototype
+    virtual ~ParameterSweep() { }
+
+    /* setup */
+    void setGeometry(SignedDistanceFunction* geom) { geometry = geom; } ///< optionally, sets a confining geometry (shared by all samples)
+    void setSoil(SoilLookUp* soil_) { soil = soil_; } ///< optionally, sets a soil for hydro tropism (shared by all samples, must be thread safe)
+    void addParameter(int organType, int subType, std::string name, double min, double max); ///< adds a swept parameter with its range
+    void addSummed(std::string name); ///< adds a parameter that is summed for each sample, @see Organism::getSummed
+    void setSamples(int sampling, int n, unsigned int seed = 1); ///< creates n samples (grid: n levels per parameter)
+    void setSamples(const std::vector<std::vector<double>>& samples); ///< sets the parameter values of each sample directly
+
+    /* simulation */
+    void run(double simtime, double dt = 1., int threads = 0, std::string filename = "", unsigned int seed = 1); ///< simulates the samples
+
+    /* results */
+    int getNumberOfParameters() const { return parameters.size(); }
+    int getNumberOfSamples() const { return samples.size(); }
+    std::vector<double> getSample(int i) const { return samples.at(i); } ///< parameter values of sample i
+    std::vector<std::string> getColumnNames() const; ///< parameter columns, followed by the metric columns
+    std::vector<double> getColumn(std::string name) const; ///< a column of the last run
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    struct Parameter {
+        int organType;
+        int subType;
+        std::string name;
+        double min;
+        double max;
+    };
+
+    virtual std::vector<double> simulateSample(int i, unsigned int seed, double simtime, double dt) const; ///< simulates and evaluates a single sample
+
+    static std::vector<std::vector<double>> latinHypercube(int n, int d, unsigned int seed); ///< n points in the unit cube
+    static std::vector<std::vector<double>> sobol(int n, int d); ///< the first n points (without the origin) in the unit cube
+
+    const RootSystem& prototype;
+    SignedDistanceFunction* geometry = nullptr;
+    SoilLookUp* soil = nullptr;
+
+    std::vector<Parameter> parameters;
+    std::vector<std::string> summedNames;
+    std::vector<std::vector<double>> samples;
+    std::vector<std::vector<double>> columns; ///< columns of the last run
+
+};
+
+} // end namespace CRootBox
+
+#endif
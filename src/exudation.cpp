@@ -0,0 +1,428 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "exudation.h"
+
+#include "RootSystem.h"
+#include "sdf_rs.h"
+#include "parallel.h"
+#include "gauss_legendre/gauss_legendre.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace CRootBox {
+
+/**
+ * Gauss-Legendre quadrature of f over [a,b] with the cached table @param q (same summation as gauss_legendre)
+ */
+template<class Q, class F>
+static double gauss(const Q& q, double a, double b, F f)
+{
+    size_t m = q.x.size();
+    double A = 0.5*(b-a);
+    double B = 0.5*(b+a);
+    double s = 0.;
+    size_t i0 = 0;
+    if (q.n&1) { // n - odd
+        s = q.w[0]*f(B);
+        i0 = 1;
+    }
+    for (size_t i=i0; i<m; i++) {
+        double Ax = A*q.x[i];
+        s += q.w[i]*(f(B+Ax)+f(B-Ax));
+    }
+    return A*s;
+}
+
+/**
+ * 2D Gauss-Legendre quadrature of f over [a,b]x[c,d] with the cached table @param q (same summation as gauss_legendre_2D_cube)
+ */
+template<class Q, class F>
+static double gauss2D(const Q& q, double a, double b, double c, double d, F f)
+{
+    size_t m = q.x.size();
+    double A = 0.5*(b-a);
+    double B = 0.5*(b+a);
+    double C = 0.5*(d-c);
+    double D = 0.5*(d+c);
+    double s = 0.;
+    size_t i0 = 0;
+    if (q.n&1) { // n - odd
+        s = q.w[0]*q.w[0]*f(B,D);
+        double t = 0.;
+        for (size_t j=1; j<m; j++) {
+            double Cy = C*q.x[j];
+            t += q.w[j]*(f(B,D+Cy)+f(B,D-Cy));
+        }
+        s += q.w[0]*t;
+        t = 0.;
+        for (size_t i=1; i<m; i++) {
+            double Ax = A*q.x[i];
+            t += q.w[i]*(f(B+Ax,D)+f(B-Ax,D));
+        }
+        s += q.w[0]*t;
+        i0 = 1;
+    }
+    for (size_t i=i0; i<m; i++) {
+        double Ax = A*q.x[i];
+        for (size_t j=i0; j<m; j++) {
+            double Cy = C*q.x[j];
+            s += q.w[i]*q.w[j]*(f(B+Ax,D+Cy)+f(Ax+B,D-Cy)+f(B-Ax,D+Cy)+f(B-Ax,D-Cy));
+        }
+    }
+    return C*A*s;
+}
+
+/**
+ * Constructor
+ *
+ * @param length    length of the domain along the x-axis, centered [cm]
+ * @param width     width of the domain along the y-axis, centered [cm]
+ * @param depth     depth of the domain along the z-axis, from -depth to 0 [cm]
+ * @param nx, ny, nz number of grid points per axis
+ * @param rs        the root system, its roots are collected at each ExudationModel::calculate
+ */
+ExudationModel::ExudationModel(double length, double width, double depth, int nx, int ny, int nz, RootSystem& rs)
+:grid(length, width, depth, nx, ny, nz), rs(rs)
+{
+    dx3 = (length/nx)*(width/ny)*(depth/nz); // for integration of eqn 13
+}
+
+/**
+ * Calculates the exudate concentration at each grid point
+ *
+ * Contributions of roots that did not change since the last call are reused. The result is also stored in grid.data
+ * (in the layout of the grid, @see RectilinearGrid3D::index), so the model can be used as soil look up.
+ *
+ * @param tend      simulation time [day]
+ * \return          concentration per grid point, z-fastest (index (i*ny+j)*nz+k)
+ */
+std::vector<double> ExudationModel::calculate(double tend)
+{
+    auto p = parameters();
+    if (p!=cachedParameters) {
+        cache.clear();
+        cachedParameters = p;
+    }
+
+    /* collect roots that (re)started growing */
+    auto roots = rs.getRoots();
+    std::map<Root*, RootContribution> current;
+    std::vector<RootContribution*> active; // roots in the order of getRoots(), that contribute
+    std::vector<RootContribution*> update; // roots, that must be integrated
+    for (Root* r : roots) {
+        if (r->getNumberOfNodes()<2) { // not started growing
+            continue;
+        }
+        auto it = cache.find(r);
+        RootContribution& c = current[r];
+        if (it!=cache.end()) {
+            c = std::move(it->second);
+        }
+        if (changed(c, tend)) {
+            c.r = r;
+            c.nodes = r->getNumberOfNodes();
+            c.tip = r->getNode(c.nodes-1);
+            c.age = std::min(r->getNodeCT(c.nodes-1), tend) - r->getNodeCT(0);
+            c.stopTime = r->isActive() ? 0. : r->getNodeCT(c.nodes-1); // time when the root stopped growing
+            c.n = int(n0*r->getLength()); // number of integration points eq 11
+            c.points.clear();
+            c.x.clear();
+            c.c11.clear();
+            if (c.age>0) {
+                update.push_back(&c);
+                quadrature(c.n);
+            }
+        }
+        if (c.age>0) {
+            active.push_back(&c);
+        }
+    }
+    cache.swap(current); // (the pointers stay valid)
+
+    /* EQN 11, in parallel over the roots */
+    parallelFor(update.size(), numberOfThreads, [&](int i) {
+        findPoints(*update[i]);
+        integrate11(*update[i]);
+    });
+
+    /* EQN 13, in parallel over chunks of grid points */
+    const size_t chunkSize = 256; // grid points per work item
+    std::vector<std::pair<RootContribution*, size_t>> items;
+    for (auto c : active) {
+        double st = c->stopTime*calc13;
+        c->c13.clear();
+        if ((st>0) && (st<tend)) { // has stopped growing
+            c->c13.resize(c->points.size());
+            for (size_t i=0; i<c->points.size(); i+=chunkSize) {
+                items.push_back(std::make_pair(c, i));
+            }
+        }
+    }
+    parallelFor(items.size(), numberOfThreads, [&](int i) {
+        const RootContribution& c = *items[i].first;
+        size_t i0 = items[i].second;
+        integrate13(c, i0, std::min(i0+chunkSize, c.points.size()), tend, items[i].first->c13);
+    });
+
+    /* sum up, in the order of the roots */
+    std::vector<double> data(grid.nx*grid.ny*grid.nz);
+    for (auto c : active) {
+        for (size_t i=0; i<c->points.size(); i++) {
+            data[c->points[i]] += c->c11[i];
+        }
+        for (size_t i=0; i<c->c13.size(); i++) {
+            data[c->points[i]] += c->c13[i];
+        }
+    }
+    std::fill(grid.data.begin(), grid.data.end(), 0.);
+    for (size_t i=0; i<grid.nx; i++) {
+        for (size_t j=0; j<grid.ny; j++) {
+            for (size_t k=0; k<grid.nz; k++) {
+                grid.setData(i, j, k, data[(i*grid.ny+j)*grid.nz+k]);
+            }
+        }
+    }
+    return data;
+}
+
+/**
+ * True, if the root grew or stopped growing since its contribution @param c was calculated
+ */
+bool ExudationModel::changed(const RootContribution& c, double tend) const
+{
+    Root* r = c.r;
+    if (r==nullptr) {
+        return true;
+    }
+    int n = r->getNumberOfNodes();
+    double age = std::min(r->getNodeCT(n-1), tend) - r->getNodeCT(0);
+    double st = r->isActive() ? 0. : r->getNodeCT(n-1);
+    Vector3d t = r->getNode(n-1);
+    return (n!=c.nodes) || (age!=c.age) || (st!=c.stopTime) || (t.x!=c.tip.x) || (t.y!=c.tip.y) || (t.z!=c.tip.z);
+}
+
+/**
+ * Finds the grid points with a distance to the root surface smaller than the observation radius.
+ * Candidates are the grid points within the bounding boxes of the segments (enlarged by the observation radius).
+ */
+void ExudationModel::findPoints(RootContribution& c) const
+{
+    size_t nx = grid.nx, ny = grid.ny, nz = grid.nz;
+    c.points.clear();
+    if (observationRadius<=0) { // no limit
+        c.points.resize(nx*ny*nz);
+        for (size_t i=0; i<c.points.size(); i++) {
+            c.points[i] = i;
+        }
+        return;
+    }
+    const std::vector<double>& gx = grid.xgrid->grid;
+    const std::vector<double>& gy = grid.ygrid->grid;
+    const std::vector<double>& gz = grid.zgrid->grid;
+    auto range = [](const std::vector<double>& g, double lo, double hi, size_t& i0, size_t& i1) { // grid points in [lo,hi]
+        i0 = std::lower_bound(g.begin(), g.end(), lo)-g.begin();
+        i1 = std::upper_bound(g.begin(), g.end(), hi)-g.begin();
+    };
+    static thread_local std::vector<char> mark; // candidates of this thread
+    mark.resize(nx*ny*nz, 0);
+    Root* r = c.r;
+    double d = observationRadius + std::max(r->param()->a, 0.);
+    for (int s=1; s<c.nodes; s++) {
+        Vector3d x1 = r->getNode(s-1);
+        Vector3d x2 = r->getNode(s);
+        size_t i0, i1, j0, j1, k0, k1;
+        range(gx, std::min(x1.x, x2.x)-d, std::max(x1.x, x2.x)+d, i0, i1);
+        range(gy, std::min(x1.y, x2.y)-d, std::max(x1.y, x2.y)+d, j0, j1);
+        range(gz, std::min(x1.z, x2.z)-d, std::max(x1.z, x2.z)+d, k0, k1);
+        for (size_t i=i0; i<i1; i++) {
+            for (size_t j=j0; j<j1; j++) {
+                for (size_t k=k0; k<k1; k++) {
+                    size_t lind = (i*ny+j)*nz+k;
+                    if (!mark[lind]) {
+                        mark[lind] = 1;
+                        c.points.push_back(lind);
+                    }
+                }
+            }
+        }
+    }
+    for (size_t lind : c.points) {
+        mark[lind] = 0;
+    }
+    std::sort(c.points.begin(), c.points.end());
+    SDF_RootSystem sdf(*r, observationRadius);
+    size_t m = 0;
+    for (size_t lind : c.points) {
+        size_t k = lind%nz, j = (lind/nz)%ny, i = lind/(ny*nz);
+        Vector3d x = Vector3d(gx[i], gy[j], gz[k]);
+        if (-sdf.getDist(x)<observationRadius) {
+            c.points[m++] = lind;
+        }
+    }
+    c.points.resize(m);
+}
+
+/**
+ * Integrates Eqn 11 for all grid points of the root contribution @param c
+ */
+void ExudationModel::integrate11(RootContribution& c) const
+{
+    Root* r = c.r;
+    Source s;
+    s.r = r;
+    s.age = c.age;
+    s.tip = c.tip; // for mps_straight, eq 11
+    Vector3d base = r->getNode(0);
+    double a = r->getNodeCT(c.nodes-1) - r->getNodeCT(0);
+    s.v = base.minus(c.tip).times(1./a); // direction towards root base
+    const Quadrature& q = quadratures.at(c.n);
+    const std::vector<double>& gx = grid.xgrid->grid;
+    const std::vector<double>& gy = grid.ygrid->grid;
+    const std::vector<double>& gz = grid.zgrid->grid;
+    size_t ny = grid.ny, nz = grid.nz;
+    c.x.resize(c.points.size());
+    c.c11.resize(c.points.size());
+    for (size_t l=0; l<c.points.size(); l++) {
+        size_t lind = c.points[l];
+        c.x[l] = Vector3d(gx[lind/(ny*nz)], gy[(lind/nz)%ny], gz[lind%nz]);
+        s.x = c.x[l]; // integration point
+        c.c11[l] = eqn11(s, q); // different flavors of Eqn (11)
+    }
+}
+
+/**
+ * Integrates Eqn 13 for the grid points @param i0 .. @param i1 -1 of the root contribution @param c (results in @param c13),
+ * simplistic integration in 3d over the grid points of the root
+ */
+void ExudationModel::integrate13(const RootContribution& c, size_t i0, size_t i1, double tend, std::vector<double>& c13) const
+{
+    double dt = tend - c.stopTime;
+    double r32 = to32(R);
+    double d = to32(4*Dl*M_PI*dt);
+    double e = -R/(4*Dl*dt);
+    double kd = k*dt/R;
+    for (size_t l = i0; l<i1; l++) {
+        c13[l] = 0.;
+        if (c.c11[l] > thresh13) {
+            const Vector3d& x = c.x[l];
+            double s = 0;
+            for (size_t m=0; m<c.points.size(); m++) {  // the root contributes nothing outside of its points
+                Vector3d z = x.minus(c.x[m]);
+                s += r32*c.c11[m]/d*exp(e*z.times(z) - kd)*dx3; // integrand Eqn 13
+            }
+            c13[l] = s;
+        }
+    }
+}
+
+/**
+ * Eqn 11 at the integration point of the source @param s, with the quadrature @param q
+ */
+double ExudationModel::eqn11(const Source& s, const Quadrature& q) const
+{
+    switch (type) {
+    case mps_straight:
+        return gauss(q, 0., s.age, [&](double t) { return integrandMPS_straight(t, s); });
+    case mps:
+        return gauss(q, 0., s.age, [&](double t) { return integrandMPS(t, s); });
+    case mls:
+        return gauss2D(q, 0., s.age, 0., l, [&](double t, double l_) { return integrandMLS(t, l_, s); });
+    }
+    std::cout << "Unknown integration type \n";
+    return 0.;
+}
+
+/**
+ * Abscissas and weights of order @param n (computed once)
+ */
+const ExudationModel::Quadrature& ExudationModel::quadrature(int n)
+{
+    auto it = quadratures.find(n);
+    if (it!=quadratures.end()) {
+        return it->second;
+    }
+    Quadrature& q = quadratures[n];
+    q.n = n;
+    size_t m = (std::max(n, 0)+1)>>1;
+    q.x.resize(m);
+    q.w.resize(m);
+    if (m>0) {
+        gauss_legendre_tbl(n, q.x.data(), q.w.data(), 1e-10);
+    }
+    return q;
+}
+
+/**
+ * Model and numerical parameters, a root contribution is only valid for the parameters it was calculated with
+ */
+std::vector<double> ExudationModel::parameters() const
+{
+    return { Q, Dl, theta, R, k, l, double(type), double(n0), observationRadius };
+}
+
+/**
+ * Returns the linearly interpolated position along the root r at age a
+ */
+Vector3d ExudationModel::pointAtAge(Root* r, double a)
+{
+    a = std::max(0.,a);
+    double et = r->getNodeCT(0)+a; // age -> emergence time
+    size_t i=0;
+    while (i<r->getNumberOfNodes()) {
+        if (r->getNodeCT(i)>et) { // first index bigger than emergence time, interpolate i-1, i
+            break;
+        }
+        i++;
+    }
+    if (i == r->getNumberOfNodes()) { // this happens if a root has stopped growing
+        return r->getNode(i-1);
+    }
+    Vector3d n1 = r->getNode(i-1);
+    Vector3d n2 = r->getNode(i);
+    double t = (et - r->getNodeCT(i - 1)) / (r->getNodeCT(i) - r->getNodeCT(i - 1)); // t in (0,1]
+    return (n1.times(1. - t)).plus(n2.times(t));
+}
+
+/**
+ * Point source, root is represented by a single straight line (substituted)
+ */
+double ExudationModel::integrandMPS_straight(double t, const Source& s) const
+{
+    double c = -R / ( 4*Dl*t );
+    double d = 8*theta*to32(M_PI*Dl*t);
+    Vector3d xtip = s.tip.plus(s.v.times(t)); // for t=0 at tip, at t=age at base, as above
+    Vector3d z = s.x.minus(xtip);
+    return (Q*sqrt(R))/d *exp(c*z.times(z) - k/R * t); // Eqn (11)
+}
+
+/**
+ * Moving point source, root is represented by a straight segments
+ */
+double ExudationModel::integrandMPS(double t, const Source& s) const
+{
+    double c = -R / ( 4*Dl*t );
+    double d = 8*theta*to32(M_PI*Dl*t);
+    Vector3d xtip = pointAtAge(s.r, s.age-t);
+    Vector3d z = s.x.minus(xtip);
+    return (Q*sqrt(R))/d *exp(c*z.times(z) - k/R * t); // Eqn (11)
+}
+
+/**
+ * Moving line source, root is represented by a straight segments
+ */
+double ExudationModel::integrandMLS(double t, double l_, const Source& s) const
+{
+    double c = -R / ( 4*Dl*t );
+    double d = 8*theta*to32(M_PI*Dl*t);
+    double tl = s.r->calcLength( s.age-t ); // tip
+    if (tl<l_) { // if root smaller l
+        return 0.;
+    }
+    double agel = s.r->calcAge(tl-l_);
+    Vector3d tipLS = pointAtAge(s.r, agel);
+    Vector3d z = s.x.minus(tipLS);
+    return (Q*sqrt(R))/d *exp(c*z.times(z) - k/R * t); // Eqn (11)
+}
+
+} // end namespace CRootBox
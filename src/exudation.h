@@ -0,0 +1,131 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef EXUDATION_H_
+#define EXUDATION_H_
+
+#include "soil.h"
+
+#include <vector>
+#include <map>
+
+namespace CRootBox {
+
+class RootSystem;
+class Root;
+
+/**
+ * Exudate concentration on an equidistant grid, produced by the root tips of a root system
+ * (point and line sources moving along the root axes, continued after the root stopped growing by Eqn 13)
+ *
+ * Each root only visits the grid points within the observation radius of its segments: the index range of the points is
+ * computed from the segment bounding boxes, and each point is checked against the distance to the root surface.
+ * The roots are integrated in parallel, and the result does not depend on the number of threads.
+ *
+ * The Gauss-Legendre nodes and weights are computed once per quadrature order.
+ * The contribution of each root (Eqn 11) is kept, and is only recomputed if the root or the model parameters changed,
+ * so ExudationModel::calculate can be called after each simulation step, and only integrates the roots that grew.
+ */
+class ExudationModel {
+public:
+
+    enum IntegrationType { mps_straight = 0, mps = 1, mls = 2 };
+
+    /*
+     * Model parameters (same for all roots)
+     */
+    double Q = 1e-5;
+    double Dl = 1e-5; // cm2 / day
+    double theta = 0.3;
+    double R = 1;
+    double k = 1e-6;
+    double l = 0.1; // cm
+
+    /*
+     *  Numerical parameters
+     */
+    EquidistantGrid3D grid;
+    int type = mps;
+    int n0 = 5; // integration points per [cm]
+    double thresh13 = 1.e-15; // threshold for Eqn 13
+    bool calc13 = true; // turns Eqn 13 on and off
+    double observationRadius = 5; //  limits computational domain around roots [cm]
+
+    ExudationModel(double width, double depth, int n, RootSystem& rs) :ExudationModel(width, width, depth, n, n, n, rs) { }
+    ExudationModel(double length, double width, double depth, int nx, int ny, int nz, RootSystem& rs);
+
+    std::vector<double> calculate(double tend); ///< concentration per grid point at time tend, z-fastest (index (i*ny+j)*nz+k)
+
+    void setNumberOfThreads(int n) { numberOfThreads = n; } ///< number of threads integrating the roots
+    int getNumberOfThreads() const { return numberOfThreads; }
+    void clear() { cache.clear(); } ///< forgets all root contributions
+
+    // Returns the linearly interpolated position along the root r at age a
+    static Vector3d pointAtAge(Root* r, double a);
+
+    static double to32(double x) { return sqrt(x*x*x); }
+    static double to3(double x) { return x*x*x; }
+
+protected:
+
+    /**
+     * Contribution of a single root
+     */
+    struct RootContribution {
+        Root* r = nullptr;
+        int nodes = 0; ///< number of nodes, when the contribution was calculated
+        Vector3d tip = Vector3d(); ///< root tip, when the contribution was calculated
+        double age = 0; ///< integration interval of Eqn 11 [day]
+        double stopTime = 0; ///< time when root stopped growing, 0 if it has not
+        int n = 0; ///< quadrature order
+        std::vector<size_t> points; ///< grid points within the observation radius, z-fastest index, sorted
+        std::vector<Vector3d> x; ///< coordinates of the grid points
+        std::vector<double> c11; ///< Eqn 11 per grid point
+        std::vector<double> c13; ///< Eqn 13 per grid point at the last ExudationModel::calculate (or empty, if the root is growing)
+    };
+
+    /**
+     * Moving source, the argument of the integrands (@see ExudationModel::eqn11)
+     */
+    struct Source {
+        Root* r;
+        double age;
+        Vector3d tip;
+        Vector3d v; ///< direction from tip towards root base (mps_straight)
+        Vector3d x; ///< integration point
+    };
+
+    /**
+     * Gauss-Legendre abscissas and weights of one order (@see external/gauss_legendre)
+     */
+    struct Quadrature {
+        int n = 0; ///< order
+        std::vector<double> x;
+        std::vector<double> w;
+    };
+
+    bool changed(const RootContribution& c, double tend) const; ///< true if the contribution of the root must be recalculated
+    void findPoints(RootContribution& c) const; ///< grid points within the observation radius of the root
+    void integrate11(RootContribution& c) const; ///< Eqn 11 for all points of the root
+    void integrate13(const RootContribution& c, size_t i0, size_t i1, double tend, std::vector<double>& c13) const; ///< Eqn 13 for the points i0 .. i1-1
+
+    double eqn11(const Source& s, const Quadrature& q) const;
+    double integrandMPS_straight(double t, const Source& s) const; // point source, root is represented by a single straight line
+    double integrandMPS(double t, const Source& s) const; // moving point source, root is represented by a straight segments
+    double integrandMLS(double t, double l, const Source& s) const; // moving line source, root is represented by a straight segments
+
+    const Quadrature& quadrature(int n); ///< computes the table, if it is not cached yet
+
+    RootSystem& rs;
+    int numberOfThreads = 1;
+    double dx3 = 1; // for integration of eqn 13
+    std::map<Root*, RootContribution> cache; ///< per root
+    std::map<int, Quadrature> quadratures; ///< per quadrature order
+
+    /* parameters, when the cache was calculated */
+    std::vector<double> cachedParameters;
+    std::vector<double> parameters() const;
+
+};
+
+} // end namespace CRootBox
+
+#endif
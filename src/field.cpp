@@ -0,0 +1,259 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "field.h"
+
+#include "analysis.h"
+#include "parallel.h"
+#include "seedparameter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * The prototype is not copied, and must live as long as the plants are added.
+ * Only its organ parameters are used, set geometry and soil with Field::setGeometry and Field::setSoil.
+ *
+ * @param prototype     root system holding the organ parameters of all plants
+ */
+Field::Field(const RootSystem& prototype) :prototype(prototype)
+{
+    patches.resize(1);
+}
+
+/**
+ * Adds a plant with the organ parameters of the prototype
+ *
+ * @param pos       mean seed position [cm] (@see SeedRandomParameter::seedPos)
+ * @param seed      random seed of the plant
+ * @return the index of the plant
+ */
+int Field::addPlant(const Vector3d& pos, unsigned int seed)
+{
+    RootSystem* rs = new RootSystem();
+    plants.push_back(std::unique_ptr<RootSystem>(rs));
+    for (int ot = 0; ot < Organism::organTypeNames.size(); ot++) { // copy organ parameters
+        for (auto p : prototype.getSharedOrganRandomParameter(ot)) {
+            rs->setOrganRandomParameter(p->copy(rs));
+        }
+    }
+    for (auto p : rs->getOrganRandomParameter(Organism::ot_seed)) {
+        ((SeedRandomParameter*)p)->seedPos = pos;
+    }
+    rs->setSeed(seed);
+    positions.push_back(pos);
+    assignPatches();
+    return plants.size()-1;
+}
+
+/**
+ * Decomposes the domain [left,right]x[front,back] into nx*ny rectangular patches, x-fastest.
+ * Plants outside of the domain belong to the nearest patch.
+ *
+ * @param left      minimal x-coordinate [cm]
+ * @param right     maximal x-coordinate [cm]
+ * @param front     minimal y-coordinate [cm]
+ * @param back      maximal y-coordinate [cm]
+ * @param nx        number of patches along the x-axis
+ * @param ny        number of patches along the y-axis
+ */
+void Field::setPatches(double left, double right, double front, double back, int nx, int ny)
+{
+    if ((nx<1) || (ny<1) || !(right>left) || !(back>front)) {
+        std::cout << "Field::setPatches: invalid domain or number of patches\n" << std::flush;
+        throw std::invalid_argument("Field::setPatches: invalid domain or number of patches");
+    }
+    this->left = left;
+    this->right = right;
+    this->front = front;
+    this->back = back;
+    this->nx = nx;
+    this->ny = ny;
+    assignPatches();
+}
+
+/**
+ * Assigns the plants to the patches by their seed positions
+ */
+void Field::assignPatches()
+{
+    patches = std::vector<std::vector<int>>(nx*ny);
+    patchOf.resize(plants.size());
+    for (size_t p=0; p<plants.size(); p++) {
+        int i = 0, j = 0;
+        if (right>left) {
+            i = std::min(std::max(int(std::floor((positions[p].x-left)/(right-left)*nx)), 0), nx-1);
+            j = std::min(std::max(int(std::floor((positions[p].y-front)/(back-front)*ny)), 0), ny-1);
+        }
+        patchOf[p] = j*nx+i;
+        patches[j*nx+i].push_back(p);
+    }
+}
+
+/**
+ * Sets geometry and soil, and initializes all plants
+ */
+void Field::initialize()
+{
+    for (auto& rs : plants) {
+        if (geometry!=nullptr) {
+            rs->setGeometry(geometry);
+        }
+        if (soil!=nullptr) {
+            rs->setSoil(soil);
+        }
+        rs->initialize();
+    }
+}
+
+/**
+ * Simulates the plants of all patches, or of a single patch, for a time span
+ *
+ * @param dt        time step [day]
+ * @param threads   number of threads simulating the patches in parallel, 0 for sequential
+ * @param patch     the patch to simulate, or -1 for all patches (default)
+ */
+void Field::simulate(double dt, int threads, int patch)
+{
+    if (patch>=int(patches.size())) {
+        std::cout << "Field::simulate: unknown patch " << patch << "\n" << std::flush;
+        throw std::invalid_argument("Field::simulate: unknown patch");
+    }
+    if (patch>=0) {
+        parallelFor(patches[patch].size(), threads, [&](int i) {
+            plants[patches[patch][i]]->simulate(dt);
+        });
+    } else {
+        parallelFor(patches.size(), threads, [&](int p) {
+            for (int i : patches[p]) {
+                plants[i]->simulate(dt);
+            }
+        });
+    }
+}
+
+/**
+ * @return the number of nodes of all plants
+ */
+int Field::getNumberOfNodes() const
+{
+    int n = 0;
+    for (const auto& rs : plants) {
+        n += rs->getNumberOfNodes();
+    }
+    return n;
+}
+
+/**
+ * @param i         plant index
+ * @return the global index of the first node of the plant, the nodes of earlier plants are numbered before
+ */
+int Field::getNodeOffset(int i) const
+{
+    int n = 0;
+    for (int p=0; p<i; p++) {
+        n += plants.at(p)->getNumberOfNodes();
+    }
+    return n;
+}
+
+/**
+ * @param n         global node index
+ * @return the index of the plant containing the node, or -1
+ */
+int Field::getPlantOfNode(int n) const
+{
+    for (size_t p=0; p<plants.size(); p++) {
+        int np = plants[p]->getNumberOfNodes();
+        if ((n>=0) && (n<np)) {
+            return p;
+        }
+        n -= np;
+    }
+    return -1;
+}
+
+/**
+ * @return the nodes of all plants, plant after plant
+ */
+std::vector<Vector3d> Field::getNodes() const
+{
+    std::vector<Vector3d> nodes;
+    nodes.reserve(getNumberOfNodes());
+    for (const auto& rs : plants) {
+        const auto& n = rs->getCachedNodes();
+        nodes.insert(nodes.end(), n.begin(), n.end());
+    }
+    return nodes;
+}
+
+/**
+ * @return the segments of all plants, with global node indices (@see Field::getNodes)
+ */
+std::vector<Vector2i> Field::getSegments() const
+{
+    std::vector<Vector2i> segs;
+    int offset = 0;
+    for (const auto& rs : plants) {
+        for (const auto& s : rs->getCachedSegments()) {
+            segs.push_back(Vector2i(s.x+offset, s.y+offset));
+        }
+        offset += rs->getNumberOfNodes();
+    }
+    return segs;
+}
+
+/**
+ * @return the creation times of the segments, corresponding to Field::getSegments
+ */
+std::vector<double> Field::getSegmentCTs() const
+{
+    std::vector<double> cts;
+    for (const auto& rs : plants) {
+        const auto& c = rs->getCachedSegmentCTs();
+        cts.insert(cts.end(), c.begin(), c.end());
+    }
+    return cts;
+}
+
+/**
+ * @return the organs containing the segments, corresponding to Field::getSegments
+ */
+std::vector<Organ*> Field::getSegmentOrigins() const
+{
+    std::vector<Organ*> origins;
+    for (const auto& rs : plants) {
+        const auto& o = rs->getCachedSegmentOrigins();
+        origins.insert(origins.end(), o.begin(), o.end());
+    }
+    return origins;
+}
+
+/**
+ * @return an analyser of all segments of the field, with global node indices (@see Field::getSegments)
+ */
+SegmentAnalyser Field::getAnalyser() const
+{
+    SegmentAnalyser a;
+    a.nodes = getNodes();
+    a.segments = getSegments();
+    a.segCTs = getSegmentCTs();
+    a.segO = getSegmentOrigins();
+    return a;
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string Field::toString() const
+{
+    std::stringstream str;
+    str << "Field with " << plants.size() << " plants in " << patches.size() << " patches, and a total of "
+        << getNumberOfNodes() << " nodes";
+    return str.str();
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,86 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef FIELD_H_
+#define FIELD_H_
+
+#include "RootSystem.h"
+
+#include <memory>
+#include <vector>
+
+namespace CRootBox {
+
+class SegmentAnalyser;
+
+/**
+ * Field
+ *
+ * A plot of many root systems, sharing one confining geometry and one soil.
+ * The plants copy the organ parameters of a prototype, and are placed at their seed positions.
+ *
+ * The domain is decomposed into rectangular patches (@see Field::setPatches), each plant belongs to the patch of its
+ * seed position. Field::simulate simulates the patches in parallel (each patch on a single thread), or a single patch,
+ * e.g. the patch of a MPI rank. Each plant has its own seed, so the results do not depend on the decomposition or the
+ * number of threads. Shared soil and geometry must be thread safe (e.g. not implemented in Python) for parallel runs.
+ *
+ * The views Field::getNodes, Field::getSegments, and Field::getAnalyser combine all plants with consistent indices:
+ * the nodes of plant p are numbered from Field::getNodeOffset(p) on, and the segments are ordered by their second node
+ * (as in Organism::getCachedSegments). They are assembled from the incrementally updated caches of the plants, the offsets
+ * change when the plants grow.
+ */
+class Field
+{
+public:
+
+    Field(const RootSystem& prototype); ///< plants use the organ parameters of the prototype
+    virtual ~Field() { }
+
+    /* setup */
+    void setGeometry(SignedDistanceFunction* geom) { geometry = geom; } ///< optionally, sets a confining geometry (shared by all plants)
+    void setSoil(SoilLookUp* soil_) { soil = soil_; } ///< optionally, sets a soil for hydro tropism (shared by all plants)
+    int addPlant(const Vector3d& pos, unsigned int seed); ///< adds a plant with its seed at pos, returns the plant index
+    void setPatches(double left, double right, double front, double back, int nx, int ny); ///< rectangular domain decomposition (x,y)
+    void initialize(); ///< initializes all plants, call after the setup
+
+    /* simulation */
+    void simulate(double dt, int threads = 0, int patch = -1); ///< simulates all patches (patch = -1), or a single patch
+
+    /* plants and patches */
+    int getNumberOfPlants() const { return plants.size(); }
+    RootSystem& getPlant(int i) { return *plants.at(i); } ///< the i-th plant
+    int getNumberOfPatches() const { return patches.size(); }
+    int getPatch(int i) const { return patchOf.at(i); } ///< patch of the i-th plant
+    std::vector<int> getPlants(int patch) const { return patches.at(patch); } ///< plants of a patch
+
+    /* combined views */
+    int getNumberOfNodes() const; ///< nodes of all plants
+    int getNodeOffset(int i) const; ///< global index of the first node of the i-th plant
+    int getPlantOfNode(int n) const; ///< plant containing the global node index
+    std::vector<Vector3d> getNodes() const; ///< nodes of all plants
+    std::vector<Vector2i> getSegments() const; ///< segments of all plants, with global node indices
+    std::vector<double> getSegmentCTs() const; ///< segment creation times, corresponding to Field::getSegments
+    std::vector<Organ*> getSegmentOrigins() const; ///< segment origins, corresponding to Field::getSegments
+    SegmentAnalyser getAnalyser() const; ///< analyser of all segments, corresponding to Field::getSegments
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    void assignPatches(); ///< assigns the plants to the patches
+
+    const RootSystem& prototype;
+    SignedDistanceFunction* geometry = nullptr;
+    SoilLookUp* soil = nullptr;
+
+    std::vector<std::unique_ptr<RootSystem>> plants;
+    std::vector<Vector3d> positions; ///< seed position per plant
+
+    double left = 0., right = 0., front = 0., back = 0.; ///< domain of the patches
+    int nx = 1, ny = 1; ///< number of patches per axis
+    std::vector<std::vector<int>> patches; ///< plant indices per patch
+    std::vector<int> patchOf; ///< patch per plant
+
+};
+
+} // end namespace CRootBox
+
+#endif
@@ -1,6 +1,11 @@
 #ifndef GROWTH_H
 #define GROWTH_H
 
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
 namespace CRootBox {
 
 class Organ;
@@ -41,16 +46,49 @@ public:
     virtual double getAge(double l, double r, double k, Organ* o) const
     { throw std::runtime_error( "getAge() not implemented" ); return 0; } ///< Returns the age of a root of length l
 
+    /**
+     * Returns the ages of a root at several lengths (e.g. the nodes created in a time step, @see Root::createSegments),
+     * the default implementation calls getAge() per length, derive from GrowthKernel for a faster evaluation
+     *
+     * @param l     root lengths [cm]
+     * @param r     initial growth rate [cm/day]
+     * @param k     maximal root length [cm]
+     * @param root  points to the root in case more information is needed
+     * @param ages  root ages [day] (results)
+     */
+    virtual void getAges(const std::vector<double>& l, double r, double k, Organ* o, std::vector<double>& ages) const {
+        ages.resize(l.size());
+        for (size_t i=0; i<l.size(); i++) {
+            ages[i] = getAge(l[i], r, k, o);
+        }
+    }
 
     virtual GrowthFunction* copy() { return new GrowthFunction(*this); } ///< Copy the object
 };
 
 
 
+/**
+ * Base class of growth functions with closed form ages, the batch evaluation GrowthFunction::getAges calls G::getAge
+ * directly (not virtually), so the loop is compiled for the specific growth function G.
+ */
+template<class G>
+class GrowthKernel : public GrowthFunction
+{
+public:
+    void getAges(const std::vector<double>& l, double r, double k, Organ* o, std::vector<double>& ages) const override {
+        const G& g = static_cast<const G&>(*this);
+        ages.resize(l.size());
+        for (size_t i=0; i<l.size(); i++) {
+            ages[i] = g.G::getAge(l[i], r, k, o);
+        }
+    } ///< @copydoc GrowthFunction::getAges
+};
+
 /**
  * LinearGrowth elongates at constant rate until the maximal length k is reached
  */
-class LinearGrowth : public GrowthFunction
+class LinearGrowth : public GrowthKernel<LinearGrowth>
 {
 public:
     double getLength(double t, double r, double k, Organ* o) const override { return std::min(k,r*t); } ///< @copydoc GrowthFunction::getLegngth
@@ -62,7 +100,7 @@ public:
 /**
  * ExponentialGrowth elongates initially at constant rate r and slows down negative exponentially towards the maximum length k is reached
  */
-class ExponentialGrowth : public GrowthFunction
+class ExponentialGrowth : public GrowthKernel<ExponentialGrowth>
 {
 public:
     double getLength(double t, double r, double k, Organ* o) const override { return k*(1-exp(-(r/k)*t)); } ///< @copydoc GrowthFunction::getLegngth
@@ -0,0 +1,115 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+const std::vector<std::string> Instrumentation::counterNames = { "segments", "objectives", "sdf", "rejected", "boundaryFailures",
+    "laterals", "soil", "skipped" };
+const std::vector<std::string> Instrumentation::phaseNames = { "simulate", "heading", "createSegments", "createLateral", "soil" };
+
+/**
+ * Copy constructor, copies the values and the state
+ */
+Instrumentation::Instrumentation(const Instrumentation& i): enabled(i.enabled)
+{
+    for (int ot=0; ot<numberOfOrganTypes; ot++) {
+        for (int j=0; j<numberOfCounters; j++) {
+            values[ot][j].store(i.values[ot][j].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        for (int j=0; j<numberOfPhases; j++) {
+            times[ot][j].store(i.times[ot][j].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Sets all counters and timers to zero
+ */
+void Instrumentation::clear()
+{
+    for (auto& v : values) {
+        for (auto& c : v) {
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (auto& v : times) {
+        for (auto& t : v) {
+            t.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @param name      name of the counter, @see Instrumentation::counterNames
+ * @param ot        organ type, or -1 for all organ types
+ * @return the value of the counter
+ */
+long Instrumentation::getCount(std::string name, int ot) const
+{
+    auto it = std::find(counterNames.begin(), counterNames.end(), name);
+    if (it==counterNames.end() || ot<-1 || ot>=numberOfOrganTypes) {
+        std::cout << "Instrumentation::getCount: unknown counter " << name << " or organ type " << ot << "\n" << std::flush;
+        throw std::invalid_argument("Instrumentation::getCount: unknown counter or organ type");
+    }
+    int c = it-counterNames.begin();
+    long v = 0;
+    for (int i=0; i<numberOfOrganTypes; i++) {
+        if (ot==-1 || ot==i) {
+            v += values[i][c].load(std::memory_order_relaxed);
+        }
+    }
+    return v;
+}
+
+/**
+ * @param name      name of the timer, @see Instrumentation::phaseNames
+ * @param ot        organ type, or -1 for all organ types
+ * @return the time [s]
+ */
+double Instrumentation::getTime(std::string name, int ot) const
+{
+    auto it = std::find(phaseNames.begin(), phaseNames.end(), name);
+    if (it==phaseNames.end() || ot<-1 || ot>=numberOfOrganTypes) {
+        std::cout << "Instrumentation::getTime: unknown timer " << name << " or organ type " << ot << "\n" << std::flush;
+        throw std::invalid_argument("Instrumentation::getTime: unknown timer or organ type");
+    }
+    int p = it-phaseNames.begin();
+    long long v = 0;
+    for (int i=0; i<numberOfOrganTypes; i++) {
+        if (ot==-1 || ot==i) {
+            v += times[i][p].load(std::memory_order_relaxed);
+        }
+    }
+    return 1.e-9*v;
+}
+
+/**
+ * Lists all non zero values, per organ type
+ */
+std::string Instrumentation::toString() const
+{
+    std::stringstream str;
+    str << "Instrumentation (" << (enabled ? "enabled" : "disabled") << ")\n";
+    for (int ot=0; ot<numberOfOrganTypes; ot++) {
+        for (size_t c=0; c<counterNames.size(); c++) {
+            long v = values[ot][c].load(std::memory_order_relaxed);
+            if (v!=0) {
+                str << "organ type " << ot << ", " << counterNames[c] << ": " << v << "\n";
+            }
+        }
+        for (size_t p=0; p<phaseNames.size(); p++) {
+            long long v = times[ot][p].load(std::memory_order_relaxed);
+            if (v!=0) {
+                str << "organ type " << ot << ", " << phaseNames[p] << ": " << 1.e-9*v << " s\n";
+            }
+        }
+    }
+    return str.str();
+}
+
+} // namespace CRootBox
@@ -0,0 +1,92 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef INSTRUMENTATION_H_
+#define INSTRUMENTATION_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace CRootBox {
+
+/**
+ * Instrumentation
+ *
+ * Optional counters and timers of the simulation hot paths, per organ type (see Organism::getInstrumentation).
+ * They are disabled by default, and cost a single branch per hot path then.
+ *
+ * Counters: "segments" (created by Root::createSegments), "objectives" (tropism objective evaluations, i.e. trials),
+ * "sdf" (geometry evaluations of Tropism::getHeading), "rejected" (headings rejected by the geometry), "boundaryFailures"
+ * (headings that could not respect the geometry), "laterals" (created by Root::createLateral), "soil" (lookups of the
+ * scaling functions of the roots), "skipped" (dormant organs, whose subtree is not simulated in a time step).
+ *
+ * Timers [s]: "simulate" (Organism::simulate, i.e. per base organ type), "heading" (Tropism::getHeading), "createSegments",
+ * "createLateral" (including the first time step of the lateral), "soil". Times are inclusive (e.g. "createSegments"
+ * contains "heading"), nested calls are counted repeatedly (e.g. laterals created within "createLateral"), and times are
+ * summed over the threads of a parallel simulation.
+ *
+ * The values accumulate over the calls of Organism::simulate, until Instrumentation::clear is called.
+ * Counting is thread safe (relaxed atomics).
+ */
+class Instrumentation
+{
+public:
+
+    enum Counters { c_segments = 0, c_objectives, c_sdf, c_rejected, c_boundaryFailures, c_laterals, c_soil, c_skipped, numberOfCounters };
+    enum Phases { p_simulate = 0, p_heading, p_createSegments, p_createLateral, p_soil, numberOfPhases };
+    static const int numberOfOrganTypes = 5; ///< @see Organism::OrganTypes
+
+    Instrumentation() { clear(); }
+    Instrumentation(const Instrumentation& i); ///< copies the values
+    Instrumentation& operator=(const Instrumentation& i) = delete;
+
+    void setEnabled(bool e) { enabled = e; } ///< starts or stops recording (the values are kept)
+    bool isEnabled() const { return enabled; } ///< true, if values are recorded
+    void clear(); ///< sets all values to zero
+
+    void count(int ot, int counter, long n = 1) { values[ot][counter].fetch_add(n, std::memory_order_relaxed); } ///< adds n to a counter
+    void time(int ot, int phase, long long ns) { times[ot][phase].fetch_add(ns, std::memory_order_relaxed); } ///< adds a time span [ns]
+
+    long getCount(std::string name, int ot = -1) const; ///< value of a counter, summed over all organ types for ot = -1
+    double getTime(std::string name, int ot = -1) const; ///< value of a timer [s], summed over all organ types for ot = -1
+    static const std::vector<std::string> counterNames; ///< names of the counters, @see Instrumentation::Counters
+    static const std::vector<std::string> phaseNames; ///< names of the timers, @see Instrumentation::Phases
+
+    std::string toString() const; ///< all non zero values
+
+    /**
+     * Measures the time of its scope, if the instrumentation is enabled
+     */
+    class Timer
+    {
+    public:
+        Timer(Instrumentation& i, int ot, int phase): i(i.isEnabled() ? &i : nullptr), ot(ot), phase(phase) {
+            if (this->i!=nullptr) {
+                t0 = std::chrono::steady_clock::now();
+            }
+        }
+        ~Timer() {
+            if (i!=nullptr) {
+                auto dt = std::chrono::steady_clock::now()-t0;
+                i->time(ot, phase, std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count());
+            }
+        }
+    private:
+        Instrumentation* i;
+        int ot;
+        int phase;
+        std::chrono::steady_clock::time_point t0;
+    };
+
+protected:
+
+    bool enabled = false;
+    std::array<std::array<std::atomic<long>, numberOfCounters>, numberOfOrganTypes> values;
+    std::array<std::array<std::atomic<long long>, numberOfPhases>, numberOfOrganTypes> times; ///< [ns]
+
+};
+
+} // namespace CRootBox
+
+#endif
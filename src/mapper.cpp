@@ -0,0 +1,208 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "mapper.h"
+
+#include "Organism.h"
+#include "soil.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * Constructor
+ *
+ * @param x         cell boundaries along the x-axis (ascending or descending), empty for an unbounded axis
+ * @param y         cell boundaries along the y-axis
+ * @param z         cell boundaries along the z-axis
+ */
+SegmentMapper::SegmentMapper(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z)
+    :raster(x, y, z)
+{ }
+
+/**
+ * Constructor, the cell (i,j,k) is [x_i,x_i+1]x[y_j,y_j+1]x[z_k,z_k+1] (@see SegmentAnalyser::rasterize)
+ *
+ * @param grid      rectilinear (or equidistant) grid with at least two grid points per axis
+ */
+SegmentMapper::SegmentMapper(const RectilinearGrid3D& grid)
+    :raster(grid.xgrid->grid, grid.ygrid->grid, grid.zgrid->grid)
+{
+    if ((grid.nx<2) || (grid.ny<2) || (grid.nz<2)) {
+        std::cout << "SegmentMapper::SegmentMapper: the grid needs at least two grid points per axis\n" << std::flush;
+        throw std::invalid_argument("SegmentMapper::SegmentMapper: the grid needs at least two grid points per axis");
+    }
+}
+
+/**
+ * Removes all segments
+ */
+void SegmentMapper::clear()
+{
+    nodes = 0;
+    prev.clear();
+    firstOut.clear();
+    nextOut.clear();
+    first.clear();
+    count.clear();
+    pieces.clear();
+    garbage = 0;
+}
+
+/**
+ * Maps all segments of the organism @param plant
+ */
+void SegmentMapper::map(const Organism& plant)
+{
+    clear();
+    updated = 0;
+    update(plant);
+}
+
+/**
+ * Maps the segments of the organism @param plant that changed in its last time step, call after each Organism::simulate.
+ * The cost is proportional to the number of new and moved segments.
+ */
+void SegmentMapper::update(const Organism& plant)
+{
+    const NodeStore& ns = plant.getNodeStore();
+    int n = std::min(plant.getNumberOfNodes(), ns.size());
+    if ((nodes==n) && (simtime==plant.getSimTime()) && (shrinks==ns.getShrinks().size())) { // up to date
+        return;
+    }
+    if ((nodes>0) && ((nodes!=n-plant.getNumberOfNewNodes()) || (shrinks!=ns.getShrinks().size()))) { // not the previous time step
+        map(plant);
+        return;
+    }
+    updated = 0;
+    for (int i : ns.getChanges()) { // moved nodes
+        if ((i>=0) && (i<nodes)) {
+            if (ns.getPrev(i)!=prev[i]) { // the topology changed
+                map(plant);
+                return;
+            }
+            mapSegment(plant, i);
+            for (int j = firstOut[i]; j>=0; j = nextOut[j]) { // segments starting in the node
+                mapSegment(plant, j);
+            }
+        }
+    }
+    prev.resize(n, -1);
+    firstOut.resize(n, -1);
+    nextOut.resize(n, -1);
+    first.resize(n, 0);
+    count.resize(n, 0);
+    for (int i=nodes; i<n; i++) { // new nodes
+        int p = ns.getPrev(i);
+        prev[i] = p;
+        if (p>=0) {
+            nextOut[i] = firstOut[p];
+            firstOut[p] = i;
+        }
+        mapSegment(plant, i);
+    }
+    nodes = n;
+    simtime = plant.getSimTime();
+    shrinks = ns.getShrinks().size();
+    if (garbage>pieces.size()/2) {
+        compact();
+    }
+}
+
+/**
+ * Maps the segment ending in node @param i (if there is one)
+ */
+void SegmentMapper::mapSegment(const Organism& plant, int i)
+{
+    const NodeStore& ns = plant.getNodeStore();
+    garbage += count[i];
+    count[i] = 0;
+    int p = ns.getPrev(i);
+    if (p<0) {
+        return;
+    }
+    first[i] = pieces.size();
+    raster.split(ns.getNode(p), ns.getNode(i), pieces);
+    count[i] = pieces.size()-first[i];
+    updated++;
+}
+
+/**
+ * Removes the pieces of remapped segments, keeps the pieces in the order of the nodes
+ */
+void SegmentMapper::compact()
+{
+    std::vector<std::pair<size_t, double>> p;
+    p.reserve(pieces.size()-garbage);
+    for (size_t i=0; i<count.size(); i++) {
+        size_t f = p.size();
+        p.insert(p.end(), pieces.begin()+first[i], pieces.begin()+first[i]+count[i]);
+        first[i] = f;
+    }
+    pieces.swap(p);
+    garbage = 0;
+}
+
+/**
+ * @param i     second node index of the segment
+ * @return the indices of the cells the segment passes
+ */
+std::vector<int> SegmentMapper::getCells(int i) const
+{
+    std::vector<int> c;
+    for (int k=0; k<count.at(i); k++) {
+        c.push_back(pieces[first[i]+k].first);
+    }
+    return c;
+}
+
+/**
+ * @param i     second node index of the segment
+ * @return the length fractions of the segment within its cells, corresponding to SegmentMapper::getCells
+ */
+std::vector<double> SegmentMapper::getFractions(int i) const
+{
+    std::vector<double> f;
+    for (int k=0; k<count.at(i); k++) {
+        f.push_back(pieces[first[i]+k].second);
+    }
+    return f;
+}
+
+/**
+ * @return the segments (by their second node index) passing each cell
+ */
+std::vector<std::vector<int>> SegmentMapper::getCellSegments() const
+{
+    std::vector<std::vector<int>> cs(getNumberOfCells());
+    for (size_t i=0; i<count.size(); i++) {
+        for (int k=0; k<count[i]; k++) {
+            cs[pieces[first[i]+k].first].push_back(i);
+        }
+    }
+    return cs;
+}
+
+/**
+ * Sums a value per segment into the cells, proportional to the length fractions (e.g. segment lengths, or fluxes)
+ *
+ * @param values    a value per segment, indexed by its second node index (at least one per mapped node)
+ * @return the summed values per cell
+ */
+std::vector<double> SegmentMapper::distribute(const std::vector<double>& values) const
+{
+    if (values.size()<count.size()) {
+        std::cout << "SegmentMapper::distribute: there must be a value per node\n" << std::flush;
+        throw std::invalid_argument("SegmentMapper::distribute: there must be a value per node");
+    }
+    std::vector<double> r(getNumberOfCells());
+    for (size_t i=0; i<count.size(); i++) {
+        for (int k=0; k<count[i]; k++) {
+            const auto& p = pieces[first[i]+k];
+            r[p.first] += p.second*values[i];
+        }
+    }
+    return r;
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,73 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef MAPPER_H_
+#define MAPPER_H_
+
+#include "raster.h"
+
+#include <vector>
+#include <utility>
+
+namespace CRootBox {
+
+class Organism;
+class RectilinearGrid3D;
+
+/**
+ * SegmentMapper
+ *
+ * Maps the segments of an organism to the cells of a soil grid (e.g. for the coupling with DuMux), and keeps a table of the
+ * cells each segment passes, with the length fraction of the segment within each cell (the segments are split exactly at
+ * the cell faces, @see Raster). Segments (or their pieces) outside of the grid are not mapped.
+ *
+ * A segment is identified by its second node index i, i.e. it is the segment (p, i) where p is the preceding node of i
+ * (@see NodeStore::getPrev), each node ends at most one segment. The cell index is x-fastest (@see Raster::index).
+ *
+ * After each simulation step, SegmentMapper::update maps only the new segments (@see Organism::getNewSegments),
+ * and the segments of the nodes that were moved (@see Organism::getUpdatedNodeIndices), taken from the node store.
+ * If the organism was changed otherwise (e.g. by RootSystem::pop, or if an update was missed), all segments are mapped again.
+ */
+class SegmentMapper
+{
+public:
+
+    SegmentMapper(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z); ///< cell boundaries per axis
+    SegmentMapper(const RectilinearGrid3D& grid); ///< the cells between the grid points
+    virtual ~SegmentMapper() { }
+
+    void map(const Organism& plant); ///< maps all segments of the organism
+    void update(const Organism& plant); ///< maps the segments that changed in the last time step
+
+    size_t getNumberOfCells() const { return raster.getNumberOfVoxels(); } ///< number of cells of the grid
+    int getNumberOfUpdated() const { return updated; } ///< number of segments mapped by the last call of map or update
+
+    std::vector<int> getCells(int i) const; ///< cells of the segment ending in node i
+    std::vector<double> getFractions(int i) const; ///< length fractions of the segment ending in node i, corresponding to getCells
+    std::vector<std::vector<int>> getCellSegments() const; ///< segments (second node indices) per cell
+    std::vector<double> distribute(const std::vector<double>& values) const; ///< sums values per segment (by node index) proportionally into the cells
+
+protected:
+
+    void clear(); ///< removes all segments
+    void mapSegment(const Organism& plant, int i); ///< maps the segment ending in node i
+    void compact(); ///< removes the pieces of remapped segments
+
+    Raster raster;
+
+    int nodes = 0; ///< number of nodes mapped
+    size_t shrinks = 0; ///< number of node store shrinks, when the nodes were mapped
+    double simtime = -1.; ///< simulation time, when the nodes were mapped
+    int updated = 0;
+
+    std::vector<int> prev; ///< preceding node per node, or -1
+    std::vector<int> firstOut; ///< first segment (second node index) starting in the node, or -1
+    std::vector<int> nextOut; ///< next segment starting in the same node as the segment, or -1
+    std::vector<size_t> first; ///< first piece of the segment ending in the node
+    std::vector<int> count; ///< number of pieces of the segment ending in the node
+    std::vector<std::pair<size_t, double>> pieces; ///< cell index and length fraction
+    size_t garbage = 0; ///< number of pieces of remapped segments
+
+};
+
+} // end namespace CRootBox
+
+#endif
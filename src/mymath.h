@@ -7,6 +7,7 @@
  * not operator overloading vector matrix classes
  */
 #include <cmath>
+#include <cstddef>
 #include <sstream>
 #include <assert.h>
 
@@ -82,6 +83,43 @@ public:
         double sa = sin(a);
         return Vector3d(cos(a), sa*cos(b), sa*sin(b) );
     };
+    static Vector3d rotAB(double sa, double ca, double sb, double cb) { return Vector3d(ca, sa*cb, sa*sb); } ///< Vector3d::rotAB from precomputed sines and cosines
+
+    /**
+     * Batch version of Vector3d::rotAB, for many angles (e.g. the trials of a tropism) as structure of arrays
+     *
+     * @param a         angles alpha
+     * @param b         angles beta
+     * @param n         number of angles
+     * @param x         x-components of the directions (results)
+     * @param y         y-components of the directions (results)
+     * @param z         z-components of the directions (results)
+     */
+    static void rotAB(const double* a, const double* b, size_t n, double* x, double* y, double* z) {
+        for (size_t i=0; i<n; i++) {
+            double sa = sin(a[i]);
+            x[i] = cos(a[i]);
+            y[i] = sa*cos(b[i]);
+            z[i] = sa*sin(b[i]);
+        }
+    }
+
+    /**
+     * Batch inner products with the vectors (x[i], y[i], z[i]), with the operations in the order of Vector3d::times,
+     * written as a plain loop over arrays, that the compiler can vectorize
+     *
+     * @param x         x-components of the vectors
+     * @param y         y-components of the vectors
+     * @param z         z-components of the vectors
+     * @param n         number of vectors
+     * @param r         inner products (results)
+     */
+    void times(const double* x, const double* y, const double* z, size_t n, double* r) const {
+        const double vx = this->x, vy = this->y, vz = this->z;
+        for (size_t i=0; i<n; i++) {
+            r[i] = x[i]*vx+y[i]*vy+z[i]*vz;
+        }
+    }
 
     void normalize() { double l=length(); x/=l; y/=l; z/=l; } ///< normalizes the vector
 
@@ -105,6 +143,8 @@ public:
 
 };
 
+static_assert(sizeof(Vector3d)==3*sizeof(double), "Vector3d must not be padded, node vectors are exported as n x 3 arrays");
+
 inline bool operator==(const Vector3d& lhs, const Vector3d& rhs){ return ((lhs.x==rhs.x) && (lhs.y==rhs.y) && (lhs.z==rhs.z)); } // needed for boost python indexing suite
 inline bool operator!=(const Vector3d& lhs, const Vector3d& rhs){ return !(lhs == rhs); }
 
@@ -169,6 +209,7 @@ public:
         v3.normalize();
         return Matrix3d(v,v2,v3);
     } ///< Creates an orthonormal system (ONS) around the vector v
+    static Matrix3d ons(const Vector3d& v) { Vector3d u(v); return ons(u); } ///< Creates an ONS around v, without normalizing v
 
     double det() const {
         return  r0.x*(r1.y*r2.z-r2.y*r1.z)-r0.y*(r1.x*r2.z-r1.z*r2.x)+r0.z*(r1.x*r2.y-r1.y*r2.x);
@@ -220,6 +261,45 @@ public:
         return Vector3d(r0.times(v), r1.times(v), r2.times(v));
     } ///<  Multiplies vector v from right
 
+    Vector3d timesRotAB(double a, double b) const {
+        double sa = sin(a);
+        const Vector3d d(cos(a), sa*cos(b), sa*sin(b));
+        return Vector3d(r0.times(d), r1.times(d), r2.times(d));
+    } ///< fused times(Vector3d::rotAB(a,b)), the direction of the angles a and b in this frame
+
+    /**
+     * Fused step pos+times(Vector3d::rotAB(a,b))*dx, the common operation of the growth path (@see Tropism::getPosition)
+     * with the same operations (and results) as the composed version, but without temporary vectors and matrices
+     *
+     * @param pos       start position
+     * @param a         angle alpha
+     * @param b         angle beta
+     * @param dx        step length
+     * @return the end position
+     */
+    Vector3d step(const Vector3d& pos, double a, double b, double dx) const {
+        double sa = sin(a);
+        const Vector3d d(cos(a), sa*cos(b), sa*sin(b));
+        return Vector3d(pos.x+dx*r0.times(d), pos.y+dx*r1.times(d), pos.z+dx*r2.times(d));
+    }
+
+    /**
+     * Batch version of Matrix3d::times over vectors as structure of arrays (e.g. the local directions of tropism trials)
+     *
+     * @param x         x-components of the vectors
+     * @param y         y-components of the vectors
+     * @param z         z-components of the vectors
+     * @param n         number of vectors
+     * @param hx        x-components of the products (results)
+     * @param hy        y-components of the products (results)
+     * @param hz        z-components of the products (results)
+     */
+    void times(const double* x, const double* y, const double* z, size_t n, double* hx, double* hy, double* hz) const {
+        r0.times(x, y, z, n, hx);
+        r1.times(x, y, z, n, hy);
+        r2.times(x, y, z, n, hz);
+    }
+
     std::string toString() const {
         std::ostringstream strs;
         strs << r0.toString() << "\n" << r1.toString() << "\n" << r2.toString();
@@ -0,0 +1,334 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef NODESTORE_H_
+#define NODESTORE_H_
+
+#include "mymath.h"
+#include "packedcolumn.h"
+#include "packedpolyline.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace CRootBox {
+
+class Organ;
+
+/**
+ * NodeStore
+ *
+ * Geometry of all nodes of an organism as structure of arrays, indexed by the global node index:
+ * coordinates, creation times, and the organ that created the node.
+ *
+ * The store is kept up to date by the organs (see Organ::addNode), and is the only copy of the coordinates: the organs hold
+ * their global node indices, and their last two nodes (see Organ::getNode). The store
+ * allows Organism::getNodes and friends to copy contiguous memory instead of traversing the organ tree.
+ * At a branching point the creation time of the base root is stored (see Organism::getNodeCTs).
+ *
+ * Coordinates and creation times are stored in double precision per default. For large organisms or ensembles (where
+ * memory is the bottleneck), NodeStore::setPrecision stores them in float precision, or the coordinates quantized
+ * relative to an origin (@see PackedColumn). The organs keep their last two nodes in double precision, so the growth is
+ * not affected, but all other geometry (e.g. Organ::getNodes, Organism::getNodes, and SegmentAnalyser) is rounded.
+ *
+ * Additionally, NodeStore::setPacking encodes blocks of nodes, that no longer change, as quantized deltas to the
+ * preceding node along the organ (@see PackedPolyline, NodeStore::pack). The packed blocks are a prefix of the store,
+ * and are decoded transparently by NodeStore::getNode and NodeStore::getNodeCT. Nodes of a packed block that are still
+ * written (e.g. the tip of a slowly growing organ) are held in double precision beside the block, until they are fixed.
+ */
+class NodeStore
+{
+public:
+
+    /**
+     * Sets the node with global index @param i, the store grows if necessary
+     *
+     * @param i     global node index
+     * @param n     node coordinates [cm]
+     * @param t     node creation time [day]
+     * @param o     organ that created the node
+     * @param p     global index of the preceding node along the organ, i.e. segment (p,i), or -1 for a base node
+     */
+    void set(int i, const Vector3d& n, double t, Organ* o, int p) {
+        if (i>=size()) {
+            resize(i+1);
+        } else {
+            changes.push_back(i);
+        }
+        if (i<packed) {
+            setLoose(i, n, t);
+        } else {
+            x.set(i-packed, n.x);
+            y.set(i-packed, n.y);
+            z.set(i-packed, n.z);
+            ct.set(i-packed, t);
+        }
+        organ[i] = o;
+        prev[i] = p;
+    }
+
+    void resize(int n) { ///< shrinks or grows the store
+        if (n<size()) {
+            changes.push_back(-n-1);
+            shrinks.push_back(n);
+        }
+        if (n<packed) { // the dense nodes are removed, and the block of the last node is decoded
+            x.resize(0); y.resize(0); z.resize(0); ct.resize(0);
+            blocks.resize((n+blockSize-1)/blockSize);
+            packed = blocks.size()*blockSize;
+            unpack(n/blockSize);
+        }
+        x.resize(n-packed); y.resize(n-packed); z.resize(n-packed); ct.resize(n-packed); organ.resize(n, nullptr); prev.resize(n, -1);
+    }
+    void clear() { resize(0); } ///< removes all nodes
+    void assignGeometry(const NodeStore& s) { ///< copies precision, packing, coordinates and creation times of another store, the organs are set by Organ::storeNodes
+        x = s.x; y = s.y; z = s.z; ct = s.ct;
+        blocks = s.blocks; // the packed blocks are shared, the loose nodes are copied
+        packed = s.packed;
+        packing = s.packing;
+        packResolution = s.packResolution;
+        packTimeResolution = s.packTimeResolution;
+        organ.assign(s.size(), nullptr);
+        prev.assign(s.size(), -1);
+    }
+    int size() const { return organ.size(); } ///< number of node indices stored
+
+    /**
+     * Sets the storage precision of coordinates and creation times, the stored nodes are converted (and rounded).
+     * Packed blocks keep their resolutions (@see NodeStore::setPacking).
+     *
+     * @param p             PackedColumn::p_double (default), PackedColumn::p_float (coordinates and times),
+     *                      or PackedColumn::p_quantized (coordinates quantized, times in float precision)
+     * @param resolution    step of the quantized coordinates [cm]
+     * @param origin        origin of the quantized coordinates, e.g. the seed position [cm]
+     */
+    void setPrecision(int p, double resolution = 1.e-4, const Vector3d& origin = Vector3d()) {
+        x.setPrecision(p, resolution, origin.x);
+        y.setPrecision(p, resolution, origin.y);
+        z.setPrecision(p, resolution, origin.z);
+        ct.setPrecision(std::min(p, int(PackedColumn::p_float)));
+    }
+    int getPrecision() const { return x.getPrecision(); } ///< storage precision of the coordinates (@see NodeStore::setPrecision)
+    double getResolution() const { return x.getResolution(); } ///< step of quantized coordinates [cm]
+    Vector3d getOrigin() const { return Vector3d(x.getOrigin(), y.getOrigin(), z.getOrigin()); } ///< origin of quantized coordinates [cm]
+    bool isRounded() const { return (getPrecision()!=PackedColumn::p_double) || packing; } ///< the stored geometry is rounded (by the precision, or by packing)
+
+    size_t getMemory() const {
+        size_t m = x.getMemory()+y.getMemory()+z.getMemory()+ct.getMemory()+blocks.capacity()*sizeof(Block);
+        for (const auto& b : blocks) {
+            m += b.nodes->getMemory()+b.loose.capacity()*sizeof(LooseNode);
+        }
+        return m;
+    } ///< memory of coordinates and times [bytes]
+
+    /**
+     * Enables or disables the packing of nodes, that no longer change (@see NodeStore::pack). Packing is lossy,
+     * coordinates and creation times are rounded to the resolutions. Disabling decodes all packed blocks.
+     *
+     * @param pack              pack blocks of fixed nodes in NodeStore::pack
+     * @param resolution        step of quantized coordinates [cm]
+     * @param timeResolution    step of quantized creation times [day]
+     */
+    void setPacking(bool pack, double resolution = 1.e-4, double timeResolution = 1.e-6) {
+        if (!(resolution>0) || !(timeResolution>0)) {
+            std::cout << "NodeStore::setPacking: invalid resolutions\n" << std::flush;
+            throw std::invalid_argument("NodeStore::setPacking: invalid resolutions");
+        }
+        packing = pack;
+        packResolution = resolution;
+        packTimeResolution = timeResolution;
+        if (!pack) {
+            unpack(0);
+        }
+    }
+    bool getPacking() const { return packing; } ///< packing is enabled (@see NodeStore::setPacking)
+    int getNumberOfPackedNodes() const { return packed; } ///< the nodes [0, getNumberOfPackedNodes()) are packed
+
+    /**
+     * Packs the blocks of nodes, if packing is enabled. A block of blockSize nodes is packed, if at most
+     * blockSize/maxLoose of its nodes can still change, i.e. the blocks are packed in order, until a block with many growing
+     * tips is reached. Changing nodes are held loose, in double precision, and blocks whose loose nodes are fixed are
+     * encoded again. The rounded nodes are logged as changes (@see NodeStore::getChanges).
+     *
+     * @param mutableNodes      sorted global indices of nodes that can still change (e.g. the last two nodes of growing organs)
+     */
+    void pack(const std::vector<int>& mutableNodes) {
+        if (!packing) {
+            return;
+        }
+        auto isMutable = [&](int i) { return std::binary_search(mutableNodes.begin(), mutableNodes.end(), i); };
+        for (size_t b=0; b<blocks.size(); b++) { // loose nodes that became fixed
+            bool fixed = false;
+            for (const auto& l : blocks[b].loose) {
+                fixed |= !isMutable(b*blockSize+l.k);
+            }
+            if (fixed) {
+                std::vector<Vector3d> n;
+                std::vector<double> t;
+                decode(b, n, t);
+                std::vector<LooseNode> loose;
+                for (const auto& l : blocks[b].loose) {
+                    if (isMutable(b*blockSize+l.k)) {
+                        loose.push_back(l);
+                    } else {
+                        changes.push_back(b*blockSize+l.k);
+                    }
+                }
+                blocks[b] = encode(b*blockSize, n, t);
+                blocks[b].loose = loose;
+            }
+        }
+        int nb = 0;
+        while (packed+(nb+1)*blockSize<=size()) { // new blocks
+            int i0 = packed+nb*blockSize;
+            auto first = std::lower_bound(mutableNodes.begin(), mutableNodes.end(), i0);
+            auto last = std::lower_bound(first, mutableNodes.end(), i0+blockSize);
+            if (last-first>blockSize/maxLoose) {
+                break;
+            }
+            std::vector<Vector3d> n(blockSize);
+            std::vector<double> t(blockSize);
+            for (int k=0; k<blockSize; k++) {
+                int j = nb*blockSize+k;
+                n[k] = Vector3d(x.get(j), y.get(j), z.get(j));
+                t[k] = ct.get(j);
+            }
+            blocks.push_back(encode(i0, n, t));
+            for (auto it = first; it!=last; ++it) {
+                int k = *it-i0;
+                blocks.back().loose.push_back(LooseNode{ k, n[k], t[k] });
+            }
+            for (int k=0; k<blockSize; k++) {
+                if (!std::binary_search(first, last, i0+k)) {
+                    changes.push_back(i0+k);
+                }
+            }
+            nb++;
+        }
+        if (nb>0) {
+            x.eraseFront(nb*blockSize); y.eraseFront(nb*blockSize); z.eraseFront(nb*blockSize); ct.eraseFront(nb*blockSize);
+            packed += nb*blockSize;
+        }
+    }
+
+    Vector3d getNode(int i) const {
+        if (i<packed) {
+            const Block& b = blocks[i/blockSize];
+            auto l = b.findLoose(i%blockSize);
+            return (l!=b.loose.end()) ? l->n : b.nodes->getNode(i%blockSize);
+        }
+        return Vector3d(x.get(i-packed), y.get(i-packed), z.get(i-packed));
+    } ///< coordinates of node i [cm]
+    double getNodeCT(int i) const {
+        if (i<packed) {
+            const Block& b = blocks[i/blockSize];
+            auto l = b.findLoose(i%blockSize);
+            return (l!=b.loose.end()) ? l->t : b.nodes->getNodeCT(i%blockSize);
+        }
+        return ct.get(i-packed);
+    } ///< creation time of node i [day]
+    Organ* getOrgan(int i) const { return organ[i]; } ///< organ that created node i (nullptr if unused)
+    int getPrev(int i) const { return prev[i]; } ///< preceding node of node i, i.e. the segment (prev, i), or -1 if there is no segment ending in i
+
+    const std::vector<Organ*>& getOrgans() const { return organ; } ///< organs that created the nodes
+    const std::vector<int>& getPrevs() const { return prev; } ///< preceding nodes of all nodes
+
+    /**
+     * Log of changes of existing entries, for incremental caches (see Organism::getCachedSegments).
+     * An entry i>=0 denotes that node i was overwritten, an entry i<0 that the store was shrunk to size -i-1.
+     * Appending new nodes is not logged.
+     */
+    const std::vector<int>& getChanges() const { return changes; }
+    void clearChanges() { changes.clear(); } ///< clears the log of changes
+    const std::vector<int>& getShrinks() const { return shrinks; } ///< sizes the store was shrunk to (e.g. by RootSystem::pop), in order, never cleared
+
+    static const int blockSize = 256; ///< number of nodes of a packed block
+    static const int maxLoose = 4; ///< a block with more than blockSize/maxLoose changing nodes is not packed
+
+protected:
+
+    struct LooseNode {
+        int k; // index within the block
+        Vector3d n;
+        double t;
+    }; ///< node of a packed block, that can still change
+
+    struct Block {
+        std::shared_ptr<const PackedPolyline> nodes;
+        std::vector<LooseNode> loose; // sorted by their index
+        std::vector<LooseNode>::const_iterator findLoose(int k) const {
+            auto l = std::lower_bound(loose.begin(), loose.end(), k, [](const LooseNode& a, int k) { return a.k<k; });
+            return ((l!=loose.end()) && (l->k==k)) ? l : loose.end();
+        }
+    }; ///< packed block of nodes
+
+    Block encode(int i0, const std::vector<Vector3d>& n, const std::vector<double>& t) const {
+        std::vector<int> bases(n.size());
+        for (size_t k=0; k<n.size(); k++) {
+            int p = prev[i0+k];
+            bases[k] = ((p>=i0) && (p<i0+int(k))) ? p-i0 : -1; // the preceding node along the organ, if in the block
+        }
+        Block b;
+        b.nodes = std::make_shared<const PackedPolyline>(n, t, bases, packResolution, packTimeResolution);
+        return b;
+    } ///< encodes the block starting at node i0
+
+    void decode(int b, std::vector<Vector3d>& n, std::vector<double>& t) const {
+        blocks[b].nodes->unpack(n, t);
+        for (const auto& l : blocks[b].loose) {
+            n[l.k] = l.n;
+            t[l.k] = l.t;
+        }
+    } ///< nodes and creation times of block b, including the loose nodes
+
+    void setLoose(int i, const Vector3d& n, double t) {
+        Block& b = blocks[i/blockSize];
+        int k = i%blockSize;
+        auto l = std::lower_bound(b.loose.begin(), b.loose.end(), k, [](const LooseNode& a, int k) { return a.k<k; });
+        if ((l!=b.loose.end()) && (l->k==k)) {
+            l->n = n;
+            l->t = t;
+            return;
+        }
+        Vector3d p = b.nodes->getNode(k);
+        if ((p.x!=n.x) || (p.y!=n.y) || (p.z!=n.z) || (b.nodes->getNodeCT(k)!=t)) {
+            b.loose.insert(l, LooseNode{ k, n, t });
+        }
+    } ///< writes a node of a packed block
+
+    void unpack(int b0) {
+        std::vector<double> vx, vy, vz, vt;
+        for (size_t b=b0; b<blocks.size(); b++) {
+            std::vector<Vector3d> n;
+            std::vector<double> t;
+            decode(b, n, t);
+            for (size_t k=0; k<n.size(); k++) {
+                vx.push_back(n[k].x); vy.push_back(n[k].y); vz.push_back(n[k].z); vt.push_back(t[k]);
+            }
+        }
+        x.insertFront(vx); y.insertFront(vy); z.insertFront(vz); ct.insertFront(vt);
+        blocks.resize(b0);
+        packed = b0*blockSize;
+    } ///< decodes the blocks [b0, end) into the dense columns
+
+    PackedColumn x; // nodes [packed, size())
+
+    PackedColumn y;
+    PackedColumn z;
+    PackedColumn ct;
+    std::vector<Organ*> organ;
+    std::vector<int> prev;
+
+    std::vector<Block> blocks; // nodes [0, packed)
+    int packed = 0;
+    bool packing = false;
+    double packResolution = 1.e-4;
+    double packTimeResolution = 1.e-6;
+
+    std::vector<int> changes;
+    std::vector<int> shrinks;
+
+};
+
+} // namespace CRootBox
+
+#endif
@@ -2,13 +2,42 @@
 #include "organparameter.h"
 
 #include "Organism.h"
+#include "binaryio.h"
 
 #include <limits>
+#include <cmath>
 #include <iostream>
 #include <exception>
+#include <stdexcept>
 
 namespace CRootBox {
 
+/**
+ * Allocates the parameters from the memory pool of the plant (@see Organ::operator new)
+ */
+void* OrganSpecificParameter::operator new(size_t size, Organism* plant)
+{
+    if (plant==nullptr) {
+        return MemoryPool::allocateHeap(size);
+    }
+    return plant->getMemoryPool().allocate(size);
+}
+
+void* OrganSpecificParameter::operator new(size_t size)
+{
+    return MemoryPool::allocateHeap(size);
+}
+
+void OrganSpecificParameter::operator delete(void* p)
+{
+    MemoryPool::deallocate(p);
+}
+
+void OrganSpecificParameter::operator delete(void* p, Organism* plant)
+{
+    MemoryPool::deallocate(p);
+}
+
 /**
  * @return Quick info about the object for debugging
  */
@@ -55,11 +84,12 @@ OrganRandomParameter* OrganRandomParameter::copy(Organism* p)
  *
  * Normally, both OrganParameter, and OrganTypeParameter are constant over the organ life time.
  *
+ * @param plant     the plant of the new organ, the parameters are allocated from its pool
  * @return The organ specific parameter set (each organ has exactly one set)
  */
-OrganSpecificParameter* OrganRandomParameter::realize()
+OrganSpecificParameter* OrganRandomParameter::realize(Organism* plant)
 {
-    OrganSpecificParameter* op = new OrganSpecificParameter();
+    OrganSpecificParameter* op = new (plant) OrganSpecificParameter();
     op->subType = subType;
     return op;
 }
@@ -93,6 +123,37 @@ double OrganRandomParameter::getParameter(std::string name) const
     return std::numeric_limits<double>::quiet_NaN(); // default if name is unknown
 }
 
+/**
+ * Sets a scalar parameter by its name (@see OrganRandomParameter::getParameter), integer parameters are rounded.
+ * Derived call back functions (e.g. tropisms) are created from the parameters when the organism is initialized.
+ *
+ * @param name      parameter name, "_dev" for its standard deviation, the suffix "_mean" is ignored
+ * @param value     new value
+ * @return false, if the parameter name is unknown
+ */
+bool OrganRandomParameter::setParameter(std::string name, double value)
+{
+    if ((name.length()>4) && (name.substr(name.length()-4)=="_dev")) {// setting standard deviation?
+        std::string n = name.substr(0,name.length()-4);
+        if (param_sd.count(n)) {
+            *param_sd.at(n) = value;
+            return true;
+        }
+    }
+    if ((name.length()>5) && (name.substr(name.length()-5)=="_mean")) {// setting the mean value?
+        name = name.substr(0,name.length()-5);
+    }
+    if (iparam.count(name)) { // setting an int parameter
+        *iparam.at(name) = (int)std::round(value);
+        return true;
+    }
+    if (dparam.count(name)) { // setting a double parameter
+        *dparam.at(name) = value;
+        return true;
+    }
+    return false;
+}
+
 /**
  * Quick info about the object for debugging
  *
@@ -270,6 +331,65 @@ void OrganRandomParameter::writeXML(std::string name) const
     doc.SaveFile(name.c_str());
 }
 
+/**
+ * Writes the values of the bound parameters @param m by name
+ */
+template<class T>
+static void writeBound(BinaryWriter& w, const std::map<std::string, T*>& m)
+{
+    w.write(uint64_t(m.size()));
+    for (const auto& p : m) {
+        w.write(p.first);
+        w.write(*p.second);
+    }
+}
+
+/**
+ * Reads the values of the bound parameters @param m written by writeBound, throws if a name is not bound
+ */
+template<class T>
+static void readBound(BinaryReader& r, const std::map<std::string, T*>& m, const std::string& name)
+{
+    uint64_t n = r.read<uint64_t>();
+    for (uint64_t i=0; i<n; i++) {
+        std::string key = r.readString();
+        T v = r.read<T>();
+        auto it = m.find(key);
+        if (it==m.end()) {
+            std::cout << "OrganRandomParameter::readBinary: unknown parameter " << key << " of " << name << "\n" << std::flush;
+            throw std::invalid_argument("OrganRandomParameter::readBinary: unknown parameter " + key);
+        }
+        *it->second = v;
+    }
+}
+
+/**
+ * Writes the name, and all bound parameters and deviations by name, in full precision
+ * (unlike OrganRandomParameter::writeXML)
+ *
+ * @param w         the binary writer
+ */
+void OrganRandomParameter::writeBinary(BinaryWriter& w) const
+{
+    w.write(name);
+    writeBound(w, iparam);
+    writeBound(w, dparam);
+    writeBound(w, param_sd);
+}
+
+/**
+ * Reads a parameter set written by OrganRandomParameter::writeBinary
+ *
+ * @param r         the binary reader
+ */
+void OrganRandomParameter::readBinary(BinaryReader& r)
+{
+    name = r.readString();
+    readBound(r, iparam, name);
+    readBound(r, dparam, name);
+    readBound(r, param_sd, name);
+}
+
 /**
  *  Binds a parameter name to its int member variable,
  *  the values can then be accessed with OrganTypeParameter::getParameter,
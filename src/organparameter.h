@@ -4,6 +4,7 @@
 
 #include <string>
 #include <map>
+#include <atomic>
 
 #include "../external/tinyxml2/tinyxml2.h"
 
@@ -15,19 +16,41 @@
 namespace CRootBox {
 
 class Organism; // forward declaration
+class BinaryWriter;
+class BinaryReader;
 
 /**
  * Parameters for a specific organ
+ *
+ * The parameters are immutable once the organ is created, and shared by the copies of the organ (@see Organ::copy).
+ * They are reference counted (@see OrganSpecificParameter::retain), and deleted with the last organ referring to them.
  */
 class OrganSpecificParameter {
 public:
 
+    OrganSpecificParameter() { }
+    OrganSpecificParameter(const OrganSpecificParameter& p): subType(p.subType) { } ///< the copy is not referenced
+    OrganSpecificParameter& operator=(const OrganSpecificParameter& p) { subType = p.subType; return *this; } ///< keeps the references
     virtual ~OrganSpecificParameter() { };
 
+    void retain() const { references++; } ///< adds a reference
+    void release() const { if (--references==0) { delete this; } } ///< removes a reference, deletes the parameters with the last
+    int getReferences() const { return references; } ///< number of organs referring to the parameters
+
+    /* allocation from the memory pool of the plant, analogous to the organs (@see Organ::operator new) */
+    static void* operator new(size_t size, Organism* plant);
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+    static void operator delete(void* p, Organism* plant);
+
     int subType = -1; ///< sub type of the organ
 
     virtual std::string toString() const; ///< quick info for debugging
 
+private:
+
+    mutable std::atomic<int> references = { 0 }; ///< organs are copied in parallel (@see RootSystemEnsemble)
+
 };
 
 /**
@@ -39,6 +62,9 @@ public:
  * For other parameter types the methods must be overwritten, see RootTypeParameters.
  *
  * The factory function copy() has to be overwritten for each specialization.
+ *
+ * The parameter sets are shared by the copies of an organism, and copied on write (@see Organism::getOrganRandomParameter).
+ * Random numbers are therefore drawn from the plant passed to realize(Organism*), not from the plant that created the set.
  */
 class OrganRandomParameter
 {
@@ -49,9 +75,11 @@ public:
 
     virtual OrganRandomParameter* copy(Organism* plant); ///< copies the root type parameter into a new plant
 
-    virtual OrganSpecificParameter* realize(); ///< creates a specific organ from the root parameter set
+    OrganSpecificParameter* realize() { return realize(plant); } ///< creates a specific organ from the root parameter set
+    virtual OrganSpecificParameter* realize(Organism* plant); ///< creates a specific organ of @param plant, using its random numbers
 
     virtual double getParameter(std::string name) const; // get a scalar parameter
+    virtual bool setParameter(std::string name, double value); ///< set a scalar parameter, returns false if the name is unknown
 
     virtual std::string toString(bool verbose = true) const; ///< info for debugging
 
@@ -59,6 +87,8 @@ public:
     void readXML(std::string name); ///< reads a single sub type organ parameter set
     virtual tinyxml2::XMLElement* writeXML(tinyxml2::XMLDocument& doc, bool comments = true) const; ///< writes a organ root parameter set
     void writeXML(std::string name) const; ///< writes a organ root parameter set
+    virtual void writeBinary(BinaryWriter& w) const; ///< writes the parameter set exactly (see Organism::save)
+    virtual void readBinary(BinaryReader& r); ///< reads a parameter set written by OrganRandomParameter::writeBinary
 
     void bindParameter(std::string name, int* i, std::string descr = "", double* dev = nullptr); ///< binds integer to parameter name
     void bindParameter(std::string name, double* d, std::string descr = "", double* dev = nullptr); ///< binds double to parameter name
@@ -67,7 +97,7 @@ public:
     int organType = 0;
     int subType = 0;
 
-    Organism* plant;
+    Organism* plant; ///< the organism that created the parameter set
 
 protected:
 
@@ -0,0 +1,139 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef PACKEDCOLUMN_H_
+#define PACKEDCOLUMN_H_
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <iostream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * PackedColumn
+ *
+ * A column of scalars (e.g. node coordinates, or creation times), stored in double precision, in float precision,
+ * or quantized as 32 bit integers with a fixed resolution relative to an origin (e.g. the seed position).
+ * Values are read and written as double, reduced precisions round the values when they are stored.
+ *
+ * Quantized values must be within origin +- resolution*2^31 (e.g. +-214 m for the default resolution 1e-4 cm).
+ */
+class PackedColumn
+{
+public:
+
+    enum Precision { p_double = 0, p_float, p_quantized }; ///< storage precisions
+
+    /**
+     * Sets the storage precision, the stored values are converted
+     *
+     * @param p             precision (@see PackedColumn::Precision)
+     * @param resolution    step of quantized values
+     * @param origin        value of the quantized zero
+     */
+    void setPrecision(int p, double resolution = 1.e-4, double origin = 0.) {
+        if ((p<p_double) || (p>p_quantized) || ((p==p_quantized) && !(resolution>0))) {
+            std::cout << "PackedColumn::setPrecision: unknown precision, or invalid resolution\n" << std::flush;
+            throw std::invalid_argument("PackedColumn::setPrecision: unknown precision, or invalid resolution");
+        }
+        std::vector<double> v(size());
+        for (size_t i=0; i<v.size(); i++) {
+            v[i] = get(i);
+        }
+        d.clear(); d.shrink_to_fit();
+        f.clear(); f.shrink_to_fit();
+        q.clear(); q.shrink_to_fit();
+        precision = p;
+        this->resolution = resolution;
+        this->origin = origin;
+        resize(v.size());
+        for (size_t i=0; i<v.size(); i++) {
+            set(i, v[i]);
+        }
+    }
+
+    int getPrecision() const { return precision; } ///< storage precision (@see PackedColumn::Precision)
+    double getResolution() const { return resolution; } ///< step of quantized values
+    double getOrigin() const { return origin; } ///< value of the quantized zero
+
+    double get(size_t i) const {
+        switch (precision) {
+        case p_double: return d[i];
+        case p_float: return f[i];
+        default: return origin+q[i]*resolution;
+        }
+    } ///< value i
+
+    void set(size_t i, double v) {
+        switch (precision) {
+        case p_double: d[i] = v; break;
+        case p_float: f[i] = float(v); break;
+        default: q[i] = quantize(v);
+        }
+    } ///< sets value i, rounded to the storage precision
+
+    void resize(size_t n) {
+        switch (precision) {
+        case p_double: d.resize(n, 0.); break;
+        case p_float: f.resize(n, 0.f); break;
+        default: q.resize(n, quantize(0.));
+        }
+    } ///< shrinks or grows the column, new values are 0
+
+    void eraseFront(size_t n) {
+        d.erase(d.begin(), d.begin()+std::min(n, d.size()));
+        f.erase(f.begin(), f.begin()+std::min(n, f.size()));
+        q.erase(q.begin(), q.begin()+std::min(n, q.size()));
+        if (d.capacity()>2*d.size()) { d.shrink_to_fit(); }
+        if (f.capacity()>2*f.size()) { f.shrink_to_fit(); }
+        if (q.capacity()>2*q.size()) { q.shrink_to_fit(); }
+    } ///< removes the first n values (e.g. moved into packed blocks, see NodeStore::pack)
+
+    void insertFront(const std::vector<double>& v) {
+        size_t n = size();
+        resize(n+v.size());
+        for (size_t i=n; i-->0; ) {
+            set(i+v.size(), get(i));
+        }
+        for (size_t i=0; i<v.size(); i++) {
+            set(i, v[i]);
+        }
+    } ///< inserts the values v in front, rounded to the storage precision
+
+    size_t size() const {
+        switch (precision) {
+        case p_double: return d.size();
+        case p_float: return f.size();
+        default: return q.size();
+        }
+    } ///< number of values
+
+    size_t getMemory() const { return d.capacity()*sizeof(double)+f.capacity()*sizeof(float)+q.capacity()*sizeof(int32_t); } ///< [bytes]
+
+protected:
+
+    int32_t quantize(double v) const {
+        double s = std::round((v-origin)/resolution);
+        if (!(std::abs(s)<=double(std::numeric_limits<int32_t>::max()))) {
+            std::cout << "PackedColumn::quantize: value " << v << " is out of the quantized range\n" << std::flush;
+            throw std::invalid_argument("PackedColumn::quantize: value is out of the quantized range");
+        }
+        return int32_t(s);
+    } ///< steps relative to the origin
+
+    int precision = p_double;
+    double resolution = 1.e-4;
+    double origin = 0.;
+
+    std::vector<double> d;
+    std::vector<float> f;
+    std::vector<int32_t> q;
+
+};
+
+} // namespace CRootBox
+
+#endif
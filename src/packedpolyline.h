@@ -0,0 +1,176 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef PACKEDPOLYLINE_H_
+#define PACKEDPOLYLINE_H_
+
+#include "mymath.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * PackedPolyline
+ *
+ * Immutable compact encoding of nodes and node creation times, that no longer change (@see NodeStore::pack).
+ *
+ * Coordinates and times are quantized with fixed resolutions, and stored as differences to a base node, as variable
+ * length integers (zigzag encoded, 7 bits per byte). The base node is the preceding node along the organ (i.e. the
+ * segment (base, i)), consecutive nodes are at most dx apart, and creation times increase slowly, so most values take
+ * one or two bytes instead of eight. Nodes without base, and every keyInterval-th node along a chain of bases, are
+ * stored absolute (key nodes), so a single node is decoded from at most keyInterval nodes.
+ *
+ * Decoded values are rounded to the resolutions, the encoding of decoded values gives the same values again.
+ */
+class PackedPolyline
+{
+public:
+
+    static const int keyInterval = 16; ///< at most keyInterval nodes are decoded per node
+    static const int maxBase = 255; ///< maximal distance of a node to its base node
+
+    /**
+     * Encodes the nodes and their creation times
+     *
+     * @param nodes             nodes of the polyline [cm]
+     * @param cts               creation times of the nodes [day]
+     * @param bases             base node of each node (a smaller index), or -1 for an absolute node;
+     *                          empty for a single polyline (the base is the preceding node)
+     * @param resolution        step of the quantized coordinates [cm]
+     * @param timeResolution    step of the quantized creation times [day]
+     */
+    PackedPolyline(const std::vector<Vector3d>& nodes, const std::vector<double>& cts, const std::vector<int>& bases = std::vector<int>(),
+        double resolution = 1.e-4, double timeResolution = 1.e-6) :n(nodes.size()), resolution(resolution), timeResolution(timeResolution)
+    {
+        if (!(resolution>0) || !(timeResolution>0) || (cts.size()!=n) || (!bases.empty() && (bases.size()!=n))) {
+            std::cout << "PackedPolyline::PackedPolyline: invalid resolutions, or number of creation times or bases\n" << std::flush;
+            throw std::invalid_argument("PackedPolyline::PackedPolyline: invalid resolutions, or number of creation times or bases");
+        }
+        std::vector<int64_t> q(4*n);
+        std::vector<uint8_t> depth(n);
+        bytes.reserve(4*n+8);
+        offsets.resize(n);
+        back.resize(n);
+        for (size_t i=0; i<n; i++) {
+            q[4*i] = quantize(nodes[i].x, resolution);
+            q[4*i+1] = quantize(nodes[i].y, resolution);
+            q[4*i+2] = quantize(nodes[i].z, resolution);
+            q[4*i+3] = quantize(cts[i], timeResolution);
+            int b = bases.empty() ? int(i)-1 : bases[i];
+            bool key = (b<0) || (b>=int(i)) || (int(i)-b>maxBase) || (depth[b]>=keyInterval-1);
+            depth[i] = key ? 0 : depth[b]+1;
+            back[i] = key ? 0 : uint8_t(i-b);
+            if (bytes.size()>UINT16_MAX) {
+                std::cout << "PackedPolyline::PackedPolyline: too many nodes\n" << std::flush;
+                throw std::invalid_argument("PackedPolyline::PackedPolyline: too many nodes");
+            }
+            offsets[i] = uint16_t(bytes.size());
+            for (int j=0; j<4; j++) {
+                put(key ? q[4*i+j] : q[4*i+j]-q[4*b+j]);
+            }
+        }
+        bytes.shrink_to_fit();
+    }
+
+    size_t size() const { return n; } ///< number of nodes
+    double getResolution() const { return resolution; } ///< step of the quantized coordinates [cm]
+    double getTimeResolution() const { return timeResolution; } ///< step of the quantized creation times [day]
+    size_t getMemory() const { return bytes.capacity()+offsets.capacity()*sizeof(uint16_t)+back.capacity(); } ///< [bytes]
+
+    Vector3d getNode(size_t i) const {
+        int64_t q[4];
+        decode(i, q);
+        return Vector3d(q[0]*resolution, q[1]*resolution, q[2]*resolution);
+    } ///< decodes node i [cm]
+
+    double getNodeCT(size_t i) const {
+        int64_t q[4];
+        decode(i, q);
+        return q[3]*timeResolution;
+    } ///< decodes the creation time of node i [day]
+
+    /**
+     * Decodes all nodes and creation times in a single pass
+     *
+     * @param nodes     the nodes [cm] (results)
+     * @param cts       their creation times [day] (results)
+     */
+    void unpack(std::vector<Vector3d>& nodes, std::vector<double>& cts) const {
+        std::vector<int64_t> q(4*n);
+        nodes.resize(n);
+        cts.resize(n);
+        const uint8_t* p = bytes.data();
+        for (size_t i=0; i<n; i++) {
+            for (int j=0; j<4; j++) {
+                q[4*i+j] = (back[i]==0) ? get(p) : q[4*(i-back[i])+j]+get(p);
+            }
+            nodes[i] = Vector3d(q[4*i]*resolution, q[4*i+1]*resolution, q[4*i+2]*resolution);
+            cts[i] = q[4*i+3]*timeResolution;
+        }
+    }
+
+protected:
+
+    static int64_t quantize(double v, double r) {
+        double s = std::round(v/r);
+        if (!(std::abs(s)<4.e18)) {
+            std::cout << "PackedPolyline::quantize: value " << v << " is out of the quantized range\n" << std::flush;
+            throw std::invalid_argument("PackedPolyline::quantize: value is out of the quantized range");
+        }
+        return int64_t(s);
+    } ///< steps relative to zero
+
+    void put(int64_t v) {
+        uint64_t u = (uint64_t(v)<<1)^uint64_t(v>>63); // zigzag, small magnitudes obtain small codes
+        while (u>=0x80) {
+            bytes.push_back(uint8_t(u|0x80));
+            u >>= 7;
+        }
+        bytes.push_back(uint8_t(u));
+    } ///< appends a variable length integer
+
+    static int64_t get(const uint8_t*& p) {
+        uint64_t u = 0;
+        int shift = 0;
+        while (*p&0x80) {
+            u |= uint64_t(*p++&0x7F)<<shift;
+            shift += 7;
+        }
+        u |= uint64_t(*p++)<<shift;
+        return int64_t(u>>1)^-int64_t(u&1);
+    } ///< reads a variable length integer, and advances the pointer
+
+    void decode(size_t i, int64_t* q) const {
+        if (i>=n) {
+            throw std::out_of_range("PackedPolyline::decode: node index out of range");
+        }
+        for (int j=0; j<4; j++) {
+            q[j] = 0;
+        }
+        while (true) { // sums the differences along the chain of bases, down to the key node
+            const uint8_t* p = bytes.data()+offsets[i];
+            for (int j=0; j<4; j++) {
+                q[j] += get(p);
+            }
+            if (back[i]==0) {
+                return;
+            }
+            i -= back[i];
+        }
+    } ///< quantized values of node i
+
+    size_t n;
+    double resolution;
+    double timeResolution;
+    std::vector<uint8_t> bytes; // per node: x, y, z, and time
+    std::vector<uint16_t> offsets; // byte offset of each node
+    std::vector<uint8_t> back; // distance to the base node, 0 for key nodes
+
+};
+
+} // namespace CRootBox
+
+#endif
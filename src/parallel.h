@@ -0,0 +1,65 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <mutex>
+#include <algorithm>
+
+namespace CRootBox {
+
+/**
+ * Calls f(i) for i = 0 .. n-1 using a pool of threads. Work items are handed out one by one,
+ * so the order in which they are processed is unspecified.
+ *
+ * The first exception thrown by f is rethrown, after all threads have finished.
+ *
+ * @param n         number of work items
+ * @param threads   number of threads, the calling thread takes part (threads<2 runs everything sequentially)
+ * @param f         work function, called with the work item index
+ */
+inline void parallelFor(int n, int threads, const std::function<void(int)>& f)
+{
+    if ((threads<2) || (n<2)) {
+        for (int i=0; i<n; i++) {
+            f(i);
+        }
+        return;
+    }
+    std::atomic<int> next(0);
+    std::exception_ptr error = nullptr;
+    std::mutex errorMutex;
+    auto worker = [&]() {
+        int i;
+        while ((i = next++) < n) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n; // stop handing out work
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t=1; t<std::min(threads, n); t++) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace CRootBox
+
+#endif
@@ -0,0 +1,80 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+#include <array>
+#include <cstdint>
+#include <cmath>
+
+namespace CRootBox {
+
+/**
+ * OrganStream
+ *
+ * Counter based random numbers of a single organ (see Organism::setOrganStreams), using the Philox 4x32-10 generator
+ * (Salmon et al. 2011, Parallel random numbers: as easy as 1, 2, 3). The n-th number of a stream is a function of the
+ * stream's key and n only, so the state is just the number of draws.
+ *
+ * Keys are derived from the key of the parent organ and the index of the lateral (or from the seed and the organ id
+ * for base organs), thus the random numbers of an organ do not depend on the draws of other organs.
+ */
+class OrganStream
+{
+public:
+
+    OrganStream(uint64_t key = 0): key(key) { }
+
+    double rand() { ///< uniformly distributed random number (0,1)
+        auto r = block(key, draws++);
+        return uniform(r[0], r[1]);
+    }
+
+    double randn() { ///< normally distributed random number (0,1), Box-Muller transform of a single block
+        auto r = block(key, draws++);
+        double u1 = uniform(r[0], r[1]);
+        double u2 = uniform(r[2], r[3]);
+        return std::sqrt(-2.*std::log(u1))*std::cos(2.*M_PI*u2);
+    }
+
+    /**
+     * Combines two values into a key (splitmix64 finalizer)
+     */
+    static uint64_t mix(uint64_t a, uint64_t b) {
+        uint64_t z = a+0x9E3779B97F4A7C15ull*(b+1);
+        z = (z^(z>>30))*0xBF58476D1CE4E5B9ull;
+        z = (z^(z>>27))*0x94D049BB133111EBull;
+        return z^(z>>31);
+    }
+
+    /**
+     * Philox 4x32-10 block of a key and a counter
+     */
+    static std::array<uint32_t, 4> block(uint64_t key, uint64_t counter) {
+        std::array<uint32_t, 4> c = { uint32_t(counter), uint32_t(counter>>32), 0, 0 };
+        uint32_t k0 = uint32_t(key);
+        uint32_t k1 = uint32_t(key>>32);
+        for (int i=0; i<10; i++) {
+            uint64_t p0 = uint64_t(0xD2511F53)*c[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57)*c[2];
+            c = { uint32_t(p1>>32)^c[1]^k0, uint32_t(p1), uint32_t(p0>>32)^c[3]^k1, uint32_t(p0) };
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        return c;
+    }
+
+    uint64_t key; ///< identifies the stream
+    uint64_t draws = 0; ///< number of random numbers drawn (the counter)
+
+protected:
+
+    static double uniform(uint32_t a, uint32_t b) { ///< (0,1) from 53 bits
+        uint64_t x = ((uint64_t(a)<<32)|b)>>11;
+        return (double(x)+0.5)*(1./9007199254740992.);
+    }
+
+};
+
+} // namespace CRootBox
+
+#endif
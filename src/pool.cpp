@@ -0,0 +1,169 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "pool.h"
+
+#include <new>
+#include <cstdlib>
+
+namespace CRootBox {
+
+thread_local MemoryPool* MemoryPool::bulk = nullptr;
+
+MemoryPool::MemoryPool()
+{
+    for (size_t i=0; i<classes.size(); i++) {
+        classes[i].blockSize = (i+1)*granularity;
+    }
+}
+
+/**
+ * Allocates memory from the pool. The block is taken from the free list of its size class,
+ * or from the last chunk of the size class, a new chunk is allocated if it is exhausted.
+ * Objects larger than the largest size class are allocated on the heap.
+ *
+ * @param size      size of the object [bytes]
+ * @return          memory aligned to 16 bytes
+ */
+void* MemoryPool::allocate(size_t size)
+{
+    size_t c = (size+headerSize-1)/granularity; // size class
+    if (c>=classes.size()) {
+        return allocateHeap(size);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    SizeClass& sc = classes[c];
+    char* b;
+    if (sc.freeList!=nullptr) { // recycle
+        b = sc.freeList;
+        sc.freeList = *reinterpret_cast<char**>(b+headerSize);
+    } else {
+        if (sc.next==sc.end) { // new chunk
+            sc.next = static_cast<char*>(rawAllocate(blocksPerChunk*sc.blockSize));
+            sc.end = sc.next+blocksPerChunk*sc.blockSize;
+            sc.chunks.push_back(sc.next);
+        }
+        b = sc.next;
+        sc.next += sc.blockSize;
+    }
+    Header* h = reinterpret_cast<Header*>(b);
+    h->pool = this;
+    h->sizeClass = c;
+    blocks++;
+    return b+headerSize;
+}
+
+/**
+ * Allocates memory on the heap, with a header, so it can be freed by MemoryPool::deallocate
+ *
+ * @param size      size of the object [bytes]
+ */
+void* MemoryPool::allocateHeap(size_t size)
+{
+    char* b = static_cast<char*>(rawAllocate(size+headerSize));
+    Header* h = reinterpret_cast<Header*>(b);
+    h->pool = nullptr;
+    h->sizeClass = 0;
+    return b+headerSize;
+}
+
+/**
+ * Returns memory obtained by MemoryPool::allocate or MemoryPool::allocateHeap,
+ * pooled blocks are put on the free list of their pool
+ *
+ * @param p         the memory
+ */
+void MemoryPool::deallocate(void* p)
+{
+    if (p==nullptr) {
+        return;
+    }
+    char* b = static_cast<char*>(p)-headerSize;
+    Header* h = reinterpret_cast<Header*>(b);
+    MemoryPool* pool = h->pool;
+    if (pool==nullptr) {
+        std::free(b);
+        return;
+    }
+    if (pool==bulk) { // returned with the bulk release, the chunks are released with the pool
+        pool->released++;
+        return;
+    }
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        SizeClass& sc = pool->classes[h->sizeClass];
+        *reinterpret_cast<char**>(p) = sc.freeList;
+        sc.freeList = b;
+        pool->blocks--;
+        last = pool->destroyed && (pool->blocks==0);
+    }
+    if (last) {
+        delete pool;
+    }
+}
+
+/**
+ * Deletes a pool that was created with new. If blocks are still in use, the pool is deleted when the last one is returned
+ * by MemoryPool::deallocate, the chunks are kept until then.
+ *
+ * @param pool      the pool, which must not be used for allocations any more
+ */
+void MemoryPool::destroy(MemoryPool* pool)
+{
+    bool empty;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->destroyed = true;
+        empty = (pool->blocks==0);
+    }
+    if (empty) {
+        delete pool;
+    }
+}
+
+/**
+ * Starts the bulk release of the blocks, that the calling thread returns to @param pool
+ */
+MemoryPool::BulkRelease::BulkRelease(MemoryPool* pool) :pool(pool), previous(bulk)
+{
+    bulk = pool;
+}
+
+/**
+ * Ends the bulk release, the returned blocks are removed from the pool at once
+ */
+MemoryPool::BulkRelease::~BulkRelease()
+{
+    bulk = previous;
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->blocks -= pool->released;
+    pool->released = 0;
+}
+
+/**
+ * Releases all chunks at once. Only call if no pooled object is alive.
+ */
+void MemoryPool::release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& sc : classes) {
+        for (auto c : sc.chunks) {
+            std::free(c);
+        }
+        sc.chunks.clear();
+        sc.freeList = nullptr;
+        sc.next = nullptr;
+        sc.end = nullptr;
+    }
+    blocks = 0;
+}
+
+void* MemoryPool::rawAllocate(size_t size)
+{
+    void* p = std::malloc(size);
+    if (p==nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+} // namespace CRootBox
@@ -0,0 +1,109 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <vector>
+#include <array>
+#include <mutex>
+#include <cstddef>
+
+namespace CRootBox {
+
+/**
+ * MemoryPool
+ *
+ * Pool allocator for the organs and specific organ parameters of an organism (see Organ::operator new).
+ * Memory is taken in chunks of equally sized blocks (one block list per size class), freed blocks are recycled,
+ * and all chunks are released at once when the pool is destroyed.
+ * Organs that are created one after the other (e.g. the laterals of a root) are placed next to each other.
+ *
+ * Each block starts with a small header pointing to its pool, so MemoryPool::deallocate works without knowing the pool,
+ * and objects allocated on the heap (pool = nullptr, e.g. organs created in Python) can be mixed with pooled ones.
+ * The pool is thread safe, since organs are created in parallel (see Organism::setNumberOfThreads).
+ *
+ * Blocks can outlive the organism that allocated them, if they are shared (e.g. the specific parameters of copied organs,
+ * see Organ::copy). The organism therefore does not delete its pool, but calls MemoryPool::destroy.
+ * When the organs of an organism are deleted, their blocks are returned in bulk (see MemoryPool::BulkRelease),
+ * and the chunks are released at once, when the pool is destroyed.
+ */
+class MemoryPool
+{
+public:
+
+    /**
+     * Within the scope, the blocks that the calling thread returns to the pool are only counted, and not put on the free list
+     * (e.g. while all organs of an organism are deleted), so the mutex is taken once at the end of the scope.
+     * The pool must not be used for allocations afterwards, but be destroyed (see MemoryPool::destroy).
+     */
+    class BulkRelease
+    {
+    public:
+        BulkRelease(MemoryPool* pool);
+        ~BulkRelease();
+        BulkRelease(const BulkRelease&) = delete;
+        BulkRelease& operator=(const BulkRelease&) = delete;
+    private:
+        MemoryPool* pool;
+        MemoryPool* previous; ///< enclosing bulk release of the thread
+    };
+
+    static const size_t headerSize = 16; ///< keeps the objects aligned to 16 bytes
+    static const size_t granularity = 64; ///< block sizes are multiples of granularity [bytes]
+    static const size_t numberOfClasses = 16; ///< size classes up to numberOfClasses*granularity bytes, larger objects go to the heap
+    static constexpr size_t maxObjectSize() { return numberOfClasses*granularity-headerSize; } ///< largest pooled object [bytes]
+
+    MemoryPool(); ///< empty pool, memory is taken from the heap on demand
+
+    MemoryPool(const MemoryPool&) = delete; ///< pools are not copied, a copied organism allocates its own organs
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    ~MemoryPool() { release(); }
+
+    static void destroy(MemoryPool* pool); ///< deletes the pool now, or when its last block is returned
+
+    void* allocate(size_t size); ///< allocates from the pool, large objects are allocated on the heap
+    static void* allocateHeap(size_t size); ///< allocates on the heap, with a header
+    static void deallocate(void* p); ///< returns memory obtained by allocate or allocateHeap
+    void release(); ///< releases all chunks at once, only call if no pooled object is alive
+
+    size_t getNumberOfBlocks() const { return blocks; } ///< number of allocated blocks, that were not freed
+    size_t getNumberOfChunks() const { ///< number of chunks taken from the heap
+        size_t n = 0;
+        for (const auto& sc : classes) {
+            n += sc.chunks.size();
+        }
+        return n;
+    }
+
+protected:
+
+    static void* rawAllocate(size_t size); ///< malloc, throws std::bad_alloc
+
+    struct Header {
+        MemoryPool* pool; ///< owning pool, nullptr for heap allocations
+        size_t sizeClass; ///< size class of the block
+    };
+
+    struct SizeClass {
+        size_t blockSize = 0; ///< size of a block including its header [bytes]
+        std::vector<char*> chunks; ///< memory taken from the heap
+        char* freeList = nullptr; ///< first free block, the next free block is stored behind the header
+        char* next = nullptr; ///< next unused block of the last chunk
+        char* end = nullptr; ///< end of the last chunk
+    };
+
+    static const size_t blocksPerChunk = 256;
+
+    static thread_local MemoryPool* bulk; ///< pool of the bulk release of this thread (see MemoryPool::BulkRelease)
+
+    std::array<SizeClass, numberOfClasses> classes;
+    std::mutex mutex;
+    size_t blocks = 0;
+    size_t released = 0; ///< blocks returned within the bulk release, only accessed by its thread
+    bool destroyed = false; ///< MemoryPool::destroy was called, the pool is deleted with its last block
+
+};
+
+} // namespace CRootBox
+
+#endif
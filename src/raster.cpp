@@ -0,0 +1,200 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "raster.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace CRootBox {
+
+static double coordinate(const Vector3d& v, int d)
+{
+    return (d==0) ? v.x : ((d==1) ? v.y : v.z);
+}
+
+/**
+ * Constructor
+ *
+ * @param x         voxel boundaries along the x-axis (ascending or descending), empty for an unbounded axis
+ * @param y         voxel boundaries along the y-axis
+ * @param z         voxel boundaries along the z-axis
+ */
+Raster::Raster(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z)
+{
+    setAxis(0, x);
+    setAxis(1, y);
+    setAxis(2, z);
+}
+
+/**
+ * Sets the voxel boundaries of axis @param d
+ */
+void Raster::setAxis(int d, const std::vector<double>& b)
+{
+    Axis& ax = axes[d];
+    if (b.size()<2) { // unbounded
+        return;
+    }
+    ax.sign = (b.front()>b.back()) ? -1. : 1.;
+    ax.b.resize(b.size());
+    for (size_t i=0; i<b.size(); i++) {
+        ax.b[i] = ax.sign*b[i];
+        if ((i>0) && !(ax.b[i]>ax.b[i-1])) {
+            std::cout << "Raster::setAxis: voxel boundaries must be strictly monotonic\n" << std::flush;
+            throw std::invalid_argument("Raster::setAxis: voxel boundaries must be strictly monotonic");
+        }
+    }
+    ax.n = b.size()-1;
+    ax.h = (ax.b.back()-ax.b.front())/ax.n;
+    double eps = 1.e-12*std::max(ax.b.back()-ax.b.front(), 1.);
+    ax.equidistant = true;
+    for (size_t i=0; i<ax.b.size(); i++) {
+        ax.equidistant = ax.equidistant && (std::abs(ax.b[i]-(ax.b.front()+i*ax.h))<=eps);
+    }
+}
+
+/**
+ * Voxel index along axis @param d of the coordinate @param x, or -1 if it is outside of the raster.
+ * Voxels are half open [b_i, b_i+1), the last voxel includes its upper boundary.
+ */
+int Raster::locate(int d, double x) const
+{
+    const Axis& ax = axes[d];
+    if (ax.b.empty()) { // unbounded
+        return 0;
+    }
+    x *= ax.sign;
+    if (!((x>=ax.b.front()) && (x<=ax.b.back()))) { // (including nan)
+        return -1;
+    }
+    int c;
+    if (ax.equidistant) {
+        c = std::min(int((x-ax.b.front())/ax.h), int(ax.n)-1);
+        while ((c>0) && (x<ax.b[c])) { // round off
+            c--;
+        }
+        while ((c+1<int(ax.n)) && (x>=ax.b[c+1])) {
+            c++;
+        }
+    } else {
+        c = std::min(int(std::upper_bound(ax.b.begin(), ax.b.end(), x)-ax.b.begin())-1, int(ax.n)-1);
+    }
+    return c;
+}
+
+/**
+ * Line parameters of the voxel boundary crossings of the segment [@param a, @param b], including 0 and 1, sorted (results in @param t)
+ */
+void Raster::clip(const Vector3d& a, const Vector3d& b, std::vector<double>& t) const
+{
+    t.clear();
+    t.push_back(0.);
+    for (int d=0; d<3; d++) {
+        const Axis& ax = axes[d];
+        double xa = ax.sign*coordinate(a, d);
+        double xb = ax.sign*coordinate(b, d);
+        if (ax.b.empty() || (xa==xb)) {
+            continue;
+        }
+        double lo = std::min(xa, xb);
+        double hi = std::max(xa, xb);
+        for (auto it = std::upper_bound(ax.b.begin(), ax.b.end(), lo); (it!=ax.b.end()) && (*it<hi); ++it) {
+            t.push_back((*it-xa)/(xb-xa));
+        }
+    }
+    t.push_back(1.);
+    std::sort(t.begin(), t.end());
+}
+
+/**
+ * Clips the segment [@param a, @param b] with value @param value, and appends the voxel index and value of each piece to @param p
+ * (@param t is a buffer for the line parameters)
+ */
+void Raster::pieces(const Vector3d& a, const Vector3d& b, double value, bool proportional, bool exact,
+    std::vector<double>& t, std::vector<std::pair<size_t, double>>& p) const
+{
+    if (exact) {
+        clip(a, b, t);
+    } else {
+        t = { 0., 1. };
+    }
+    Vector3d v = b.minus(a);
+    for (size_t k=0; k+1<t.size(); k++) {
+        double dt = t[k+1]-t[k];
+        if (dt<=0) { // crossing of two boundaries at once
+            continue;
+        }
+        Vector3d m = a.plus(v.times(0.5*(t[k]+t[k+1]))); // the piece is within a single voxel
+        int i = locate(0, m.x);
+        int j = locate(1, m.y);
+        int l = locate(2, m.z);
+        if ((i>=0) && (j>=0) && (l>=0)) {
+            p.push_back(std::make_pair(index(i, j, l), proportional ? value*dt : value));
+        }
+    }
+}
+
+/**
+ * Clips the segment [@param a, @param b] at the voxel boundaries, and appends the voxel index and the length fraction
+ * of each piece to @param p. Pieces outside of the raster are dropped, i.e. the fractions add up to less than one.
+ */
+void Raster::split(const Vector3d& a, const Vector3d& b, std::vector<std::pair<size_t, double>>& p) const
+{
+    static thread_local std::vector<double> t;
+    pieces(a, b, 1., true, true, t, p);
+}
+
+/**
+ * Sums the segment values per voxel
+ *
+ * @param nodes         nodes
+ * @param segments      connectivity of the nodes
+ * @param values        a value per segment
+ * @param proportional  the value of a piece is proportional to its length (e.g. length, surface, volume),
+ *                      otherwise the value is added once for each voxel the segment passes
+ * @param exact         clips the segments at the voxel boundaries (true), or uses the segment mid points (false)
+ * @param threads       number of threads clipping the segments
+ * \return              summed values per voxel, x-fastest (@see Raster::index)
+ */
+std::vector<double> Raster::rasterize(const std::vector<Vector3d>& nodes, const std::vector<Vector2i>& segments,
+    const std::vector<double>& values, bool proportional, bool exact, int threads) const
+{
+    if (values.size()!=segments.size()) {
+        std::cout << "Raster::rasterize: number of values must equal the number of segments\n" << std::flush;
+        throw std::invalid_argument("Raster::rasterize: number of values must equal the number of segments");
+    }
+    std::vector<double> r(getNumberOfVoxels());
+    if (threads<2) {
+        std::vector<double> t;
+        std::vector<std::pair<size_t, double>> p;
+        for (size_t i=0; i<segments.size(); i++) {
+            p.clear();
+            pieces(nodes.at(segments[i].x), nodes.at(segments[i].y), values[i], proportional, exact, t, p);
+            for (const auto& pi : p) {
+                r[pi.first] += pi.second;
+            }
+        }
+        return r;
+    }
+    const size_t chunkSize = 4096; // segments per work item
+    size_t n = (segments.size()+chunkSize-1)/chunkSize;
+    std::vector<std::vector<std::pair<size_t, double>>> chunks(n);
+    parallelFor(n, threads, [&](int c) {
+        std::vector<double> t;
+        for (size_t i=c*chunkSize; i<std::min((c+1)*chunkSize, segments.size()); i++) {
+            pieces(nodes.at(segments[i].x), nodes.at(segments[i].y), values[i], proportional, exact, t, chunks[c]);
+        }
+    });
+    for (const auto& chunk : chunks) { // in the order of the segments
+        for (const auto& pi : chunk) {
+            r[pi.first] += pi.second;
+        }
+    }
+    return r;
+}
+
+} // end namespace CRootBox
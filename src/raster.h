@@ -0,0 +1,89 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef RASTER_H_
+#define RASTER_H_
+
+#include "mymath.h"
+
+#include <vector>
+#include <utility>
+
+namespace CRootBox {
+
+/**
+ * Raster
+ *
+ * Rasterizes line segments into the voxels of a rectilinear grid in a single pass.
+ * Each segment is clipped exactly at the voxel boundaries that it crosses, and the pieces are accumulated into the voxels
+ * (or, if not exact, the whole segment is accumulated into the voxel containing its mid point).
+ *
+ * Each axis is given by its voxel boundaries (n+1 values for n voxels, ascending or descending),
+ * an axis without boundaries is unbounded, and has a single voxel (e.g. x and y for a vertical distribution).
+ * Equidistant axes locate voxels in O(1), others by a binary search.
+ *
+ * The segments are clipped in parallel. The pieces are accumulated in the order of the segments,
+ * so the result does not depend on the number of threads.
+ */
+class Raster
+{
+public:
+
+    Raster(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z); ///< voxel boundaries per axis
+
+    size_t getNumberOfVoxels() const { return axes[0].n*axes[1].n*axes[2].n; }
+    size_t getNumberOfVoxels(int d) const { return axes[d].n; } ///< number of voxels along the axis d
+    size_t index(size_t i, size_t j, size_t k) const { return (k*axes[1].n+j)*axes[0].n+i; } ///< linear voxel index, x-fastest
+
+    std::vector<double> rasterize(const std::vector<Vector3d>& nodes, const std::vector<Vector2i>& segments,
+        const std::vector<double>& values, bool proportional, bool exact = true, int threads = 0) const; ///< sums the segment values per voxel
+
+    /**
+     * Sums the segment values per voxel, like Raster::rasterize, for segments that are not stored in vectors (e.g. SegmentView)
+     *
+     * @param n         number of segments
+     * @param segment   segment(i, a, b) sets the end points a and b of segment i, it is called once per segment in increasing order of i
+     * @param values    value per segment
+     */
+    template<class Segment>
+    std::vector<double> rasterize(size_t n, const Segment& segment, const std::vector<double>& values, bool proportional,
+        bool exact = true) const {
+        std::vector<double> r(getNumberOfVoxels());
+        std::vector<double> t;
+        std::vector<std::pair<size_t, double>> p;
+        Vector3d a, b;
+        for (size_t i=0; i<n; i++) {
+            segment(i, a, b);
+            p.clear();
+            pieces(a, b, values.at(i), proportional, exact, t, p);
+            for (const auto& pi : p) {
+                r[pi.first] += pi.second;
+            }
+        }
+        return r;
+    }
+
+    int locate(int d, double x) const; ///< voxel index along axis d, or -1 if outside
+    void split(const Vector3d& a, const Vector3d& b, std::vector<std::pair<size_t, double>>& p) const; ///< voxels and length fractions of a segment
+
+protected:
+
+    /* voxel boundaries along one axis, stored ascending */
+    struct Axis {
+        std::vector<double> b; ///< voxel boundaries
+        double sign = 1.; ///< -1 if the boundaries were given descending
+        size_t n = 1; ///< number of voxels
+        bool equidistant = false;
+        double h = 0.; ///< voxel size, if equidistant
+    };
+
+    void setAxis(int d, const std::vector<double>& b);
+    void clip(const Vector3d& a, const Vector3d& b, std::vector<double>& t) const; ///< parameters [0,1] of the boundary crossings, sorted
+    void pieces(const Vector3d& a, const Vector3d& b, double value, bool proportional, bool exact,
+        std::vector<double>& t, std::vector<std::pair<size_t, double>>& p) const; ///< voxel indices and values of the pieces of a segment
+
+    Axis axes[3];
+
+};
+
+} // end namespace CRootBox
+
+#endif
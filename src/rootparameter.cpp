@@ -2,6 +2,7 @@
 #include "rootparameter.h"
 
 #include "Organism.h"
+#include "binaryio.h"
 
 #include <cmath>
 #include <iostream>
@@ -83,9 +84,10 @@ OrganRandomParameter* RootRandomParameter::copy(Organism* p)
  * @copydoc OrganTypeParameter::realize()
  *
  * Creates a specific root from the root type parameters.
+ * @param plant     the plant of the new root
  * @return Specific root parameters derived from the root type parameters
  */
-OrganSpecificParameter* RootRandomParameter::realize()
+OrganSpecificParameter* RootRandomParameter::realize(Organism* plant)
 {
     //& std::cout << "RootTypeParameter::realize(): subType " << subType << "\n" << std::flush;
     double lb_ = std::max(lb + plant->randn()*lbs, 0.); // length of basal zone
@@ -100,7 +102,7 @@ OrganSpecificParameter* RootRandomParameter::realize()
     double a_ = std::max(a + plant->randn()*as, 0.); // radius
     double theta_ = std::max(theta + plant->randn()*thetas, 0.); // initial elongation
     double rlt_ = std::max(rlt + plant->randn()*rlts, 0.); // root life time
-    OrganSpecificParameter* p = new RootSpecificParameter(subType,lb_,la_,ln_,nob_,r_,a_,theta_,rlt_);
+    OrganSpecificParameter* p = new (plant) RootSpecificParameter(subType,lb_,la_,ln_,nob_,r_,a_,theta_,rlt_);
     return p;
 }
 
@@ -108,9 +110,10 @@ OrganSpecificParameter* RootRandomParameter::realize()
  * Choose (dice) lateral type based on root parameters successor and successorP
  *
  * @param pos       spatial position (for coupling to a soil model)
+ * @param plant     the plant of the root, that dices
  * @return          root sub type of the lateral root
  */
-int RootRandomParameter::getLateralType(const Vector3d& pos)
+int RootRandomParameter::getLateralType(const Vector3d& pos, Organism* plant)
 {
     assert(successor.size()==successorP.size()
         && "RootTypeParameter::getLateralType: Successor sub type and probability vector does not have the same size");
@@ -191,6 +194,30 @@ void RootRandomParameter::readXML(tinyxml2::XMLElement* element)
         "RootTypeParameter::readXML: Successor sub type and probability vector does not have the same size" );
 }
 
+/**
+ * @copydoc OrganRandomParameter::writeBinary
+ *
+ * We need to add the parameters that are not in the hashmaps (i.e. a, successor, and successorP)
+ */
+void RootRandomParameter::writeBinary(BinaryWriter& w) const
+{
+    OrganRandomParameter::writeBinary(w);
+    w.write(a);
+    w.write(successor);
+    w.write(successorP);
+}
+
+/**
+ * @copydoc OrganRandomParameter::readBinary
+ */
+void RootRandomParameter::readBinary(BinaryReader& r)
+{
+    OrganRandomParameter::readBinary(r);
+    a = r.read<double>();
+    successor = r.readVector<int>();
+    successorP = r.readVector<double>();
+}
+
 /**
  * @copydoc OrganTypeParameter::writeXML()
  *
@@ -62,14 +62,18 @@ public:
 
     OrganRandomParameter* copy(Organism* plant_) override;
 
-    OrganSpecificParameter* realize() override; ///< Creates a specific root from the root parameter set
-    int getLateralType(const Vector3d& pos); ///< Choose (dice) lateral type based on root parameter set
+    using OrganRandomParameter::realize;
+    OrganSpecificParameter* realize(Organism* plant) override; ///< Creates a specific root from the root parameter set
+    int getLateralType(const Vector3d& pos) { return getLateralType(pos, plant); } ///< Choose (dice) lateral type based on root parameter set
+    int getLateralType(const Vector3d& pos, Organism* plant); ///< Choose (dice) lateral type, using the random numbers of @param plant
     double getK() const { return std::max(nob-1,double(0))*ln+la+lb; }  ///< returns the mean maximal root length [cm]
 
     std::string toString(bool verbose = true) const override; ///< info for debugging
 
     void readXML(tinyxml2::XMLElement* element) override; ///< reads a single sub type organ parameter set
     tinyxml2::XMLElement* writeXML(tinyxml2::XMLDocument& doc, bool comments = true) const override; ///< writes a organ root parameter set
+    void writeBinary(BinaryWriter& w) const override; ///< writes the parameter set exactly
+    void readBinary(BinaryReader& r) override; ///< reads a parameter set written by RootRandomParameter::writeBinary
 
     // DEPRICATED
     void read(std::istream & cin); ///< reads a single root parameter set
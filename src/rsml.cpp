@@ -0,0 +1,479 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "rsml.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <cmath>
+
+namespace CRootBox {
+
+/**
+ * Replaces the predefined entities and character references of @param s
+ */
+static std::string decode(const std::string& s)
+{
+    if (s.find('&')==std::string::npos) {
+        return s;
+    }
+    std::string r;
+    r.reserve(s.size());
+    for (size_t i=0; i<s.size(); i++) {
+        size_t e = s.find(';', i);
+        if ((s[i]!='&') || (e==std::string::npos)) {
+            r += s[i];
+            continue;
+        }
+        std::string name = s.substr(i+1, e-i-1);
+        if (name=="lt") { r += '<';
+        } else if (name=="gt") { r += '>';
+        } else if (name=="amp") { r += '&';
+        } else if (name=="quot") { r += '"';
+        } else if (name=="apos") { r += '\'';
+        } else if ((name.size()>1) && (name[0]=='#')) { // character reference, as UTF-8
+            unsigned long c = (name[1]=='x') ? strtoul(name.c_str()+2, nullptr, 16) : strtoul(name.c_str()+1, nullptr, 10);
+            if (c<0x80) {
+                r += char(c);
+            } else if (c<0x800) {
+                r += char(0xC0|(c>>6)); r += char(0x80|(c&0x3F));
+            } else if (c<0x10000) {
+                r += char(0xE0|(c>>12)); r += char(0x80|((c>>6)&0x3F)); r += char(0x80|(c&0x3F));
+            } else {
+                r += char(0xF0|(c>>18)); r += char(0x80|((c>>12)&0x3F)); r += char(0x80|((c>>6)&0x3F)); r += char(0x80|(c&0x3F));
+            }
+        } else { // unknown entity, keep it
+            r += s.substr(i, e-i+1);
+        }
+        i = e;
+    }
+    return r;
+}
+
+/**
+ * Skips the stream @param sb until (and including) @param end, returns false at the end of the stream
+ */
+static bool skipUntil(std::streambuf* sb, const std::string& end)
+{
+    size_t matched = 0;
+    int c;
+    while ((c = sb->sbumpc())!=EOF) {
+        if (c==end[matched]) {
+            matched++;
+            if (matched==end.size()) {
+                return true;
+            }
+        } else {
+            matched = (c==end[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads the roots of the RSML file @param name (@see RSMLReader::read(std::istream&))
+ */
+void RSMLReader::read(std::string name)
+{
+    std::ifstream fis(name);
+    if (!fis.good()) {
+        std::cout << "RSMLReader::read: could not open file " << name << "\n" << std::flush;
+        throw std::invalid_argument("RSMLReader::read: could not open file " + name);
+    }
+    read(fis);
+}
+
+/**
+ * Reads the roots of a RSML document, tag by tag, and adds their segments to the ones already read.
+ * Throws a std::invalid_argument, if the document is not well formed.
+ *
+ * @param is        input stream
+ */
+void RSMLReader::read(std::istream& is)
+{
+    tags.clear();
+    roots.clear();
+    text.clear();
+    function.clear();
+    property.clear();
+    size_t firstSegment = segments.size();
+    std::streambuf* sb = is.rdbuf();
+    std::string chars; // characters between tags
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    auto error = [&](std::string msg) {
+        std::cout << "RSMLReader::read: " << msg << " (in tag " << (tags.empty() ? "" : tags.back()) << ")\n" << std::flush;
+        throw std::invalid_argument("RSMLReader::read: " + msg);
+    };
+    int c;
+    while ((c = sb->sbumpc())!=EOF) {
+        if (c!='<') {
+            chars += char(c);
+            continue;
+        }
+        if (!chars.empty()) {
+            characters(decode(chars));
+            chars.clear();
+        }
+        c = sb->sbumpc();
+        if (c=='?') { // declaration, or processing instruction
+            if (!skipUntil(sb, "?>")) {
+                error("unexpected end of document");
+            }
+        } else if (c=='!') {
+            std::string s;
+            while ((s.size()<7) && (s!="--") && (sb->sgetc()!=EOF) && (sb->sgetc()!='>')) {
+                s += char(sb->sbumpc());
+            }
+            if (s.compare(0, 2, "--")==0) { // comment
+                if (!skipUntil(sb, "-->")) {
+                    error("unexpected end of document");
+                }
+            } else if (s=="[CDATA[") {
+                std::string cdata;
+                while (cdata.size()<3 || cdata.compare(cdata.size()-3, 3, "]]>")!=0) {
+                    if ((c = sb->sbumpc())==EOF) {
+                        error("unexpected end of document");
+                    }
+                    cdata += char(c);
+                }
+                characters(cdata.substr(0, cdata.size()-3));
+            } else { // doctype, possibly with an internal subset
+                int depth = std::count(s.begin(), s.end(), '[') - std::count(s.begin(), s.end(), ']');
+                while (((c = sb->sbumpc())!=EOF) && ((c!='>') || (depth>0))) {
+                    depth += (c=='[') - (c==']');
+                }
+                if (c==EOF) {
+                    error("unexpected end of document");
+                }
+            }
+        } else if (c=='/') { // end tag
+            name.clear();
+            while (((c = sb->sbumpc())!=EOF) && (c!='>')) {
+                if (!std::isspace(c)) {
+                    name += char(c);
+                }
+            }
+            if (c==EOF) {
+                error("unexpected end of document");
+            }
+            endElement(name);
+        } else { // start tag
+            name.clear();
+            attributes.clear();
+            while ((c!=EOF) && !std::isspace(c) && (c!='/') && (c!='>')) {
+                name += char(c);
+                c = sb->sbumpc();
+            }
+            bool empty = false;
+            while (true) {
+                while ((c!=EOF) && std::isspace(c)) {
+                    c = sb->sbumpc();
+                }
+                if (c==EOF) {
+                    error("unexpected end of document");
+                }
+                if (c=='>') {
+                    break;
+                }
+                if (c=='/') {
+                    if (sb->sbumpc()!='>') {
+                        error("expected '>' after '/' in tag " + name);
+                    }
+                    empty = true;
+                    break;
+                }
+                std::string key;
+                while ((c!=EOF) && !std::isspace(c) && (c!='=') && (c!='>') && (c!='/')) {
+                    key += char(c);
+                    c = sb->sbumpc();
+                }
+                while ((c!=EOF) && std::isspace(c)) {
+                    c = sb->sbumpc();
+                }
+                if (c!='=') {
+                    error("expected '=' after attribute " + key + " in tag " + name);
+                }
+                c = sb->sbumpc();
+                while ((c!=EOF) && std::isspace(c)) {
+                    c = sb->sbumpc();
+                }
+                if ((c!='"') && (c!='\'')) {
+                    error("expected a quoted value of attribute " + key + " in tag " + name);
+                }
+                int quote = c;
+                std::string value;
+                while (((c = sb->sbumpc())!=EOF) && (c!=quote)) {
+                    value += char(c);
+                }
+                attributes.push_back(std::make_pair(key, decode(value)));
+                c = sb->sbumpc();
+            }
+            if (name.empty()) {
+                error("tag without name");
+            }
+            startElement(name, attributes);
+            if (empty) {
+                endElement(name);
+            }
+        }
+    }
+    if (!tags.empty()) {
+        error("unexpected end of document");
+    }
+    // remove connections of laterals, whose parents have no points
+    size_t j = firstSegment;
+    for (size_t i=firstSegment; i<segments.size(); i++) {
+        if (segments[i].x>=0) {
+            segments[j] = segments[i];
+            segCTs[j] = segCTs[i];
+            for (auto& d : data) {
+                d.second[j] = d.second[i];
+            }
+            j++;
+        }
+    }
+    segments.resize(j);
+    segCTs.resize(j);
+    for (auto& d : data) {
+        d.second.resize(j);
+    }
+}
+
+/**
+ * Removes all nodes, segments, and segment data
+ */
+void RSMLReader::clear()
+{
+    nodes.clear();
+    segments.clear();
+    segCTs.clear();
+    names.clear();
+    data.clear();
+    plant = -1;
+}
+
+/**
+ * @return segment data @param name (@see RSMLReader::getDataNames)
+ */
+const std::vector<double>& RSMLReader::getData(std::string name) const
+{
+    auto it = data.find(name);
+    if (it==data.end()) {
+        std::cout << "RSMLReader::getData: unknown segment data " << name << "\n" << std::flush;
+        throw std::invalid_argument("RSMLReader::getData: unknown segment data " + name);
+    }
+    return it->second;
+}
+
+/**
+ * Called for each start tag @param name, with its @param attributes
+ */
+void RSMLReader::startElement(const std::string& name, const std::vector<std::pair<std::string, std::string>>& attributes)
+{
+    auto attribute = [&](const char* key, bool& found) {
+        for (const auto& a : attributes) {
+            if (a.first==key) {
+                found = true;
+                return a.second;
+            }
+        }
+        found = false;
+        return std::string();
+    };
+    bool found;
+    std::string parent = tags.empty() ? "" : tags.back();
+    tags.push_back(name);
+    text.clear();
+    if (name=="plant") {
+        plant++;
+    } else if (name=="root") {
+        OpenRoot r;
+        r.parent = roots.size()-1;
+        r.order = roots.size();
+        std::string id = attribute("ID", found);
+        r.id = toDouble(found ? id : attribute("id", found));
+        roots.push_back(r);
+        if (plant<0) {
+            plant = 0;
+        }
+    } else if ((name=="point") && (parent=="polyline") && !roots.empty()) {
+        Vector3d p;
+        p.x = toDouble(attribute("x", found));
+        p.y = toDouble(attribute("y", found));
+        std::string z = attribute("z", found);
+        p.z = found ? toDouble(z) : 0.; // 2d
+        roots.back().points.push_back(nodes.size());
+        nodes.push_back(p);
+    } else if ((tags.size()>=3) && (parent=="properties") && (tags[tags.size()-3]=="root")) {
+        property = name;
+        std::string v = attribute("value", found);
+        propertyValue = found;
+        if (found) {
+            roots.back().propertyNames.push_back(name);
+            roots.back().propertyValues.push_back(toDouble(v));
+        }
+    } else if ((name=="function") && (parent=="functions") && !roots.empty()) {
+        std::string domain = attribute("domain", found);
+        if (!found || (domain=="polyline")) {
+            function = attribute("name", found);
+            roots.back().functions[function].clear();
+        }
+    } else if ((name=="sample") && (parent=="function") && !function.empty()) {
+        std::string v = attribute("value", found);
+        sampleValue = found;
+        if (found) {
+            roots.back().functions[function].push_back(toDouble(v));
+        }
+    }
+}
+
+/**
+ * Called for each end tag @param name
+ */
+void RSMLReader::endElement(const std::string& name)
+{
+    if (tags.empty() || (tags.back()!=name)) {
+        std::string open = tags.empty() ? "none" : tags.back();
+        std::cout << "RSMLReader::endElement: end tag " << name << " does not match the open tag " << open << "\n" << std::flush;
+        throw std::invalid_argument("RSMLReader::endElement: end tag " + name + " does not match the open tag " + open);
+    }
+    if ((name==property) && (tags.size()>=3) && (tags[tags.size()-2]=="properties")) {
+        if (!propertyValue) { // value as text
+            roots.back().propertyNames.push_back(name);
+            roots.back().propertyValues.push_back(toDouble(text));
+        }
+        property.clear();
+    } else if ((name=="sample") && !function.empty()) {
+        if (!sampleValue) { // value as text
+            roots.back().functions[function].push_back(toDouble(text));
+        }
+    } else if (name=="function") {
+        function.clear();
+    } else if (name=="root") {
+        closeRoot();
+    }
+    tags.pop_back();
+    text.clear();
+}
+
+/**
+ * Called for the characters between tags
+ */
+void RSMLReader::characters(const std::string& s)
+{
+    text += s;
+}
+
+/**
+ * Adds the segments of the innermost open root, and connects its laterals.
+ * A lateral is connected to the point given by its property "parent-node" (index of the parent's polyline point),
+ * or "parentNI" (see Root::parentNI, exact for RSML files written by Organism::writeRSML without skipping points), otherwise to the point of the parent nearest to the lateral's first point. If there are node creation times, only points
+ * that are not younger than the lateral's first point are considered.
+ */
+void RSMLReader::closeRoot()
+{
+    OpenRoot r = std::move(roots.back());
+    roots.pop_back();
+    auto cts = r.functions.find("node_creation_time");
+    bool hasCT = (cts!=r.functions.end()) && (cts->second.size()==r.points.size());
+    auto ct = [&](int k) { return hasCT ? cts->second[k] : 0.; };
+    if (!r.points.empty()) {
+        if (r.parent>=0) { // connection to the parent, resolved when the parent is closed
+            double pn = std::numeric_limits<double>::quiet_NaN();
+            for (size_t i=0; i<r.propertyNames.size(); i++) {
+                if (r.propertyNames[i]=="parent-node") {
+                    pn = r.propertyValues[i];
+                    break;
+                }
+                if (r.propertyNames[i]=="parentNI") { // CRootBox node index, laterals do not write their first node
+                    pn = r.propertyValues[i] - (roots[r.parent].order>0);
+                }
+            }
+            roots[r.parent].lateralSegments.push_back(addSegment(-1, r.points[0], ct(0), r, 0));
+            roots[r.parent].lateralParentNodes.push_back(pn);
+            roots[r.parent].lateralCTs.push_back(hasCT ? ct(0) : std::numeric_limits<double>::quiet_NaN());
+        }
+        for (size_t k=1; k<r.points.size(); k++) {
+            addSegment(r.points[k-1], r.points[k], ct(k), r, k);
+        }
+    }
+    for (size_t l=0; l<r.lateralSegments.size(); l++) {
+        int s = r.lateralSegments[l];
+        double pn = r.lateralParentNodes[l];
+        if (r.points.empty()) {
+            continue; // removed at the end of RSMLReader::read
+        }
+        if (!std::isnan(pn)) { // given by the lateral
+            segments[s].x = r.points[std::min(std::max(int(pn), 0), int(r.points.size())-1)];
+            continue;
+        }
+        // nearest point, that is not younger than the first point of the lateral
+        double lct = r.lateralCTs[l];
+        bool causal = hasCT && !std::isnan(lct) && (cts->second[0]<=lct);
+        const Vector3d& p = nodes[segments[s].y];
+        double minDist = std::numeric_limits<double>::max();
+        for (size_t k=0; k<r.points.size(); k++) {
+            double d = nodes[r.points[k]].minus(p).length();
+            if ((d<minDist) && (!causal || (cts->second[k]<=lct))) {
+                minDist = d;
+                segments[s].x = r.points[k];
+            }
+        }
+    }
+}
+
+/**
+ * Adds the segment (@param a, @param b) with creation time @param ct, and the data of root @param r at its point @param k
+ *
+ * @return the segment index
+ */
+int RSMLReader::addSegment(int a, int b, double ct, const OpenRoot& r, int k)
+{
+    int s = segments.size();
+    segments.push_back(Vector2i(a, b));
+    segCTs.push_back(ct);
+    for (auto& d : data) {
+        d.second.push_back(std::numeric_limits<double>::quiet_NaN());
+    }
+    column("id")[s] = r.id;
+    column("order")[s] = r.order;
+    column("plant")[s] = plant;
+    for (size_t i=0; i<r.propertyNames.size(); i++) {
+        column(r.propertyNames[i])[s] = r.propertyValues[i];
+    }
+    for (const auto& f : r.functions) {
+        if ((f.first!="node_creation_time") && (f.second.size()==r.points.size())) {
+            column(f.first)[s] = f.second[k];
+        }
+    }
+    return s;
+}
+
+/**
+ * @return the segment data @param name, a new column is filled with NaN
+ */
+std::vector<double>& RSMLReader::column(std::string name)
+{
+    auto it = data.find(name);
+    if (it==data.end()) {
+        names.push_back(name);
+        it = data.insert(std::make_pair(name, std::vector<double>(segments.size(), std::numeric_limits<double>::quiet_NaN()))).first;
+    }
+    return it->second;
+}
+
+/**
+ * @return the number in @param s, or NaN
+ */
+double RSMLReader::toDouble(const std::string& s)
+{
+    const char* p = s.c_str();
+    char* end;
+    double v = strtod(p, &end);
+    return (end==p) ? std::numeric_limits<double>::quiet_NaN() : v;
+}
+
+} // namespace CRootBox
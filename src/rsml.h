@@ -0,0 +1,92 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef RSML_H_
+#define RSML_H_
+
+#include "mymath.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <limits>
+#include <istream>
+
+namespace CRootBox {
+
+/**
+ * RSMLReader
+ *
+ * Reads the root geometry of RSML files (e.g. written by Organism::writeRSML) into segments.
+ *
+ * The file is parsed as a stream of tags, without building a document, and only the roots that are still open are held in
+ * memory besides the resulting segments. Each polyline point becomes a node, consecutive points a segment. Laterals
+ * (roots nested in roots) are connected to the point given by their property "parent-node" (or "parentNI"), or, since the branching point is
+ * often not stored, to the parent point nearest to their first point (and not younger, if there are creation times).
+ *
+ * Per segment, the creation time is taken from the function "node_creation_time" at the second node (if present).
+ * The root properties (e.g. "subType"), and the values of the other polyline functions at the second node are available as
+ * named segment data, together with "id" (the root ID), "order" (0 for base roots), and "plant" (index of the plant).
+ * Missing values are NaN. Use SegmentAnalyser(const RSMLReader&) for analysis, the segment data become its user data.
+ */
+class RSMLReader
+{
+public:
+
+    RSMLReader() { }
+    RSMLReader(std::string name) { read(name); } ///< reads the file
+
+    void read(std::string name); ///< reads the roots of a RSML file, and adds their segments
+    void read(std::istream& is); ///< reads the roots of a RSML document, and adds their segments
+    void clear(); ///< removes all segments
+
+    const std::vector<std::string>& getDataNames() const { return names; } ///< names of the segment data
+    const std::vector<double>& getData(std::string name) const; ///< segment data by name
+
+    std::vector<Vector3d> nodes; ///< polyline points
+    std::vector<Vector2i> segments; ///< node indices
+    std::vector<double> segCTs; ///< creation times of the segments
+
+protected:
+
+    /* a root, while its tag is open */
+    struct OpenRoot {
+        int parent = -1; ///< index of the parent in the stack of open roots, or -1
+        int order = 0;
+        double id = std::numeric_limits<double>::quiet_NaN();
+        std::vector<int> points; ///< node indices of the polyline
+        std::vector<std::string> propertyNames;
+        std::vector<double> propertyValues;
+        std::map<std::string, std::vector<double>> functions; ///< per point
+        std::vector<int> lateralSegments; ///< index of the connecting segment of each lateral (its end node is the lateral's first node)
+        std::vector<double> lateralParentNodes; ///< property "parent-node" of each lateral, or NaN
+        std::vector<double> lateralCTs; ///< creation time of the first point of each lateral, or NaN
+    };
+
+    /* tag callbacks of the parser */
+    void startElement(const std::string& name, const std::vector<std::pair<std::string, std::string>>& attributes);
+    void endElement(const std::string& name);
+    void characters(const std::string& text);
+
+    void closeRoot(); ///< adds the segments of the innermost open root
+    int addSegment(int a, int b, double ct, const OpenRoot& r, int pointIndex); ///< adds a segment and its data from the root r, returns its index
+    std::vector<double>& column(std::string name); ///< segment data, a new column is filled with NaN
+
+    static double toDouble(const std::string& s); ///< NaN, if s is not a number
+
+    std::vector<std::string> names;
+    std::map<std::string, std::vector<double>> data; ///< segment data by name
+
+    /* parser state */
+    std::vector<std::string> tags; ///< open tags
+    std::vector<OpenRoot> roots; ///< open roots
+    int plant = -1; ///< index of the current plant
+    std::string text; ///< characters of the innermost tag
+    std::string function; ///< name of the open polyline function, or empty
+    std::string property; ///< name of the open property, or empty
+    bool propertyValue = false; ///< the open property had a value attribute
+    bool sampleValue = false; ///< the open sample had a value attribute
+
+};
+
+} // namespace CRootBox
+
+#endif
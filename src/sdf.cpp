@@ -1,6 +1,9 @@
 // -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
 #include "sdf.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace CRootBox {
 
 std::string SignedDistanceFunction::writePVPScript() const
@@ -10,6 +13,44 @@ std::string SignedDistanceFunction::writePVPScript() const
     return str.str();
 }
 
+/**
+ * Returns the signed distances of many points, overwrite for a faster evaluation
+ *
+ * @param points    spatial positions [cm]
+ * @param d         signed distances [cm] (results)
+ */
+void SignedDistanceFunction::getDists(const std::vector<Vector3d>& points, std::vector<double>& d) const
+{
+    d.resize(points.size());
+    for (size_t i=0; i<points.size(); i++) {
+        d[i] = getDist(points[i]);
+    }
+}
+
+/**
+ * Returns the signed distances of many points
+ *
+ * @param points    spatial positions [cm]
+ * \return          signed distances [cm]
+ */
+std::vector<double> SignedDistanceFunction::getDists(const std::vector<Vector3d>& points) const
+{
+    std::vector<double> d;
+    getDists(points, d);
+    return d;
+}
+
+/**
+ * Appends the function to a program, overwrite to represent the geometry by instructions of SDF_Compiled.
+ * By default the geometry is evaluated by SignedDistanceFunction::getDist.
+ *
+ * @param program   the program
+ */
+void SignedDistanceFunction::compile(SDF_Compiled& program) const
+{
+    program.addFunction(this);
+}
+
 
 
 /**
@@ -18,12 +59,20 @@ std::string SignedDistanceFunction::writePVPScript() const
  * @param v     spatial position [cm]
  * \return      signed distance [cm], a minus sign means inside, plus outside
  */
-double SDF_PlantBox::getDist(const Vector3d& v) const
+double SDF_PlantBox::dist(const Vector3d& v, const Vector3d& dim)
 {
     double z = v.z+dim.z; //  translate
     return -std::min(std::min(std::min(std::min(std::min(dim.z+z,dim.z-z),dim.y+v.y),dim.y-v.y),dim.x+v.x),dim.x-v.x);
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_PlantBox::compile(SDF_Compiled& program) const
+{
+    program.addBox(dim);
+}
+
 /**
  * Writes a ParaView Phython script explicitly representing the implicit geometry
  *
@@ -69,7 +118,7 @@ SDF_PlantContainer::SDF_PlantContainer(double r1_, double r2_, double h_, double
  * @param v     spatial position [cm]
  * \return      signed distance [cm], a minus sign means inside, plus outside
  */
-double SDF_PlantContainer::getDist(const Vector3d& v) const
+double SDF_PlantContainer::dist(const Vector3d& v, double r1, double r2, double h, bool square)
 {
     double z = v.z/h; // 0 .. -1
     double r =  (1+z)*r1 - z*r2;
@@ -82,6 +131,14 @@ double SDF_PlantContainer::getDist(const Vector3d& v) const
     return std::max(d,-std::min(h+v.z,0.-v.z));
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_PlantContainer::compile(SDF_Compiled& program) const
+{
+    program.addContainer(r1, r2, h, square);
+}
+
 /**
  * Writes a ParaView Phython script explicitly representing the implicit geometry
  *
@@ -167,6 +224,16 @@ double SDF_RotateTranslate::getDist(const Vector3d& v) const
     return sdf->getDist(p);
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_RotateTranslate::compile(SDF_Compiled& program) const
+{
+    program.pushTransform(A, pos);
+    sdf->compile(program);
+    program.popTransform();
+}
+
 /**
  * Writes a ParaView Phython script explicitly representing the implicit geometry
  *
@@ -218,6 +285,17 @@ double SDF_Intersection::getDist(const Vector3d& v) const {
     return d;
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_Intersection::compile(SDF_Compiled& program) const
+{
+    for (const auto& sdf : sdfs) {
+        sdf->compile(program);
+    }
+    program.addReduction(SDF_Compiled::op_max, sdfs.size());
+}
+
 /**
  * Writes a ParaView Phython script explicitly representing the implicit geometry
  *
@@ -277,6 +355,17 @@ double SDF_Union::getDist(const Vector3d& v) const
     return d;
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_Union::compile(SDF_Compiled& program) const
+{
+    for (const auto& sdf : sdfs) {
+        sdf->compile(program);
+    }
+    program.addReduction(SDF_Compiled::op_min, sdfs.size());
+}
+
 
 
 /**
@@ -294,12 +383,36 @@ double SDF_Difference::getDist(const Vector3d& v) const
     return d;
 }
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_Difference::compile(SDF_Compiled& program) const
+{
+    sdfs[0]->compile(program);
+    for (size_t i=1; i<sdfs.size(); i++) {
+        sdfs[i]->compile(program);
+        program.addNegation();
+    }
+    program.addReduction(SDF_Compiled::op_max, sdfs.size());
+}
+
+
+
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_Complement::compile(SDF_Compiled& program) const
+{
+    sdf->compile(program);
+    program.addNegation();
+}
+
 
 
 /**
  * Constructor
  */
-SDF_HalfPlane::SDF_HalfPlane(const Vector3d& o, const Vector3d& n_)
+SDF_HalfPlane::SDF_HalfPlane(const Vector3d& o, const Vector3d& n_): o(o)
 {
     n = n_;
     n.normalize();
@@ -320,6 +433,14 @@ SDF_HalfPlane::SDF_HalfPlane(const Vector3d& o, const Vector3d& p1, const Vector
     //	std::cout << "SDF_HalfPlane normal:"<< n.toString() << "\n" ;
 };
 
+/**
+ * @see SignedDistanceFunction::compile
+ */
+void SDF_HalfPlane::compile(SDF_Compiled& program) const
+{
+    program.addHalfPlane(o, n);
+}
+
 /**
  * Writes a ParaView Phython script explicitly representing the half plane,
  * the plane is given only by its normal, two orthogonal vectors are randomly chosen
@@ -347,4 +468,386 @@ int SDF_HalfPlane::writePVPScript(std::ostream & cout, int c) const
     return c;
 }
 
+
+
+/**
+ * Compiles the original geometry again, e.g. after its parameters have changed
+ */
+void SDF_Compiled::recompile()
+{
+    program.clear();
+    boxes.clear();
+    containers.clear();
+    planeOrigins.clear();
+    planeNormals.clear();
+    functions.clear();
+    transforms.clear();
+    transformStack.clear();
+    distances = 0;
+    maxDistances = 0;
+    if (sdf!=nullptr) {
+        sdf->compile(*this);
+    }
+}
+
+/**
+ * Evaluates a leaf instruction at the point @param v
+ */
+inline double SDF_Compiled::leafDist(const Instruction& ins, const Vector3d& v) const
+{
+    Vector3d p = (ins.transform<0) ? v : transforms[ins.transform].apply(v);
+    switch (ins.op) {
+    case op_box:
+        return SDF_PlantBox::dist(p, boxes[ins.index]);
+    case op_container: {
+        const Container& c = containers[ins.index];
+        return SDF_PlantContainer::dist(p, c.r1, c.r2, c.h, c.square);
+    }
+    case op_halfPlane:
+        return planeNormals[ins.index].times(p.minus(planeOrigins[ins.index]));
+    default: // op_function
+        return functions[ins.index]->getDist(p);
+    }
+}
+
+/**
+ * Runs the program for a single point
+ *
+ * @param v     spatial position [cm]
+ * \return      signed distance [cm], a minus sign means inside, plus outside
+ */
+double SDF_Compiled::getDist(const Vector3d& v) const
+{
+    if (program.empty()) {
+        return -1e100;
+    }
+    if (program.size()==1) { // a single leaf
+        return leafDist(program[0], v);
+    }
+    const size_t stackSize = 32;
+    double stack[stackSize]; // distances
+    std::vector<double> heap; // for deep programs
+    double* values = stack;
+    if (maxDistances>stackSize) {
+        heap.resize(maxDistances);
+        values = heap.data();
+    }
+    int nv = -1; // top of the stack
+    for (const auto& ins : program) {
+        if (ins.op<op_max) { // a leaf
+            values[++nv] = leafDist(ins, v);
+        } else {
+            switch (ins.op) {
+            case op_max: {
+                int s = nv-ins.index+1;
+                double d = values[s];
+                for (int i=s+1; i<=nv; i++) {
+                    d = std::max(d, values[i]);
+                }
+                nv = s;
+                values[nv] = d;
+                break;
+            }
+            case op_min: {
+                int s = nv-ins.index+1;
+                double d = values[s];
+                for (int i=s+1; i<=nv; i++) {
+                    d = std::min(d, values[i]);
+                }
+                nv = s;
+                values[nv] = d;
+                break;
+            }
+            case op_neg:
+                values[nv] = -values[nv];
+                break;
+            }
+        }
+    }
+    return values[nv];
+}
+
+/**
+ * Runs the program for many points, instruction by instruction for blocks of points
+ *
+ * @param points    spatial positions [cm]
+ * @param d         signed distances [cm] (results)
+ */
+void SDF_Compiled::getDists(const std::vector<Vector3d>& points, std::vector<double>& d) const
+{
+    size_t n = points.size();
+    d.resize(n);
+    if (program.empty()) {
+        std::fill(d.begin(), d.end(), -1e100);
+        return;
+    }
+    const size_t blockSize = 256; // keeps the stack in the cache
+    std::vector<double> stack(maxDistances*blockSize); // distances, level l starts at l*blockSize
+    std::vector<Vector3d> p(blockSize); // transformed points
+    for (size_t b0=0; b0<n; b0+=blockSize) {
+        size_t m = std::min(blockSize, n-b0);
+        const Vector3d* x = &points[b0];
+        int nv = -1; // top of the stack
+        for (const auto& ins : program) {
+            if (ins.op<op_max) { // a leaf
+                const Vector3d* q = x;
+                if (ins.transform>=0) {
+                    const Transform& t = transforms[ins.transform];
+                    for (size_t i=0; i<m; i++) {
+                        p[i] = t.apply(x[i]);
+                    }
+                    q = p.data();
+                }
+                nv++;
+                double* v = &stack[nv*blockSize];
+                switch (ins.op) {
+                case op_box: {
+                    const Vector3d& dim = boxes[ins.index];
+                    for (size_t i=0; i<m; i++) {
+                        v[i] = SDF_PlantBox::dist(q[i], dim);
+                    }
+                    break;
+                }
+                case op_container: {
+                    const Container& c = containers[ins.index];
+                    for (size_t i=0; i<m; i++) {
+                        v[i] = SDF_PlantContainer::dist(q[i], c.r1, c.r2, c.h, c.square);
+                    }
+                    break;
+                }
+                case op_halfPlane: {
+                    const Vector3d& o = planeOrigins[ins.index];
+                    const Vector3d& nn = planeNormals[ins.index];
+                    for (size_t i=0; i<m; i++) {
+                        v[i] = nn.times(q[i].minus(o));
+                    }
+                    break;
+                }
+                case op_function:
+                    for (size_t i=0; i<m; i++) {
+                        v[i] = functions[ins.index]->getDist(q[i]);
+                    }
+                    break;
+                }
+            } else {
+                switch (ins.op) {
+                case op_max: {
+                    int s = nv-ins.index+1;
+                    double* v = &stack[s*blockSize];
+                    for (int j=s+1; j<=nv; j++) {
+                        const double* w = &stack[j*blockSize];
+                        for (size_t i=0; i<m; i++) {
+                            v[i] = std::max(v[i], w[i]);
+                        }
+                    }
+                    nv = s;
+                    break;
+                }
+                case op_min: {
+                    int s = nv-ins.index+1;
+                    double* v = &stack[s*blockSize];
+                    for (int j=s+1; j<=nv; j++) {
+                        const double* w = &stack[j*blockSize];
+                        for (size_t i=0; i<m; i++) {
+                            v[i] = std::min(v[i], w[i]);
+                        }
+                    }
+                    nv = s;
+                    break;
+                }
+                case op_neg: {
+                    double* v = &stack[nv*blockSize];
+                    for (size_t i=0; i<m; i++) {
+                        v[i] = -v[i];
+                    }
+                    break;
+                }
+                }
+            }
+        }
+        std::copy(&stack[nv*blockSize], &stack[nv*blockSize]+m, &d[b0]);
+    }
+}
+
+/**
+ * Appends the program of the original geometry
+ */
+void SDF_Compiled::compile(SDF_Compiled& program) const
+{
+    if (sdf!=nullptr) {
+        sdf->compile(program);
+    } else {
+        program.addFunction(this);
+    }
+}
+
+void SDF_Compiled::add(int op, int index)
+{
+    int t = -1;
+    switch (op) {
+    case op_max:
+    case op_min:
+        distances -= index-1;
+        break;
+    case op_neg:
+        break;
+    default: // a leaf
+        distances++;
+        if (!transformStack.empty()) {
+            t = transformStack.back();
+        }
+    }
+    maxDistances = std::max(maxDistances, distances);
+    program.push_back({ op, index, t });
+}
+
+void SDF_Compiled::addBox(const Vector3d& dim)
+{
+    add(op_box, boxes.size());
+    boxes.push_back(dim);
+}
+
+void SDF_Compiled::addContainer(double r1, double r2, double h, bool square)
+{
+    add(op_container, containers.size());
+    containers.push_back({ r1, r2, h, square });
+}
+
+void SDF_Compiled::addHalfPlane(const Vector3d& o, const Vector3d& n)
+{
+    add(op_halfPlane, planeOrigins.size());
+    planeOrigins.push_back(o);
+    planeNormals.push_back(n);
+}
+
+void SDF_Compiled::addFunction(const SignedDistanceFunction* f)
+{
+    add(op_function, functions.size());
+    functions.push_back(f);
+}
+
+/**
+ * Multiplies the transformation p = A(v-pos) with the current transformation
+ *
+ * @param A         rotation matrix
+ * @param pos       translation
+ */
+void SDF_Compiled::pushTransform(const Matrix3d& A, const Vector3d& pos)
+{
+    Transform t;
+    if (transformStack.empty()) { // A*v-A*pos
+        t.M = A;
+        t.c = A.times(pos).times(-1.);
+    } else { // A*(M*v+c-pos)
+        const Transform& current = transforms[transformStack.back()];
+        t.M = A;
+        t.M.times(current.M);
+        t.c = A.times(current.c.minus(pos));
+    }
+    transformStack.push_back(transforms.size());
+    transforms.push_back(t);
+}
+
+/**
+ * Constructor, samples the geometry
+ *
+ * @param sdf           original geometry
+ * @param min           lower corner of the sampled box [cm]
+ * @param max           upper corner of the sampled box [cm]
+ * @param resolution    grid spacing [cm]
+ * @param band          width of the band on both sides of the surface [cm]
+ * @param maxBytes      memory budget of the samples [bytes]
+ */
+SDF_Cached::SDF_Cached(const SignedDistanceFunction* sdf, const Vector3d& min, const Vector3d& max, double resolution,
+    double band, size_t maxBytes) :sdf(sdf), min(min), h(resolution), band(band), maxBytes(maxBytes)
+{
+    if ((sdf==nullptr) || !(resolution>0) || !(band>0) || !(max.x>min.x) || !(max.y>min.y) || !(max.z>min.z)) {
+        std::cout << "SDF_Cached::SDF_Cached: invalid geometry, box, resolution, or band\n" << std::flush;
+        throw std::invalid_argument("SDF_Cached::SDF_Cached: invalid geometry, box, resolution, or band");
+    }
+    Vector3d d = max.minus(min);
+    n[0] = std::ceil(d.x/h);
+    n[1] = std::ceil(d.y/h);
+    n[2] = std::ceil(d.z/h);
+    for (int i=0; i<3; i++) {
+        nb[i] = (n[i]+brickSize-1)/brickSize;
+    }
+    rebuild();
+}
+
+/**
+ * Samples the original geometry at the nodes of all bricks within the band
+ */
+void SDF_Cached::rebuild()
+{
+    bricks.assign(nb[0]*nb[1]*nb[2], -1);
+    samples.clear();
+    complete = true;
+    double bs = brickSize*h;
+    double r = 0.5*std::sqrt(3.)*bs; // half diagonal of a brick
+    std::vector<Vector3d> nodes(nodesPerBrick);
+    std::vector<double> dist;
+    for (int k=0; k<nb[2]; k++) {
+        for (int j=0; j<nb[1]; j++) {
+            for (int i=0; i<nb[0]; i++) {
+                Vector3d o = min.plus(Vector3d(i*bs, j*bs, k*bs));
+                if (std::abs(sdf->getDist(o.plus(Vector3d(bs/2., bs/2., bs/2.))))>r+band) { // the brick is outside of the band
+                    continue;
+                }
+                if ((samples.size()+nodesPerBrick)*sizeof(double)>maxBytes) {
+                    complete = false;
+                    return;
+                }
+                int c = 0;
+                for (int kk=0; kk<=brickSize; kk++) {
+                    for (int jj=0; jj<=brickSize; jj++) {
+                        for (int ii=0; ii<=brickSize; ii++) {
+                            nodes[c++] = o.plus(Vector3d(ii*h, jj*h, kk*h));
+                        }
+                    }
+                }
+                sdf->getDists(nodes, dist); // all nodes of the brick in one call
+                bricks[(k*nb[1]+j)*nb[0]+i] = samples.size();
+                samples.insert(samples.end(), dist.begin(), dist.end());
+            }
+        }
+    }
+}
+
+/**
+ * Interpolates the sampled distance within the band, and evaluates the original geometry elsewhere
+ *
+ * @param v     spatial position [cm]
+ * \return      signed distance [cm]
+ */
+double SDF_Cached::getDist(const Vector3d& v) const
+{
+    double x[3] = { (v.x-min.x)/h, (v.y-min.y)/h, (v.z-min.z)/h }; // in cells
+    int c[3];
+    double t[3];
+    for (int i=0; i<3; i++) {
+        if (!(x[i]>=0) || !(x[i]<n[i])) { // outside of the box (including nan)
+            return sdf->getDist(v);
+        }
+        c[i] = int(x[i]);
+        t[i] = x[i]-c[i];
+    }
+    int b = bricks[((c[2]/brickSize)*nb[1]+c[1]/brickSize)*nb[0]+c[0]/brickSize];
+    if (b<0) {
+        return sdf->getDist(v);
+    }
+    const int s1 = brickSize+1, s2 = s1*s1;
+    const double* p = &samples[b+((c[2]%brickSize)*s1+c[1]%brickSize)*s1+c[0]%brickSize];
+    double c00 = p[0]*(1.-t[0])+p[1]*t[0];
+    double c10 = p[s1]*(1.-t[0])+p[s1+1]*t[0];
+    double c01 = p[s2]*(1.-t[0])+p[s2+1]*t[0];
+    double c11 = p[s2+s1]*(1.-t[0])+p[s2+s1+1]*t[0];
+    double d = (c00*(1.-t[1])+c10*t[1])*(1.-t[2])+(c01*(1.-t[1])+c11*t[1])*t[2];
+    if (std::abs(d)<band) {
+        return d;
+    } else {
+        return sdf->getDist(v);
+    }
+}
+
 } // end namespace CRootBox
@@ -10,6 +10,8 @@
 
 namespace CRootBox {
 
+class SDF_Compiled;
+
 /**
  * Signed Distance Function (minus is inside, plus is outside)
  *
@@ -32,6 +34,11 @@ public:
      */
     virtual double getDist(const Vector3d& v) const { return -1e100; } ///< Returns the signed distance to the next boundary
 
+    virtual void getDists(const std::vector<Vector3d>& points, std::vector<double>& d) const; ///< signed distances of many points
+    std::vector<double> getDists(const std::vector<Vector3d>& points) const; ///< signed distances of many points
+
+    virtual void compile(SDF_Compiled& program) const; ///< appends the function to a flat program (@see SDF_Compiled)
+
     /**
      * Returns a string representation of the object (for debugging)
      */
@@ -84,7 +91,10 @@ public:
      */
     SDF_PlantBox(double x, double y, double z) { dim = Vector3d(x/2.,y/2.,z/2.); } ///< creates a rectangular box
 
-    virtual double getDist(const Vector3d& v) const override; ///< @see SignedDistanceFunction::getDist
+    virtual double getDist(const Vector3d& v) const override { return dist(v, dim); } ///< @see SignedDistanceFunction::getDist
+    static double dist(const Vector3d& v, const Vector3d& dim); ///< signed distance to a box with half dimensions dim
+
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
 
     virtual std::string toString() const override { return "SDF_PlantBox"; } ///< @see SignedDistanceFunction::toString
 
@@ -107,7 +117,10 @@ public:
     SDF_PlantContainer() { r1=5; r2=5; h=100; square = false; } ///< Default is a cylindrical rhizotron with radius 10 cm and 100 cm depth
     SDF_PlantContainer(double r1_, double r2_, double h_, double sq=false); ///< Creates a cylindrical or square container
 
-    virtual double getDist(const Vector3d& v) const override; ///< @see SignedDistanceFunction::getDist
+    virtual double getDist(const Vector3d& v) const override { return dist(v, r1, r2, h, square); } ///< @see SignedDistanceFunction::getDist
+    static double dist(const Vector3d& v, double r1, double r2, double h, bool square); ///< signed distance to a container
+
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
 
     virtual std::string toString() const override { return "SDF_PlantContainer"; } ///< @see SignedDistanceFunction::toString
 
@@ -137,6 +150,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override; ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual std::string toString() const override { return "SDF_RotateTranslate"; } ///< @see SignedDistanceFunction::toString
 
     virtual int writePVPScript(std::ostream & cout, int c=1)  const override; ///< @see SignedDistanceFunction::writePVPScript
@@ -165,6 +180,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override;  ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual std::string toString() const override { return "SDF_Intersection"; } ///< @see SignedDistanceFunction::toString
 
     virtual int writePVPScript(std::ostream & cout, int c=1) const override; ///< @see SignedDistanceFunction::writePVPScript
@@ -187,6 +204,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override;  ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual std::string toString() const override { return "SDF_Union"; } ///< @see SignedDistanceFunction::toString
 };
 
@@ -204,6 +223,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override;  ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual std::string toString() const override { return "SDF_Difference"; } ///< @see SignedDistanceFunction::toString
 };
 
@@ -220,6 +241,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override { return -sdf->getDist(v); } ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual int writePVPScript(std::ostream & cout, int c=1) const override { return sdf->writePVPScript(cout,c); } ///< same as original geometry
 
     virtual std::string toString() const override { return "SDF_Complement"; } ///< @see SignedDistanceFunction::toString
@@ -242,6 +265,8 @@ public:
 
     virtual double getDist(const Vector3d& v) const override { return n.times(v.minus(o)); } ///< @see SignedDistanceFunction::getDist
 
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
     virtual int writePVPScript(std::ostream & cout, int c=1) const override; ///< @see SignedDistanceFunction::writePVPScript
 
     virtual std::string toString() const override { return "SDF_HalfPlane"; } ///< @see SignedDistanceFunction::toString
@@ -253,6 +278,144 @@ public:
 
 };
 
+
+
+/**
+ * SDF_Compiled flattens the expression tree of a composite geometry (e.g. SDF_Union of SDF_RotateTranslate)
+ * into a linear program of leaf geometries and boolean operations, that is evaluated without virtual calls.
+ *
+ * Nested rotations and translations are multiplied into a single affine transformation per leaf at compile time.
+ * Boolean operations reduce the distances of their children on a small stack, in the original order.
+ * Geometries that are not known to the compiler (e.g. SDF_RootSystem) are called through SignedDistanceFunction::getDist.
+ *
+ * The program represents the parameters at compile time, call SDF_Compiled::recompile after changing the original geometry.
+ * SDF_Compiled::getDists evaluates the program instruction by instruction for all points at once.
+ */
+class SDF_Compiled : public SignedDistanceFunction
+{
+
+public:
+
+    enum Opcodes { op_box = 0, op_container, op_halfPlane, op_function, op_max, op_min, op_neg }; ///< instructions
+
+    SDF_Compiled() { } ///< empty program, i.e. unconstrained
+    SDF_Compiled(const SignedDistanceFunction* sdf) : sdf(sdf) { recompile(); } ///< compiles the geometry @param sdf
+
+    void recompile(); ///< compiles the original geometry again
+
+    virtual double getDist(const Vector3d& v) const override; ///< @see SignedDistanceFunction::getDist
+    using SignedDistanceFunction::getDists;
+    virtual void getDists(const std::vector<Vector3d>& points, std::vector<double>& d) const override; ///< @see SignedDistanceFunction::getDists
+
+    virtual void compile(SDF_Compiled& program) const override; ///< @see SignedDistanceFunction::compile
+
+    virtual int writePVPScript(std::ostream & cout, int c=1) const override { return (sdf!=nullptr) ? sdf->writePVPScript(cout,c) : c; } ///< same as original geometry
+
+    virtual std::string toString() const override { return "SDF_Compiled"; } ///< @see SignedDistanceFunction::toString
+
+    int getNumberOfInstructions() const { return program.size(); } ///< length of the program
+
+    /* used by SignedDistanceFunction::compile */
+    void addBox(const Vector3d& dim); ///< SDF_PlantBox
+    void addContainer(double r1, double r2, double h, bool square); ///< SDF_PlantContainer
+    void addHalfPlane(const Vector3d& o, const Vector3d& n); ///< SDF_HalfPlane
+    void addFunction(const SignedDistanceFunction* f); ///< any geometry, evaluated by SignedDistanceFunction::getDist
+    void pushTransform(const Matrix3d& A, const Vector3d& pos); ///< following leaves are evaluated at A(v-pos)
+    void popTransform() { transformStack.pop_back(); } ///< ends the last transformation
+    void addReduction(int op, int n) { add(op, n); } ///< reduces the last n distances by SDF_Compiled::op_max or SDF_Compiled::op_min
+    void addNegation() { add(op_neg, 0); } ///< negates the last distance
+
+protected:
+
+    struct Instruction {
+        int op; ///< opcode
+        int index; ///< index of the leaf parameters, or number of distances to reduce
+        int transform; ///< index of the affine transformation of a leaf, or -1
+    };
+
+    struct Container {
+        double r1, r2, h;
+        bool square;
+    };
+
+    struct Transform { ///< affine transformation M*v+c
+        Matrix3d M;
+        Vector3d c;
+        Vector3d apply(const Vector3d& v) const { return M.times(v).plus(c); }
+    };
+
+    void add(int op, int index); ///< appends an instruction, and tracks the stack size
+    double leafDist(const Instruction& ins, const Vector3d& v) const; ///< evaluates a leaf instruction
+
+    const SignedDistanceFunction* sdf = nullptr; ///< the original geometry
+    std::vector<Instruction> program;
+    std::vector<Vector3d> boxes; ///< half dimensions of the boxes
+    std::vector<Container> containers;
+    std::vector<Vector3d> planeOrigins;
+    std::vector<Vector3d> planeNormals;
+    std::vector<const SignedDistanceFunction*> functions; ///< geometries evaluated by virtual call
+    std::vector<Transform> transforms;
+
+    std::vector<int> transformStack; ///< current transformations while compiling
+    size_t distances = 0; ///< size of the distance stack while compiling
+    size_t maxDistances = 0; ///< maximal size of the distance stack
+
+};
+
+
+
+/**
+ * SDF_Cached samples an expensive geometry (e.g. a SDF_Difference with many rhizotubes, or a SDF_RootSystem) on a sparse
+ * grid in a narrow band around its surface, and interpolates trilinearly within the band. Outside of the band or the
+ * bounding box, the original geometry is evaluated.
+ *
+ * The grid consists of bricks of SDF_Cached::brickSize^3 cells, only bricks within the band are stored. A brick is skipped,
+ * if the distance at its center exceeds its half diagonal plus the band width (assuming the geometry does not overestimate
+ * the distance). If the memory budget is exceeded, the remaining bricks are not stored (@see SDF_Cached::isComplete).
+ *
+ * Interpolated distances are accurate up to the order of the resolution (exact for planar surfaces), choose the resolution
+ * smaller than the features of the geometry. Call SDF_Cached::rebuild after changing the original geometry.
+ */
+class SDF_Cached : public SignedDistanceFunction
+{
+
+public:
+
+    static const int brickSize = 8; ///< cells per brick and axis
+
+    SDF_Cached(const SignedDistanceFunction* sdf, const Vector3d& min, const Vector3d& max, double resolution = 0.1,
+        double band = 0.5, size_t maxBytes = 256*1024*1024);
+
+    void rebuild(); ///< samples the original geometry again
+
+    virtual double getDist(const Vector3d& v) const override; ///< @see SignedDistanceFunction::getDist
+
+    virtual int writePVPScript(std::ostream & cout, int c=1) const override { return sdf->writePVPScript(cout,c); } ///< same as original geometry
+
+    virtual std::string toString() const override { return "SDF_Cached"; } ///< @see SignedDistanceFunction::toString
+
+    int getNumberOfBricks() const { return samples.size()/nodesPerBrick; } ///< number of stored bricks
+    size_t getMemory() const { return samples.size()*sizeof(double); } ///< memory of the samples [bytes]
+    bool isComplete() const { return complete; } ///< false, if bricks were dropped because the memory budget was exceeded
+
+protected:
+
+    static const int nodesPerBrick = (brickSize+1)*(brickSize+1)*(brickSize+1);
+
+    const SignedDistanceFunction* sdf; ///< the original geometry
+    Vector3d min; ///< lower corner of the bounding box [cm]
+    double h; ///< resolution [cm]
+    double band; ///< width of the band around the surface [cm]
+    size_t maxBytes; ///< memory budget of the samples [bytes]
+    int n[3]; ///< number of cells per axis
+    int nb[3]; ///< number of bricks per axis
+    bool complete = true;
+
+    std::vector<int> bricks; ///< first sample of each brick (x-fastest), or -1 if the brick is not stored
+    std::vector<double> samples; ///< signed distances at the brick nodes (x-fastest per brick)
+
+};
+
 } // end namespace CRootBox
 
 #endif
@@ -0,0 +1,258 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "sdf_rs.h"
+
+#include "Root.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace CRootBox {
+
+/**
+ * Constructors
+ */
+SDF_RootSystem::SDF_RootSystem(const Root& r, double dx): dx_(dx) {
+  size_t n = r.getNumberOfNodes();
+  nodes_.resize(n);
+  segments_.resize(n-1);
+  radii_.resize(n-1);
+  for (size_t i=0; i<n; i++) {
+      nodes_[i] = r.getNode(i);
+  }
+  for (size_t i=1; i<n; i++) {
+      segments_[i-1] = Vector2i(i-1,i);
+      radii_[i-1] = r.param()->a;
+  }
+  buildTree();
+}
+
+SDF_RootSystem::SDF_RootSystem(const Organism& plant, double dx): dx_(dx) {
+    build(plant);
+}
+
+SDF_RootSystem::SDF_RootSystem(std::vector<Vector3d> nodes, const std::vector<Vector2i> segments, const std::vector<double> radii, double dx)
+    :nodes_(nodes), segments_(segments), radii_(radii), dx_(dx) {
+    buildTree();
+}
+
+/**
+ * Puts all segments into the tree, and sets up the node to segment incidences
+ */
+void SDF_RootSystem::buildTree() {
+    tree.removeAll();
+    segmentEnd_.assign(nodes_.size(), -1);
+    segmentStart_.assign(nodes_.size(), -1);
+    nextStart_.assign(segments_.size(), -1);
+    std::vector<double> lower, upper;
+    for (size_t c=0; c<segments_.size(); c++) { // fill the tree
+        const auto& s = segments_[c];
+        segmentEnd_[s.y] = c;
+        nextStart_[c] = segmentStart_[s.x];
+        segmentStart_[s.x] = c;
+        getBounds(c, lower, upper);
+        tree.insertParticle(c, lower, upper);
+    }
+}
+
+/**
+ * Copies the segments of the organism from its node store, and builds the tree
+ */
+void SDF_RootSystem::build(const Organism& plant) {
+    const NodeStore& store = plant.getNodeStore();
+    int n = store.size();
+    nodes_.resize(n);
+    segments_.clear();
+    radii_.clear();
+    for (int i=0; i<n; i++) {
+        nodes_[i] = store.getNode(i);
+        int p = store.getPrev(i);
+        if ((p>=0) && (store.getOrgan(i)!=nullptr)) {
+            segments_.push_back(Vector2i(p,i));
+            radii_.push_back(store.getOrgan(i)->getParameter(Organ::pi_radius));
+        }
+    }
+    buildTree();
+    shrinks_ = store.getShrinks().size();
+}
+
+/**
+ * Updates the index after a simulation step: moved nodes are updated, and the new segments are inserted.
+ * If the index is out of sync (e.g. update was not called after each step, or RootSystem::pop was called),
+ * it is built from scratch.
+ *
+ * @param plant     the organism, the index was built from
+ */
+void SDF_RootSystem::update(const Organism& plant) {
+    const NodeStore& store = plant.getNodeStore();
+    int n = store.size();
+    int old = n - plant.getNumberOfNewNodes(); // number of nodes before the last step
+    const auto& shrinks = store.getShrinks();
+    bool valid = (old==(int)nodes_.size()) && (segmentEnd_.size()==nodes_.size());
+    for (size_t i=shrinks_; i<shrinks.size(); i++) { // nodes of the index were overwritten
+        valid = valid && (shrinks[i]>=(int)nodes_.size());
+    }
+    if (!valid) {
+        build(plant);
+        return;
+    }
+    shrinks_ = shrinks.size();
+    auto ni = plant.getUpdatedNodeIndices(); // moved nodes
+    for (int i : ni) {
+        nodes_[i] = store.getNode(i);
+    }
+    for (int i : ni) {
+        if (segmentEnd_[i]>=0) {
+            updateSegment(segmentEnd_[i]);
+        }
+        for (int s = segmentStart_[i]; s>=0; s = nextStart_[s]) {
+            updateSegment(s);
+        }
+    }
+    nodes_.resize(n); // new nodes
+    segmentEnd_.resize(n, -1);
+    segmentStart_.resize(n, -1);
+    for (int i=old; i<n; i++) {
+        nodes_[i] = store.getNode(i);
+    }
+    for (int i=old; i<n; i++) { // new segments (@see Organism::getNewSegments)
+        int p = store.getPrev(i);
+        if ((p>=0) && (store.getOrgan(i)!=nullptr)) {
+            addSegment(Vector2i(p,i), store.getOrgan(i)->getParameter(Organ::pi_radius));
+        }
+    }
+}
+
+/**
+ * Appends the segment @param s with radius @param radius and inserts it into the tree
+ */
+void SDF_RootSystem::addSegment(const Vector2i& s, double radius) {
+    int c = segments_.size();
+    segments_.push_back(s);
+    radii_.push_back(radius);
+    segmentEnd_[s.y] = c;
+    nextStart_.push_back(segmentStart_[s.x]);
+    segmentStart_[s.x] = c;
+    std::vector<double> lower, upper;
+    getBounds(c, lower, upper);
+    tree.insertParticle(c, lower, upper);
+}
+
+/**
+ * Updates the bounding box of segment @param i in the tree, after one of its nodes moved
+ */
+void SDF_RootSystem::updateSegment(int i) {
+    std::vector<double> lower, upper;
+    getBounds(i, lower, upper);
+    tree.updateParticle(i, lower, upper);
+}
+
+/**
+ * Bounding box of segment @param i, enlarged by its radius
+ */
+void SDF_RootSystem::getBounds(int i, std::vector<double>& lower, std::vector<double>& upper) const {
+    const Vector3d& x1 = nodes_[segments_[i].x];
+    const Vector3d& x2 = nodes_[segments_[i].y];
+    double r = std::max(radii_[i], 0.);
+    lower = { std::min(x1.x, x2.x)-r, std::min(x1.y, x2.y)-r, std::min(x1.z, x2.z)-r };
+    upper = { std::max(x1.x, x2.x)+r, std::max(x1.y, x2.y)+r, std::max(x1.z, x2.z)+r };
+}
+
+/**
+ * Segments with bounding boxes overlapping the cube [p-r, p+r]
+ */
+std::vector<unsigned int> SDF_RootSystem::query(const Vector3d& p, double r) const {
+    r = std::max(r, 0.);
+    std::vector<double> a = { p.x-r, p.y-r, p.z-r };
+    std::vector<double> b = { p.x+r, p.y+r, p.z+r };
+    aabb::AABB box = aabb::AABB(a,b);
+    return tree.query(box);
+}
+
+/**
+ * Distance between the point @param p and the surface of segment @param i (negative inside the segment)
+ */
+double SDF_RootSystem::getSegmentDist(const Vector3d& p, int i) const {
+    Vector3d x1 = nodes_[segments_[i].x];
+    Vector3d x2 = nodes_[segments_[i].y];
+    Vector3d v = x2.minus(x1);
+    Vector3d w = p.minus(x1);
+
+    double c1 = v.times(w);
+    double c2 = v.times(v);
+
+    double l;
+    if (c1<=0) {
+        l = w.length();
+    } else if (c1>=c2) {
+        l = p.minus(x2).length();
+    } else {
+        l = p.minus(x1.plus(v.times(c1/c2))).length();
+    }
+    return l - radii_[i];
+}
+
+/**
+ * Signed distance to the closest segment within the observation radius dx (-1e100 if there is none)
+ */
+double SDF_RootSystem::getDist(const Vector3d& p) const {
+    double mdist = 1e100; // far far away
+    auto indices = query(p, dx_);
+    // std::cout << indices.size() << " segments in range\n";
+    for (int i : indices) {
+        double l = getSegmentDist(p, i);
+        if (l < mdist) {
+            mdist = l;
+        }
+    }
+    return -mdist;
+}
+
+/**
+ * Segments with a surface distance to @param p of at most @param r, ordered by the segment index
+ */
+std::vector<int> SDF_RootSystem::getSegmentsInRadius(const Vector3d& p, double r) const {
+    std::vector<int> seg;
+    auto indices = query(p, r);
+    for (int i : indices) {
+        if (getSegmentDist(p, i)<=r) {
+            seg.push_back(i);
+        }
+    }
+    std::sort(seg.begin(), seg.end());
+    return seg;
+}
+
+/**
+ * The @param k segments with the smallest surface distance to @param p, ordered by distance.
+ * The search cube starts with the observation radius, and is doubled until the k-th segment is found within the cube.
+ */
+std::vector<int> SDF_RootSystem::getNearestSegments(const Vector3d& p, int k) const {
+    k = std::min(k, (int)segments_.size());
+    std::vector<int> seg;
+    if (k<=0) {
+        return seg;
+    }
+    double r = (dx_>0) ? dx_ : 1.;
+    std::vector<std::pair<double, int>> candidates;
+    while (true) {
+        auto indices = query(p, r);
+        bool all = (indices.size()==segments_.size());
+        if (((int)indices.size()>=k) || all) {
+            candidates.clear();
+            for (int i : indices) {
+                candidates.push_back(std::make_pair(getSegmentDist(p, i), i));
+            }
+            std::partial_sort(candidates.begin(), candidates.begin()+k, candidates.end());
+            if ((candidates[k-1].first<=r) || all) { // segments closer than r overlap the cube
+                break;
+            }
+        }
+        r *= 2.;
+    }
+    for (int i=0; i<k; i++) {
+        seg.push_back(candidates[i].second);
+    }
+    return seg;
+}
+
+} // namespace
@@ -11,17 +11,24 @@
 #include "sdf.h"
 #include "Organism.h"
 #include "mymath.h"
-#include "analysis.h"
 
 namespace CRootBox {
 
+class Root;
+
 /**
- * Distance to a static root system
+ * Distance to a root system
  *
  * segment, nodes, and radii are copied,
- * segment centers are put into a aabb tree, for fast distance lookup
+ * the bounding boxes of the segments (enlarged by their radii) are put into a aabb tree, for fast distance lookup
  *
  * dx is the rectangular observation radius
+ *
+ * An index built from an organism is kept up to date by SDF_RootSystem::update after each time step,
+ * new segments are inserted and moved nodes are updated, instead of rebuilding the tree.
+ *
+ * Queries (getDist, getSegmentsInRadius, getNearestSegments) are const and can run concurrently from many threads,
+ * SDF_RootSystem::update must not run at the same time.
  */
 class SDF_RootSystem : public SignedDistanceFunction
 {
@@ -33,8 +40,14 @@ public:
 
     SDF_RootSystem(std::vector<Vector3d> nodes, const std::vector<Vector2i> segments, std::vector<double> radii, double dx = 0.5);
 
+    void update(const Organism& plant); ///< adds the new segments and moved nodes of the last time step
+
     virtual double getDist(const Vector3d& p) const override;
 
+    std::vector<int> getSegmentsInRadius(const Vector3d& p, double r) const; ///< segments with a surface distance below r
+    std::vector<int> getNearestSegments(const Vector3d& p, int k) const; ///< the k segments with the smallest surface distance
+    double getSegmentDist(const Vector3d& p, int i) const; ///< distance between p and the surface of segment i
+
     virtual std::string toString() const override { return "SDF_RootSystem"; }
 
     std::vector<Vector3d> nodes_;
@@ -45,92 +58,23 @@ public:
 protected:
 
     void buildTree();
+    void build(const Organism& plant); ///< copies all segments of the organism, and builds the tree
+    void addSegment(const Vector2i& s, double radius); ///< appends a segment, and inserts it into the tree
+    void updateSegment(int i); ///< updates the bounding box of segment i
+    void getBounds(int i, std::vector<double>& lower, std::vector<double>& upper) const; ///< bounding box of segment i
+    std::vector<unsigned int> query(const Vector3d& p, double r) const; ///< segments with bounding boxes overlapping the cube [p-r,p+r]
 
-    mutable aabb::Tree tree = aabb::Tree();
+    mutable aabb::Tree tree = aabb::Tree(); // aabb::Tree::query does not modify the tree, but is not declared const
 
-};
+    /* node to segment incidences, for moved nodes */
+    std::vector<int> segmentEnd_; ///< index of the segment ending in a node, or -1
+    std::vector<int> segmentStart_; ///< index of the first segment starting in a node, or -1
+    std::vector<int> nextStart_; ///< index of the next segment starting in the same node, or -1
 
+    size_t shrinks_ = 0; ///< number of node store shrinks of the organism at the last update (@see NodeStore::getShrinks)
 
-
-/**
- * Constructors
- */
-SDF_RootSystem::SDF_RootSystem(const Root& r, double dx): dx_(dx) {
-  size_t n = r.getNumberOfNodes();
-  nodes_.resize(n);
-  segments_.resize(n-1);
-  radii_.resize(n-1);
-  for (size_t i=0; i<n; i++) {
-      nodes_[i] = r.getNode(i);
-  }
-  for (size_t i=1; i<n; i++) {
-      segments_[i-1] = Vector2i(i-1,i);
-      radii_[i-1] = r.param()->a;
-  }
-  buildTree();
-}
-
-SDF_RootSystem::SDF_RootSystem(const Organism& plant, double dx): dx_(dx) {
-    auto ana = SegmentAnalyser(plant);
-    nodes_ = ana.nodes;
-    segments_ = ana.segments;
-    radii_ = ana.getParameter("radius");
-    buildTree();
-}
-
-SDF_RootSystem::SDF_RootSystem(std::vector<Vector3d> nodes, const std::vector<Vector2i> segments, const std::vector<double> radii, double dx)
-    :nodes_(nodes), segments_(segments), radii_(radii), dx_(dx) {
-    buildTree();
-}
-
-void SDF_RootSystem::buildTree() {
-    size_t c = 0;
-    for (const auto& s : segments_) { // fill the tree
-        Vector3d mid = nodes_[s.x].plus(nodes_[s.y]).times(0.5);
-        std::vector<double> d = { mid.x, mid.y, mid.z };
-        tree.insertParticle(c, d, radii_[c]);
-        c++;
-    }
-}
-
-
-double SDF_RootSystem::getDist(const Vector3d& p) const {
-
-    std::vector<double> a = { p.x-dx_, p.y-dx_, p.z-dx_ };
-    std::vector<double> b = { p.x+dx_, p.y+dx_, p.z+dx_ };
-    aabb::AABB box = aabb::AABB(a,b);
-    double mdist = 1e100; // far far away
-    auto indices = tree.query(box);
-    // std::cout << indices.size() << " segments in range\n";
-    for (int i : indices) {
-
-        Vector3d x1 = nodes_[segments_[i].x];
-        Vector3d x2 = nodes_[segments_[i].y];
-        Vector3d v = x2.minus(x1);
-        Vector3d w = p.minus(x1);
-
-        double c1 = v.times(w);
-        double c2 = v.times(v);
-
-        double l;
-        if (c1<=0) {
-            l = w.length();
-        } else if (c1>=c2) {
-            l = p.minus(x2).length();
-        } else {
-            l = p.minus(x1.plus(v.times(c1/c2))).length();
-        }
-        l -= radii_[i];
-
-        if (l < mdist) {
-            mdist = l;
-        }
-
-    }
-    return -mdist;
-}
+};
 
 } // namespace
 
-
 #endif
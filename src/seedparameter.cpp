@@ -51,9 +51,10 @@ OrganRandomParameter* SeedRandomParameter::copy(Organism* p)
  * @copydoc OrganTypeParameter::realize()
  *
  * Creates a specific plant from the plant random parameters.
+ * @param plant     the plant of the new seed
  * @return Specific plant parameters derived from the root random parameters
  */
-OrganSpecificParameter* SeedRandomParameter::realize()
+OrganSpecificParameter* SeedRandomParameter::realize(Organism* plant)
 {
     Vector3d sP = seedPos.plus(Vector3d(plant->randn()*seedPoss.x, plant->randn()*seedPoss.y, plant->randn()*seedPoss.z));
     double fB = std::max(firstB + plant->randn()*firstBs, 0.);
@@ -65,7 +66,7 @@ OrganSpecificParameter* SeedRandomParameter::realize()
     double dRC = std::max(delayRC + plant->randn()*delayRCs, 0.);
     double nz_ = std::max(delaySB + plant->randn()*delaySBs, 0.);
     double st = std::max(simtime + plant->randn()*simtimes, 0.);
-    OrganSpecificParameter* p = new SeedSpecificParameter(subType, sP, fB, dB, mB, nC_, fSB, dSB,dRC, nz_, st);
+    OrganSpecificParameter* p = new (plant) SeedSpecificParameter(subType, sP, fB, dB, mB, nC_, fSB, dSB,dRC, nz_, st);
     return p;
 }
 
@@ -63,7 +63,8 @@ public:
 
     OrganRandomParameter* copy(Organism* plant_) override;
 
-    OrganSpecificParameter* realize() override; ///< Creates a specific plant from the seed random parameter set
+    using OrganRandomParameter::realize;
+    OrganSpecificParameter* realize(Organism* plant) override; ///< Creates a specific plant from the seed random parameter set
 
     // DEPRICATED
     void read(std::istream & cin); ///< reads a single root system parameter set
@@ -0,0 +1,460 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "segmentstore.h"
+
+#include "analysis.h"
+#include "binaryio.h"
+#include "raster.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+static const std::string storeMagic = "CRootBoxSegmentStore"; ///< file signature
+static const uint32_t storeVersion = 1; ///< increase, if the file layout changes
+static const uint32_t storeByteOrder = 0x01020304; ///< the file is written in native byte order
+
+/**
+ * Opens an existing store, only the chunk headers are read
+ *
+ * @param name      file name
+ */
+SegmentStore::SegmentStore(std::string name) :name(name), chunkSize(0)
+{
+    readIndex();
+}
+
+/**
+ * Creates an empty store
+ *
+ * @param name      file name, an existing file is overwritten
+ * @param types     parameters stored per segment (@see SegmentAnalyser::getParameter), the creation time and the
+ *                  geometry (length, and surface and volume, if the radius is stored) are always available
+ * @param chunkSize maximal number of segments per chunk
+ */
+SegmentStore::SegmentStore(std::string name, std::vector<std::string> types, int chunkSize) :name(name), types(types),
+    chunkSize(chunkSize)
+{
+    if (chunkSize<1) {
+        std::cout << "SegmentStore::SegmentStore: the chunk size must be positive\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::SegmentStore: the chunk size must be positive");
+    }
+    std::ofstream fos(name, std::ios::binary | std::ios::trunc);
+    if (!fos.good()) {
+        std::cout << "SegmentStore::SegmentStore: could not open file " << name << "\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::SegmentStore: could not open file " + name);
+    }
+    BinaryWriter w(fos);
+    w.writeChars(storeMagic);
+    w.write(storeVersion);
+    w.write(storeByteOrder);
+    w.write(int32_t(chunkSize));
+    w.write(uint64_t(types.size()));
+    for (const auto& t : types) {
+        w.write(t);
+    }
+    fileSize = fos.tellp();
+    if (!fos.good()) {
+        std::cout << "SegmentStore::SegmentStore: could not write file " << name << "\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::SegmentStore: could not write file " + name);
+    }
+}
+
+/**
+ * Appends the segments of the plant, its parameters are evaluated before adding (@see SegmentStore::addSegments)
+ */
+void SegmentStore::addSegments(const Organism& plant)
+{
+    addSegments(SegmentAnalyser(plant));
+}
+
+/**
+ * Appends the segments of the analyser. The parameters of the store are evaluated (from the organs or the user data
+ * of the analyser), and the segments are split into chunks of at most chunkSize segments.
+ *
+ * @param a         the analyser, e.g. of a single plant, or a chunk of another store
+ */
+void SegmentStore::addSegments(const SegmentAnalyser& a)
+{
+    std::vector<std::vector<double>> parameters;
+    for (const auto& t : types) {
+        parameters.push_back(a.getParameter(t));
+    }
+    std::vector<int> ni(a.nodes.size(), -1);
+    for (size_t first=0; first<a.segments.size(); first+=chunkSize) {
+        append(a, parameters, first, std::min(first+chunkSize, a.segments.size()), ni);
+    }
+}
+
+/**
+ * Writes the segments [first,last) of the analyser as a chunk, with their nodes (renumbered in order of appearance)
+ */
+void SegmentStore::append(const SegmentAnalyser& a, const std::vector<std::vector<double>>& parameters, size_t first, size_t last,
+    std::vector<int>& ni)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    Vector3d lower(inf, inf, inf), upper(-inf, -inf, -inf);
+    std::vector<Vector3d> nodes;
+    std::vector<int32_t> segs;
+    segs.reserve(2*(last-first));
+    auto node = [&](int i) {
+        if (ni.at(i)<0) {
+            ni[i] = nodes.size();
+            const Vector3d& n = a.nodes[i];
+            nodes.push_back(n);
+            lower = Vector3d(std::min(lower.x, n.x), std::min(lower.y, n.y), std::min(lower.z, n.z));
+            upper = Vector3d(std::max(upper.x, n.x), std::max(upper.y, n.y), std::max(upper.z, n.z));
+        }
+        return ni[i];
+    };
+    for (size_t i=first; i<last; i++) {
+        const Vector2i& s = a.segments[i];
+        segs.push_back(node(s.x));
+        segs.push_back(node(s.y));
+    }
+    for (size_t i=first; i<last; i++) { // reset the buffer for the next chunk
+        ni[a.segments[i].x] = -1;
+        ni[a.segments[i].y] = -1;
+    }
+    std::ostringstream blob;
+    BinaryWriter w(blob);
+    w.write(uint64_t(nodes.size()));
+    w.write(uint64_t(last-first));
+    w.write(lower);
+    w.write(upper);
+    w.write(nodes);
+    w.write(segs);
+    w.write(std::vector<double>(a.segCTs.begin()+first, a.segCTs.begin()+last));
+    for (const auto& p : parameters) {
+        w.write(std::vector<double>(p.begin()+first, p.begin()+last));
+    }
+    std::string data = blob.str();
+
+    std::ofstream fos(name, std::ios::binary | std::ios::app);
+    BinaryWriter fw(fos);
+    fw.write(uint64_t(data.size()));
+    fw.writeChars(data);
+    if (!fos.good()) {
+        std::cout << "SegmentStore::append: could not write file " << name << "\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::append: could not write file " + name);
+    }
+    Chunk c = { fileSize+sizeof(uint64_t), data.size(), nodes.size(), last-first, lower, upper };
+    chunks.push_back(c);
+    fileSize += sizeof(uint64_t)+data.size();
+    std::lock_guard<std::mutex> lock(mutex);
+    file.reset(); // the mapping does not contain the chunk
+}
+
+/**
+ * Reads the header of the file, and the header of each chunk (the chunk data are skipped)
+ */
+void SegmentStore::readIndex()
+{
+    const MappedFile& f = getFile();
+    BinaryReader r(f.getData(), f.getSize());
+    if ((f.getSize()<storeMagic.size()) || (r.readChars(storeMagic.size())!=storeMagic)) {
+        std::cout << "SegmentStore::readIndex: " << name << " is not a CRootBox segment store \n" << std::flush;
+        throw std::invalid_argument("SegmentStore::readIndex: not a CRootBox segment store " + name);
+    }
+    uint32_t version = r.read<uint32_t>();
+    uint32_t order = r.read<uint32_t>();
+    if ((version!=storeVersion) || (order!=storeByteOrder)) {
+        std::cout << "SegmentStore::readIndex: file " << name << " has version " << version << " and byte order " << std::hex << order
+            << std::dec << ", expected version " << storeVersion << " in native byte order \n" << std::flush;
+        throw std::invalid_argument("SegmentStore::readIndex: unsupported file " + name);
+    }
+    chunkSize = r.read<int32_t>();
+    uint64_t n = r.read<uint64_t>();
+    types.clear();
+    for (uint64_t i=0; i<n; i++) {
+        types.push_back(r.readString());
+    }
+    size_t pos = r.getPosition();
+    chunks.clear();
+    while (pos<f.getSize()) {
+        BinaryReader h(f.getData()+pos, f.getSize()-pos);
+        uint64_t size = h.read<uint64_t>();
+        Chunk c;
+        c.offset = pos+sizeof(uint64_t);
+        c.size = size;
+        if (size>f.getSize()-c.offset) {
+            std::cout << "SegmentStore::readIndex: chunk " << chunks.size() << " exceeds the file " << name << "\n" << std::flush;
+            throw std::invalid_argument("SegmentStore::readIndex: unexpected end of file " + name);
+        }
+        c.numberOfNodes = h.read<uint64_t>();
+        c.numberOfSegments = h.read<uint64_t>();
+        c.lower = h.readVector3d();
+        c.upper = h.readVector3d();
+        chunks.push_back(c);
+        pos = c.offset+c.size;
+    }
+    fileSize = f.getSize();
+}
+
+/**
+ * @return the mapped file, which is mapped again, if chunks were added since the last mapping
+ */
+const MappedFile& SegmentStore::getFile() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file) {
+        file = std::make_shared<MappedFile>(name);
+    }
+    return *file;
+}
+
+/**
+ * @param i         chunk index
+ * @return          an analyser with the segments of the chunk, the stored parameters are its user data, the organs are nullptr
+ */
+SegmentAnalyser SegmentStore::getChunk(int i) const
+{
+    const Chunk& c = chunks.at(i);
+    const MappedFile& f = getFile();
+    BinaryReader r(f.getData()+c.offset, c.size);
+    r.read<uint64_t>(); // numberOfNodes, numberOfSegments, lower, and upper are in the index
+    r.read<uint64_t>();
+    r.readVector3d();
+    r.readVector3d();
+    SegmentAnalyser a;
+    a.nodes = r.readVector3ds();
+    std::vector<int32_t> segs = r.readVector<int32_t>();
+    a.segCTs = r.readVector<double>();
+    if ((a.nodes.size()!=c.numberOfNodes) || (segs.size()!=2*c.numberOfSegments) || (a.segCTs.size()!=c.numberOfSegments)) {
+        std::cout << "SegmentStore::getChunk: chunk " << i << " of " << name << " is corrupt\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::getChunk: corrupt chunk in " + name);
+    }
+    a.segments.resize(c.numberOfSegments);
+    for (size_t j=0; j<c.numberOfSegments; j++) {
+        a.segments[j] = Vector2i(segs[2*j], segs[2*j+1]);
+        if ((segs[2*j]<0) || (segs[2*j]>=int(c.numberOfNodes)) || (segs[2*j+1]<0) || (segs[2*j+1]>=int(c.numberOfNodes))) {
+            std::cout << "SegmentStore::getChunk: chunk " << i << " of " << name << " has invalid node indices\n" << std::flush;
+            throw std::invalid_argument("SegmentStore::getChunk: corrupt chunk in " + name);
+        }
+    }
+    a.segO.assign(c.numberOfSegments, nullptr);
+    for (const auto& t : types) {
+        std::vector<double> data = r.readVector<double>();
+        if (data.size()!=c.numberOfSegments) {
+            std::cout << "SegmentStore::getChunk: chunk " << i << " of " << name << " is corrupt\n" << std::flush;
+            throw std::invalid_argument("SegmentStore::getChunk: corrupt chunk in " + name);
+        }
+        a.addUserData(data, t);
+    }
+    return a;
+}
+
+/**
+ * Calls @param f for the analyser of each chunk, in the order of the chunks, with one chunk in memory at a time
+ */
+void SegmentStore::forEachChunk(const std::function<void(const SegmentAnalyser&)>& f) const
+{
+    for (size_t i=0; i<chunks.size(); i++) {
+        f(getChunk(i));
+    }
+}
+
+/**
+ * @return all segments of the store in a single analyser, with the stored parameters as user data
+ */
+SegmentAnalyser SegmentStore::load() const
+{
+    SegmentAnalyser a;
+    std::vector<std::vector<double>> data(types.size());
+    forEachChunk([&](const SegmentAnalyser& c) {
+        a.addSegments(c);
+        for (size_t k=0; k<types.size(); k++) {
+            std::vector<double> d = c.getParameter(types[k]);
+            data[k].insert(data[k].end(), d.begin(), d.end());
+        }
+    });
+    for (size_t k=0; k<types.size(); k++) {
+        a.addUserData(data[k], types[k]);
+    }
+    return a;
+}
+
+/**
+ * @param name      parameter name, stored or derived from the geometry (@see SegmentStore::SegmentStore)
+ * @return          the sum of the parameter over all segments
+ */
+double SegmentStore::getSummed(std::string name) const
+{
+    checkParameter(name);
+    double v = 0.;
+    forEachChunk([&](const SegmentAnalyser& c) {
+        v += c.getSummed(name);
+    });
+    return v;
+}
+
+/**
+ * @param name      parameter name, stored or derived from the geometry (@see SegmentStore::SegmentStore)
+ * @param geometry  the segments with their mid point within the geometry are summed (@see SegmentAnalyser::getSummed)
+ * @return          the sum of the parameter within the geometry
+ */
+double SegmentStore::getSummed(std::string name, SignedDistanceFunction* geometry) const
+{
+    checkParameter(name);
+    double v = 0.;
+    forEachChunk([&](const SegmentAnalyser& c) {
+        v += c.getSummed(name, geometry);
+    });
+    return v;
+}
+
+/**
+ * Vertical distribution of a parameter, summed over the chunks (@see SegmentAnalyser::distribution)
+ */
+std::vector<double> SegmentStore::distribution(std::string name, double top, double bot, int n, bool exact) const
+{
+    double dz = (bot-top)/double(n);
+    std::vector<double> z(n+1);
+    for (int i=0; i<=n; i++) {
+        z[i] = top-i*dz; // layer i is [top-(i+1)*dz, top-i*dz]
+    }
+    return rasterize(name, { }, { }, z, exact);
+}
+
+/**
+ * Three-dimensional distribution of a parameter, summed over the chunks (@see SegmentAnalyser::rasterize).
+ * Chunks, whose bounding boxes are outside of the raster, are skipped without reading their data.
+ */
+std::vector<double> SegmentStore::rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y,
+    const std::vector<double>& z, bool exact) const
+{
+    checkParameter(name);
+    Raster raster(x, y, z);
+    bool proportional = (name=="length") || (name=="surface") || (name=="volume");
+    const std::vector<double>* axes[3] = { &x, &y, &z };
+    std::vector<double> r(raster.getNumberOfVoxels(), 0.);
+    for (size_t i=0; i<chunks.size(); i++) {
+        bool outside = false;
+        for (int d=0; d<3; d++) {
+            const std::vector<double>& b = *axes[d];
+            if (!b.empty()) {
+                double lo = std::min(b.front(), b.back());
+                double hi = std::max(b.front(), b.back());
+                double cl = (d==0) ? chunks[i].lower.x : ((d==1) ? chunks[i].lower.y : chunks[i].lower.z);
+                double cu = (d==0) ? chunks[i].upper.x : ((d==1) ? chunks[i].upper.y : chunks[i].upper.z);
+                outside = outside || (cu<lo) || (cl>hi);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+        SegmentAnalyser c = getChunk(i);
+        std::vector<double> ri = raster.rasterize(c.nodes, c.segments, c.getParameter(name), proportional, exact);
+        for (size_t j=0; j<r.size(); j++) {
+            r[j] += ri[j];
+        }
+    }
+    return r;
+}
+
+/**
+ * Appends the segments, whose parameter is within [min,max], to the store @param out (@see SegmentAnalyser::filter)
+ */
+void SegmentStore::filter(std::string name, double min, double max, SegmentStore& out) const
+{
+    checkParameter(name);
+    checkOutput(out);
+    forEachChunk([&](const SegmentAnalyser& c) {
+        SegmentQuery q(c);
+        out.addSegments(q.filter(name, min, max).getAnalyser(true));
+    });
+}
+
+/**
+ * Appends the segments, whose parameter equals value, to the store @param out (@see SegmentAnalyser::filter)
+ */
+void SegmentStore::filter(std::string name, double value, SegmentStore& out) const
+{
+    checkParameter(name);
+    checkOutput(out);
+    forEachChunk([&](const SegmentAnalyser& c) {
+        SegmentQuery q(c);
+        out.addSegments(q.filter(name, value).getAnalyser(true));
+    });
+}
+
+/**
+ * Appends the segments within the geometry to the store @param out, segments crossing its boundary are cut
+ * (@see SegmentAnalyser::crop)
+ */
+void SegmentStore::crop(SignedDistanceFunction* geometry, SegmentStore& out) const
+{
+    checkOutput(out);
+    forEachChunk([&](const SegmentAnalyser& c) {
+        SegmentQuery q(c);
+        out.addSegments(q.crop(geometry).getAnalyser(true));
+    });
+}
+
+/**
+ * @return the number of segments of all chunks
+ */
+size_t SegmentStore::getNumberOfSegments() const
+{
+    size_t n = 0;
+    for (const auto& c : chunks) {
+        n += c.numberOfSegments;
+    }
+    return n;
+}
+
+/**
+ * @return the number of nodes of all chunks
+ */
+size_t SegmentStore::getNumberOfNodes() const
+{
+    size_t n = 0;
+    for (const auto& c : chunks) {
+        n += c.numberOfNodes;
+    }
+    return n;
+}
+
+/**
+ * Throws, if the parameter @param name is not available for the stored segments
+ */
+void SegmentStore::checkParameter(std::string name) const
+{
+    bool stored = std::find(types.begin(), types.end(), name)!=types.end();
+    bool radius = std::find(types.begin(), types.end(), "radius")!=types.end();
+    if (!stored && (name!="creationTime") && (name!="length") && !(radius && ((name=="surface") || (name=="volume")))) {
+        std::cout << "SegmentStore::checkParameter: the parameter " << name << " is not stored in " << this->name << "\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::checkParameter: the parameter " + name + " is not stored");
+    }
+}
+
+/**
+ * Throws, if @param out is this store (its chunks would be read while they are written)
+ */
+void SegmentStore::checkOutput(const SegmentStore& out) const
+{
+    if ((&out==this) || (out.name==name)) {
+        std::cout << "SegmentStore::checkOutput: the result cannot be written into the store " << name << " itself\n" << std::flush;
+        throw std::invalid_argument("SegmentStore::checkOutput: the result cannot be written into the store itself");
+    }
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string SegmentStore::toString() const
+{
+    std::stringstream str;
+    str << "SegmentStore " << name << " with " << getNumberOfSegments() << " segments in " << chunks.size() << " chunks (" << fileSize
+        << " bytes), parameters:";
+    for (const auto& t : types) {
+        str << " " << t;
+    }
+    return str.str();
+}
+
+} // end namespace CRootBox
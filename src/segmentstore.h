@@ -0,0 +1,110 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef SEGMENTSTORE_H_
+#define SEGMENTSTORE_H_
+
+#include "mymath.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CRootBox {
+
+class Organism;
+class SegmentAnalyser;
+class SignedDistanceFunction;
+class MappedFile;
+
+/**
+ * SegmentStore
+ *
+ * Segments of many plants (e.g. of a whole plot) in a file of chunks, instead of a single SegmentAnalyser in memory.
+ * Plants are appended chunk by chunk, each chunk holds at most chunkSize segments with their nodes, creation times,
+ * and the parameters given by types (e.g. radius and sub type), which are evaluated from the organs when the plant
+ * is added, so that the store is independent of the organs.
+ *
+ * Analyses run over the chunks of the memory mapped file, one chunk in memory at a time: sums, distributions, and
+ * rasterizations are added up per chunk, filters and crops write their result into another store. A chunk is a
+ * SegmentAnalyser with the parameters as user data (@see SegmentAnalyser::snapshot).
+ *
+ * Opening a store only reads the chunk headers. The file is written in native byte order (as Organism::save).
+ *
+ * Thread safety: const methods can be called concurrently, adding segments must not run concurrently with other calls.
+ */
+class SegmentStore
+{
+
+public:
+
+    SegmentStore(std::string name); ///< opens an existing store
+    SegmentStore(std::string name, std::vector<std::string> types, int chunkSize = 65536); ///< creates an empty store, an existing file is overwritten
+    virtual ~SegmentStore() { }
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    // append
+    void addSegments(const Organism& plant); ///< appends the segments of a plant
+    void addSegments(const SegmentAnalyser& a); ///< appends the segments of an analyser
+
+    // chunks
+    int getNumberOfChunks() const { return chunks.size(); }
+    SegmentAnalyser getChunk(int i) const; ///< the segments of chunk i, with the parameters as user data
+    void forEachChunk(const std::function<void(const SegmentAnalyser&)>& f) const; ///< calls f for each chunk, in order
+    SegmentAnalyser load() const; ///< all segments in a single analyser (for stores that fit into memory)
+
+    // streaming analysis
+    double getSummed(std::string name) const; ///< sums up the parameter @see SegmentAnalyser::getSummed
+    double getSummed(std::string name, SignedDistanceFunction* geometry) const; ///< sums up the parameter within the geometry
+    std::vector<double> distribution(std::string name, double top, double bot, int n, bool exact = false) const; ///< vertical distribution @see SegmentAnalyser::distribution
+    std::vector<double> rasterize(std::string name, const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+        bool exact = true) const; ///< 3d distribution of a parameter @see SegmentAnalyser::rasterize
+    void filter(std::string name, double min, double max, SegmentStore& out) const; ///< appends the segments with parameter values in [min,max] to out
+    void filter(std::string name, double value, SegmentStore& out) const; ///< appends the segments with the parameter value to out
+    void crop(SignedDistanceFunction* geometry, SegmentStore& out) const; ///< appends the segments (or their parts) within the geometry to out
+
+    // info
+    std::string getName() const { return name; } ///< file name
+    const std::vector<std::string>& getTypes() const { return types; } ///< names of the stored parameters
+    int getChunkSize() const { return chunkSize; } ///< maximal number of segments per chunk
+    size_t getNumberOfSegments() const; ///< number of segments of all chunks
+    size_t getNumberOfNodes() const; ///< number of nodes of all chunks (nodes shared by two chunks are stored in both)
+    size_t getFileSize() const { return fileSize; } ///< size of the file [bytes]
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    /* position and extent of a chunk within the file */
+    struct Chunk {
+        size_t offset; ///< first byte of the chunk data
+        size_t size; ///< number of bytes of the chunk data
+        size_t numberOfNodes;
+        size_t numberOfSegments;
+        Vector3d lower; ///< lower corner of the bounding box of the nodes
+        Vector3d upper; ///< upper corner of the bounding box of the nodes
+    };
+
+    void readIndex(); ///< reads the header and the chunk headers
+    void append(const SegmentAnalyser& a, const std::vector<std::vector<double>>& parameters, size_t first, size_t last,
+        std::vector<int>& ni); ///< appends the segments [first,last) of a as a chunk, ni is a buffer of -1 per node of a
+    const MappedFile& getFile() const; ///< the mapped file, mapped again after segments were added
+    void checkParameter(std::string name) const; ///< throws, if the parameter is neither stored, nor derived from the geometry
+    void checkOutput(const SegmentStore& out) const; ///< throws, if out is this store
+
+    std::string name;
+    std::vector<std::string> types;
+    int chunkSize;
+    std::vector<Chunk> chunks;
+    size_t fileSize = 0;
+
+    mutable std::shared_ptr<MappedFile> file; ///< mapped lazily
+    mutable std::mutex mutex; ///< guards the mapping
+
+};
+
+} // end namespace CRootBox
+
+#endif
@@ -0,0 +1,73 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef SHAREDVECTOR_H_
+#define SHAREDVECTOR_H_
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace CRootBox {
+
+/**
+ * SharedVector
+ *
+ * A vector that shares its elements with its copies, until one of them is modified (copy on write).
+ * Used for the nodes of the organs, so copies of an organism (@see Organism::Organism(const Organism&)) do not copy
+ * the geometry of organs that do not grow any more (e.g. dead or inactive roots).
+ *
+ * Read access is const, and never copies. All modifications go through SharedVector::edit (or the methods calling it),
+ * which copies the elements first, if they are shared.
+ * Copies can be modified by different threads (e.g. forks of a root system simulated in parallel).
+ */
+template<class T>
+class SharedVector
+{
+public:
+
+    SharedVector() { }
+    SharedVector(const std::vector<T>& v): p(std::make_shared<std::vector<T>>(v)) { } ///< copies the elements
+
+    size_t size() const { return (p!=nullptr) ? p->size() : 0; }
+    bool empty() const { return size()==0; }
+    const T& operator[](size_t i) const { return (*p)[i]; }
+    const T& at(size_t i) const { return get().at(i); }
+    const T& back() const { return p->back(); }
+    typename std::vector<T>::const_iterator begin() const { return get().begin(); }
+    typename std::vector<T>::const_iterator end() const { return get().end(); }
+    const std::vector<T>& get() const { return (p!=nullptr) ? *p : empty_; } ///< the elements, read only
+
+    void push_back(const T& v) { edit().push_back(v); }
+    void resize(size_t n) { edit().resize(n); }
+    void set(size_t i, const T& v) { edit()[i] = v; } ///< sets element i
+    void setBack(const T& v) { edit().back() = v; } ///< sets the last element
+    SharedVector& operator=(const std::vector<T>& v) { p = std::make_shared<std::vector<T>>(v); return *this; } ///< copies the elements
+
+    /**
+     * @return the elements for modification, they are copied first if they are shared
+     */
+    std::vector<T>& edit() {
+        if (p==nullptr) {
+            p = std::make_shared<std::vector<T>>();
+        } else if (p.use_count()>1) {
+            p = std::make_shared<std::vector<T>>(*p);
+        } else {
+            std::atomic_thread_fence(std::memory_order_acquire); // the last other owner might have just copied the elements
+        }
+        return *p;
+    }
+
+    bool isShared() const { return p.use_count()>1; } ///< true, if a copy refers to the same elements
+
+protected:
+
+    std::shared_ptr<std::vector<T>> p;
+    static const std::vector<T> empty_;
+
+};
+
+template<class T>
+const std::vector<T> SharedVector<T>::empty_ = std::vector<T>();
+
+} // namespace CRootBox
+
+#endif
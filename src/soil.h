@@ -5,8 +5,14 @@
 #include "mymath.h"
 #include "sdf.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <iostream>
 #include <limits>
+#include <stdexcept>
+#include <vector>
+#include <typeinfo>
 
 namespace CRootBox  {
 
@@ -14,6 +20,10 @@ class Organ;
 
 /**
  * Base class to look up for a scalar soil property
+ *
+ * Optionally, callers keep their last value in a SoilLookUp::Sample, which is reused as long as the positions stay
+ * within the same cell of a piecewise constant soil (@see SoilLookUp::setCaching, and SoilLookUp::getCellBounds).
+ * Call SoilLookUp::changed, whenever the data of the soil are modified, this invalidates all samples.
  */
 class SoilLookUp
 {
@@ -21,6 +31,17 @@ public:
 
     const double inf = std::numeric_limits<double>::infinity();
 
+    /**
+     * The last value of a caller, and the cell where it is valid (@see SoilLookUp::getCachedValue)
+     */
+    struct Sample {
+        const SoilLookUp* soil = nullptr; ///< soil of the value, nullptr if the sample is empty
+        size_t version = 0; ///< version of the soil data (@see SoilLookUp::changed)
+        Vector3d lo; ///< the cell [lo, hi) of the value, in the periodic domain
+        Vector3d hi;
+        double value = 0.;
+    };
+
     SoilLookUp() { }
     virtual ~SoilLookUp() { }
 
@@ -36,8 +57,89 @@ public:
      */
     virtual double getValue(const Vector3d& pos, const Organ* o = nullptr) const { return 1.; } ///< Returns a scalar property of the soil, 1. per default
 
+    /**
+     * Returns the scalar soil property at many positions, overwrite for a faster evaluation
+     *
+     * @param pos       positions [cm]
+     * @param values    scalar soil properties (results)
+     * @param o         the organ that wants to know the scalar property (for all positions)
+     */
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const {
+        values.resize(pos.size());
+        for (size_t i=0; i<pos.size(); i++) {
+            values[i] = getValue(pos[i], o);
+        }
+    }
+
+    std::vector<double> getValues(const std::vector<Vector3d>& pos) const {
+        std::vector<double> values;
+        getValues(pos, values);
+        return values;
+    } ///< Returns the scalar soil property at many positions
+
     virtual std::string toString() const { return "SoilLookUp base class"; } ///< Quick info about the object for debugging
 
+    /**
+     * The cell containing the point, if the soil property is constant within the cell (for all organs), overwrite for
+     * piecewise constant soils. The cell is half open [lo, hi), unbounded sides are infinite.
+     *
+     * @param p         position in the periodic domain [cm]
+     * @param lo        lower corner of the cell (result)
+     * @param hi        upper corner of the cell (result)
+     * \return          true, if the cell is known
+     */
+    virtual bool getCellBounds(const Vector3d& p, Vector3d& lo, Vector3d& hi) const { return false; }
+
+    void setCaching(bool c) { caching = c; } ///< callers reuse their samples within the cells (default false)
+    bool getCaching() const { return caching; } ///< callers reuse their samples within the cells
+    void changed() { version++; } ///< invalidates all samples, call after the soil data were modified
+    size_t getVersion() const { return version; } ///< number of modifications
+
+    /**
+     * True, if the sample @param s is valid at position @param pos
+     */
+    bool isCached(const Vector3d& pos, const Sample& s) const {
+        if (!caching || (s.soil!=this) || (s.version!=version)) {
+            return false;
+        }
+        Vector3d p = periodic(pos);
+        return (p.x>=s.lo.x) && (p.x<s.hi.x) && (p.y>=s.lo.y) && (p.y<s.hi.y) && (p.z>=s.lo.z) && (p.z<s.hi.z);
+    }
+
+    /**
+     * Returns the value of the sample @param s if it is valid at position @param pos, otherwise looks up the value
+     * (@see SoilLookUp::getValue), and stores it in the sample
+     */
+    double getCachedValue(const Vector3d& pos, const Organ* o, Sample& s) const {
+        if (isCached(pos, s)) {
+            return s.value;
+        }
+        double v = getValue(pos, o);
+        if (caching && getCellBounds(periodic(pos), s.lo, s.hi)) {
+            s.soil = this;
+            s.version = version;
+            s.value = v;
+        } else {
+            s.soil = nullptr;
+        }
+        return v;
+    }
+
+    /**
+     * Values at many positions, reusing the sample @param s (@see SoilLookUp::getCachedValue),
+     * the same as SoilLookUp::getValues if caching is off
+     */
+    void getCachedValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o, Sample& s) const {
+        if (!caching) {
+            getValues(pos, values, o);
+            return;
+        }
+        values.resize(pos.size());
+        for (size_t i=0; i<pos.size(); i++) {
+            values[i] = getCachedValue(pos[i], o, s);
+        }
+    }
+
     /**
      * sets the periodic boundaries, periodicity is used if bounds are set,
      * and if it is supportet by the getValue method of the derived classes
@@ -68,6 +170,13 @@ public:
         this->setPeriodicDomain(minx, maxx, 0, inf, 0, inf );
     }
 
+    void periodic(const std::vector<Vector3d>& pos, std::vector<Vector3d>& p) const {
+        p.resize(pos.size());
+        for (size_t i=0; i<pos.size(); i++) {
+            p[i] = periodic(pos[i]);
+        }
+    } ///< maps the points into the periodic domain
+
     /**
      * maps the point into the periodic domain
      */
@@ -99,6 +208,8 @@ private:
 
     bool periodic_ = false;
     double minx=0., xx=0., miny=0., yy=0, minz=0., zz=0.;
+    bool caching = false;
+    size_t version = 0;
 
 };
 
@@ -141,6 +252,18 @@ public:
         return std::max(std::min(c,fmax),fmin);
     }
 
+    using SoilLookUp::getValues;
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const override {
+        std::vector<Vector3d> p;
+        periodic(pos, p);
+        sdf->getDists(p, values); // batch evaluation of the geometry
+        for (auto& v : values) {
+            double c = -v/slope*2.;
+            c += (fmax-fmin)/2.;
+            v = std::max(std::min(c,fmax),fmin);
+        }
+    } ///< @see SoilLookUp::getValues
+
     std::string toString() const override { return "SoilLookUpSDF"; } ///< Quick info about the object for debugging
 
     SignedDistanceFunction* sdf; ///< signed distance function representing the geometry
@@ -172,6 +295,18 @@ public:
         return v;
     }
 
+    using SoilLookUp::getValues;
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const override {
+        values.assign(pos.size(), 1.);
+        std::vector<double> v;
+        for (size_t i=0; i<soils.size(); i++) {
+            soils[i]->getValues(pos, v, o);
+            for (size_t j=0; j<values.size(); j++) {
+                values[j] *= v[j];
+            }
+        }
+    } ///< multiplies the batch evaluations of the soils, @see SoilLookUp::getValues
+
     virtual std::string toString() const override {
         std::string str = "";
         for (size_t i=0; i<soils.size(); i++) {
@@ -220,6 +355,20 @@ public:
         }
     }
 
+    using SoilLookUp::getValues;
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const override {
+        if (baseLookUp==nullptr) {
+            values.assign(pos.size(), scale);
+        } else {
+            std::vector<Vector3d> p;
+            this->periodic(pos, p);
+            baseLookUp->getValues(p, values, o);
+            for (auto& v : values) {
+                v *= scale;
+            }
+        }
+    } ///< scales the batch evaluation of the base soil look up, @see SoilLookUp::getValues
+
     virtual std::string toString() const override { return "ProportionalElongation"; } ///< Quick info about the object for debugging
 
 protected:
@@ -266,11 +415,32 @@ public:
         return jl;
     } ///< Generic way to perform look up in an ordered table, overwrite by faster method if appropriate, todo currently floor
 
+    virtual void mapIndices(const std::vector<double>& x, std::vector<size_t>& indices) const {
+        indices.resize(x.size());
+        for (size_t i=0; i<x.size(); i++) {
+            indices[i] = Grid1D::map(x[i]);
+        }
+    } ///< Look up of many values, @see Grid1D::map
+
     virtual double getValue(const Vector3d& pos, const Organ* o = nullptr) const override {
         Vector3d p = this->periodic(pos);
         return data[map(p.z)];
     } ///< Returns the data of the 1d table, repeats first or last entry if out of bound
 
+    using SoilLookUp::getValues;
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const override {
+        std::vector<double> z(pos.size());
+        for (size_t i=0; i<pos.size(); i++) {
+            z[i] = this->periodic(pos[i]).z;
+        }
+        std::vector<size_t> indices;
+        mapIndices(z, indices);
+        values.resize(pos.size());
+        for (size_t i=0; i<pos.size(); i++) {
+            values[i] = data[indices[i]];
+        }
+    } ///< @see SoilLookUp::getValues
+
     virtual std::string toString() const override { return "RectilinearGrid1D"; } ///< Quick info about the object for debugging
 
     size_t n;
@@ -312,8 +482,23 @@ public:
     }
 
     virtual size_t map(double x) const override {
-        return std::floor((x-a)/(b-a)*(n-1));
-    } ///< faster than general look up
+        return cell(x, a, b, n);
+    } ///< faster than general look up, repeats first or last entry if out of bound
+
+    virtual void mapIndices(const std::vector<double>& x, std::vector<size_t>& indices) const override {
+        indices.resize(x.size());
+        for (size_t i=0; i<x.size(); i++) {
+            indices[i] = cell(x[i], a, b, n);
+        }
+    } ///< @see EquidistantGrid1D::map
+
+    static size_t cell(double x, double a, double b, size_t n) {
+        double i = std::floor((x-a)/(b-a)*(n-1));
+        if (!(i>0)) { // (including nan)
+            return 0;
+        }
+        return std::min(size_t(i), std::max(n, size_t(1))-1);
+    } ///< index of an equidistant grid [a,b] with n points
 
     virtual std::string toString() const  override{ return "LinearGrid1D"; } ///< Quick info about the object for debugging
 
@@ -325,52 +510,364 @@ public:
 
 /**
  * RectilinearGrid, called tensor product grid (in Dune), data is located between the grid points
+ *
+ * Cells are located in O(1) for equidistant axes, and by a search starting at the last cell of the caller otherwise
+ * (@see RectilinearGrid3D::Hint), so look ups along a growing root hardly ever search.
+ * The data is piecewise constant per default, or trilinearly interpolated between the grid points (@see setInterpolation).
+ *
+ * The linear data index is x-fastest (@see RectilinearGrid3D::index). Alternatively, data can be stored in blocks of 4x4x4 cells
+ * (@see setBlocked), so neighbouring cells in all directions share cache lines. Access the data by setData and getData
+ * in both layouts.
+ *
+ * Instead of RectilinearGrid3D::data, lookups can read a field owned by the caller, e.g. the water content of an external
+ * soil solver, without copying it (@see bindField). With two bound buffers, the solver writes the next field into the back
+ * buffer, while lookups read the front buffer, and publishes it by swapping the buffers (@see swapFields). The swap is
+ * atomic, each lookup reads either the old or the new field, and increments the version (@see SoilLookUp::changed).
  */
 class RectilinearGrid3D  : public SoilLookUp
 {
 public:
 
+    /**
+     * The last cell of a caller, speeds up the search in rectilinear axes
+     */
+    struct Hint {
+        size_t i = 0;
+        size_t j = 0;
+        size_t k = 0;
+    };
+
     RectilinearGrid3D(Grid1D* xgrid, Grid1D* ygrid, Grid1D* zgrid) :xgrid(xgrid), ygrid(ygrid), zgrid(zgrid) {
         nx = xgrid->n;
         ny = ygrid->n;
         nz = zgrid->n;
         data = std::vector<double>(nx*ny*nz);
+        update();
     }
 
+    RectilinearGrid3D(const RectilinearGrid3D& g) :SoilLookUp(g), xgrid(g.xgrid), ygrid(g.ygrid), zgrid(g.zgrid),
+        nx(g.nx), ny(g.ny), nz(g.nz), data(g.data), axes{g.axes[0], g.axes[1], g.axes[2]}, interpolate(g.interpolate),
+        blocked(g.blocked), field(g.field.load()), buffers{g.buffers[0], g.buffers[1]} { } ///< copies the data, bound fields are shared
+
     virtual ~RectilinearGrid3D() { };
 
     SoilLookUp* copy() override { return new RectilinearGrid3D(*this); }
 
+    /**
+     * Sets up the cell locators of the three axes, call if the axes were changed
+     */
+    void update() {
+        setAxis(0, xgrid);
+        setAxis(1, ygrid);
+        setAxis(2, zgrid);
+        changed();
+    }
+
+    size_t index(size_t i, size_t j, size_t k) const {
+        return linearIndex(i, j, k, blocked);
+    } ///< cell indices to linear data index
+
     virtual size_t map(double x, double y, double z) const {
-        size_t i = xgrid->map(x);
-        size_t j = ygrid->map(y);
-        size_t k = zgrid->map(z);
-        return k*(ny*nz)+j*z+i; // or whatever
+        Hint hint;
+        locate(Vector3d(x,y,z), hint);
+        return index(hint.i, hint.j, hint.k);
     } ///< point to linear data index
 
-    double getData(size_t i, size_t j, size_t k) {
-        return data.at(map(i,j,k));
+    double getData(size_t i, size_t j, size_t k) const {
+        size_t l = index(i,j,k);
+        const double* d = getField();
+        return (d!=data.data()) ? d[l] : data.at(l);
+    } ///< data at cell indices (of the bound field, if one is bound)
+
+    void setData(size_t i, size_t j, size_t k, double d) {
+        checkUnbound("setData");
+        data.at(index(i,j,k)) = d;
+        changed();
+    } ///< sets the data at cell indices (call SoilLookUp::changed after modifying RectilinearGrid3D::data directly)
+
+    /**
+     * Lookups read the field at @param p, instead of RectilinearGrid3D::data. The field is not copied, it is owned by the
+     * caller, and must stay valid while it is bound. It contains @param n values in the layout of RectilinearGrid3D::index,
+     * where n is the size of RectilinearGrid3D::data. Call SoilLookUp::changed after modifying the field in place.
+     */
+    void bindField(const double* p, size_t n) {
+        checkFieldSize(p, n);
+        buffers[0] = const_cast<double*>(p);
+        buffers[1] = nullptr;
+        field.store(p, std::memory_order_release);
+        changed();
     }
 
+    /**
+     * Binds two buffers of the caller (@see bindField), lookups read @param front, the caller writes the next field into
+     * the back buffer (@see getBackField), and publishes it with RectilinearGrid3D::swapFields
+     */
+    void bindFields(double* front, double* back, size_t n) {
+        checkFieldSize(front, n);
+        checkFieldSize(back, n);
+        if (front==back) {
+            std::cout << "RectilinearGrid3D::bindFields: front and back buffer are the same\n" << std::flush;
+            throw std::invalid_argument("RectilinearGrid3D::bindFields: front and back buffer are the same");
+        }
+        buffers[0] = front;
+        buffers[1] = back;
+        field.store(front, std::memory_order_release);
+        changed();
+    }
+
+    /**
+     * Publishes the back buffer, which becomes the front buffer read by the lookups, and the former front buffer
+     * can be overwritten with the next field. Concurrent lookups read either the old or the new field.
+     */
+    void swapFields() {
+        if (buffers[1]==nullptr) {
+            std::cout << "RectilinearGrid3D::swapFields: no double buffer is bound (use bindFields)\n" << std::flush;
+            throw std::invalid_argument("RectilinearGrid3D::swapFields: no double buffer is bound (use bindFields)");
+        }
+        std::swap(buffers[0], buffers[1]);
+        field.store(buffers[0], std::memory_order_release);
+        changed();
+    }
+
+    void unbindField() { buffers[0] = buffers[1] = nullptr; field.store(nullptr, std::memory_order_release); changed(); } ///< lookups read RectilinearGrid3D::data again
+    bool isBound() const { return field.load(std::memory_order_acquire)!=nullptr; } ///< true, if lookups read a field of the caller
+    const double* getField() const {
+        const double* p = field.load(std::memory_order_acquire);
+        return (p!=nullptr) ? p : data.data();
+    } ///< the field read by lookups, i.e. the front buffer, or RectilinearGrid3D::data
+    double* getBackField() const { return buffers[1]; } ///< the buffer for the next field (nullptr, if no double buffer is bound)
+
     double getValue(const Vector3d& pos, const Organ* o = nullptr) const override {
+        static thread_local Hint hint; // last cell of this thread
+        return getValue(pos, hint);
+    } ///< Returns the data of the 3d table, repeats first or last entry if out of bound
+
+    /**
+     * Returns the data at a position, the cell search starts at the last cell of the caller
+     *
+     * @param pos       position [cm]
+     * @param hint      last cell of the caller (in), cell containing pos (out)
+     */
+    double getValue(const Vector3d& pos, Hint& hint) const {
         Vector3d p = periodic(pos);
-        return data[map(p.x,p.y,p.z)];
-    } ///< Returns the data of the 1d table, repeats first or last entry if out of bound
+        locate(p, hint);
+        const double* d = getField(); // a single field per lookup
+        if (!interpolate) {
+            return d[index(hint.i, hint.j, hint.k)];
+        }
+        size_t i1, j1, k1;
+        double tx = weight(0, p.x, hint.i, i1);
+        double ty = weight(1, p.y, hint.j, j1);
+        double tz = weight(2, p.z, hint.k, k1);
+        double c00 = lerp(d[index(hint.i, hint.j, hint.k)], d[index(i1, hint.j, hint.k)], tx);
+        double c10 = lerp(d[index(hint.i, j1, hint.k)], d[index(i1, j1, hint.k)], tx);
+        double c01 = lerp(d[index(hint.i, hint.j, k1)], d[index(i1, hint.j, k1)], tx);
+        double c11 = lerp(d[index(hint.i, j1, k1)], d[index(i1, j1, k1)], tx);
+        return lerp(lerp(c00, c10, ty), lerp(c01, c11, ty), tz);
+    }
 
-    void setData(size_t i, size_t j, size_t k, double d) {
-        data.at(map(i,j,k)) = d;
+    using SoilLookUp::getValues;
+    virtual void getValues(const std::vector<Vector3d>& pos, std::vector<double>& values, const Organ* o = nullptr) const override {
+        Hint hint;
+        values.resize(pos.size());
+        for (size_t l=0; l<pos.size(); l++) {
+            values[l] = getValue(pos[l], hint); // neighbouring positions start at the last cell
+        }
+    } ///< @see SoilLookUp::getValues
+
+    /**
+     * The cell of the data at @param p, if the data are piecewise constant (@see SoilLookUp::getCellBounds),
+     * outer cells extend to infinity (the first or last entry is repeated)
+     */
+    bool getCellBounds(const Vector3d& p, Vector3d& lo, Vector3d& hi) const override {
+        if (interpolate) {
+            return false;
+        }
+        Hint hint;
+        locate(p, hint);
+        return cellBounds(0, hint.i, lo.x, hi.x) && cellBounds(1, hint.j, lo.y, hi.y) && cellBounds(2, hint.k, lo.z, hi.z);
+    }
+
+    /**
+     * Locates the cell containing the point @param p, the search starts at @param hint
+     */
+    void locate(const Vector3d& p, Hint& hint) const {
+        hint.i = locate(0, p.x, hint.i);
+        hint.j = locate(1, p.y, hint.j);
+        hint.k = locate(2, p.z, hint.k);
+    }
+
+    void setInterpolation(bool interpolate_) { interpolate = interpolate_; changed(); } ///< trilinear interpolation between the grid points, or piecewise constant
+    bool getInterpolation() const { return interpolate; }
+
+    /**
+     * Stores the data in blocks of 4x4x4 cells, or x-fastest. The data is reordered, and padded to full blocks.
+     */
+    void setBlocked(bool blocked_) {
+        if (blocked_==blocked) {
+            return;
+        }
+        checkUnbound("setBlocked");
+        std::vector<double> d = data;
+        data.assign(blocked_ ? ((nx+3)/4)*((ny+3)/4)*((nz+3)/4)*64 : nx*ny*nz, 0.);
+        for (size_t k=0; k<nz; k++) {
+            for (size_t j=0; j<ny; j++) {
+                for (size_t i=0; i<nx; i++) {
+                    data[linearIndex(i,j,k,blocked_)] = d[linearIndex(i,j,k,blocked)];
+                }
+            }
+        }
+        blocked = blocked_;
+        changed();
     }
+    bool getBlocked() const { return blocked; }
 
     Vector3d getGridPoint(size_t i, size_t j, size_t k) {
         return Vector3d(xgrid->grid[i], ygrid->grid[j], zgrid->grid[k]);
     } ///< grid point at indices
 
+    virtual std::string toString() const override { return "RectilinearGrid3D"; } ///< Quick info about the object for debugging
+
     Grid1D* xgrid;
     Grid1D* ygrid;
     Grid1D* zgrid;
 
     size_t nx,ny,nz;
-    std::vector<double> data;
+    std::vector<double> data; ///< x-fastest (@see RectilinearGrid3D::index)
+
+protected:
+
+    size_t linearIndex(size_t i, size_t j, size_t k, bool blocked_) const {
+        if (blocked_) { // block index, and cell index within the block
+            size_t nbx = (nx+3)/4, nby = (ny+3)/4;
+            return ((((k>>2)*nby+(j>>2))*nbx+(i>>2))<<6) + ((((k&3)<<2)+(j&3))<<2) + (i&3);
+        } else {
+            return (k*ny+j)*nx+i;
+        }
+    }
+
+    enum AxisType { axis_equidistant, axis_rectilinear, axis_generic };
+
+    /**
+     * Cell locator of one axis
+     */
+    struct Axis {
+        AxisType type = axis_generic;
+        double a = 0.; ///< first grid point (equidistant)
+        double b = 1.; ///< last grid point (equidistant)
+        size_t n = 0;
+        const Grid1D* grid = nullptr;
+    };
+
+    void setAxis(int d, const Grid1D* g) {
+        Axis& ax = axes[d];
+        ax.grid = g;
+        ax.n = g->n;
+        auto eg = dynamic_cast<const EquidistantGrid1D*>(g);
+        if ((eg!=nullptr) && (typeid(*g)==typeid(EquidistantGrid1D))) {
+            ax.type = axis_equidistant;
+            ax.a = eg->a;
+            ax.b = eg->b;
+        } else if (typeid(*g)==typeid(Grid1D)) {
+            ax.type = axis_rectilinear;
+        } else { // map was overwritten
+            ax.type = axis_generic;
+        }
+    }
+
+    /**
+     * Cell index along axis @param d, same as Grid1D::map, the search starts at cell @param h
+     */
+    size_t locate(int d, double x, size_t h) const {
+        const Axis& ax = axes[d];
+        switch (ax.type) {
+        case axis_equidistant:
+            return EquidistantGrid1D::cell(x, ax.a, ax.b, ax.n);
+        case axis_rectilinear: {
+            const std::vector<double>& g = ax.grid->grid;
+            if (h+1<ax.n) {
+                if ((x>=g[h]) && (x<g[h+1])) { // same cell
+                    return h;
+                }
+                if ((h+2<ax.n) && (x>=g[h+1]) && (x<g[h+2])) { // next cell
+                    return h+1;
+                }
+                if ((h>0) && (x>=g[h-1]) && (x<g[h])) { // previous cell
+                    return h-1;
+                }
+            }
+            return ax.grid->Grid1D::map(x);
+        }
+        default:
+            return ax.grid->map(x);
+        }
+    }
+
+    /**
+     * Bounds [lo, hi) of the coordinates located in cell @param i along axis @param d (@see RectilinearGrid3D::locate)
+     */
+    bool cellBounds(int d, size_t i, double& lo, double& hi) const {
+        const Axis& ax = axes[d];
+        switch (ax.type) {
+        case axis_equidistant: { // shrunk by a small margin, the cell is computed in floating point
+            if (ax.n<2) {
+                lo = -inf;
+                hi = inf;
+                return true;
+            }
+            double h = (ax.b-ax.a)/double(ax.n-1);
+            lo = (i==0) ? -inf : ax.a+i*h+1.e-9*std::abs(h);
+            hi = (i+1>=ax.n) ? inf : ax.a+(i+1)*h-1.e-9*std::abs(h);
+            return h>0;
+        }
+        case axis_rectilinear: { // Grid1D::map returns at most the cell n-2
+            const std::vector<double>& g = ax.grid->grid;
+            lo = (i==0) ? -inf : g[i];
+            hi = (i+2>=ax.n) ? inf : g[i+1];
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Interpolation weight of @param x in cell @param i along axis @param d, and the next cell index @param i1
+     */
+    double weight(int d, double x, size_t i, size_t& i1) const {
+        const std::vector<double>& g = axes[d].grid->grid;
+        if (i+1>=g.size()) {
+            i1 = i;
+            return 0.;
+        }
+        i1 = i+1;
+        double t = (x-g[i])/(g[i1]-g[i]);
+        return std::max(std::min(t, 1.), 0.);
+    }
+
+    static double lerp(double v0, double v1, double t) { return v0+(v1-v0)*t; }
+
+    void checkFieldSize(const double* p, size_t n) const {
+        if ((p==nullptr) || (n!=data.size())) {
+            std::cout << "RectilinearGrid3D::bindField: the field must have " << data.size() << " values\n" << std::flush;
+            throw std::invalid_argument("RectilinearGrid3D::bindField: the field must have the size of the data");
+        }
+    } ///< throws, if the field does not match the data
+
+    void checkUnbound(std::string method) const {
+        if (isBound()) {
+            std::cout << "RectilinearGrid3D::" << method << ": a field of the caller is bound (use unbindField)\n" << std::flush;
+            throw std::invalid_argument("RectilinearGrid3D::" + method + ": a field of the caller is bound (use unbindField)");
+        }
+    } ///< throws, if lookups read a bound field
+
+    Axis axes[3];
+    bool interpolate = false;
+    bool blocked = false;
+
+    std::atomic<const double*> field { nullptr }; ///< the front buffer, or nullptr for RectilinearGrid3D::data
+    double* buffers[2] = { nullptr, nullptr }; ///< front and back buffer of the caller
+
 };
 
 
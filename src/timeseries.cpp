@@ -0,0 +1,389 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "timeseries.h"
+
+#include "Organism.h"
+#include "Organ.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <iostream>
+
+namespace CRootBox {
+
+const char TimeSeriesWriter::magic[8] = { 'C', 'R', 'B', 'S', 'E', 'R', 'I', 'E' };
+const uint32_t TimeSeriesWriter::version;
+
+/* binary helpers, values are stored in native (little endian) byte order */
+template<class T>
+static void put(std::string& b, const T& v)
+{
+    b.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<class T>
+static T get(const std::string& b, size_t& pos)
+{
+    if (pos+sizeof(T)>b.size()) {
+        throw std::invalid_argument("TimeSeriesReader: corrupt record");
+    }
+    T v;
+    std::memcpy(&v, b.data()+pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+
+/**
+ * Creates the file and writes the file header
+ *
+ * @param name                  file name
+ * @param keyframeInterval      a key frame (complete state) is written every keyframeInterval records,
+ *                              0 writes only the first record as key frame (default)
+ */
+TimeSeriesWriter::TimeSeriesWriter(std::string name, int keyframeInterval) :keyframeInterval(keyframeInterval)
+{
+    file.open(name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+        throw std::invalid_argument("TimeSeriesWriter::TimeSeriesWriter: could not open file " + name);
+    }
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.flush();
+}
+
+/**
+ * Appends a record of the organism's current state, a key frame for the first record, every keyframeInterval records,
+ * or if nodes of the last record were removed (e.g. by RootSystem::pop), a delta otherwise.
+ *
+ * @param plant     the organism, after its last simulation step
+ */
+void TimeSeriesWriter::write(const Organism& plant)
+{
+    if (!file.is_open()) {
+        throw std::invalid_argument("TimeSeriesWriter::write: file is closed");
+    }
+    bool keyframe = (steps==0) || ((keyframeInterval>0) && (steps%keyframeInterval==0)) || (plant.getNumberOfNodes()<numberOfNodes);
+    const auto& shrinks = plant.getNodeStore().getShrinks();
+    for (size_t i=numberOfShrinks; i<shrinks.size(); i++) { // nodes of the last record were overwritten
+        keyframe = keyframe || (shrinks[i]<numberOfNodes);
+    }
+    if (keyframe) {
+        writeKeyframe(plant);
+    } else {
+        writeDelta(plant);
+    }
+    numberOfNodes = plant.getNumberOfNodes();
+    numberOfShrinks = shrinks.size();
+    steps++;
+}
+
+/**
+ * Closes the file, no more records can be written
+ */
+void TimeSeriesWriter::close()
+{
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+/**
+ * Writes the record header [type, time, payload size] and the payload
+ */
+void TimeSeriesWriter::writeRecord(uint32_t type, double time, const std::string& payload)
+{
+    uint64_t size = payload.size();
+    file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(payload.data(), payload.size());
+    file.flush();
+}
+
+/**
+ * Appends the segment ending in node i [int32 node indices, organ id, organ type, sub type, double radius]
+ */
+void TimeSeriesWriter::addSegment(std::string& payload, const Organism& plant, int i) const
+{
+    const NodeStore& store = plant.getNodeStore();
+    const Organ* o = store.getOrgan(i);
+    put<int32_t>(payload, store.getPrev(i));
+    put<int32_t>(payload, i);
+    put<int32_t>(payload, o->getId());
+    put<int32_t>(payload, o->organType());
+    put<int32_t>(payload, o->getParameter(Organ::pi_subType));
+    put<double>(payload, o->getParameter(Organ::pi_radius));
+}
+
+/**
+ * Key frame payload: number of nodes, nodes [x, y, z, creation time], number of segments, segments
+ */
+void TimeSeriesWriter::writeKeyframe(const Organism& plant)
+{
+    const NodeStore& store = plant.getNodeStore();
+    int n = plant.getNumberOfNodes();
+    int ns = std::min(n, store.size());
+    std::string payload;
+    put<int32_t>(payload, n);
+    for (int i=0; i<n; i++) {
+        Vector3d x = (i<ns) ? store.getNode(i) : Vector3d();
+        put<double>(payload, x.x);
+        put<double>(payload, x.y);
+        put<double>(payload, x.z);
+        put<double>(payload, (i<ns) ? store.getNodeCT(i) : 0.);
+    }
+    std::vector<int> segs;
+    for (int i=0; i<ns; i++) {
+        if ((store.getPrev(i)>=0) && (store.getOrgan(i)!=nullptr)) {
+            segs.push_back(i);
+        }
+    }
+    put<int32_t>(payload, segs.size());
+    for (int i : segs) {
+        addSegment(payload, plant, i);
+    }
+    writeRecord(rt_keyframe, plant.getSimTime(), payload);
+}
+
+/**
+ * Delta payload: index of the first new node, number of nodes, the new nodes [x, y, z, creation time],
+ * number of moved nodes, moved nodes [index, x, y, z, creation time], number of new segments, new segments
+ */
+void TimeSeriesWriter::writeDelta(const Organism& plant)
+{
+    const NodeStore& store = plant.getNodeStore();
+    int n = plant.getNumberOfNodes();
+    int ns = std::min(n, store.size());
+    std::string payload;
+    put<int32_t>(payload, numberOfNodes);
+    put<int32_t>(payload, n);
+    for (int i=numberOfNodes; i<n; i++) {
+        Vector3d x = (i<ns) ? store.getNode(i) : Vector3d();
+        put<double>(payload, x.x);
+        put<double>(payload, x.y);
+        put<double>(payload, x.z);
+        put<double>(payload, (i<ns) ? store.getNodeCT(i) : 0.);
+    }
+    std::vector<int> moved;
+    for (int i : plant.getUpdatedNodeIndices()) {
+        if ((i>=0) && (i<numberOfNodes) && (i<ns)) {
+            moved.push_back(i);
+        }
+    }
+    put<int32_t>(payload, moved.size());
+    for (int i : moved) {
+        Vector3d x = store.getNode(i);
+        put<int32_t>(payload, i);
+        put<double>(payload, x.x);
+        put<double>(payload, x.y);
+        put<double>(payload, x.z);
+        put<double>(payload, store.getNodeCT(i));
+    }
+    std::vector<int> segs;
+    for (int i=numberOfNodes; i<ns; i++) {
+        if ((store.getPrev(i)>=0) && (store.getOrgan(i)!=nullptr)) {
+            segs.push_back(i);
+        }
+    }
+    put<int32_t>(payload, segs.size());
+    for (int i : segs) {
+        addSegment(payload, plant, i);
+    }
+    writeRecord(rt_delta, plant.getSimTime(), payload);
+}
+
+/**
+ * Opens the file, checks its header, and indexes the records (without reading their payload).
+ * An incomplete last record is ignored.
+ *
+ * @param name      file name
+ */
+TimeSeriesReader::TimeSeriesReader(std::string name) :name(name)
+{
+    std::ifstream file(name.c_str(), std::ios::in | std::ios::binary);
+    if (!file.good()) {
+        throw std::invalid_argument("TimeSeriesReader::TimeSeriesReader: could not open file " + name);
+    }
+    char m[sizeof(TimeSeriesWriter::magic)];
+    uint32_t v = 0;
+    file.read(m, sizeof(m));
+    file.read(reinterpret_cast<char*>(&v), sizeof(v));
+    if (!file.good() || (std::memcmp(m, TimeSeriesWriter::magic, sizeof(m))!=0) || (v!=TimeSeriesWriter::version)) {
+        throw std::invalid_argument("TimeSeriesReader::TimeSeriesReader: " + name + " is not a time series file of this version");
+    }
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    std::streamoff pos = sizeof(m)+sizeof(v);
+    const std::streamoff headerSize = sizeof(uint32_t)+sizeof(double)+sizeof(uint64_t);
+    while (pos+headerSize<=end) {
+        Record r;
+        file.seekg(pos);
+        file.read(reinterpret_cast<char*>(&r.type), sizeof(r.type));
+        file.read(reinterpret_cast<char*>(&r.time), sizeof(r.time));
+        file.read(reinterpret_cast<char*>(&r.size), sizeof(r.size));
+        r.offset = pos+headerSize;
+        if (!file.good() || (r.offset+std::streamoff(r.size)>end)) { // incomplete record
+            break;
+        }
+        if (records.empty() && (r.type!=TimeSeriesWriter::rt_keyframe)) {
+            throw std::invalid_argument("TimeSeriesReader::TimeSeriesReader: first record of " + name + " is not a key frame");
+        }
+        records.push_back(r);
+        pos = r.offset+r.size;
+    }
+}
+
+/**
+ * Rebuilds the state at a recorded step, starting from the preceding key frame,
+ * or from the current state, if it lies between key frame and step.
+ *
+ * @param s     recorded step
+ */
+void TimeSeriesReader::read(int s)
+{
+    if ((s<0) || (s>=int(records.size()))) {
+        throw std::invalid_argument("TimeSeriesReader::read: step out of range");
+    }
+    int k = s;
+    while (records[k].type!=TimeSeriesWriter::rt_keyframe) { // preceding key frame
+        k--;
+    }
+    int start = ((step>=k) && (step<=s)) ? step+1 : k;
+    for (int i=start; i<=s; i++) {
+        apply(i);
+    }
+    step = s;
+}
+
+/**
+ * Applies the record of a step to the current state (a key frame replaces it)
+ */
+void TimeSeriesReader::apply(int s)
+{
+    const Record& r = records.at(s);
+    std::string b(r.size, '\0');
+    std::ifstream file(name.c_str(), std::ios::in | std::ios::binary);
+    file.seekg(r.offset);
+    file.read(&b[0], r.size);
+    if (!file.good()) {
+        throw std::invalid_argument("TimeSeriesReader::apply: could not read record");
+    }
+    size_t pos = 0;
+    int first = 0;
+    if (r.type==TimeSeriesWriter::rt_keyframe) {
+        segments.clear();
+        organIds.clear();
+        organTypes.clear();
+        subTypes.clear();
+        radii.clear();
+    } else {
+        first = get<int32_t>(b, pos);
+    }
+    int n = get<int32_t>(b, pos);
+    nodes.resize(n);
+    nodeCTs.resize(n);
+    for (int i=first; i<n; i++) {
+        nodes[i].x = get<double>(b, pos);
+        nodes[i].y = get<double>(b, pos);
+        nodes[i].z = get<double>(b, pos);
+        nodeCTs[i] = get<double>(b, pos);
+    }
+    if (r.type==TimeSeriesWriter::rt_delta) {
+        int m = get<int32_t>(b, pos);
+        for (int j=0; j<m; j++) {
+            int i = get<int32_t>(b, pos);
+            nodes.at(i).x = get<double>(b, pos);
+            nodes.at(i).y = get<double>(b, pos);
+            nodes.at(i).z = get<double>(b, pos);
+            nodeCTs.at(i) = get<double>(b, pos);
+        }
+    }
+    int m = get<int32_t>(b, pos);
+    for (int j=0; j<m; j++) {
+        int x = get<int32_t>(b, pos);
+        int y = get<int32_t>(b, pos);
+        segments.push_back(Vector2i(x, y));
+        organIds.push_back(get<int32_t>(b, pos));
+        organTypes.push_back(get<int32_t>(b, pos));
+        subTypes.push_back(get<int32_t>(b, pos));
+        radii.push_back(get<double>(b, pos));
+    }
+}
+
+/**
+ * @return the segment creation times, i.e. the creation times of their second nodes (@see Organism::getSegmentCTs)
+ */
+std::vector<double> TimeSeriesReader::getSegmentCTs() const
+{
+    std::vector<double> cts(segments.size());
+    for (size_t j=0; j<segments.size(); j++) {
+        cts[j] = nodeCTs.at(segments[j].y);
+    }
+    return cts;
+}
+
+/**
+ * @param name      "organId", "organType", "subType", "radius", or "creationTime"
+ * @return the data per segment
+ */
+std::vector<double> TimeSeriesReader::getSegmentData(std::string name) const
+{
+    if (name=="organId") {
+        return std::vector<double>(organIds.begin(), organIds.end());
+    }
+    if (name=="organType") {
+        return std::vector<double>(organTypes.begin(), organTypes.end());
+    }
+    if (name=="subType") {
+        return std::vector<double>(subTypes.begin(), subTypes.end());
+    }
+    if (name=="radius") {
+        return radii;
+    }
+    if (name=="creationTime") {
+        return getSegmentCTs();
+    }
+    throw std::invalid_argument("TimeSeriesReader::getSegmentData: unknown segment data " + name);
+}
+
+/**
+ * Writes the current state as segment based VTP file, with the same data arrays as SegmentAnalyser::write
+ *
+ * @param name      file name
+ * @param format    VTPWriter::ascii (default), VTPWriter::binary, or VTPWriter::compressed (zlib)
+ */
+void TimeSeriesReader::writeVTP(std::string name, int format) const
+{
+    std::ofstream os(name.c_str(), std::ios::out | std::ios::binary);
+    VTPWriter vtp(os, format);
+    vtp.begin();
+    os << "<Piece NumberOfLines=\""<< segments.size() << "\" NumberOfPoints=\""<< nodes.size()<< "\">\n";
+    os << "<CellData Scalars=\" CellData\">\n";
+    for (auto n : { "radius", "subType", "creationTime", "organId" }) {
+        vtp.dataArray(n, 1, getSegmentData(n));
+    }
+    os << "\n</CellData>\n";
+    os << "<Points>\n";
+    std::vector<double> coordinates(3*nodes.size());
+    for (size_t i=0; i<nodes.size(); i++) {
+        coordinates[3*i] = nodes[i].x;
+        coordinates[3*i+1] = nodes[i].y;
+        coordinates[3*i+2] = nodes[i].z;
+    }
+    vtp.dataArray("Coordinates", 3, coordinates);
+    os << "</Points>\n";
+    os << "<Lines>\n";
+    std::vector<int> connectivity(2*segments.size()), offsets(segments.size());
+    for (size_t i=0; i<segments.size(); i++) {
+        connectivity[2*i] = segments[i].x;
+        connectivity[2*i+1] = segments[i].y;
+        offsets[i] = 2*i+2;
+    }
+    vtp.dataArray("connectivity", 1, connectivity);
+    vtp.dataArray("offsets", 1, offsets);
+    os << "\n</Lines>\n";
+    os << "</Piece>\n";
+    vtp.end();
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,115 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef TIMESERIES_H_
+#define TIMESERIES_H_
+
+#include "mymath.h"
+#include "vtpwriter.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace CRootBox {
+
+class Organism;
+
+/**
+ * TimeSeriesWriter
+ *
+ * Streams the segments of an organism into a single binary container file, one record per call of TimeSeriesWriter::write.
+ * A record is either a key frame holding the complete state, or a delta holding only the new nodes,
+ * the moved nodes, and the new segments of the last time step (with organ id, organ type, sub type, and radius).
+ *
+ * Call TimeSeriesWriter::write after each simulation step (Organism::simulate), since moved nodes are only known for
+ * the last step (@see Organism::getUpdatedNodeIndices). Records are appended and flushed immediately,
+ * a file of an aborted simulation can be read up to its last complete record.
+ *
+ * Read the file with TimeSeriesReader.
+ */
+class TimeSeriesWriter
+{
+public:
+
+    enum RecordType { rt_keyframe = 0, rt_delta = 1 }; ///< record types of the container
+
+    TimeSeriesWriter(std::string name, int keyframeInterval = 0); ///< creates (overwrites) the file
+    virtual ~TimeSeriesWriter() { close(); }
+
+    void write(const Organism& plant); ///< appends the state of the organism after the last time step
+    void close(); ///< closes the file
+    int getNumberOfSteps() const { return steps; } ///< number of records written
+
+    static const char magic[8]; ///< file signature
+    static const uint32_t version = 1; ///< file format version
+
+protected:
+
+    void writeRecord(uint32_t type, double time, const std::string& payload); ///< writes a record and flushes the file
+    void addSegment(std::string& payload, const Organism& plant, int i) const; ///< appends the segment ending in node i
+    void writeKeyframe(const Organism& plant);
+    void writeDelta(const Organism& plant);
+
+    std::ofstream file;
+    int keyframeInterval; ///< a key frame is written every keyframeInterval steps (0: only the first record)
+    int steps = 0; ///< number of records written
+    int numberOfNodes = 0; ///< number of nodes of the last record
+    size_t numberOfShrinks = 0; ///< number of node store shrinks at the last record (@see NodeStore::getShrinks)
+
+};
+
+/**
+ * TimeSeriesReader
+ *
+ * Reads a file written by TimeSeriesWriter. On construction only the record headers are read,
+ * the state at a step is rebuilt from the preceding key frame (or from the current state, if it is closer).
+ */
+class TimeSeriesReader
+{
+public:
+
+    TimeSeriesReader(std::string name); ///< opens the file, and indexes its records
+
+    int getNumberOfSteps() const { return records.size(); } ///< number of recorded steps
+    double getTime(int step) const { return records.at(step).time; } ///< simulation time of a step [day]
+    bool isKeyframe(int step) const { return records.at(step).type==TimeSeriesWriter::rt_keyframe; } ///< true, if the step is stored as key frame
+
+    void read(int step); ///< rebuilds the state at a recorded step
+    int getStep() const { return step; } ///< the current step, -1 if nothing was read yet
+
+    /* current state */
+    const std::vector<Vector3d>& getNodes() const { return nodes; } ///< nodes, indexed by the global node index
+    const std::vector<double>& getNodeCTs() const { return nodeCTs; } ///< node creation times
+    const std::vector<Vector2i>& getSegments() const { return segments; } ///< segments, ordered by their second node index
+    std::vector<double> getSegmentCTs() const; ///< segment creation times
+    std::vector<double> getSegmentData(std::string name) const; ///< per segment: "organId", "organType", "subType", "radius", or "creationTime"
+    void writeVTP(std::string name, int format = VTPWriter::ascii) const; ///< writes the current state as segment based VTP file
+
+protected:
+
+    struct Record {
+        uint32_t type;
+        double time;
+        std::streamoff offset; ///< position of the record payload
+        uint64_t size; ///< size of the payload
+    };
+
+    void apply(int step); ///< applies a single record to the current state
+
+    std::string name;
+    std::vector<Record> records;
+
+    int step = -1;
+    std::vector<Vector3d> nodes;
+    std::vector<double> nodeCTs;
+    std::vector<Vector2i> segments;
+    std::vector<int> organIds;
+    std::vector<int> organTypes;
+    std::vector<int> subTypes;
+    std::vector<double> radii;
+
+};
+
+} // end namespace CRootBox
+
+#endif
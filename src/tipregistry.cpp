@@ -0,0 +1,307 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "tipregistry.h"
+
+#include "Organism.h"
+#include "Organ.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace CRootBox {
+
+/**
+ * @param cellSize  edge length of the hash cells [cm], e.g. the typical query radius, or the soil cell size
+ */
+TipRegistry::TipRegistry(double cellSize) :cellSize(cellSize)
+{
+    if (!(cellSize>0)) {
+        std::cout << "TipRegistry::TipRegistry: the cell size must be positive\n" << std::flush;
+        throw std::invalid_argument("TipRegistry::TipRegistry: the cell size must be positive");
+    }
+}
+
+/**
+ * Registers the changes of the last time step: the tips of roots with new nodes (Organism::getNumberOfNewNodes),
+ * or moved nodes (NodeStore::getChanges), and removes the tips of roots that stopped growing.
+ * The registry is rebuilt, if it was not built yet, or the node store was shrunk (e.g. by RootSystem::pop).
+ *
+ * @param plant     the organism, after its time step
+ */
+void TipRegistry::update(const Organism& plant)
+{
+    const NodeStore& store = plant.getNodeStore();
+    if (!valid || (store.getShrinks().size()!=shrinks)) {
+        rebuild(plant);
+        return;
+    }
+    int n = std::min(plant.getNumberOfNodes(), store.size());
+    Organ* last = nullptr;
+    for (int i=plant.getNumberOfNodes()-plant.getNumberOfNewNodes(); i<n; i++) { // new nodes, consecutive per organ
+        Organ* o = store.getOrgan(i);
+        if ((o!=nullptr) && (o!=last)) {
+            set(o);
+            last = o;
+        }
+    }
+    for (int i : store.getChanges()) { // moved nodes
+        if ((i>=0) && (i<n) && (store.getOrgan(i)!=nullptr)) {
+            set(store.getOrgan(i));
+        }
+    }
+    for (size_t s = tips.size(); s-->0; ) { // roots that stopped without a change of their nodes
+        if (!tips[s].organ->isAlive() || !tips[s].organ->isActive()) {
+            remove(s);
+        }
+    }
+}
+
+/**
+ * Registers the tips of all growing roots of the organism
+ *
+ * @param plant     the organism
+ */
+void TipRegistry::rebuild(const Organism& plant)
+{
+    clear();
+    for (auto o : plant.getOrganList()) {
+        set(o);
+    }
+    valid = true;
+    shrinks = plant.getNodeStore().getShrinks().size();
+}
+
+/**
+ * Removes all tips, the next call of TipRegistry::update rebuilds the registry
+ */
+void TipRegistry::clear()
+{
+    tips.clear();
+    slots.clear();
+    nodeSlots.clear();
+    cells.clear();
+    valid = false;
+}
+
+/**
+ * @return the node indices of all registered tips
+ */
+std::vector<int> TipRegistry::getTips() const
+{
+    std::vector<int> t;
+    t.reserve(tips.size());
+    for (const auto& tip : tips) {
+        t.push_back(tip.node);
+    }
+    std::sort(t.begin(), t.end());
+    return t;
+}
+
+/**
+ * @param x         center [cm]
+ * @param r         radius [cm]
+ * @return          node indices of the tips with a distance to x of at most r
+ */
+std::vector<int> TipRegistry::getTipsInRadius(const Vector3d& x, double r) const
+{
+    std::vector<int> t;
+    const double r2 = r*r;
+    forEachCell(x.minus(Vector3d(r, r, r)), x.plus(Vector3d(r, r, r)), [&](const Tip& tip) {
+        Vector3d d = tip.pos.minus(x);
+        if (d.times(d)<=r2) {
+            t.push_back(tip.node);
+        }
+    });
+    std::sort(t.begin(), t.end());
+    return t;
+}
+
+/**
+ * @param min       lower corner of the box [cm]
+ * @param max       upper corner of the box [cm]
+ * @return          node indices of the tips within the box (including its boundary)
+ */
+std::vector<int> TipRegistry::getTipsInBox(const Vector3d& min, const Vector3d& max) const
+{
+    std::vector<int> t;
+    forEachCell(min, max, [&](const Tip& tip) {
+        const Vector3d& p = tip.pos;
+        if ((p.x>=min.x) && (p.x<=max.x) && (p.y>=min.y) && (p.y<=max.y) && (p.z>=min.z) && (p.z<=max.z)) {
+            t.push_back(tip.node);
+        }
+    });
+    std::sort(t.begin(), t.end());
+    return t;
+}
+
+/**
+ * @return node indices of the tips within the hash cell (i,j,k), i.e. the cube [i,i+1)x[j,j+1)x[k,k+1) times the cell size
+ */
+std::vector<int> TipRegistry::getTipsInCell(int i, int j, int k) const
+{
+    std::vector<int> t;
+    auto it = cells.find(key(i, j, k));
+    if (it!=cells.end()) {
+        for (int s : it->second) {
+            int ci, cj, ck;
+            getCell(tips[s].pos, ci, cj, ck);
+            if ((ci==i) && (cj==j) && (ck==k)) { // keys of distant cells can collide
+                t.push_back(tips[s].node);
+            }
+        }
+    }
+    std::sort(t.begin(), t.end());
+    return t;
+}
+
+/**
+ * Hash cell (i,j,k) containing the position x
+ */
+void TipRegistry::getCell(const Vector3d& x, int& i, int& j, int& k) const
+{
+    i = int(std::floor(x.x/cellSize));
+    j = int(std::floor(x.y/cellSize));
+    k = int(std::floor(x.z/cellSize));
+}
+
+/**
+ * @param node      node index of a tip
+ * @return          the organ of the tip, or nullptr, if no tip has this node index
+ */
+Organ* TipRegistry::getOrgan(int node) const
+{
+    auto it = nodeSlots.find(node);
+    return (it!=nodeSlots.end()) ? tips[it->second].organ : nullptr;
+}
+
+/**
+ * @param node      node index of a registered tip
+ * @return          position of the tip [cm]
+ */
+Vector3d TipRegistry::getPosition(int node) const
+{
+    auto it = nodeSlots.find(node);
+    if (it==nodeSlots.end()) {
+        std::cout << "TipRegistry::getPosition: node " << node << " is not a registered tip\n" << std::flush;
+        throw std::invalid_argument("TipRegistry::getPosition: node is not a registered tip");
+    }
+    return tips[it->second].pos;
+}
+
+/**
+ * Registers the tip of a growing root, moves the tip of a registered root, or removes the tip, if the organ stopped growing
+ */
+void TipRegistry::set(Organ* o)
+{
+    bool growing = (o->organType()==Organism::ot_root) && o->isAlive() && o->isActive() && (o->getNumberOfNodes()>1);
+    auto it = slots.find(o);
+    if (!growing) {
+        if (it!=slots.end()) {
+            remove(it->second);
+        }
+        return;
+    }
+    int ln = o->getNumberOfNodes()-1;
+    Tip tip = { o, o->getNodeId(ln), o->getNode(ln), 0 };
+    int i, j, k;
+    getCell(tip.pos, i, j, k);
+    tip.cell = key(i, j, k);
+    if (it==slots.end()) { // new tip
+        int s = tips.size();
+        tips.push_back(tip);
+        slots[o] = s;
+        nodeSlots[tip.node] = s;
+        cells[tip.cell].push_back(s);
+    } else { // moved tip
+        int s = it->second;
+        Tip& old = tips[s];
+        if (old.cell!=tip.cell) {
+            auto& c = cells[old.cell];
+            c.erase(std::find(c.begin(), c.end(), s));
+            if (c.empty()) {
+                cells.erase(old.cell);
+            }
+            cells[tip.cell].push_back(s);
+        }
+        nodeSlots.erase(old.node);
+        nodeSlots[tip.node] = s;
+        old = tip;
+    }
+}
+
+/**
+ * Removes the tip in slot s, the last tip moves into the slot
+ */
+void TipRegistry::remove(int s)
+{
+    auto& c = cells[tips[s].cell];
+    c.erase(std::find(c.begin(), c.end(), s));
+    if (c.empty()) {
+        cells.erase(tips[s].cell);
+    }
+    slots.erase(tips[s].organ);
+    nodeSlots.erase(tips[s].node);
+    int l = tips.size()-1;
+    if (s!=l) {
+        Tip& last = tips[l];
+        auto& lc = cells[last.cell];
+        *std::find(lc.begin(), lc.end(), l) = s;
+        slots[last.organ] = s;
+        nodeSlots[last.node] = s;
+        tips[s] = last;
+    }
+    tips.pop_back();
+}
+
+/**
+ * @return hash key of the cell (i,j,k), 21 bits per direction
+ */
+uint64_t TipRegistry::key(int i, int j, int k) const
+{
+    const uint64_t m = (uint64_t(1)<<21)-1;
+    return ((uint64_t(i)&m)<<42) | ((uint64_t(j)&m)<<21) | (uint64_t(k)&m);
+}
+
+/**
+ * Calls f for the tips of all cells overlapping the box, or for all tips, if the box covers more cells than there are tips
+ */
+template<class F>
+void TipRegistry::forEachCell(const Vector3d& min, const Vector3d& max, F f) const
+{
+    int i0, j0, k0, i1, j1, k1;
+    getCell(min, i0, j0, k0);
+    getCell(max, i1, j1, k1);
+    double n = double(i1-i0+1)*double(j1-j0+1)*double(k1-k0+1);
+    if (n>double(tips.size())) { // scanning the tips is cheaper
+        for (const auto& tip : tips) {
+            f(tip);
+        }
+        return;
+    }
+    for (int i=i0; i<=i1; i++) {
+        for (int j=j0; j<=j1; j++) {
+            for (int k=k0; k<=k1; k++) {
+                auto it = cells.find(key(i, j, k));
+                if (it!=cells.end()) {
+                    for (int s : it->second) {
+                        f(tips[s]); // callers check the position, colliding keys are filtered
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @return Quick info about the object for debugging
+ */
+std::string TipRegistry::toString() const
+{
+    std::stringstream str;
+    str << "TipRegistry with " << tips.size() << " tips in " << cells.size() << " cells of size " << cellSize << " cm";
+    return str.str();
+}
+
+} // end namespace CRootBox
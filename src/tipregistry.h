@@ -0,0 +1,77 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef TIPREGISTRY_H_
+#define TIPREGISTRY_H_
+
+#include "mymath.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CRootBox {
+
+class Organ;
+class Organism;
+
+/**
+ * TipRegistry
+ *
+ * The tips of the growing roots (alive, active, and with at least one segment), in a spatial hash of cubic cells.
+ * The registry is kept up to date after each time step (see RootSystem::setTipRegistry): only the roots with new or
+ * moved nodes (from the node store, see NodeStore::getChanges) are updated, and the registered tips are checked for
+ * roots that stopped growing. After a RootSystem::pop or a load the registry is rebuilt.
+ *
+ * Queries return the global node indices of the tips, in ascending order. Tip-based models (e.g. sources and sinks per
+ * soil cell) can look up the tips within a radius, a box, or a hash cell, without scanning all roots.
+ */
+class TipRegistry
+{
+public:
+
+    TipRegistry(double cellSize = 1.); ///< empty registry
+
+    void update(const Organism& plant); ///< registers the tips that changed in the last time step
+    void rebuild(const Organism& plant); ///< registers the tips of all growing roots
+    void clear(); ///< removes all tips, the next update rebuilds the registry
+
+    int getNumberOfTips() const { return tips.size(); } ///< number of registered tips
+    double getCellSize() const { return cellSize; } ///< edge length of the hash cells [cm]
+    std::vector<int> getTips() const; ///< node indices of all registered tips
+    std::vector<int> getTipsInRadius(const Vector3d& x, double r) const; ///< tips within the distance r of x
+    std::vector<int> getTipsInBox(const Vector3d& min, const Vector3d& max) const; ///< tips within an axis aligned box, e.g. a soil cell
+    std::vector<int> getTipsInCell(int i, int j, int k) const; ///< tips within the hash cell (i,j,k)
+    void getCell(const Vector3d& x, int& i, int& j, int& k) const; ///< hash cell of a position
+    Organ* getOrgan(int node) const; ///< organ of the tip with node index node, or nullptr, if it is not registered
+    Vector3d getPosition(int node) const; ///< position of a registered tip
+
+    std::string toString() const; ///< quick info for debugging
+
+protected:
+
+    struct Tip {
+        Organ* organ;
+        int node;
+        Vector3d pos;
+        uint64_t cell;
+    }; ///< a registered tip
+
+    void set(Organ* o); ///< registers, moves, or removes the tip of an organ
+    void remove(int slot); ///< removes a tip, the last tip takes its slot
+    uint64_t key(int i, int j, int k) const; ///< hash key of a cell
+    template<class F> void forEachCell(const Vector3d& min, const Vector3d& max, F f) const; ///< calls f with the tips of the cells overlapping the box
+
+    double cellSize;
+    std::vector<Tip> tips;
+    std::unordered_map<const Organ*, int> slots; ///< slot of the tip of an organ
+    std::unordered_map<int, int> nodeSlots; ///< slot of the tip with a node index
+    std::unordered_map<uint64_t, std::vector<int>> cells; ///< slots of the tips per cell
+
+    bool valid = false; ///< the registry was built
+    size_t shrinks = 0; ///< number of node store shrinks at the last update (@see NodeStore::getShrinks)
+
+};
+
+} // end namespace CRootBox
+
+#endif
@@ -9,6 +9,48 @@
 
 namespace CRootBox {
 
+/**
+ * Evaluates the local directions Vector3d::rotAB(a,b) of all trials
+ */
+void TropismTrials::update()
+{
+    size_t n = a.size();
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+    Vector3d::rotAB(a.data(), b.data(), n, x.data(), y.data(), z.data());
+}
+
+/**
+ * Global headings old.times(Vector3d::rotAB(a,b)) of all trials, call TropismTrials::update first
+ *
+ * @param old          rotation matrix, heading is old(:,1)
+ * @param hx           x-components of the headings (results)
+ * @param hy           y-components of the headings (results)
+ * @param hz           z-components of the headings (results)
+ */
+void TropismTrials::getHeadings(const Matrix3d& old, std::vector<double>& hx, std::vector<double>& hy, std::vector<double>& hz) const
+{
+    size_t n = x.size();
+    hx.resize(n);
+    hy.resize(n);
+    hz.resize(n);
+    old.times(x.data(), y.data(), z.data(), n, hx.data(), hy.data(), hz.data()); // same order of operations as Matrix3d::times
+}
+
+/**
+ * Z-components of the global headings of all trials, call TropismTrials::update first
+ *
+ * @param old          rotation matrix, heading is old(:,1)
+ * @param hz           z-components of the headings (results)
+ */
+void TropismTrials::getHeadingsZ(const Matrix3d& old, std::vector<double>& hz) const
+{
+    size_t n = x.size();
+    hz.resize(n);
+    old.r2.times(x.data(), y.data(), z.data(), n, hz.data());
+}
+
 /**
  * Copies this tropism
  */
@@ -19,6 +61,17 @@ Tropism* Tropism::copy(Organism* plant)
     return nt;
 }
 
+/**
+ * @return the plant of the organ @param o, or the plant of the tropism if o is nullptr
+ */
+Organism* Tropism::getPlant(const Organ* o) const
+{
+    if (o!=nullptr) {
+        return o->getOrganism();
+    }
+    return plant;
+}
+
 /**
  * Applies angles a and b and goes dx [cm] into the new direction and returns the new position
  *
@@ -32,7 +85,7 @@ Tropism* Tropism::copy(Organism* plant)
  */
 Vector3d Tropism::getPosition(const Vector3d& pos, Matrix3d old, double a, double b, double dx)
 {
-    return pos.plus((old.times(Vector3d::rotAB(a,b))).times(dx));
+    return old.step(pos, a, b, dx);
 }
 
 /**
@@ -47,9 +100,9 @@ Vector3d Tropism::getPosition(const Vector3d& pos, Matrix3d old, double a, doubl
  */
 Vector2d Tropism::getUCHeading(const Vector3d& pos, Matrix3d old, double dx,const Organ* o)
 {
+    Organism* plant = getPlant(o);
     double a = sigma*plant->randn()*sqrt(dx);
     double b = plant->rand()*2*M_PI;
-    double v;
 
     double n_=n*sqrt(dx);
     if (n_>0) {
@@ -59,26 +112,55 @@ Vector2d Tropism::getUCHeading(const Vector3d& pos, Matrix3d old, double dx,cons
         } else {
             n_ = floor(n_);
         }
-        double bestA = a;
-        double bestB = b;
-        double bestV = this->tropismObjective(pos,old,a,b,dx,o);
-        for (int i=0; i<n_; i++) {
+        thread_local TropismTrials trials; // buffers are reused, tropisms are shared by the threads of the simulation
+        thread_local std::vector<double> v;
+        trials.clear();
+        trials.add(a, b);
+        for (int i=0; i<n_; i++) { // dice all trials first, in the same order as the sequential optimization
             b = plant->rand()*2*M_PI;
             a = sigma*plant->randn()*sqrt(dx);
-            v = this->tropismObjective(pos,old,a,b,dx,o);
-            if (v<bestV) {
-                bestV=v;
-                bestA=a;
-                bestB=b;
+            trials.add(a, b);
+        }
+        trials.update();
+        this->tropismObjectives(pos, old, trials, dx, o, v);
+        Instrumentation& stats = plant->getInstrumentation();
+        if (stats.isEnabled()) {
+            stats.count((o!=nullptr) ? o->organType() : Organism::ot_organ, Instrumentation::c_objectives, trials.size());
+        }
+        size_t best = 0;
+        for (size_t i=1; i<trials.size(); i++) { // the first best trial wins
+            if (v[i]<v[best]) {
+                best = i;
             }
         }
-        a = bestA;
-        b = bestB;
+        a = trials.a[best];
+        b = trials.b[best];
     }
 
     return Vector2d(a,b);
 }
 
+/**
+ * Evaluates the objective function for all trials of one step of getUCHeading().
+ * The default implementation calls tropismObjective() for each trial,
+ * overwrite it to evaluate the trials together (e.g. using the precomputed directions of the trials).
+ *
+ * @param pos          current root tip position
+ * @param old          rotation matrix, old(:,1) is the root tip heading
+ * @param trials       the trials, with updated local directions (@see TropismTrials::update)
+ * @param dx           small distance to look ahead
+ * @param o            points to the root that called getHeading
+ * @param v            objective function values of the trials (results)
+ */
+void Tropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    v.resize(trials.size());
+    for (size_t i=0; i<trials.size(); i++) {
+        v[i] = this->tropismObjective(pos, old, trials.a[i], trials.b[i], dx, o);
+    }
+}
+
 /**
  * Inside the geometric domain baseTropism::getHeading() is returned.
  * In case geometric boundaries are hit, the rotations are modified, so that growth stays inside the domain.
@@ -92,14 +174,19 @@ Vector2d Tropism::getUCHeading(const Vector3d& pos, Matrix3d old, double dx,cons
  */
 Vector2d Tropism::getHeading(const Vector3d& pos, Matrix3d old, double dx, const Organ* o)
 {
+    Organism* plant = getPlant(o);
+    Instrumentation& stats = plant->getInstrumentation();
+    int ot = (stats.isEnabled() && (o!=nullptr)) ? o->organType() : Organism::ot_organ;
+    Instrumentation::Timer timer(stats, ot, Instrumentation::p_heading);
     // std::cout << "n " << n << ", " << sigma << "\n";
     Vector2d h = this->getUCHeading(pos, old, dx, o);
     double a = h.x;
     double b = h.y;
 
     if (geometry!=nullptr) {
-        double d = geometry->getDist(this->getPosition(pos,old,a,b,dx));
+        double d = compiledGeometry.getDist(this->getPosition(pos,old,a,b,dx));
         double dmin = d;
+        long evaluations = 1;
 
         double bestA = a;
         double bestB = b;
@@ -112,7 +199,8 @@ Vector2d Tropism::getHeading(const Vector3d& pos, Matrix3d old, double dx, const
             while ((d>0) && j<betaN) { // change beta
 
                 b = 2*M_PI*plant->rand(); // dice
-                d = geometry->getDist(this->getPosition(pos,old,a,b,dx));
+                d = compiledGeometry.getDist(this->getPosition(pos,old,a,b,dx));
+                evaluations++;
                 if (d<dmin) {
                     dmin = d;
                     bestA = a;
@@ -127,18 +215,51 @@ Vector2d Tropism::getHeading(const Vector3d& pos, Matrix3d old, double dx, const
 
             if (i>alphaN) {
                 std::cout << "Could not respect geometry boundaries \n";
+                if (stats.isEnabled()) {
+                    stats.count(ot, Instrumentation::c_boundaryFailures);
+                }
                 a = bestA;
                 b = bestB;
                 break;
             }
 
         }
+        if (stats.isEnabled()) {
+            stats.count(ot, Instrumentation::c_sdf, evaluations);
+            stats.count(ot, Instrumentation::c_rejected, (d>0) ? evaluations : evaluations-1); // all but the accepted one
+        }
     }
     return Vector2d(a,b);
 }
 
 
 
+/**
+ * Batch evaluation, @see Tropism::tropismObjectives
+ */
+void Gravitropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    trials.getHeadingsZ(old, v);
+    for (size_t i=0; i<v.size(); i++) {
+        v[i] = 0.5*(v[i]+1.);
+    }
+}
+
+/**
+ * Batch evaluation, @see Tropism::tropismObjectives
+ */
+void Plagiotropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    trials.getHeadingsZ(old, v);
+    for (size_t i=0; i<v.size(); i++) {
+        v[i] = std::abs(v[i]);
+    }
+}
+
+
+
 /**
  * getHeading() minimizes this function, @see TropismFunction::tropismObjective
  */
@@ -151,6 +272,26 @@ double Exotropism::tropismObjective(const Vector3d& pos, Matrix3d old, double a,
     return acos(s)/M_PI; // 0..1
 }
 
+/**
+ * Batch evaluation, @see Tropism::tropismObjectives
+ */
+void Exotropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    thread_local std::vector<double> hx, hy, hz;
+    Vector3d iheading = ((Root*)o)->iHeading;
+    double f1 = 1./iheading.length();
+    double f2 = 1./old.column(0).length();
+    trials.getHeadings(old, hx, hy, hz);
+    v.resize(trials.size());
+    for (size_t i=0; i<trials.size(); i++) {
+        double s = hx[i]*iheading.x+hy[i]*iheading.y+hz[i]*iheading.z;
+        s*=f1;
+        s*=f2;
+        v[i] = acos(s)/M_PI;
+    }
+}
+
 
 
 /**
@@ -160,11 +301,33 @@ double Hydrotropism::tropismObjective(const Vector3d& pos, Matrix3d old, double
 {
     assert(soil!=nullptr);
     Vector3d newpos = this->getPosition(pos,old,a,b,dx);
-    double v = soil->getValue(newpos,o);
+    thread_local SoilLookUp::Sample sample; // trials of the same tip mostly hit the same cell
+    double v = soil->getCachedValue(newpos, o, sample);
     // std::cout << "\n" << newpos.getString() << ", = "<< v;
     return -v; ///< (-1) because we want to maximize the soil property
 }
 
+/**
+ * Batch evaluation, @see Tropism::tropismObjectives
+ */
+void Hydrotropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    assert(soil!=nullptr);
+    thread_local std::vector<double> hx, hy, hz;
+    thread_local std::vector<Vector3d> newpos;
+    trials.getHeadings(old, hx, hy, hz);
+    newpos.resize(trials.size());
+    for (size_t i=0; i<trials.size(); i++) {
+        newpos[i] = pos.plus(Vector3d(hx[i]*dx, hy[i]*dx, hz[i]*dx));
+    }
+    thread_local SoilLookUp::Sample sample;
+    soil->getCachedValues(newpos, v, o, sample); // all trials in one soil look up
+    for (auto& vi : v) {
+        vi = -vi;
+    }
+}
+
 
 
 /**
@@ -200,4 +363,49 @@ double CombinedTropism::tropismObjective(const Vector3d& pos, Matrix3d old, doub
     return v;
 }
 
+/**
+ * Batch evaluation, the weighted sum of the batch evaluations of the tropisms, @see Tropism::tropismObjectives
+ */
+void CombinedTropism::tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+    std::vector<double>& v)
+{
+    thread_local std::vector<double> vi;
+    tropisms[0]->tropismObjectives(pos, old, trials, dx, o, v);
+    for (size_t j=0; j<v.size(); j++) {
+        v[j] *= weights[0];
+    }
+    for (size_t i = 1; i< tropisms.size(); i++) {
+        tropisms[i]->tropismObjectives(pos, old, trials, dx, o, vi);
+        for (size_t j=0; j<v.size(); j++) {
+            v[j] += vi[j]*weights[i];
+        }
+    }
+}
+
+
+
+/**
+ * Initial heading of the root, @see Exotropism::tropismObjectives
+ */
+void ExotropismTerm::prepare(const TropismKernel& k, State& s) const
+{
+    s.iheading = ((Root*)k.o)->iHeading;
+    s.f1 = 1./s.iheading.length();
+    s.f2 = 1./k.old.column(0).length();
+}
+
+/**
+ * Soil values at the look ahead positions of all trials, @see Hydrotropism::tropismObjectives
+ */
+void HydrotropismTerm::prepare(const TropismKernel& k, State& s) const
+{
+    assert(soil!=nullptr);
+    s.newpos.resize(k.n);
+    for (size_t i=0; i<k.n; i++) {
+        s.newpos[i] = k.pos.plus(Vector3d(k.hx[i]*k.dx, k.hy[i]*k.dx, k.hz[i]*k.dx));
+    }
+    thread_local SoilLookUp::Sample sample;
+    soil->getCachedValues(s.newpos, s.v, k.o, sample);
+}
+
 } // end namespace CRootBox
@@ -3,6 +3,7 @@
 #define TROPISM_H
 
 #include "mymath.h"
+#include "sdf.h"
 
 #include <chrono>
 #include <iostream>
@@ -11,10 +12,29 @@
 namespace CRootBox {
 
 class SoilLookUp;
-class SignedDistanceFunction;
 class Organ;
 class Organism;
 
+/**
+ * The trial rotations of one step of Tropism::getUCHeading as structure of arrays,
+ * the trigonometric functions are evaluated once per trial (see TropismTrials::update)
+ */
+struct TropismTrials
+{
+    std::vector<double> a; ///< rotation angles alpha (angular change)
+    std::vector<double> b; ///< rotation angles beta (radial change)
+    std::vector<double> x, y, z; ///< local directions Vector3d::rotAB(a,b)
+
+    size_t size() const { return a.size(); } ///< number of trials
+    void clear() { a.clear(); b.clear(); } ///< removes all trials
+    void add(double a_, double b_) { a.push_back(a_); b.push_back(b_); } ///< adds a trial
+    void update(); ///< evaluates the local directions of all trials
+
+    void getHeadings(const Matrix3d& old, std::vector<double>& hx, std::vector<double>& hy, std::vector<double>& hz) const;
+    ///< global headings old*rotAB(a,b) of all trials
+    void getHeadingsZ(const Matrix3d& old, std::vector<double>& hz) const; ///< z-components of the global headings
+};
+
 /**
  * Base class for all tropism functions, e.g. Gravitropism, Plagiotropism, Exotropism...
  */
@@ -38,7 +58,8 @@ public:
     virtual Tropism* copy(Organism* plant); ///< copy object, factory method
 
     /* parameters */
-    void setGeometry(SignedDistanceFunction* geom) { geometry = geom; } ///< sets a confining geometry
+    void setGeometry(SignedDistanceFunction* geom) { geometry = geom; compiledGeometry = SDF_Compiled(geom); }
+    ///< sets a confining geometry, the geometry is compiled (@see SDF_Compiled), set it again after changing it
     void setTropismParameter(double n_,double sigma_) { n=n_; sigma=sigma_; } ///< sets the tropism parameters
 
     virtual Vector2d getHeading(const Vector3d& pos, Matrix3d old,  double dx, const Organ* o = nullptr);
@@ -61,17 +82,24 @@ public:
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) { std::cout << "TropismFunction::tropismObjective() not overwritten\n"; return 0; }
     ///< The objective function of the random optimization of getHeading().
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v);
+    ///< Evaluates the objective function for all trials of one step, overwrite for a faster batch evaluation
+
     static Vector3d getPosition(const Vector3d& pos, Matrix3d old, double a, double b, double dx);
     ///< Auxiliary function: Applies angles a and b and goes dx [cm] into the new direction
 
 protected:
 
-    Organism* plant;
+    Organism* getPlant(const Organ* o) const; ///< the plant of the organ, that draws the random numbers (the tropism is shared by copies of the plant)
+
+    Organism* plant; ///< the plant that created the tropism, used if there is no organ
 
     double n; ///< Number of trials
     double sigma; ///< Standard deviation
 
     SignedDistanceFunction* geometry; ///< confining geometry
+    SDF_Compiled compiledGeometry; ///< confining geometry as flat program
     const int alphaN = 20;
     const int betaN = 5;
 
@@ -96,10 +124,13 @@ public:
     } ///< copy constructor
 
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override {
-        return 0.5*(old.times(Vector3d::rotAB(a,b)).z+1.); // negative values point downwards, transformed to 0..1
+        return 0.5*(old.timesRotAB(a,b).z+1.); // negative values point downwards, transformed to 0..1
     }
     ///< TropismFunction::getHeading minimizes this function, @see TropismFunction::getHeading and @see TropismFunction::tropismObjective
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override; ///< batch evaluation, @see Tropism::tropismObjectives
+
 
 
 };
@@ -123,10 +154,13 @@ public:
     } ///< copy constructor
 
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override {
-        return std::abs(old.times(Vector3d::rotAB(a,b)).z); // 0..1
+        return std::abs(old.timesRotAB(a,b).z); // 0..1
     }
     ///< getHeading() minimizes this function, @see TropismFunction
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override; ///< batch evaluation, @see Tropism::tropismObjectives
+
 };
 
 
@@ -150,6 +184,9 @@ public:
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override;
     ///< getHeading() minimizes this function, @see TropismFunction
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override; ///< batch evaluation, @see Tropism::tropismObjectives
+
 };
 
 
@@ -173,6 +210,9 @@ public:
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override;
     ///< getHeading() minimizes this function, @see TropismFunction
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override; ///< batch evaluation, @see Tropism::tropismObjectives
+
 private:
     SoilLookUp* soil;
 };
@@ -208,11 +248,185 @@ public:
     virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override;
     ///< getHeading() minimizes this function, @see TropismFunction
 
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override; ///< batch evaluation, @see Tropism::tropismObjectives
+
 private:
     std::vector<Tropism*> tropisms;
     std::vector<double> weights;
 };
 
+
+
+/**
+ * The trials of one step of Tropism::getUCHeading, as seen by the objective terms of a ComposedTropism:
+ * the global headings of the n trials (hx and hy are only set, if a term needs them, see ComposedTropism)
+ */
+struct TropismKernel
+{
+    const Vector3d& pos; ///< current root tip position
+    const Matrix3d& old; ///< rotation matrix, old(:,1) is the root tip heading
+    double dx; ///< small distance to look ahead
+    const Organ* o; ///< the root that called getHeading
+    const double* hx; ///< x-components of the global headings
+    const double* hy; ///< y-components of the global headings
+    const double* hz; ///< z-components of the global headings
+    size_t n; ///< number of trials
+};
+
+/**
+ * Objective terms of the built-in tropisms, for the composition at compile time (see ComposedTropism).
+ *
+ * A term has a State (buffers of one evaluation, owned by the calling thread), prepare() evaluates everything
+ * of the trials that is not per trial (e.g. the soil look up of all trials), and value() is the objective of
+ * trial i, inlined into the loop over the trials. needsXY is false, if the term only needs the z-components of the headings.
+ * Each term gives the same values as the batch evaluation of its tropism class.
+ */
+struct GravitropismTerm
+{
+    struct State { };
+    static constexpr bool needsXY = false;
+    void prepare(const TropismKernel& k, State& s) const { }
+    double value(const TropismKernel& k, const State& s, size_t i) const { return 0.5*(k.hz[i]+1.); } ///< @see Gravitropism
+};
+
+struct PlagiotropismTerm
+{
+    struct State { };
+    static constexpr bool needsXY = false;
+    void prepare(const TropismKernel& k, State& s) const { }
+    double value(const TropismKernel& k, const State& s, size_t i) const { return std::abs(k.hz[i]); } ///< @see Plagiotropism
+};
+
+struct ExotropismTerm
+{
+    struct State {
+        Vector3d iheading;
+        double f1 = 1.; ///< inverse length of the initial heading
+        double f2 = 1.; ///< inverse length of the heading
+    };
+    static constexpr bool needsXY = true;
+    void prepare(const TropismKernel& k, State& s) const;
+    double value(const TropismKernel& k, const State& s, size_t i) const { ///< @see Exotropism
+        double c = k.hx[i]*s.iheading.x+k.hy[i]*s.iheading.y+k.hz[i]*s.iheading.z;
+        c*=s.f1;
+        c*=s.f2;
+        return acos(c)/M_PI;
+    }
+};
+
+struct HydrotropismTerm
+{
+    HydrotropismTerm(SoilLookUp* soil) :soil(soil) { }
+    struct State {
+        std::vector<Vector3d> newpos;
+        std::vector<double> v; ///< soil values at the positions of the trials
+    };
+    static constexpr bool needsXY = true;
+    void prepare(const TropismKernel& k, State& s) const; ///< a single soil look up for all trials
+    double value(const TropismKernel& k, const State& s, size_t i) const { return -s.v[i]; } ///< @see Hydrotropism
+    SoilLookUp* soil;
+};
+
+/**
+ * Weighted sum w1*t1+w2*t2 of two objective terms, is a term itself, e.g.
+ * TropismSum<TropismSum<GravitropismTerm, ExotropismTerm>, HydrotropismTerm> (see ComposedTropism)
+ */
+template<class T1, class T2>
+struct TropismSum
+{
+    TropismSum(const T1& t1, double w1, const T2& t2, double w2) :t1(t1), t2(t2), w1(w1), w2(w2) { }
+    struct State {
+        typename T1::State s1;
+        typename T2::State s2;
+    };
+    static constexpr bool needsXY = T1::needsXY || T2::needsXY;
+    void prepare(const TropismKernel& k, State& s) const {
+        t1.prepare(k, s.s1);
+        t2.prepare(k, s.s2);
+    }
+    double value(const TropismKernel& k, const State& s, size_t i) const {
+        return t1.value(k, s.s1, i)*w1+t2.value(k, s.s2, i)*w2; // same order of operations as CombinedTropism
+    }
+    T1 t1;
+    T2 t2;
+    double w1, w2;
+};
+
+/**
+ * A tropism with an objective term composed at compile time (from the terms of the built-in tropisms and TropismSum),
+ * instead of the virtual calls of CombinedTropism. The headings of the trials are computed once, and the objective
+ * of all terms is evaluated in a single loop over the trials, that the compiler can inline.
+ *
+ * Gives the same headings as the CombinedTropism of the respective tropisms.
+ */
+template<class Term>
+class ComposedTropism : public Tropism
+{
+
+public:
+
+    ComposedTropism(Organism* plant, double n, double sigma, const Term& term) : Tropism(plant, n, sigma), term(term) { }
+    ///< @see TropismFunction
+
+    virtual Tropism* copy(Organism* plant) override {
+        ComposedTropism* nt = new ComposedTropism(*this); // default copy constructor
+        nt->plant = plant;
+        return nt;
+    } ///< copy constructor
+
+    virtual double tropismObjective(const Vector3d& pos, Matrix3d old, double a, double b, double dx, const Organ* o = nullptr) override {
+        Vector3d h = old.timesRotAB(a, b);
+        TropismKernel k = { pos, old, dx, o, &h.x, &h.y, &h.z, 1 };
+        typename Term::State s;
+        term.prepare(k, s);
+        return term.value(k, s, 0);
+    }
+    ///< getHeading() minimizes this function, @see TropismFunction
+
+    virtual void tropismObjectives(const Vector3d& pos, const Matrix3d& old, const TropismTrials& trials, double dx, const Organ* o,
+        std::vector<double>& v) override {
+        thread_local std::vector<double> hx, hy, hz;
+        thread_local typename Term::State s;
+        if (Term::needsXY) {
+            trials.getHeadings(old, hx, hy, hz);
+        } else {
+            trials.getHeadingsZ(old, hz);
+        }
+        TropismKernel k = { pos, old, dx, o, hx.data(), hy.data(), hz.data(), trials.size() };
+        term.prepare(k, s);
+        v.resize(trials.size());
+        for (size_t i=0; i<trials.size(); i++) {
+            v[i] = term.value(k, s, i);
+        }
+    } ///< batch evaluation, @see Tropism::tropismObjectives
+
+    const Term& getTerm() const { return term; } ///< the composed objective term
+
+protected:
+    Term term;
+};
+
+/**
+ * Hydrotropism combined with gravitropism (the tropism type tt_hydro of RootSystem::createTropismFunction)
+ */
+class HydroGravitropism : public ComposedTropism<TropismSum<HydrotropismTerm, GravitropismTerm>>
+{
+
+public:
+
+    HydroGravitropism(Organism* plant, double n, double sigma, SoilLookUp* soil, double wh = 10., double wg = 1.) :
+        ComposedTropism(plant, n, sigma, TropismSum<HydrotropismTerm, GravitropismTerm>(HydrotropismTerm(soil), wh, GravitropismTerm(), wg)) { }
+    ///< the weighted sum wh*hydrotropism+wg*gravitropism
+
+    virtual Tropism* copy(Organism* plant) override {
+        HydroGravitropism* nt = new HydroGravitropism(*this); // default copy constructor
+        nt->plant = plant;
+        return nt;
+    } ///< copy constructor
+
+};
+
 } // end namespace CRootBox
 
 #endif
@@ -0,0 +1,169 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#include "vtpwriter.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace CRootBox {
+
+/**
+ * @param os        typically a file out stream (opened in binary mode for the binary formats)
+ * @param format    VTPWriter::ascii, VTPWriter::binary, or VTPWriter::compressed
+ */
+VTPWriter::VTPWriter(std::ostream& os, int format) :os(os), format(format)
+{
+    if ((format<ascii) || (format>compressed)) {
+        throw std::invalid_argument("VTPWriter::VTPWriter: unknown format");
+    }
+    if ((format==compressed) && !hasCompression()) {
+        throw std::invalid_argument("VTPWriter::VTPWriter: CRootBox was built without zlib, compressed format is not available");
+    }
+}
+
+/**
+ * @return true, if CRootBox was built with zlib, i.e. VTPWriter::compressed is available
+ */
+bool VTPWriter::hasCompression()
+{
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Writes the xml header, and opens the PolyData tag
+ */
+void VTPWriter::begin()
+{
+    os << "<?xml version=\"1.0\"?>";
+    os << "<VTKFile type=\"PolyData\" version=\"0.1\" byte_order=\"LittleEndian\"";
+    if (format!=ascii) {
+        os << " header_type=\"UInt32\"";
+    }
+    if (format==compressed) {
+        os << " compressor=\"vtkZLibDataCompressor\"";
+    }
+    os << ">\n";
+    os << "<PolyData>\n";
+}
+
+/**
+ * Writes a floating point data array
+ *
+ * @param name          name of the array
+ * @param components    number of components per tuple (e.g. 3 for coordinates)
+ * @param data          values
+ * @param type          "Float32" (default) or "Float64"
+ */
+void VTPWriter::dataArray(std::string name, int components, const std::vector<double>& data, std::string type)
+{
+    tag(type, name, components);
+    if (format==ascii) {
+        for (const auto& d : data) {
+            os << d << " ";
+        }
+        os << "\n</DataArray>\n";
+    } else if (type=="Float64") {
+        appendBlock(reinterpret_cast<const char*>(data.data()), data.size()*sizeof(double));
+    } else if (type=="Float32") {
+        std::vector<float> f(data.begin(), data.end());
+        appendBlock(reinterpret_cast<const char*>(f.data()), f.size()*sizeof(float));
+    } else {
+        throw std::invalid_argument("VTPWriter::dataArray: unknown data type " + type);
+    }
+}
+
+/**
+ * Writes an Int32 data array
+ *
+ * @param name          name of the array
+ * @param components    number of components per tuple
+ * @param data          values
+ */
+void VTPWriter::dataArray(std::string name, int components, const std::vector<int>& data)
+{
+    tag("Int32", name, components);
+    if (format==ascii) {
+        for (const auto& d : data) {
+            os << d << " ";
+        }
+        os << "\n</DataArray>\n";
+    } else {
+        std::vector<int32_t> i(data.begin(), data.end());
+        appendBlock(reinterpret_cast<const char*>(i.data()), i.size()*sizeof(int32_t));
+    }
+}
+
+/**
+ * Closes the PolyData tag, writes the appended data (binary formats), and closes the VTKFile tag
+ */
+void VTPWriter::end()
+{
+    os << "</PolyData>\n";
+    if (format!=ascii) {
+        os << "<AppendedData encoding=\"raw\">\n_";
+        os.write(appended.data(), appended.size());
+        os << "\n</AppendedData>\n";
+        appended.clear();
+    }
+    os << "</VTKFile>\n";
+}
+
+/**
+ * Writes the opening tag of a data array, that is closed inline (ascii), or refers to the appended data
+ */
+void VTPWriter::tag(std::string type, std::string name, int components)
+{
+    os << "<DataArray type=\"" << type << "\" Name=\"" << name << "\" NumberOfComponents=\"" << components << "\" format=\"";
+    if (format==ascii) {
+        os << "ascii\" >\n";
+    } else {
+        os << "appended\" offset=\"" << appended.size() << "\" />\n";
+    }
+}
+
+/**
+ * Appends a block of binary data. Uncompressed, the block is preceded by its size in bytes.
+ * Compressed, the data is split into 32 kB blocks, preceded by the header
+ * [number of blocks, block size, size of the last partial block (or 0), compressed size of each block].
+ */
+void VTPWriter::appendBlock(const char* data, size_t size)
+{
+    if (format==binary) {
+        uint32_t n = size;
+        appended.append(reinterpret_cast<const char*>(&n), sizeof(n));
+        appended.append(data, size);
+        return;
+    }
+#ifdef HAVE_ZLIB
+    const size_t blockSize = 32768;
+    size_t nob = (size+blockSize-1)/blockSize;
+    std::vector<uint32_t> header(3+nob);
+    header[0] = nob;
+    header[1] = blockSize;
+    header[2] = size%blockSize;
+    std::string blocks;
+    std::vector<Bytef> buffer(compressBound(blockSize));
+    for (size_t i=0; i<nob; i++) {
+        uLong n = std::min(blockSize, size-i*blockSize);
+        uLongf cn = buffer.size();
+        if (compress2(buffer.data(), &cn, reinterpret_cast<const Bytef*>(data+i*blockSize), n, Z_DEFAULT_COMPRESSION)!=Z_OK) {
+            throw std::runtime_error("VTPWriter::appendBlock: zlib compression failed");
+        }
+        header[3+i] = cn;
+        blocks.append(reinterpret_cast<const char*>(buffer.data()), cn);
+    }
+    appended.append(reinterpret_cast<const char*>(header.data()), header.size()*sizeof(uint32_t));
+    appended.append(blocks);
+#endif
+}
+
+} // end namespace CRootBox
@@ -0,0 +1,49 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+#ifndef VTPWRITER_H_
+#define VTPWRITER_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace CRootBox {
+
+/**
+ * VTPWriter
+ *
+ * Writes the header, the data arrays, and the footer of a VTP (VTK polydata) file.
+ * The caller writes the remaining tags (Piece, PointData, CellData, Points, Lines) directly to the stream.
+ *
+ * In ascii format the data arrays are written inline. In binary format they are collected and written as
+ * raw appended data at the end of the file, optionally compressed with zlib (VTK's vtkZLibDataCompressor).
+ * All formats use the same data array types and names, so files can be opened in the same ParaView pipelines.
+ */
+class VTPWriter
+{
+public:
+
+    enum Format { ascii = 0, binary = 1, compressed = 2 }; ///< vtp data array formats
+
+    VTPWriter(std::ostream& os, int format = ascii); ///< the stream must outlive the writer
+
+    void begin(); ///< writes the xml header, up to the PolyData tag
+    void dataArray(std::string name, int components, const std::vector<double>& data, std::string type = "Float32"); ///< writes a Float32 or Float64 data array
+    void dataArray(std::string name, int components, const std::vector<int>& data); ///< writes an Int32 data array
+    void end(); ///< closes the PolyData tag, and writes the appended data
+
+    static bool hasCompression(); ///< true, if CRootBox was built with zlib
+
+protected:
+
+    void appendBlock(const char* data, size_t size); ///< appends a block of binary data, with its header
+    void tag(std::string type, std::string name, int components); ///< opening tag of a data array
+
+    std::ostream& os;
+    int format;
+    std::string appended; ///< appended data (binary formats)
+
+};
+
+} // end namespace CRootBox
+
+#endif
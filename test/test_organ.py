@@ -99,6 +99,11 @@ class TestOrgan(unittest.TestCase):
         self.assertEqual(o0, 0, "wrong order")
         self.assertEqual(o1, 1, "wrong order")
         self.assertEqual(o2, 1, "wrong order")
+        id = rb.Organ.parameterId("order")
+        self.assertEqual(rb.Organ.parameterName(id), "order", "wrong parameter name")
+        self.assertEqual(self.thumb.getParameter(id), o2, "interned id and name disagree")
+        organs = self.hand.getOrgans()
+        self.assertEqual(list(rb.Organ.getParameters(id, organs)), [o.getParameter("order") for o in organs], "wrong parameter column")
 
     def test_dynamics(self):
         """ tests if nodes created in last time step are correct """  #
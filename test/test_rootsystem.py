@@ -1,8 +1,22 @@
+import os
+import shutil
+import tempfile
 import unittest
 import py_rootbox as rb
 from rsml import *
 from rb_tools import *
 
+outdir = tempfile.mkdtemp(prefix="test_rootsystem_")  # files written by the tests, removed after the tests
+
+
+def out(fname):
+    """ path of an output file in the temporary directory """
+    return os.path.join(outdir, fname)
+
+
+def tearDownModule():
+    shutil.rmtree(outdir, ignore_errors=True)
+
 
 def rootAge(l, r, k):  # root age at a certain length
     return -np.log(1 - l / k) * k / r
@@ -160,6 +174,41 @@ class TestRootSystem(unittest.TestCase):
         rs3.simulate(10)
         self.assertEqual(rs3.rand(), n2, "copy: simulation not deterministic")
 
+    def test_copy_parameters(self):
+        """ checks if copies share their parameters, until one is modified """
+        name = "Brassica_oleracea_Vansteenkiste_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(100)
+        rs.initialize()
+        rs.simulate(10)
+        rs2 = rb.RootSystem(rs)
+        rs3 = rb.RootSystem(rs)
+        r = rs.getRootTypeParameter(2).r
+        rs2.getRootTypeParameter(2).r = 0.  # copied on write
+        self.assertEqual(rs.getRootTypeParameter(2).r, r, "copy parameters: the original was modified")
+        self.assertEqual(rs3.getRootTypeParameter(2).r, r, "copy parameters: another copy was modified")
+        self.assertEqual(rs2.getRootTypeParameter(2).r, 0., "copy parameters: the copy was not modified")
+        del rs  # the copies own the shared parameters
+        rs3.simulate(10)
+        rs2.simulate(10)
+        self.assertLess(rs2.getSummed("length"), rs3.getSummed("length"), "copy parameters: the modification had no effect")
+
+    def test_copy_nodes(self):
+        """ checks if copies that share their nodes grow independently """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(1)
+        rs.initialize()
+        rs.simulate(20)
+        nodes = [str(n) for n in rs.getNodes()]
+        rs2 = rb.RootSystem(rs)
+        rs2.simulate(20)  # moves shared nodes of the copy
+        self.assertEqual([str(n) for n in rs.getNodes()], nodes, "copy nodes: the original was modified")
+        rs.simulate(20)
+        self.assertEqual([str(n) for n in rs.getNodes()], [str(n) for n in rs2.getNodes()], "copy nodes: copies grow differently")
+
     def test_polylines(self):
         """checks if the polylines have the right tips and bases """
         name = "Brassica_napus_a_Leitner_2010"
@@ -244,6 +293,93 @@ class TestRootSystem(unittest.TestCase):
         uneq = np.sum(seg_ != seg) / 2
         self.assertEqual(uneq, 0, "incremental growth: segment lists are not equal")
 
+    def test_dry_run(self):
+        """ checks that the dry run predicts the length increment, and leaves the root system unchanged """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        for i in range(0, 10):
+            rs.simulate(1)
+        n, l = rs.getNumberOfNodes(), rs.getSummed("length")
+        inc = rs.simulateDry(1)
+        self.assertEqual(rs.getNumberOfNodes(), n, "dry run: nodes were created")
+        self.assertEqual(rs.getSummed("length"), l, "dry run: root system was changed")
+        rs.simulate(1)
+        self.assertAlmostEqual(rs.getSummed("length") - l, inc, 8, "dry run: wrong length increment")
+        rs = rb.RootSystem()  # the random numbers differ from the real step, the increment is an estimate
+        rs.readParameters("modelparameter/Anagallis_femina_Leitner_2010.xml")
+        rs.setSeed(3)
+        rs.initialize()
+        for i in range(0, 20):
+            l = rs.getSummed("length")
+            inc = rs.simulateDry(1)
+            rs.simulate(1)
+            self.assertLess(abs(rs.getSummed("length") - l - inc), 0.1 * inc + 1.e-9, "dry run: the estimate is too far off")
+
+    def test_maximal_increase(self):
+        """ checks that the scaled time step meets the maximal increase, including the emerging laterals """
+        for name, seed, maxinc, tol in [("Anagallis_femina_Leitner_2010", 3, 10., 0.25), ("Zea_mays_1_Leitner_2010", 1, 20., 0.05)]:
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.setSeed(seed)
+            rs.initialize()
+            se = rb.ProportionalElongation()
+            for p in rs.getRootTypeParameter():  # including the types created by initialize
+                p.f_se = se
+            incs = []
+            for i in range(0, 20):
+                l = rs.getSummed("length")
+                rs.simulate(1., maxinc, se)
+                inc = rs.getSummed("length") - l
+                self.assertLessEqual(inc, (1. + tol) * maxinc, "maximal increase: " + name + " grew too much on day " + str(i + 1))
+                incs.append(inc)
+            mean = sum(incs[10:]) / 10.  # the dry run correction is an estimate, with other random numbers
+            self.assertAlmostEqual(mean / maxinc, 1., delta = 0.05, msg = "maximal increase: " + name + " is not met")
+
+    def test_checkpoints(self):
+        """ checks that nested push and pop restore the root system, including the random numbers """
+        name = "Zea_mays_4_Leitner_2014"
+        ref, rs = rb.RootSystem(), rb.RootSystem()
+        for r in [ref, rs]:
+            r.readParameters("modelparameter/" + name + ".xml")
+            r.setSeed(3)
+            r.initialize()
+        for i in range(0, 15):
+            ref.simulate(1)
+            rs.push()
+            rs.simulate(2)
+            rs.push()
+            rs.simulate(1)
+            rs.pop()
+            rs.simulate(1)
+            rs.pop()
+            rs.simulate(1)
+        n, n_ = ref.getNodes(), rs.getNodes()
+        self.assertEqual(len(n), len(n_), "checkpoints: wrong number of nodes")
+        self.assertEqual([(v.x, v.y, v.z) for v in n], [(v.x, v.y, v.z) for v in n_], "checkpoints: nodes differ")
+        self.assertEqual(ref.getNumberOfRoots(True), rs.getNumberOfRoots(True), "checkpoints: wrong number of roots")
+
+    def test_save_load(self):
+        """ checks that a root system restored from a binary file continues like the original """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(7)
+        rs.initialize()
+        rs.simulate(20)
+        rs.save(out("test_save_load.bin"))
+        rs2 = rb.RootSystem()
+        rs2.load(out("test_save_load.bin"))
+        self.assertEqual(rs2.getSimTime(), rs.getSimTime(), "save load: wrong simulation time")
+        self.assertEqual(rs2.getNumberOfNodes(), rs.getNumberOfNodes(), "save load: wrong number of nodes")
+        rs.simulate(10)
+        rs2.simulate(10)
+        n, n2 = rs.getNodes(), rs2.getNodes()
+        self.assertEqual(len(n), len(n2), "save load: wrong number of nodes after simulation")
+        self.assertEqual([(v.x, v.y, v.z) for v in n], [(v.x, v.y, v.z) for v in n2], "save load: nodes differ after simulation")
+        self.assertEqual(rs.getSummed("length"), rs2.getSummed("length"), "save load: lengths differ after simulation")
+
     def test_rsml(self):
         """ checks rsml functionality with Python rsml reader """
         name = "Anagallis_femina_Leitner_2010"
@@ -252,10 +388,1232 @@ class TestRootSystem(unittest.TestCase):
         rs.initialize()
         simtime = 60
         rs.simulate(simtime)
-        rs.writeRSML(name + ".rsml")
-        pl, props, funcs = read_rsml(name + ".rsml")
+        rs.writeRSML(out(name + ".rsml"))
+        pl, props, funcs = read_rsml(out(name + ".rsml"))
         # todo
 
+    def test_rsml_reader(self):
+        """ checks if the segments of a rsml file are read back """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(30)
+        rs.writeRSML(out(name + "_reader.rsml"))
+        reader = rb.RSMLReader(out(name + "_reader.rsml"))
+        self.assertEqual(len(reader.segments), len(rs.getSegments()), "rsml reader: wrong number of segments")
+        self.assertIn("subType", list(reader.getDataNames()), "rsml reader: missing root property")
+        ana = rb.SegmentAnalyser(reader)
+        self.assertAlmostEqual(ana.getSummed("subType"), rb.SegmentAnalyser(rs).getSummed("subType"), 10, "rsml reader: wrong sub types")
+        self.assertAlmostEqual(sum(reader.segCTs) / sum(rs.getSegmentCTs()), 1., 5, "rsml reader: wrong creation times")
+
+    def test_vtp(self):
+        """ checks if binary and compressed vtp files are written with the same arrays as ascii files """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(30)
+        formats = [rb.VTPFormat.ascii, rb.VTPFormat.binary]
+        if rb.VTPWriter.hasCompression():
+            formats.append(rb.VTPFormat.compressed)
+        sizes = []
+        for f in formats:
+            fname = out(name + "_" + str(int(f)) + ".vtp")
+            rs.write(fname, f)
+            with open(fname, "rb") as file:
+                data = file.read()
+            self.assertEqual(data.count(b"<DataArray"), 7, "vtp: wrong number of data arrays")
+            sizes.append(len(data))
+        for s in sizes[1:]:
+            self.assertLess(s, sizes[0], "vtp: binary file should be smaller than ascii file")
+
+    def test_timeseries(self):
+        """ checks if the streamed time series rebuilds the segments of each step """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        writer = rb.TimeSeriesWriter(out(name + ".series"), 4)
+        segs = []
+        for i in range(0, 10):
+            rs.simulate(1)
+            writer.write(rs)
+            segs.append(sorted([(s.x, s.y) for s in rs.getSegments()]))
+        writer.close()
+        reader = rb.TimeSeriesReader(out(name + ".series"))
+        self.assertEqual(reader.getNumberOfSteps(), 10, "time series: wrong number of steps")
+        for i in [9, 2, 5, 0]:
+            reader.read(i)
+            self.assertEqual(sorted([(s.x, s.y) for s in reader.getSegments()]), segs[i], "time series: segments differ")
+            self.assertEqual(reader.getTime(i), i + 1, "time series: wrong time")
+
+    def test_sdf_rootsystem(self):
+        """ checks if the incrementally updated root system distance equals a newly built one """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(1)
+        sdf = rb.SDF_RootSystem(rs, 0.5)
+        for i in range(0, 10):
+            rs.simulate(1)
+            sdf.update(rs)
+        new_sdf = rb.SDF_RootSystem(rs, 0.5)
+        for p in [rb.Vector3d(0, 0, -3), rb.Vector3d(1, 0.5, -10), rb.Vector3d(-2, 1, -20)]:
+            self.assertEqual(sdf.getDist(p), new_sdf.getDist(p), "sdf root system: distances differ")
+            nearest = sdf.getNearestSegments(p, 3)
+            d = [sdf.getSegmentDist(p, j) for j in nearest]
+            self.assertEqual(d, sorted(d), "sdf root system: nearest segments are not ordered")
+            for j in sdf.getSegmentsInRadius(p, d[0]):
+                self.assertLessEqual(sdf.getSegmentDist(p, j), d[0], "sdf root system: segment out of radius")
+
+    def test_sdf_cached(self):
+        """ checks the narrow band cache against the original geometry """
+        box = rb.SDF_PlantBox(10, 10, 20)
+        container = rb.SDF_PlantContainer(1, 1, 20, False)
+        tube = rb.SDF_RotateTranslate(container, 90, 0, rb.Vector3d(0, 10, -10))
+        geom = rb.SDF_Difference(box, tube)
+        cached = rb.SDF_Cached(geom, rb.Vector3d(-6, -6, -21), rb.Vector3d(6, 6, 1), 0.1, 0.5)
+        self.assertTrue(cached.isComplete(), "sdf cached: bricks were dropped")
+        self.assertLess(cached.getNumberOfBricks(), 0.75 * 15 * 15 * 28, "sdf cached: the band is not sparse")
+        for p in [rb.Vector3d(4.8, 0, -5), rb.Vector3d(0, -5.2, -12), rb.Vector3d(0, 0.3, -11.4), rb.Vector3d(1, 1, -25), rb.Vector3d(0, 0, -5)]:
+            d = geom.getDist(p)
+            if abs(d) < 0.5:
+                self.assertAlmostEqual(cached.getDist(p), d, 1, "sdf cached: interpolated distance differs")
+            else:
+                self.assertEqual(cached.getDist(p), d, "sdf cached: distance outside of the band differs")
+        small = rb.SDF_Cached(geom, rb.Vector3d(-6, -6, -21), rb.Vector3d(6, 6, 1), 0.1, 0.5, 100000)
+        self.assertFalse(small.isComplete(), "sdf cached: memory budget exceeded")
+        self.assertLessEqual(small.getMemory(), 100000, "sdf cached: memory budget exceeded")
+
+    def test_sdf_compiled(self):
+        """ checks the batch distances of the compiled geometry against the tree, for nested geometries """
+        xaxis, yaxis, zaxis = rb.SDF_Axis.xaxis, rb.SDF_Axis.yaxis, rb.SDF_Axis.zaxis
+        box = rb.SDF_PlantBox(4, 3, 10)
+        rt = rb.SDF_RotateTranslate(box, 30., xaxis, rb.Vector3d(1, 0, -2))
+        rt2 = rb.SDF_RotateTranslate(rt, 45., zaxis, rb.Vector3d(0, 1, -3))  # nested transformations
+        cont = rb.SDF_PlantContainer(3, 2, 15, False)
+        union = rb.SDF_Union(rt2, cont)
+        box2 = rb.SDF_PlantBox(6, 6, 30)  # the geometries hold raw pointers, keep all of them referenced
+        big = rb.SDF_RotateTranslate(box2, rb.Vector3d(0, 0, -1))
+        inter = rb.SDF_Intersection(union, big)
+        cont2 = rb.SDF_PlantContainer(1, 1, 8, True)
+        hole = rb.SDF_RotateTranslate(cont2, 20., yaxis, rb.Vector3d(0.5, 0, -4))
+        diff = rb.SDF_Difference(inter, hole)
+        box3 = rb.SDF_PlantBox(2, 2, 4)
+        comp = rb.SDF_Complement(box3)
+        small = rb.SDF_RotateTranslate(comp, 60., xaxis, rb.Vector3d(-1, 1, -6))
+        rt3 = rb.SDF_RotateTranslate(union, 90., yaxis, rb.Vector3d(0, 0, -5))
+        geoms = rb.std_vector_SDF_()
+        for g in [diff, small, rt3]:
+            geoms.append(g)
+        nested = rb.SDF_Intersection(geoms)
+        pos = rb.std_vector_Vector3d_()
+        for i in range(0, 600):  # more than one block of the batch evaluation
+            pos.append(rb.Vector3d(((7 * i) % 23) * 0.6 - 7., ((11 * i) % 19) * 0.6 - 6., -((13 * i) % 41) * 0.6 + 1.))
+        for geom in [rt2, union, inter, diff, small, nested]:
+            compiled = rb.SDF_Compiled(geom)
+            d = compiled.getDists(pos)
+            self.assertEqual(len(d), len(pos), "sdf compiled: wrong number of distances")
+            for i, p in enumerate(pos):
+                ref = geom.getDist(p)
+                self.assertAlmostEqual(d[i], ref, 10, "sdf compiled: batch distance differs from the tree " + str(geom))
+                self.assertAlmostEqual(compiled.getDist(p), ref, 10, "sdf compiled: distance differs from the tree " + str(geom))
+
+    def test_soil_values(self):
+        """ checks if the batch soil look up equals the point wise look up """
+        grid = rb.EquidistantGrid1D(-50, 0, 11)
+        for i in range(0, 11):
+            grid.data[i] = i / 10.
+        box = rb.SDF_PlantBox(6, 6, 20)
+        sdf = rb.SoilLookUpSDF(box, 1., 0.1, 0.5)
+        soil = rb.MultiplySoilLookUps(grid, sdf)
+        scale = rb.ProportionalElongation()
+        scale.setBaseLookUp(soil)
+        scale.setScale(0.5)
+        pos = rb.std_vector_Vector3d_()
+        for p in [rb.Vector3d(0, 0, -3), rb.Vector3d(1, 0.5, -10), rb.Vector3d(-2, 1, -25), rb.Vector3d(4, 0, -49)]:
+            pos.append(p)
+        for s in [grid, sdf, soil, scale]:
+            v = s.getValues(pos)
+            for i, p in enumerate(pos):
+                self.assertEqual(v[i], s.getValue(p), "soil values: batch and point wise look up differ")
+        grid3 = rb.EquidistantGrid3D(20, 20, 50, 5, 5, 11)
+        for k in range(0, 11):
+            for j in range(0, 5):
+                for i in range(0, 5):
+                    grid3.setData(i, j, k, i + 10 * j + 100 * k)
+        v = grid3.getValues(pos)
+        grid3.setBlocked(True)
+        self.assertEqual(list(v), list(grid3.getValues(pos)), "soil values: blocked layout changes the look up")
+        grid3.setInterpolation(True)
+        self.assertAlmostEqual(grid3.getValue(rb.Vector3d(-7.5, -10, -47.5)), 0.5 + 0.5 * 100, 10, "soil values: wrong interpolation")
+
+    def test_rasterize(self):
+        """ checks the voxel distribution of the root length """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(20)
+        ana = rb.SegmentAnalyser(rs)
+        l = ana.getSummed("length")
+        d = ana.distribution("length", 0., 100., 17, True)
+        self.assertAlmostEqual(sum(d), l, 10, "rasterize: vertical distribution does not sum up")
+        grid = rb.EquidistantGrid3D(100, 100, 100, 11, 12, 13)
+        ana.rasterize("length", grid, True)
+        self.assertAlmostEqual(sum(grid.data), l, 10, "rasterize: grid does not sum up")
+        data = list(grid.data)
+        ana.setNumberOfThreads(4)
+        ana.rasterize("length", grid, True)
+        self.assertEqual(data, list(grid.data), "rasterize: parallel result differs")
+        for name in ["length", "surface", "order", "age"]:
+            ana.setNumberOfThreads(0)
+            sequential = list(ana.getParameter(name))
+            ana.setNumberOfThreads(4)
+            self.assertEqual(sequential, list(ana.getParameter(name)), "getParameter: parallel result differs")
+
+    def test_segment_parameters(self):
+        """ checks the parameters evaluated once per organ against the parameters of the organs of the single segments """
+        import math
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(20)
+        ana = rb.SegmentAnalyser(rs)
+        ana.addSegments(rs)  # the segments of an organ are not consecutive
+        organs = list(rs.getSegmentOrigins()) * 2
+        n = len(ana.segments)
+        self.assertEqual(list(ana.getParameter("creationTime")), list(rs.getSegmentCTs()) * 2, "segment parameters: segments differ from the root system")
+        lengths, radii = [ana.getSegmentLength(i) for i in range(0, n)], [o.getParameter("radius") for o in organs]
+        for threads in [0, 4]:
+            ana.setNumberOfThreads(threads)
+            for p in ["radius", "order", "age", "subType", "id", "lb"]:
+                ref = [o.getParameter(p) for o in organs]
+                self.assertEqual(list(ana.getParameter(p)), ref, "segment parameters: wrong " + p + " with " + str(threads) + " threads")
+            self.assertEqual(list(ana.getParameter("length")), lengths, "segment parameters: wrong length")
+            for v, l, r in zip(ana.getParameter("surface"), lengths, radii):
+                self.assertAlmostEqual(v, 2 * math.pi * r * l, 12, "segment parameters: wrong surface")
+            for v, l, r in zip(ana.getParameter("volume"), lengths, radii):
+                self.assertAlmostEqual(v, math.pi * r * r * l, 12, "segment parameters: wrong volume")
+
+    def test_doussan(self):
+        """ checks the tree solver of the Doussan system against the sparse matrix """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(5)
+        d = rb.Doussan(rs, None)
+        d.kr = 1.e-4
+        age, kx = rb.std_vector_double_(), rb.std_vector_double_()
+        for a, k in [(0., 1.e-3), (10., 1.e-2)]:
+            age.append(a)
+            kx.append(k)
+        d.setKxTable(age, kx)
+        d.init()
+        for i in range(0, 5):
+            rs.simulate(1)
+            d.update()
+            d2 = rb.Doussan(rs, None)  # incremental update agrees with a new assembly
+            d2.kr = 1.e-4
+            d2.setKxTable(age, kx)
+            d2.init()
+            self.assertEqual(list(d.getRowPtr()), list(d2.getRowPtr()), "doussan: update has a wrong sparsity pattern")
+            self.assertEqual(list(d.getColIdx()), list(d2.getColIdx()), "doussan: update has a wrong sparsity pattern")
+            for v1, v2 in zip(list(d.getValues()) + list(d.getB()), list(d2.getValues()) + list(d2.getB())):
+                self.assertAlmostEqual(v1, v2, 10, "doussan: update differs from a new assembly")
+        collar = d.getSegments()[0].x
+        d.addNeumann(collar, -0.1)
+        x = d.solve()
+        rp, ci, v, b = d.getRowPtr(), d.getColIdx(), d.getValues(), d.getB()
+        for i in range(0, len(rp) - 1):
+            q = sum([v[k] * x[ci[k]] for k in range(rp[i], rp[i + 1])])
+            self.assertAlmostEqual(q, b[i] + (-0.1 if i == collar else 0.), 10, "doussan: tree solver does not solve the system")
+        self.assertAlmostEqual(sum(d.getRadialFlux(x)), -0.1, 10, "doussan: radial fluxes do not sum up to the collar flux")
+
+    def test_exudation(self):
+        """ checks that the incremental and parallel exudation model agrees with a single sequential calculation """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        model = rb.ExudationModel(10, 10, 20, 10, 10, 15, rs)
+        model.observationRadius = 2
+        model.setNumberOfThreads(2)
+        for i in range(0, 6):
+            rs.simulate(1)
+            c = model.calculate(i + 1)
+        fresh = rb.ExudationModel(10, 10, 20, 10, 10, 15, rs)
+        fresh.observationRadius = 2
+        c2 = fresh.calculate(6)
+        self.assertEqual(len(c), 10 * 10 * 15, "exudation: wrong number of grid points")
+        self.assertGreater(max(c), 0., "exudation: no exudates")
+        self.assertEqual(list(c), list(c2), "exudation: incremental calculation differs")
+
+    def test_nodes(self):
+        """ checks if the node list agrees with the organ nodes after growth, push and pop, and copy """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        for i in range(0, 10):
+            rs.simulate(1)
+        rs.push()
+        rs.simulate(5)
+        rs.pop()
+        rs.simulate(1)
+        for rs_ in [rs, rb.RootSystem(rs)]:
+            nodes, cts = rs_.getNodes(), rs_.getNodeCTs()
+            self.assertEqual(len(nodes), rs_.getNumberOfNodes(), "nodes: wrong number of nodes")
+            for o in rs_.getOrgans():
+                for i in range(1, o.getNumberOfNodes()):
+                    n, ni = o.getNode(i), o.getNodeId(i)
+                    self.assertEqual([n.x, n.y, n.z], [nodes[ni].x, nodes[ni].y, nodes[ni].z], "nodes: node coordinates differ")
+                    self.assertEqual(o.getNodeCT(i), cts[ni], "nodes: creation times differ")
+
+    def test_cached_segments(self):
+        """ checks if the incrementally cached segments agree with the segment list """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        se = rb.ProportionalElongation()
+        for i in range(0, 10):
+            rs.simulate(1, 5., se)
+            if i == 5:
+                rs.push()
+                rs.simulate(3)
+                rs.getCachedSegments()
+                rs.pop()
+            segs, cts = rs.getSegments(), rs.getSegmentCTs()
+            ref = sorted([(s.y, s.x, ct) for s, ct in zip(segs, cts)])
+            cached = [(s.y, s.x, ct) for s, ct in zip(rs.getCachedSegments(), rs.getCachedSegmentCTs())]
+            self.assertEqual(ref, cached, "cached segments: segments differ")
+            self.assertEqual(len(rs.getCachedNodes()), rs.getNumberOfNodes(), "cached segments: wrong number of nodes")
+
+    def test_arrays(self):
+        """ checks if the buffer arrays (e.g. for numpy.asarray) agree with the vectors """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(20)
+        nodes, segs = rs.getNodes(), rs.getSegments()
+        n, s = memoryview(rs.getNodeArray()), memoryview(rs.getSegmentArray())
+        self.assertEqual(n.shape, (len(nodes), 3), "arrays: wrong node shape")
+        self.assertEqual(s.shape, (len(segs), 2), "arrays: wrong segment shape")
+        self.assertEqual([(n[i, 0], n[i, 1], n[i, 2]) for i in range(0, len(nodes))], [(x.x, x.y, x.z) for x in nodes], "arrays: nodes differ")
+        self.assertEqual([(s[i, 0], s[i, 1]) for i in range(0, len(segs))], [(x.x, x.y) for x in segs], "arrays: segments differ")
+        self.assertEqual(memoryview(rs.getSegmentCTArray()).tolist(), list(rs.getSegmentCTs()), "arrays: segment creation times differ")
+        self.assertEqual(memoryview(rs.getParameterArray("length", 2)).tolist(), list(rs.getParameter("length", 2)), "arrays: parameters differ")
+        ana = rb.SegmentAnalyser(rs)
+        self.assertEqual(memoryview(ana.getParameterArray("age")).tolist(), list(ana.getParameter("age")), "arrays: segment parameters differ")
+        self.assertEqual(memoryview(ana.getNodeArray()).shape, (len(ana.nodes), 3), "arrays: wrong segment analyser node shape")
+
+    def test_query(self):
+        """ checks if the lazy segment query agrees with filter and crop of the segment analyser """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        for i in range(0, 20):
+            rs.simulate(1)
+        box = rb.SDF_PlantBox(6, 6, 20)
+        ana = rb.SegmentAnalyser(rs)
+        ana.filter("type", 1, 4)
+        ana.crop(box)
+        ana.filter("creationTime", 3, 15)
+        ana2 = rb.SegmentAnalyser(rs)
+        q = rb.SegmentQuery(ana2).filter("type", 1, 4).crop(box).filter("creationTime", 3, 15)
+        self.assertEqual(q.getNumberOfSegments(), len(ana.segments), "query: wrong number of segments")
+        self.assertAlmostEqual(q.getSummed("length"), ana.getSummed("length"), 10, "query: summed length differs")
+        self.assertAlmostEqual(q.getAnalyser(True).getSummed("volume"), ana.getSummed("volume"), 10, "query: summed volume differs")
+
+    def test_field(self):
+        """ checks that the plants of a field equal single root systems, and the combined views """
+        name = "Anagallis_femina_Leitner_2010"
+        prototype = rb.RootSystem()
+        prototype.readParameters("modelparameter/" + name + ".xml")
+        field = rb.Field(prototype)
+        positions = [rb.Vector3d(x, y, -3.) for x in [-10., 10.] for y in [-10., 10.]]
+        for i, pos in enumerate(positions):
+            field.addPlant(pos, i + 1)
+        field.setPatches(-20., 20., -20., 20., 2, 2)
+        self.assertEqual([field.getPatch(i) for i in range(0, 4)], [0, 2, 1, 3], "field: wrong patches")
+        field.initialize()
+        for i in range(0, 10):
+            field.simulate(1, 2)
+        length = 0.
+        for i, pos in enumerate(positions):
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.getOrganRandomParameter(1, 0).seedPos = pos
+            rs.setSeed(i + 1)
+            rs.initialize()
+            for j in range(0, 10):
+                rs.simulate(1)
+            plant = field.getPlant(i)
+            self.assertEqual(plant.getNumberOfNodes(), rs.getNumberOfNodes(), "field: plant differs from a single root system")
+            self.assertAlmostEqual(plant.getSummed("length"), rs.getSummed("length"), 10, "field: plant differs from a single root system")
+            length += rs.getSummed("length")
+        nodes, segs = field.getNodes(), field.getSegments()
+        self.assertEqual(len(nodes), field.getNumberOfNodes(), "field: wrong number of nodes")
+        self.assertEqual(len(segs), len(field.getSegmentCTs()), "field: wrong number of segment creation times")
+        for s in segs:
+            self.assertEqual(field.getPlantOfNode(s.x), field.getPlantOfNode(s.y), "field: segment connects two plants")
+        self.assertAlmostEqual(field.getAnalyser().getSummed("length"), length, 8, "field: combined length differs")
+
+    def test_soil_cache(self):
+        """ checks that cached soil samples give the same root system with fewer look ups """
+        name = "Anagallis_femina_Leitner_2010"
+        grid = rb.EquidistantGrid3D(20, 20, 50, 5, 5, 11)
+        for k in range(0, 11):
+            for j in range(0, 5):
+                for i in range(0, 5):
+                    grid.setData(i, j, k, 0.5 + 0.05 * ((i + 2 * j + 3 * k) % 10))
+        def simulate(caching):
+            grid.setCaching(caching)
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            for p in rs.getRootTypeParameter():
+                p.f_se = grid
+                p.tropismT = 3  # hydrotropism
+            rs.setSoil(grid)
+            rs.setSeed(1)
+            rs.initialize()
+            stats = rs.getInstrumentation()
+            stats.setEnabled(True)
+            for i in range(0, 10):
+                rs.simulate(1)
+            return rs, stats.getCount("soil")
+        rs, n = simulate(False)
+        rs_cached, n_cached = simulate(True)
+        self.assertEqual(len(rs.getNodes()), len(rs_cached.getNodes()), "soil cache: number of nodes differ")
+        for a, b in zip(rs.getNodes(), rs_cached.getNodes()):
+            self.assertEqual(str(a), str(b), "soil cache: nodes differ")
+        self.assertLess(n_cached, n, "soil cache: no look ups were saved")
+        p = rb.Vector3d(1, 1, -10)
+        v = grid.getValue(p)
+        version = grid.getVersion()
+        grid.setData(2, 2, 8, v + 1.)
+        self.assertGreater(grid.getVersion(), version, "soil cache: set data does not invalidate the samples")
+        self.assertEqual(grid.getValue(p), v + 1., "soil cache: value was not updated")
+
+    def test_mapper(self):
+        """ checks the incremental segment to cell mapping against mapping all segments """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        grid = rb.EquidistantGrid3D(20, 20, 50, 5, 5, 11)
+        mapper = rb.SegmentMapper(grid)
+        mapper.map(rs)
+        for i in range(0, 15):
+            rs.simulate(1)
+            mapper.update(rs)
+            self.assertLessEqual(mapper.getNumberOfUpdated(), 2 * rs.getNumberOfNewNodes() + 1, "mapper: too many segments were mapped")
+        full = rb.SegmentMapper(grid)
+        full.map(rs)
+        for i in range(0, rs.getNumberOfNodes()):
+            self.assertEqual(list(mapper.getCells(i)), list(full.getCells(i)), "mapper: cells differ")
+            self.assertEqual(list(mapper.getFractions(i)), list(full.getFractions(i)), "mapper: fractions differ")
+        nodes, lengths = rs.getNodes(), [0.] * rs.getNumberOfNodes()
+        for s in rs.getSegments():
+            lengths[s.y] = nodes[s.y].minus(nodes[s.x]).length()
+        cells = mapper.distribute(a2v(lengths))
+        self.assertEqual(len(cells), 4 * 4 * 10, "mapper: wrong number of cells")
+        ana = rb.SegmentAnalyser(rs)
+        ana.crop(rb.SDF_PlantBox(20, 20, 50))
+        self.assertAlmostEqual(sum(cells), ana.getSummed("length"), 4, "mapper: mapped length differs")  # crop cuts numerically
+
+    def test_segment_index(self):
+        """ checks that cuts, crops, and images using the index equal the ones without """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        for i in range(0, 20):
+            rs.simulate(1)
+        ana = rb.SegmentAnalyser(rs)
+        index = rb.SegmentIndex(ana)
+        self.assertEqual(index.getNumberOfSegments(), len(ana.segments), "segment index: wrong number of segments")
+        for x in [-5., -1., 0.5, 3.]:
+            plane = rb.SDF_HalfPlane(rb.Vector3d(x, 0, 0), rb.Vector3d(1, 0.2, 0))
+            cut, indexed = ana.cut(plane), ana.cut(plane, index)
+            self.assertEqual([str(s) for s in cut.segments], [str(s) for s in indexed.segments], "segment index: cut segments differ")
+            self.assertLessEqual(len(index.getIntersecting(plane)), len(ana.segments), "segment index: too many candidates")
+        box = rb.SDF_PlantBox(4, 4, 10)
+        cropped = rb.SegmentAnalyser(ana)
+        cropped.crop(box)
+        cropped.pack()
+        indexed = ana.crop(box, index)
+        indexed.pack()
+        self.assertEqual(len(cropped.segments), len(indexed.segments), "segment index: cropped segments differ")
+        self.assertAlmostEqual(cropped.getSummed("length"), indexed.getSummed("length"), 10, "segment index: cropped length differs")
+        self.assertLess(len(index.getNear(box)), len(ana.segments), "segment index: no segments were skipped")
+        ons = rb.Matrix3d(rb.Vector3d(0, 1, 0), rb.Vector3d(1, 0, 0), rb.Vector3d(0, 0, 1))  # looking along y
+        foto = ana.foto(rb.Vector3d(0, -20, -15), ons, 1., 1., 1.)
+        self.assertGreater(len(foto.segments), 0, "segment index: empty image")
+        self.assertEqual(len(foto.segments), len(ana.foto(rb.Vector3d(0, -20, -15), ons, 1., 1., 1., index).segments), "segment index: images differ")
+        for n in foto.nodes:
+            self.assertTrue(abs(n.x) <= 0.5 + 1.e-5 and abs(n.y) <= 0.5 + 1.e-5 and n.z == 0, "segment index: node outside of the image")
+
+    def test_coarsen(self):
+        """ checks that the level of detail keeps the organs, the branching nodes, and nearly the length """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        for i in range(0, 20):
+            rs.simulate(1)
+        ana = rb.SegmentAnalyser(rs)
+        coarse = rb.SegmentAnalyser(ana)
+        coarse.addUserData(ana.getParameter("creationTime"), "ct")
+        coarse.coarsen(0.1)
+        self.assertLess(len(coarse.segments), 0.6 * len(ana.segments), "coarsen: too many segments")
+        self.assertEqual(coarse.getNumberOfOrgans(), ana.getNumberOfOrgans(), "coarsen: organs are missing")
+        self.assertAlmostEqual(coarse.getSummed("length") / ana.getSummed("length"), 1., 2, "coarsen: length differs")
+        weighted = lambda a, name: sum(x * l for x, l in zip(a.getParameter(name), a.getParameter("length")))
+        self.assertAlmostEqual(weighted(coarse, "ct") / weighted(ana, "creationTime"), 1., 2, "coarsen: user data are not length weighted")
+        ends = set([s.y for s in coarse.segments])
+        for s in ana.segments:  # the lateral base nodes are kept
+            if sum(1 for t in ana.segments if t.x == s.x) > 1:
+                self.assertIn(s.x, ends | set([t.x for t in coarse.segments]), "coarsen: a branching node was removed")
+        coarse.coarsen(0.)
+        n = len(coarse.segments)
+        coarse.coarsen(0.)
+        self.assertEqual(len(coarse.segments), n, "coarsen: not idempotent")
+
+    def test_parallel(self):
+        """ checks that parallel simulation does not depend on the number of threads """
+        name = "Zea_mays_4_Leitner_2014"
+        lengths, nodes = [], []
+        for threads in [1, 2, 4]:
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.setSeed(42)
+            rs.setNumberOfThreads(threads)
+            rs.initialize()
+            for i in range(0, 30):
+                rs.simulate(1)
+            lengths.append(v2a(rs.getParameter("length")))
+            nodes.append(vv2a(rs.getNodes()))
+        for i in range(1, 3):
+            self.assertEqual(lengths[0].shape, lengths[i].shape, "parallel simulation: number of roots differ")
+            self.assertEqual(np.sum(lengths[0] != lengths[i]), 0, "parallel simulation: root lengths differ")
+            self.assertEqual(np.sum(nodes[0] != nodes[i]), 0, "parallel simulation: nodes differ")
+
+    def test_ensemble(self):
+        """ checks the ensemble statistics against single simulations """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        ensemble = rb.RootSystemEnsemble(rs)
+        ensemble.setDistribution("length", 0., 50., 10)
+        ensemble.addSummed("length")
+        ensemble.run(4, 1, 20, 1., 2)
+        l = []
+        for i in range(0, 4):
+            rs.setSeed(1 + i)
+            rs.initialize()
+            for j in range(0, 20):
+                rs.simulate(1.)
+            l.append(rs.getSummed("length"))
+        self.assertEqual(ensemble.getNumberOfReplicates(), 4, "ensemble: wrong number of replicates")
+        self.assertAlmostEqual(ensemble.getSummedMean("length"), np.mean(l), 10, "ensemble: wrong mean length")
+        self.assertAlmostEqual(ensemble.getSummedVariance("length"), np.var(l, ddof = 1), 8, "ensemble: wrong length variance")
+        self.assertAlmostEqual(np.sum(v2a(ensemble.getDistributionMean())), np.mean(l), 8, "ensemble: distribution does not sum up")
+
+    def test_organ_streams(self):
+        """ checks that organ streams are independent of the number of threads, and of the draws of other organs """
+        name = "Anagallis_femina_Leitner_2010"
+        def simulate(threads, tropismN):
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.setOrganStreams(True)
+            rs.setNumberOfThreads(threads)
+            if tropismN is not None:
+                rs.getRootTypeParameter(4).tropismN = tropismN  # sub type 4 has no laterals
+            rs.initialize()
+            for i in range(0, 20):
+                rs.simulate(1)
+            organs = {}
+            for o in rs.getOrgans():
+                nodes = [o.getNode(i) for i in range(0, o.getNumberOfNodes())]
+                organs[o.getId()] = (o.getParameter("subType"), [(n.x, n.y, n.z) for n in nodes])
+            return organs
+        a, b, c = simulate(0, None), simulate(2, None), simulate(0, 10.)
+        self.assertEqual(a, b, "organ streams: results depend on the number of threads")
+        self.assertEqual(set(a.keys()), set(c.keys()), "organ streams: different organs")
+        changed = [i for i in a if a[i] != c[i]]
+        self.assertGreater(len(changed), 0, "organ streams: tropism had no effect")
+        for i in changed:
+            self.assertEqual(a[i][0], 4, "organ streams: an organ of another sub type changed")
+
+    def test_finished(self):
+        """ checks that dead roots are finished, and no longer change """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        for p in rs.getRootTypeParameter():
+            p.rlt = 5. * p.subType  # root life time [day]
+        rs.initialize()
+        for i in range(0, 15):
+            rs.simulate(1)
+        finished = [(o, o.getAge(), o.getNumberOfNodes()) for o in rs.getOrgans() if o.isFinished()]
+        self.assertGreater(len(finished), 0, "finished: no finished roots")
+        rs.simulate(10)
+        for o, age, non in finished:
+            self.assertFalse(o.isAlive(), "finished: a living root is finished")
+            self.assertEqual((o.getAge(), o.getNumberOfNodes()), (age, non), "finished: a finished root has changed")
+
+    def test_dormant(self):
+        """ checks that unborn and inactive subtrees are skipped, and that they age lazily """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.getInstrumentation().setEnabled(True)
+        for i in range(0, 20):
+            rs.simulate(1)
+        self.assertGreater(rs.getInstrumentation().getCount("skipped"), 0, "dormant: no subtree was skipped")
+        def living(o):  # the organ and its ancestors are alive, i.e. the organ ages
+            while o is not None:
+                if not o.isAlive():
+                    return False
+                o = o.getParent()
+            return True
+        organs = [(o, o.getAge(), o.getNumberOfNodes(), o.isDormant()) for o in rs.getOrgans() if o.getAge() > 0 and living(o)]
+        self.assertGreater(len([o for o in organs if o[3]]), 0, "dormant: no dormant root")
+        for i in range(0, 7):
+            rs.simulate(1)
+        for o, age, non, dormant in organs:
+            if living(o):
+                self.assertAlmostEqual(o.getAge(), age + 7, 10, "dormant: the age does not advance")
+            if dormant:  # inactive roots do not grow, also if they were simulated for an emerging lateral
+                self.assertEqual(o.getNumberOfNodes(), non, "dormant: a dormant root has changed")
+                self.assertEqual(o.getOldNumberOfNodes(), non, "dormant: a dormant root has new nodes")
+
+    def test_parameter_cache(self):
+        """ checks that the organs see replaced type parameters, also in copies of the root system """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(10)
+        copy = rb.RootSystem(rs)
+        copy.getRootTypeParameter(1).name = "modified"  # copy on write
+        roots = lambda r: [o for o in r.getOrgans() if o.getParameter("subType") == 1]
+        for o in roots(copy):
+            self.assertEqual(o.getOrganRandomParameter().name, "modified", "parameter cache: organ of the copy has an outdated parameter")
+        for o in roots(rs):
+            self.assertNotEqual(o.getOrganRandomParameter().name, "modified", "parameter cache: parameter of the copy is shared")
+        p = rs.getRootTypeParameter(1).copy(rs)
+        p.name = "replaced"
+        rs.setOrganRandomParameter(p)
+        for o in roots(rs):
+            self.assertEqual(o.getOrganRandomParameter().name, "replaced", "parameter cache: organ has a replaced parameter")
+
+    def test_instrumentation(self):
+        """ checks the counters of the instrumentation against the created geometry """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        stats = rs.getInstrumentation()
+        rs.simulate(5)
+        self.assertEqual(stats.getCount("segments"), 0, "instrumentation: counts while disabled")
+        stats.setEnabled(True)
+        nodes, organs = rs.getNumberOfNodes(), rs.getNumberOfOrgans()
+        rs.simulate(20)
+        self.assertEqual(stats.getCount("segments"), rs.getNumberOfNodes() - nodes, "instrumentation: wrong number of segments")
+        self.assertEqual(stats.getCount("segments", 2), stats.getCount("segments"), "instrumentation: segments of other organ types")
+        self.assertEqual(stats.getCount("laterals"), rs.getNumberOfOrgans() - organs, "instrumentation: wrong number of laterals")
+        self.assertGreater(stats.getCount("objectives"), 0, "instrumentation: no tropism objectives")
+        self.assertGreater(stats.getTime("simulate"), stats.getTime("heading"), "instrumentation: heading not within simulate")
+        stats.clear()
+        self.assertEqual(stats.getCount("objectives"), 0, "instrumentation: not cleared")
+
+    def test_threads(self):
+        """ checks simulations of different root systems in Python threads against sequential ones """
+        import threading
+        name = "Anagallis_femina_Leitner_2010"
+        def simulate(rs, i, results):
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.setSeed(i + 1)
+            rs.initialize()
+            rs.simulate(20)
+            results[i] = (rs.getNumberOfNodes(), rs.getSummed("length"), rb.SegmentAnalyser(rs).getSummed("length"))
+        sequential, threaded = [None] * 3, [None] * 3
+        for i in range(0, 3):
+            simulate(rb.RootSystem(), i, sequential)
+        threads = [threading.Thread(target = simulate, args = (rb.RootSystem(), i, threaded)) for i in range(0, 3)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(threaded, sequential, "threads: results differ from the sequential simulation")
+
+        class Conductivity(rb.Doussan):  # calls back into Python, from a call without the GIL
+            def radialConductivity(self, ot, subType, age):
+                return 2.e-4
+        rs = rb.RootSystem()
+        simulate(rs, 0, threaded)
+        d = Conductivity(rs, None)
+        d.init()
+        t = threading.Thread(target = d.assemble)
+        t.start()
+        t.join()
+        d2 = rb.Doussan(rs, None)
+        d2.kr = 2.e-4
+        d2.init()
+        self.assertEqual(list(d.getValues()), list(d2.getValues()), "threads: Python conductivity was not used")
+
+    def test_storage_precision(self):
+        """ checks the node store and packed segments in reduced precision against double precision """
+        name = "Anagallis_femina_Leitner_2010"
+        ref, rs = rb.RootSystem(), rb.RootSystem()
+        for r, p in [(ref, rb.StoragePrecision.double), (rs, rb.StoragePrecision.quantized)]:
+            r.readParameters("modelparameter/" + name + ".xml")
+            r.setStoragePrecision(p, 1.e-3)
+            r.initialize()
+            r.simulate(10)
+        rs.setStoragePrecision(rb.StoragePrecision.float)
+        rs.simulate(10)
+        rs.setStoragePrecision(rb.StoragePrecision.quantized, 1.e-3, rb.Vector3d(0, 0, -3))
+        ref.simulate(10)
+        self.assertEqual(rs.getStoragePrecision(), int(rb.StoragePrecision.quantized), "storage precision: wrong precision")
+        self.assertEqual(rs.getNumberOfNodes(), ref.getNumberOfNodes(), "storage precision: simulation differs")
+        n, nr = rs.getNodes(), ref.getNodes()
+        err = max([max(abs(a.x - b.x), abs(a.y - b.y), abs(a.z - b.z)) for a, b in zip(n, nr)])
+        self.assertLess(err, 1.e-3, "storage precision: nodes differ by more than the resolution")
+        self.assertLess(rs.getNodeMemory(), 0.7 * ref.getNodeMemory(), "storage precision: the rounded geometry saves no memory")
+        ana = rb.SegmentAnalyser(ref)
+        packed = rb.PackedSegments(ana, rb.StoragePrecision.float)
+        ana2 = packed.unpack()
+        self.assertEqual(packed.getNumberOfSegments(), len(ana.segments), "storage precision: wrong number of segments")
+        self.assertAlmostEqual(ana2.getSummed("length"), ana.getSummed("length"), 3, "storage precision: packed lengths differ")
+        self.assertLess(packed.getMemory(), 24 * len(ana.nodes) + 24 * len(ana.segments), "storage precision: packed segments are not smaller")
+
+    def test_node_packing(self):
+        """ checks that packed nodes are decoded within the resolution, need less memory, and do not change the growth """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(3)
+        rs.initialize()
+        ref = rb.RootSystem(rs)
+        rs.setNodePacking(True, 1.e-4, 1.e-6)
+        for i in range(60):
+            rs.simulate(1)
+            ref.simulate(1)
+        self.assertTrue(rs.getNodePacking(), "node packing: packing is not enabled")
+        self.assertEqual(rs.getNumberOfNodes(), ref.getNumberOfNodes(), "node packing: the growth changed")
+        self.assertLess(rs.getNodeMemory(), 0.75 * ref.getNodeMemory(), "node packing: no memory saved")
+        nodes, refNodes = rs.getNodes(), ref.getNodes()
+        cts, refCts = rs.getNodeCTs(), ref.getNodeCTs()
+        for i in range(0, len(nodes)):
+            self.assertLess(nodes[i].minus(refNodes[i]).length(), 1.e-4, "node packing: node " + str(i) + " differs")
+            self.assertLess(abs(cts[i] - refCts[i]), 1.e-6, "node packing: creation time of node " + str(i) + " differs")
+        cached = rs.getCachedNodes()
+        for i in range(0, len(nodes)):
+            self.assertEqual(nodes[i].minus(cached[i]).length(), 0., "node packing: the cached nodes differ")
+        ana, refAna = rb.SegmentAnalyser(rs), rb.SegmentAnalyser(ref)
+        self.assertAlmostEqual(ana.getSummed("length"), refAna.getSummed("length"), 2, "node packing: analysed lengths differ")
+        copy = rb.RootSystem(rs)
+        copyNodes = copy.getNodes()
+        for i in range(0, len(nodes)):
+            self.assertEqual(nodes[i].minus(copyNodes[i]).length(), 0., "node packing: the copy differs")
+        rs.setNodePacking(False)
+        unpacked = rs.getNodes()
+        for i in range(0, len(nodes)):
+            self.assertEqual(nodes[i].minus(unpacked[i]).length(), 0., "node packing: unpacking changed node " + str(i))
+
+    def test_sweep(self):
+        """ checks a parameter sweep against simulations with the modified parameters """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        sweep = rb.ParameterSweep(rs)
+        sweep.addParameter(2, 1, "lb", 0.5, 2.)
+        sweep.addParameter(2, 1, "theta", 0.5, 1.5)
+        sweep.addSummed("length")
+        sweep.setSamples(rb.Sampling.latinhypercube, 5, 3)
+        for j in range(0, 2):
+            strata = sorted([int((sweep.getSample(i)[j] - 0.5) / [1.5, 1.][j] * 5) for i in range(0, 5)])
+            self.assertEqual(strata, [0, 1, 2, 3, 4], "sweep: samples are not a latin hypercube")
+        sweep.run(10, 1., 1, out("sweep.txt"), 7)
+        lengths = list(sweep.getColumn("length"))
+        for i in range(0, 5):
+            ref = rb.RootSystem()
+            ref.readParameters("modelparameter/" + name + ".xml")
+            p = ref.getRootTypeParameter(1)
+            p.setParameter("lb", sweep.getSample(i)[0])
+            p.setParameter("theta", sweep.getSample(i)[1])
+            ref.setSeed(7 + i)
+            ref.initialize()
+            for k in range(0, 10):
+                ref.simulate(1.)
+            self.assertAlmostEqual(lengths[i], ref.getSummed("length"), 10, "sweep: sample differs from the simulation")
+        sweep.run(10, 1., 3, "", 7)
+        self.assertEqual(list(sweep.getColumn("length")), lengths, "sweep: results depend on the number of threads")
+        with open(out("sweep.txt")) as f:
+            lines = f.read().splitlines()
+        self.assertEqual(lines[0].split("\t"), list(sweep.getColumnNames()), "sweep: wrong header")
+        self.assertEqual([float(l.split("\t")[2]) for l in lines[1:]], lengths, "sweep: file differs from the columns")
+
+    def test_buffers(self):
+        """ checks the buffer versions of the geometry methods, and the geometry visitor, against the vectors """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        nodes, segs, cts, tips = rb.std_vector_Vector3d_(), rb.std_vector_Vector2i_(), rb.std_vector_double_(), rb.std_vector_int_()
+        for i in range(0, 2):
+            rs.simulate(5)
+            rs.getNodes(nodes)
+            rs.getSegments(segs, 2)
+            rs.getSegmentCTs(cts)
+            rs.getRootTips(tips)
+            self.assertEqual([(n.x, n.y, n.z) for n in nodes], [(n.x, n.y, n.z) for n in rs.getNodes()], "buffers: nodes differ")
+            self.assertEqual([(s.x, s.y) for s in segs], [(s.x, s.y) for s in rs.getSegments(2)], "buffers: segments differ")
+            self.assertEqual(list(cts), list(rs.getSegmentCTs()), "buffers: segment creation times differ")
+            self.assertEqual(list(tips), list(rs.getRootTips()), "buffers: root tips differ")
+
+        class Visitor(rb.GeometryVisitor):
+            def __init__(self):
+                super().__init__()
+                self.nodes, self.segs, self.organs = [], [], []
+            def visitNode(self, i, n, ct):
+                self.nodes.append((i, n.x, n.y, n.z, ct))
+            def visitOrgan(self, o):
+                self.organs.append(o.getId())
+                return True
+            def visitSegment(self, s, ct, o):
+                self.segs.append((s.x, s.y, ct, o.getId()))
+        v = Visitor()
+        rs.visit(v)
+        nct = rs.getNodeCTs()
+        self.assertEqual(v.nodes, [(i, n.x, n.y, n.z, nct[i]) for i, n in enumerate(rs.getNodes())], "visitor: nodes differ")
+        self.assertEqual(v.organs, [o.getId() for o in rs.getOrgans()], "visitor: organs differ")
+        ref = [(s.x, s.y, ct, o.getId()) for s, ct, o in zip(rs.getSegments(), rs.getSegmentCTs(), rs.getSegmentOrigins())]
+        self.assertEqual(v.segs, ref, "visitor: segments differ")
+
+    def test_organ_list(self):
+        """ checks the cached organ list against the organ tree, after growth, push and pop """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        def tree(o):
+            return [o.getId()] + [i for c in range(0, o.getNumberOfChildren()) for i in tree(o.getChild(c))]
+        for i in range(0, 12):
+            rs.simulate(1)
+            if i == 5:
+                rs.push()
+            if i == 8:
+                rs.pop()
+            v = rs.getOrganListVersion()
+            organs = rs.getOrgans()
+            self.assertEqual(rs.getOrganListVersion(), v, "organ list: rebuilt without changes")
+            self.assertEqual([o.getId() for o in rs.getOrganList()], [i for b in rs.getBaseRoots() for i in tree(b)], "organ list: wrong order")
+            ref = [o.getId() for b in rs.getBaseRoots() for o in b.getOrgans()]
+            self.assertEqual([o.getId() for o in organs], ref, "organ list: organs differ")
+            self.assertEqual([r.getId() for r in rs.getRoots()], [o.getId() for b in rs.getBaseRoots() for o in b.getOrgans(2)], "organ list: roots differ")
+
+    def test_creation_time_index(self):
+        """ checks snapshots of the creation time index against filtered analysers """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+        rs.simulate(30)
+        ana = rb.SegmentAnalyser(rs)
+        index = rb.CreationTimeIndex(ana)
+        times = rb.std_vector_double_()
+        times.extend([5., 10., 17.5, 30.])
+        dists = index.distribution("length", 0., 50., 10, True, times)
+        for i, t in enumerate(times):
+            ref = rb.SegmentAnalyser(ana)
+            ref.filter("creationTime", 0., t)
+            snap = index.getSnapshot(t)
+            self.assertEqual(index.getNumberOfSegments(t), len(ref.segments), "creation time index: wrong number of segments")
+            self.assertEqual(list(snap.segCTs), list(ref.segCTs), "creation time index: snapshot differs")
+            self.assertAlmostEqual(index.getSummed("length", t), ref.getSummed("length"), 10, "creation time index: summed length differs")
+            d = ref.distribution("length", 0., 50., 10, True)
+            for a, b in zip(dists[i], d):
+                self.assertAlmostEqual(a, b, 10, "creation time index: distribution differs")
+
+    def test_async_writer(self):
+        """ checks that asynchronously written files equal the synchronous ones, while the simulation continues """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(1)
+        rs.initialize()
+        writer = rb.AsyncWriter(2)
+        f = rb.VTPFormat.compressed if rb.VTPWriter.hasCompression() else rb.VTPFormat.binary
+        for i in range(4):
+            rs.simulate(5)
+            ana = rb.SegmentAnalyser(rs)
+            ana.addUserData(ana.getParameter("length"), "len")
+            ana.write(out(name + "_sync_" + str(i) + ".vtp"), f)
+            rs.writeRSML(out(name + "_sync_" + str(i) + ".rsml"))
+            writer.write(ana, out(name + "_async_" + str(i) + ".vtp"), f)
+            writer.write(rs, out(name + "_async_" + str(i) + ".rsml"))
+            self.assertLessEqual(writer.getNumberOfPending(), writer.getQueueSize(), "async writer: queue exceeds its size")
+        writer.finish()
+        self.assertEqual(writer.getNumberOfPending(), 0, "async writer: finish left pending files")
+        self.assertEqual(writer.getNumberOfWritten(), 8, "async writer: wrong number of files")
+        for i in range(4):
+            for ext in [".vtp", ".rsml"]:
+                with open(out(name + "_sync_" + str(i) + ext), "rb") as f:
+                    a = f.read()
+                with open(out(name + "_async_" + str(i) + ext), "rb") as f:
+                    b = f.read()
+                self.assertEqual(a, b, "async writer: file " + str(i) + ext + " differs")
+
+    def test_organ_nodes(self):
+        """ checks that the organs read their nodes from the node store, also after parallel steps, and for copies """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(3)
+        rs.initialize()
+        par, seq = rb.RootSystem(rs), rb.RootSystem(rs)
+        par.setNumberOfThreads(2)
+        seq.setNumberOfThreads(1)
+        for i in range(30):
+            rs.simulate(1)
+            par.simulate(1)
+            seq.simulate(1)
+        self.assertEqual(len(par.getNodes()), len(seq.getNodes()), "organ nodes: the parallel simulation differs")
+        nodes = rs.getNodes()
+        self.assertLess(rs.getOrganNodeMemory(), 12 * len(nodes), "organ nodes: the organs hold a copy of the coordinates")
+        copy = rb.RootSystem(rs)
+        for r in [rs, par, copy]:
+            nodes = r.getNodes()
+            for o in r.getOrganList():
+                n = o.getNodes()
+                for j in range(0, o.getNumberOfNodes()):
+                    self.assertEqual(n[j].minus(nodes[o.getNodeId(j)]).length(), 0., "organ nodes: node differs from the node store")
+                    self.assertEqual(n[j].minus(o.getNode(j)).length(), 0., "organ nodes: a single node differs")
+
+    def test_math_kernels(self):
+        """ checks that the fused rotations and steps equal the composed operations """
+        m = rb.Matrix3d.ons(rb.Vector3d(0.3, -0.5, 0.8))
+        pos = rb.Vector3d(1., 2., 3.)
+        for a, b in [(0., 0.), (0.4, 1.3), (1.2, 5.9)]:
+            r = m.times(rb.Vector3d.rotAB(a, b))
+            f = m.timesRotAB(a, b)
+            self.assertAlmostEqual(r.minus(f).length(), 0., 14, "timesRotAB: differs from the composed rotation")
+            p = pos.plus(r.times(0.25))
+            self.assertAlmostEqual(p.minus(m.step(pos, a, b, 0.25)).length(), 0., 14, "step: differs from the composed step")
+
+    def test_lazy_base_roots(self):
+        """ checks that scheduled base roots are created when they emerge, and are removed by pop """
+        name = "Zea_mays_4_Leitner_2014"
+        eager = rb.RootSystem()
+        eager.readParameters("modelparameter/" + name + ".xml")
+        eager.initialize()
+        times = [o.getNodeCT(0) for o in eager.getBaseRoots()[1:]]
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(5)
+        rs.setLazyBaseRoots(True)
+        rs.initialize()
+        self.assertEqual(len(rs.getBaseRoots()), 1, "lazy base roots: only the tap root is created")
+        self.assertEqual(rs.getNumberOfScheduledRoots(), len(times), "lazy base roots: wrong number of scheduled roots")
+        for i in range(20):
+            rs.simulate(1)
+            born = len([t for t in times if t < rs.getSimTime()])
+            self.assertEqual(len(rs.getBaseRoots()), 1 + born, "lazy base roots: wrong number of base roots at day " + str(i + 1))
+        ref = rb.RootSystem(rs)
+        rs.push()
+        rs.simulate(10)
+        rs.pop()
+        self.assertEqual(len(rs.getBaseRoots()), len(ref.getBaseRoots()), "lazy base roots: pop did not remove the new base roots")
+        self.assertEqual(rs.getNumberOfScheduledRoots(), ref.getNumberOfScheduledRoots(), "lazy base roots: pop did not restore the schedule")
+        rs.save(out("test_lazy_base_roots.bin"))
+        rs2 = rb.RootSystem()
+        rs2.load(out("test_lazy_base_roots.bin"))
+        for r in [rs, ref, rs2]:
+            r.simulate(10)
+        n, nref, n2 = rs.getNodes(), ref.getNodes(), rs2.getNodes()
+        self.assertEqual([(v.x, v.y, v.z) for v in n], [(v.x, v.y, v.z) for v in nref], "lazy base roots: push and pop changed the simulation")
+        self.assertEqual([(v.x, v.y, v.z) for v in n], [(v.x, v.y, v.z) for v in n2], "lazy base roots: save and load changed the simulation")
+
+    def test_step_delta(self):
+        """ checks that the step delta equals the separate calls of the last time step """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.initialize()
+
+        class Sink(rb.StepDeltaSink):
+
+            def __init__(self):
+                super().__init__()
+                self.nodes, self.segments = 0, 0
+
+            def newNode(self, i, n, ct):
+                self.nodes += 1
+
+            def newSegment(self, s, o):
+                self.segments += 1
+
+        delta = rb.StepDelta()
+        for i in range(20):
+            rs.simulate(1)
+            rs.getStepDelta(delta)
+            self.assertEqual(delta.numberOfNewNodes, rs.getNumberOfNewNodes(), "step delta: wrong number of new nodes")
+            self.assertEqual(delta.numberOfNewOrgans, rs.getNumberOfNewOrgans(), "step delta: wrong number of new organs")
+            self.assertEqual([(v.x, v.y, v.z) for v in delta.newNodes], [(v.x, v.y, v.z) for v in rs.getNewNodes()], "step delta: new nodes differ")
+            self.assertEqual(list(delta.newNodeCTs), list(rs.getNewNodeCTs()), "step delta: new node creation times differ")
+            self.assertEqual(list(delta.updatedNodeIndices), list(rs.getUpdatedNodeIndices()), "step delta: updated node indices differ")
+            self.assertEqual([(v.x, v.y, v.z) for v in delta.updatedNodes], [(v.x, v.y, v.z) for v in rs.getUpdatedNodes()], "step delta: updated nodes differ")
+            self.assertEqual([(s.x, s.y) for s in delta.newSegments], [(s.x, s.y) for s in rs.getNewSegments()], "step delta: new segments differ")
+            self.assertEqual([o.getId() for o in delta.newSegmentOrigins], [o.getId() for o in rs.getNewSegmentOrigins()], "step delta: new segment origins differ")
+        sink = Sink()
+        rs.visitStepDelta(sink)
+        self.assertEqual(sink.nodes, rs.getNumberOfNewNodes(), "step delta: the sink received a wrong number of nodes")
+        self.assertEqual(sink.segments, len(rs.getNewSegments()), "step delta: the sink received a wrong number of segments")
+
+    def test_carbon_allocator(self):
+        """ checks that the carbon allocation meets the budget, and serves the root types by their weights """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(11)
+        rs.initialize()
+        rs.simulate(20)
+        alloc = rb.CarbonAllocator(rs)
+        alloc.setWeight(1, 4.)
+        demand = alloc.getDemand(1.)
+        self.assertGreater(demand, 0., "carbon allocator: no demand")
+        self.assertAlmostEqual(alloc.allocate(1., 2 * demand), demand, 10, "carbon allocator: the demand was not satisfied")
+        self.assertEqual(set(alloc.getScales()), {1.}, "carbon allocator: growth was limited below the budget")
+        self.assertGreaterEqual(demand + 1.e-9, sum(alloc.getDemands()), "carbon allocator: the demand is below the potential elongation")
+        budget = 0.5 * demand
+        allocated = alloc.allocate(1., budget)
+        self.assertLessEqual(allocated, budget + 1.e-9, "carbon allocator: the budget is exceeded")
+        self.assertGreater(allocated, 0.99 * budget, "carbon allocator: the budget is not used")
+        demands, scales = alloc.getDemands(), alloc.getScales()
+        tap = rs.getBaseRoots()[0].getId()
+        for i, s in enumerate(scales):
+            self.assertTrue(0. <= s <= 1., "carbon allocator: invalid scale")
+            if demands[i] > 0:
+                self.assertLessEqual(s, scales[tap], "carbon allocator: the weight of the tap root is ignored")
+        rs.setElongationScales(rb.std_vector_double_())
+        ref = rb.RootSystem(rs)
+        l0 = rs.getSummed("length")
+        ref.simulate(1.)
+        alloc.simulate(1., budget)
+        self.assertEqual(len(rs.getElongationScales()), 0, "carbon allocator: the scales were not removed")
+        self.assertAlmostEqual(rs.getSummed("length") - l0, allocated, delta = 0.01 * allocated, msg = "carbon allocator: the time step differs from the allocation")
+        self.assertLess(rs.getSummed("length") - l0, ref.getSummed("length") - l0, "carbon allocator: growth was not limited")
+        rs = rb.RootSystem()  # many laterals emerge within the time steps
+        rs.readParameters("modelparameter/Anagallis_femina_Leitner_2010.xml")
+        rs.setSeed(3)
+        rs.initialize()
+        alloc = rb.CarbonAllocator(rs)
+        incs = []
+        for i in range(0, 20):
+            l0 = rs.getSummed("length")
+            alloc.simulate(1., 10.)
+            incs.append(rs.getSummed("length") - l0)
+            self.assertLessEqual(incs[-1], 12.5, "carbon allocator: the budget is exceeded on day " + str(i + 1))
+        self.assertAlmostEqual(sum(incs[10:]) / 10., 10., delta = 0.5, msg = "carbon allocator: the budget is not met")
+
+    def test_tip_registry(self):
+        """ checks the tip registry and its spatial queries against a scan of all roots """
+        name = "Zea_mays_4_Leitner_2014"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(3)
+        rs.initialize()
+        rs.setTipRegistry(True, 2.)
+
+        def growing():
+            tips = {}
+            for r in rs.getRoots():
+                if r.isAlive() and r.isActive() and r.getNumberOfNodes() > 1:
+                    ln = r.getNumberOfNodes() - 1
+                    tips[r.getNodeId(ln)] = r.getNode(ln)
+            return tips
+
+        for i in range(0, 15):
+            rs.simulate(1.)
+            reg = rs.getTipRegistry()
+            tips = growing()
+            self.assertEqual(list(reg.getTips()), sorted(tips.keys()), "tip registry: wrong tips after day " + str(i + 1))
+        rs.push()
+        rs.simulate(3.)
+        rs.pop()
+        reg = rs.getTipRegistry()
+        self.assertEqual(list(reg.getTips()), sorted(tips.keys()), "tip registry: wrong tips after pop")
+        x, r = rb.Vector3d(0., 0., -10.), 7.
+        ref = sorted([n for n, p in tips.items() if p.minus(x).length() <= r])
+        self.assertEqual(list(reg.getTipsInRadius(x, r)), ref, "tip registry: wrong tips within the radius")
+        self.assertEqual(list(reg.getTipsInRadius(x, 100.)), sorted(tips.keys()), "tip registry: wrong tips within a large radius")
+        a, b = rb.Vector3d(-5., -5., -20.), rb.Vector3d(5., 5., -5.)
+        ref = sorted([n for n, p in tips.items() if a.x <= p.x <= b.x and a.y <= p.y <= b.y and a.z <= p.z <= b.z])
+        self.assertEqual(list(reg.getTipsInBox(a, b)), ref, "tip registry: wrong tips within the box")
+        n = sorted(tips.keys())[0]
+        p = reg.getPosition(n)
+        c = [int(v // 2.) for v in [p.x, p.y, p.z]]
+        ref = sorted([m for m, q in tips.items() if [int(v // 2.) for v in [q.x, q.y, q.z]] == c])
+        self.assertEqual(list(reg.getTipsInCell(c[0], c[1], c[2])), ref, "tip registry: wrong tips within the cell")
+        self.assertEqual(reg.getOrgan(n).getNodeId(reg.getOrgan(n).getNumberOfNodes() - 1), n, "tip registry: wrong organ of a tip")
+
+    def test_composed_tropism(self):
+        """ checks the compile time composed hydro- and gravitropism against the weighted sum of the single tropisms """
+        grid = rb.EquidistantGrid3D(20, 20, 50, 5, 5, 11)
+        for k in range(0, 11):
+            for j in range(0, 5):
+                for i in range(0, 5):
+                    grid.setData(i, j, k, 0.5 + 0.05 * ((i + 2 * j + 3 * k) % 10))
+        rs = rb.RootSystem()
+        ht = rb.Hydrotropism(rs, 10., 0.2, grid)
+        gt = rb.Gravitropism(rs, 10., 0.2)
+        hgt = rb.HydroGravitropism(rs, 10., 0.2, grid)
+        hgt2 = rb.HydroGravitropism(rs, 10., 0.2, grid, 2., 3.)
+        pos = rb.Vector3d(1., 2., -10.)
+        old = rb.Matrix3d.ons(rb.Vector3d(0.3, 0.1, -1.))
+        for i in range(0, 20):
+            a, b = 0.1 * i, 0.7 * i
+            h, g = ht.tropismObjective(pos, old, a, b, 2.), gt.tropismObjective(pos, old, a, b, 2.)
+            self.assertAlmostEqual(hgt.tropismObjective(pos, old, a, b, 2.), 10. * h + g, 12, "composed tropism: wrong objective")
+            self.assertAlmostEqual(hgt2.tropismObjective(pos, old, a, b, 2.), 2. * h + 3. * g, 12, "composed tropism: wrong weights")
+        ct = rb.CombinedTropism(rs, 10., 0.2, ht, 10., gt, 1.)
+        trials = rb.TropismTrials()
+        for i in range(0, 20):
+            trials.add(0.1 * i, 0.7 * i)
+        trials.update()
+        for p, o in [(pos, old), (rb.Vector3d(-5., 3., -30.), rb.Matrix3d.ons(rb.Vector3d(1., -0.5, -0.2)))]:
+            v, ref = hgt.tropismObjectives(p, o, trials, 2.), ct.tropismObjectives(p, o, trials, 2.)
+            self.assertEqual(len(v), 20, "composed tropism: wrong number of objectives")
+            for x, y in zip(v, ref):
+                self.assertAlmostEqual(x, y, 12, "composed tropism: batch objectives differ from the combined tropism")
+        rs1, rs2 = rb.RootSystem(), rb.RootSystem()  # same random numbers
+        for r in [rs1, rs2]:
+            r.setSeed(7)
+        rs1.setSoil(grid)
+        t1 = rs1.createTropismFunction(rb.TropismType.hydro, 10., 0.2)
+        t2 = rb.CombinedTropism(rs2, 10., 0.2, rb.Hydrotropism(rs2, 10., 0.2, grid), 10., rb.Gravitropism(rs2, 10., 0.2), 1.)
+        for i in range(0, 100):
+            p = rb.Vector3d(-8. + 0.16 * i, 5. - 0.1 * i, -0.45 * i - 1.)
+            o = rb.Matrix3d.ons(rb.Vector3d(0.3 * ((i % 7) - 3), 0.2 * ((i % 5) - 2), -1.))
+            h1, h2 = t1.getHeading(p, o, 0.5, None), t2.getHeading(p, o, 0.5, None)
+            self.assertEqual((h1.x, h1.y), (h2.x, h2.y), "composed tropism: headings differ from the combined tropism")
+
+    def test_segment_store(self):
+        """ checks the chunked segment store against a merged analyser, and after reopening the file """
+        name = "Anagallis_femina_Leitner_2010"
+        types = rb.std_vector_string_()
+        types.append("radius")
+        types.append("subType")
+        store = rb.SegmentStore(out("test_segment_store.bin"), types, 150)
+        ana = rb.SegmentAnalyser()
+        plants = []  # the analyser reads the organs
+        for i in range(0, 3):
+            rs = rb.RootSystem()
+            rs.readParameters("modelparameter/" + name + ".xml")
+            rs.setSeed(i + 1)
+            rs.initialize()
+            rs.simulate(10)
+            store.addSegments(rs)
+            ana.addSegments(rs)
+            plants.append(rs)
+        n = len(ana.segments)
+        self.assertEqual(store.getNumberOfSegments(), n, "segment store: wrong number of segments")
+        self.assertGreater(store.getNumberOfChunks(), 3, "segment store: plants were not split into chunks")
+        reopened = rb.SegmentStore(out("test_segment_store.bin"))
+        self.assertEqual(reopened.getNumberOfChunks(), store.getNumberOfChunks(), "segment store: wrong number of chunks after reopening")
+        self.assertEqual(list(reopened.getTypes()), ["radius", "subType"], "segment store: wrong parameters after reopening")
+        for st in [store, reopened]:
+            for p in ["length", "surface", "subType", "creationTime"]:
+                self.assertAlmostEqual(st.getSummed(p), ana.getSummed(p), 8, "segment store: wrong sum of " + p)
+            d, dref = st.distribution("length", 0., -20., 10, True), ana.distribution("length", 0., -20., 10, True)
+            for a, b in zip(d, dref):
+                self.assertAlmostEqual(a, b, 8, "segment store: wrong distribution")
+        filtered = rb.SegmentStore(out("test_segment_store_filtered.bin"), types)
+        reopened.filter("subType", 2., filtered)
+        ana.filter("subType", 2.)
+        self.assertEqual(filtered.getNumberOfSegments(), len(ana.segments), "segment store: wrong number of filtered segments")
+        self.assertAlmostEqual(filtered.getSummed("length"), ana.getSummed("length"), 8, "segment store: wrong filtered length")
+        box = rb.SDF_PlantBox(4., 4., 6.)
+        cropped = rb.SegmentStore(out("test_segment_store_cropped.bin"), types)
+        filtered.crop(box, cropped)
+        ana.crop(box)
+        self.assertAlmostEqual(cropped.getSummed("length"), ana.getSummed("length"), 8, "segment store: wrong cropped length")
+        self.assertAlmostEqual(cropped.load().getSummed("volume"), ana.getSummed("volume"), 8, "segment store: wrong volume of the loaded segments")
+
+    def test_segment_view(self):
+        """ checks the non-owning segment view against a SegmentAnalyser """
+        name = "Anagallis_femina_Leitner_2010"
+        rs = rb.RootSystem()
+        rs.readParameters("modelparameter/" + name + ".xml")
+        rs.setSeed(5)
+        rs.initialize()
+        rs.simulate(15)
+        ana = rb.SegmentAnalyser(rs)
+        view = rb.SegmentView(rs)
+        self.assertEqual(view.getNumberOfSegments(), len(ana.segments), "segment view: wrong number of segments")
+        for p in ["length", "surface", "volume", "subType", "creationTime"]:
+            self.assertAlmostEqual(view.getSummed(p), ana.getSummed(p), 8, "segment view: wrong sum of " + p)
+        d, dref = view.distribution("length", 0., -20., 10, True), ana.distribution("length", 0., -20., 10, True)
+        for a, b in zip(d, dref):
+            self.assertAlmostEqual(a, b, 8, "segment view: wrong distribution")
+        box = rb.SDF_PlantBox(4., 4., 6.)
+        view.filter("subType", 2.).crop(box)
+        ana.filter("subType", 2.)
+        ana.crop(box)
+        self.assertEqual(view.getNumberOfSegments(), len(ana.segments), "segment view: wrong number of cropped segments")
+        self.assertGreater(view.getNumberOfCuts(), 0, "segment view: no segment was cut")
+        self.assertAlmostEqual(view.getSummed("length"), ana.getSummed("length"), 8, "segment view: wrong cropped length")
+        self.assertAlmostEqual(view.getAnalyser().getSummed("surface"), ana.getSummed("surface"), 8, "segment view: wrong surface of the analyser")
+        self.assertEqual(rb.SegmentView(rs).getNumberOfSegments(), rs.getNumberOfSegments(), "segment view: the organism was changed")
+
+    def test_bound_field(self):
+        """ checks that grid lookups read bound external fields, and the double buffer swap """
+        import array
+        import sys
+        grid = rb.EquidistantGrid3D(20, 20, 50, 5, 5, 11)
+        n = len(grid.data)
+        front, back = array.array("d", [0.5] * n), array.array("d", [0.25] * n)
+        grid.bindFields(front, back)
+        p = rb.Vector3d(1, 1, -10)
+        self.assertTrue(grid.isBound(), "bound field: grid is not bound")
+        self.assertEqual(grid.getValue(p), 0.5, "bound field: wrong front value")
+        front[grid.index(2, 2, 8)] = 0.75  # in place, without copying
+        self.assertEqual(grid.getValue(p), 0.75, "bound field: field was copied")
+        version = grid.getVersion()
+        grid.swapFields()
+        self.assertGreater(grid.getVersion(), version, "bound field: swap does not invalidate the samples")
+        self.assertTrue(grid.isFrontField(back), "bound field: back buffer was not published")
+        self.assertEqual(grid.getValue(p), 0.25, "bound field: wrong value after swap")
+        self.assertRaises(Exception, grid.setData, 2, 2, 8, 1.)
+        self.assertRaises(Exception, grid.bindField, array.array("d", [0.] * (n - 1)))
+        self.assertRaises(BufferError, front.append, 0.)  # the views are held while the fields are bound
+        self.assertRaises(BufferError, back.append, 0.)
+        field = array.array("d", [0.125] * n)
+        refs = sys.getrefcount(field)
+        grid.bindField(field)  # rebinding releases the previous views
+        for a in [front, back]:
+            a.append(0.)
+            a.pop()
+        self.assertEqual(grid.getValue(p), 0.125, "bound field: wrong value after rebinding")
+        self.assertRaises(BufferError, field.append, 0.)
+        grid.unbindField()
+        self.assertFalse(grid.isBound(), "bound field: grid is still bound")
+        self.assertEqual(grid.getValue(p), 0., "bound field: wrong value of the own data")
+        field.append(0.)  # the view is released by unbindField
+        self.assertEqual(sys.getrefcount(field), refs, "bound field: the field is still referenced")
+
 #     def test_stack(self):
 #         """ checks if push and pop are working """
 